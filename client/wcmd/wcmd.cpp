@@ -448,8 +448,25 @@ OpenDB()
   if (level >= VL_DEBUG)
     cout << "Opening database: " << workDB << " ... ";
 
-  IDBSHandler& dbsHnd = DBSRetrieveDatabase(workDB.c_str());
-  SetDbsHandler(dbsHnd);
+  try
+  {
+    SetDbsHandler(DBSRetrieveDatabase(workDB.c_str()));
+  }
+  catch (const DBSException& e)
+  {
+    //Try first to replay the updates logged since the last checkpoint, the
+    //whole database needs to be checked only if that is not possible.
+    if ((e.Code() != DBSException::DATABASE_IN_USE)
+        || ! DBSRecoverDatabase(workDB.c_str()))
+    {
+      throw;
+    }
+
+    if (level >= VL_DEBUG)
+      cout << "recovered ... ";
+
+    SetDbsHandler(DBSRetrieveDatabase(workDB.c_str()));
+  }
 
   if (level >= VL_DEBUG)
     cout << "done." << endl;
@@ -667,12 +667,39 @@ TableAlterRules::CommitToTable(ITable&                 table,
     }
 }
 
+bool
+TableAlterRules::CommitInPlace()
+{
+  //Only new fields can be added without copying the table's rows.
+  if (mSrcFields.size() != mTable->FieldsCount())
+    return false;
+
+  for (size_t f = 0; f < mSrcFields.size(); ++f)
+    {
+      if ((strcmp(mSrcFields[f].name, mDstFields[f].name) != 0)
+          || (mSrcFields[f].type != mDstFields[f].type)
+          || (mSrcFields[f].isArray != mDstFields[f].isArray))
+        {
+          return false;
+        }
+    }
+
+  for (size_t f = mSrcFields.size(); f < mDstFields.size(); ++f)
+    mDbs.AddTableField(mTableName.c_str(), mDstFields[f]);
+
+  return true;
+}
+
+
 void
 TableAlterRules::Commit()
 {
   static const char temporalTableName[] = "_temporal_persitent_table_";
   assert(mTableName.length() > 0);
 
+  if (CommitInPlace())
+    return;
+
   vector<DBSFieldDescriptor> dummy = mDstFields;
   ITable* table = nullptr;
   Range<ROW_INDEX> allRows;
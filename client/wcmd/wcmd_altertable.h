@@ -63,6 +63,7 @@ private:
 
   void CommitToTable(whais::ITable&                 table,
                       const whais::Range<ROW_INDEX>& selectedRows);
+  bool CommitInPlace();
 
   struct FieldConnection
   {
@@ -117,6 +117,10 @@ repair_callback(const FIX_ERROR_CALLBACK_TYPE type,
     result = false;
     break;
 
+  case PROGRESS_INFO:
+    cout << "CHK PRG: ";
+    break;
+
   default:
 
     assert(false);
@@ -117,12 +117,58 @@ static const char tableCopeDescExt[] =
 static const char tableAddIndDesc[]    = "Index the specified field tables.";
 static const char tableAddIndDescExt[] =
   "Index the values of the specified table fields for faster searching.\n"
-  "Currently it does not support to index array nor text field types.\n"
+  "Currently it does not support to index array field types.\n"
   "Usage:\n"
   "  index table_name field_name [second_field_name ...]\n"
   "Example:\n"
   "  index mytab password_hash";
 
+static const char tableHashIndDesc[]    = "Index the specified table fields by"
+                                          " their values hashes.";
+static const char tableHashIndDescExt[] =
+  "Index the values of the specified table fields by their hashes. Such an\n"
+  "index finds faster the rows holding a given value and takes less space,\n"
+  "but it does not help to find the rows holding a range of values.\n"
+  "Currently it does not support to index array field types.\n"
+  "Usage:\n"
+  "  hashindex table_name field_name [second_field_name ...]\n"
+  "Example:\n"
+  "  hashindex mytab user_name";
+
+static const char tableBitmapIndDesc[]    = "Index the specified table fields by"
+                                            " the rows of each value.";
+static const char tableBitmapIndDescExt[] =
+  "Index the values of the specified table fields by keeping the set of\n"
+  "rows holding each of them. It suits the fields with few distinct values\n"
+  "(e.g. statuses or flags), whose conditions are combined quickly.\n"
+  "Currently it does not support to index text or array field types.\n"
+  "Usage:\n"
+  "  bitmapindex table_name field_name [second_field_name ...]\n"
+  "Example:\n"
+  "  bitmapindex mytab order_status";
+
+static const char tableTrigramIndDesc[]    = "Index the specified text fields by"
+                                             " their values trigrams.";
+static const char tableTrigramIndDescExt[] =
+  "Index the values of the specified text fields by the sequences of three\n"
+  "characters they hold, so the rows holding a substring are found faster.\n"
+  "The characters casing is ignored. It supports only text fields.\n"
+  "Usage:\n"
+  "  trigramindex table_name field_name [second_field_name ...]\n"
+  "Example:\n"
+  "  trigramindex mytab customer_name";
+
+static const char tableElementsIndDesc[]    = "Index the specified array fields by"
+                                              " their elements.";
+static const char tableElementsIndDescExt[] =
+  "Index the values of the specified array fields by their elements, so the\n"
+  "rows whose arrays hold some values are found faster. It supports only\n"
+  "array fields.\n"
+  "Usage:\n"
+  "  elementsindex table_name field_name [second_field_name ...]\n"
+  "Example:\n"
+  "  elementsindex mytab product_tags";
+
 static const char tableRmIndDesc[]    = "Remove the index associated with some"
                                         " table fields.";
 static const char tableRmIndDescExt[] =
@@ -132,6 +178,35 @@ static const char tableRmIndDescExt[] =
   "Example:\n"
   "  rmindex mytab password_hash";
 
+static const char tableLoadDesc[]    = "Load rows in bulk from a file.";
+static const char tableLoadDescExt[] =
+  "Append to a table the rows of a CSV or binary file. The values are\n"
+  "parsed by several threads and the table indexes are updated once all\n"
+  "rows are in. Only the specified fields are loaded (by default all of\n"
+  "them, in the table order); the rest are left null.\n"
+  "In CSV files the values are in the same format used by 'rows', a null\n"
+  "value is left empty, a value with commas is double quoted and the\n"
+  "array elements are separated by semicolons.\n"
+  "Usage:\n"
+  "  load table_name csv|bin file_name [field_name ...]\n"
+  "Example:\n"
+  "  load mytab csv /tmp/feed.csv\n"
+  "  load mytab bin /tmp/feed.bin id name";
+
+static const char tableExportDesc[]    = "Export a table to a columnar file.";
+static const char tableExportDescExt[] =
+  "Write a snapshot of the table rows to a file that keeps the values of\n"
+  "every field together, for analytics tools. Each field's values are\n"
+  "encoded on their own (as plain values, runs, deltas or a dictionary of\n"
+  "distinct texts), several fields at once. Only the specified fields are\n"
+  "exported (by default all of them) and the rows free for reuse are\n"
+  "skipped. The table is not updated while its rows are exported.\n"
+  "Usage:\n"
+  "  export table_name file_name [field_name ...]\n"
+  "Example:\n"
+  "  export mytab /tmp/mytab.cols\n"
+  "  export mytab /tmp/mytab.cols id name";
+
 static const char rowsDesc[]    = "Manipulate table rows.";
 static const char rowsDescExt[] =
   "This command is used to manage the rows of a table. It can be used to\n"
@@ -773,7 +848,24 @@ cmdTableAddIndex(const string& cmdLine, ENTRY_CMD_CONTEXT context)
   ITable*              table   = nullptr;
   bool                 result  = true;
 
-  assert(token == "index");
+  assert((token == "index")
+         || (token == "hashindex")
+         || (token == "bitmapindex")
+         || (token == "trigramindex")
+         || (token == "elementsindex"));
+
+  DBS_INDEX_KIND kind = INDEX_BTREE;
+  if (token == "hashindex")
+    kind = INDEX_HASH;
+
+  else if (token == "bitmapindex")
+    kind = INDEX_BITMAP;
+
+  else if (token == "trigramindex")
+    kind = INDEX_TRIGRAM;
+
+  else if (token == "elementsindex")
+    kind = INDEX_ELEMENTS;
 
   if (linePos >= cmdLine.length())
     goto invalid_args;
@@ -811,12 +903,12 @@ cmdTableAddIndex(const string& cmdLine, ENTRY_CMD_CONTEXT context)
               {
                 CreateIndexCallbackContext context;
 
-                table->CreateIndex(field, create_index_call_back, &context);
+                table->CreateIndex(field, create_index_call_back, &context, kind);
 
                 cout << endl;
               }
             else
-              table->CreateIndex(field, nullptr, nullptr);
+              table->CreateIndex(field, nullptr, nullptr, kind);
           }
       }
       catch(const Exception& e)
@@ -1426,6 +1518,180 @@ invalid_args:
 }
 
 
+static bool
+cmdTableLoad(const string& cmdLine, ENTRY_CMD_CONTEXT context)
+{
+  IDBSHandler&         dbs     = *_RC(IDBSHandler*, context);
+  size_t               linePos = 0;
+  string               token   = CmdLineNextToken(cmdLine, linePos);
+  const  VERBOSE_LEVEL level   = GetVerbosityLevel();
+  ITable*              table   = nullptr;
+  bool                 result  = true;
+
+  assert(token == "load");
+
+  if (linePos >= cmdLine.length())
+    goto invalid_args;
+
+  try
+  {
+    token = CmdLineNextToken(cmdLine, linePos);
+    table = &dbs.RetrievePersistentTable(token.c_str());
+  }
+  catch(const Exception& e)
+  {
+    if (level >= VL_INFO)
+      cerr << "Failed to open table '" << token << "'.\n";
+
+    printException(cerr, e);
+
+    return false;
+  }
+
+  if (linePos >= cmdLine.length())
+    goto invalid_args;
+
+  {
+    DBS_LOAD_FORMAT format;
+
+    token = CmdLineNextToken(cmdLine, linePos);
+    if (token == "csv")
+      format = LOAD_CSV;
+
+    else if (token == "bin")
+      format = LOAD_BINARY;
+
+    else
+      goto invalid_args;
+
+    if (linePos >= cmdLine.length())
+      goto invalid_args;
+
+    const string fileName = CmdLineNextToken(cmdLine, linePos);
+    vector<FIELD_INDEX> fields;
+
+    try
+    {
+      while (linePos < cmdLine.length())
+      {
+        token = CmdLineNextToken(cmdLine, linePos);
+        if ( ! token.empty())
+          fields.push_back(table->RetrieveField(token.c_str()));
+      }
+
+      const ROW_INDEX loadedRows = table->LoadRows(fileName.c_str(),
+                                                   format,
+                                                   fields.data(),
+                                                   fields.size());
+      if (level >= VL_INFO)
+        cout << "Loaded " << loadedRows << " rows.\n";
+    }
+    catch(const Exception& e)
+    {
+      if (level >= VL_INFO)
+        cerr << "Failed to load the rows of file '" << fileName << "'.\n";
+
+      printException(cerr, e);
+
+      result = false;
+    }
+  }
+
+  dbs.ReleaseTable(*table);
+
+  return result;
+
+invalid_args:
+
+  if (table)
+    dbs.ReleaseTable(*table);
+
+  if (level >= VL_ERROR)
+    cerr << "Invalid commands arguments.\n";
+
+  return false;
+}
+
+
+static bool
+cmdTableExport(const string& cmdLine, ENTRY_CMD_CONTEXT context)
+{
+  IDBSHandler&         dbs     = *_RC(IDBSHandler*, context);
+  size_t               linePos = 0;
+  string               token   = CmdLineNextToken(cmdLine, linePos);
+  const  VERBOSE_LEVEL level   = GetVerbosityLevel();
+  ITable*              table   = nullptr;
+  bool                 result  = true;
+
+  assert(token == "export");
+
+  if (linePos >= cmdLine.length())
+    goto invalid_args;
+
+  try
+  {
+    token = CmdLineNextToken(cmdLine, linePos);
+    table = &dbs.RetrievePersistentTable(token.c_str());
+  }
+  catch(const Exception& e)
+  {
+    if (level >= VL_INFO)
+      cerr << "Failed to open table '" << token << "'.\n";
+
+    printException(cerr, e);
+
+    return false;
+  }
+
+  if (linePos >= cmdLine.length())
+    goto invalid_args;
+
+  {
+    const string fileName = CmdLineNextToken(cmdLine, linePos);
+    vector<FIELD_INDEX> fields;
+
+    try
+    {
+      while (linePos < cmdLine.length())
+      {
+        token = CmdLineNextToken(cmdLine, linePos);
+        if ( ! token.empty())
+          fields.push_back(table->RetrieveField(token.c_str()));
+      }
+
+      const ROW_INDEX exportedRows = table->ExportRows(fileName.c_str(),
+                                                       fields.data(),
+                                                       fields.size());
+      if (level >= VL_INFO)
+        cout << "Exported " << exportedRows << " rows.\n";
+    }
+    catch(const Exception& e)
+    {
+      if (level >= VL_INFO)
+        cerr << "Failed to export the rows to file '" << fileName << "'.\n";
+
+      printException(cerr, e);
+
+      result = false;
+    }
+  }
+
+  dbs.ReleaseTable(*table);
+
+  return result;
+
+invalid_args:
+
+  if (table)
+    dbs.ReleaseTable(*table);
+
+  if (level >= VL_ERROR)
+    cerr << "Invalid commands arguments.\n";
+
+  return false;
+}
+
+
 void
 AddOfflineTableCommands()
 {
@@ -1473,6 +1739,38 @@ AddOfflineTableCommands()
 
   RegisterCommand(entry);
 
+  entry.mShowStatus   = true;
+  entry.mName         = "hashindex";
+  entry.mDesc         = tableHashIndDesc;
+  entry.mExtendedDesc = tableHashIndDescExt;
+  entry.mCmd          = cmdTableAddIndex;
+
+  RegisterCommand(entry);
+
+  entry.mShowStatus   = true;
+  entry.mName         = "bitmapindex";
+  entry.mDesc         = tableBitmapIndDesc;
+  entry.mExtendedDesc = tableBitmapIndDescExt;
+  entry.mCmd          = cmdTableAddIndex;
+
+  RegisterCommand(entry);
+
+  entry.mShowStatus   = true;
+  entry.mName         = "trigramindex";
+  entry.mDesc         = tableTrigramIndDesc;
+  entry.mExtendedDesc = tableTrigramIndDescExt;
+  entry.mCmd          = cmdTableAddIndex;
+
+  RegisterCommand(entry);
+
+  entry.mShowStatus   = true;
+  entry.mName         = "elementsindex";
+  entry.mDesc         = tableElementsIndDesc;
+  entry.mExtendedDesc = tableElementsIndDescExt;
+  entry.mCmd          = cmdTableAddIndex;
+
+  RegisterCommand(entry);
+
   entry.mShowStatus   = true;
   entry.mName         = "rmindex";
   entry.mDesc         = tableRmIndDesc;
@@ -1481,6 +1779,22 @@ AddOfflineTableCommands()
 
   RegisterCommand(entry);
 
+  entry.mShowStatus   = true;
+  entry.mName         = "load";
+  entry.mDesc         = tableLoadDesc;
+  entry.mExtendedDesc = tableLoadDescExt;
+  entry.mCmd          = cmdTableLoad;
+
+  RegisterCommand(entry);
+
+  entry.mShowStatus   = true;
+  entry.mName         = "export";
+  entry.mDesc         = tableExportDesc;
+  entry.mExtendedDesc = tableExportDescExt;
+  entry.mCmd          = cmdTableExport;
+
+  RegisterCommand(entry);
+
   entry.mShowStatus   = true;
   entry.mName         = "alter";
   entry.mDesc         = fieldsDesc;
@@ -31,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <sched.h>
 #include <unistd.h>
 #include <pthread.h>
+#include <time.h>
 
 uint_t
 wh_lock_init(WH_LOCK* const lock)
@@ -134,6 +135,105 @@ wh_lock_release(WH_LOCK* const lock)
 }
 
 
+uint_t
+wh_cond_init(WH_COND* const cond)
+{
+  uint_t result;
+
+  do
+    result = pthread_cond_init(cond, NULL);
+  while (result == EAGAIN);
+
+  if (result == 0)
+    return WOP_OK;
+
+  return result;
+}
+
+
+uint_t
+wh_cond_destroy(WH_COND* const cond)
+{
+  const uint_t result = pthread_cond_destroy(cond);
+
+  if (result == 0)
+    return WOP_OK;
+
+  return result;
+}
+
+
+uint_t
+wh_cond_wait(WH_COND* const cond, WH_LOCK* const lock)
+{
+  const uint_t result = pthread_cond_wait(cond, lock);
+
+  if (result == 0)
+    return WOP_OK;
+
+  return result;
+}
+
+
+uint_t
+wh_cond_timed_wait(WH_COND* const  cond,
+                    WH_LOCK* const  lock,
+                    const uint_t    millisecs,
+                    bool_t* const   outTimeout)
+{
+  struct timespec deadline;
+  int result;
+
+  clock_gettime(CLOCK_REALTIME, &deadline);
+
+  deadline.tv_sec  += millisecs / 1000;
+  deadline.tv_nsec += (millisecs % 1000) * 1000000L;
+  if (deadline.tv_nsec >= 1000000000L)
+    {
+      deadline.tv_sec  += 1;
+      deadline.tv_nsec -= 1000000000L;
+    }
+
+  result = pthread_cond_timedwait(cond, lock, &deadline);
+  if (result == 0)
+    {
+      *outTimeout = FALSE;
+      return WOP_OK;
+    }
+  else if (result == ETIMEDOUT)
+    {
+      *outTimeout = TRUE;
+      return WOP_OK;
+    }
+
+  return result;
+}
+
+
+uint_t
+wh_cond_signal(WH_COND* const cond)
+{
+  const uint_t result = pthread_cond_signal(cond);
+
+  if (result == 0)
+    return WOP_OK;
+
+  return result;
+}
+
+
+uint_t
+wh_cond_broadcast(WH_COND* const cond)
+{
+  const uint_t result = pthread_cond_broadcast(cond);
+
+  if (result == 0)
+    return WOP_OK;
+
+  return result;
+}
+
+
 uint_t
 wh_thread_create(WH_THREAD*  const             outThread,
                   const WH_THREAD_ROUTINE       routine,
@@ -211,6 +311,18 @@ wh_atomic_fetch_dec64(volatile int64_t* const value)
   return __sync_fetch_and_sub(value, (int64_t)1);
 }
 
+int32_t
+wh_atomic_fetch_or32(volatile int32_t* const value, const int32_t mask)
+{
+  return __sync_fetch_and_or(value, mask);
+}
+
+int32_t
+wh_atomic_fetch_and32(volatile int32_t* const value, const int32_t mask)
+{
+  return __sync_fetch_and_and(value, mask);
+}
+
 
 #if defined(ARCH_PPC)
 /* These functions are required by GCC compiler for PPC target processor as
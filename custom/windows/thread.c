@@ -74,6 +74,78 @@ wh_lock_release(WH_LOCK* const lock)
 }
 
 
+uint_t
+wh_cond_init(WH_COND* const cond)
+{
+  InitializeConditionVariable(cond);
+
+  return WOP_OK;
+}
+
+
+uint_t
+wh_cond_destroy(WH_COND* const cond)
+{
+  //Windows' condition variables do not need to be released.
+  return WOP_OK;
+}
+
+
+uint_t
+wh_cond_wait(WH_COND* const cond, WH_LOCK* const lock)
+{
+  if ( ! SleepConditionVariableCS(cond, lock, INFINITE))
+    {
+      const uint_t result = GetLastError();
+
+      return(result == WOP_OK) ? WOP_UNKNOW : result;
+    }
+
+  return WOP_OK;
+}
+
+
+uint_t
+wh_cond_timed_wait(WH_COND* const  cond,
+                    WH_LOCK* const  lock,
+                    const uint_t    millisecs,
+                    bool_t* const   outTimeout)
+{
+  *outTimeout = FALSE;
+  if ( ! SleepConditionVariableCS(cond, lock, millisecs))
+    {
+      const uint_t result = GetLastError();
+      if (result == ERROR_TIMEOUT)
+        {
+          *outTimeout = TRUE;
+          return WOP_OK;
+        }
+
+      return(result == WOP_OK) ? WOP_UNKNOW : result;
+    }
+
+  return WOP_OK;
+}
+
+
+uint_t
+wh_cond_signal(WH_COND* const cond)
+{
+  WakeConditionVariable(cond);
+
+  return WOP_OK;
+}
+
+
+uint_t
+wh_cond_broadcast(WH_COND* const cond)
+{
+  WakeAllConditionVariable(cond);
+
+  return WOP_OK;
+}
+
+
 uint_t
 wh_thread_create(WH_THREAD* const              outThread,
                   const WH_THREAD_ROUTINE       routine,
@@ -159,3 +231,15 @@ wh_atomic_fetch_dec64(volatile int64_t* const value)
 {
   return InterlockedDecrement64(value) + 1;
 }
+
+int32_t
+wh_atomic_fetch_or32(volatile int32_t* const value, const int32_t mask)
+{
+  return InterlockedOr((volatile LONG*)value, mask);
+}
+
+int32_t
+wh_atomic_fetch_and32(volatile int32_t* const value, const int32_t mask)
+{
+  return InterlockedAnd((volatile LONG*)value, mask);
+}
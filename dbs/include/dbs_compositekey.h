@@ -0,0 +1,92 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+
+#ifndef DBS_COMPOSITEKEY_H_
+#define DBS_COMPOSITEKEY_H_
+
+#include "dbs_types.h"
+#include "dbs_values.h"
+
+
+namespace whais {
+
+
+/* A key of a composite index: the values of its fields, or only of some of
+ * the leading ones, added in the index's fields order. The values are kept so
+ * two keys compare byte by byte like their values do, field after field, the
+ * null values being the smallest. A key missing the values of the last fields
+ * is the lowest key starting with its values, or the highest one once it is
+ * marked as an upper bound, so two such keys bound a range scan of the index. */
+class DBS_SHL CompositeKey
+{
+public:
+  static const uint_t SIZE = 48;
+
+  CompositeKey();
+
+  //A key as it is kept by an index.
+  explicit CompositeKey(const uint8_t* const rawKey);
+
+  //Add the value of the next field. A key is too small for too many fields.
+  void Add(const DBool& value);
+  void Add(const DChar& value);
+  void Add(const DDate& value);
+  void Add(const DDateTime& value);
+  void Add(const DHiresTime& value);
+  void Add(const DInt8& value);
+  void Add(const DInt16& value);
+  void Add(const DInt32& value);
+  void Add(const DInt64& value);
+  void Add(const DUInt8& value);
+  void Add(const DUInt16& value);
+  void Add(const DUInt32& value);
+  void Add(const DUInt64& value);
+  void Add(const DReal& value);
+  void Add(const DRichReal& value);
+
+  //The values of the fields not added yet are taken as the biggest ones.
+  void MarkUpperBound();
+
+  //All of the key's values are null.
+  bool IsNull() const;
+  DBS_FIELD_TYPE DBSType() const { return T_UNDETERMINED; }
+  const uint8_t* RawKey() const { return mKey; }
+
+  bool operator< (const CompositeKey& second) const;
+  bool operator== (const CompositeKey& second) const;
+
+  static CompositeKey Max();
+
+private:
+  template<class T> void AddValue(const T& value);
+
+  uint8_t   mKey[SIZE];
+  uint_t    mSize;
+};
+
+
+} //namespace whais
+
+#endif /* DBS_COMPOSITEKEY_H_ */
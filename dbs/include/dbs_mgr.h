@@ -25,8 +25,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DBS_MGR_H_
 #define DBS_MGR_H_
 
+#include <memory>
 #include <string>
 
+#include "utils/wthread.h"
 #include "dbs_types.h"
 #include "dbs_table.h"
 
@@ -41,7 +43,18 @@ enum FIX_ERROR_CALLBACK_TYPE {
   FIX_QUESTION,
   CONFIRMATION_QUESTION,
   OPTIMISE_QUESTION,
-  CRITICAL
+  CRITICAL,
+  PROGRESS_INFO
+};
+
+
+/* When the updates of the persistent tables are made durable in the
+ * database's redo log. */
+enum DBS_DURABILITY
+{
+  DURABILITY_ASYNC = 0,      //Only when the tables' content is synchronised.
+  DURABILITY_PER_PROCEDURE,  //At the end of every procedure call.
+  DURABILITY_PER_WRITE       //After every table update.
 };
 
 
@@ -51,6 +64,14 @@ static const uint32_t DEFAULT_TABLE_CACHE_BLK_COUNT     = 1024u;
 static const uint32_t DEFAULT_VLSTORE_CACHE_BLK_SIZE    = 16384u;       //16KB
 static const uint32_t DEFAULT_VLSTORE_CACHE_BLK_COUNT   = 1024u;
 static const uint32_t DEFAULT_VLVALUE_CACHE_SIZE        = 512u;
+static const uint64_t DEFAULT_TEMP_MEMORY_LIMIT         = 268435456ul;  //256MB
+static const uint64_t DEFAULT_SESSION_TEMP_MEMORY_LIMIT = 67108864ul;   //64MB
+static const uint32_t DEFAULT_CHECKPOINT_BATCH          = 16u;          //Blocks per table lock
+static const uint32_t DEFAULT_CHECKPOINT_PAUSE          = 0u;           //Milliseconds
+static const uint32_t DEFAULT_CHECK_THREADS             = 4u;
+static const uint32_t DEFAULT_SORT_THREADS              = 4u;
+static const uint32_t DEFAULT_LOAD_THREADS              = 4u;
+static const uint32_t DEFAULT_EXPORT_THREADS            = 4u;
 
 
 class DBS_SHL IDBSHandler
@@ -65,9 +86,16 @@ public:
                         const FIELD_INDEX   fieldsCount,
                         DBSFieldDescriptor* const inoutFields) = 0;
   virtual void DeleteTable(const char* const name) = 0;
+  //Change the layout of a table while keeping its rows. The rows already
+  //stored are converted in the background, as part of the checkpoints.
+  virtual void AddTableField(const char* const name, const DBSFieldDescriptor& field) = 0;
+  virtual void RetypeTableField(const char* const      name,
+                                const char* const      field,
+                                const DBS_FIELD_TYPE   type) = 0;
   virtual void SyncAllTablesContent() = 0;
   virtual void SyncTableContent(const TABLE_INDEX index) = 0;
   virtual bool NotifyDatabaseUpdate(const bool tryDbLock) = 0;
+  virtual void CommitUpdates() = 0;
   virtual ITable& CreateTempTable(const FIELD_INDEX   fieldsCount,
                                   DBSFieldDescriptor* inoutFields) = 0;
 
@@ -86,7 +114,16 @@ struct DBSSettings
       mTableCacheBlkCount(DEFAULT_TABLE_CACHE_BLK_COUNT),
       mVLStoreCacheBlkSize(DEFAULT_VLSTORE_CACHE_BLK_SIZE),
       mVLStoreCacheBlkCount(DEFAULT_VLSTORE_CACHE_BLK_COUNT),
-      mVLValueCacheSize(DEFAULT_VLVALUE_CACHE_SIZE)
+      mVLValueCacheSize(DEFAULT_VLVALUE_CACHE_SIZE),
+      mTempMemoryLimit(DEFAULT_TEMP_MEMORY_LIMIT),
+      mSessionTempMemoryLimit(DEFAULT_SESSION_TEMP_MEMORY_LIMIT),
+      mDurability(DURABILITY_ASYNC),
+      mCheckpointBatch(DEFAULT_CHECKPOINT_BATCH),
+      mCheckpointPause(DEFAULT_CHECKPOINT_PAUSE),
+      mCheckThreads(DEFAULT_CHECK_THREADS),
+      mSortThreads(DEFAULT_SORT_THREADS),
+      mLoadThreads(DEFAULT_LOAD_THREADS),
+      mExportThreads(DEFAULT_EXPORT_THREADS)
   {
   }
 
@@ -98,6 +135,61 @@ struct DBSSettings
   uint32_t      mVLStoreCacheBlkSize;
   uint32_t      mVLStoreCacheBlkCount;
   uint32_t      mVLValueCacheSize;
+  uint64_t      mTempMemoryLimit;
+  uint64_t      mSessionTempMemoryLimit;
+  DBS_DURABILITY mDurability;
+  uint32_t      mCheckpointBatch;
+  uint32_t      mCheckpointPause;
+  uint32_t      mCheckThreads;
+  uint32_t      mSortThreads;
+  uint32_t      mLoadThreads;
+  uint32_t      mExportThreads;
+};
+
+
+struct DBSTempMemoryStats
+{
+  uint64_t      mUsed;
+  uint64_t      mPeak;
+  uint64_t      mSpillsCount;
+  uint64_t      mSpilledBytes;
+};
+
+
+/* Accounts the memory used by the temporal values (e.g. procedures' local
+ * arrays and texts). A temporal value keeps its content in memory until its
+ * budget (or the server wide one) is exhausted, and only then it is moved to
+ * a temporal file. */
+class DBS_SHL TempMemoryBudget
+{
+public:
+  explicit TempMemoryBudget(const uint64_t limit);
+
+  TempMemoryBudget(const TempMemoryBudget&) = delete;
+  TempMemoryBudget& operator= (const TempMemoryBudget&) = delete;
+
+  bool Reserve(const uint64_t size);
+  void Release(const uint64_t size);
+  void NotifySpill(const uint64_t size);
+
+  uint64_t Limit() const { return mLimit; }
+  void Limit(const uint64_t limit) { mLimit = limit; }
+
+  DBSTempMemoryStats Stats();
+
+  //The budget used by the temporal values created by the calling thread.
+  static std::shared_ptr<TempMemoryBudget> Current();
+  static std::shared_ptr<TempMemoryBudget> Current(std::shared_ptr<TempMemoryBudget> budget);
+
+  static TempMemoryBudget& ServerBudget();
+
+private:
+  TempMemoryBudget(const uint64_t limit, TempMemoryBudget* const parent);
+
+  TempMemoryBudget* const   mParent;
+  uint64_t                  mLimit;
+  DBSTempMemoryStats        mStats;
+  Lock                      mSync;
 };
 
 
@@ -127,6 +219,10 @@ DBSRepairDatabase(const char* const            name,
                   const char*                  path        = nullptr,
                   FIX_ERROR_CALLBACK           fixCallback = nullptr);
 
+DBS_SHL bool
+DBSRecoverDatabase(const char* const name,
+                   const char*       path = nullptr);
+
 DBS_SHL IDBSHandler&
 DBSRetrieveDatabase(const char* const name,
                     const char*       path = nullptr);
@@ -139,6 +235,9 @@ DBS_SHL void
 DBSRemoveDatabase(const char* const     name,
                   const char* const     path = nullptr);
 
+DBS_SHL DBSTempMemoryStats
+DBSGetTempMemoryStats();
+
 DBS_SHL const char*
 DescribeDbsEngineVersion();
 
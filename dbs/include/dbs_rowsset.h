@@ -0,0 +1,95 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef DBS_ROWSSET_H_
+#define DBS_ROWSSET_H_
+
+#include <vector>
+
+#include "dbs_types.h"
+#include "dbs_values.h"
+
+
+namespace whais {
+
+
+/* A set of rows kept as a compressed bitmap. The rows are split in blocks
+ * sharing their upper 16 bits; a block keeps the lower bits of its rows in
+ * a sorted list while they are few, or in a bitmap otherwise. Unlike a DArray
+ * of rows, the set stays in memory and its operations never need to sort. */
+class DBS_SHL RowsSet
+{
+public:
+  RowsSet() = default;
+
+  bool IsEmpty() const { return mBlocks.empty(); }
+  uint64_t Count() const;
+  bool Contains(const ROW_INDEX row) const;
+
+  void Add(const ROW_INDEX row);
+  void Add(const ROW_INDEX from, const ROW_INDEX to);
+  void Remove(const ROW_INDEX row);
+  void Clear() { mBlocks.clear(); }
+
+  RowsSet& Unite(const RowsSet& set);
+  RowsSet& Intersect(const RowsSet& set);
+
+  //The first row not less than 'from' or INVALID_ROW_INDEX if there is none.
+  ROW_INDEX Next(const ROW_INDEX from) const;
+  ROW_INDEX Last() const;
+
+  //Fills 'outRows' with the first rows not less than 'from'. Returns how many.
+  uint_t Fetch(const ROW_INDEX from, const uint_t count, ROW_INDEX* const outRows) const;
+
+  DArray ToArray() const;
+  static RowsSet FromArray(const DArray& rows);
+
+private:
+  struct Block
+  {
+    bool IsBitmap() const { return ! mBits.empty(); }
+    bool Contains(const uint16_t low) const;
+    int Next(const uint_t low) const;
+    void Add(const uint16_t low);
+    void Remove(const uint16_t low);
+    void AddRange(const uint_t from, const uint_t to);
+    void ToBitmap();
+    void Pack();
+
+    uint32_t                mKey    = 0;
+    uint32_t                mCount  = 0;
+    std::vector<uint16_t>   mLows;
+    std::vector<uint64_t>   mBits;
+  };
+
+  size_t FindBlock(const uint32_t key) const;
+  Block& RetrieveBlock(const uint32_t key);
+
+  std::vector<Block>    mBlocks;
+};
+
+
+} //namespace whais
+
+#endif /* DBS_ROWSSET_H_ */
@@ -25,8 +25,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DBS_TABLE_H_
 #define DBS_TABLE_H_
 
+#include <string>
+#include <vector>
+
 #include "dbs_types.h"
 #include "dbs_values.h"
+#include "dbs_rowsset.h"
+#include "dbs_compositekey.h"
 
 
 namespace whais {
@@ -44,6 +49,108 @@ class IDBSHandler;
 
 typedef void CREATE_INDEX_CALLBACK_FUNC(CreateIndexCallbackContext* cbContext);
 
+
+/* How the values of an indexed field are kept.
+ *
+ * INDEX_BTREE: sorted, so it serves the matches of any values range.
+ *
+ * INDEX_HASH: by their hashes, so it serves only the matches of a single
+ * value (the range ends are equal), but with fewer reads and in less space.
+ * The other matches of a such field are done by checking all its rows.
+ *
+ * INDEX_BITMAP: as a compressed set of rows for every distinct value, kept
+ * in memory. It suits the fields with a handful of distinct values (e.g.
+ * flags or status codes), as a match is the union of the sets of the values
+ * in range. It does not support the text fields.
+ *
+ * INDEX_TRIGRAM: only for text fields, as a set of rows for every sequence
+ * of three characters (ignoring their case) found in the fields' values. It
+ * serves the substring searches of MatchTextRows(), which check only the
+ * rows holding all the searched text's trigrams.
+ *
+ * INDEX_ELEMENTS: only for array fields, as a set of rows for every value
+ * found as an element of the fields' arrays. It serves the matches of
+ * MatchArrayRows(). */
+enum DBS_INDEX_KIND
+{
+  INDEX_BTREE = 0,
+  INDEX_HASH,
+  INDEX_BITMAP,
+  INDEX_TRIGRAM,
+  INDEX_ELEMENTS
+};
+
+
+/* How the rows loaded in bulk into a table are kept in their file.
+ *
+ * LOAD_CSV: a row per line, with the loaded fields values separated by
+ * commas. The values are written as the database translates them to text
+ * (e.g. '2011/12/31 23:59:59'); an empty one is null. The values holding
+ * commas, quotes or new lines are enclosed in double quotes, with their
+ * quotes doubled. The elements of an array are separated by semicolons.
+ *
+ * LOAD_BINARY: every row starts with a bit per loaded field, set when its
+ * value is null, followed by the values of the others. A basic value is kept
+ * as it is stored in the table's rows, a text one as its 32 bits UTF-8 size
+ * followed by its content and an array as its 32 bits elements count
+ * followed by its elements. All integers are little endian. */
+enum DBS_LOAD_FORMAT
+{
+  LOAD_CSV = 0,
+  LOAD_BINARY
+};
+
+
+/* How the values of a column are kept in the files written by a table export.
+ *
+ * The file starts with a 32 bits magic ('COLS'), a 16 bits version and a 16
+ * bits columns count. Each column is described by its 16 bits type (the array
+ * ones have 0x100 set) and its name (a 16 bits size followed by the name).
+ * The rows follow in groups, each starting with a 32 bits rows count. A group
+ * keeps first the rows numbers (as an EXPORT_DELTA column, without the nulls
+ * bits) and then its columns. A column is written as its encoding (8 bits),
+ * its content size (64 bits), a bit per group row set when its value is null
+ * and the values of the others. A group with no rows ends the file and is
+ * followed by the 64 bits count of the written rows. All integers are little
+ * endian.
+ *
+ * EXPORT_PLAIN: the values one after another. A basic one is kept as it is
+ * stored in the table's rows, a text one as its 32 bits UTF-8 size followed by
+ * its content and an array as its 32 bits elements count and its elements.
+ *
+ * EXPORT_RLE: runs of equal basic values, as a 32 bits run length and the
+ * run value.
+ *
+ * EXPORT_DELTA: the differences between consecutive basic values (the first
+ * one from 0) as zigzag LEB128 integers. The dates are counted as days since
+ * 1970/1/1, the date and times as seconds since then and the high resolution
+ * ones as microseconds since then; the characters as their code points.
+ *
+ * EXPORT_DICTIONARY: the distinct text values (a 32 bits count and the values
+ * as with EXPORT_PLAIN), followed by the LEB128 index of every value. */
+enum DBS_EXPORT_ENCODING
+{
+  EXPORT_PLAIN = 0,
+  EXPORT_RLE,
+  EXPORT_DELTA,
+  EXPORT_DICTIONARY
+};
+
+
+/* The distribution of a field's values, as estimated by its table. The rows
+ * free for reuse are not counted. The histogram splits the field's not null
+ * values in buckets holding about the same count of values; a bucket is
+ * described by its biggest value, written as text like the database
+ * translates it (e.g. '2011/12/31'). Text and array fields have no
+ * histogram and no distinct values estimate. */
+struct DBSFieldStats
+{
+  uint64_t                    mRowsCount      = 0;
+  uint64_t                    mNullsCount     = 0;
+  uint64_t                    mDistinctCount  = 0;
+  std::vector<std::string>    mHistogram;
+};
+
 class DBS_SHL ITable
 {
 public:
@@ -64,10 +171,31 @@ public:
 
   virtual void CreateIndex(const FIELD_INDEX                   field,
                            CREATE_INDEX_CALLBACK_FUNC* const   cbFunc,
-                           CreateIndexCallbackContext* const   cbContext) = 0;
+                           CreateIndexCallbackContext* const   cbContext,
+                           const DBS_INDEX_KIND                kind = INDEX_BTREE) = 0;
   virtual void RemoveIndex(const FIELD_INDEX field) = 0;
   virtual bool IsIndexed(const FIELD_INDEX field) const = 0;
 
+  //A composite index keeps the rows sorted by the values of several fields,
+  //compared in the specified order. It serves the matches of the leading
+  //fields values and the sorts by all its fields. Its fields may be indexed
+  //on their own too, but none may be a text or an array field.
+  virtual void CreateCompositeIndex(const FIELD_INDEX* const            fields,
+                                    const FIELD_INDEX                   fieldsCount,
+                                    CREATE_INDEX_CALLBACK_FUNC* const   cbFunc,
+                                    CreateIndexCallbackContext* const   cbContext) = 0;
+  virtual void RemoveCompositeIndex(const FIELD_INDEX* const   fields,
+                                    const FIELD_INDEX          fieldsCount) = 0;
+  //The fields of every composite index, in their order.
+  virtual std::vector<std::vector<FIELD_INDEX>> CompositeIndexes() = 0;
+
+  /* While deferred, the changes of the fields with a B-tree index are kept
+   * aside in memory, to be applied to the indexes in batches: when the table
+   * is flushed, when too many are kept or when an index is searched (the
+   * searches see them all). Meant for the bursts of updates of the same
+   * rows. Turning it off applies the changes kept so far. */
+  virtual void DeferIndexesUpdates(const bool defer) = 0;
+
   virtual void Set(const ROW_INDEX     row,
                    const FIELD_INDEX   field,
                    const DBool&        value,
@@ -213,9 +341,17 @@ public:
                             const bool        skipThreadSafety = false) = 0;
 
   virtual void Sort(const FIELD_INDEX   field,
-                      const ROW_INDEX     from,
-                      const ROW_INDEX     to,
-                      const bool         reverse) = 0;
+                    const ROW_INDEX     from,
+                    const ROW_INDEX     to,
+                    const bool          reverse) = 0;
+
+  //Sort the rows by the values of several fields; a row's value of a field
+  //is considered only when the values of the previous fields are equal.
+  virtual void Sort(const FIELD_INDEX* const   fields,
+                    const bool* const          reverse,
+                    const FIELD_INDEX          fieldsCount,
+                    const ROW_INDEX            from,
+                    const ROW_INDEX            to) = 0;
 
   virtual DArray MatchRows(const DBool&        min,
                            const DBool&        max,
@@ -292,6 +428,154 @@ public:
                            const ROW_INDEX     fromRow,
                            const ROW_INDEX     toRow,
                            const FIELD_INDEX   field) = 0;
+  //An indexed text field keeps only its values' prefixes in the index, so
+  //its matched rows are returned sorted by their indexes.
+  virtual DArray MatchRows(const DText&        min,
+                           const DText&        max,
+                           const ROW_INDEX     fromRow,
+                           const ROW_INDEX     toRow,
+                           const FIELD_INDEX   field) = 0;
+
+  //Same as MatchRows(), but the matching rows are kept in a compressed set
+  //sorted by their indexes, rather than in a temporal array.
+  virtual RowsSet MatchRowsSet(const DBool&        min,
+                               const DBool&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DChar&        min,
+                               const DChar&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DDate&        min,
+                               const DDate&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DDateTime&    min,
+                               const DDateTime&    max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DHiresTime&   min,
+                               const DHiresTime&   max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DUInt8&       min,
+                               const DUInt8&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DUInt16&      min,
+                               const DUInt16&      max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DUInt32&      min,
+                               const DUInt32&      max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DUInt64&      min,
+                               const DUInt64&      max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DInt8&        min,
+                               const DInt8&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DInt16&       min,
+                               const DInt16&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DInt32&       min,
+                               const DInt32&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DInt64&       min,
+                               const DInt64&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DReal&        min,
+                               const DReal&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DRichReal&    min,
+                               const DRichReal&    max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+  virtual RowsSet MatchRowsSet(const DText&        min,
+                               const DText&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field) = 0;
+
+  //The rows of a text field whose values contain the specified substring.
+  virtual RowsSet MatchTextRows(const DText&        substring,
+                                const bool          ignoreCase,
+                                const ROW_INDEX     fromRow,
+                                const ROW_INDEX     toRow,
+                                const FIELD_INDEX   field) = 0;
+
+  //The rows of an array field whose arrays hold any (or all, if requested)
+  //of the specified array's elements.
+  virtual RowsSet MatchArrayRows(const DArray&       values,
+                                 const bool          matchAll,
+                                 const ROW_INDEX     fromRow,
+                                 const ROW_INDEX     toRow,
+                                 const FIELD_INDEX   field) = 0;
+
+  //The rows whose keys in the composite index of the specified fields are in
+  //range. The keys may hold only the values of the index's leading fields.
+  virtual RowsSet MatchCompositeRows(const FIELD_INDEX* const   fields,
+                                     const FIELD_INDEX          fieldsCount,
+                                     const CompositeKey&        min,
+                                     const CompositeKey&        max,
+                                     const ROW_INDEX            fromRow,
+                                     const ROW_INDEX            toRow) = 0;
+
+  /* Walk the entries of a field's B-tree index in their values order (or the
+   * reverse one), like an index cursor would, without reading the rows. The
+   * walk starts with the first entry holding the last value of 'fromValue'
+   * or, if 'afterRow' is a valid row, with the entry next to that value and
+   * row, as returned by the previous walk. An empty 'fromValue' starts it
+   * from the first (or last) entry. The values and the rows of at most
+   * 'count' entries are returned and the null values are skipped. Returns
+   * the count of the walked entries. */
+  virtual uint_t FetchIndexEntries(const FIELD_INDEX   field,
+                                   const DArray&       fromValue,
+                                   const ROW_INDEX     afterRow,
+                                   const bool          reverse,
+                                   const uint_t        count,
+                                   DArray&             outValues,
+                                   DArray&             outRows) = 0;
+
+  //Append the rows of a file, with the values of the specified fields (or of
+  //all of them if none is specified). Returns the count of the added rows.
+  virtual ROW_INDEX LoadRows(const char* const          file,
+                             const DBS_LOAD_FORMAT      format,
+                             const FIELD_INDEX* const   fields,
+                             const FIELD_INDEX          fieldsCount) = 0;
+
+  //Write a snapshot of the table's rows (the ones not free for reuse) to a
+  //columnar file, with the specified fields (or all of them if none is
+  //specified). Returns the count of the written rows.
+  virtual ROW_INDEX ExportRows(const char* const          file,
+                               const FIELD_INDEX* const   fields,
+                               const FIELD_INDEX          fieldsCount) = 0;
+
+  //The statistics are gathered from the rows when first requested and
+  //refreshed once a tenth of the table's rows were changed.
+  virtual DBSFieldStats GetFieldStats(const FIELD_INDEX field) = 0;
 
   virtual void Flush() = 0;
   virtual void LockTable() = 0;
@@ -1478,6 +1478,23 @@ public:
   uint64_t Add(const DInt32& value);
   uint64_t Add(const DInt64& value);
 
+  //Append more elements at once. Returns the index of the first one.
+  uint64_t Add(const DBool* const values, const uint64_t count);
+  uint64_t Add(const DChar* const values, const uint64_t count);
+  uint64_t Add(const DDate* const values, const uint64_t count);
+  uint64_t Add(const DDateTime* const values, const uint64_t count);
+  uint64_t Add(const DHiresTime* const values, const uint64_t count);
+  uint64_t Add(const DUInt8* const values, const uint64_t count);
+  uint64_t Add(const DUInt16* const values, const uint64_t count);
+  uint64_t Add(const DUInt32* const values, const uint64_t count);
+  uint64_t Add(const DUInt64* const values, const uint64_t count);
+  uint64_t Add(const DReal* const values, const uint64_t count);
+  uint64_t Add(const DRichReal* const values, const uint64_t count);
+  uint64_t Add(const DInt8* const values, const uint64_t count);
+  uint64_t Add(const DInt16* const values, const uint64_t count);
+  uint64_t Add(const DInt32* const values, const uint64_t count);
+  uint64_t Add(const DInt64* const values, const uint64_t count);
+
   void Get(const uint64_t index, DBool& outValue) const;
   void Get(const uint64_t index, DChar& outValue) const;
   void Get(const uint64_t index, DDate& outValue) const;
@@ -1494,6 +1511,24 @@ public:
   void Get(const uint64_t index, DInt32& outValue) const;
   void Get(const uint64_t index, DInt64& outValue) const;
 
+  //Copy a range of consecutive elements. Returns how many were copied, which
+  //is less than requested when the range goes past the array's end.
+  uint64_t Get(const uint64_t from, const uint64_t count, DBool* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DChar* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DDate* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DDateTime* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DHiresTime* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DUInt8* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DUInt16* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DUInt32* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DUInt64* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DReal* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DRichReal* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DInt8* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DInt16* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DInt32* const outValues) const;
+  uint64_t Get(const uint64_t from, const uint64_t count, DInt64* const outValues) const;
+
   void Set(const uint64_t index, const DBool& value);
   void Set(const uint64_t index, const DChar& value);
   void Set(const uint64_t index, const DDate& value);
@@ -1518,7 +1553,11 @@ public:
 
 private:
   template<class T> uint64_t add_array_element(const T& value);
+  template<class T> uint64_t add_array_elements(const T* const values, const uint64_t count);
   template<class T> void get_array_element(const uint64_t index, T& outElement) const;
+  template<class T> uint64_t get_array_elements(const uint64_t from,
+                                                const uint64_t count,
+                                                T* const outElements) const;
   template<class T> void set_array_element(const T& value, const uint64_t index);
 
 #pragma warning(disable:4251)
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
 #include <assert.h>
+#include <new>
 
 #include "utils/endianness.h"
 #include "utils/wsort.h"
@@ -40,6 +41,8 @@ namespace whais {
 IArrayStrategy::IArrayStrategy(const DBS_FIELD_TYPE elemsType)
   : mElementsCount(0),
     mElementRawSize(0),
+    mStoredCopyEntry(0),
+    mStoredCopyGeneration(0),
     mElementsType(elemsType)
 {
   if (elemsType != T_UNDETERMINED)
@@ -84,6 +87,23 @@ IArrayStrategy::Get(const uint64_t index, uint8_t* const dest)
   return mElementRawSize;
 }
 
+uint64_t
+IArrayStrategy::Get(const uint64_t from, const uint64_t count, uint8_t* const dest)
+{
+  LockGuard<Lock> _l(mLock);
+
+  assert (mSelfShare.lock().get() == this);
+
+  if (from > mElementsCount)
+    throw DBSException(_EXTRA(DBSException::ARRAY_INDEX_TOO_BIG));
+
+  const uint64_t result = MIN(count, mElementsCount - from);
+  if (result > 0)
+    RawRead(from * mElementRawSize, result * mElementRawSize, dest);
+
+  return result;
+}
+
 shared_ptr<IArrayStrategy>
 IArrayStrategy::Set(const DBS_BASIC_TYPE type,
                     const uint8_t* const rawValue,
@@ -170,6 +190,50 @@ IArrayStrategy::Add(const DBS_BASIC_TYPE type,
   return r;
 }
 
+shared_ptr<IArrayStrategy>
+IArrayStrategy::Add(const DBS_BASIC_TYPE type,
+                    const uint8_t* const rawValues,
+                    const uint64_t count,
+                    uint64_t* const outIndex)
+{
+  LockGuard<Lock> _l(mLock);
+
+  shared_ptr<IArrayStrategy> r = mSelfShare.lock();
+  assert (r.get() == this);
+
+  assert((T_UNKNOWN < type) && (type < T_TEXT));
+  assert(count > 0);
+
+  if (type != mElementsType)
+  {
+    if (mElementsType != T_UNDETERMINED)
+      throw DBSException(_EXTRA(DBSException::INVALID_ARRAY_TYPE));
+
+    r = shared_make(pastra::TemporalArray, type);
+    r->SetSelfReference(r);
+  }
+
+  if (r->IsShared())
+  {
+    assert (r.get() == this);
+
+    r = r->Clone();
+
+    assert(r->mElementsCount == mElementsCount);
+    assert(r->mElementRawSize == mElementRawSize);
+    assert(r->mElementsType == mElementsType);
+  }
+
+  r->RawWrite(r->mElementsCount * r->mElementRawSize, count * r->mElementRawSize, rawValues);
+  *outIndex = r->mElementsCount;
+  r->mElementsCount += count;
+
+  assert(r->RawSize() % r->mElementsCount == 0);
+  assert(r->RawSize() / r->mElementsCount == r->mElementRawSize);
+
+  return r;
+}
+
 shared_ptr<IArrayStrategy>
 IArrayStrategy::Remove(const uint64_t index)
 {
@@ -229,6 +293,69 @@ IArrayStrategy::Remove(const uint64_t index)
   return r;
 }
 
+template<typename TE> bool
+IArrayStrategy::SortElementsInMemory(const bool reverse)
+{
+  const uint64_t rawSize = mElementsCount * mElementRawSize;
+  const uint64_t memSize = rawSize + mElementsCount * sizeof(TE);
+
+  const auto sessionBudget = TempMemoryBudget::Current();
+  TempMemoryBudget& budget = sessionBudget
+                             ? *sessionBudget
+                             : TempMemoryBudget::ServerBudget();
+  if ( ! budget.Reserve(memSize))
+    return false;
+
+  unique_ptr<uint8_t[]> rawValues;
+  vector<TE> elements;
+  try
+  {
+    rawValues = unique_array_make(uint8_t, rawSize);
+    elements.resize(mElementsCount);
+  }
+  catch (std::bad_alloc&)
+  {
+    budget.Release(memSize);
+    return false;
+  }
+
+  try
+  {
+    RawRead(0, rawSize, rawValues.get());
+    for (uint64_t i = 0; i < mElementsCount; ++i)
+      pastra::Serializer::Load(rawValues.get() + i * mElementRawSize, &elements[i]);
+
+    MemoryContainer<TE> container(elements);
+    quick_sort<TE, MemoryContainer<TE> >(0, mElementsCount - 1, reverse, container);
+
+    for (uint64_t i = 0; i < mElementsCount; ++i)
+      pastra::Serializer::Store(rawValues.get() + i * mElementRawSize, elements[i]);
+
+    RawWrite(0, rawSize, rawValues.get());
+  }
+  catch (...)
+  {
+    budget.Release(memSize);
+    throw;
+  }
+
+  budget.Release(memSize);
+  return true;
+}
+
+template<typename TE> void
+IArrayStrategy::SortElements(const bool reverse)
+{
+  //Sorting a contiguous copy of the elements avoids a raw read for every
+  //compare. Use it unless there is not enough memory to hold such a copy.
+  if (SortElementsInMemory<TE>(reverse))
+    return;
+
+  ArrayContainer<TE> temp(*this);
+  quick_sort<TE, ArrayContainer<TE> >(0, mElementsCount - 1, reverse, temp);
+}
+
+
 shared_ptr<IArrayStrategy>
 IArrayStrategy::Sort(const bool reverse)
 {
@@ -254,110 +381,65 @@ IArrayStrategy::Sort(const bool reverse)
   switch (mElementsType)
   {
   case T_BOOL:
-  {
-    ArrayContainer<DBool> temp(*r);
-    quick_sort<DBool, ArrayContainer<DBool> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DBool>(reverse);
     break;
 
   case T_CHAR:
-  {
-    ArrayContainer<DChar> temp(*r);
-    quick_sort<DChar, ArrayContainer<DChar> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DChar>(reverse);
     break;
 
   case T_DATE:
-  {
-    ArrayContainer<DDate> temp(*r);
-    quick_sort<DDate, ArrayContainer<DDate> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DDate>(reverse);
     break;
 
   case T_DATETIME:
-  {
-    ArrayContainer<DDateTime> temp(*r);
-    quick_sort<DDateTime, ArrayContainer<DDateTime> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DDateTime>(reverse);
     break;
 
   case T_HIRESTIME:
-  {
-    ArrayContainer<DHiresTime> temp(*r);
-    quick_sort<DHiresTime, ArrayContainer<DHiresTime> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DHiresTime>(reverse);
     break;
 
   case T_UINT8:
-  {
-    ArrayContainer<DUInt8> temp(*r);
-    quick_sort<DUInt8, ArrayContainer<DUInt8> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DUInt8>(reverse);
     break;
 
   case T_UINT16:
-  {
-    ArrayContainer<DUInt16> temp(*r);
-    quick_sort<DUInt16, ArrayContainer<DUInt16> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DUInt16>(reverse);
     break;
 
   case T_UINT32:
-  {
-    ArrayContainer<DUInt32> temp(*r);
-    quick_sort<DUInt32, ArrayContainer<DUInt32> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DUInt32>(reverse);
     break;
 
   case T_UINT64:
-  {
-    ArrayContainer<DUInt64> temp(*r);
-    quick_sort<DUInt64, ArrayContainer<DUInt64> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DUInt64>(reverse);
     break;
 
   case T_REAL:
-  {
-    ArrayContainer<DReal> temp(*r);
-    quick_sort<DReal, ArrayContainer<DReal> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DReal>(reverse);
     break;
 
   case T_RICHREAL:
-  {
-    ArrayContainer<DRichReal> temp(*r);
-    quick_sort<DRichReal, ArrayContainer<DRichReal> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DRichReal>(reverse);
     break;
 
   case T_INT8:
-  {
-    ArrayContainer<DInt8> temp(*r);
-    quick_sort<DInt8, ArrayContainer<DInt8> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DInt8>(reverse);
     break;
 
   case T_INT16:
-  {
-    ArrayContainer<DInt16> temp(*r);
-    quick_sort<DInt16, ArrayContainer<DInt16> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DInt16>(reverse);
     break;
 
   case T_INT32:
-  {
-    ArrayContainer<DInt32> temp(*r);
-    quick_sort<DInt32, ArrayContainer<DInt32> >(0, mElementsCount - 1, reverse,
-        temp);
-  }
+    r->SortElements<DInt32>(reverse);
     break;
 
   case T_INT64:
-  {
-    ArrayContainer<DInt64> temp(*r);
-    quick_sort<DInt64, ArrayContainer<DInt64> >(0, mElementsCount - 1, reverse, temp);
-  }
+    r->SortElements<DInt64>(reverse);
     break;
+
   default:
     throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
   }
@@ -406,6 +488,38 @@ IArrayStrategy::GetRowStorage()
   throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
 }
 
+bool
+IArrayStrategy::ShareStoredCopy(pastra::VariableSizeStore& store, uint64_t* const outEntry)
+{
+  if (mStoredCopy.lock().get() != &store)
+    return false;
+
+  if ( ! store.ShareRecord(mStoredCopyEntry, mStoredCopyGeneration))
+  {
+    ReleaseStoredCopy();
+    return false;
+  }
+
+  *outEntry = mStoredCopyEntry;
+  return true;
+}
+
+void
+IArrayStrategy::BindStoredCopy(pastra::VariableSizeStoreSPtr store, const uint64_t entry)
+{
+  assert(store);
+
+  mStoredCopy = store;
+  mStoredCopyEntry = entry;
+  mStoredCopyGeneration = store->RecordGeneration(entry);
+}
+
+void
+IArrayStrategy::ReleaseStoredCopy()
+{
+  mStoredCopy.reset();
+}
+
 
 namespace pastra {
 
@@ -585,6 +699,7 @@ TemporalArray::RawWrite(const uint64_t       offset,
   assert((mElementsType >= T_BOOL) && (mElementsType < T_TEXT));
   assert(mElementRawSize > 0);
 
+  ReleaseStoredCopy();
   mStorage.Write(offset, size, buffer);
 }
 
@@ -596,6 +711,7 @@ TemporalArray::ColapseRaw(const uint64_t offset, const uint64_t count)
   assert(mElementRawSize > 0);
   assert((count % mElementRawSize) == 0);
 
+  ReleaseStoredCopy();
   mStorage.Colapse(offset, offset + count);
 }
 
@@ -665,6 +781,8 @@ RowFieldArray::RawRead(const uint64_t offset, const uint64_t size, uint8_t* cons
 void
 RowFieldArray::RawWrite(const uint64_t offset, const uint64_t size, const uint8_t* const buffer)
 {
+  ReleaseStoredCopy();
+
   if ( ! mStorage)
   {
     mTempStorage.Write(offset, size, buffer);
@@ -694,6 +812,8 @@ RowFieldArray::RawWrite(const uint64_t offset, const uint64_t size, const uint8_
 void
 RowFieldArray::ColapseRaw(const uint64_t offset, const uint64_t count)
 {
+  ReleaseStoredCopy();
+
   if ( ! mStorage)
   {
     mTempStorage.Colapse(offset, count);
@@ -26,6 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PS_ARRAYSTRATEGY_H_
 
 
+#include <vector>
+
 #include "whais.h"
 #include "ps_container.h"
 #include "ps_varstorage.h"
@@ -41,6 +43,7 @@ class TemporalArray;
 class RowFieldArray;
 class NullArray;
 class PrototypeTable;
+class ArrayRedoContent;
 
 
 } //namespace pastra
@@ -50,6 +53,7 @@ class IArrayStrategy
 {
   friend class std::unique_ptr<IArrayStrategy>;
   friend class pastra::PrototypeTable;
+  friend class pastra::ArrayRedoContent;
 
 public:
   IArrayStrategy(const IArrayStrategy&) = delete;
@@ -61,12 +65,17 @@ public:
   DBS_BASIC_TYPE Type();
 
   uint_t Get(const uint64_t index, uint8_t* const dest);
+  uint64_t Get(const uint64_t from, const uint64_t count, uint8_t* const dest);
   auto Set(const DBS_BASIC_TYPE type,
            const uint8_t* const rawValue,
            const uint64_t index) -> std::shared_ptr<IArrayStrategy>;
   auto Add(const DBS_BASIC_TYPE type,
            const uint8_t* const rawValue,
            uint64_t* const outIndex) -> std::shared_ptr<IArrayStrategy>;
+  auto Add(const DBS_BASIC_TYPE type,
+           const uint8_t* const rawValues,
+           const uint64_t count,
+           uint64_t* const outIndex) -> std::shared_ptr<IArrayStrategy>;
   auto Remove(const uint64_t index) -> std::shared_ptr<IArrayStrategy>;
   auto Sort(const bool reverse) -> std::shared_ptr<IArrayStrategy>;
 
@@ -122,6 +131,39 @@ public:
     TE                mPivot;
   };
 
+  //Same interface as above, but over a copy of the elements kept contiguous
+  //in memory.
+  template<typename TE>
+  class MemoryContainer
+  {
+  public:
+    MemoryContainer(std::vector<TE>& elements)
+      : mElements(elements)
+    {
+    }
+
+    const TE& operator[](const uint64_t index) const
+    {
+      assert(index < mElements.size());
+
+      return mElements[index];
+    }
+
+    void Exchange(const int64_t pos1, const int64_t pos2)
+    {
+      std::swap(mElements[pos1], mElements[pos2]);
+    }
+
+    uint64_t Count() const { return mElements.size(); }
+
+    void Pivot(const int64_t index) { mPivot = mElements[index]; }
+    const TE& Pivot() const { return mPivot; }
+
+  private:
+    std::vector<TE>&  mElements;
+    TE                mPivot;
+  };
+
 protected:
   IArrayStrategy(const DBS_BASIC_TYPE elemsType);
   virtual bool IsShared() const = 0;
@@ -132,9 +174,22 @@ protected:
   virtual void ColapseRaw(const uint64_t offset, const uint64_t count) = 0;
   virtual uint64_t RawSize() const = 0;
 
+  //A copy of this array already kept by a variable size store. Storing the
+  //array again in the same store will just share that record, if it's still
+  //there. The binding is kept in memory only, no reference is held.
+  bool ShareStoredCopy(pastra::VariableSizeStore& store, uint64_t* const outEntry);
+  void BindStoredCopy(pastra::VariableSizeStoreSPtr store, const uint64_t entry);
+  void ReleaseStoredCopy();
+
+  template<typename TE> void SortElements(const bool reverse);
+  template<typename TE> bool SortElementsInMemory(const bool reverse);
+
   uint64_t mElementsCount;
   uint_t mElementRawSize;
   std::weak_ptr<IArrayStrategy> mSelfShare;
+  std::weak_ptr<pastra::VariableSizeStore> mStoredCopy;
+  uint64_t mStoredCopyEntry;
+  uint32_t mStoredCopyGeneration;
   const DBS_BASIC_TYPE mElementsType;
   Lock mLock;
 };
@@ -0,0 +1,437 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+#include "utils/endianness.h"
+#include "utils/wutf.h"
+#include "utils/wunicode.h"
+
+#include "dbs_exception.h"
+#include "ps_bitmapindex.h"
+
+
+using namespace std;
+
+
+namespace whais {
+namespace pastra {
+
+
+//The rows sharing their upper 16 bits are written together, as a list of
+//their lower bits while they are few or as a bitmap otherwise.
+static const uint_t BLOCK_ROWS      = 0x10000;
+static const uint_t BLOCK_LIST_MAX  = BLOCK_ROWS / 16;
+static const uint_t FETCH_ROWS      = 1024;
+
+
+
+static bool
+value_less(const vector<uint8_t>& value, const uint8_t* const other, const uint_t otherSize)
+{
+  const int cmp = memcmp(value.data(), other, MIN(value.size(), otherSize));
+
+  return (cmp < 0) || ((cmp == 0) && (value.size() < otherSize));
+}
+
+
+static void
+write_block(vector<uint8_t>& out, const uint32_t key, const vector<uint16_t>& lows)
+{
+  uint8_t header[sizeof(uint16_t) + sizeof(uint32_t)];
+
+  store_le_int16(key, header);
+  store_le_int32(lows.size(), header + sizeof(uint16_t));
+  out.insert(out.end(), header, header + sizeof header);
+
+  if (lows.size() <= BLOCK_LIST_MAX)
+  {
+    for (auto low : lows)
+    {
+      uint8_t data[sizeof(uint16_t)];
+
+      store_le_int16(low, data);
+      out.insert(out.end(), data, data + sizeof data);
+    }
+    return;
+  }
+
+  vector<uint8_t> bits(BLOCK_ROWS / 8, 0);
+  for (auto low : lows)
+    bits[low / 8] |= 1 << (low % 8);
+
+  out.insert(out.end(), bits.begin(), bits.end());
+}
+
+
+static void
+write_rows(vector<uint8_t>& out, const RowsSet& rows)
+{
+  const size_t countOff = out.size();
+  uint32_t blocksCount = 0;
+
+  out.resize(out.size() + sizeof(uint32_t));
+
+  ROW_INDEX fetched[FETCH_ROWS];
+  vector<uint16_t> lows;
+  uint32_t key = 0;
+
+  uint_t count;
+  ROW_INDEX from = 0;
+  while ((count = rows.Fetch(from, FETCH_ROWS, fetched)) > 0)
+  {
+    for (uint_t i = 0; i < count; ++i)
+    {
+      if ( ! lows.empty() && ((fetched[i] >> 16) != key))
+      {
+        write_block(out, key, lows);
+        ++blocksCount;
+        lows.clear();
+      }
+
+      key = fetched[i] >> 16;
+      lows.push_back(fetched[i] & 0xFFFF);
+    }
+
+    from = fetched[count - 1] + 1;
+    if (from == 0)
+      break;
+  }
+
+  if ( ! lows.empty())
+  {
+    write_block(out, key, lows);
+    ++blocksCount;
+  }
+
+  store_le_int32(blocksCount, out.data() + countOff);
+}
+
+
+static const uint8_t*
+read_rows(const uint8_t* data, const uint8_t* const end, RowsSet& outRows)
+{
+  if (data + sizeof(uint32_t) > end)
+    throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY));
+
+  uint32_t blocksCount = load_le_int32(data);
+  data += sizeof(uint32_t);
+
+  while (blocksCount-- > 0)
+  {
+    if (data + sizeof(uint16_t) + sizeof(uint32_t) > end)
+      throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY));
+
+    const ROW_INDEX base = _SC(ROW_INDEX, load_le_int16(data)) << 16;
+    const uint32_t count = load_le_int32(data + sizeof(uint16_t));
+    data += sizeof(uint16_t) + sizeof(uint32_t);
+
+    const uint_t size = (count <= BLOCK_LIST_MAX) ? count * sizeof(uint16_t) : BLOCK_ROWS / 8;
+    if ((count == 0) || (count > BLOCK_ROWS) || (data + size > end))
+      throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY));
+
+    if (count <= BLOCK_LIST_MAX)
+    {
+      for (uint_t i = 0; i < count; ++i)
+        outRows.Add(base + load_le_int16(data + i * sizeof(uint16_t)));
+    }
+    else
+    {
+      for (uint_t low = 0; low < BLOCK_ROWS; ++low)
+      {
+        if (data[low / 8] & (1 << (low % 8)))
+          outRows.Add(base + low);
+      }
+    }
+    data += size;
+  }
+
+  return data;
+}
+
+
+
+FieldBitmapIndex::FieldBitmapIndex(unique_ptr<IDataContainer>&  container,
+                                   const bool                   create)
+  : mContainer(container.release()),
+    mModified(create)
+{
+  if (create)
+    Flush();
+
+  else
+    Load();
+}
+
+
+FieldBitmapIndex::~FieldBitmapIndex()
+{
+  Flush();
+}
+
+
+void
+FieldBitmapIndex::Add(const uint8_t* const value, const uint_t valueSize, const ROW_INDEX row)
+{
+  size_t pos = FindValue(value, valueSize);
+
+  if ((pos == mValues.size())
+      || (mValues[pos].mValue.size() != valueSize)
+      || (memcmp(mValues[pos].mValue.data(), value, valueSize) != 0))
+  {
+    ValueRows entry;
+    entry.mValue.assign(value, value + valueSize);
+
+    mValues.insert(mValues.begin() + pos, entry);
+  }
+
+  mValues[pos].mRows.Add(row);
+  mModified = true;
+}
+
+
+void
+FieldBitmapIndex::Remove(const uint8_t* const value, const uint_t valueSize, const ROW_INDEX row)
+{
+  const size_t pos = FindValue(value, valueSize);
+
+  if ((pos == mValues.size())
+      || (mValues[pos].mValue.size() != valueSize)
+      || (memcmp(mValues[pos].mValue.data(), value, valueSize) != 0))
+  {
+    return;
+  }
+
+  mValues[pos].mRows.Remove(row);
+  if (mValues[pos].mRows.IsEmpty())
+    mValues.erase(mValues.begin() + pos);
+
+  mModified = true;
+}
+
+
+void
+FieldBitmapIndex::AddTrigrams(const vector<uint64_t>& trigrams, const ROW_INDEX row)
+{
+  for (auto trigram : trigrams)
+  {
+    uint8_t key[sizeof(uint64_t)];
+
+    store_le_int64(trigram, key);
+    Add(key, sizeof key, row);
+  }
+}
+
+
+void
+FieldBitmapIndex::RemoveTrigrams(const vector<uint64_t>& trigrams, const ROW_INDEX row)
+{
+  for (auto trigram : trigrams)
+  {
+    uint8_t key[sizeof(uint64_t)];
+
+    store_le_int64(trigram, key);
+    Remove(key, sizeof key, row);
+  }
+}
+
+
+void
+FieldBitmapIndex::AddElements(const vector<uint8_t>& elements,
+                              const uint_t elementSize,
+                              const ROW_INDEX row)
+{
+  assert((elementSize > 0) && (elements.size() % elementSize == 0));
+
+  for (size_t offset = 0; offset < elements.size(); offset += elementSize)
+    Add(elements.data() + offset, elementSize, row);
+}
+
+
+void
+FieldBitmapIndex::RemoveElements(const vector<uint8_t>& elements,
+                                 const uint_t elementSize,
+                                 const ROW_INDEX row)
+{
+  assert((elementSize > 0) && (elements.size() % elementSize == 0));
+
+  for (size_t offset = 0; offset < elements.size(); offset += elementSize)
+    Remove(elements.data() + offset, elementSize, row);
+}
+
+
+const RowsSet*
+FieldBitmapIndex::Rows(const uint8_t* const value, const uint_t valueSize) const
+{
+  const size_t pos = FindValue(value, valueSize);
+
+  if ((pos == mValues.size())
+      || (mValues[pos].mValue.size() != valueSize)
+      || (memcmp(mValues[pos].mValue.data(), value, valueSize) != 0))
+  {
+    return nullptr;
+  }
+
+  return &mValues[pos].mRows;
+}
+
+
+const RowsSet*
+FieldBitmapIndex::TrigramRows(const uint64_t trigram) const
+{
+  uint8_t key[sizeof(uint64_t)];
+
+  store_le_int64(trigram, key);
+
+  return Rows(key, sizeof key);
+}
+
+
+void
+FieldBitmapIndex::Flush()
+{
+  if (mModified)
+  {
+    vector<uint8_t> content(sizeof(uint32_t));
+
+    store_le_int32(mValues.size(), content.data());
+    for (const auto& entry : mValues)
+    {
+      content.push_back(entry.mValue.size());
+      content.insert(content.end(), entry.mValue.begin(), entry.mValue.end());
+
+      write_rows(content, entry.mRows);
+    }
+
+    mContainer->Write(0, content.size(), content.data());
+    if (mContainer->Size() > content.size())
+      mContainer->Colapse(content.size(), mContainer->Size());
+
+    mModified = false;
+  }
+
+  mContainer->Flush();
+}
+
+
+void
+FieldBitmapIndex::MarkForRemoval()
+{
+  mContainer->MarkForRemoval();
+
+  //Its content is not needed anymore.
+  mModified = false;
+}
+
+
+uint64_t
+FieldBitmapIndex::IndexRawSize() const
+{
+  return mContainer->Size();
+}
+
+
+size_t
+FieldBitmapIndex::FindValue(const uint8_t* const value, const uint_t valueSize) const
+{
+  size_t from = 0, to = mValues.size();
+
+  while (from < to)
+  {
+    const size_t mid = (from + to) / 2;
+
+    if (value_less(mValues[mid].mValue, value, valueSize))
+      from = mid + 1;
+
+    else
+      to = mid;
+  }
+
+  return from;
+}
+
+
+void
+FieldBitmapIndex::Load()
+{
+  vector<uint8_t> content(mContainer->Size());
+
+  mContainer->Read(0, content.size(), content.data());
+
+  const uint8_t* data = content.data();
+  const uint8_t* const end = data + content.size();
+
+  if (data + sizeof(uint32_t) > end)
+    throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY));
+
+  uint32_t valuesCount = load_le_int32(data);
+  data += sizeof(uint32_t);
+
+  while (valuesCount-- > 0)
+  {
+    if ((data >= end) || (data + 1 + data[0] > end))
+      throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY));
+
+    ValueRows entry;
+    entry.mValue.assign(data + 1, data + 1 + data[0]);
+    data += 1 + data[0];
+
+    data = read_rows(data, end, entry.mRows);
+    mValues.push_back(entry);
+  }
+}
+
+
+void
+text_trigrams(const uint8_t* const utf8, const uint64_t utf8Size, vector<uint64_t>& outTrigrams)
+{
+  outTrigrams.clear();
+
+  uint64_t window = 0;
+  uint_t charsCount = 0;
+
+  for (uint64_t offset = 0; offset < utf8Size; )
+  {
+    uint32_t codePoint;
+    const uint_t unitsCount = wh_load_utf8_cp(utf8 + offset, &codePoint);
+
+    if ((unitsCount == 0) || (offset + unitsCount > utf8Size))
+      break;
+
+    offset += unitsCount;
+
+    window = ((window << 21) | (wh_to_lowercase(codePoint) & 0x1FFFFF)) & 0x7FFFFFFFFFFFFFFFull;
+    if (++charsCount >= 3)
+      outTrigrams.push_back(window);
+  }
+
+  sort(outTrigrams.begin(), outTrigrams.end());
+  outTrigrams.erase(unique(outTrigrams.begin(), outTrigrams.end()), outTrigrams.end());
+}
+
+
+} //namespace pastra
+} //namespace whais
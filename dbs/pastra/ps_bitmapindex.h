@@ -0,0 +1,112 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef PS_BITMAPINDEX_H_
+#define PS_BITMAPINDEX_H_
+
+#include <memory>
+#include <vector>
+
+#include "dbs/dbs_rowsset.h"
+#include "ps_container.h"
+
+
+namespace whais {
+namespace pastra {
+
+
+/* A field index keeping, for every distinct value of a field, the set of
+ * the rows holding it. It suits the fields with few distinct values, whose
+ * rows sets are small enough to be kept in memory and are united or
+ * intersected without reading any row. The values are kept as they are
+ * stored in the rows; the null one is kept as an empty value. The index
+ * content is written in its container when it is flushed.
+ *
+ * A text field's trigram index is kept the same way, with the trigrams of
+ * the rows' values in place of the values themselves, and so is an array
+ * field's elements index, with the arrays' elements. */
+class FieldBitmapIndex
+{
+public:
+  struct ValueRows
+  {
+    std::vector<uint8_t>    mValue;
+    RowsSet                 mRows;
+  };
+
+  FieldBitmapIndex(std::unique_ptr<IDataContainer>&  container,
+                   const bool                        create);
+  ~FieldBitmapIndex();
+
+  FieldBitmapIndex(const FieldBitmapIndex&) = delete;
+  FieldBitmapIndex& operator= (const FieldBitmapIndex&) = delete;
+
+  void Add(const uint8_t* const value, const uint_t valueSize, const ROW_INDEX row);
+  void Remove(const uint8_t* const value, const uint_t valueSize, const ROW_INDEX row);
+
+  void AddTrigrams(const std::vector<uint64_t>& trigrams, const ROW_INDEX row);
+  void RemoveTrigrams(const std::vector<uint64_t>& trigrams, const ROW_INDEX row);
+
+  //The elements are as they are stored in the arrays, one after another.
+  void AddElements(const std::vector<uint8_t>& elements,
+                   const uint_t elementSize,
+                   const ROW_INDEX row);
+  void RemoveElements(const std::vector<uint8_t>& elements,
+                      const uint_t elementSize,
+                      const ROW_INDEX row);
+
+  //The rows holding a value, if any does.
+  const RowsSet* Rows(const uint8_t* const value, const uint_t valueSize) const;
+  const RowsSet* TrigramRows(const uint64_t trigram) const;
+
+  //Sorted by the values raw content.
+  const std::vector<ValueRows>& Values() const { return mValues; }
+
+  void Flush();
+  void MarkForRemoval();
+  uint64_t IndexRawSize() const;
+
+private:
+  size_t FindValue(const uint8_t* const value, const uint_t valueSize) const;
+  void Load();
+
+  std::unique_ptr<IDataContainer>   mContainer;
+  std::vector<ValueRows>            mValues;
+  bool                              mModified;
+};
+
+
+/* Get the distinct trigrams of an UTF-8 text, sorted. A trigram packs the
+ * lower case code points of three consecutive characters, 21 bits each, so
+ * the trigrams are the same whatever the characters' case. */
+void
+text_trigrams(const uint8_t* const     utf8,
+              const uint64_t           utf8Size,
+              std::vector<uint64_t>&   outTrigrams);
+
+
+} //namespace pastra
+} //namespace whais
+
+#endif /* PS_BITMAPINDEX_H_ */
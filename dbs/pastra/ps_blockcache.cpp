@@ -36,7 +36,8 @@ BlockCache::BlockCache()
     mItemSize(0),
     mBlockSize(0),
     mMaxCachedBlocks(0),
-    mCachedBlocks()
+    mCachedBlocks(),
+    mDirtyBlocks()
 {
 }
 
@@ -98,8 +99,35 @@ BlockCache::Flush()
   if (mSkipFlush)
     return;
 
-  for (auto& block : mCachedBlocks)
-    FlushItem(block.first);
+  FlushSome(mDirtyBlocks.size());
+}
+
+bool
+BlockCache::FlushSome(const uint_t maxBlocks)
+{
+  assert(mItemSize != 0);
+
+  if (mSkipFlush)
+    return false;
+
+  const uint_t itemsPerBlock = mBlockSize / mItemSize;
+
+  for (uint_t count = 0; (count < maxBlocks) && ! mDirtyBlocks.empty(); ++count)
+  {
+    const uint64_t baseBlockItem = *mDirtyBlocks.begin();
+
+    auto it = mCachedBlocks.find(baseBlockItem);
+
+    assert(it != mCachedBlocks.end());
+    assert(it->second.IsDirty());
+
+    mManager->StoreItems(baseBlockItem, itemsPerBlock, it->second.Data());
+    it->second.MarkClean();
+
+    mDirtyBlocks.erase(mDirtyBlocks.begin());
+  }
+
+  return ! mDirtyBlocks.empty();
 }
 
 StoredItem
@@ -121,12 +149,18 @@ BlockCache::RetriveItem(const uint64_t item)
     while (it != mCachedBlocks.end())
     {
       if (it->second.IsInUse())
+      {
+        ++it;
         continue;
+      }
 
       uint8_t* const data_ = it->second.Data();
 
       if (it->second.IsDirty())
+      {
         mManager->StoreItems(it->first, itemsPerBlock, data_);
+        mDirtyBlocks.erase(it->first);
+      }
 
       delete[] data_;
 
@@ -140,7 +174,8 @@ BlockCache::RetriveItem(const uint64_t item)
   unique_ptr<uint8_t> block(new uint8_t[mBlockSize]);
   uint8_t* const data_ = block.get();
 
-  mCachedBlocks.insert(pair<uint64_t, BlockEntry>(baseBlockItem, BlockEntry(data_)));
+  mCachedBlocks.insert(pair<uint64_t, BlockEntry>(baseBlockItem,
+                                                  BlockEntry(data_, baseBlockItem, mDirtyBlocks)));
   block.release();
 
   mManager->RetrieveItems(baseBlockItem, itemsPerBlock, data_);
@@ -162,6 +197,8 @@ BlockCache::FlushItem(const uint64_t item)
   {
     mManager->StoreItems(baseBlockItem, itemsPerBlock, it->second.Data());
     it->second.MarkClean();
+
+    mDirtyBlocks.erase(baseBlockItem);
   }
 }
 
@@ -182,5 +219,28 @@ BlockCache::RefreshItem(const uint64_t item)
 }
 
 
+void
+BlockCache::Reset(const uint_t itemSize, const uint_t blockSize)
+{
+  assert(mItemSize != 0);
+
+  Flush();
+
+  for (auto& block : mCachedBlocks)
+  {
+    assert(block.second.IsInUse() == false);
+
+    delete [] block.second.Data();
+  }
+  mCachedBlocks.clear();
+  mDirtyBlocks.clear();
+
+  const uint_t maxCachedBlocks = mMaxCachedBlocks;
+
+  mItemSize = mBlockSize = mMaxCachedBlocks = 0;
+  Init( *mManager, itemSize, blockSize, maxCachedBlocks, mSkipFlush);
+}
+
+
 } //namespace pastra
 } //namespace whais
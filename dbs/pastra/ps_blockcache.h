@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PS_BLOCKCACHE_H_
 
 #include <map>
+#include <set>
 #include <assert.h>
 #include <string.h>
 
@@ -50,8 +51,12 @@ public:
 class BlockEntry
 {
 public:
-  explicit BlockEntry(uint8_t* const data)
+  BlockEntry(uint8_t* const              data,
+             const uint64_t              baseItem,
+             std::set<uint64_t>&         dirtyBlocks)
     : mData(data),
+      mBaseItem(baseItem),
+      mDirtyBlocks(dirtyBlocks),
       mReferenceCount(0),
       mFlags(0)
   {
@@ -60,8 +65,16 @@ public:
 
   bool IsDirty() const { return (mFlags & BLOCK_ENTRY_DIRTY) != 0; }
   bool IsInUse() const { return mReferenceCount > 0; }
-  void MarkDirty() { mFlags |= BLOCK_ENTRY_DIRTY; }
   void MarkClean() { mFlags &= ~BLOCK_ENTRY_DIRTY; }
+  void MarkDirty()
+  {
+    if (IsDirty())
+      return;
+
+    //Let the cache know which blocks to write, without searching for them.
+    mDirtyBlocks.insert(mBaseItem);
+    mFlags |= BLOCK_ENTRY_DIRTY;
+  }
   uint8_t* Data() { return mData; }
 
   void RegisterUser() { wh_atomic_fetch_inc32(_RC(int32_t*, &mReferenceCount)); }
@@ -72,8 +85,10 @@ public:
   }
 
 private:
-  uint8_t* const   mData;
-  uint32_t         mReferenceCount;
+  uint8_t* const        mData;
+  const uint64_t        mBaseItem;
+  std::set<uint64_t>&   mDirtyBlocks;
+  uint32_t              mReferenceCount;
   uint32_t         mFlags;
 
   static const uint32_t BLOCK_ENTRY_DIRTY = 0x00000001;
@@ -139,8 +154,16 @@ public:
             const uint_t      blockSize,
             const uint_t      maxCachedBlocks,
             const bool        nonPersitentData);
+  //Drops the cached blocks (the modified ones are written first) to hold
+  //from now on items of a different size.
+  void Reset(const uint_t itemSize, const uint_t blockSize);
 
   void Flush();
+  //Write at most 'maxBlocks' of the modified blocks. Returns true if there
+  //are modified blocks left to be written.
+  bool FlushSome(const uint_t maxBlocks);
+  uint_t DirtyBlocksCount() const { return mDirtyBlocks.size(); }
+  uint_t BlockItemsCount() const { return mBlockSize / mItemSize; }
   void FlushItem(const uint64_t item);
   void RefreshItem(const uint64_t item);
   StoredItem RetriveItem(const uint64_t item);
@@ -153,6 +176,7 @@ private:
   bool             mSkipFlush;
 
   std::map<uint64_t, BlockEntry> mCachedBlocks;
+  std::set<uint64_t>             mDirtyBlocks;
 };
 
 
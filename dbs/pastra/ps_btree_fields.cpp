@@ -31,6 +31,43 @@ namespace whais {
 namespace pastra {
 
 
+TextIndexPrefix::TextIndexPrefix()
+{
+  memset(mData, 0, sizeof mData);
+}
+
+
+TextIndexPrefix::TextIndexPrefix(const DText& text)
+{
+  memset(mData, 0, sizeof mData);
+
+  const uint64_t unitsCount = text.RawSize();
+
+  text.RawRead(0, MIN(unitsCount, _SC(uint64_t, MAX_UNITS)), mData);
+  mData[MAX_UNITS] = MIN(unitsCount, _SC(uint64_t, MAX_UNITS + 1));
+}
+
+
+TextIndexPrefix::TextIndexPrefix(const uint8_t* const utf8, const uint64_t unitsCount)
+{
+  memset(mData, 0, sizeof mData);
+
+  memcpy(mData, utf8, MIN(unitsCount, _SC(uint64_t, MAX_UNITS)));
+  mData[MAX_UNITS] = MIN(unitsCount, _SC(uint64_t, MAX_UNITS + 1));
+}
+
+
+TextIndexPrefix
+TextIndexPrefix::Max()
+{
+  TextIndexPrefix result;
+
+  memset(result.mData, 0xFF, sizeof result.mData);
+
+  return result;
+}
+
+
 FieldIndexNodeManager::FieldIndexNodeManager(unique_ptr<IDataContainer>&   container,
                                              const uint_t                  nodeSize,
                                              const uint_t                  maxCacheMem,
@@ -297,6 +334,14 @@ FieldIndexNodeManager::NodeFactory(const NODE_INDEX nodeId)
     result = new RichRealBTreeNode(*this, nodeId);
     break;
 
+  case T_TEXT:
+    result = new TextBTreeNode(*this, nodeId);
+    break;
+
+  case PS_COMPOSITE_KEY_TYPE:
+    result = new CompositeBTreeNode(*this, nodeId);
+    break;
+
   default:
     assert(false);
     }
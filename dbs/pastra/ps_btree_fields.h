@@ -26,7 +26,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PS_BTREE_FIELDS_H_
 
 #include <assert.h>
+#include <string.h>
 #include <limits>
+#include <vector>
 
 #include "whais.h"
 #include "ps_btree_index.h"
@@ -38,6 +40,45 @@ namespace whais {
 namespace pastra {
 
 
+/* The key value of a text field index: the first UTF-8 code units of the
+ * text and how many of them it has. UTF-8 keeps the order of the characters'
+ * codes, so the prefixes of two texts are never ordered against the texts
+ * themselves. Texts longer than the prefix are marked as truncated; these
+ * are the only ones whose rows need to be checked when they are matched. */
+class TextIndexPrefix
+{
+public:
+  static const uint_t SIZE      = 24;
+  static const uint_t MAX_UNITS = SIZE - 1;
+
+  TextIndexPrefix();
+  explicit TextIndexPrefix(const DText& text);
+  TextIndexPrefix(const uint8_t* const utf8, const uint64_t unitsCount);
+
+  bool IsNull() const { return mData[MAX_UNITS] == 0; }
+  bool IsTruncated() const { return mData[MAX_UNITS] > MAX_UNITS; }
+
+  DBS_FIELD_TYPE DBSType() const { return T_TEXT; }
+
+  bool operator< (const TextIndexPrefix& second) const
+  {
+    return memcmp(mData, second.mData, SIZE) < 0;
+  }
+
+  bool operator== (const TextIndexPrefix& second) const
+  {
+    return memcmp(mData, second.mData, SIZE) == 0;
+  }
+
+  static TextIndexPrefix Max();
+
+private:
+  friend class Serializer;
+
+  uint8_t mData[SIZE];
+};
+
+
 template <class DBS_T>
 class T_BTreeKey : public IBTreeKey
 {
@@ -85,6 +126,11 @@ typedef T_BTreeKey<DDateTime>    DateTimeBTreeKey;
 typedef T_BTreeKey<DHiresTime>   HiresTimeBTreeKey;
 typedef T_BTreeKey<DReal>        RealBTreeKey;
 typedef T_BTreeKey<DRichReal>    RichRealBTreeKey;
+typedef T_BTreeKey<TextIndexPrefix>  TextBTreeKey;
+typedef T_BTreeKey<CompositeKey>     CompositeBTreeKey;
+
+//The nodes type of the composite indexes, whose keys hold several fields' values.
+static const DBS_FIELD_TYPE PS_COMPOSITE_KEY_TYPE = T_UNDETERMINED;
 
 
 class IBTreeFieldIndexNode : public IBTreeNode
@@ -100,6 +146,15 @@ public:
                        KEY_INDEX toPos,
                        const ROW_INDEX fromRow,
                        const ROW_INDEX toRow, DArray& output) const = 0;
+  virtual void GetRows(KEY_INDEX fromPos,
+                       KEY_INDEX toPos,
+                       const ROW_INDEX fromRow,
+                       const ROW_INDEX toRow, RowsSet& output) const = 0;
+  //Keeps the rows in their keys order.
+  virtual void GetRows(KEY_INDEX fromPos,
+                       KEY_INDEX toPos,
+                       const ROW_INDEX fromRow,
+                       const ROW_INDEX toRow, std::vector<ROW_INDEX>& output) const = 0;
 };
 
 
@@ -107,6 +162,8 @@ template <class DBS_T, class T, uint_t T_SIZE>
 class DBS_BTreeNode : public IBTreeFieldIndexNode
 {
 public:
+  typedef DBS_T VALUE_TYPE;
+
   DBS_BTreeNode(IBTreeNodeManager& nodesManager, const NODE_INDEX node)
     : IBTreeFieldIndexNode(nodesManager, node)
   {
@@ -432,7 +489,61 @@ public:
     }
   }
 
-private:
+  virtual void GetRows(KEY_INDEX fromPos,
+                       KEY_INDEX toPos,
+                       const ROW_INDEX fromRow,
+                       const ROW_INDEX toRow,
+                       RowsSet& output) const
+  {
+    assert(fromPos >= toPos);
+    assert(fromPos < KeysCount());
+
+    const ROW_INDEX* const rows = _RC(const ROW_INDEX*, DataForRead());
+
+    if ((toPos == 0) && (CompareKey(SentinelKey(), toPos) == 0))
+      ++toPos;
+
+    while (fromPos >= toPos)
+    {
+      const auto row = Serializer::LoadRow(rows + fromPos);
+      if (fromRow <= row && row <= toRow)
+        output.Add(row);
+
+      if (fromPos == 0)
+        break;
+
+      fromPos--;
+    }
+  }
+
+  virtual void GetRows(KEY_INDEX fromPos,
+                       KEY_INDEX toPos,
+                       const ROW_INDEX fromRow,
+                       const ROW_INDEX toRow,
+                       std::vector<ROW_INDEX>& output) const
+  {
+    assert(fromPos >= toPos);
+    assert(fromPos < KeysCount());
+
+    const ROW_INDEX* const rows = _RC(const ROW_INDEX*, DataForRead());
+
+    if ((toPos == 0) && (CompareKey(SentinelKey(), toPos) == 0))
+      ++toPos;
+
+    while (fromPos >= toPos)
+    {
+      const auto row = Serializer::LoadRow(rows + fromPos);
+      if (fromRow <= row && row <= toRow)
+        output.push_back(row);
+
+      if (fromPos == 0)
+        break;
+
+      fromPos--;
+    }
+  }
+
+  //The value and the row of a node's key.
   const T_BTreeKey<DBS_T> GetKey(const KEY_INDEX keyIndex) const
   {
     assert(keyIndex < KeysCount());
@@ -460,6 +571,7 @@ private:
     return T_BTreeKey<DBS_T>(value, Serializer::LoadRow(rows + keyIndex));
   }
 
+private:
   void SetKey(const T_BTreeKey<DBS_T> &key, const KEY_INDEX keyIndex)
   {
     assert(keyIndex < KeysCount());
@@ -504,6 +616,8 @@ typedef DBS_BTreeNode<DInt32, int32_t, 4>         Int32BTreeNode;
 typedef DBS_BTreeNode<DInt64, int64_t, 8>         Int64BTreeNode;
 typedef DBS_BTreeNode<DReal, REAL_T, 8>           RealBTreeNode;
 typedef DBS_BTreeNode<DRichReal, RICHREAL_T, 14>  RichRealBTreeNode;
+typedef DBS_BTreeNode<TextIndexPrefix, void, TextIndexPrefix::SIZE> TextBTreeNode;
+typedef DBS_BTreeNode<CompositeKey, void, CompositeKey::SIZE> CompositeBTreeNode;
 
 
 class FieldIndexNodeManager : public IBTreeNodeManager
@@ -0,0 +1,136 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+#include <string.h>
+
+#include "dbs/dbs_compositekey.h"
+#include "dbs/dbs_exception.h"
+
+#include "ps_sortkeys.h"
+
+
+using namespace std;
+using namespace whais::pastra;
+
+
+namespace whais {
+
+
+CompositeKey::CompositeKey()
+  : mSize(0)
+{
+  memset(mKey, 0, sizeof mKey);
+}
+
+
+CompositeKey::CompositeKey(const uint8_t* const rawKey)
+  : mSize(SIZE)
+{
+  memcpy(mKey, rawKey, sizeof mKey);
+}
+
+
+template<class T> void
+CompositeKey::AddValue(const T& value)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+  const uint_t keySize = sort_key_value(value, key);
+
+  if (mSize + keySize > SIZE)
+  {
+    throw DBSException(_EXTRA(DBSException::OPER_NOT_SUPPORTED),
+                       "The values do not fit in a composite index key.");
+  }
+
+  memcpy(mKey + mSize, key, keySize);
+  mSize += keySize;
+}
+
+
+void CompositeKey::Add(const DBool& value) { AddValue(value); }
+void CompositeKey::Add(const DChar& value) { AddValue(value); }
+void CompositeKey::Add(const DDate& value) { AddValue(value); }
+void CompositeKey::Add(const DDateTime& value) { AddValue(value); }
+void CompositeKey::Add(const DHiresTime& value) { AddValue(value); }
+void CompositeKey::Add(const DInt8& value) { AddValue(value); }
+void CompositeKey::Add(const DInt16& value) { AddValue(value); }
+void CompositeKey::Add(const DInt32& value) { AddValue(value); }
+void CompositeKey::Add(const DInt64& value) { AddValue(value); }
+void CompositeKey::Add(const DUInt8& value) { AddValue(value); }
+void CompositeKey::Add(const DUInt16& value) { AddValue(value); }
+void CompositeKey::Add(const DUInt32& value) { AddValue(value); }
+void CompositeKey::Add(const DUInt64& value) { AddValue(value); }
+void CompositeKey::Add(const DReal& value) { AddValue(value); }
+void CompositeKey::Add(const DRichReal& value) { AddValue(value); }
+
+
+void
+CompositeKey::MarkUpperBound()
+{
+  //No value's key starts with this byte, not even the null one's.
+  memset(mKey + mSize, 0xFF, SIZE - mSize);
+  mSize = SIZE;
+}
+
+
+bool
+CompositeKey::IsNull() const
+{
+  for (uint_t i = 0; i < SIZE; ++i)
+  {
+    if (mKey[i] != 0)
+      return false;
+  }
+
+  return true;
+}
+
+
+bool
+CompositeKey::operator< (const CompositeKey& second) const
+{
+  return memcmp(mKey, second.mKey, SIZE) < 0;
+}
+
+
+bool
+CompositeKey::operator== (const CompositeKey& second) const
+{
+  return memcmp(mKey, second.mKey, SIZE) == 0;
+}
+
+
+CompositeKey
+CompositeKey::Max()
+{
+  CompositeKey result;
+
+  result.MarkUpperBound();
+
+  return result;
+}
+
+
+} //namespace whais
@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <assert.h>
 #include <string.h>
 #include <memory>
+#include <new>
 
 #include "dbs/dbs_mgr.h"
 #include "ps_container.h"
@@ -38,14 +39,6 @@ namespace whais {
 namespace pastra {
 
 
-static inline void
-safe_memcpy(uint8_t* to, uint8_t* from, uint64_t count)
-{
-  while (count-- > 0)
-    *to++ = *from++;
-}
-
-
 void
 append_int_to_str(uint64_t number, string& inoutStr)
 {
@@ -149,6 +142,10 @@ FileContainer::FileContainer(const char*       baseName,
   : mMaxFileUnitSize(maxFileSize),
     mFilesHandles(),
     mFileNamePrefix(baseName),
+    mJournal(nullptr),
+    mStaged(),
+    mSync(),
+    mStaging(false),
     mToRemove(false),
     mIgnoreExistingData(truncate)
 {
@@ -198,12 +195,45 @@ FileContainer::FileContainer(const char*       baseName,
 
 FileContainer::~FileContainer()
 {
+  //Its removal was accounted for when it was marked.
+  if (mJournal != nullptr)
+  {
+    mJournal->Detach( *this);
+    mJournal = nullptr;
+  }
+
   if (mToRemove)
     Colapse(0, Size() );
 }
 
 void
 FileContainer::Write(uint64_t to, uint64_t size, const uint8_t* buffer)
+{
+  if (mJournal != nullptr)
+    mJournal->BeforeWrite( *this, to, size);
+
+  LockGuard<Lock> _l(mSync);
+
+  if ( ! mStaging)
+  {
+    WriteStagedContent();
+    WriteContent(to, size, buffer);
+    return;
+  }
+
+  if (to > ContentSize())
+  {
+    throw WFileContainerException(_EXTRA(WFileContainerException::INVALID_ACCESS_POSITION),
+                                  "Could not stage a write at file container offset %lu(of %lu).",
+                                  _SC(long, to),
+                                  _SC(long, ContentSize()));
+  }
+
+  mStaged.push_back(StagedWrite{to, vector<uint8_t>(buffer, buffer + size), false});
+}
+
+void
+FileContainer::WriteContent(uint64_t to, uint64_t size, const uint8_t* buffer)
 {
   const uint_t unitsCount = mFilesHandles.size();
   uint64_t unitIndex = to / mMaxFileUnitSize;
@@ -257,12 +287,60 @@ FileContainer::Write(uint64_t to, uint64_t size, const uint8_t* buffer)
 
   //Write the rest
   if (actualSize < size)
-    Write(to + actualSize, size - actualSize, buffer + actualSize);
+    WriteContent(to + actualSize, size - actualSize, buffer + actualSize);
 }
 
 
 void
 FileContainer::Read(uint64_t from, uint64_t size, uint8_t* buffer)
+{
+  LockGuard<Lock> _l(mSync);
+
+  ReadStaged(from, size, buffer);
+}
+
+
+void
+FileContainer::ReadStaged(uint64_t from, uint64_t size, uint8_t* buffer)
+{
+  if (mStaged.empty())
+  {
+    ReadContent(from, size, buffer);
+    return;
+  }
+
+  if (from + size > ContentSize())
+  {
+    throw WFileContainerException(_EXTRA(WFileContainerException::INVALID_ACCESS_POSITION),
+                                  "Failed to read %lu bytes from %lu( of %lu).",
+                                    _SC(long, size),
+                                    _SC(long, from),
+                                    _SC(long, ContentSize()));
+  }
+
+  const uint64_t filesSize = FilesSize();
+  if (from < filesSize)
+    ReadContent(from, MIN(size, filesSize - from), buffer);
+
+  //What is staged covers anything past the end of the files, even after the
+  //content was cut.
+  for (auto& staged : mStaged)
+  {
+    if (staged.mTruncation)
+      continue;
+
+    const uint64_t stagedEnd = staged.mOffset + staged.mContent.size();
+    const uint64_t start = MAX(from, staged.mOffset);
+    const uint64_t end = MIN(from + size, stagedEnd);
+
+    if (start < end)
+      memcpy(buffer + (start - from), &staged.mContent[start - staged.mOffset], end - start);
+  }
+}
+
+
+void
+FileContainer::ReadContent(uint64_t from, uint64_t size, uint8_t* buffer)
 {
   if (size == 0)
     return ;
@@ -271,14 +349,14 @@ FileContainer::Read(uint64_t from, uint64_t size, uint8_t* buffer)
   uint64_t unitIndex = from / mMaxFileUnitSize;
   uint64_t unitPosition = from % mMaxFileUnitSize;
 
-  if ((unitIndex > unitsCount) || (from + size > Size()))
+  if ((unitIndex > unitsCount) || (from + size > FilesSize()))
   {
     throw WFileContainerException(_EXTRA(WFileContainerException::INVALID_ACCESS_POSITION),
                                   "Failed to read %lu bytes from %lu( of %lu), "
                                     "unit %d( of %d).",
                                     _SC(long, size),
                                     _SC(long, from),
-                                    _SC(long, Size()),
+                                    _SC(long, FilesSize()),
                                     unitIndex,
                                     unitsCount);
   }
@@ -295,7 +373,7 @@ FileContainer::Read(uint64_t from, uint64_t size, uint8_t* buffer)
 
   //Read the rest
   if (actualSize < size)
-    Read(from + actualSize, size - actualSize, buffer + actualSize);
+    ReadContent(from + actualSize, size - actualSize, buffer + actualSize);
 
 }
 
@@ -303,8 +381,13 @@ FileContainer::Read(uint64_t from, uint64_t size, uint8_t* buffer)
 void
 FileContainer::Colapse(uint64_t from, uint64_t to)
 {
+  if ((mJournal != nullptr) && (from < to))
+    mJournal->BeforeWrite( *this, from, Size() - from);
+
+  LockGuard<Lock> _l(mSync);
+
   const uint64_t intervalSize = to - from;
-  const uint64_t containerSize = Size();
+  const uint64_t containerSize = ContentSize();
 
   if ((to < from) || (containerSize < to))
   {
@@ -317,6 +400,22 @@ FileContainer::Colapse(uint64_t from, uint64_t to)
   else if (intervalSize == 0)
     return;
 
+  if (mStaging)
+  {
+    if (to < containerSize)
+    {
+      StagedWrite moved{from, vector<uint8_t>(containerSize - to), false};
+
+      ReadStaged(to, moved.mContent.size(), moved.mContent.data());
+      mStaged.push_back(move(moved));
+    }
+
+    mStaged.push_back(StagedWrite{containerSize - intervalSize, vector<uint8_t>(), true});
+    return;
+  }
+
+  WriteStagedContent();
+
   while (to < containerSize)
   {
     uint8_t buffer[1024];
@@ -325,14 +424,19 @@ FileContainer::Colapse(uint64_t from, uint64_t to)
     if (stepSize + to > containerSize)
       stepSize = containerSize - to;
 
-    Read(to, stepSize, buffer);
-    Write(from, stepSize, buffer);
+    ReadContent(to, stepSize, buffer);
+    WriteContent(from, stepSize, buffer);
 
     to += stepSize, from += stepSize;
   }
 
-  //Delete the remaining content.
-  const uint64_t newSize = containerSize - intervalSize;
+  TruncateContent(containerSize - intervalSize);
+}
+
+
+void
+FileContainer::TruncateContent(const uint64_t newSize)
+{
   int lastUnit = newSize / mMaxFileUnitSize;
   const int lastUnitSize = newSize % mMaxFileUnitSize;
 
@@ -359,6 +463,15 @@ FileContainer::Colapse(uint64_t from, uint64_t to)
 
 uint64_t
 FileContainer::Size() const
+{
+  LockGuard<Lock> _l(mSync);
+
+  return ContentSize();
+}
+
+
+uint64_t
+FileContainer::FilesSize() const
 {
   if (mFilesHandles.size() == 0)
     return 0;
@@ -369,9 +482,32 @@ FileContainer::Size() const
 }
 
 
+uint64_t
+FileContainer::ContentSize() const
+{
+  uint64_t result = FilesSize();
+
+  for (auto& staged : mStaged)
+  {
+    if (staged.mTruncation)
+      result = staged.mOffset;
+
+    else
+      result = MAX(result, staged.mOffset + staged.mContent.size());
+  }
+
+  return result;
+}
+
+
 void
 FileContainer::MarkForRemoval()
 {
+  if ((mJournal != nullptr) && ! mToRemove)
+    mJournal->BeforeRemoval( *this);
+
+  LockGuard<Lock> _l(mSync);
+
   mToRemove = true;
 }
 
@@ -379,11 +515,58 @@ FileContainer::MarkForRemoval()
 void
 FileContainer::Flush()
 {
+  LockGuard<Lock> _l(mSync);
+
+  //What is staged is not in the files yet, whoever writes it syncs them.
+  if (mStaging)
+    return;
+
   for (auto& f : mFilesHandles)
     f.Sync();
 }
 
 
+void
+FileContainer::StageWrites(const bool stage)
+{
+  LockGuard<Lock> _l(mSync);
+
+  mStaging = stage;
+}
+
+
+void
+FileContainer::WriteStaged()
+{
+  LockGuard<Lock> _l(mSync);
+
+  WriteStagedContent();
+}
+
+
+void
+FileContainer::WriteStagedContent()
+{
+  //The content is about to go away anyway.
+  if (mToRemove)
+  {
+    mStaged.clear();
+    return;
+  }
+
+  for (auto& staged : mStaged)
+  {
+    if (staged.mTruncation)
+      TruncateContent(staged.mOffset);
+
+    else
+      WriteContent(staged.mOffset, staged.mContent.size(), staged.mContent.data());
+  }
+
+  mStaged.clear();
+}
+
+
 void
 FileContainer::Fix(const char* const   baseFile,
                    const uint64_t      maxFileSize,
@@ -443,17 +626,143 @@ TemporalFileContainer::TemporalFileContainer(const char* baseName, const uint32_
 
 
 
+static thread_local shared_ptr<TempMemoryBudget> tCurrentBudget;
+
+
+} //namespace pastra
+
+
+
+TempMemoryBudget::TempMemoryBudget(const uint64_t limit)
+  : TempMemoryBudget(limit, &ServerBudget())
+{
+}
+
+
+TempMemoryBudget::TempMemoryBudget(const uint64_t limit, TempMemoryBudget* const parent)
+  : mParent(parent),
+    mLimit(limit),
+    mStats()
+{
+}
+
+
+bool
+TempMemoryBudget::Reserve(const uint64_t size)
+{
+  LockGuard<Lock> _l(mSync);
+
+  if ((mLimit != 0) && (mStats.mUsed + size > mLimit))
+    return false;
+
+  if ((mParent != nullptr) && ! mParent->Reserve(size))
+    return false;
+
+  mStats.mUsed += size;
+  mStats.mPeak = MAX(mStats.mPeak, mStats.mUsed);
+
+  return true;
+}
+
+
+void
+TempMemoryBudget::Release(const uint64_t size)
+{
+  {
+    LockGuard<Lock> _l(mSync);
+
+    assert(mStats.mUsed >= size);
+    mStats.mUsed -= size;
+  }
+
+  if (mParent != nullptr)
+    mParent->Release(size);
+}
+
+
+void
+TempMemoryBudget::NotifySpill(const uint64_t size)
+{
+  {
+    LockGuard<Lock> _l(mSync);
+
+    ++mStats.mSpillsCount;
+    mStats.mSpilledBytes += size;
+  }
+
+  if (mParent != nullptr)
+    mParent->NotifySpill(size);
+}
+
+
+DBSTempMemoryStats
+TempMemoryBudget::Stats()
+{
+  LockGuard<Lock> _l(mSync);
+
+  return mStats;
+}
+
+
+shared_ptr<TempMemoryBudget>
+TempMemoryBudget::Current()
+{
+  return pastra::tCurrentBudget;
+}
+
+
+shared_ptr<TempMemoryBudget>
+TempMemoryBudget::Current(shared_ptr<TempMemoryBudget> budget)
+{
+  pastra::tCurrentBudget.swap(budget);
+
+  return budget;
+}
+
+
+TempMemoryBudget&
+TempMemoryBudget::ServerBudget()
+{
+  //Never destroyed, as temporal values held by static objects may be
+  //released after this would go out of scope.
+  alignas(TempMemoryBudget) static uint8_t storage[sizeof(TempMemoryBudget)];
+
+#pragma push_macro("new")
+#undef new
+  static TempMemoryBudget* const serverBudget =
+      new (storage) TempMemoryBudget(DEFAULT_TEMP_MEMORY_LIMIT, nullptr);
+#pragma pop_macro("new")
+
+  return *serverBudget;
+}
+
+
+
+namespace pastra {
+
+
 TemporalContainer::TemporalContainer(const uint_t reservedMemory)
-  : mCache_1(unique_array_make(uint8_t, reservedMemory / 2)),
-    mCacheStartPos_1(0),
-    mCacheEndPos_1(0),
-    mCacheStartPos_2(0),
-    mCacheEndPos_2(0),
-    mCacheSize(reservedMemory / 2),
-    mDirtyCache_1(false),
-    mDirtyCache_2(false),
-    mCache1LastUsed(true)
+  : mBudget(TempMemoryBudget::Current()),
+    mSize(0),
+    mReservedMemory(0),
+    mCacheStartPos(0),
+    mCacheEndPos(0),
+    mFirstChunkSize(reservedMemory),
+    mMaxChunkSize(MAX(reservedMemory, MAX_TEMP_MEM_CHUNK_SIZE)),
+    mGrowingChunks(0),
+    mDirtyCache(false)
 {
+  assert(reservedMemory > 0);
+
+  while ((_SC(uint64_t, mFirstChunkSize) << mGrowingChunks) < mMaxChunkSize)
+    ++mGrowingChunks;
+}
+
+
+TemporalContainer::~TemporalContainer()
+{
+  if (mReservedMemory > 0)
+    Budget().Release(mReservedMemory);
 }
 
 
@@ -469,44 +778,46 @@ TemporalContainer::Write(uint64_t to, uint64_t size, const uint8_t* buffer)
                                   _SC(long, Size()));
   }
 
-  while (size > 0)
-  {
-    assert((mCacheStartPos_1 % mCacheSize) == 0);
-    assert((mCacheStartPos_2 % mCacheSize) == 0);
+  if ( !IsSpilled() && ! ExtendChunks(to + size))
+    Spill();
 
-    if (mCacheStartPos_1 <= to && to < (mCacheStartPos_1 + mCacheSize))
+  if ( !IsSpilled())
+  {
+    while (size > 0)
     {
-      const uint_t toWrite = MIN(size, mCacheStartPos_1 + mCacheSize - to);
-
-      memcpy(mCache_1.get() + (to - mCacheStartPos_1), buffer, toWrite);
+      uint_t offset;
+      const uint_t chunk = FindChunk(to, &offset);
+      const uint_t toWrite = MIN(size, ChunkSize(chunk) - offset);
 
-      if (to + toWrite > mCacheEndPos_1)
-        mCacheEndPos_1 = to + toWrite;
+      memcpy(mChunks[chunk].get() + offset, buffer, toWrite);
 
       to += toWrite, buffer += toWrite, size -= toWrite;
-      mDirtyCache_1 = true;
     }
-    else if (mCache_2.get() != nullptr
-            && (mCacheStartPos_2 <= to && to < (mCacheStartPos_2 + mCacheSize)))
-    {
-      assert(mCacheStartPos_1 != mCacheStartPos_2);
-      assert((mCacheEndPos_1 != mCacheEndPos_2) || (mCacheEndPos_2 == mCacheStartPos_2));
 
-      const uint_t toWrite = MIN(size, mCacheStartPos_2 + mCacheSize - to);
+    mSize = MAX(mSize, to);
+    return;
+  }
+
+  while (size > 0)
+  {
+    if (mCacheStartPos <= to && to < mCacheStartPos + mFirstChunkSize)
+    {
+      const uint_t toWrite = MIN(size, mCacheStartPos + mFirstChunkSize - to);
 
-      memcpy(mCache_2.get() + (to - mCacheStartPos_2), buffer, toWrite);
+      memcpy(mChunks[0].get() + (to - mCacheStartPos), buffer, toWrite);
 
-      if (to + toWrite > mCacheEndPos_2)
-        mCacheEndPos_2 = to + toWrite;
+      if (to + toWrite > mCacheEndPos)
+        mCacheEndPos = to + toWrite;
 
       to += toWrite, buffer += toWrite, size -= toWrite;
-      mDirtyCache_2 = true;
+      mDirtyCache = true;
     }
     else
       FillCache(to);
   }
 }
 
+
 void
 TemporalContainer::Read(uint64_t from, uint64_t size, uint8_t* buffer)
 {
@@ -519,29 +830,31 @@ TemporalContainer::Read(uint64_t from, uint64_t size, uint8_t* buffer)
                                   _SC(long, Size()));
   }
 
-  while (size > 0)
+  if ( !IsSpilled())
   {
-    assert((mCacheStartPos_1 % mCacheSize) == 0);
-    assert((mCacheStartPos_2 % mCacheSize) == 0);
-
-    if (mCacheStartPos_1 <= from && from < mCacheEndPos_1)
+    while (size > 0)
     {
-      const uint_t toRead = MIN(size, mCacheEndPos_1 - from);
+      uint_t offset;
+      const uint_t chunk = FindChunk(from, &offset);
+      const uint_t toRead = MIN(size, ChunkSize(chunk) - offset);
 
-      memcpy(buffer, mCache_1.get() + (from - mCacheStartPos_1), toRead);
+      memcpy(buffer, mChunks[chunk].get() + offset, toRead);
 
       from += toRead, buffer += toRead, size -= toRead;
     }
-    else if (mCache_2.get() != nullptr
-             && (mCacheStartPos_2 <= from && from < mCacheEndPos_2))
+    return;
+  }
+
+  while (size > 0)
+  {
+    if (mCacheStartPos <= from && from < mCacheEndPos)
     {
-      const uint_t toRead = MIN(size, mCacheEndPos_2 - from);
+      const uint_t toRead = MIN(size, mCacheEndPos - from);
 
-      memcpy(buffer, mCache_2.get() + (from - mCacheStartPos_2), toRead);
+      memcpy(buffer, mChunks[0].get() + (from - mCacheStartPos), toRead);
 
       from += toRead, buffer += toRead, size -= toRead;
     }
-
     else
       FillCache(from);
   }
@@ -562,281 +875,246 @@ TemporalContainer::Colapse(uint64_t from, uint64_t to)
                                      _SC(long, containerSize));
     }
 
-  if (mFileContainer.get() == nullptr
-      && mCache_2.get() != nullptr)
-  {
-    assert(mCacheStartPos_1 == 0);
-    assert(mCacheEndPos_1 == mCacheSize);
-    assert(mCacheStartPos_2 == mCacheSize);
-    assert(mCacheEndPos_2 <= 2 * mCacheSize);
-    assert(containerSize == mCacheEndPos_2);
-
-    uint8_t stepBuffer[128];
-    uint64_t tempFrom = from, tempTo = to;
-
-    while (tempTo < containerSize)
-    {
-      uint_t stepSize = sizeof(stepBuffer);
-
-      if (tempTo + stepSize > containerSize)
-        stepSize = containerSize - tempTo;
-
-      Read(tempTo, stepSize, stepBuffer);
-      Write(tempFrom, stepSize, stepBuffer);
-
-      tempTo += stepSize, tempFrom += stepSize;
-    }
-
-    assert(to <= mCacheEndPos_2);
-
-    mCacheEndPos_2 -= to - from;
-    if (mCacheEndPos_2 <= mCacheSize)
-    {
-      mCacheEndPos_1 = mCacheEndPos_2;
-
-      mCacheStartPos_2 = mCacheEndPos_2 = 0;
-      mCache_2.reset(nullptr);
-      mCache1LastUsed = true;
-    }
-  }
-  else if (mFileContainer.get() != nullptr)
+  if (IsSpilled())
   {
-    assert(mCache_2.get() != nullptr);
+    FlushCache();
+    mFileContainer->Colapse(from, to);
 
-    if (mDirtyCache_1)
-    {
-      mFileContainer->Write(mCacheStartPos_1, mCacheEndPos_1 - mCacheStartPos_1, mCache_1.get());
-      mDirtyCache_1 = false;
-    }
+    if (mFileContainer->Size() <= mFirstChunkSize)
+      Unspill();
 
-    if (mDirtyCache_2)
+    else
     {
-      mFileContainer->Write(mCacheStartPos_2, mCacheEndPos_2 - mCacheStartPos_2, mCache_2.get());
-      mDirtyCache_2 = false;
+      mCacheStartPos = mCacheEndPos = 0;
+      FillCache(0);
     }
-
-    mFileContainer->Colapse(from, to);
-  }
-  else
-  {
-    assert(containerSize == mCacheEndPos_1);
-    assert((containerSize == 0) || mDirtyCache_1);
-
-    uint8_t* const cache_     = mCache_1.get();
-    const uint_t   remainSize = mCacheEndPos_1 - to;
-
-    safe_memcpy(cache_ + from, cache_ + to, remainSize);
-    mCacheEndPos_1 -= (to - from);
+    return;
   }
 
-  if (mFileContainer.get() != nullptr
-      && mFileContainer->Size() <= (2 * mCacheSize))
+  while (to < mSize)
   {
-    if (mFileContainer->Size() > mCacheSize)
-    {
-      assert(mCache_2.get() != nullptr);
+    uint_t fromOffset, toOffset;
 
-      mCacheStartPos_2 = mCacheSize;
-      mCacheEndPos_2 = mFileContainer->Size();
-
-      mFileContainer->Read(mCacheStartPos_2, mCacheEndPos_2 - mCacheStartPos_2, mCache_2.get());
-      mDirtyCache_2 = false;
-    }
-    else if (mCache_2.get() != nullptr)
-    {
-      mCacheStartPos_2 = mCacheEndPos_2 = 0;
-      mDirtyCache_2 = false;
-      mCache1LastUsed = true;
+    const uint_t fromChunk = FindChunk(from, &fromOffset);
+    const uint_t toChunk   = FindChunk(to, &toOffset);
 
-      mCache_2.reset(nullptr);
-    }
+    uint64_t toMove = mSize - to;
 
-    mCacheStartPos_1 = 0;
-    mCacheEndPos_1 = MIN(mFileContainer->Size(), mCacheSize);
+    toMove = MIN(toMove, ChunkSize(fromChunk) - fromOffset);
+    toMove = MIN(toMove, ChunkSize(toChunk) - toOffset);
 
-    mFileContainer->Read(mCacheStartPos_1, mCacheEndPos_1 - mCacheStartPos_1, mCache_1.get());
-    mDirtyCache_1 = false;
+    memmove(mChunks[fromChunk].get() + fromOffset, mChunks[toChunk].get() + toOffset, toMove);
 
-    mFileContainer.reset(nullptr);
+    from += toMove, to += toMove;
   }
-  else if (mFileContainer.get() != nullptr)
-  {
-    /* Refill both cache buffers. */
-    assert(mCache_2.get() != nullptr);
-
-    assert(mDirtyCache_1 == false);
-    assert(mDirtyCache_2 == false);
-
-    mCacheStartPos_1 = 0;
-    mCacheEndPos_1 = mCacheSize;
 
-    mFileContainer->Read(mCacheStartPos_1, mCacheEndPos_1 - mCacheStartPos_1, mCache_1.get());
-
-    from -= from % mCacheSize;
-    if (from == 0)
-      from = mCacheSize;
-
-    mCacheStartPos_2 = from;
-    mCacheEndPos_2 = MIN(mFileContainer->Size(), from + mCacheSize);
-
-    mFileContainer->Read(mCacheStartPos_2, mCacheEndPos_2 - mCacheStartPos_2, mCache_2.get());
-
-    mCache1LastUsed = false;
-  }
+  mSize = from;
+  ReleaseChunks();
 }
 
+
 void
 TemporalContainer::MarkForRemoval()
 {
   return ; //This will be deleted automatically. Nothing to do here!
 }
 
+
 void
 TemporalContainer::Flush()
 {
-  if (mFileContainer.get() != nullptr)
+  if (IsSpilled())
+  {
+    FlushCache();
     mFileContainer->Flush();
+  }
 }
 
+
 uint64_t
 TemporalContainer::Size() const
 {
-  assert((mCacheStartPos_1 % mCacheSize) == 0);
-  assert((mCacheStartPos_2 % mCacheSize) == 0);
+  if (IsSpilled())
+    return MAX(mCacheEndPos, mFileContainer->Size());
 
-  assert(mCacheStartPos_1 <= mCacheEndPos_1);
-  assert(mCacheStartPos_2 <= mCacheEndPos_2);
+  return mSize;
+}
 
-  if (mFileContainer.get() != nullptr)
-  {
-    assert(mCache_2.get() != nullptr);
-    assert(mCacheStartPos_1 != mCacheStartPos_2);
-    assert((mCacheEndPos_1 != mCacheEndPos_2)
-            || (mCacheEndPos_2 == mCacheStartPos_2));
 
-    const uint64_t temp = max(mCacheEndPos_1, mCacheEndPos_2);
-    return max(temp, mFileContainer->Size());
-  }
-  else if (mCache_2.get() != nullptr)
+uint64_t
+TemporalContainer::ChunkStart(const uint_t chunk) const
+{
+  if (chunk <= mGrowingChunks)
+    return _SC(uint64_t, mFirstChunkSize) * ((_SC(uint64_t, 1) << chunk) - 1);
+
+  return ChunkStart(mGrowingChunks) + _SC(uint64_t, chunk - mGrowingChunks) * mMaxChunkSize;
+}
+
+
+uint_t
+TemporalContainer::ChunkSize(const uint_t chunk) const
+{
+  if (chunk < mGrowingChunks)
+    return mFirstChunkSize << chunk;
+
+  return mMaxChunkSize;
+}
+
+
+uint_t
+TemporalContainer::FindChunk(const uint64_t position, uint_t* const outOffset) const
+{
+  const uint64_t growingEnd = ChunkStart(mGrowingChunks);
+  if (position >= growingEnd)
   {
-    assert(mCacheStartPos_1  == 0);
-    assert(mCacheEndPos_1    == mCacheSize);
-    assert(mCacheStartPos_2  == mCacheSize);
-    assert(mCacheEndPos_1    <= 2 * mCacheSize);
+    *outOffset = (position - growingEnd) % mMaxChunkSize;
+    return mGrowingChunks + (position - growingEnd) / mMaxChunkSize;
   }
-  else
+
+  uint_t chunk = 0;
+  uint64_t start = 0;
+  while (position >= start + ChunkSize(chunk))
+    start += ChunkSize(chunk++);
+
+  *outOffset = position - start;
+  return chunk;
+}
+
+
+bool
+TemporalContainer::ExtendChunks(const uint64_t size)
+{
+  while (ChunkStart(mChunks.size()) < size)
   {
-    assert(mCacheStartPos_1 == 0);
-    assert(mCacheEndPos_1 <= mCacheSize);
+    const uint_t chunkSize = ChunkSize(mChunks.size());
+
+    //The first chunk is always granted, as it's used as a cache once the
+    //content is moved to a file. It is the only one that may be used without
+    //being reserved, so it is not accounted then.
+    const bool reserved = Budget().Reserve(chunkSize);
+    if ( ! reserved && ! mChunks.empty())
+      return false;
+
+    try
+    {
+      mChunks.push_back(unique_array_make(uint8_t, chunkSize));
+    }
+    catch (std::bad_alloc&)
+    {
+      //Running out of memory is also a good reason to use a file.
+      if (reserved)
+        Budget().Release(chunkSize);
+
+      if (mChunks.empty())
+        throw;
+
+      return false;
+    }
+
+    if (reserved)
+      mReservedMemory += chunkSize;
   }
 
-  return max(mCacheEndPos_1, mCacheEndPos_2);
+  return true;
 }
 
 
 void
-TemporalContainer::FillCache(uint64_t position)
+TemporalContainer::ReleaseChunks()
 {
-  position -= (position % mCacheSize);
+  assert( !IsSpilled());
 
-  assert((mCacheStartPos_1 % mCacheSize) == 0);
-  assert((mCacheStartPos_2 % mCacheSize) == 0);
+  while ((mChunks.size() > 1) && (ChunkStart(mChunks.size() - 1) >= mSize))
+  {
+    const uint_t chunkSize = ChunkSize(mChunks.size() - 1);
 
-  if (mCacheStartPos_1 == position)
-    return;
+    mChunks.pop_back();
 
-  else if (mCache_2.get() != nullptr && mCacheStartPos_2 == position)
-    return;
+    Budget().Release(chunkSize);
+    mReservedMemory -= chunkSize;
+  }
+}
 
-  else if (mCache_2.get() == nullptr && position == mCacheSize)
-  {
-    assert(mFileContainer.get() == nullptr);
 
-    mCache_2.reset(new uint8_t[mCacheSize]);
-    mCacheStartPos_2 = mCacheEndPos_2 = mCacheSize;
-    mDirtyCache_2 = false;
+void
+TemporalContainer::Spill()
+{
+  assert( !IsSpilled());
+  assert(mChunks.size() > 0);
 
-    mCache1LastUsed = false;
+  const uint64_t currentId = wh_atomic_fetch_inc64(_RC(int64_t*, &smTemporalsCount));
+  const DBSSettings& settings = DBSGetSeettings();
+  const string baseName = settings.mTempDir + "wtemp" + to_string(currentId) + ".tmp";
 
-    return;
-  }
+  unique_ptr<TemporalFileContainer> fileContainer(
+      new TemporalFileContainer(baseName.c_str(), settings.mMaxFileSize));
 
-  if (mFileContainer.get() == nullptr)
+  for (uint_t chunk = 0; chunk < mChunks.size(); ++chunk)
   {
-    const uint64_t currentId = wh_atomic_fetch_inc64(_RC(int64_t*, &smTemporalsCount));
+    const uint64_t start = ChunkStart(chunk);
+    if (start >= mSize)
+      break;
 
-    assert(mCacheStartPos_1 == 0);
-    assert(mCacheEndPos_1 == mCacheSize);
-    assert(mCacheStartPos_2 == mCacheSize);
-    assert(mCacheEndPos_2 == 2 * mCacheSize);
-    assert(position == 2 * mCacheSize);
+    fileContainer->Write(start, MIN(mSize - start, ChunkSize(chunk)), mChunks[chunk].get());
+  }
 
-    const DBSSettings& settings = DBSGetSeettings();
+  Budget().NotifySpill(mSize);
 
-    const string baseName = settings.mTempDir + "wtemp" + to_string(currentId) + ".tmp";
+  //Keep only the first chunk to be used as cache.
+  mSize = 0;
+  ReleaseChunks();
 
-    mFileContainer.reset(new TemporalFileContainer(baseName.c_str(), settings.mMaxFileSize));
+  mFileContainer = move(fileContainer);
 
-    mFileContainer->Write(0, mCacheSize, mCache_1.get());
-    mFileContainer->Write(mCacheSize, mCacheSize, mCache_2.get());
+  mCacheStartPos = 0;
+  mCacheEndPos   = MIN(mFileContainer->Size(), mFirstChunkSize);
+  mDirtyCache    = false;
+}
 
-    mDirtyCache_1 = mDirtyCache_2 = false;
 
-    mCacheStartPos_1 = mCacheEndPos_1 = position;
+void
+TemporalContainer::Unspill()
+{
+  assert(IsSpilled());
+  assert(mDirtyCache == false);
+  assert(mFileContainer->Size() <= mFirstChunkSize);
 
-    mCache1LastUsed = true;
-    return;
-  }
-  else if (mCache1LastUsed)
-  {
-    if (mDirtyCache_2)
-    {
-      mFileContainer->Write(mCacheStartPos_2, mCacheEndPos_2 - mCacheStartPos_2, mCache_2.get());
-      mDirtyCache_2 = false;
-    }
+  mSize = mFileContainer->Size();
+  mFileContainer->Read(0, mSize, mChunks[0].get());
+  mFileContainer.reset(nullptr);
 
-    if (position >= mFileContainer->Size())
-    {
-      if (mDirtyCache_1)
-      {
-        mFileContainer->Write(mCacheStartPos_1, mCacheEndPos_1 - mCacheStartPos_1, mCache_1.get());
-        mDirtyCache_1 = false;
-      }
-    }
+  mCacheStartPos = mCacheEndPos = 0;
+}
 
-    const uint_t toRead = MIN(mCacheSize, mFileContainer->Size() - position);
 
-    mFileContainer->Read(position, toRead, mCache_2.get());
+void
+TemporalContainer::FlushCache()
+{
+  assert(IsSpilled());
 
-    mCacheStartPos_2 = position;
-    mCacheEndPos_2 = mCacheStartPos_2 + toRead;
-    mCache1LastUsed = false;
-  }
-  else
+  if (mDirtyCache)
   {
-    if (mDirtyCache_1)
-    {
-      mFileContainer->Write(mCacheStartPos_1, mCacheEndPos_1 - mCacheStartPos_1, mCache_1.get());
-      mDirtyCache_1 = false;
-    }
+    mFileContainer->Write(mCacheStartPos, mCacheEndPos - mCacheStartPos, mChunks[0].get());
+    mDirtyCache = false;
+  }
+}
 
-    if (position >= mFileContainer->Size())
-    {
-      if (mDirtyCache_2)
-      {
-        mFileContainer->Write(mCacheStartPos_2, mCacheEndPos_2 - mCacheStartPos_2, mCache_2.get());
-        mDirtyCache_2 = false;
-      }
-    }
 
-    const uint_t toRead = MIN(mCacheSize, mFileContainer->Size() - position);
+void
+TemporalContainer::FillCache(uint64_t position)
+{
+  assert(IsSpilled());
+
+  position -= (position % mFirstChunkSize);
 
-    mFileContainer->Read(position, toRead, mCache_1.get());
+  FlushCache();
 
-    mCacheStartPos_1 = position;
-    mCacheEndPos_1 = mCacheStartPos_1 + toRead;
-    mCache1LastUsed = true;
-  }
+  const uint_t toRead = MIN(mFirstChunkSize, mFileContainer->Size() - position);
+
+  mFileContainer->Read(position, toRead, mChunks[0].get());
+
+  mCacheStartPos = position;
+  mCacheEndPos = mCacheStartPos + toRead;
 }
 
 
@@ -31,6 +31,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "utils/wfile.h"
 #include "utils/wthread.h"
+#include "dbs/dbs_mgr.h"
 #include "dbs/dbs_values.h"
 
 
@@ -38,7 +39,8 @@ namespace whais {
 namespace pastra {
 
 
-static const uint_t DEFAULT_TEMP_MEM_RESERVED = 4096; //4KB
+static const uint_t DEFAULT_TEMP_MEM_RESERVED = 4096;   //4KB
+static const uint_t MAX_TEMP_MEM_CHUNK_SIZE   = 262144; //256KB
 
 
 void
@@ -97,6 +99,28 @@ public:
 
 
 
+class FileContainer;
+
+
+/* Keeps what is needed to bring the files of a container back to their
+ * content from the last time its table was synchronised. It is told about
+ * every change before the change reaches the files. */
+class IContainerJournal
+{
+public:
+  virtual ~IContainerJournal() = default;
+
+  virtual void Attach(FileContainer& container) = 0;
+  //The content from the specified offset is about to be overwritten. The
+  //container might grow too.
+  virtual void BeforeWrite(FileContainer& container, const uint64_t from, const uint64_t size) = 0;
+  //The container files are about to be removed.
+  virtual void BeforeRemoval(FileContainer& container) = 0;
+  //The container is not used anymore.
+  virtual void Detach(FileContainer& container) = 0;
+};
+
+
 class FileContainer : public IDataContainer
 {
 public:
@@ -116,17 +140,46 @@ public:
   virtual void MarkForRemoval() override;
   virtual void Flush() override;
 
+  void Journal(IContainerJournal* const journal) { mJournal = journal; }
+  const std::string& BaseName() const { return mFileNamePrefix; }
+  uint64_t MaxFileSize() const { return mMaxFileUnitSize; }
+
+  //While set, what is written is kept in memory (and read back from there)
+  //until WriteStaged() is called. The next write or collapse that is not
+  //staged has it written first.
+  void StageWrites(const bool stage);
+  void WriteStaged();
+
   static void Fix(const char* const   baseFile,
                   const uint64_t      maxFileSize,
                   const uint64_t      newContainerSize);
 private:
-  void ExtendContainer();
+  struct StagedWrite
+  {
+    uint64_t               mOffset;
+    std::vector<uint8_t>   mContent;
+    //The content is cut at the offset instead.
+    bool                   mTruncation;
+  };
 
-  const uint64_t      mMaxFileUnitSize;
-  std::vector<File>   mFilesHandles;
-  std::string         mFileNamePrefix;
-  bool                mToRemove;
-  bool                mIgnoreExistingData;
+  void WriteContent(uint64_t to, uint64_t size, const uint8_t* buffer);
+  void ReadContent(uint64_t from, uint64_t size, uint8_t* buffer);
+  void ReadStaged(uint64_t from, uint64_t size, uint8_t* buffer);
+  void TruncateContent(const uint64_t newSize);
+  void WriteStagedContent();
+  void ExtendContainer();
+  uint64_t FilesSize() const;
+  uint64_t ContentSize() const;
+
+  const uint64_t             mMaxFileUnitSize;
+  std::vector<File>          mFilesHandles;
+  std::string                mFileNamePrefix;
+  IContainerJournal*         mJournal;
+  std::vector<StagedWrite>   mStaged;
+  mutable Lock               mSync;
+  bool                       mStaging;
+  bool                       mToRemove;
+  bool                       mIgnoreExistingData;
 };
 
 
@@ -141,6 +194,7 @@ class TemporalContainer : public IDataContainer
 {
 public:
   explicit TemporalContainer(const uint_t reservedMemory = DEFAULT_TEMP_MEM_RESERVED);
+  virtual ~TemporalContainer() override;
 
   virtual void Write(uint64_t to, uint64_t size, const uint8_t* buffer) override;
   virtual void Read(uint64_t from, uint64_t size, uint8_t* buffer) override;
@@ -150,21 +204,40 @@ public:
   virtual void MarkForRemoval() override;
   virtual void Flush() override;
 
+  bool IsSpilled() const { return mFileContainer.get() != nullptr; }
+
 private:
-  void  FillCache(uint64_t position);
+  uint64_t ChunkStart(const uint_t chunk) const;
+  uint_t ChunkSize(const uint_t chunk) const;
+  uint_t FindChunk(const uint64_t position, uint_t* const outOffset) const;
+
+  bool  ExtendChunks(const uint64_t size);
+  void  ReleaseChunks();
+  void  Spill();
+  void  Unspill();
 
-  std::unique_ptr<TemporalFileContainer>   mFileContainer;
-  std::unique_ptr<uint8_t[]>               mCache_1;
-  std::unique_ptr<uint8_t[]>               mCache_2;
-  uint64_t                                 mCacheStartPos_1;
-  uint64_t                                 mCacheEndPos_1;
-  uint64_t                                 mCacheStartPos_2;
-  uint64_t                                 mCacheEndPos_2;
-  const uint_t                             mCacheSize;
-  bool                                     mDirtyCache_1;
-  bool                                     mDirtyCache_2;
-  bool                                     mCache1LastUsed;
+  void  FlushCache();
+  void  FillCache(uint64_t position);
 
+  TempMemoryBudget& Budget()
+  {
+    return mBudget ? *mBudget : TempMemoryBudget::ServerBudget();
+  }
+
+  /* The content is kept in chunks of memory that double in size up to a
+   * limit. When the memory budget is exhausted the content is moved to a
+   * temporal file and the first chunk is used to cache it. */
+  std::unique_ptr<TemporalFileContainer>     mFileContainer;
+  std::vector<std::unique_ptr<uint8_t[]>>    mChunks;
+  std::shared_ptr<TempMemoryBudget>          mBudget;
+  uint64_t                                   mSize;
+  uint64_t                                   mReservedMemory;
+  uint64_t                                   mCacheStartPos;
+  uint64_t                                   mCacheEndPos;
+  const uint_t                               mFirstChunkSize;
+  const uint_t                               mMaxChunkSize;
+  uint_t                                     mGrowingChunks;
+  bool                                       mDirtyCache;
 
   static uint64_t smTemporalsCount;
 };
@@ -25,8 +25,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <map>
 #include <memory>
 #include <memory.h>
+#include <set>
 #include <assert.h>
 #include <stdio.h>
+#include <stdarg.h>
+#include <vector>
 
 #include "dbs/dbs_exception.h"
 #include "utils/wfile.h"
@@ -34,6 +37,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "utils/endianness.h"
 #include "ps_dbsmgr.h"
 #include "ps_table.h"
+#include "ps_redolog.h"
 
 
 using namespace std;
@@ -43,10 +47,11 @@ namespace pastra {
 
 
 static const char DBS_FILE_EXT[]       = ".db";
+static const char DBS_REDO_FILE_EXT[]  = ".redo";
 static const char DBS_FILE_SIGNATURE[] = { 0x50, 0x41, 0x53, 0x54, 0x52, 0x41, 0x20, 0x44 };
 
 static const uint16_t PS_DBS_VER_MAJ   = 1;
-static const uint16_t PS_DBS_VER_MIN   = 1;
+static const uint16_t PS_DBS_VER_MIN   = 2;
 
 static const uint_t PS_DBS_SIGNATURE_OFF    = 0;
 static const uint_t PS_DBS_SIGNATURE_LEN    = 8;
@@ -64,6 +69,7 @@ static const uint_t PS_DBS_HEADER_SIZE      = 32;
 
 static const uint64_t PS_FLAG_NOT_CLOSED   = 1;
 static const uint64_t PS_FLAG_TO_REPAIR    = 2;
+static const uint64_t PS_FLAG_TO_RECOVER   = 4;
 
 static unique_ptr<DbsManager> dbsMgrs_;
 
@@ -72,6 +78,7 @@ DbsHandler::DbsHandler(const DBSSettings&   settings,
                        const std::string&   locationDir,
                        const std::string&   name)
   : mGlbSettings(settings),
+    mPinnedTable(nullptr),
     mDbsLocationDir(locationDir),
     mFileName(mDbsLocationDir + name + DBS_FILE_EXT),
     mFile(mFileName.c_str(), WH_FILEOPEN_EXISTING | WH_FILERDWR | WH_FILESYNC),
@@ -94,14 +101,18 @@ DbsHandler::DbsHandler(const DBSSettings&   settings,
 
   uint64_t headerFlags = load_le_int64(buffer + PS_DBS_FLAGS_OFF);
   if ((headerFlags & PS_FLAG_NOT_CLOSED)
-      && ! (headerFlags & PS_FLAG_TO_REPAIR))
+      && ! (headerFlags & (PS_FLAG_TO_REPAIR | PS_FLAG_TO_RECOVER)))
   {
     throw DBSException(_EXTRA(DBSException::DATABASE_IN_USE),
                         "Cannot open database '%s'. Either it is already in use or it was not"
                           " properly closed last time.",
                         name.c_str());
   }
-  headerFlags &= ~PS_FLAG_TO_REPAIR;
+
+  //The logged updates are of no use once the tables are repaired.
+  const bool discardRedoLog = (headerFlags & PS_FLAG_TO_REPAIR) != 0;
+
+  headerFlags &= ~(PS_FLAG_TO_REPAIR | PS_FLAG_TO_RECOVER);
   store_le_int64(headerFlags, buffer + PS_DBS_FLAGS_OFF);
 
   const uint16_t versionMaj = load_le_int16(buffer + PS_DBS_VER_MAJ_OFF);
@@ -129,6 +140,10 @@ DbsHandler::DbsHandler(const DBSSettings&   settings,
                        _SC(long, mGlbSettings.mMaxFileSize));
   }
 
+  //The tables of older versions are converted as they are opened.
+  store_le_int16(PS_DBS_VER_MAJ, buffer + PS_DBS_VER_MAJ_OFF);
+  store_le_int16(PS_DBS_VER_MIN, buffer + PS_DBS_VER_MIN_OFF);
+
   //Before we continue set the 'in use' flag.
   mFile.Seek(0, WH_SEEK_BEGIN);
   mFile.Write(buffer, fileSize);
@@ -140,14 +155,22 @@ DbsHandler::DbsHandler(const DBSSettings&   settings,
     mTables.insert(pair<string, PersistentTable*>(_RC(char*, buffer), nullptr));
     buffer += strlen(_RC(char*, buffer)) + 1;
   }
+
+  const string redoFile = mDbsLocationDir + name + DBS_REDO_FILE_EXT;
+  if (discardRedoLog)
+    RedoLog::RemoveFiles(redoFile);
+
+  mRedoLog = unique_make(RedoLog, redoFile, mGlbSettings.mDurability);
 }
 
 DbsHandler::DbsHandler(DbsHandler&& source)
   : mGlbSettings(move(source.mGlbSettings)),
+    mPinnedTable(nullptr),
     mDbsLocationDir(move(source.mDbsLocationDir)),
     mFileName(move(source.mFileName)),
     mFile(move(source.mFile)),
     mTables(move(source.mTables)),
+    mRedoLog(move(source.mRedoLog)),
     mCreatedTemporalTables(move(source.mCreatedTemporalTables)),
     mNeedsSync(move(source.mNeedsSync))
 {
@@ -287,6 +310,8 @@ DbsHandler::ReleaseTable(ITable& hndTable)
     return;
   }
 
+  WaitTableUnpin(&hndTable);
+
   for (auto it = mTables.begin(); it != mTables.end(); ++it)
   {
     if (&hndTable == _SC(ITable*, it->second))
@@ -326,6 +351,8 @@ DbsHandler::TableName(const TABLE_INDEX index)
 void
 DbsHandler::DeleteTable(const char* const name)
 {
+  //Wait for any checkpoint in progress, we are about to do our own.
+  LockGuard<Lock> checkpointHolder(mCheckpointSync);
   LockGuard<Lock> syncHolder(mSync);
 
   auto it = mTables.find(name);
@@ -347,24 +374,110 @@ DbsHandler::DeleteTable(const char* const name)
   mTables.erase(it);
 
   SyncToFile();
+
+  //Do not let the logged updates of this table to be confused with the ones
+  //of a new table created with the same name.
+  Checkpoint();
+}
+
+
+void
+DbsHandler::AddTableField(const char* const name, const DBSFieldDescriptor& field)
+{
+  //The checkpoints convert the altered tables rows, do not run along them.
+  LockGuard<Lock> checkpointHolder(mCheckpointSync);
+
+  bool opened;
+  PersistentTable& table = PinTableToAlter(name, &opened);
+
+  try
+  {
+    table.AddField(field);
+  }
+  catch (...)
+  {
+    ReleaseAlteredTable(opened);
+    throw;
+  }
+
+  ReleaseAlteredTable(opened);
+}
+
+
+void
+DbsHandler::RetypeTableField(const char* const      name,
+                             const char* const      field,
+                             const DBS_FIELD_TYPE   type)
+{
+  LockGuard<Lock> checkpointHolder(mCheckpointSync);
+
+  bool opened;
+  PersistentTable& table = PinTableToAlter(name, &opened);
+
+  try
+  {
+    table.RetypeField(table.RetrieveField(field), type);
+  }
+  catch (...)
+  {
+    ReleaseAlteredTable(opened);
+    throw;
+  }
+
+  ReleaseAlteredTable(opened);
 }
 
 
 void
 DbsHandler::SyncAllTablesContent()
 {
-  LockGuard<Lock> _l(mSync);
+  //The tables are flushed without holding the database lock for the whole
+  //checkpoint, so only one of these could be in progress at a time.
+  LockGuard<Lock> _c(mCheckpointSync);
 
-  if ( ! mNeedsSync)
-    return;
+  uint64_t lsn = 0;
+  vector<string> openedTables;
+  {
+    LockGuard<Lock> _l(mSync);
 
-  for (auto& table: mTables)
+    if ( ! mNeedsSync)
+      return;
+
+    //The updates made from now on mark the database as not closed again.
+    mNeedsSync = false;
+
+    if (mRedoLog != nullptr)
+      lsn = mRedoLog->BeginCheckpoint();
+
+    //The tables not opened right now were flushed when they were released.
+    for (auto& table : mTables)
+    {
+      if (table.second != nullptr)
+        openedTables.push_back(table.first);
+    }
+  }
+
+  try
   {
-    if (table.second != nullptr)
-      table.second->Flush();
+    for (auto& name : openedTables)
+      CheckpointTable(name);
+  }
+  catch (...)
+  {
+    LockGuard<Lock> _l(mSync);
+
+    mNeedsSync = true;
+    throw;
   }
 
-  mNeedsSync = false;
+  if (mRedoLog != nullptr)
+    mRedoLog->EndCheckpoint(lsn);
+
+  LockGuard<Lock> _l(mSync);
+
+  //Some of the tables were modified after they were flushed.
+  if (mNeedsSync)
+    return;
 
   uint8_t flags[sizeof(uint64_t)];
 
@@ -432,6 +545,13 @@ DbsHandler::NotifyDatabaseUpdate(const bool tryDbLock)
   return true;
 }
 
+void
+DbsHandler::CommitUpdates()
+{
+  if (mRedoLog != nullptr)
+    mRedoLog->CommitProcedure();
+}
+
 ITable&
 DbsHandler::CreateTempTable(const FIELD_INDEX   fieldsCount,
                              DBSFieldDescriptor* inoutFields)
@@ -448,6 +568,7 @@ DbsHandler::CreateTempTable(const FIELD_INDEX   fieldsCount,
 void
 DbsHandler::Discard()
 {
+  LockGuard<Lock> checkpointHolder(mCheckpointSync);
   LockGuard<Lock> syncHolder(mSync);
 
   for (auto& table : mTables)
@@ -455,6 +576,339 @@ DbsHandler::Discard()
     delete table.second;
     table.second = nullptr;
   }
+
+  //Every table was synchronised when it was closed, even what they logged
+  //while being closed is not needed anymore.
+  if (mRedoLog != nullptr)
+    mRedoLog->EndCheckpoint(mRedoLog->BeginCheckpoint());
+}
+
+//The damages left by the crash are fixed without asking, the logged updates
+//are replayed afterwards anyway.
+static bool
+recovery_fix_callback(const FIX_ERROR_CALLBACK_TYPE type, const char* const, ...)
+{
+  return type != CRITICAL;
+}
+
+
+//What the log tells about a table that was not properly closed.
+struct TableRecovery
+{
+  //The logged updates up to this one are in the table's synchronised content.
+  uint64_t   mSyncedLsn;
+  //The last time it was changed in a way its journal cannot undo.
+  uint64_t   mAlteredLsn;
+  bool       mAltered;
+};
+
+
+static map<string, TableRecovery>
+tables_to_recover(const string& logFile, const map<string, PersistentTable*>& tables)
+{
+  map<string, TableRecovery> result;
+
+  RedoLogReader reader(logFile);
+  RedoRecord record;
+
+  while (reader.Next(record))
+  {
+    //Skip the records of a table removed before they were discarded.
+    if (tables.find(record.mTable) == tables.end())
+      continue;
+
+    //Every table changed since the checkpoint was synchronised afterwards, so
+    //one with no synchronisation logged has none of its updates discarded.
+    auto it = result.find(record.mTable);
+    if (it == result.end())
+      it = result.insert(make_pair(record.mTable, TableRecovery{0, 0, false})).first;
+
+    //A synchronisation whose content was written after the table was unlocked
+    //might get logged after a later one.
+    if (record.mType == REDO_TABLE_SYNC)
+      it->second.mSyncedLsn = MAX(it->second.mSyncedLsn, record.mEpoch);
+
+    else if (record.mType == REDO_TABLE_ALTER)
+      it->second.mAlteredLsn = record.mLsn;
+  }
+
+  for (auto& table : result)
+    table.second.mAltered = (table.second.mAlteredLsn > table.second.mSyncedLsn);
+
+  return result;
+}
+
+
+//Brings the tables' files back to their synchronised content. Only the first
+//size and the first image journaled for a container and for its blocks since
+//then hold what was there, the later ones were taken from content written
+//after the synchronisation.
+static void
+restore_tables_files(const string&                       logFile,
+                     const string&                       directory,
+                     const map<string, TableRecovery>&   tables)
+{
+  map<string, unique_ptr<FileContainer>> containers;
+  set<pair<string, uint64_t>> restoredBlocks;
+
+  RedoLogReader reader(logFile);
+  RedoRecord record;
+
+  while (reader.Next(record))
+  {
+    if ((record.mType != REDO_CONTAINER_SIZE) && (record.mType != REDO_BLOCK_IMAGE))
+      continue;
+
+    auto table = tables.find(record.mTable);
+    if ((table == tables.end())
+        || table->second.mAltered
+        || (record.mEpoch < table->second.mSyncedLsn))
+    {
+      continue;
+    }
+
+    const string fileName = directory + record.mContainer;
+    auto it = containers.find(record.mContainer);
+
+    if (record.mType == REDO_CONTAINER_SIZE)
+    {
+      if (it != containers.end())
+        continue;
+
+      FileContainer::Fix(fileName.c_str(), record.mUnitSize, record.mOffset);
+
+      const uint64_t unitsCount = (record.mOffset + record.mUnitSize - 1) / record.mUnitSize;
+      containers[record.mContainer].reset(new FileContainer(fileName.c_str(),
+                                                            record.mUnitSize,
+                                                            unitsCount,
+                                                            false));
+      continue;
+    }
+
+    //A block is journaled only after the size of its container.
+    if (it == containers.end())
+    {
+      throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY),
+                         "Cannot recover table '%s' as its journal is not complete.",
+                         record.mTable.c_str());
+    }
+
+    if ( ! restoredBlocks.insert(make_pair(record.mContainer, record.mOffset)).second)
+      continue;
+
+    //The blocks past the container's end were added later and are gone now.
+    const uint64_t size = it->second->Size();
+    if (record.mOffset < size)
+    {
+      it->second->Write(record.mOffset,
+                        MIN(record.mValueSize, size - record.mOffset),
+                        record.mValue);
+    }
+  }
+
+  for (auto& container : containers)
+    container.second->Flush();
+}
+
+
+void
+DbsHandler::ReplayRedoLog()
+{
+  assert(mRedoLog != nullptr);
+
+  //The log stays in place, so the blocks written while replaying are
+  //journaled as well and a new attempt can undo them if this one stops.
+  const map<string, TableRecovery> recovered = tables_to_recover(mRedoLog->FileName(), mTables);
+
+  try
+  {
+    restore_tables_files(mRedoLog->FileName(), WorkingDir(), recovered);
+
+    //A table changed in a way its journal cannot undo (e.g. it had its rows
+    //layout converted) has to be checked all over instead.
+    for (auto& table : recovered)
+    {
+      if ( ! table.second.mAltered)
+        continue;
+
+      if ( ! PersistentTable::RepairTable(*this,
+                                          table.first,
+                                          WorkingDir(),
+                                          recovery_fix_callback,
+                                          MAX(mGlbSettings.mCheckThreads, 1u)))
+      {
+        throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY),
+                           "Cannot recover table '%s' as it is too damaged.",
+                           table.first.c_str());
+      }
+    }
+
+    //Every table is reopened, even the ones with no logged updates, to have
+    //their files marked as properly closed again.
+    for (auto& table : mTables)
+    {
+      assert(table.second == nullptr);
+      table.second = new PersistentTable(*this, table.first, true);
+    }
+
+    RedoLogReader reader(mRedoLog->FileName());
+    RedoRecord record;
+
+    while (reader.Next(record))
+    {
+      if ((record.mType != REDO_ROW_ADD) && (record.mType != REDO_FIELD_VALUE))
+        continue;
+
+      //Skip the updates already in the table's synchronised content.
+      auto it = recovered.find(record.mTable);
+      if ((it != recovered.end()) && (record.mLsn > it->second.mSyncedLsn))
+        mTables[record.mTable]->ApplyRedoRecord(record);
+    }
+  }
+  catch (...)
+  {
+    //The log is kept for another attempt. The tables do not log their
+    //synchronisation while being recovered, so it will start over.
+    LockGuard<Lock> syncHolder(mSync);
+
+    for (auto& table : mTables)
+    {
+      delete table.second;
+      table.second = nullptr;
+    }
+
+    throw;
+  }
+
+  Discard();
+}
+
+void
+DbsHandler::Checkpoint()
+{
+  //The records logged after this point might not be covered by the flush.
+  const uint64_t lsn = (mRedoLog != nullptr) ? mRedoLog->BeginCheckpoint() : 0;
+
+  for (auto& table: mTables)
+  {
+    if (table.second != nullptr)
+      table.second->Flush();
+  }
+
+  if (mRedoLog != nullptr)
+    mRedoLog->EndCheckpoint(lsn);
+}
+
+void
+DbsHandler::CheckpointTable(const string& name)
+{
+  PersistentTable* table;
+  {
+    LockGuard<Lock> _l(mSync);
+
+    auto it = mTables.find(name);
+    if ((it == mTables.end()) || (it->second == nullptr))
+      return;
+
+    //Keep the table around until we are done with it, even if it's released.
+    table = mPinnedTable = it->second;
+  }
+
+  try
+  {
+    //The rows left with the layout the table had before being altered are
+    //converted the same way.
+    while (table->ConvertSomeRows(mGlbSettings.mCheckpointBatch))
+      CheckpointPause();
+
+    //Write the modified blocks few at a time, so the table users do not have
+    //to wait for the whole table to be flushed.
+    while (table->FlushSome(mGlbSettings.mCheckpointBatch))
+      CheckpointPause();
+
+    //What was modified meanwhile, index nodes included, is only copied while
+    //the table is locked.
+    table->FlushDeferred();
+  }
+  catch (...)
+  {
+    UnpinTable();
+    throw;
+  }
+
+  UnpinTable();
+}
+
+void
+DbsHandler::CheckpointPause()
+{
+  if (mGlbSettings.mCheckpointPause > 0)
+    wh_sleep(mGlbSettings.mCheckpointPause);
+
+  else
+    wh_yield();
+}
+
+PersistentTable&
+DbsHandler::PinTableToAlter(const char* const name, bool* const outOpened)
+{
+  LockGuard<Lock> _l(mSync);
+
+  auto it = mTables.find(name);
+  if (it == mTables.end())
+  {
+    throw DBSException(_EXTRA(DBSException::TABLE_NOT_FUND),
+                       "Cannot alter table '%s'. It was not found.",
+                       name);
+  }
+
+  //The table is opened just for this, if no one uses it.
+  *outOpened = (it->second == nullptr);
+  if (*outOpened)
+    it->second = new PersistentTable(*this, it->first);
+
+  mPinnedTable = it->second;
+
+  return *mPinnedTable;
+}
+
+void
+DbsHandler::ReleaseAlteredTable(const bool opened)
+{
+  LockGuard<Lock> _l(mSync);
+
+  if (opened)
+  {
+    for (auto& table : mTables)
+    {
+      if (table.second == mPinnedTable)
+      {
+        delete table.second;
+        table.second = nullptr;
+        break;
+      }
+    }
+  }
+
+  mPinnedTable = nullptr;
+  mUnpinned.Broadcast();
+}
+
+void
+DbsHandler::UnpinTable()
+{
+  LockGuard<Lock> _l(mSync);
+
+  mPinnedTable = nullptr;
+  mUnpinned.Broadcast();
+}
+
+void
+DbsHandler::WaitTableUnpin(const ITable* const table)
+{
+  //Expects the database lock to be held.
+  while ((mPinnedTable != nullptr) && (_SC(ITable*, mPinnedTable) == table))
+    mUnpinned.Wait(mSync);
 }
 
 void
@@ -520,6 +974,14 @@ DbsHandler::RemoveFromStorage()
       table->RemoveFromDatabase();
     }
 
+  if (mRedoLog != nullptr)
+  {
+    const string redoFile = mRedoLog->FileName();
+
+    mRedoLog.reset();
+    RedoLog::RemoveFiles(redoFile);
+  }
+
   whf_remove(mFileName.c_str());
 }
 
@@ -539,6 +1001,8 @@ DBSInit(const DBSSettings& settings)
                        "DBS framework was already initialized.");
   }
   dbsMgrs_ = unique_make(DbsManager, settings);
+
+  TempMemoryBudget::ServerBudget().Limit(settings.mTempMemoryLimit);
 }
 
 
@@ -643,6 +1107,98 @@ DBSValidateDatabase(const char* const name, const char* path)
 }
 
 
+//The callback is a plain function with no context of its own, hence only one
+//database is repaired at a time.
+static FIX_ERROR_CALLBACK sFixCallback;
+static Lock               sFixCallbackSync;
+static Lock               sRepairSync;
+
+static bool
+serialized_fix_callback(const FIX_ERROR_CALLBACK_TYPE type, const char* const format, ...)
+{
+  char message[1024] = {0, };
+
+  if (format != nullptr)
+  {
+    va_list args;
+
+    va_start(args, format);
+    vsnprintf(message, sizeof message, format, args);
+    va_end(args);
+  }
+
+  LockGuard<Lock> _l(sFixCallbackSync);
+
+  return (format == nullptr)
+         ? sFixCallback(type, nullptr)
+         : sFixCallback(type, "%s", message);
+}
+
+
+struct TablesRepairJob
+{
+  TablesRepairJob(DbsHandler& dbs, const vector<string>& tablesNames, const char* const path)
+    : mDbs(dbs),
+      mTablesNames(tablesNames),
+      mPath(path),
+      mRowsThreads(1),
+      mNextTable(0),
+      mCheckedTables(0),
+      mFailed(false)
+  {
+  }
+
+  DbsHandler&             mDbs;
+  const vector<string>&   mTablesNames;
+  const string            mPath;
+  uint_t                  mRowsThreads;
+  volatile int32_t        mNextTable;
+  volatile int32_t        mCheckedTables;
+  volatile bool           mFailed;
+};
+
+
+static void
+repair_tables_routine(void* args)
+{
+  TablesRepairJob& job = *_RC(TablesRepairJob*, args);
+
+  while ( ! job.mFailed)
+  {
+    const uint_t table = wh_atomic_fetch_inc32(&job.mNextTable);
+    if (table >= job.mTablesNames.size())
+      break;
+
+    const string& tableName = job.mTablesNames[table];
+
+    serialized_fix_callback(STEP_INFO, " * Checking database table '%s' ...\n", tableName.c_str());
+    try
+    {
+      if ( ! PersistentTable::RepairTable(job.mDbs,
+                                          tableName,
+                                          job.mPath,
+                                          serialized_fix_callback,
+                                          job.mRowsThreads))
+      {
+        job.mFailed = true;
+      }
+    }
+    catch (...)
+    {
+      job.mFailed = true;
+    }
+
+    if (job.mFailed)
+      break;
+
+    serialized_fix_callback(PROGRESS_INFO,
+                            "%u of %u tables checked.",
+                            wh_atomic_fetch_inc32(&job.mCheckedTables) + 1,
+                            _SC(uint_t, job.mTablesNames.size()));
+  }
+}
+
+
 DBS_SHL bool
 DBSRepairDatabase(const char* const name, const char* path, FIX_ERROR_CALLBACK fixCallback)
 {
@@ -691,30 +1247,47 @@ DBSRepairDatabase(const char* const name, const char* path, FIX_ERROR_CALLBACK f
   inputFile.Write(buffer, fileSize);
   inputFile.Close();
 
-  IDBSHandler& dbs = DBSRetrieveDatabase(name, path);
   uint16_t tablesCount = load_le_int16(buffer + PS_DBS_NUM_TABLES_OFF);
   uint16_t actualCount = 0;
+
+  vector<string> tablesNames;
   const char* tableName = _RC(const char*, buffer + PS_DBS_HEADER_SIZE);
   while ((*tableName != 0) && (_SC(uint64_t, (_RC(const uint8_t*, tableName) - buffer)) < fileSize))
   {
     --tablesCount, ++actualCount;
 
-    fixCallback(STEP_INFO, " * Checking database table '%s' ...\n", tableName);
-    try
-    {
-      if ( ! PersistentTable::RepairTable(_SC(DbsHandler&, dbs), tableName, path, fixCallback))
-        return false;
-    }
-    catch (...)
-    {
-      DBSReleaseDatabase(dbs);
-      return false;
-    }
+    tablesNames.push_back(tableName);
+    tableName += strlen(tableName) + 1;
+  }
+
+  IDBSHandler& dbs = DBSRetrieveDatabase(name, path);
+
+  LockGuard<Lock> _l(sRepairSync);
+
+  sFixCallback = fixCallback;
+
+  TablesRepairJob job(_SC(DbsHandler&, dbs), tablesNames, path);
+
+  const uint_t threadsCount = MAX(dbsMgrs_->mDBSSettings.mCheckThreads, 1u);
+  const uint_t workersCount = MAX(MIN(threadsCount, _SC(uint_t, tablesNames.size())), 1u);
+
+  job.mRowsThreads = MAX(threadsCount / workersCount, 1u);
+
+  unique_ptr<Thread[]> workers(unique_array_make(Thread, workersCount));
+
+  for (uint_t i = 1; i < workersCount; ++i)
+    workers[i].Run(repair_tables_routine, &job);
+
+  repair_tables_routine(&job);
+
+  for (uint_t i = 1; i < workersCount; ++i)
+    workers[i].WaitToEnd(false);
 
-      tableName += strlen(tableName) + 1;
-    }
   DBSReleaseDatabase(dbs);
 
+  if (job.mFailed)
+    return false;
+
   if (tablesCount > 0)
   {
     bool fixError = fixCallback(FIX_QUESTION,
@@ -732,6 +1305,86 @@ DBSRepairDatabase(const char* const name, const char* path, FIX_ERROR_CALLBACK f
 }
 
 
+static void
+mark_database_not_closed(const string& fileName)
+{
+  uint8_t flags[sizeof(uint64_t)];
+
+  File dbFile(fileName.c_str(), WH_FILEOPEN_EXISTING | WH_FILERDWR);
+
+  dbFile.Seek(PS_DBS_FLAGS_OFF, WH_SEEK_BEGIN);
+  dbFile.Read(flags, sizeof flags);
+
+  store_le_int64((load_le_int64(flags) | PS_FLAG_NOT_CLOSED) & ~PS_FLAG_TO_RECOVER, flags);
+
+  dbFile.Seek(PS_DBS_FLAGS_OFF, WH_SEEK_BEGIN);
+  dbFile.Write(flags, sizeof flags);
+}
+
+
+DBS_SHL bool
+DBSRecoverDatabase(const char* const name, const char* path)
+{
+  if (dbsMgrs_.get() == nullptr)
+    throw DBSException(_EXTRA(DBSException::NOT_INITED), "DBS framework is not initialized.");
+
+  if (path == nullptr)
+    path = dbsMgrs_->mDBSSettings.mWorkDir.c_str();
+
+  const string fileName = string(path) + name + DBS_FILE_EXT;
+  {
+    uint8_t header[PS_DBS_HEADER_SIZE];
+
+    File dbFile(fileName.c_str(), WH_FILEOPEN_EXISTING | WH_FILERDWR);
+
+    if (dbFile.Size() < sizeof header)
+      return false;
+
+    dbFile.Seek(0, WH_SEEK_BEGIN);
+    dbFile.Read(header, sizeof header);
+
+    if (memcmp(header, DBS_FILE_SIGNATURE, PS_DBS_SIGNATURE_LEN) != 0)
+      return false;
+
+    const uint64_t headerFlags = load_le_int64(header + PS_DBS_FLAGS_OFF);
+    if ((headerFlags & PS_FLAG_NOT_CLOSED) == 0)
+      return true;
+
+    //Only a full repair helps if one was already started or if the updates
+    //done since the last checkpoint cannot be replayed.
+    if ((headerFlags & PS_FLAG_TO_REPAIR)
+        || ! RedoLog::CanReplay(string(path) + name + DBS_REDO_FILE_EXT))
+    {
+      return false;
+    }
+
+    store_le_int64(headerFlags | PS_FLAG_TO_RECOVER, header + PS_DBS_FLAGS_OFF);
+
+    dbFile.Seek(0, WH_SEEK_BEGIN);
+    dbFile.Write(header, sizeof header);
+  }
+
+  IDBSHandler* dbs = nullptr;
+  try
+  {
+    dbs = &DBSRetrieveDatabase(name, path);
+    _SC(DbsHandler*, dbs)->ReplayRedoLog();
+  }
+  catch (...)
+  {
+    if (dbs != nullptr)
+      DBSReleaseDatabase( *dbs);
+
+    mark_database_not_closed(fileName);
+    return false;
+  }
+
+  DBSReleaseDatabase( *dbs);
+
+  return true;
+}
+
+
 DBS_SHL IDBSHandler&
 DBSRetrieveDatabase(const char* const name, const char* path)
 {
@@ -845,6 +1498,13 @@ DBSRemoveDatabase(const char* const name, const char* path)
 }
 
 
+DBS_SHL DBSTempMemoryStats
+DBSGetTempMemoryStats()
+{
+  return TempMemoryBudget::ServerBudget().Stats();
+}
+
+
 DBS_SHL const char*
 DescribeDbsEngineVersion()
 {
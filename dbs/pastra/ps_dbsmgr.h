@@ -26,6 +26,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PS_DBSMGR_H_
 
 #include <map>
+#include <memory>
+#include <vector>
 #include <string.h>
 
 #include "utils/wthread.h"
@@ -40,6 +42,7 @@ namespace pastra {
 
 //Forward declarations
 class PersistentTable;
+class RedoLog;
 class DbsHandler;
 struct DbsManager;
 
@@ -61,9 +64,14 @@ public:
                        const FIELD_INDEX           fieldsCount,
                        DBSFieldDescriptor* const   inoutFields) override;
   virtual void DeleteTable(const char* const name) override;
+  virtual void AddTableField(const char* const name, const DBSFieldDescriptor& field) override;
+  virtual void RetypeTableField(const char* const      name,
+                                const char* const      field,
+                                const DBS_FIELD_TYPE   type) override;
   virtual void SyncAllTablesContent() override;
   virtual void SyncTableContent(const TABLE_INDEX index) override;
   virtual bool NotifyDatabaseUpdate(const bool tryDbLock) override;
+  virtual void CommitUpdates() override;
 
   virtual ITable& CreateTempTable(const FIELD_INDEX fieldsCount, DBSFieldDescriptor* inoutFields) override;
   virtual const char* TableName(const TABLE_INDEX index) override;
@@ -75,6 +83,11 @@ public:
   const std::string& TemporalDir() const { return mGlbSettings.mTempDir; }
   uint64_t MaxFileSize() const { return mGlbSettings.mMaxFileSize; }
   const DBSSettings& Settings() const { return mGlbSettings; }
+  RedoLog* GetRedoLog() { return mRedoLog.get(); }
+
+  //Brings the tables up to date with the updates logged since the last
+  //checkpoint. Used when the database was not properly closed.
+  void ReplayRedoLog();
 
   bool HasUnreleasedTables();
   void RegisterTableSpawn();
@@ -84,13 +97,24 @@ private:
   using TABLES = std::map<std::string, PersistentTable*>;
 
   void SyncToFile();
+  void Checkpoint();
+  void CheckpointTable(const std::string& name);
+  void CheckpointPause();
+  void UnpinTable();
+  void WaitTableUnpin(const ITable* const table);
+  PersistentTable& PinTableToAlter(const char* const name, bool* const outOpened);
+  void ReleaseAlteredTable(const bool opened);
 
   const DBSSettings&   mGlbSettings;
   Lock                 mSync;
+  Lock                 mCheckpointSync;
+  Condition            mUnpinned;
+  PersistentTable*     mPinnedTable;
   const std::string    mDbsLocationDir;
   const std::string    mFileName;
   File                 mFile;
   TABLES               mTables;
+  std::unique_ptr<RedoLog> mRedoLog;
   int                  mCreatedTemporalTables;
   bool                 mNeedsSync;
 };
@@ -121,7 +145,8 @@ struct DbsManager
         || mDBSSettings.mTableCacheBlkCount == 0
         || mDBSSettings.mVLStoreCacheBlkSize == 0
         || mDBSSettings.mVLStoreCacheBlkCount == 0
-        || mDBSSettings.mVLValueCacheSize == 0)
+        || mDBSSettings.mVLValueCacheSize == 0
+        || mDBSSettings.mCheckpointBatch == 0)
     {
       throw DBSException(_EXTRA(DBSException::BAD_PARAMETERS),
           "Cannot create a database manager with the specified parameters.");
@@ -0,0 +1,718 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+#include <string.h>
+#include <map>
+
+#include "dbs/dbs_exception.h"
+#include "utils/endianness.h"
+#include "utils/wthread.h"
+
+#include "ps_exporter.h"
+#include "ps_serializer.h"
+#include "ps_templatetable.h"
+#include "ps_varstorage.h"
+
+
+using namespace std;
+
+
+namespace whais {
+namespace pastra {
+
+
+static const uint32_t EXPORT_MAGIC = 0x534C4F43; //'COLS'
+static const uint16_t EXPORT_VERSION = 1;
+static const ROW_INDEX EXPORT_GROUP_ROWS = 64 * 1024;
+
+static const uint64_t ROW_VALUE_INLINE = 0x80;
+static const uint64_t TEXT_RECORD_HEADER = 3 * sizeof(uint32_t);
+static const uint64_t ARRAY_RECORD_HEADER = sizeof(uint64_t);
+
+
+struct ColumnsExporter::EncodeJob
+{
+  EncodeJob(ColumnsExporter& exporter)
+    : mExporter(exporter),
+      mNextColumn(0),
+      mFailed(false),
+      mErrorCode(0)
+  {
+  }
+
+  void Fail(const uint32_t code, const string& message)
+  {
+    LockGuard<Lock> _l(mSync);
+
+    if (mFailed)
+      return;
+
+    mErrorCode = code;
+    mError = message;
+    mFailed = true;
+  }
+
+  ColumnsExporter&      mExporter;
+  volatile int64_t      mNextColumn;
+  volatile bool         mFailed;
+  uint32_t              mErrorCode;
+  string                mError;
+  Lock                  mSync;
+};
+
+
+static inline void
+append_le(vector<uint8_t>& out, const uint64_t value, const uint_t size)
+{
+  for (uint_t i = 0; i < size; ++i)
+    out.push_back((value >> (8 * i)) & 0xFF);
+}
+
+
+static inline uint_t
+leb128_size(uint64_t value)
+{
+  uint_t result = 1;
+
+  while (value >= 0x80)
+    value >>= 7, ++result;
+
+  return result;
+}
+
+
+static inline void
+append_leb128(vector<uint8_t>& out, uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    out.push_back((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+
+  out.push_back(value);
+}
+
+
+static inline uint64_t
+zigzag(const int64_t value)
+{
+  return (_SC(uint64_t, value) << 1) ^ _SC(uint64_t, value >> 63);
+}
+
+
+static int64_t
+days_since_epoch(int64_t year, const uint_t month, const uint_t day)
+{
+  year -= (month <= 2) ? 1 : 0;
+
+  const int64_t era = ((year >= 0) ? year : (year - 399)) / 400;
+  const uint64_t yoe = year - era * 400;
+  const uint64_t doy = (153 * ((month > 2) ? (month - 3) : (month + 9)) + 2) / 5 + day - 1;
+  const uint64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+
+  return era * 146097 + _SC(int64_t, doe) - 719468;
+}
+
+
+static int64_t
+value_ordinal(const DBool& value)
+{
+  return value.mValue ? 1 : 0;
+}
+
+
+static int64_t
+value_ordinal(const DChar& value)
+{
+  return value.mValue;
+}
+
+
+static int64_t
+value_ordinal(const DDate& value)
+{
+  return days_since_epoch(value.mYear, value.mMonth, value.mDay);
+}
+
+
+static int64_t
+value_ordinal(const DDateTime& value)
+{
+  return days_since_epoch(value.mYear, value.mMonth, value.mDay) * 86400
+         + value.mHour * 3600 + value.mMinutes * 60 + value.mSeconds;
+}
+
+
+static int64_t
+value_ordinal(const DHiresTime& value)
+{
+  const int64_t seconds = days_since_epoch(value.mYear, value.mMonth, value.mDay) * 86400
+                          + value.mHour * 3600 + value.mMinutes * 60 + value.mSeconds;
+
+  return seconds * 1000000 + value.mMicrosec;
+}
+
+
+template<typename T> static int64_t
+value_ordinal(const T& value)
+{
+  return _SC(int64_t, value.mValue);
+}
+
+
+template<typename T> static void
+load_ordinals(const vector<uint8_t>&   values,
+              const uint_t             valueSize,
+              vector<int64_t>&         outOrdinals)
+{
+  outOrdinals.clear();
+  for (size_t offset = 0; offset < values.size(); offset += valueSize)
+  {
+    T value;
+
+    Serializer::Load(values.data() + offset, &value);
+    outOrdinals.push_back(value_ordinal(value));
+  }
+}
+
+
+//Returns false if the values of this type are not encoded with deltas.
+static bool
+values_ordinals(const DBS_FIELD_TYPE     type,
+                const vector<uint8_t>&   values,
+                const uint_t             valueSize,
+                vector<int64_t>&         outOrdinals)
+{
+  switch (type)
+  {
+  case T_BOOL:
+    load_ordinals<DBool>(values, valueSize, outOrdinals);
+    break;
+
+  case T_CHAR:
+    load_ordinals<DChar>(values, valueSize, outOrdinals);
+    break;
+
+  case T_DATE:
+    load_ordinals<DDate>(values, valueSize, outOrdinals);
+    break;
+
+  case T_DATETIME:
+    load_ordinals<DDateTime>(values, valueSize, outOrdinals);
+    break;
+
+  case T_HIRESTIME:
+    load_ordinals<DHiresTime>(values, valueSize, outOrdinals);
+    break;
+
+  case T_INT8:
+    load_ordinals<DInt8>(values, valueSize, outOrdinals);
+    break;
+
+  case T_INT16:
+    load_ordinals<DInt16>(values, valueSize, outOrdinals);
+    break;
+
+  case T_INT32:
+    load_ordinals<DInt32>(values, valueSize, outOrdinals);
+    break;
+
+  case T_INT64:
+    load_ordinals<DInt64>(values, valueSize, outOrdinals);
+    break;
+
+  case T_UINT8:
+    load_ordinals<DUInt8>(values, valueSize, outOrdinals);
+    break;
+
+  case T_UINT16:
+    load_ordinals<DUInt16>(values, valueSize, outOrdinals);
+    break;
+
+  case T_UINT32:
+    load_ordinals<DUInt32>(values, valueSize, outOrdinals);
+    break;
+
+  case T_UINT64:
+    load_ordinals<DUInt64>(values, valueSize, outOrdinals);
+    break;
+
+  default:
+    return false;
+  }
+
+  return true;
+}
+
+
+static uint64_t
+deltas_size(const vector<int64_t>& ordinals)
+{
+  uint64_t result = 0;
+  int64_t previous = 0;
+
+  for (auto ordinal : ordinals)
+  {
+    result += leb128_size(zigzag(_SC(int64_t, _SC(uint64_t, ordinal) - previous)));
+    previous = ordinal;
+  }
+
+  return result;
+}
+
+
+static void
+append_deltas(vector<uint8_t>& out, const vector<int64_t>& ordinals)
+{
+  int64_t previous = 0;
+
+  for (auto ordinal : ordinals)
+  {
+    append_leb128(out, zigzag(_SC(int64_t, _SC(uint64_t, ordinal) - previous)));
+    previous = ordinal;
+  }
+}
+
+
+//Starts a column, returning where its content begins (its size is kept just
+//before it).
+static size_t
+begin_column(vector<uint8_t>& out, const DBS_EXPORT_ENCODING encoding)
+{
+  out.push_back(encoding);
+  append_le(out, 0, sizeof(uint64_t));
+
+  return out.size();
+}
+
+
+static void
+end_column(vector<uint8_t>& out, const size_t contentStart)
+{
+  store_le_int64(out.size() - contentStart, out.data() + contentStart - sizeof(uint64_t));
+}
+
+
+
+ColumnsExporter::ColumnsExporter(const char* const              file,
+                                 const FieldDescriptor* const   tableFields,
+                                 const FIELD_INDEX* const       fields,
+                                 const char* const* const       names,
+                                 const FIELD_INDEX              fieldsCount,
+                                 const uint_t                   rowSize,
+                                 VariableSizeStore* const       vsStore,
+                                 const uint_t                   threadsCount)
+  : mFile(file, WH_FILECREATE | WH_FILETRUNC | WH_FILEWRITE),
+    mTableFields(tableFields),
+    mFields(fields, fields + fieldsCount),
+    mRowSize(rowSize),
+    mVSStore(vsStore),
+    mThreadsCount(MAX(threadsCount, 1u)),
+    mColumnsData(fieldsCount),
+    mExportedRows(0)
+{
+  mGroupRows.reserve(_SC(uint64_t, EXPORT_GROUP_ROWS) * mRowSize);
+  WriteHeader(names);
+}
+
+
+void
+ColumnsExporter::AddRow(const ROW_INDEX row, const uint8_t* const rowData)
+{
+  mGroupRows.insert(mGroupRows.end(), rowData, rowData + mRowSize);
+  mGroupRowsIndexes.push_back(row);
+
+  if (mGroupRowsIndexes.size() >= EXPORT_GROUP_ROWS)
+    WriteGroup();
+}
+
+
+uint64_t
+ColumnsExporter::Finish()
+{
+  if ( ! mGroupRowsIndexes.empty())
+    WriteGroup();
+
+  vector<uint8_t> end;
+
+  append_le(end, 0, sizeof(uint32_t));
+  append_le(end, mExportedRows, sizeof(uint64_t));
+  WriteData(end.data(), end.size());
+
+  return mExportedRows;
+}
+
+
+void
+ColumnsExporter::WriteHeader(const char* const* const names)
+{
+  vector<uint8_t> header;
+
+  append_le(header, EXPORT_MAGIC, sizeof(uint32_t));
+  append_le(header, EXPORT_VERSION, sizeof(uint16_t));
+  append_le(header, mFields.size(), sizeof(uint16_t));
+
+  for (size_t c = 0; c < mFields.size(); ++c)
+  {
+    const FieldDescriptor& fd = mTableFields[mFields[c]];
+    const uint_t type = GET_BASE_TYPE(fd.Type()) | (IS_ARRAY(fd.Type()) ? T_ARRAY_MASK : 0);
+    const uint_t nameSize = strlen(names[c]);
+
+    append_le(header, type, sizeof(uint16_t));
+    append_le(header, nameSize, sizeof(uint16_t));
+    header.insert(header.end(), names[c], names[c] + nameSize);
+  }
+
+  WriteData(header.data(), header.size());
+}
+
+
+void
+ColumnsExporter::WriteGroup()
+{
+  vector<uint8_t> rowsColumn;
+
+  append_le(rowsColumn, mGroupRowsIndexes.size(), sizeof(uint32_t));
+  EncodeRowsColumn(rowsColumn);
+
+  EncodeJob job(*this);
+
+  const uint_t workersCount = MIN(mThreadsCount, mFields.size()) - 1;
+  unique_ptr<Thread[]> workers(unique_array_make(Thread, workersCount));
+
+  for (uint_t i = 0; i < workersCount; ++i)
+    workers[i].Run(encode_columns_routine, &job);
+
+  encode_columns_routine(&job);
+
+  for (uint_t i = 0; i < workersCount; ++i)
+    workers[i].WaitToEnd(false);
+
+  if (job.mFailed)
+    throw DBSException(_EXTRA(job.mErrorCode), "%s", job.mError.c_str());
+
+  WriteData(rowsColumn.data(), rowsColumn.size());
+  for (auto& column : mColumnsData)
+  {
+    WriteData(column.data(), column.size());
+    column.clear();
+  }
+
+  mExportedRows += mGroupRowsIndexes.size();
+  mGroupRowsIndexes.clear();
+  mGroupRows.clear();
+}
+
+
+void
+ColumnsExporter::WriteData(const uint8_t* data, uint64_t size)
+{
+  while (size > 0)
+  {
+    const uint_t chunk = MIN(size, 0x40000000ull);
+
+    mFile.Write(data, chunk);
+    data += chunk, size -= chunk;
+  }
+}
+
+
+void
+ColumnsExporter::EncodeRowsColumn(vector<uint8_t>& out)
+{
+  vector<int64_t> ordinals(mGroupRowsIndexes.begin(), mGroupRowsIndexes.end());
+
+  const size_t content = begin_column(out, EXPORT_DELTA);
+  append_deltas(out, ordinals);
+  end_column(out, content);
+}
+
+
+void
+ColumnsExporter::EncodeColumn(const FIELD_INDEX column, vector<uint8_t>& out)
+{
+  const FieldDescriptor& fd = mTableFields[mFields[column]];
+
+  out.clear();
+  if (IS_ARRAY(fd.Type()))
+    EncodeArrayColumn(fd, out);
+
+  else if (GET_BASE_TYPE(fd.Type()) == T_TEXT)
+    EncodeTextColumn(fd, out);
+
+  else
+    EncodeBasicColumn(fd, out);
+}
+
+
+//Adds the column's null bits and returns the rows having a value.
+static vector<const uint8_t*>
+append_nulls(vector<uint8_t>&          out,
+             const FieldDescriptor&    field,
+             const vector<uint8_t>&    rows,
+             const uint_t              rowSize)
+{
+  const uint_t bit = field.NullBitIndex();
+  const size_t rowsCount = rows.size() / rowSize;
+  const size_t nullsStart = out.size();
+
+  vector<const uint8_t*> result;
+
+  out.resize(nullsStart + (rowsCount + 7) / 8, 0);
+  for (size_t row = 0; row < rowsCount; ++row)
+  {
+    const uint8_t* const rowData = rows.data() + row * rowSize;
+
+    if (rowData[bit / 8] & (1 << (bit % 8)))
+      out[nullsStart + row / 8] |= 1 << (row % 8);
+
+    else
+      result.push_back(rowData);
+  }
+
+  return result;
+}
+
+
+void
+ColumnsExporter::EncodeBasicColumn(const FieldDescriptor& field, vector<uint8_t>& out)
+{
+  const DBS_FIELD_TYPE type = _SC(DBS_FIELD_TYPE, GET_BASE_TYPE(field.Type()));
+  const uint_t valueSize = Serializer::Size(type, false);
+
+  vector<uint8_t> nulls;
+  const vector<const uint8_t*> rows = append_nulls(nulls, field, mGroupRows, mRowSize);
+
+  vector<uint8_t> values;
+  uint64_t runsCount = 0;
+
+  values.reserve(rows.size() * valueSize);
+  for (size_t i = 0; i < rows.size(); ++i)
+  {
+    const uint8_t* const value = rows[i] + field.RowDataOff();
+
+    if ((i == 0) || (memcmp(value, values.data() + (i - 1) * valueSize, valueSize) != 0))
+      ++runsCount;
+
+    values.insert(values.end(), value, value + valueSize);
+  }
+
+  const uint64_t plainSize = values.size();
+  const uint64_t rleSize = runsCount * (sizeof(uint32_t) + valueSize);
+
+  vector<int64_t> ordinals;
+  const bool useDeltas = values_ordinals(type, values, valueSize, ordinals)
+                         && (deltas_size(ordinals) < MIN(plainSize, rleSize));
+
+  if (useDeltas)
+  {
+    const size_t content = begin_column(out, EXPORT_DELTA);
+
+    out.insert(out.end(), nulls.begin(), nulls.end());
+    append_deltas(out, ordinals);
+    end_column(out, content);
+  }
+  else if (rleSize < plainSize)
+  {
+    const size_t content = begin_column(out, EXPORT_RLE);
+
+    out.insert(out.end(), nulls.begin(), nulls.end());
+    for (size_t i = 0; i < rows.size();)
+    {
+      const uint8_t* const value = values.data() + i * valueSize;
+
+      size_t runEnd = i + 1;
+      while ((runEnd < rows.size())
+             && (memcmp(value, values.data() + runEnd * valueSize, valueSize) == 0))
+      {
+        ++runEnd;
+      }
+
+      append_le(out, runEnd - i, sizeof(uint32_t));
+      out.insert(out.end(), value, value + valueSize);
+
+      i = runEnd;
+    }
+    end_column(out, content);
+  }
+  else
+  {
+    const size_t content = begin_column(out, EXPORT_PLAIN);
+
+    out.insert(out.end(), nulls.begin(), nulls.end());
+    out.insert(out.end(), values.begin(), values.end());
+    end_column(out, content);
+  }
+}
+
+
+void
+ColumnsExporter::EncodeTextColumn(const FieldDescriptor& field, vector<uint8_t>& out)
+{
+  vector<uint8_t> nulls;
+  const vector<const uint8_t*> rows = append_nulls(nulls, field, mGroupRows, mRowSize);
+
+  map<string, uint32_t> dictionary;
+  vector<uint32_t> indexes;
+  vector<uint8_t> text;
+  uint64_t plainSize = 0, dictionarySize = sizeof(uint32_t);
+
+  indexes.reserve(rows.size());
+  for (auto rowData : rows)
+  {
+    LoadStoredValue(field, rowData, TEXT_RECORD_HEADER, text);
+
+    const uint32_t newIndex = dictionary.size();
+    auto entry = dictionary.insert(make_pair(string(_RC(const char*, text.data()), text.size()),
+                                             newIndex));
+    if (entry.second)
+      dictionarySize += sizeof(uint32_t) + text.size();
+
+    indexes.push_back(entry.first->second);
+    dictionarySize += leb128_size(entry.first->second);
+    plainSize += sizeof(uint32_t) + text.size();
+  }
+
+  vector<const string*> values(dictionary.size());
+  for (auto& entry : dictionary)
+    values[entry.second] = &entry.first;
+
+  if (dictionarySize < plainSize)
+  {
+    const size_t content = begin_column(out, EXPORT_DICTIONARY);
+
+    out.insert(out.end(), nulls.begin(), nulls.end());
+    append_le(out, values.size(), sizeof(uint32_t));
+    for (auto value : values)
+    {
+      append_le(out, value->size(), sizeof(uint32_t));
+      out.insert(out.end(), value->begin(), value->end());
+    }
+
+    for (auto index : indexes)
+      append_leb128(out, index);
+
+    end_column(out, content);
+  }
+  else
+  {
+    const size_t content = begin_column(out, EXPORT_PLAIN);
+
+    out.insert(out.end(), nulls.begin(), nulls.end());
+    for (auto index : indexes)
+    {
+      append_le(out, values[index]->size(), sizeof(uint32_t));
+      out.insert(out.end(), values[index]->begin(), values[index]->end());
+    }
+    end_column(out, content);
+  }
+}
+
+
+void
+ColumnsExporter::EncodeArrayColumn(const FieldDescriptor& field, vector<uint8_t>& out)
+{
+  const DBS_FIELD_TYPE type = _SC(DBS_FIELD_TYPE, GET_BASE_TYPE(field.Type()));
+  const uint_t itemSize = Serializer::Size(type, false);
+
+  vector<uint8_t> nulls;
+  const vector<const uint8_t*> rows = append_nulls(nulls, field, mGroupRows, mRowSize);
+
+  const size_t content = begin_column(out, EXPORT_PLAIN);
+
+  out.insert(out.end(), nulls.begin(), nulls.end());
+
+  vector<uint8_t> items;
+  for (auto rowData : rows)
+  {
+    LoadStoredValue(field, rowData, ARRAY_RECORD_HEADER, items);
+
+    append_le(out, items.size() / itemSize, sizeof(uint32_t));
+    out.insert(out.end(), items.begin(), items.end());
+  }
+  end_column(out, content);
+}
+
+
+void
+ColumnsExporter::LoadStoredValue(const FieldDescriptor&   field,
+                                 const uint8_t* const     rowData,
+                                 const uint64_t           recordHeader,
+                                 vector<uint8_t>&         out)
+{
+  const uint8_t* const fieldData = rowData + field.RowDataOff();
+  const uint64_t valueSize = load_le_int64(fieldData + sizeof(uint64_t));
+
+  if ((valueSize >> 56) & ROW_VALUE_INLINE)
+  {
+    const uint_t size = (valueSize >> 56) & ~ROW_VALUE_INLINE;
+
+    out.assign(fieldData, fieldData + size);
+    return;
+  }
+
+  assert(valueSize >= recordHeader);
+
+  out.resize(valueSize - recordHeader);
+  if ( ! out.empty())
+    mVSStore->GetRecord(load_le_int64(fieldData), recordHeader, out.size(), out.data());
+}
+
+
+void
+ColumnsExporter::encode_columns_routine(void* args)
+{
+  EncodeJob& job = *_RC(EncodeJob*, args);
+  ColumnsExporter& exporter = job.mExporter;
+
+  try
+  {
+    while ( ! job.mFailed)
+    {
+      const int64_t column = wh_atomic_fetch_inc64(&job.mNextColumn);
+      if (column >= _SC(int64_t, exporter.mFields.size()))
+        break;
+
+      exporter.EncodeColumn(column, exporter.mColumnsData[column]);
+    }
+  }
+  catch (const DBSException& e)
+  {
+    job.Fail(e.Code(), e.Message());
+  }
+  catch (const Exception& e)
+  {
+    job.Fail(DBSException::GENERAL_CONTROL_ERROR, e.Message());
+  }
+  catch (...)
+  {
+    job.Fail(DBSException::GENERAL_CONTROL_ERROR, "Failed to encode the exported columns.");
+  }
+}
+
+
+} //namespace pastra
+} //namespace whais
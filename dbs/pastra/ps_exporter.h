@@ -0,0 +1,100 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef PS_EXPORTER_H_
+#define PS_EXPORTER_H_
+
+#include <string>
+#include <vector>
+
+#include "utils/wfile.h"
+#include "dbs/dbs_table.h"
+
+
+namespace whais {
+namespace pastra {
+
+
+class FieldDescriptor;
+class VariableSizeStore;
+
+
+/* Writes the rows of a table to a columnar file (see DBS_EXPORT_ENCODING).
+ * The rows are gathered in groups; the columns of a group are encoded by
+ * several threads at once, each with the encoding that keeps it smaller. */
+class ColumnsExporter
+{
+public:
+  ColumnsExporter(const char* const              file,
+                  const FieldDescriptor* const   tableFields,
+                  const FIELD_INDEX* const       fields,
+                  const char* const* const       names,
+                  const FIELD_INDEX              fieldsCount,
+                  const uint_t                   rowSize,
+                  VariableSizeStore* const       vsStore,
+                  const uint_t                   threadsCount);
+
+  ColumnsExporter(const ColumnsExporter&) = delete;
+  ColumnsExporter& operator= (const ColumnsExporter&) = delete;
+
+  void AddRow(const ROW_INDEX row, const uint8_t* const rowData);
+
+  //Writes the rows left and the file end. Returns the count of written rows.
+  uint64_t Finish();
+
+private:
+  struct EncodeJob;
+
+  void WriteHeader(const char* const* const names);
+  void WriteGroup();
+  void WriteData(const uint8_t* data, uint64_t size);
+  void EncodeRowsColumn(std::vector<uint8_t>& out);
+  void EncodeColumn(const FIELD_INDEX column, std::vector<uint8_t>& out);
+  void EncodeBasicColumn(const FieldDescriptor& field, std::vector<uint8_t>& out);
+  void EncodeTextColumn(const FieldDescriptor& field, std::vector<uint8_t>& out);
+  void EncodeArrayColumn(const FieldDescriptor& field, std::vector<uint8_t>& out);
+  void LoadStoredValue(const FieldDescriptor&   field,
+                       const uint8_t* const     rowData,
+                       const uint64_t           recordHeader,
+                       std::vector<uint8_t>&    out);
+
+  static void encode_columns_routine(void* args);
+
+  File                                  mFile;
+  const FieldDescriptor* const          mTableFields;
+  std::vector<FIELD_INDEX>              mFields;
+  const uint_t                          mRowSize;
+  VariableSizeStore* const              mVSStore;
+  const uint_t                          mThreadsCount;
+  std::vector<uint8_t>                  mGroupRows;
+  std::vector<ROW_INDEX>                mGroupRowsIndexes;
+  std::vector<std::vector<uint8_t>>     mColumnsData;
+  uint64_t                              mExportedRows;
+};
+
+
+} //namespace pastra
+} //namespace whais
+
+#endif /* PS_EXPORTER_H_ */
@@ -0,0 +1,246 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+
+#include "dbs/dbs_valtranslator.h"
+#include "utils/whash.h"
+
+#include "ps_fieldstats.h"
+#include "ps_serializer.h"
+#include "ps_templatetable.h"
+
+
+using namespace std;
+
+
+namespace whais {
+namespace pastra {
+
+
+static const uint64_t STATS_SAMPLE_SIZE       = 0x4000;
+static const uint_t   STATS_HISTOGRAM_BUCKETS = 64;
+
+
+
+HyperLogLog::HyperLogLog()
+{
+  memset(mRegisters, 0, sizeof mRegisters);
+}
+
+
+void
+HyperLogLog::Add(const uint8_t* const value, const uint_t size)
+{
+  //Spread the hash bits, as the registers use the highest ones.
+  uint64_t hash = wh_hash(value, size);
+
+  hash ^= hash >> 33;
+  hash *= 0xFF51AFD7ED558CCDull;
+  hash ^= hash >> 33;
+  hash *= 0xC4CEB9FE1A85EC53ull;
+  hash ^= hash >> 33;
+
+  const uint_t reg = hash >> (64 - REGISTERS_BITS);
+
+  uint8_t rank = 1;
+  for (hash <<= REGISTERS_BITS; ((hash & (1ull << 63)) == 0) && (rank <= 64 - REGISTERS_BITS); hash <<= 1)
+    ++rank;
+
+  mRegisters[reg] = MAX(mRegisters[reg], rank);
+}
+
+
+uint64_t
+HyperLogLog::Estimate() const
+{
+  double sum = 0;
+  uint_t zeros = 0;
+
+  for (uint_t i = 0; i < REGISTERS_COUNT; ++i)
+  {
+    sum += ldexp(1.0, -mRegisters[i]);
+    zeros += (mRegisters[i] == 0) ? 1 : 0;
+  }
+
+  const double m = REGISTERS_COUNT;
+  double result = (0.7213 / (1 + 1.079 / m)) * m * m / sum;
+
+  //Small cardinalities are better estimated by the count of empty registers.
+  if ((result <= 2.5 * m) && (zeros > 0))
+    result = m * log(m / zeros);
+
+  return _SC(uint64_t, result + 0.5);
+}
+
+
+
+FieldStatsCollector::FieldStatsCollector(const FieldDescriptor& field,
+                                         const ROW_INDEX        rowsCount)
+  : mField(field),
+    mRowsCount(0),
+    mNullsCount(0),
+    mSampleStep(MAX(1, rowsCount / STATS_SAMPLE_SIZE)),
+    mValueSize(0)
+{
+  if ( ! IS_ARRAY(mField.Type()) && (GET_BASE_TYPE(mField.Type()) != T_TEXT))
+    mValueSize = Serializer::Size(_SC(DBS_FIELD_TYPE, GET_BASE_TYPE(mField.Type())), false);
+}
+
+
+void
+FieldStatsCollector::AddRow(const uint8_t* const rowData)
+{
+  const uint_t bit = mField.NullBitIndex();
+
+  ++mRowsCount;
+  if (rowData[bit / 8] & (1 << (bit % 8)))
+  {
+    ++mNullsCount;
+    return;
+  }
+  else if (mValueSize == 0)
+    return;
+
+  const uint8_t* const value = rowData + mField.RowDataOff();
+
+  mDistinct.Add(value, mValueSize);
+  if (((mRowsCount - mNullsCount) % mSampleStep) == 0)
+    mSample.insert(mSample.end(), value, value + mValueSize);
+}
+
+
+template<class T> static void
+build_histogram(const vector<uint8_t>&    sample,
+                const uint_t              valueSize,
+                vector<string>&           outHistogram)
+{
+  vector<T> values(sample.size() / valueSize);
+
+  for (size_t i = 0; i < values.size(); ++i)
+    Serializer::Load(sample.data() + i * valueSize, &values[i]);
+
+  sort(values.begin(), values.end());
+
+  const size_t buckets = MIN(values.size(), STATS_HISTOGRAM_BUCKETS);
+  for (size_t b = 1; b <= buckets; ++b)
+  {
+    uint8_t text[128];
+    const T& bound = values[b * values.size() / buckets - 1];
+
+    //The written size counts the text's ending zero too.
+    const uint_t size = Utf8Translator::Write(text, sizeof text, bound);
+    outHistogram.push_back(string(_RC(const char*, text), size > 0 ? size - 1 : 0));
+  }
+}
+
+
+DBSFieldStats
+FieldStatsCollector::Result()
+{
+  DBSFieldStats result;
+
+  result.mRowsCount  = mRowsCount;
+  result.mNullsCount = mNullsCount;
+
+  if (mValueSize == 0)
+    return result;
+
+  result.mDistinctCount = MIN(mDistinct.Estimate(), mRowsCount - mNullsCount);
+
+  switch (GET_BASE_TYPE(mField.Type()))
+  {
+  case T_BOOL:
+    build_histogram<DBool>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_CHAR:
+    build_histogram<DChar>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_DATE:
+    build_histogram<DDate>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_DATETIME:
+    build_histogram<DDateTime>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_HIRESTIME:
+    build_histogram<DHiresTime>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_INT8:
+    build_histogram<DInt8>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_INT16:
+    build_histogram<DInt16>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_INT32:
+    build_histogram<DInt32>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_INT64:
+    build_histogram<DInt64>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_UINT8:
+    build_histogram<DUInt8>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_UINT16:
+    build_histogram<DUInt16>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_UINT32:
+    build_histogram<DUInt32>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_UINT64:
+    build_histogram<DUInt64>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_REAL:
+    build_histogram<DReal>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  case T_RICHREAL:
+    build_histogram<DRichReal>(mSample, mValueSize, result.mHistogram);
+    break;
+
+  default:
+    assert(false);
+  }
+
+  return result;
+}
+
+
+} //namespace pastra
+} //namespace whais
@@ -0,0 +1,82 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef PS_FIELDSTATS_H_
+#define PS_FIELDSTATS_H_
+
+#include <vector>
+
+#include "dbs/dbs_table.h"
+
+
+namespace whais {
+namespace pastra {
+
+
+class FieldDescriptor;
+
+
+//Estimates the count of the distinct values it was given, in a fixed space.
+class HyperLogLog
+{
+public:
+  HyperLogLog();
+
+  void Add(const uint8_t* const value, const uint_t size);
+  uint64_t Estimate() const;
+
+private:
+  static const uint_t REGISTERS_BITS  = 12;
+  static const uint_t REGISTERS_COUNT = 1 << REGISTERS_BITS;
+
+  uint8_t   mRegisters[REGISTERS_COUNT];
+};
+
+
+/* Gathers the statistics of a field from its table's rows. Every value is
+ * counted, while only an evenly spread sample of them is kept to build the
+ * histogram. */
+class FieldStatsCollector
+{
+public:
+  FieldStatsCollector(const FieldDescriptor& field, const ROW_INDEX rowsCount);
+
+  void AddRow(const uint8_t* const rowData);
+  DBSFieldStats Result();
+
+private:
+  const FieldDescriptor&  mField;
+  HyperLogLog             mDistinct;
+  std::vector<uint8_t>    mSample;
+  uint64_t                mRowsCount;
+  uint64_t                mNullsCount;
+  uint64_t                mSampleStep;
+  uint_t                  mValueSize;
+};
+
+
+} //namespace pastra
+} //namespace whais
+
+#endif /* PS_FIELDSTATS_H_ */
@@ -0,0 +1,516 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+#include <string.h>
+
+#include "utils/endianness.h"
+
+#include "dbs_exception.h"
+#include "ps_hashindex.h"
+
+
+using namespace std;
+
+
+namespace whais {
+namespace pastra {
+
+
+static const uint32_t NIL_PAGE = 0;
+
+//The header page layout.
+static const uint_t HDR_LEVEL_OFF       = 0;
+static const uint_t HDR_NEXT_SPLIT_OFF  = 4;
+static const uint_t HDR_ENTRIES_OFF     = 8;
+static const uint_t HDR_FREE_PAGE_OFF   = 16;
+static const uint_t HDR_MAP_PAGE_OFF    = 20;
+static const uint_t HDR_BUCKETS_OFF     = 24;
+static const uint_t HDR_SIZE            = 28;
+
+//A bucket page starts with its entries count and its overflow page. A map
+//page starts with its entries count too, followed by its next map page.
+static const uint_t PAGE_COUNT_OFF      = 0;
+static const uint_t PAGE_NEXT_OFF       = 4;
+static const uint_t PAGE_DATA_OFF       = 8;
+
+static const uint_t ENTRY_SIZE          = 12;
+
+//Split a bucket when the buckets are, on average, filled above this.
+static const uint_t SPLIT_FILL_PERCENT  = 75;
+
+
+
+FieldHashIndex::FieldHashIndex(unique_ptr<IDataContainer>&   container,
+                               const uint_t                  pageSize,
+                               const bool                    create)
+  : mPageSize(pageSize),
+    mContainer(container.release()),
+    mPage(new uint8_t[pageSize]),
+    mEntriesCount(0),
+    mLevel(0),
+    mNextSplit(0),
+    mFirstFreePage(NIL_PAGE),
+    mMapPage(NIL_PAGE),
+    mModified(false)
+{
+  if ((mPageSize < HDR_SIZE) || (PageEntries() < 2))
+    throw DBSException(_EXTRA(DBSException::INVALID_PARAMETERS));
+
+  if (create)
+  {
+    memset(mPage.get(), 0, mPageSize);
+    mContainer->Write(0, mPageSize, mPage.get());
+
+    mBucketsPages.push_back(AllocatePage());
+    mModified = true;
+
+    Flush();
+  }
+  else
+    LoadBucketsMap();
+}
+
+
+FieldHashIndex::~FieldHashIndex()
+{
+  Flush();
+}
+
+
+void
+FieldHashIndex::Insert(const uint64_t hash, const ROW_INDEX row)
+{
+  PAGE_INDEX page = mBucketsPages[BucketOf(hash)];
+
+  while (true)
+  {
+    ReadPage(page, mPage.get());
+
+    const uint_t count = load_le_int32(mPage.get() + PAGE_COUNT_OFF);
+    if (count < PageEntries())
+    {
+      uint8_t* const entry = mPage.get() + PAGE_DATA_OFF + count * ENTRY_SIZE;
+
+      store_le_int64(hash, entry);
+      store_le_int32(row, entry + sizeof(uint64_t));
+      store_le_int32(count + 1, mPage.get() + PAGE_COUNT_OFF);
+      WritePage(page, mPage.get());
+      break;
+    }
+
+    const PAGE_INDEX next = load_le_int32(mPage.get() + PAGE_NEXT_OFF);
+    if (next != NIL_PAGE)
+    {
+      page = next;
+      continue;
+    }
+
+    //The page is full; chain a new one after it.
+    const PAGE_INDEX overflow = AllocatePage();
+
+    ReadPage(page, mPage.get());
+    store_le_int32(overflow, mPage.get() + PAGE_NEXT_OFF);
+    WritePage(page, mPage.get());
+
+    page = overflow;
+  }
+
+  ++mEntriesCount;
+  mModified = true;
+
+  if (mEntriesCount * 100 > _SC(uint64_t, SPLIT_FILL_PERCENT) * PageEntries() * mBucketsPages.size())
+    Split();
+}
+
+
+void
+FieldHashIndex::Remove(const uint64_t hash, const ROW_INDEX row)
+{
+  PAGE_INDEX prevPage = NIL_PAGE;
+  PAGE_INDEX page = mBucketsPages[BucketOf(hash)];
+
+  while (page != NIL_PAGE)
+  {
+    ReadPage(page, mPage.get());
+
+    const uint_t count = load_le_int32(mPage.get() + PAGE_COUNT_OFF);
+    const PAGE_INDEX next = load_le_int32(mPage.get() + PAGE_NEXT_OFF);
+
+    for (uint_t i = 0; i < count; ++i)
+    {
+      uint8_t* const entry = mPage.get() + PAGE_DATA_OFF + i * ENTRY_SIZE;
+
+      if ((load_le_int64(entry) != hash)
+          || (load_le_int32(entry + sizeof(uint64_t)) != row))
+      {
+        continue;
+      }
+
+      //The entries are not kept in any order, so the last one fills the gap.
+      memmove(entry, mPage.get() + PAGE_DATA_OFF + (count - 1) * ENTRY_SIZE, ENTRY_SIZE);
+      store_le_int32(count - 1, mPage.get() + PAGE_COUNT_OFF);
+
+      if ((count == 1) && (prevPage != NIL_PAGE))
+      {
+        FreePage(page);
+
+        ReadPage(prevPage, mPage.get());
+        store_le_int32(next, mPage.get() + PAGE_NEXT_OFF);
+        WritePage(prevPage, mPage.get());
+      }
+      else
+        WritePage(page, mPage.get());
+
+      assert(mEntriesCount > 0);
+
+      --mEntriesCount;
+      mModified = true;
+      return;
+    }
+
+    prevPage = page;
+    page = next;
+  }
+}
+
+
+void
+FieldHashIndex::Find(const uint64_t    hash,
+                     const ROW_INDEX   fromRow,
+                     const ROW_INDEX   toRow,
+                     RowsSet&          outRows)
+{
+  PAGE_INDEX page = mBucketsPages[BucketOf(hash)];
+
+  while (page != NIL_PAGE)
+  {
+    ReadPage(page, mPage.get());
+
+    const uint_t count = load_le_int32(mPage.get() + PAGE_COUNT_OFF);
+    for (uint_t i = 0; i < count; ++i)
+    {
+      const uint8_t* const entry = mPage.get() + PAGE_DATA_OFF + i * ENTRY_SIZE;
+
+      if (load_le_int64(entry) != hash)
+        continue;
+
+      const ROW_INDEX row = load_le_int32(entry + sizeof(uint64_t));
+      if ((fromRow <= row) && (row <= toRow))
+        outRows.Add(row);
+    }
+
+    page = load_le_int32(mPage.get() + PAGE_NEXT_OFF);
+  }
+}
+
+
+void
+FieldHashIndex::Flush()
+{
+  if (mModified)
+  {
+    StoreBucketsMap();
+
+    memset(mPage.get(), 0, mPageSize);
+    store_le_int32(mLevel, mPage.get() + HDR_LEVEL_OFF);
+    store_le_int32(mNextSplit, mPage.get() + HDR_NEXT_SPLIT_OFF);
+    store_le_int64(mEntriesCount, mPage.get() + HDR_ENTRIES_OFF);
+    store_le_int32(mFirstFreePage, mPage.get() + HDR_FREE_PAGE_OFF);
+    store_le_int32(mMapPage, mPage.get() + HDR_MAP_PAGE_OFF);
+    store_le_int32(mBucketsPages.size(), mPage.get() + HDR_BUCKETS_OFF);
+    WritePage(0, mPage.get());
+
+    mModified = false;
+  }
+
+  mContainer->Flush();
+}
+
+
+void
+FieldHashIndex::MarkForRemoval()
+{
+  mContainer->MarkForRemoval();
+
+  //Its content is not needed anymore.
+  mModified = false;
+}
+
+
+uint64_t
+FieldHashIndex::IndexRawSize() const
+{
+  return mContainer->Size();
+}
+
+
+uint_t
+FieldHashIndex::PageEntries() const
+{
+  return (mPageSize - PAGE_DATA_OFF) / ENTRY_SIZE;
+}
+
+
+uint32_t
+FieldHashIndex::BucketOf(const uint64_t hash) const
+{
+  uint32_t bucket = hash & ((_SC(uint64_t, 1) << mLevel) - 1);
+
+  //The buckets before the split pointer were already split at this level.
+  if (bucket < mNextSplit)
+    bucket = hash & ((_SC(uint64_t, 1) << (mLevel + 1)) - 1);
+
+  assert(bucket < mBucketsPages.size());
+
+  return bucket;
+}
+
+
+FieldHashIndex::PAGE_INDEX
+FieldHashIndex::AllocatePage()
+{
+  PAGE_INDEX page = mFirstFreePage;
+
+  if (page != NIL_PAGE)
+  {
+    ReadPage(page, mPage.get());
+    mFirstFreePage = load_le_int32(mPage.get() + PAGE_NEXT_OFF);
+  }
+  else
+  {
+    assert(mContainer->Size() % mPageSize == 0);
+
+    page = mContainer->Size() / mPageSize;
+  }
+
+  //The containers do not allow gaps, so the page is written right away.
+  memset(mPage.get(), 0, mPageSize);
+  WritePage(page, mPage.get());
+
+  mModified = true;
+
+  return page;
+}
+
+
+void
+FieldHashIndex::FreePage(const PAGE_INDEX page)
+{
+  assert(page != NIL_PAGE);
+
+  memset(mPage.get(), 0, mPageSize);
+  store_le_int32(mFirstFreePage, mPage.get() + PAGE_NEXT_OFF);
+  WritePage(page, mPage.get());
+
+  mFirstFreePage = page;
+  mModified = true;
+}
+
+
+void
+FieldHashIndex::ReadPage(const PAGE_INDEX page, uint8_t* const data)
+{
+  mContainer->Read(_SC(uint64_t, page) * mPageSize, mPageSize, data);
+}
+
+
+void
+FieldHashIndex::WritePage(const PAGE_INDEX page, const uint8_t* const data)
+{
+  mContainer->Write(_SC(uint64_t, page) * mPageSize, mPageSize, data);
+}
+
+
+void
+FieldHashIndex::StoreBucket(const uint32_t bucket, const vector<Entry>& entries)
+{
+  const PAGE_INDEX first = mBucketsPages[bucket];
+
+  //Release the old overflow pages; new ones are taken as they are needed.
+  ReadPage(first, mPage.get());
+  PAGE_INDEX page = load_le_int32(mPage.get() + PAGE_NEXT_OFF);
+  while (page != NIL_PAGE)
+  {
+    ReadPage(page, mPage.get());
+
+    const PAGE_INDEX next = load_le_int32(mPage.get() + PAGE_NEXT_OFF);
+
+    FreePage(page);
+    page = next;
+  }
+
+  page = first;
+
+  size_t e = 0;
+  do
+  {
+    const uint_t count = MIN(entries.size() - e, PageEntries());
+    const PAGE_INDEX next = (e + count < entries.size()) ? AllocatePage() : NIL_PAGE;
+
+    memset(mPage.get(), 0, mPageSize);
+    store_le_int32(count, mPage.get() + PAGE_COUNT_OFF);
+    store_le_int32(next, mPage.get() + PAGE_NEXT_OFF);
+
+    for (uint_t i = 0; i < count; ++i, ++e)
+    {
+      uint8_t* const entry = mPage.get() + PAGE_DATA_OFF + i * ENTRY_SIZE;
+
+      store_le_int64(entries[e].mHash, entry);
+      store_le_int32(entries[e].mRow, entry + sizeof(uint64_t));
+    }
+
+    WritePage(page, mPage.get());
+    page = next;
+  } while (page != NIL_PAGE);
+}
+
+
+void
+FieldHashIndex::Split()
+{
+  const uint32_t bucket = mNextSplit;
+  const uint64_t newMask = (_SC(uint64_t, 1) << (mLevel + 1)) - 1;
+
+  vector<Entry> entries[2];
+
+  PAGE_INDEX page = mBucketsPages[bucket];
+  while (page != NIL_PAGE)
+  {
+    ReadPage(page, mPage.get());
+
+    const uint_t count = load_le_int32(mPage.get() + PAGE_COUNT_OFF);
+    for (uint_t i = 0; i < count; ++i)
+    {
+      const uint8_t* const data = mPage.get() + PAGE_DATA_OFF + i * ENTRY_SIZE;
+
+      Entry entry;
+      entry.mHash = load_le_int64(data);
+      entry.mRow  = load_le_int32(data + sizeof(uint64_t));
+
+      entries[(entry.mHash & newMask) == bucket ? 0 : 1].push_back(entry);
+    }
+
+    page = load_le_int32(mPage.get() + PAGE_NEXT_OFF);
+  }
+
+  mBucketsPages.push_back(AllocatePage());
+
+  assert(mBucketsPages.size() == (_SC(uint64_t, 1) << mLevel) + bucket + 1);
+
+  StoreBucket(bucket, entries[0]);
+  StoreBucket(mBucketsPages.size() - 1, entries[1]);
+
+  if (++mNextSplit == (_SC(uint64_t, 1) << mLevel))
+  {
+    ++mLevel;
+    mNextSplit = 0;
+  }
+
+  mModified = true;
+}
+
+
+void
+FieldHashIndex::LoadBucketsMap()
+{
+  ReadPage(0, mPage.get());
+
+  mLevel         = load_le_int32(mPage.get() + HDR_LEVEL_OFF);
+  mNextSplit     = load_le_int32(mPage.get() + HDR_NEXT_SPLIT_OFF);
+  mEntriesCount  = load_le_int64(mPage.get() + HDR_ENTRIES_OFF);
+  mFirstFreePage = load_le_int32(mPage.get() + HDR_FREE_PAGE_OFF);
+  mMapPage       = load_le_int32(mPage.get() + HDR_MAP_PAGE_OFF);
+
+  const uint32_t bucketsCount = load_le_int32(mPage.get() + HDR_BUCKETS_OFF);
+
+  if ((bucketsCount == 0)
+      || (bucketsCount != (_SC(uint64_t, 1) << mLevel) + mNextSplit))
+  {
+    throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY),
+                       "The hash index header is corrupted.");
+  }
+
+  mBucketsPages.reserve(bucketsCount);
+
+  PAGE_INDEX page = mMapPage;
+  while ((page != NIL_PAGE) && (mBucketsPages.size() < bucketsCount))
+  {
+    ReadPage(page, mPage.get());
+
+    const uint_t count = load_le_int32(mPage.get() + PAGE_COUNT_OFF);
+    for (uint_t i = 0; i < count; ++i)
+      mBucketsPages.push_back(load_le_int32(mPage.get() + PAGE_DATA_OFF + i * sizeof(uint32_t)));
+
+    page = load_le_int32(mPage.get() + PAGE_NEXT_OFF);
+  }
+
+  if (mBucketsPages.size() != bucketsCount)
+  {
+    throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY),
+                       "The hash index buckets map is corrupted.");
+  }
+}
+
+
+void
+FieldHashIndex::StoreBucketsMap()
+{
+  while (mMapPage != NIL_PAGE)
+  {
+    ReadPage(mMapPage, mPage.get());
+
+    const PAGE_INDEX next = load_le_int32(mPage.get() + PAGE_NEXT_OFF);
+
+    FreePage(mMapPage);
+    mMapPage = next;
+  }
+
+  const uint_t pageBuckets = (mPageSize - PAGE_DATA_OFF) / sizeof(uint32_t);
+
+  //Write the map from its end, so every page knows the one that follows it.
+  size_t end = mBucketsPages.size();
+  while (end > 0)
+  {
+    const size_t start = (end - 1) / pageBuckets * pageBuckets;
+    const PAGE_INDEX page = AllocatePage();
+
+    memset(mPage.get(), 0, mPageSize);
+    store_le_int32(end - start, mPage.get() + PAGE_COUNT_OFF);
+    store_le_int32(mMapPage, mPage.get() + PAGE_NEXT_OFF);
+    for (size_t b = start; b < end; ++b)
+    {
+      store_le_int32(mBucketsPages[b],
+                     mPage.get() + PAGE_DATA_OFF + (b - start) * sizeof(uint32_t));
+    }
+    WritePage(page, mPage.get());
+
+    mMapPage = page;
+    end = start;
+  }
+}
+
+
+} //namespace pastra
+} //namespace whais
@@ -0,0 +1,104 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef PS_HASHINDEX_H_
+#define PS_HASHINDEX_H_
+
+#include <memory>
+#include <vector>
+
+#include "dbs/dbs_rowsset.h"
+#include "ps_container.h"
+
+
+namespace whais {
+namespace pastra {
+
+
+/* A field index that serves only the lookups of single values. It keeps the
+ * hashes of the indexed values, with their rows, in buckets of pages that are
+ * split one at a time as the index grows (linear hashing), so a lookup reads
+ * a bucket's page and seldom one of its overflow pages. The found rows have
+ * to be checked against the value, as different values may share a hash.
+ * The pages of the buckets are listed in a map kept in memory, which is
+ * written in the index's pages when the index is flushed. */
+class FieldHashIndex
+{
+public:
+  FieldHashIndex(std::unique_ptr<IDataContainer>&   container,
+                 const uint_t                       pageSize,
+                 const bool                         create);
+  ~FieldHashIndex();
+
+  FieldHashIndex(const FieldHashIndex&) = delete;
+  FieldHashIndex& operator= (const FieldHashIndex&) = delete;
+
+  void Insert(const uint64_t hash, const ROW_INDEX row);
+  void Remove(const uint64_t hash, const ROW_INDEX row);
+  void Find(const uint64_t    hash,
+            const ROW_INDEX   fromRow,
+            const ROW_INDEX   toRow,
+            RowsSet&          outRows);
+
+  void Flush();
+  void MarkForRemoval();
+  uint64_t IndexRawSize() const;
+
+private:
+  typedef uint32_t PAGE_INDEX;
+
+  struct Entry
+  {
+    uint64_t    mHash;
+    ROW_INDEX   mRow;
+  };
+
+  uint_t PageEntries() const;
+  uint32_t BucketOf(const uint64_t hash) const;
+  PAGE_INDEX AllocatePage();
+  void FreePage(const PAGE_INDEX page);
+  void ReadPage(const PAGE_INDEX page, uint8_t* const data);
+  void WritePage(const PAGE_INDEX page, const uint8_t* const data);
+  void StoreBucket(const uint32_t bucket, const std::vector<Entry>& entries);
+  void Split();
+  void LoadBucketsMap();
+  void StoreBucketsMap();
+
+  const uint_t                      mPageSize;
+  std::unique_ptr<IDataContainer>   mContainer;
+  std::vector<PAGE_INDEX>           mBucketsPages;
+  std::unique_ptr<uint8_t[]>        mPage;
+  uint64_t                          mEntriesCount;
+  uint32_t                          mLevel;
+  uint32_t                          mNextSplit;
+  PAGE_INDEX                        mFirstFreePage;
+  PAGE_INDEX                        mMapPage;
+  bool                              mModified;
+};
+
+
+} //namespace pastra
+} //namespace whais
+
+#endif /* PS_HASHINDEX_H_ */
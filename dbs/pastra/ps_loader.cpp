@@ -0,0 +1,772 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+#include <string.h>
+
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_valtranslator.h"
+#include "utils/endianness.h"
+#include "utils/wthread.h"
+#include "utils/wutf.h"
+
+#include "ps_loader.h"
+#include "ps_serializer.h"
+#include "ps_templatetable.h"
+#include "ps_varstorage.h"
+
+
+using namespace std;
+
+
+namespace whais {
+namespace pastra {
+
+
+static const uint64_t LOAD_INPUT_SIZE = 4 * 1024 * 1024;
+static const ROW_INDEX LOAD_SLICE_ROWS = 512;
+
+//The text and array values smaller than this are kept in their rows.
+static const uint64_t ROW_VALUE_SIZE = 2 * sizeof(uint64_t);
+static const uint64_t ROW_VALUE_INLINE = 0x80;
+
+static const uint64_t TEXT_RECORD_HEADER = 3 * sizeof(uint32_t);
+static const uint64_t ARRAY_RECORD_HEADER = sizeof(uint64_t);
+
+
+struct RowsLoader::ConvertJob
+{
+  ConvertJob(RowsLoader& loader, const int64_t slicesCount)
+    : mLoader(loader),
+      mSlicesCount(slicesCount),
+      mNextSlice(0),
+      mFailed(false),
+      mErrorCode(0)
+  {
+  }
+
+  void Fail(const uint32_t code, const string& message)
+  {
+    LockGuard<Lock> _l(mSync);
+
+    if (mFailed)
+      return;
+
+    mErrorCode = code;
+    mError = message;
+    mFailed = true;
+  }
+
+  RowsLoader&           mLoader;
+  const int64_t         mSlicesCount;
+  volatile int64_t      mNextSlice;
+  volatile bool         mFailed;
+  uint32_t              mErrorCode;
+  string                mError;
+  Lock                  mSync;
+};
+
+
+static inline bool
+is_variable_field(const FieldDescriptor& field)
+{
+  return IS_ARRAY(field.Type()) || (GET_BASE_TYPE(field.Type()) == T_TEXT);
+}
+
+
+static inline void
+set_not_null(const FieldDescriptor& field, uint8_t* const rowData)
+{
+  const uint_t bit = field.NullBitIndex();
+
+  rowData[bit / 8] &= ~(1 << (bit % 8));
+}
+
+
+template<typename T> static int
+read_basic_value(const uint8_t* const    src,
+                 const uint64_t          srcSize,
+                 uint8_t* const          dest)
+{
+  T value;
+
+  const int result = Utf8Translator::Read(src, srcSize, &value);
+  if ((result <= 0) || value.IsNull())
+    return -1;
+
+  Serializer::Store(dest, value);
+  return result;
+}
+
+
+static int
+read_csv_value(const DBS_FIELD_TYPE    type,
+               const uint8_t* const    src,
+               const uint64_t          srcSize,
+               uint8_t* const          dest)
+{
+  switch (type)
+  {
+  case T_BOOL:
+    return read_basic_value<DBool>(src, srcSize, dest);
+
+  case T_CHAR:
+    return read_basic_value<DChar>(src, srcSize, dest);
+
+  case T_DATE:
+    return read_basic_value<DDate>(src, srcSize, dest);
+
+  case T_DATETIME:
+    return read_basic_value<DDateTime>(src, srcSize, dest);
+
+  case T_HIRESTIME:
+    return read_basic_value<DHiresTime>(src, srcSize, dest);
+
+  case T_INT8:
+    return read_basic_value<DInt8>(src, srcSize, dest);
+
+  case T_INT16:
+    return read_basic_value<DInt16>(src, srcSize, dest);
+
+  case T_INT32:
+    return read_basic_value<DInt32>(src, srcSize, dest);
+
+  case T_INT64:
+    return read_basic_value<DInt64>(src, srcSize, dest);
+
+  case T_REAL:
+    return read_basic_value<DReal>(src, srcSize, dest);
+
+  case T_RICHREAL:
+    return read_basic_value<DRichReal>(src, srcSize, dest);
+
+  case T_UINT8:
+    return read_basic_value<DUInt8>(src, srcSize, dest);
+
+  case T_UINT16:
+    return read_basic_value<DUInt16>(src, srcSize, dest);
+
+  case T_UINT32:
+    return read_basic_value<DUInt32>(src, srcSize, dest);
+
+  case T_UINT64:
+    return read_basic_value<DUInt64>(src, srcSize, dest);
+
+  default:
+    assert(false);
+  }
+
+  return -1;
+}
+
+
+
+RowsLoader::RowsLoader(const char* const              file,
+                       const DBS_LOAD_FORMAT          format,
+                       const FieldDescriptor* const   tableFields,
+                       const FIELD_INDEX              tableFieldsCount,
+                       const FIELD_INDEX* const       fields,
+                       const FIELD_INDEX              fieldsCount,
+                       const uint_t                   rowSize,
+                       VariableSizeStore* const       vsStore,
+                       const uint_t                   threadsCount)
+  : mFile(file, WH_FILEOPEN_EXISTING | WH_FILEREAD),
+    mFileName(file),
+    mFormat(format),
+    mTableFields(tableFields),
+    mTableFieldsCount(tableFieldsCount),
+    mFields(fields, fields + fieldsCount),
+    mRowSize(rowSize),
+    mVSStore(vsStore),
+    mThreadsCount(MAX(threadsCount, 1u)),
+    mFileSize(mFile.Size()),
+    mFileOffset(0),
+    mInput(LOAD_INPUT_SIZE),
+    mInputSize(0),
+    mInputConsumed(0),
+    mRowsCapacity(0),
+    mBatchRows(0),
+    mLoadedRows(0)
+{
+  if ((format != LOAD_CSV) && (format != LOAD_BINARY))
+  {
+    throw DBSException(_EXTRA(DBSException::INVALID_PARAMETERS),
+                       "Unknown format of the rows to load from '%s'.",
+                       file);
+  }
+
+  for (auto field : mFields)
+  {
+    if (is_variable_field(mTableFields[field]) && (mVSStore == nullptr))
+    {
+      throw DBSException(_EXTRA(DBSException::INVALID_PARAMETERS),
+                         "Cannot load the values of field %u without a store.",
+                         field);
+    }
+  }
+}
+
+
+bool
+RowsLoader::NextBatch()
+{
+  mBatchRows = 0;
+
+  mRowsBounds.clear();
+  while (mRowsBounds.empty())
+  {
+    const bool lastInput = ! ReadInput();
+    if (mInputSize == 0)
+      return false;
+
+    DelimitRows(lastInput);
+    if (lastInput && mRowsBounds.empty())
+      return false;
+  }
+
+  ConvertRows();
+
+  return true;
+}
+
+
+void
+RowsLoader::ReleaseBatch()
+{
+  if (mVSStore != nullptr)
+  {
+    ReleaseRowsValues(mTableFields,
+                      mTableFieldsCount,
+                      mRows.get(),
+                      mBatchRows,
+                      mRowSize,
+                      *mVSStore);
+  }
+
+  mBatchRows = 0;
+}
+
+
+void
+RowsLoader::ReleaseRowsValues(const FieldDescriptor* const   fields,
+                              const FIELD_INDEX              fieldsCount,
+                              const uint8_t*                 rows,
+                              const ROW_INDEX                rowsCount,
+                              const uint_t                   rowSize,
+                              VariableSizeStore&             vsStore)
+{
+  for (ROW_INDEX row = 0; row < rowsCount; ++row, rows += rowSize)
+  {
+    for (FIELD_INDEX field = 0; field < fieldsCount; ++field)
+    {
+      const FieldDescriptor& fd = fields[field];
+      const uint_t bit = fd.NullBitIndex();
+
+      if ( ! is_variable_field(fd) || (rows[bit / 8] & (1 << (bit % 8))))
+        continue;
+
+      const uint8_t* const fieldData = rows + fd.RowDataOff();
+      const uint64_t valueSize = load_le_int64(fieldData + sizeof(uint64_t));
+      if (((valueSize >> 56) & ROW_VALUE_INLINE) == 0)
+        vsStore.DecrementRecordRef(load_le_int64(fieldData));
+    }
+  }
+}
+
+
+//Keeps the input's part not delimited yet and reads more of the file after
+//it. Returns false when nothing is left to read.
+bool
+RowsLoader::ReadInput()
+{
+  if (mInputConsumed > 0)
+  {
+    memmove(mInput.data(), mInput.data() + mInputConsumed, mInputSize - mInputConsumed);
+    mInputSize -= mInputConsumed, mInputConsumed = 0;
+  }
+
+  //Not even a row fits in the input buffer.
+  if (mInputSize == mInput.size())
+    mInput.resize(2 * mInput.size());
+
+  const uint64_t toRead = MIN(mInput.size() - mInputSize, mFileSize - mFileOffset);
+
+  mFile.Read(mInput.data() + mInputSize, toRead);
+  mInputSize += toRead, mFileOffset += toRead;
+
+  return mFileOffset < mFileSize;
+}
+
+
+void
+RowsLoader::DelimitRows(const bool lastInput)
+{
+  uint64_t from = mInputConsumed;
+
+  while (from < mInputSize)
+  {
+    RowBounds row;
+
+    const uint64_t next = (mFormat == LOAD_CSV)
+                          ? DelimitCsvRow(from, lastInput, &row)
+                          : DelimitBinaryRow(from, &row);
+    if (next == 0)
+      break;
+
+    //The empty lines of a CSV file are skipped.
+    if (row.mTo > row.mFrom)
+      mRowsBounds.push_back(row);
+
+    from = next;
+  }
+
+  mInputConsumed = from;
+  if (lastInput && (mInputConsumed < mInputSize))
+  {
+    throw DBSException(_EXTRA(DBSException::INVALID_PARAMETERS),
+                       "The file '%s' ends in the middle of its row %lu.",
+                       mFileName.c_str(),
+                       _SC(unsigned long, mLoadedRows + mRowsBounds.size() + 1));
+  }
+}
+
+
+uint64_t
+RowsLoader::DelimitCsvRow(const uint64_t     from,
+                          const bool         lastInput,
+                          RowBounds* const   outRow)
+{
+  const uint8_t* const input = mInput.data();
+
+  bool quoted = false;
+  uint64_t pos = from;
+  for (; pos < mInputSize; ++pos)
+  {
+    if (input[pos] == '"')
+      quoted = ! quoted;
+
+    else if ((input[pos] == '\n') && ! quoted)
+      break;
+  }
+
+  if ((pos == mInputSize) && ! lastInput)
+    return 0;
+
+  outRow->mFrom = from, outRow->mTo = pos;
+  if ((pos > from) && (input[pos - 1] == '\r'))
+    --outRow->mTo;
+
+  return (pos < mInputSize) ? pos + 1 : pos;
+}
+
+
+uint64_t
+RowsLoader::DelimitBinaryRow(const uint64_t from, RowBounds* const outRow)
+{
+  const uint8_t* const input = mInput.data();
+
+  uint64_t pos = from + (mFields.size() + 7) / 8;
+  if (pos > mInputSize)
+    return 0;
+
+  for (size_t f = 0; f < mFields.size(); ++f)
+  {
+    if (input[from + f / 8] & (1 << (f % 8)))
+      continue;
+
+    const FieldDescriptor& fd = mTableFields[mFields[f]];
+    const DBS_FIELD_TYPE type = _SC(DBS_FIELD_TYPE, GET_BASE_TYPE(fd.Type()));
+
+    if (is_variable_field(fd))
+    {
+      if (pos + sizeof(uint32_t) > mInputSize)
+        return 0;
+
+      const uint64_t count = load_le_int32(input + pos);
+      pos += sizeof(uint32_t);
+      pos += count * (IS_ARRAY(fd.Type()) ? Serializer::Size(type, false) : 1);
+    }
+    else
+      pos += Serializer::Size(type, false);
+
+    if (pos > mInputSize)
+      return 0;
+  }
+
+  outRow->mFrom = from, outRow->mTo = pos;
+  return pos;
+}
+
+
+void
+RowsLoader::ConvertRows()
+{
+  mBatchRows = mRowsBounds.size();
+  if (mRowsCapacity < mBatchRows)
+  {
+    mRows = unique_array_make(uint8_t, mBatchRows * mRowSize);
+    mRowsCapacity = mBatchRows;
+  }
+
+  //Every value starts as null.
+  memset(mRows.get(), 0xFF, mBatchRows * mRowSize);
+
+  ConvertJob job(*this, (mBatchRows + LOAD_SLICE_ROWS - 1) / LOAD_SLICE_ROWS);
+
+  const uint_t workersCount = MIN(_SC(int64_t, mThreadsCount), job.mSlicesCount) - 1;
+  unique_ptr<Thread[]> workers(unique_array_make(Thread, workersCount));
+
+  for (uint_t i = 0; i < workersCount; ++i)
+    workers[i].Run(convert_rows_routine, &job);
+
+  convert_rows_routine(&job);
+
+  for (uint_t i = 0; i < workersCount; ++i)
+    workers[i].WaitToEnd(false);
+
+  if (job.mFailed)
+  {
+    ReleaseBatch();
+    throw DBSException(_EXTRA(job.mErrorCode), "%s", job.mError.c_str());
+  }
+
+  mLoadedRows += mBatchRows;
+}
+
+
+void
+RowsLoader::ConvertRow(const ROW_INDEX    row,
+                       uint8_t* const     rowData,
+                       ConvertBuffers&    buffers)
+{
+  const bool converted = (mFormat == LOAD_CSV)
+                         ? ConvertCsvRow(mRowsBounds[row], rowData, buffers)
+                         : ConvertBinaryRow(mRowsBounds[row], rowData, buffers);
+  if ( ! converted)
+  {
+    throw DBSException(_EXTRA(DBSException::INVALID_PARAMETERS),
+                       "The row %lu of file '%s' does not hold valid values.",
+                       _SC(unsigned long, mLoadedRows + row + 1),
+                       mFileName.c_str());
+  }
+}
+
+
+bool
+RowsLoader::ConvertCsvRow(const RowBounds&   bounds,
+                          uint8_t* const     rowData,
+                          ConvertBuffers&    buffers)
+{
+  const uint8_t* const input = mInput.data();
+  vector<uint8_t>& value = buffers.mValue;
+
+  uint64_t pos = bounds.mFrom;
+  for (size_t f = 0; f < mFields.size(); ++f)
+  {
+    if (f > 0)
+    {
+      if ((pos >= bounds.mTo) || (input[pos] != ','))
+        return false;
+
+      ++pos;
+    }
+
+    value.clear();
+    if ((pos < bounds.mTo) && (input[pos] == '"'))
+    {
+      while (true)
+      {
+        if (++pos >= bounds.mTo)
+          return false;
+
+        if (input[pos] == '"')
+        {
+          if ((pos + 1 >= bounds.mTo) || (input[pos + 1] != '"'))
+          {
+            ++pos;
+            break;
+          }
+          ++pos;
+        }
+        value.push_back(input[pos]);
+      }
+    }
+    else
+    {
+      while ((pos < bounds.mTo) && (input[pos] != ','))
+        value.push_back(input[pos++]);
+    }
+
+    const uint64_t valueSize = value.size();
+    value.push_back(0);
+
+    try
+    {
+      if ( ! StoreCsvValue(mTableFields[mFields[f]], value.data(), valueSize, rowData, buffers))
+        return false;
+    }
+    catch (const DBSException&)
+    {
+      return false;
+    }
+  }
+
+  return pos == bounds.mTo;
+}
+
+
+bool
+RowsLoader::ConvertBinaryRow(const RowBounds&   bounds,
+                             uint8_t* const     rowData,
+                             ConvertBuffers&    buffers)
+{
+  const uint8_t* const input = mInput.data() + bounds.mFrom;
+
+  uint64_t pos = (mFields.size() + 7) / 8;
+  for (size_t f = 0; f < mFields.size(); ++f)
+  {
+    if (input[f / 8] & (1 << (f % 8)))
+      continue;
+
+    const FieldDescriptor& fd = mTableFields[mFields[f]];
+    const DBS_FIELD_TYPE type = _SC(DBS_FIELD_TYPE, GET_BASE_TYPE(fd.Type()));
+
+    if (IS_ARRAY(fd.Type()))
+    {
+      const uint64_t count = load_le_int32(input + pos);
+      const uint_t itemSize = Serializer::Size(type, false);
+      const Serializer::VALUE_VALIDATOR validator = Serializer::SelectValidator(type);
+
+      pos += sizeof(uint32_t);
+      for (uint64_t i = 0; i < count; ++i)
+      {
+        if ( ! validator(input + pos + i * itemSize))
+          return false;
+      }
+
+      if (count > 0)
+        StoreArray(fd, input + pos, count, rowData, buffers.mRecord);
+
+      pos += count * itemSize;
+    }
+    else if (type == T_TEXT)
+    {
+      const uint64_t size = load_le_int32(input + pos);
+
+      pos += sizeof(uint32_t);
+      if ((size > 0) && ! StoreText(fd, input + pos, size, rowData, buffers.mRecord))
+        return false;
+
+      pos += size;
+    }
+    else
+    {
+      if ( ! Serializer::SelectValidator(type)(input + pos))
+        return false;
+
+      memcpy(rowData + fd.RowDataOff(), input + pos, Serializer::Size(type, false));
+      set_not_null(fd, rowData);
+
+      pos += Serializer::Size(type, false);
+    }
+  }
+
+  assert(bounds.mFrom + pos == bounds.mTo);
+
+  return true;
+}
+
+
+bool
+RowsLoader::StoreCsvValue(const FieldDescriptor&   field,
+                          const uint8_t* const     value,
+                          const uint64_t           valueSize,
+                          uint8_t* const           rowData,
+                          ConvertBuffers&          buffers)
+{
+  if (valueSize == 0)
+    return true;
+
+  const DBS_FIELD_TYPE type = _SC(DBS_FIELD_TYPE, GET_BASE_TYPE(field.Type()));
+
+  if (IS_ARRAY(field.Type()))
+  {
+    const uint_t itemSize = Serializer::Size(type, false);
+    vector<uint8_t>& items = buffers.mItems;
+
+    uint64_t pos = 0, count = 0;
+    while (true)
+    {
+      items.resize((count + 1) * itemSize);
+
+      const int result = read_csv_value(type,
+                                        value + pos,
+                                        valueSize + 1 - pos,
+                                        items.data() + count * itemSize);
+      if (result <= 0)
+        return false;
+
+      pos += result, ++count;
+      if (pos == valueSize)
+        break;
+
+      else if (value[pos++] != ';')
+        return false;
+    }
+
+    StoreArray(field, items.data(), count, rowData, buffers.mRecord);
+    return true;
+  }
+  else if (type == T_TEXT)
+    return StoreText(field, value, valueSize, rowData, buffers.mRecord);
+
+  if (read_csv_value(type, value, valueSize + 1, rowData + field.RowDataOff()) != _SC(int, valueSize))
+    return false;
+
+  set_not_null(field, rowData);
+  return true;
+}
+
+
+bool
+RowsLoader::StoreText(const FieldDescriptor&   field,
+                      const uint8_t* const     utf8,
+                      const uint64_t           utf8Size,
+                      uint8_t* const           rowData,
+                      vector<uint8_t>&         record)
+{
+  assert(utf8Size > 0);
+
+  uint64_t charsCount = 0;
+  for (uint64_t pos = 0; pos < utf8Size; ++charsCount)
+  {
+    const uint_t unitsCount = wh_utf8_cu_count(utf8[pos]);
+    uint32_t codePoint;
+
+    if ((unitsCount == 0)
+        || (pos + unitsCount > utf8Size)
+        || (wh_load_utf8_cp(utf8 + pos, &codePoint) != unitsCount)
+        || (codePoint == 0))
+    {
+      return false;
+    }
+    pos += unitsCount;
+  }
+
+  if (utf8Size > 0xFFFFFFFF)
+    return false;
+
+  uint8_t* const fieldData = rowData + field.RowDataOff();
+  if (utf8Size < ROW_VALUE_SIZE)
+  {
+    store_le_int64((utf8Size | ROW_VALUE_INLINE) << 56, fieldData + sizeof(uint64_t));
+    memcpy(fieldData, utf8, utf8Size);
+  }
+  else
+  {
+    record.resize(TEXT_RECORD_HEADER + utf8Size);
+    store_le_int32(charsCount, record.data());
+    store_le_int32(0, record.data() + sizeof(uint32_t));
+    store_le_int32(0, record.data() + 2 * sizeof(uint32_t));
+    memcpy(record.data() + TEXT_RECORD_HEADER, utf8, utf8Size);
+
+    store_le_int64(mVSStore->AddRecord(record.data(), record.size()), fieldData);
+    store_le_int64(record.size(), fieldData + sizeof(uint64_t));
+  }
+
+  set_not_null(field, rowData);
+  return true;
+}
+
+
+void
+RowsLoader::StoreArray(const FieldDescriptor&   field,
+                       const uint8_t* const     items,
+                       const uint64_t           itemsCount,
+                       uint8_t* const           rowData,
+                       vector<uint8_t>&         record)
+{
+  assert(itemsCount > 0);
+
+  const DBS_FIELD_TYPE type = _SC(DBS_FIELD_TYPE, GET_BASE_TYPE(field.Type()));
+  const uint64_t rawSize = itemsCount * Serializer::Size(type, false);
+
+  uint8_t* const fieldData = rowData + field.RowDataOff();
+  if (rawSize < ROW_VALUE_SIZE)
+  {
+    store_le_int64((rawSize | ROW_VALUE_INLINE) << 56, fieldData + sizeof(uint64_t));
+    memcpy(fieldData, items, rawSize);
+  }
+  else
+  {
+    record.resize(ARRAY_RECORD_HEADER + rawSize);
+    store_le_int64(itemsCount, record.data());
+    memcpy(record.data() + ARRAY_RECORD_HEADER, items, rawSize);
+
+    store_le_int64(mVSStore->AddRecord(record.data(), record.size()), fieldData);
+    store_le_int64(record.size(), fieldData + sizeof(uint64_t));
+  }
+
+  set_not_null(field, rowData);
+}
+
+
+void
+RowsLoader::convert_rows_routine(void* args)
+{
+  ConvertJob& job = *_RC(ConvertJob*, args);
+  RowsLoader& loader = job.mLoader;
+  ConvertBuffers buffers;
+
+  try
+  {
+    while ( ! job.mFailed)
+    {
+      const int64_t slice = wh_atomic_fetch_inc64(&job.mNextSlice);
+      if (slice >= job.mSlicesCount)
+        break;
+
+      const ROW_INDEX from = slice * LOAD_SLICE_ROWS;
+      const ROW_INDEX to = MIN(from + LOAD_SLICE_ROWS, loader.mBatchRows);
+      for (ROW_INDEX row = from; (row < to) && ! job.mFailed; ++row)
+        loader.ConvertRow(row, loader.mRows.get() + row * loader.mRowSize, buffers);
+    }
+  }
+  catch (const DBSException& e)
+  {
+    job.Fail(e.Code(), e.Message());
+  }
+  catch (const Exception& e)
+  {
+    job.Fail(DBSException::GENERAL_CONTROL_ERROR, e.Message());
+  }
+  catch (...)
+  {
+    job.Fail(DBSException::GENERAL_CONTROL_ERROR, "Failed to convert the loaded rows.");
+  }
+}
+
+
+} //namespace pastra
+} //namespace whais
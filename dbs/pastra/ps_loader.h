@@ -0,0 +1,150 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef PS_LOADER_H_
+#define PS_LOADER_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/wfile.h"
+#include "dbs/dbs_table.h"
+
+
+namespace whais {
+namespace pastra {
+
+
+class FieldDescriptor;
+class VariableSizeStore;
+
+
+/* Converts the rows of a file loaded in bulk into a table to the layout of
+ * the table's rows. The file is read in batches; the rows of a batch are
+ * delimited first, then several threads convert them at once. The text and
+ * array values that do not fit in their rows are added to the table's
+ * variable size store while they are converted. */
+class RowsLoader
+{
+public:
+  RowsLoader(const char* const              file,
+             const DBS_LOAD_FORMAT          format,
+             const FieldDescriptor* const   tableFields,
+             const FIELD_INDEX              tableFieldsCount,
+             const FIELD_INDEX* const       fields,
+             const FIELD_INDEX              fieldsCount,
+             const uint_t                   rowSize,
+             VariableSizeStore* const       vsStore,
+             const uint_t                   threadsCount);
+
+  RowsLoader(const RowsLoader&) = delete;
+  RowsLoader& operator= (const RowsLoader&) = delete;
+
+  //Converts the rows of the next batch. Returns false if none are left.
+  bool NextBatch();
+
+  ROW_INDEX BatchRowsCount() const { return mBatchRows; }
+  const uint8_t* BatchRows() const { return mRows.get(); }
+
+  //Drops the stored values of the batch's rows, when these are not kept.
+  void ReleaseBatch();
+
+  //Drops the values kept in the variable size store by some rows.
+  static void ReleaseRowsValues(const FieldDescriptor* const   fields,
+                                const FIELD_INDEX              fieldsCount,
+                                const uint8_t*                 rows,
+                                const ROW_INDEX                rowsCount,
+                                const uint_t                   rowSize,
+                                VariableSizeStore&             vsStore);
+
+private:
+  struct ConvertJob;
+
+  struct RowBounds
+  {
+    uint64_t    mFrom;
+    uint64_t    mTo;
+  };
+
+  //Scratch memory of a thread while it converts rows.
+  struct ConvertBuffers
+  {
+    std::vector<uint8_t>    mValue;
+    std::vector<uint8_t>    mItems;
+    std::vector<uint8_t>    mRecord;
+  };
+
+  bool ReadInput();
+  void DelimitRows(const bool lastInput);
+  uint64_t DelimitCsvRow(const uint64_t from, const bool lastInput, RowBounds* const outRow);
+  uint64_t DelimitBinaryRow(const uint64_t from, RowBounds* const outRow);
+  void ConvertRows();
+  void ConvertRow(const ROW_INDEX row, uint8_t* const rowData, ConvertBuffers& buffers);
+  bool ConvertCsvRow(const RowBounds& bounds, uint8_t* const rowData, ConvertBuffers& buffers);
+  bool ConvertBinaryRow(const RowBounds& bounds, uint8_t* const rowData, ConvertBuffers& buffers);
+  bool StoreCsvValue(const FieldDescriptor&   field,
+                     const uint8_t* const     value,
+                     const uint64_t           valueSize,
+                     uint8_t* const           rowData,
+                     ConvertBuffers&          buffers);
+  bool StoreText(const FieldDescriptor&   field,
+                 const uint8_t* const     utf8,
+                 const uint64_t           utf8Size,
+                 uint8_t* const           rowData,
+                 std::vector<uint8_t>&    record);
+  void StoreArray(const FieldDescriptor&   field,
+                  const uint8_t* const     items,
+                  const uint64_t           itemsCount,
+                  uint8_t* const           rowData,
+                  std::vector<uint8_t>&    record);
+
+  static void convert_rows_routine(void* args);
+
+  File                              mFile;
+  const std::string                 mFileName;
+  const DBS_LOAD_FORMAT             mFormat;
+  const FieldDescriptor* const      mTableFields;
+  const FIELD_INDEX                 mTableFieldsCount;
+  std::vector<FIELD_INDEX>          mFields;
+  const uint_t                      mRowSize;
+  VariableSizeStore* const          mVSStore;
+  const uint_t                      mThreadsCount;
+  const uint64_t                    mFileSize;
+  uint64_t                          mFileOffset;
+  std::vector<uint8_t>              mInput;
+  uint64_t                          mInputSize;
+  uint64_t                          mInputConsumed;
+  std::vector<RowBounds>            mRowsBounds;
+  std::unique_ptr<uint8_t[]>        mRows;
+  ROW_INDEX                         mRowsCapacity;
+  ROW_INDEX                         mBatchRows;
+  uint64_t                          mLoadedRows;
+};
+
+
+} //namespace pastra
+} //namespace whais
+
+#endif /* PS_LOADER_H_ */
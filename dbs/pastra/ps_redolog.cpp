@@ -0,0 +1,1075 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+#include <memory.h>
+
+#include "dbs/dbs_exception.h"
+#include "utils/endianness.h"
+#include "ps_redolog.h"
+
+
+using namespace std;
+
+namespace whais {
+namespace pastra {
+
+
+static const uint8_t REDO_FILE_SIGNATURE[] = { 0x50, 0x41, 0x53, 0x54, 0x52, 0x41, 0x20, 0x52 };
+static const char REDO_TEMP_FILE_EXT[]     = ".tmp";
+
+static const uint16_t REDO_VER_MAJ   = 1;
+static const uint16_t REDO_VER_MIN   = 0;
+
+static const uint_t REDO_SIGNATURE_OFF      = 0;
+static const uint_t REDO_SIGNATURE_LEN      = 8;
+static const uint_t REDO_VER_MAJ_OFF        = 8;
+static const uint_t REDO_VER_MIN_OFF        = 10;
+static const uint_t REDO_CHECKPOINT_OFF     = 16;
+static const uint_t REDO_HEADER_SIZE        = 32;
+
+static const uint_t REDO_REC_SIZE_OFF       = 0;
+static const uint_t REDO_REC_TYPE_OFF       = 4;
+static const uint_t REDO_REC_LSN_OFF        = 8;
+static const uint_t REDO_REC_HEADER_SIZE    = 16;
+static const uint_t REDO_REC_TRAILER_SIZE   = 4;
+
+//Layout of a field record's payload, after the table name.
+static const uint_t REDO_FIELD_ROW_OFF      = 0;
+static const uint_t REDO_FIELD_INDEX_OFF    = 4;
+static const uint_t REDO_FIELD_TYPE_OFF     = 6;
+static const uint_t REDO_FIELD_FLAGS_OFF    = 8;
+static const uint_t REDO_FIELD_HEAD_SIZE    = 9;
+
+static const uint8_t REDO_FIELD_NULL_FLAG   = 1;
+
+//Layout of a container record's payload, after the table name. The name of
+//the container follows, then the block's content for an image.
+static const uint_t REDO_BLOCK_EPOCH_OFF    = 0;
+static const uint_t REDO_BLOCK_UNIT_OFF     = 8;
+static const uint_t REDO_BLOCK_OFFSET_OFF   = 16;
+static const uint_t REDO_BLOCK_NAME_OFF     = 24;
+static const uint_t REDO_BLOCK_HEAD_SIZE    = 26;
+
+//Layout of a table sync record's payload, after the table name.
+static const uint_t REDO_SYNC_EPOCH_OFF     = 0;
+static const uint_t REDO_SYNC_HEAD_SIZE     = 8;
+
+static const uint_t REDO_BUFFER_SIZE        = 65536;
+
+static const uint32_t CHECKSUM_INIT         = 2166136261u;
+static const uint32_t CHECKSUM_PRIME        = 16777619u;
+
+
+static uint32_t
+update_checksum(uint32_t checksum, const uint8_t* data, uint64_t size)
+{
+  while (size-- > 0)
+  {
+    checksum ^= *data++;
+    checksum *= CHECKSUM_PRIME;
+  }
+
+  return checksum;
+}
+
+
+static void
+fill_log_header(const uint64_t checkpointLsn, uint8_t* const header)
+{
+  memset(header, 0, REDO_HEADER_SIZE);
+  memcpy(header + REDO_SIGNATURE_OFF, REDO_FILE_SIGNATURE, REDO_SIGNATURE_LEN);
+  store_le_int16(REDO_VER_MAJ, header + REDO_VER_MAJ_OFF);
+  store_le_int16(REDO_VER_MIN, header + REDO_VER_MIN_OFF);
+  store_le_int64(checkpointLsn, header + REDO_CHECKPOINT_OFF);
+}
+
+
+static const string&
+prepare_log_file(const string& fileName)
+{
+  //A checkpoint was interrupted before the compacted log took the place of
+  //the old one. Both of them have the records that matter.
+  const string tempName = fileName + REDO_TEMP_FILE_EXT;
+  if (whf_file_exists(tempName.c_str()) && ! whf_file_exists(fileName.c_str()))
+    whf_move_file(tempName.c_str(), fileName.c_str());
+
+  return fileName;
+}
+
+
+static bool
+parse_record(const uint_t         type,
+             const uint64_t       lsn,
+             const uint8_t* const payload,
+             const uint64_t       payloadSize,
+             RedoRecord&          outRecord)
+{
+  if (payloadSize < sizeof(uint16_t))
+    return false;
+
+  const uint_t nameLen = load_le_int16(payload);
+  uint64_t offset = sizeof(uint16_t) + nameLen;
+  if (offset > payloadSize)
+    return false;
+
+  outRecord.mType      = type;
+  outRecord.mLsn       = lsn;
+  outRecord.mTable.assign(_RC(const char*, payload + sizeof(uint16_t)), nameLen);
+  outRecord.mField     = 0;
+  outRecord.mFieldType = 0;
+  outRecord.mIsNull    = true;
+  outRecord.mValue     = nullptr;
+  outRecord.mValueSize = 0;
+  outRecord.mEpoch     = 0;
+  outRecord.mUnitSize  = 0;
+  outRecord.mOffset    = 0;
+  outRecord.mContainer.clear();
+
+  if (type == REDO_ROW_ADD)
+  {
+    if (offset + sizeof(uint32_t) != payloadSize)
+      return false;
+
+    outRecord.mRow = load_le_int32(payload + offset);
+    return true;
+  }
+  else if (type == REDO_TABLE_ALTER)
+    return offset == payloadSize;
+
+  else if (type == REDO_TABLE_SYNC)
+  {
+    if (offset + REDO_SYNC_HEAD_SIZE != payloadSize)
+      return false;
+
+    outRecord.mEpoch = load_le_int64(payload + offset + REDO_SYNC_EPOCH_OFF);
+    return true;
+  }
+  else if ((type == REDO_CONTAINER_SIZE) || (type == REDO_BLOCK_IMAGE))
+  {
+    if (offset + REDO_BLOCK_HEAD_SIZE > payloadSize)
+      return false;
+
+    const uint8_t* const head = payload + offset;
+    const uint_t containerLen = load_le_int16(head + REDO_BLOCK_NAME_OFF);
+
+    offset += REDO_BLOCK_HEAD_SIZE + containerLen;
+    if ((offset > payloadSize)
+        || ((type == REDO_CONTAINER_SIZE) && (offset != payloadSize)))
+    {
+      return false;
+    }
+
+    outRecord.mEpoch     = load_le_int64(head + REDO_BLOCK_EPOCH_OFF);
+    outRecord.mUnitSize  = load_le_int64(head + REDO_BLOCK_UNIT_OFF);
+    outRecord.mOffset    = load_le_int64(head + REDO_BLOCK_OFFSET_OFF);
+    outRecord.mContainer.assign(_RC(const char*, head + REDO_BLOCK_HEAD_SIZE), containerLen);
+    outRecord.mValue     = payload + offset;
+    outRecord.mValueSize = payloadSize - offset;
+
+    return (outRecord.mUnitSize > 0) && ! outRecord.mContainer.empty();
+  }
+  else if (type != REDO_FIELD_VALUE)
+    return false;
+
+  if (offset + REDO_FIELD_HEAD_SIZE > payloadSize)
+    return false;
+
+  const uint8_t* const head = payload + offset;
+
+  outRecord.mRow       = load_le_int32(head + REDO_FIELD_ROW_OFF);
+  outRecord.mField     = load_le_int16(head + REDO_FIELD_INDEX_OFF);
+  outRecord.mFieldType = load_le_int16(head + REDO_FIELD_TYPE_OFF);
+  outRecord.mIsNull    = (head[REDO_FIELD_FLAGS_OFF] & REDO_FIELD_NULL_FLAG) != 0;
+
+  offset += REDO_FIELD_HEAD_SIZE;
+
+  outRecord.mValue     = payload + offset;
+  outRecord.mValueSize = payloadSize - offset;
+
+  return true;
+}
+
+
+
+RedoLog::RedoLog(const string& fileName, const DBS_DURABILITY durability)
+  : mFileName(fileName),
+    mDurability(durability),
+    mFile(prepare_log_file(fileName).c_str(), WH_FILECREATE | WH_FILERDWR),
+    mBuffer(unique_array_make(uint8_t, REDO_BUFFER_SIZE)),
+    mBufferUsed(0),
+    mFileEnd(REDO_HEADER_SIZE),
+    mCheckpointOffset(REDO_HEADER_SIZE),
+    mCheckpointLsn(0),
+    mLastLsn(0),
+    mDurableLsn(0),
+    mSyncInProgress(false)
+{
+  whf_remove((mFileName + REDO_TEMP_FILE_EXT).c_str());
+
+  if (mFile.Size() < REDO_HEADER_SIZE)
+  {
+    mFile.Size(0);
+    WriteHeader();
+    mFile.Sync();
+  }
+  else
+  {
+    RedoLogReader reader(mFileName);
+    RedoRecord record;
+
+    mCheckpointLsn = mLastLsn = reader.CheckpointLsn();
+    while (reader.Next(record))
+      mLastLsn = MAX(mLastLsn, record.mLsn);
+
+    //Drop whatever follows the last complete record.
+    mFileEnd = reader.ValidSize();
+    if (mFileEnd < mFile.Size())
+      mFile.Size(mFileEnd);
+  }
+
+  mCheckpointOffset = mFileEnd;
+  mDurableLsn = mLastLsn;
+}
+
+
+RedoLog::~RedoLog()
+{
+  try
+  {
+    WriteBuffer();
+  }
+  catch (...)
+  {
+  }
+}
+
+
+uint64_t
+RedoLog::LogRowAdd(const string& table, const ROW_INDEX row)
+{
+  uint8_t head[sizeof(uint32_t)];
+
+  store_le_int32(row, head);
+
+  return Append(REDO_ROW_ADD, table, head, sizeof head, nullptr, 0, nullptr);
+}
+
+
+uint64_t
+RedoLog::LogFieldValue(const string&          table,
+                       const ROW_INDEX        row,
+                       const FIELD_INDEX      field,
+                       const uint_t           fieldType,
+                       const uint8_t* const   value,
+                       const uint_t           valueSize)
+{
+  uint8_t head[REDO_FIELD_HEAD_SIZE];
+
+  store_le_int32(row, head + REDO_FIELD_ROW_OFF);
+  store_le_int16(field, head + REDO_FIELD_INDEX_OFF);
+  store_le_int16(fieldType, head + REDO_FIELD_TYPE_OFF);
+  head[REDO_FIELD_FLAGS_OFF] = (value == nullptr) ? REDO_FIELD_NULL_FLAG : 0;
+
+  return Append(REDO_FIELD_VALUE,
+                table,
+                head,
+                sizeof head,
+                value,
+                (value == nullptr) ? 0 : valueSize,
+                nullptr);
+}
+
+
+uint64_t
+RedoLog::LogFieldValue(const string&        table,
+                       const ROW_INDEX      row,
+                       const FIELD_INDEX    field,
+                       const uint_t         fieldType,
+                       IRedoContent&        content)
+{
+  uint8_t head[REDO_FIELD_HEAD_SIZE];
+
+  store_le_int32(row, head + REDO_FIELD_ROW_OFF);
+  store_le_int16(field, head + REDO_FIELD_INDEX_OFF);
+  store_le_int16(fieldType, head + REDO_FIELD_TYPE_OFF);
+  head[REDO_FIELD_FLAGS_OFF] = (content.Size() == 0) ? REDO_FIELD_NULL_FLAG : 0;
+
+  return Append(REDO_FIELD_VALUE, table, head, sizeof head, nullptr, 0, &content);
+}
+
+
+static vector<uint8_t>
+container_record_head(const uint64_t   epoch,
+                      const string&    container,
+                      const uint64_t   unitSize,
+                      const uint64_t   offset)
+{
+  if (container.length() > 0xFFFF)
+  {
+    throw DBSException(_EXTRA(DBSException::OPER_NOT_SUPPORTED),
+                       "Cannot journal the content of a container with such a long name.");
+  }
+
+  vector<uint8_t> head(REDO_BLOCK_HEAD_SIZE);
+
+  store_le_int64(epoch, head.data() + REDO_BLOCK_EPOCH_OFF);
+  store_le_int64(unitSize, head.data() + REDO_BLOCK_UNIT_OFF);
+  store_le_int64(offset, head.data() + REDO_BLOCK_OFFSET_OFF);
+  store_le_int16(container.length(), head.data() + REDO_BLOCK_NAME_OFF);
+  head.insert(head.end(), container.begin(), container.end());
+
+  return head;
+}
+
+
+uint64_t
+RedoLog::LogContainerSize(const string&    table,
+                          const uint64_t   epoch,
+                          const string&    container,
+                          const uint64_t   unitSize,
+                          const uint64_t   size)
+{
+  const vector<uint8_t> head = container_record_head(epoch, container, unitSize, size);
+
+  return Append(REDO_CONTAINER_SIZE, table, head.data(), head.size(), nullptr, 0, nullptr);
+}
+
+
+uint64_t
+RedoLog::LogBlockImage(const string&          table,
+                       const uint64_t         epoch,
+                       const string&          container,
+                       const uint64_t         unitSize,
+                       const uint64_t         offset,
+                       const uint8_t* const   content,
+                       const uint_t           size)
+{
+  const vector<uint8_t> head = container_record_head(epoch, container, unitSize, offset);
+
+  return Append(REDO_BLOCK_IMAGE, table, head.data(), head.size(), content, size, nullptr);
+}
+
+
+uint64_t
+RedoLog::LogTableSync(const string& table, const uint64_t epoch)
+{
+  uint8_t head[REDO_SYNC_HEAD_SIZE];
+
+  store_le_int64(epoch, head + REDO_SYNC_EPOCH_OFF);
+
+  return Append(REDO_TABLE_SYNC, table, head, sizeof head, nullptr, 0, nullptr);
+}
+
+
+uint64_t
+RedoLog::LogTableAlter(const string& table)
+{
+  return Append(REDO_TABLE_ALTER, table, nullptr, 0, nullptr, 0, nullptr);
+}
+
+
+void
+RedoLog::Commit(const uint64_t lsn)
+{
+  LockGuard<Lock> _l(mSync);
+
+  while (mDurableLsn < lsn)
+  {
+    if (mSyncInProgress)
+    {
+      //Someone else syncs the log file. Its sync might cover our records too.
+      mSyncDone.Wait(mSync);
+      continue;
+    }
+
+    mSyncInProgress = true;
+
+    const uint64_t syncLsn = mLastLsn;
+    bool locked = true;
+    try
+    {
+      WriteBuffer();
+
+      //Let the others append their records while we wait for the sync.
+      _l.unlock();
+      locked = false;
+
+      mFile.Sync();
+    }
+    catch (...)
+    {
+      if ( ! locked)
+        _l.lock();
+
+      mSyncInProgress = false;
+      mSyncDone.Broadcast();
+      throw;
+    }
+
+    _l.lock();
+
+    mDurableLsn = MAX(mDurableLsn, syncLsn);
+    mSyncInProgress = false;
+    mSyncDone.Broadcast();
+  }
+}
+
+
+void
+RedoLog::CommitWrite(const uint64_t lsn)
+{
+  if ((mDurability == DURABILITY_PER_WRITE) && (lsn > 0))
+    Commit(lsn);
+}
+
+
+void
+RedoLog::CommitProcedure()
+{
+  if (mDurability != DURABILITY_ASYNC)
+    Commit(LastLsn());
+}
+
+
+uint64_t
+RedoLog::BeginCheckpoint()
+{
+  LockGuard<Lock> _l(mSync);
+
+  mCheckpointOffset = mFileEnd + mBufferUsed;
+
+  return mLastLsn;
+}
+
+
+void
+RedoLog::EndCheckpoint(const uint64_t lsn)
+{
+  LockGuard<Lock> _l(mSync);
+
+  assert(lsn <= mLastLsn);
+
+  while (mSyncInProgress)
+    mSyncDone.Wait(mSync);
+
+  WriteBuffer();
+
+  assert(mCheckpointOffset <= mFileEnd);
+
+  mCheckpointLsn = lsn;
+  if (mCheckpointOffset == mFileEnd)
+  {
+    mFile.Size(REDO_HEADER_SIZE);
+    WriteHeader();
+    mFile.Sync();
+
+    mFileEnd = REDO_HEADER_SIZE;
+  }
+  else
+  {
+    //Some records were added while the tables were flushed. Keep them, but
+    //first make sure the ones already covered are skipped in any case.
+    WriteHeader();
+    mFile.Sync();
+
+    const string tempName = mFileName + REDO_TEMP_FILE_EXT;
+    const uint64_t tailSize = mFileEnd - mCheckpointOffset;
+    {
+      File tempFile(tempName.c_str(), WH_FILECREATE | WH_FILETRUNC | WH_FILERDWR);
+
+      uint8_t header[REDO_HEADER_SIZE];
+
+      fill_log_header(mCheckpointLsn, header);
+      tempFile.Write(header, sizeof header);
+
+      for (uint64_t copied = 0; copied < tailSize; )
+      {
+        const uint_t chunk = MIN(tailSize - copied, REDO_BUFFER_SIZE);
+
+        mFile.Seek(mCheckpointOffset + copied, WH_SEEK_BEGIN);
+        mFile.Read(mBuffer.get(), chunk);
+        tempFile.Write(mBuffer.get(), chunk);
+
+        copied += chunk;
+      }
+      tempFile.Sync();
+    }
+
+    mFile.Close();
+    whf_remove(mFileName.c_str());
+    whf_move_file(tempName.c_str(), mFileName.c_str());
+    mFile = File(mFileName.c_str(), WH_FILEOPEN_EXISTING | WH_FILERDWR);
+
+    mFileEnd = REDO_HEADER_SIZE + tailSize;
+  }
+
+  mCheckpointOffset = mFileEnd;
+  mDurableLsn = mLastLsn;
+}
+
+
+bool
+RedoLog::CanReplay(const string& fileName)
+{
+  if ( ! whf_file_exists(prepare_log_file(fileName).c_str()))
+    return false;
+
+  try
+  {
+    RedoLogReader reader(fileName);
+  }
+  catch (...)
+  {
+    return false;
+  }
+
+  return true;
+}
+
+
+void
+RedoLog::RemoveFiles(const string& fileName)
+{
+  whf_remove(fileName.c_str());
+  whf_remove((fileName + REDO_TEMP_FILE_EXT).c_str());
+}
+
+
+uint64_t
+RedoLog::LastLsn()
+{
+  LockGuard<Lock> _l(mSync);
+
+  return mLastLsn;
+}
+
+
+uint64_t
+RedoLog::DurableLsn()
+{
+  LockGuard<Lock> _l(mSync);
+
+  return mDurableLsn;
+}
+
+
+uint64_t
+RedoLog::CheckpointLsn()
+{
+  LockGuard<Lock> _l(mSync);
+
+  return mCheckpointLsn;
+}
+
+
+uint64_t
+RedoLog::Append(const uint_t          type,
+                const string&         table,
+                const uint8_t* const  head,
+                const uint_t          headSize,
+                const uint8_t* const  value,
+                const uint_t          valueSize,
+                IRedoContent* const   content)
+{
+  if (table.length() > 0xFFFF)
+  {
+    throw DBSException(_EXTRA(DBSException::OPER_NOT_SUPPORTED),
+                       "Cannot log the updates of a table with such a long name.");
+  }
+
+  LockGuard<Lock> _l(mSync);
+
+  const uint64_t contentSize = (content != nullptr) ? content->Size() : valueSize;
+  const uint64_t payloadSize = sizeof(uint16_t) + table.length() + headSize + contentSize;
+
+  if (payloadSize > 0xFFFFFFFFull)
+  {
+    throw DBSException(_EXTRA(DBSException::OPER_NOT_SUPPORTED),
+                       "Cannot log a value with %lu bytes.",
+                       _SC(long, contentSize));
+  }
+
+  const uint64_t lsn = mLastLsn + 1;
+
+  uint8_t header[REDO_REC_HEADER_SIZE];
+  memset(header, 0, sizeof header);
+  store_le_int32(payloadSize, header + REDO_REC_SIZE_OFF);
+  header[REDO_REC_TYPE_OFF] = type;
+  store_le_int64(lsn, header + REDO_REC_LSN_OFF);
+
+  uint8_t nameLen[sizeof(uint16_t)];
+  store_le_int16(table.length(), nameLen);
+
+  uint32_t checksum = CHECKSUM_INIT;
+
+  AppendBytes(header, sizeof header, &checksum);
+  AppendBytes(nameLen, sizeof nameLen, &checksum);
+  AppendBytes(_RC(const uint8_t*, table.c_str()), table.length(), &checksum);
+  AppendBytes(head, headSize, &checksum);
+
+  if (content != nullptr)
+  {
+    //Read the content straight in the log buffer.
+    for (uint64_t offset = 0; offset < contentSize; )
+    {
+      if (mBufferUsed == REDO_BUFFER_SIZE)
+        WriteBuffer();
+
+      const uint_t chunk = MIN(contentSize - offset, REDO_BUFFER_SIZE - mBufferUsed);
+      uint8_t* const dest = mBuffer.get() + mBufferUsed;
+
+      content->Read(offset, chunk, dest);
+      checksum = update_checksum(checksum, dest, chunk);
+
+      mBufferUsed += chunk, offset += chunk;
+    }
+  }
+  else
+    AppendBytes(value, valueSize, &checksum);
+
+  uint8_t trailer[REDO_REC_TRAILER_SIZE];
+  store_le_int32(checksum, trailer);
+
+  AppendBytes(trailer, sizeof trailer, nullptr);
+
+  return mLastLsn = lsn;
+}
+
+
+void
+RedoLog::AppendBytes(const uint8_t* data, uint64_t size, uint32_t* const inoutChecksum)
+{
+  if (inoutChecksum != nullptr)
+    *inoutChecksum = update_checksum(*inoutChecksum, data, size);
+
+  while (size > 0)
+  {
+    if (mBufferUsed == REDO_BUFFER_SIZE)
+      WriteBuffer();
+
+    const uint_t chunk = MIN(size, REDO_BUFFER_SIZE - mBufferUsed);
+
+    memcpy(mBuffer.get() + mBufferUsed, data, chunk);
+
+    mBufferUsed += chunk, data += chunk, size -= chunk;
+  }
+}
+
+
+void
+RedoLog::WriteBuffer()
+{
+  if (mBufferUsed == 0)
+    return;
+
+  mFile.Seek(mFileEnd, WH_SEEK_BEGIN);
+  mFile.Write(mBuffer.get(), mBufferUsed);
+
+  mFileEnd += mBufferUsed;
+  mBufferUsed = 0;
+}
+
+
+void
+RedoLog::WriteHeader()
+{
+  uint8_t header[REDO_HEADER_SIZE];
+
+  fill_log_header(mCheckpointLsn, header);
+
+  mFile.Seek(0, WH_SEEK_BEGIN);
+  mFile.Write(header, sizeof header);
+}
+
+
+
+TableJournal::TableJournal(RedoLog&        log,
+                           const string&   table,
+                           const string&   directory,
+                           const bool      logSyncs)
+  : mLog(log),
+    mTable(table),
+    mDirectory(directory),
+    mLogSyncs(logSyncs),
+    mEpoch(log.LastLsn()),
+    mStaging(false),
+    mStagedLsn(0),
+    mClosingLsn(0),
+    mClosingStagedLsn(0)
+{
+}
+
+
+TableJournal::~TableJournal()
+{
+  mLog.Commit(mStagedLsn);
+
+  //Some containers might outlive the table (e.g. its variable size store).
+  for (auto container : mAttached)
+  {
+    container->StageWrites(false);
+    container->WriteStaged();
+    container->Journal(nullptr);
+  }
+}
+
+
+void
+TableJournal::Attach(FileContainer& container)
+{
+  LockGuard<Lock> _l(mSync);
+
+  mAttached.insert( &container);
+  container.Journal(this);
+  container.StageWrites(mStaging);
+}
+
+
+void
+TableJournal::BeforeWrite(FileContainer& container, const uint64_t from, const uint64_t size)
+{
+  uint64_t lsn = 0;
+  {
+    LockGuard<Lock> _l(mSync);
+
+    auto it = mTouched.find( &container);
+    if (it == mTouched.end())
+    {
+      ContainerEpoch epoch;
+
+      epoch.mStartSize = container.Size();
+      epoch.mSizeLsn = mLog.LogContainerSize(mTable,
+                                             mEpoch,
+                                             ContainerName(container),
+                                             container.MaxFileSize(),
+                                             epoch.mStartSize);
+
+      it = mTouched.insert(make_pair( &container, epoch)).first;
+    }
+
+    ContainerEpoch& epoch = it->second;
+    const uint64_t currentSize = container.Size();
+    const uint64_t end = MIN(from + size, MIN(epoch.mStartSize, currentSize));
+
+    lsn = epoch.mSizeLsn;
+    for (uint64_t block = from / IMAGE_SIZE; block * IMAGE_SIZE < end; ++block)
+    {
+      auto image = epoch.mBlocksLsns.find(block);
+      if (image == epoch.mBlocksLsns.end())
+      {
+        uint8_t content[IMAGE_SIZE];
+
+        const uint64_t offset = block * IMAGE_SIZE;
+        const uint_t imageSize = MIN(IMAGE_SIZE, MIN(epoch.mStartSize, currentSize) - offset);
+
+        container.Read(offset, imageSize, content);
+
+        const uint64_t imageLsn = mLog.LogBlockImage(mTable,
+                                                     mEpoch,
+                                                     ContainerName(container),
+                                                     container.MaxFileSize(),
+                                                     offset,
+                                                     content,
+                                                     imageSize);
+
+        image = epoch.mBlocksLsns.insert(make_pair(block, imageLsn)).first;
+      }
+
+      lsn = MAX(lsn, image->second);
+    }
+
+    //Staged content reaches the files only after these are committed.
+    if (mStaging)
+    {
+      mStagedLsn = MAX(mStagedLsn, lsn);
+      return;
+    }
+  }
+
+  //The content about to be overwritten has to be in the log first.
+  mLog.Commit(lsn);
+}
+
+
+void
+TableJournal::BeforeRemoval(FileContainer& container)
+{
+  {
+    LockGuard<Lock> _l(mSync);
+
+    //Its files were created during this epoch, so their removal is undone
+    //anyway.
+    auto it = mTouched.find( &container);
+    if ((it != mTouched.end()) && (it->second.mStartSize == 0))
+      return;
+  }
+
+  MarkAltered();
+}
+
+
+void
+TableJournal::Detach(FileContainer& container)
+{
+  uint64_t stagedLsn;
+  {
+    LockGuard<Lock> _l(mSync);
+
+    mAttached.erase( &container);
+    mTouched.erase( &container);
+
+    stagedLsn = mStagedLsn;
+  }
+
+  //Its staged content does not wait for the others anymore.
+  LockGuard<Lock> _l(mClosingSync);
+
+  mLog.Commit(stagedLsn);
+
+  container.StageWrites(false);
+  container.WriteStaged();
+  if (mClosing.erase( &container) > 0)
+    container.Flush();
+}
+
+
+void
+TableJournal::MarkAltered()
+{
+  mLog.Commit(mLog.LogTableAlter(mTable));
+}
+
+
+void
+TableJournal::EndEpoch(const uint64_t lsn)
+{
+  {
+    LockGuard<Lock> _l(mSync);
+
+    if (mStaging)
+    {
+      LockGuard<Lock> _c(mClosingSync);
+
+      //What is still closing from a previous epoch is covered by this one.
+      for (auto& container : mTouched)
+        mClosing.insert(container.first);
+
+      for (auto container : mAttached)
+        container->StageWrites(false);
+
+      mClosingLsn = lsn;
+      mClosingStagedLsn = mStagedLsn;
+
+      mStaging = false;
+      mTouched.clear();
+      mEpoch = lsn;
+      return;
+    }
+  }
+
+  uint64_t closingLsn;
+  const bool closed = WriteClosing( &closingLsn);
+  {
+    LockGuard<Lock> _l(mSync);
+
+    if (mTouched.empty() && ! closed)
+    {
+      mEpoch = lsn;
+      return;
+    }
+
+    //Some content might be left staged by a canceled flush.
+    for (auto& container : mTouched)
+    {
+      container.first->WriteStaged();
+      container.first->Flush();
+    }
+
+    //From now on the blocks are logged again before being overwritten.
+    mTouched.clear();
+    mEpoch = lsn;
+  }
+
+  //A table being recovered does not have all its logged updates replayed
+  //yet, a new attempt has to start again from its last synchronisation.
+  if (mLogSyncs)
+    mLog.Commit(mLog.LogTableSync(mTable, lsn));
+}
+
+
+void
+TableJournal::BeginStaging()
+{
+  LockGuard<Lock> _l(mSync);
+
+  mStaging = true;
+  for (auto container : mAttached)
+    container->StageWrites(true);
+}
+
+
+void
+TableJournal::CancelStaging()
+{
+  uint64_t lsn;
+  {
+    LockGuard<Lock> _l(mSync);
+
+    if ( ! mStaging)
+      return;
+
+    mStaging = false;
+    for (auto container : mAttached)
+      container->StageWrites(false);
+
+    lsn = mStagedLsn;
+  }
+
+  //The staged content stays with the epoch and can be written any time now.
+  mLog.Commit(lsn);
+}
+
+
+void
+TableJournal::WriteStaged()
+{
+  uint64_t lsn;
+
+  if (WriteClosing( &lsn) && mLogSyncs)
+    mLog.Commit(mLog.LogTableSync(mTable, lsn));
+}
+
+
+bool
+TableJournal::WriteClosing(uint64_t* const outLsn)
+{
+  LockGuard<Lock> _l(mClosingSync);
+
+  if (mClosing.empty())
+    return false;
+
+  mLog.Commit(mClosingStagedLsn);
+
+  for (auto container : mClosing)
+  {
+    container->WriteStaged();
+    container->Flush();
+  }
+
+  mClosing.clear();
+  *outLsn = mClosingLsn;
+
+  return true;
+}
+
+
+string
+TableJournal::ContainerName(const FileContainer& container) const
+{
+  const string& name = container.BaseName();
+
+  if (name.compare(0, mDirectory.length(), mDirectory) == 0)
+    return name.substr(mDirectory.length());
+
+  return name;
+}
+
+
+
+RedoLogReader::RedoLogReader(const string& fileName)
+  : mFile(fileName.c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD),
+    mFileSize(mFile.Size()),
+    mOffset(REDO_HEADER_SIZE),
+    mCheckpointLsn(0)
+{
+  uint8_t header[REDO_HEADER_SIZE];
+
+  if (mFileSize >= sizeof header)
+  {
+    mFile.Seek(0, WH_SEEK_BEGIN);
+    mFile.Read(header, sizeof header);
+  }
+
+  if ((mFileSize < sizeof header)
+      || (memcmp(header + REDO_SIGNATURE_OFF, REDO_FILE_SIGNATURE, REDO_SIGNATURE_LEN) != 0))
+  {
+    throw DBSException(_EXTRA(DBSException::INAVLID_DATABASE),
+                       "File '%s' is not a valid redo log.",
+                       fileName.c_str());
+  }
+
+  const uint16_t versionMaj = load_le_int16(header + REDO_VER_MAJ_OFF);
+  if (versionMaj > REDO_VER_MAJ)
+  {
+    throw DBSException(_EXTRA(DBSException::OPER_NOT_SUPPORTED),
+                       "Cannot use a redo log with version %d.%d.",
+                       versionMaj,
+                       load_le_int16(header + REDO_VER_MIN_OFF));
+  }
+
+  mCheckpointLsn = load_le_int64(header + REDO_CHECKPOINT_OFF);
+}
+
+
+bool
+RedoLogReader::Next(RedoRecord& outRecord)
+{
+  while (mOffset + REDO_REC_HEADER_SIZE + REDO_REC_TRAILER_SIZE <= mFileSize)
+  {
+    uint8_t header[REDO_REC_HEADER_SIZE];
+
+    mFile.Seek(mOffset, WH_SEEK_BEGIN);
+    mFile.Read(header, sizeof header);
+
+    const uint64_t payloadSize = load_le_int32(header + REDO_REC_SIZE_OFF);
+    if (mOffset + REDO_REC_HEADER_SIZE + payloadSize + REDO_REC_TRAILER_SIZE > mFileSize)
+      return false;
+
+    mPayload.resize(payloadSize + REDO_REC_TRAILER_SIZE);
+    mFile.Read(mPayload.data(), mPayload.size());
+
+    uint32_t checksum = update_checksum(CHECKSUM_INIT, header, sizeof header);
+    checksum = update_checksum(checksum, mPayload.data(), payloadSize);
+
+    if (checksum != load_le_int32(mPayload.data() + payloadSize))
+      return false;
+
+    const uint64_t lsn = load_le_int64(header + REDO_REC_LSN_OFF);
+    if ( ! parse_record(header[REDO_REC_TYPE_OFF], lsn, mPayload.data(), payloadSize, outRecord))
+      return false;
+
+    mOffset += REDO_REC_HEADER_SIZE + payloadSize + REDO_REC_TRAILER_SIZE;
+
+    //Records already covered by the last checkpoint are not reported.
+    if (lsn > mCheckpointLsn)
+      return true;
+  }
+
+  return false;
+}
+
+
+} //namespace pastra
+} //namespace whais
@@ -0,0 +1,278 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef PS_REDOLOG_H_
+#define PS_REDOLOG_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "utils/wfile.h"
+#include "utils/wthread.h"
+#include "dbs/dbs_mgr.h"
+#include "ps_container.h"
+
+
+namespace whais {
+namespace pastra {
+
+
+enum REDO_RECORD_TYPE
+{
+  REDO_ROW_ADD          = 1,
+  REDO_FIELD_VALUE      = 2,
+  REDO_CONTAINER_SIZE   = 3,
+  REDO_BLOCK_IMAGE      = 4,
+  REDO_TABLE_SYNC       = 5,
+  REDO_TABLE_ALTER      = 6
+};
+
+
+/* A source for the content of a variable size value (e.g. a text or an array)
+ * that is copied in a redo record. */
+class IRedoContent
+{
+public:
+  virtual ~IRedoContent() = default;
+
+  virtual uint64_t Size() = 0;
+  virtual void Read(const uint64_t offset, const uint_t size, uint8_t* const buffer) = 0;
+};
+
+
+struct RedoRecord
+{
+  uint_t           mType;
+  uint64_t         mLsn;
+  std::string      mTable;
+  ROW_INDEX        mRow;
+  FIELD_INDEX      mField;
+  uint_t           mFieldType;
+  bool             mIsNull;
+  const uint8_t*   mValue;
+  uint64_t         mValueSize;
+
+  //For the records journaling the table's files.
+  uint64_t         mEpoch;
+  std::string      mContainer;
+  uint64_t         mUnitSize;
+  uint64_t         mOffset;
+};
+
+
+/* The log of the updates done on the persistent tables of a database. Every
+ * record gets a log sequence number (LSN). The records are kept in a memory
+ * buffer and are written to the log file when it fills up or when they are
+ * committed. Concurrent commits are grouped: the first one performs the file
+ * sync on behalf of all the others waiting for it.
+ * A checkpoint discards the records already covered by the tables' files. */
+class RedoLog
+{
+public:
+  RedoLog(const std::string& fileName, const DBS_DURABILITY durability);
+  ~RedoLog();
+
+  RedoLog(const RedoLog&) = delete;
+  RedoLog& operator= (const RedoLog&) = delete;
+
+  uint64_t LogRowAdd(const std::string& table, const ROW_INDEX row);
+  uint64_t LogFieldValue(const std::string&    table,
+                         const ROW_INDEX       row,
+                         const FIELD_INDEX     field,
+                         const uint_t          fieldType,
+                         const uint8_t* const  value,
+                         const uint_t          valueSize);
+  uint64_t LogFieldValue(const std::string&    table,
+                         const ROW_INDEX       row,
+                         const FIELD_INDEX     field,
+                         const uint_t          fieldType,
+                         IRedoContent&         content);
+
+  uint64_t LogContainerSize(const std::string&   table,
+                            const uint64_t       epoch,
+                            const std::string&   container,
+                            const uint64_t       unitSize,
+                            const uint64_t       size);
+  uint64_t LogBlockImage(const std::string&     table,
+                         const uint64_t         epoch,
+                         const std::string&     container,
+                         const uint64_t         unitSize,
+                         const uint64_t         offset,
+                         const uint8_t* const   content,
+                         const uint_t           size);
+  uint64_t LogTableSync(const std::string& table, const uint64_t epoch);
+  uint64_t LogTableAlter(const std::string& table);
+
+  //Makes durable all the records up to (and including) the specified one.
+  void Commit(const uint64_t lsn);
+  //Commit only if the durability level asks for it after a table update,
+  //respectively after a procedure call.
+  void CommitWrite(const uint64_t lsn);
+  void CommitProcedure();
+
+  //Returns the last record covered by the checkpoint. Once the tables were
+  //flushed, EndCheckpoint() discards the records up to this one.
+  uint64_t BeginCheckpoint();
+  void EndCheckpoint(const uint64_t lsn);
+
+  //Checks if a log file exists and its records can be replayed.
+  static bool CanReplay(const std::string& fileName);
+  //Removes a log file, including what an interrupted checkpoint left behind.
+  static void RemoveFiles(const std::string& fileName);
+
+  DBS_DURABILITY Durability() const { return mDurability; }
+  const std::string& FileName() const { return mFileName; }
+  uint64_t LastLsn();
+  uint64_t DurableLsn();
+  uint64_t CheckpointLsn();
+
+private:
+  uint64_t Append(const uint_t          type,
+                  const std::string&    table,
+                  const uint8_t* const  head,
+                  const uint_t          headSize,
+                  const uint8_t* const  value,
+                  const uint_t          valueSize,
+                  IRedoContent* const   content);
+  void AppendBytes(const uint8_t* data, uint64_t size, uint32_t* const inoutChecksum);
+  void WriteBuffer();
+  void WriteHeader();
+
+  const std::string             mFileName;
+  const DBS_DURABILITY          mDurability;
+  File                          mFile;
+  std::unique_ptr<uint8_t[]>    mBuffer;
+  uint_t                        mBufferUsed;
+  uint64_t                      mFileEnd;
+  uint64_t                      mCheckpointOffset;
+  uint64_t                      mCheckpointLsn;
+  uint64_t                      mLastLsn;
+  uint64_t                      mDurableLsn;
+  bool                          mSyncInProgress;
+  Lock                          mSync;
+  Condition                     mSyncDone;
+};
+
+
+/* Journals the changes on the files of a persistent table. The content of a
+ * block is logged before it is overwritten for the first time since the table
+ * was synchronised (an epoch), and the log is made durable before the block
+ * reaches the file. The LSN of every block's image is kept, so writing it again
+ * only waits for that record. With the containers' sizes, the images let the
+ * files of a table be brought back to their content at the end of the last
+ * epoch, for the logged updates to be replayed on them. */
+class TableJournal : public IContainerJournal
+{
+public:
+  static const uint_t IMAGE_SIZE = 4096;
+
+  TableJournal(RedoLog&             log,
+               const std::string&   table,
+               const std::string&   directory,
+               const bool           logSyncs);
+  virtual ~TableJournal() override;
+
+  TableJournal(const TableJournal&) = delete;
+  TableJournal& operator= (const TableJournal&) = delete;
+
+  virtual void Attach(FileContainer& container) override;
+  virtual void BeforeWrite(FileContainer& container, const uint64_t from, const uint64_t size) override;
+  virtual void BeforeRemoval(FileContainer& container) override;
+  virtual void Detach(FileContainer& container) override;
+
+  //The table files are about to be changed in a way the log cannot undo.
+  void MarkAltered();
+
+  //The updates logged up to this point are in the table's content.
+  uint64_t LastLsn() { return mLog.LastLsn(); }
+  //The table's content covering the updates up to the specified LSN was
+  //written. Makes it durable and begins a new epoch.
+  void EndEpoch(const uint64_t lsn);
+
+  //Until the epoch ends, what the table writes is kept in its containers'
+  //memory. The new epoch begins right away, but the staged content is made
+  //durable, and the epoch's end logged, only by WriteStaged(). This way the
+  //table does not have to be locked while its content reaches the disk.
+  void BeginStaging();
+  void CancelStaging();
+  void WriteStaged();
+
+private:
+  struct ContainerEpoch
+  {
+    uint64_t                       mStartSize;
+    uint64_t                       mSizeLsn;
+    std::map<uint64_t, uint64_t>   mBlocksLsns;
+  };
+
+  std::string ContainerName(const FileContainer& container) const;
+  bool WriteClosing(uint64_t* const outLsn);
+
+  RedoLog&                                   mLog;
+  const std::string                          mTable;
+  const std::string                          mDirectory;
+  const bool                                 mLogSyncs;
+  uint64_t                                   mEpoch;
+  std::set<FileContainer*>                   mAttached;
+  std::map<FileContainer*, ContainerEpoch>   mTouched;
+  bool                                       mStaging;
+  uint64_t                                   mStagedLsn;
+  Lock                                       mSync;
+
+  //The containers with staged content of an epoch that already ended.
+  std::set<FileContainer*>                   mClosing;
+  uint64_t                                   mClosingLsn;
+  uint64_t                                   mClosingStagedLsn;
+  Lock                                       mClosingSync;
+};
+
+
+/* Walks through the records of a log file. Stops at the end of the file or at
+ * the first record that is not complete or does not match its checksum. */
+class RedoLogReader
+{
+public:
+  explicit RedoLogReader(const std::string& fileName);
+
+  bool Next(RedoRecord& outRecord);
+
+  uint64_t CheckpointLsn() const { return mCheckpointLsn; }
+  uint64_t ValidSize() const { return mOffset; }
+
+private:
+  File                    mFile;
+  std::vector<uint8_t>    mPayload;
+  uint64_t                mFileSize;
+  uint64_t                mOffset;
+  uint64_t                mCheckpointLsn;
+};
+
+
+} //namespace pastra
+} //namespace whais
+
+#endif /* PS_REDOLOG_H_ */
@@ -0,0 +1,557 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+#include <algorithm>
+#include <iterator>
+
+#include "dbs/dbs_rowsset.h"
+
+
+using namespace std;
+
+
+namespace whais {
+
+
+//Past this count of rows a block keeps them in a bitmap, as it takes less.
+static const uint_t MAX_LIST_ROWS = 4096;
+static const uint_t BLOCK_ROWS    = 0x10000;
+static const uint_t BITMAP_WORDS  = BLOCK_ROWS / 64;
+static const uint_t FETCH_CHUNK   = 256;
+
+
+static uint_t
+bits_count(uint64_t word)
+{
+  word = word - ((word >> 1) & 0x5555555555555555ull);
+  word = (word & 0x3333333333333333ull) + ((word >> 2) & 0x3333333333333333ull);
+  word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+
+  return (word * 0x0101010101010101ull) >> 56;
+}
+
+
+static uint_t
+lowest_bit(const uint64_t word)
+{
+  assert(word != 0);
+
+  uint_t result = 0;
+  while ((word & (1ull << result)) == 0)
+    ++result;
+
+  return result;
+}
+
+
+bool
+RowsSet::Block::Contains(const uint16_t low) const
+{
+  if (IsBitmap())
+    return (mBits[low / 64] & (1ull << (low % 64))) != 0;
+
+  return binary_search(mLows.begin(), mLows.end(), low);
+}
+
+
+int
+RowsSet::Block::Next(const uint_t low) const
+{
+  if (low >= BLOCK_ROWS)
+    return -1;
+
+  if ( ! IsBitmap())
+  {
+    auto it = lower_bound(mLows.begin(), mLows.end(), low);
+    return (it == mLows.end()) ? -1 : *it;
+  }
+
+  uint_t word = low / 64;
+  uint64_t bits = mBits[word] & (~0ull << (low % 64));
+
+  while (bits == 0)
+  {
+    if (++word >= BITMAP_WORDS)
+      return -1;
+
+    bits = mBits[word];
+  }
+
+  return word * 64 + lowest_bit(bits);
+}
+
+
+void
+RowsSet::Block::Add(const uint16_t low)
+{
+  if (IsBitmap())
+  {
+    uint64_t& word = mBits[low / 64];
+    const uint64_t bit = 1ull << (low % 64);
+
+    if ((word & bit) == 0)
+      word |= bit, ++mCount;
+
+    return;
+  }
+
+  auto it = lower_bound(mLows.begin(), mLows.end(), low);
+  if ((it != mLows.end()) && (*it == low))
+    return;
+
+  mLows.insert(it, low);
+  if (++mCount > MAX_LIST_ROWS)
+    ToBitmap();
+}
+
+
+void
+RowsSet::Block::Remove(const uint16_t low)
+{
+  if (IsBitmap())
+  {
+    uint64_t& word = mBits[low / 64];
+    const uint64_t bit = 1ull << (low % 64);
+
+    if ((word & bit) != 0)
+      word &= ~bit, --mCount;
+
+    Pack();
+    return;
+  }
+
+  auto it = lower_bound(mLows.begin(), mLows.end(), low);
+  if ((it != mLows.end()) && (*it == low))
+    mLows.erase(it), --mCount;
+}
+
+
+void
+RowsSet::Block::AddRange(const uint_t from, const uint_t to)
+{
+  assert(from <= to);
+  assert(to < BLOCK_ROWS);
+
+  if ( ! IsBitmap() && (mCount + (to - from + 1) <= MAX_LIST_ROWS))
+  {
+    vector<uint16_t> range, result;
+
+    for (uint_t low = from; low <= to; ++low)
+      range.push_back(low);
+
+    set_union(mLows.begin(), mLows.end(), range.begin(), range.end(), back_inserter(result));
+
+    mLows.swap(result);
+    mCount = mLows.size();
+    return;
+  }
+
+  ToBitmap();
+  for (uint_t low = from; low <= to; ++low)
+    mBits[low / 64] |= 1ull << (low % 64);
+
+  mCount = 0;
+  for (auto word : mBits)
+    mCount += bits_count(word);
+}
+
+
+void
+RowsSet::Block::ToBitmap()
+{
+  if (IsBitmap())
+    return;
+
+  mBits.assign(BITMAP_WORDS, 0);
+  for (auto low : mLows)
+    mBits[low / 64] |= 1ull << (low % 64);
+
+  mLows = vector<uint16_t>();
+}
+
+
+void
+RowsSet::Block::Pack()
+{
+  if ( ! IsBitmap() || (mCount > MAX_LIST_ROWS))
+    return;
+
+  mLows.clear();
+  for (int low = Next(0); low >= 0; low = Next(low + 1))
+    mLows.push_back(low);
+
+  mBits = vector<uint64_t>();
+}
+
+
+size_t
+RowsSet::FindBlock(const uint32_t key) const
+{
+  size_t from = 0, to = mBlocks.size();
+
+  while (from < to)
+  {
+    const size_t middle = (from + to) / 2;
+
+    if (mBlocks[middle].mKey < key)
+      from = middle + 1;
+
+    else
+      to = middle;
+  }
+
+  return from;
+}
+
+
+RowsSet::Block&
+RowsSet::RetrieveBlock(const uint32_t key)
+{
+  auto it = mBlocks.begin() + FindBlock(key);
+
+  if ((it == mBlocks.end()) || (it->mKey != key))
+  {
+    it = mBlocks.insert(it, Block());
+    it->mKey = key;
+  }
+
+  return *it;
+}
+
+
+uint64_t
+RowsSet::Count() const
+{
+  uint64_t result = 0;
+
+  for (const auto& block : mBlocks)
+    result += block.mCount;
+
+  return result;
+}
+
+
+bool
+RowsSet::Contains(const ROW_INDEX row) const
+{
+  const uint32_t key = row / BLOCK_ROWS;
+
+  auto it = mBlocks.begin() + FindBlock(key);
+
+  return (it != mBlocks.end())
+         && (it->mKey == key)
+         && it->Contains(row % BLOCK_ROWS);
+}
+
+
+void
+RowsSet::Add(const ROW_INDEX row)
+{
+  RetrieveBlock(row / BLOCK_ROWS).Add(row % BLOCK_ROWS);
+}
+
+
+void
+RowsSet::Add(ROW_INDEX from, const ROW_INDEX to)
+{
+  if (to < from)
+    return;
+
+  while (true)
+  {
+    const uint32_t key = from / BLOCK_ROWS;
+    const uint_t last = (key == to / BLOCK_ROWS) ? to % BLOCK_ROWS : BLOCK_ROWS - 1;
+
+    RetrieveBlock(key).AddRange(from % BLOCK_ROWS, last);
+    if (key == to / BLOCK_ROWS)
+      break;
+
+    from = (key + 1) * BLOCK_ROWS;
+  }
+}
+
+
+void
+RowsSet::Remove(const ROW_INDEX row)
+{
+  const uint32_t key = row / BLOCK_ROWS;
+
+  auto it = mBlocks.begin() + FindBlock(key);
+  if ((it == mBlocks.end()) || (it->mKey != key))
+    return;
+
+  it->Remove(row % BLOCK_ROWS);
+  if (it->mCount == 0)
+    mBlocks.erase(it);
+}
+
+
+RowsSet&
+RowsSet::Unite(const RowsSet& set)
+{
+  if (&set == this)
+    return *this;
+
+  vector<Block> result;
+  auto first = mBlocks.begin();
+  auto second = set.mBlocks.begin();
+
+  while ((first != mBlocks.end()) || (second != set.mBlocks.end()))
+  {
+    if ((second == set.mBlocks.end())
+        || ((first != mBlocks.end()) && (first->mKey < second->mKey)))
+    {
+      result.push_back(move(*first++));
+      continue;
+    }
+    else if ((first == mBlocks.end()) || (second->mKey < first->mKey))
+    {
+      result.push_back(*second++);
+      continue;
+    }
+
+    Block block = move(*first++);
+    const Block& other = *second++;
+
+    if (block.IsBitmap() || other.IsBitmap() || (block.mCount + other.mCount > MAX_LIST_ROWS))
+    {
+      block.ToBitmap();
+      if (other.IsBitmap())
+      {
+        for (uint_t w = 0; w < BITMAP_WORDS; ++w)
+          block.mBits[w] |= other.mBits[w];
+      }
+      else
+      {
+        for (auto low : other.mLows)
+          block.mBits[low / 64] |= 1ull << (low % 64);
+      }
+
+      block.mCount = 0;
+      for (auto word : block.mBits)
+        block.mCount += bits_count(word);
+
+      block.Pack();
+    }
+    else
+    {
+      vector<uint16_t> lows;
+      set_union(block.mLows.begin(),
+                block.mLows.end(),
+                other.mLows.begin(),
+                other.mLows.end(),
+                back_inserter(lows));
+
+      block.mLows.swap(lows);
+      block.mCount = block.mLows.size();
+    }
+
+    result.push_back(move(block));
+  }
+
+  mBlocks.swap(result);
+  return *this;
+}
+
+
+RowsSet&
+RowsSet::Intersect(const RowsSet& set)
+{
+  if (&set == this)
+    return *this;
+
+  vector<Block> result;
+  auto first = mBlocks.begin();
+  auto second = set.mBlocks.begin();
+
+  while ((first != mBlocks.end()) && (second != set.mBlocks.end()))
+  {
+    if (first->mKey < second->mKey)
+    {
+      ++first;
+      continue;
+    }
+    else if (second->mKey < first->mKey)
+    {
+      ++second;
+      continue;
+    }
+
+    Block block = move(*first++);
+    const Block& other = *second++;
+
+    if (block.IsBitmap() && other.IsBitmap())
+    {
+      block.mCount = 0;
+      for (uint_t w = 0; w < BITMAP_WORDS; ++w)
+      {
+        block.mBits[w] &= other.mBits[w];
+        block.mCount += bits_count(block.mBits[w]);
+      }
+      block.Pack();
+    }
+    else if (block.IsBitmap() || other.IsBitmap())
+    {
+      const Block& bitmap = block.IsBitmap() ? block : other;
+      const Block& list = block.IsBitmap() ? other : block;
+
+      vector<uint16_t> lows;
+      for (auto low : list.mLows)
+      {
+        if (bitmap.Contains(low))
+          lows.push_back(low);
+      }
+
+      block.mBits = vector<uint64_t>();
+      block.mLows.swap(lows);
+      block.mCount = block.mLows.size();
+    }
+    else
+    {
+      vector<uint16_t> lows;
+      set_intersection(block.mLows.begin(),
+                       block.mLows.end(),
+                       other.mLows.begin(),
+                       other.mLows.end(),
+                       back_inserter(lows));
+
+      block.mLows.swap(lows);
+      block.mCount = block.mLows.size();
+    }
+
+    if (block.mCount > 0)
+      result.push_back(move(block));
+  }
+
+  mBlocks.swap(result);
+  return *this;
+}
+
+
+ROW_INDEX
+RowsSet::Next(const ROW_INDEX from) const
+{
+  ROW_INDEX result;
+
+  return (Fetch(from, 1, &result) > 0) ? result : INVALID_ROW_INDEX;
+}
+
+
+ROW_INDEX
+RowsSet::Last() const
+{
+  if (mBlocks.empty())
+    return INVALID_ROW_INDEX;
+
+  const Block& block = mBlocks.back();
+  if ( ! block.IsBitmap())
+    return block.mKey * BLOCK_ROWS + block.mLows.back();
+
+  uint_t word = BITMAP_WORDS;
+  while (block.mBits[--word] == 0)
+    ;
+
+  uint_t bit = 63;
+  while ((block.mBits[word] & (1ull << bit)) == 0)
+    --bit;
+
+  return block.mKey * BLOCK_ROWS + word * 64 + bit;
+}
+
+
+uint_t
+RowsSet::Fetch(const ROW_INDEX from, const uint_t count, ROW_INDEX* const outRows) const
+{
+  const uint32_t key = from / BLOCK_ROWS;
+
+  auto it = mBlocks.begin() + FindBlock(key);
+
+  uint_t result = 0;
+  for (; (it != mBlocks.end()) && (result < count); ++it)
+  {
+    const ROW_INDEX base = it->mKey * BLOCK_ROWS;
+    int low = it->Next((it->mKey == key) ? from % BLOCK_ROWS : 0);
+
+    while ((low >= 0) && (result < count))
+    {
+      outRows[result++] = base + low;
+      low = it->Next(low + 1);
+    }
+  }
+
+  return result;
+}
+
+
+DArray
+RowsSet::ToArray() const
+{
+  DArray result;
+
+  ROW_INDEX rows[FETCH_CHUNK];
+  DROW_INDEX values[FETCH_CHUNK];
+
+  uint_t count;
+  ROW_INDEX from = 0;
+  while ((count = Fetch(from, FETCH_CHUNK, rows)) > 0)
+  {
+    for (uint_t i = 0; i < count; ++i)
+      values[i] = DROW_INDEX(rows[i]);
+
+    result.Add(values, count);
+
+    if (rows[count - 1] == INVALID_ROW_INDEX - 1)
+      break;
+
+    from = rows[count - 1] + 1;
+  }
+
+  return result;
+}
+
+
+RowsSet
+RowsSet::FromArray(const DArray& rows)
+{
+  RowsSet result;
+
+  DROW_INDEX values[FETCH_CHUNK];
+
+  const auto count = rows.Count();
+  for (uint64_t i = 0; i < count; i += FETCH_CHUNK)
+  {
+    const auto chunkCount = rows.Get(i, FETCH_CHUNK, values);
+    for (uint_t j = 0; j < chunkCount; ++j)
+    {
+      if ( ! values[j].IsNull())
+        result.Add(values[j].mValue);
+    }
+  }
+
+  return result;
+}
+
+
+} //namespace whais
@@ -29,6 +29,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "dbs/dbs_values.h"
 #include "utils/endianness.h"
 #include "ps_serializer.h"
+#include "ps_btree_fields.h"
 
 
 using namespace std;
@@ -282,6 +283,22 @@ Serializer::Store(uint8_t* const dst, const DUInt64 &value)
   store_le_int64(value.mValue, dst);
 }
 
+void
+Serializer::Store(uint8_t* const dst, const TextIndexPrefix& value)
+{
+  assert(! value.IsNull());
+
+  memcpy(dst, value.mData, sizeof value.mData);
+}
+
+void
+Serializer::Store(uint8_t* const dst, const CompositeKey& value)
+{
+  assert(! value.IsNull());
+
+  memcpy(dst, value.RawKey(), CompositeKey::SIZE);
+}
+
 void
 Serializer::Load(const uint8_t* const src, DBool* outValue)
 {
@@ -425,6 +442,18 @@ Serializer::Load(const uint8_t* src, DUInt64* const outValue)
   new_integer(load_le_int64(src), outValue);
 }
 
+void
+Serializer::Load(const uint8_t* src, TextIndexPrefix* const outValue)
+{
+  memcpy(outValue->mData, src, sizeof outValue->mData);
+}
+
+void
+Serializer::Load(const uint8_t* src, CompositeKey* const outValue)
+{
+  *outValue = CompositeKey(src);
+}
+
 uint_t
 Serializer::Size(const DBS_FIELD_TYPE type, const bool isArray)
 {
@@ -529,5 +558,132 @@ Serializer::SelectValidator(const DBS_FIELD_TYPE itemType)
 }
 
 
+
+bool
+Serializer::IsWidening(const DBS_FIELD_TYPE from, const DBS_FIELD_TYPE to)
+{
+  if (is_time_related(from) && is_time_related(to))
+    return from < to;
+
+  else if (is_integer(from) && is_integer(to))
+  {
+    //An unsigned value fits in a wider signed one, but not the other way.
+    return (Size(from, false) < Size(to, false)) && (::is_unsigned(from) || ::is_signed(to));
+  }
+  else if (is_integer(from) && (to == T_REAL))
+    return Size(from, false) <= PS_INT32_SIZE;
+
+  else if (is_integer(from) && (to == T_RICHREAL))
+    return from != T_UINT64;
+
+  return (from == T_REAL) && (to == T_RICHREAL);
+}
+
+
+static int64_t
+load_widened_integer(const DBS_FIELD_TYPE type, const uint8_t* const src)
+{
+  switch (type)
+  {
+  case T_INT8:
+    return _SC(int8_t, src[0]);
+
+  case T_INT16:
+    return _SC(int16_t, load_le_int16(src));
+
+  case T_INT32:
+    return _SC(int32_t, load_le_int32(src));
+
+  case T_INT64:
+    return load_le_int64(src);
+
+  case T_UINT8:
+    return src[0];
+
+  case T_UINT16:
+    return load_le_int16(src);
+
+  case T_UINT32:
+    return load_le_int32(src);
+
+  default:
+    assert(false);
+  }
+
+  return 0;
+}
+
+
+void
+Serializer::Widen(const DBS_FIELD_TYPE   from,
+                  const uint8_t* const   src,
+                  const DBS_FIELD_TYPE   to,
+                  uint8_t* const         dst)
+{
+  assert(IsWidening(from, to));
+
+  if (from == T_DATE)
+  {
+    DDate date;
+    Load(src, &date);
+
+    if (to == T_DATETIME)
+      Store(dst, DDateTime(date));
+
+    else
+      Store(dst, DHiresTime(date));
+
+    return;
+  }
+  else if (from == T_DATETIME)
+  {
+    DDateTime time;
+    Load(src, &time);
+
+    Store(dst, DHiresTime(time));
+    return;
+  }
+  else if (from == T_REAL)
+  {
+    DReal real;
+    Load(src, &real);
+
+    Store(dst, DRichReal(real));
+    return;
+  }
+
+  const int64_t value = load_widened_integer(from, src);
+
+  switch (to)
+  {
+  case T_INT16:
+  case T_UINT16:
+    store_le_int16(value, dst);
+    break;
+
+  case T_INT32:
+  case T_UINT32:
+    store_le_int32(value, dst);
+    break;
+
+  case T_INT64:
+  case T_UINT64:
+    store_le_int64(value, dst);
+    break;
+
+  case T_REAL:
+    Store(dst, DReal(DBS_REAL_T(value)));
+    break;
+
+  case T_RICHREAL:
+    Store(dst, DRichReal(DBS_RICHREAL_T(value)));
+    break;
+
+  default:
+    assert(false);
+  }
+}
+
+
 } //namespace pastra
 } //namespace whais
@@ -28,6 +28,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <cstring>
 
 #include "dbs/dbs_values.h"
+#include "dbs/dbs_compositekey.h"
 #include "utils/endianness.h"
 
 namespace whais {
@@ -35,6 +36,8 @@ namespace pastra {
 
 typedef uint32_t NODE_INDEX;
 
+class TextIndexPrefix;
+
 class Serializer
 {
   Serializer() = delete;
@@ -58,6 +61,8 @@ public:
   static void Store(uint8_t* const dest, const DUInt16& value);
   static void Store(uint8_t* const dest, const DUInt32& value);
   static void Store(uint8_t* const dest, const DUInt64& value);
+  static void Store(uint8_t* const dest, const TextIndexPrefix& value);
+  static void Store(uint8_t* const dest, const CompositeKey& value);
 
   static void Load(const uint8_t* const src, DBool* const outValue);
   static void Load(const uint8_t* const src, DChar* const outValue);
@@ -74,6 +79,8 @@ public:
   static void Load(const uint8_t* const src, DUInt16* const outValue);
   static void Load(const uint8_t* const src, DUInt32* const outValue);
   static void Load(const uint8_t* const src, DUInt64* const outValue);
+  static void Load(const uint8_t* const src, TextIndexPrefix* const outValue);
+  static void Load(const uint8_t* const src, CompositeKey* const outValue);
 
   static uint_t Size(const DBS_FIELD_TYPE type, const bool isArray);
 
@@ -270,6 +277,13 @@ public:
 
   static VALUE_VALIDATOR SelectValidator(const DBS_FIELD_TYPE type);
 
+  //Tells if any stored value of type 'from' can be kept by type 'to'.
+  static bool IsWidening(const DBS_FIELD_TYPE from, const DBS_FIELD_TYPE to);
+  static void Widen(const DBS_FIELD_TYPE   from,
+                    const uint8_t* const   src,
+                    const DBS_FIELD_TYPE   to,
+                    uint8_t* const         dst);
+
   static const int MAX_VALUE_RAW_SIZE = 0x20;
 };
 
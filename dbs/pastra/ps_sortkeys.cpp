@@ -0,0 +1,894 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+#include "utils/endianness.h"
+#include "utils/wsort.h"
+#include "utils/wunicode.h"
+#include "utils/wutf.h"
+
+#include "ps_sortkeys.h"
+
+
+using namespace std;
+
+namespace whais {
+namespace pastra {
+
+
+static const uint8_t KEY_NULL_VALUE       = 0x00;
+static const uint8_t KEY_VALUE            = 0x01;
+static const uint8_t KEY_TEXT_END         = 0x00;
+static const uint8_t KEY_TEXT_CHAR        = 0x01;
+
+static const uint_t KEY_SIZE_LEN          = sizeof(uint32_t);
+static const uint_t KEY_ROW_LEN           = sizeof(uint64_t);
+
+static const uint64_t MIN_KEYS_CAPACITY   = 64 * 1024;
+static const uint_t MIN_RUN_KEYS          = 1024;
+static const uint_t RUN_BUFFER_SIZE       = 64 * 1024;
+
+static uint64_t sRunsCount;
+
+
+static int
+compare_keys(const uint8_t* const key1, const uint8_t* const key2)
+{
+  const uint32_t size1 = load_le_int32(key1);
+  const uint32_t size2 = load_le_int32(key2);
+
+  const int result = memcmp(key1 + KEY_SIZE_LEN, key2 + KEY_SIZE_LEN, MIN(size1, size2));
+  if (result != 0)
+    return result;
+
+  return (size1 < size2) ? -1 : ((size1 > size2) ? 1 : 0);
+}
+
+
+static ROW_INDEX
+key_row(const uint8_t* const key)
+{
+  const uint32_t size = load_le_int32(key);
+
+  assert(size >= KEY_ROW_LEN);
+
+  return load_ge_int64(key + KEY_SIZE_LEN + size - KEY_ROW_LEN);
+}
+
+
+class KeysLess
+{
+public:
+  explicit KeysLess(const uint8_t* const keys)
+    : mKeys(keys)
+  {
+  }
+
+  bool operator() (const uint64_t offset1, const uint64_t offset2) const
+  {
+    return compare_keys(mKeys + offset1, mKeys + offset2) < 0;
+  }
+
+private:
+  const uint8_t* mKeys;
+};
+
+
+class RowsSortKeys::RunReader
+{
+public:
+  explicit RunReader(IDataContainer& run)
+    : mRun(run),
+      mRunSize(run.Size()),
+      mReadPosition(0),
+      mBuffer(new uint8_t[RUN_BUFFER_SIZE]),
+      mBufferOffset(0),
+      mBufferSize(0)
+  {
+  }
+
+  bool Next()
+  {
+    if ((mReadPosition == mRunSize) && (mBufferOffset == mBufferSize))
+      return false;
+
+    mKey.resize(KEY_SIZE_LEN);
+    Read(mKey.data(), KEY_SIZE_LEN);
+
+    const uint32_t keySize = load_le_int32(mKey.data());
+
+    mKey.resize(KEY_SIZE_LEN + keySize);
+    Read(mKey.data() + KEY_SIZE_LEN, keySize);
+
+    return true;
+  }
+
+  const uint8_t* Key() const { return mKey.data(); }
+
+private:
+  void Read(uint8_t* dest, uint64_t size)
+  {
+    while (size > 0)
+    {
+      if (mBufferOffset == mBufferSize)
+      {
+        mBufferSize = MIN(RUN_BUFFER_SIZE, mRunSize - mReadPosition);
+        if (mBufferSize == 0)
+          throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
+
+        mRun.Read(mReadPosition, mBufferSize, mBuffer.get());
+        mReadPosition += mBufferSize;
+        mBufferOffset = 0;
+      }
+
+      const uint_t chunkSize = MIN(size, mBufferSize - mBufferOffset);
+
+      memcpy(dest, mBuffer.get() + mBufferOffset, chunkSize);
+
+      mBufferOffset += chunkSize;
+      dest += chunkSize;
+      size -= chunkSize;
+    }
+  }
+
+  IDataContainer&               mRun;
+  const uint64_t                mRunSize;
+  uint64_t                      mReadPosition;
+  vector<uint8_t>               mKey;
+  unique_ptr<uint8_t[]>         mBuffer;
+  uint_t                        mBufferOffset;
+  uint_t                        mBufferSize;
+};
+
+
+class RowsSortKeys::RunsGreater
+{
+public:
+  explicit RunsGreater(const vector<unique_ptr<RunReader>>& readers)
+    : mReaders(readers)
+  {
+  }
+
+  bool operator() (const uint_t run1, const uint_t run2) const
+  {
+    return compare_keys(mReaders[run1]->Key(), mReaders[run2]->Key()) > 0;
+  }
+
+private:
+  const vector<unique_ptr<RunReader>>& mReaders;
+};
+
+
+
+//The characters are compared alphabetically, like wh_cmp_alphabetically()
+//does: first the upper case of their canonical form, then their canonical
+//form and at last their code points.
+static void
+char_key(const uint32_t codePoint, uint8_t* const outKey)
+{
+  const uint32_t canonical = wh_to_canonical(codePoint);
+  const uint32_t upperCase = wh_to_uppercase(canonical);
+
+  for (uint_t i = 0; i < 3; ++i)
+  {
+    const uint_t shift = 8 * (2 - i);
+
+    outKey[i] = (upperCase >> shift) & 0xFF;
+    outKey[3 + i] = (canonical >> shift) & 0xFF;
+    outKey[6 + i] = (codePoint >> shift) & 0xFF;
+  }
+}
+
+
+static uint_t
+null_key(uint8_t* const outKey)
+{
+  outKey[0] = KEY_NULL_VALUE;
+
+  return 1;
+}
+
+
+uint_t
+sort_key_value(const DBool& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  outKey[1] = value.mValue ? 1 : 0;
+
+  return 2;
+}
+
+
+uint_t
+sort_key_value(const DChar& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  char_key(value.mValue, outKey + 1);
+
+  return 10;
+}
+
+
+uint_t
+sort_key_value(const DDate& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  store_ge_int16(_SC(uint16_t, value.mYear) ^ 0x8000, outKey + 1);
+  outKey[3] = value.mMonth;
+  outKey[4] = value.mDay;
+
+  return 5;
+}
+
+
+uint_t
+sort_key_value(const DDateTime& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  store_ge_int16(_SC(uint16_t, value.mYear) ^ 0x8000, outKey + 1);
+  outKey[3] = value.mMonth;
+  outKey[4] = value.mDay;
+  outKey[5] = value.mHour;
+  outKey[6] = value.mMinutes;
+  outKey[7] = value.mSeconds;
+
+  return 8;
+}
+
+
+uint_t
+sort_key_value(const DHiresTime& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  store_ge_int16(_SC(uint16_t, value.mYear) ^ 0x8000, outKey + 1);
+  outKey[3] = value.mMonth;
+  outKey[4] = value.mDay;
+  outKey[5] = value.mHour;
+  outKey[6] = value.mMinutes;
+  outKey[7] = value.mSeconds;
+  store_ge_int32(value.mMicrosec, outKey + 8);
+
+  return 12;
+}
+
+
+uint_t
+sort_key_value(const DInt8& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  outKey[1] = _SC(uint8_t, value.mValue) ^ 0x80;
+
+  return 2;
+}
+
+
+uint_t
+sort_key_value(const DInt16& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  store_ge_int16(_SC(uint16_t, value.mValue) ^ 0x8000, outKey + 1);
+
+  return 3;
+}
+
+
+uint_t
+sort_key_value(const DInt32& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  store_ge_int32(_SC(uint32_t, value.mValue) ^ 0x80000000u, outKey + 1);
+
+  return 5;
+}
+
+
+uint_t
+sort_key_value(const DInt64& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  store_ge_int64(_SC(uint64_t, value.mValue) ^ 0x8000000000000000ull, outKey + 1);
+
+  return 9;
+}
+
+
+uint_t
+sort_key_value(const DUInt8& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  outKey[1] = value.mValue;
+
+  return 2;
+}
+
+
+uint_t
+sort_key_value(const DUInt16& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  store_ge_int16(value.mValue, outKey + 1);
+
+  return 3;
+}
+
+
+uint_t
+sort_key_value(const DUInt32& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  store_ge_int32(value.mValue, outKey + 1);
+
+  return 5;
+}
+
+
+uint_t
+sort_key_value(const DUInt64& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  store_ge_int64(value.mValue, outKey + 1);
+
+  return 9;
+}
+
+
+uint_t
+sort_key_value(const DReal& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  store_ge_int64(_SC(uint64_t, value.mValue.Integer()) ^ 0x8000000000000000ull, outKey + 1);
+  store_ge_int64(_SC(uint64_t, value.mValue.Fractional()) ^ 0x8000000000000000ull, outKey + 9);
+
+  return 17;
+}
+
+
+uint_t
+sort_key_value(const DRichReal& value, uint8_t* const outKey)
+{
+  if (value.IsNull())
+    return null_key(outKey);
+
+  outKey[0] = KEY_VALUE;
+  store_ge_int64(_SC(uint64_t, value.mValue.Integer()) ^ 0x8000000000000000ull, outKey + 1);
+  store_ge_int64(_SC(uint64_t, value.mValue.Fractional()) ^ 0x8000000000000000ull, outKey + 9);
+
+  return 17;
+}
+
+
+uint_t
+sort_key_size(const DBS_FIELD_TYPE type)
+{
+  switch (type)
+  {
+  case T_BOOL:
+  case T_INT8:
+  case T_UINT8:
+    return 2;
+
+  case T_INT16:
+  case T_UINT16:
+    return 3;
+
+  case T_DATE:
+  case T_INT32:
+  case T_UINT32:
+    return 5;
+
+  case T_DATETIME:
+    return 8;
+
+  case T_INT64:
+  case T_UINT64:
+    return 9;
+
+  case T_CHAR:
+    return 10;
+
+  case T_HIRESTIME:
+    return 12;
+
+  case T_REAL:
+  case T_RICHREAL:
+    return 17;
+
+  default:
+    return 0;
+  }
+}
+
+
+
+RowsSortKeys::RowsSortKeys(const uint_t threadsCount)
+  : mBudget(TempMemoryBudget::Current()),
+    mKeyStart(0),
+    mReservedMemory(0),
+    mThreadsCount(MAX(threadsCount, 1u))
+{
+  const uint8_t keySize[KEY_SIZE_LEN] = {0, };
+
+  AddBytes(keySize, sizeof keySize, false);
+}
+
+
+RowsSortKeys::~RowsSortKeys()
+{
+  ReleaseMemory();
+}
+
+
+void
+RowsSortKeys::AddNull(const bool reverse)
+{
+  AddBytes( &KEY_NULL_VALUE, sizeof KEY_NULL_VALUE, reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DBool& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DChar& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DDate& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DDateTime& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DHiresTime& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DInt8& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DInt16& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DInt32& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DInt64& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DUInt8& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DUInt16& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DUInt32& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DUInt64& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DReal& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::Add(const DRichReal& value, const bool reverse)
+{
+  uint8_t key[SORT_KEY_MAX_SIZE];
+
+  AddBytes(key, sort_key_value(value, key), reverse);
+}
+
+
+void
+RowsSortKeys::AddText(const uint8_t* const utf8, const uint64_t utf8Count, const bool reverse)
+{
+  if (utf8Count == 0)
+    return AddNull(reverse);
+
+  AddBytes( &KEY_VALUE, sizeof KEY_VALUE, reverse);
+
+  //Every character is marked, so a text sorts before the ones it prefixes.
+  uint64_t offset = 0;
+  while (offset < utf8Count)
+  {
+    uint32_t codePoint;
+    const uint_t cuCount = wh_load_utf8_cp(utf8 + offset, &codePoint);
+
+    if ((cuCount == 0) || (offset + cuCount > utf8Count))
+      throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
+
+    AddBytes( &KEY_TEXT_CHAR, sizeof KEY_TEXT_CHAR, reverse);
+    AddChar(codePoint, reverse);
+
+    offset += cuCount;
+  }
+
+  AddBytes( &KEY_TEXT_END, sizeof KEY_TEXT_END, reverse);
+}
+
+
+void
+RowsSortKeys::CommitKey(const ROW_INDEX row)
+{
+  uint8_t rowKey[KEY_ROW_LEN];
+  store_ge_int64(row, rowKey);
+
+  AddBytes(rowKey, sizeof rowKey, false);
+
+  store_le_int32(mKeys.size() - mKeyStart - KEY_SIZE_LEN, mKeys.data() + mKeyStart);
+
+  if (mKeysOffsets.size() == mKeysOffsets.capacity())
+  {
+    uint64_t capacity = MAX(2 * mKeysOffsets.capacity(), _SC(uint64_t, MIN_RUN_KEYS));
+
+    if ( ! ReserveMemory((capacity - mKeysOffsets.capacity()) * sizeof(uint64_t))
+        && (mKeysOffsets.size() >= MIN_RUN_KEYS))
+    {
+      SpillRun();
+
+      capacity = MIN_RUN_KEYS;
+      ReserveMemory(capacity * sizeof(uint64_t));
+    }
+    mKeysOffsets.reserve(capacity);
+  }
+
+  mKeysOffsets.push_back(mKeyStart);
+
+  //Leave room for the size of the next key.
+  const uint8_t keySize[KEY_SIZE_LEN] = {0, };
+
+  mKeyStart = mKeys.size();
+  AddBytes(keySize, sizeof keySize, false);
+}
+
+
+void
+RowsSortKeys::Sort(vector<ROW_INDEX>& outRows)
+{
+  mKeys.resize(mKeyStart);
+
+  if (mRuns.empty())
+  {
+    SortRun();
+
+    outRows.resize(mKeysOffsets.size());
+    for (uint64_t k = 0; k < mKeysOffsets.size(); ++k)
+      outRows[k] = key_row(mKeys.data() + mKeysOffsets[k]);
+  }
+  else
+  {
+    if ( ! mKeysOffsets.empty())
+      SpillRun();
+
+    MergeRuns(outRows);
+  }
+
+  vector<uint8_t>().swap(mKeys);
+  vector<uint64_t>().swap(mKeysOffsets);
+  mRuns.clear();
+
+  ReleaseMemory();
+}
+
+
+void
+RowsSortKeys::AddBytes(const uint8_t* const data, const uint_t size, const bool reverse)
+{
+  if (mKeys.size() + size > mKeys.capacity())
+    ExtendKeys(size);
+
+  const uint64_t offset = mKeys.size();
+
+  mKeys.resize(offset + size);
+  if (reverse)
+  {
+    for (uint_t i = 0; i < size; ++i)
+      mKeys[offset + i] = ~data[i];
+  }
+  else
+    memcpy(mKeys.data() + offset, data, size);
+}
+
+
+void
+RowsSortKeys::ExtendKeys(const uint_t size)
+{
+  //Account the memory before it is used. When the budget is exhausted the
+  //completed keys are moved to a temporal file, and only then the current one
+  //is allowed to grow regardless.
+  uint64_t capacity = MAX(2 * mKeys.capacity(), mKeys.size() + size + MIN_KEYS_CAPACITY);
+
+  if ( ! ReserveMemory(capacity - mKeys.capacity()))
+  {
+    if (mKeysOffsets.size() >= MIN_RUN_KEYS)
+      SpillRun();
+
+    capacity = MAX(mKeys.capacity(), mKeys.size() + size + MIN_KEYS_CAPACITY);
+    ReserveMemory(capacity - mKeys.capacity());
+  }
+
+  mKeys.reserve(capacity);
+}
+
+
+void
+RowsSortKeys::AddChar(const uint32_t codePoint, const bool reverse)
+{
+  uint8_t key[9];
+
+  char_key(codePoint, key);
+  AddBytes(key, sizeof key, reverse);
+}
+
+
+void
+RowsSortKeys::SortRun()
+{
+  parallel_sort(mKeysOffsets.data(),
+                mKeysOffsets.size(),
+                mThreadsCount,
+                KeysLess(mKeys.data()));
+}
+
+
+void
+RowsSortKeys::SpillRun()
+{
+  assert(mKeysOffsets.size() > 0);
+
+  SortRun();
+
+  const uint64_t runId = wh_atomic_fetch_inc64(_RC(int64_t*, &sRunsCount));
+  const DBSSettings& settings = DBSGetSeettings();
+  const string baseName = settings.mTempDir + "wsort" + to_string(runId) + ".tmp";
+
+  unique_ptr<TemporalFileContainer> run(new TemporalFileContainer(baseName.c_str(),
+                                                                  settings.mMaxFileSize));
+  unique_ptr<uint8_t[]> buffer(new uint8_t[RUN_BUFFER_SIZE]);
+  uint_t bufferUsed = 0;
+
+  for (uint64_t k = 0; k < mKeysOffsets.size(); ++k)
+  {
+    const uint8_t* key = mKeys.data() + mKeysOffsets[k];
+    uint64_t keySize = KEY_SIZE_LEN + load_le_int32(key);
+
+    while (keySize > 0)
+    {
+      const uint_t chunkSize = MIN(keySize, RUN_BUFFER_SIZE - bufferUsed);
+
+      memcpy(buffer.get() + bufferUsed, key, chunkSize);
+      bufferUsed += chunkSize;
+      key += chunkSize;
+      keySize -= chunkSize;
+
+      if (bufferUsed == RUN_BUFFER_SIZE)
+      {
+        run->Write(run->Size(), bufferUsed, buffer.get());
+        bufferUsed = 0;
+      }
+    }
+  }
+
+  if (bufferUsed > 0)
+    run->Write(run->Size(), bufferUsed, buffer.get());
+
+  Budget().NotifySpill(run->Size());
+  mRuns.push_back(move(run));
+
+  //Keep only the key still being built.
+  vector<uint8_t> currentKey(mKeys.begin() + mKeyStart, mKeys.end());
+
+  mKeys.swap(currentKey);
+  vector<uint64_t>().swap(mKeysOffsets);
+
+  ReleaseMemory();
+  ReserveMemory(mKeys.capacity());
+
+  mKeyStart = 0;
+}
+
+
+bool
+RowsSortKeys::ReserveMemory(const uint64_t size)
+{
+  if ( ! Budget().Reserve(size))
+    return false;
+
+  mReservedMemory += size;
+  return true;
+}
+
+
+void
+RowsSortKeys::ReleaseMemory()
+{
+  if (mReservedMemory == 0)
+    return;
+
+  Budget().Release(mReservedMemory);
+  mReservedMemory = 0;
+}
+
+
+void
+RowsSortKeys::MergeRuns(vector<ROW_INDEX>& outRows)
+{
+  vector<unique_ptr<RunReader>> readers;
+  vector<uint_t> heap;
+
+  for (auto& run : mRuns)
+  {
+    readers.push_back(unique_ptr<RunReader>(new RunReader( *run)));
+    if (readers.back()->Next())
+      heap.push_back(readers.size() - 1);
+  }
+
+  const RunsGreater greater(readers);
+  make_heap(heap.begin(), heap.end(), greater);
+
+  outRows.clear();
+  while ( ! heap.empty())
+  {
+    pop_heap(heap.begin(), heap.end(), greater);
+
+    const uint_t run = heap.back();
+    outRows.push_back(key_row(readers[run]->Key()));
+
+    if (readers[run]->Next())
+      push_heap(heap.begin(), heap.end(), greater);
+
+    else
+      heap.pop_back();
+  }
+}
+
+
+} //namespace pastra
+} //namespace whais
@@ -0,0 +1,140 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef PS_SORTKEYS_H_
+#define PS_SORTKEYS_H_
+
+#include <memory>
+#include <vector>
+
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_values.h"
+
+#include "ps_container.h"
+
+
+namespace whais {
+namespace pastra {
+
+
+//The biggest size of a not text value's key.
+static const uint_t SORT_KEY_MAX_SIZE = 17;
+
+/* Write a value's key, in a form where two keys compare byte by byte like
+ * their values do, the null values being the smallest ones. Returns the key
+ * size. The composite indexes keep their fields' values the same way. */
+uint_t sort_key_value(const DBool& value, uint8_t* const outKey);
+uint_t sort_key_value(const DChar& value, uint8_t* const outKey);
+uint_t sort_key_value(const DDate& value, uint8_t* const outKey);
+uint_t sort_key_value(const DDateTime& value, uint8_t* const outKey);
+uint_t sort_key_value(const DHiresTime& value, uint8_t* const outKey);
+uint_t sort_key_value(const DInt8& value, uint8_t* const outKey);
+uint_t sort_key_value(const DInt16& value, uint8_t* const outKey);
+uint_t sort_key_value(const DInt32& value, uint8_t* const outKey);
+uint_t sort_key_value(const DInt64& value, uint8_t* const outKey);
+uint_t sort_key_value(const DUInt8& value, uint8_t* const outKey);
+uint_t sort_key_value(const DUInt16& value, uint8_t* const outKey);
+uint_t sort_key_value(const DUInt32& value, uint8_t* const outKey);
+uint_t sort_key_value(const DUInt64& value, uint8_t* const outKey);
+uint_t sort_key_value(const DReal& value, uint8_t* const outKey);
+uint_t sort_key_value(const DRichReal& value, uint8_t* const outKey);
+
+//The key size of a not null value of a type, or 0 for the text values.
+uint_t sort_key_size(const DBS_FIELD_TYPE type);
+
+
+/* Holds the keys of the rows to be sorted. A row's key is built once from
+ * the values of the sorted fields, in a form where two keys compare byte by
+ * byte like their values do, and it ends with the row index so no two keys
+ * are equal. The keys are kept in memory until the temporal memory budget is
+ * exhausted; then they are sorted and moved into a temporal file, and the
+ * sorted runs are merged at the end. */
+class RowsSortKeys
+{
+public:
+  explicit RowsSortKeys(const uint_t threadsCount);
+  ~RowsSortKeys();
+
+  RowsSortKeys(const RowsSortKeys&) = delete;
+  RowsSortKeys& operator= (const RowsSortKeys&) = delete;
+
+  //Add the value of the next sorted field of the current row's key.
+  void AddNull(const bool reverse);
+  void Add(const DBool& value, const bool reverse);
+  void Add(const DChar& value, const bool reverse);
+  void Add(const DDate& value, const bool reverse);
+  void Add(const DDateTime& value, const bool reverse);
+  void Add(const DHiresTime& value, const bool reverse);
+  void Add(const DInt8& value, const bool reverse);
+  void Add(const DInt16& value, const bool reverse);
+  void Add(const DInt32& value, const bool reverse);
+  void Add(const DInt64& value, const bool reverse);
+  void Add(const DUInt8& value, const bool reverse);
+  void Add(const DUInt16& value, const bool reverse);
+  void Add(const DUInt32& value, const bool reverse);
+  void Add(const DUInt64& value, const bool reverse);
+  void Add(const DReal& value, const bool reverse);
+  void Add(const DRichReal& value, const bool reverse);
+  void AddText(const uint8_t* const utf8, const uint64_t utf8Count, const bool reverse);
+
+  //Ends the current key.
+  void CommitKey(const ROW_INDEX row);
+
+  //Returns the rows in the order given by their keys.
+  void Sort(std::vector<ROW_INDEX>& outRows);
+
+  uint_t SpilledRunsCount() const { return mRuns.size(); }
+
+private:
+  class RunReader;
+  class RunsGreater;
+
+  void AddBytes(const uint8_t* const data, const uint_t size, const bool reverse);
+  void AddChar(const uint32_t codePoint, const bool reverse);
+  void ExtendKeys(const uint_t size);
+  void SortRun();
+  void SpillRun();
+  bool ReserveMemory(const uint64_t size);
+  void ReleaseMemory();
+  void MergeRuns(std::vector<ROW_INDEX>& outRows);
+
+  TempMemoryBudget& Budget()
+  {
+    return mBudget ? *mBudget : TempMemoryBudget::ServerBudget();
+  }
+
+  std::vector<uint8_t>                                  mKeys;
+  std::vector<uint64_t>                                 mKeysOffsets;
+  std::vector<std::unique_ptr<TemporalFileContainer>>   mRuns;
+  std::shared_ptr<TempMemoryBudget>                     mBudget;
+  uint64_t                                              mKeyStart;
+  uint64_t                                              mReservedMemory;
+  const uint_t                                          mThreadsCount;
+};
+
+
+} //namespace pastra
+} //namespace whais
+
+#endif /* PS_SORTKEYS_H_ */
@@ -26,15 +26,18 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <cassert>
 #include <cstring>
 #include <vector>
+#include <map>
 #include <algorithm>
 
 #include "utils/wfile.h"
 #include "utils/endianness.h"
 #include "utils/wutf.h"
+#include "utils/wthread.h"
 #include "dbs/dbs_mgr.h"
 #include "dbs_exception.h"
 #include "ps_table.h"
 #include "ps_serializer.h"
+#include "ps_sortkeys.h"
 
 
 using namespace std;
@@ -46,6 +49,9 @@ namespace pastra {
 static const char PS_TEMP_TABLE_SUFFIX[]   = "pttable_";
 static const char PS_TABLE_FIXFIELDS_EXT[] = "_f";
 static const char PS_TABLE_VARFIELDS_EXT[] = "_v";
+static const char PS_TABLE_MIGRATION_EXT[] = "_mig";
+static const char PS_TABLE_LEGACY_EXT[]    = "_old";
+static const char PS_TABLE_COMPOSITE_EXT[] = "_ci";
 static const uint8_t PS_TABLE_SIGNATURE[]  = { 0x50, 0x41, 0x53, 0x54, 0x52, 0x41, 0x54, 0x42 };
 
 static const uint_t PS_HEADER_SIZE = 128;
@@ -72,12 +78,53 @@ static const uint_t PS_TABLE_ROW_SIZE_OFF          = 56;
 static const uint_t PS_TABLE_ROW_SIZE_LEN          = 4;
 static const uint_t PS_TABLE_FLAGS_OFF             = 60;
 static const uint_t PS_TABLE_FLAGS_LEN             = 4;
-
-static const uint_t PS_RESEVED_FOR_FUTURE_OFF   = 64;
+static const uint_t PS_TABLE_VARSTORAGE_VER_OFF    = 64;
+static const uint_t PS_TABLE_VARSTORAGE_VER_LEN    = 4;
+
+static const uint_t PS_TABLE_LEGACY_ROW_SIZE_OFF   = 68;
+static const uint_t PS_TABLE_LEGACY_ROW_SIZE_LEN   = 4;
+static const uint_t PS_TABLE_LEGACY_ROWS_OFF       = 72;
+static const uint_t PS_TABLE_LEGACY_ROWS_LEN       = 8;
+static const uint_t PS_TABLE_RETYPED_FIELD_OFF     = 80;
+static const uint_t PS_TABLE_RETYPED_FIELD_LEN     = 2;
+static const uint_t PS_TABLE_RETYPED_TYPE_OFF      = 82;
+static const uint_t PS_TABLE_RETYPED_TYPE_LEN      = 2;
+static const uint_t PS_TABLE_RETYPED_DATA_OFF      = 84;
+static const uint_t PS_TABLE_RETYPED_DATA_LEN      = 4;
+
+static const uint_t PS_RESEVED_FOR_FUTURE_OFF   = 88;
 static const uint_t PS_RESEVED_FOR_FUTURE_LEN   = PS_HEADER_SIZE - PS_RESEVED_FOR_FUTURE_OFF;
 
 static const uint32_t PS_TABLE_MODIFIED_MASK    = 1;
 static const uint32_t PS_TABLE_TO_REPAIR_MASK   = 2;
+//The fields layout was changed in place, it's not the one of a new table.
+static const uint32_t PS_TABLE_ALTERED_MASK     = 4;
+
+
+static LegacyRowsLayout
+load_legacy_rows_layout(const uint8_t* const header)
+{
+  LegacyRowsLayout result;
+
+  result.mRowSize          = load_le_int32(header + PS_TABLE_LEGACY_ROW_SIZE_OFF);
+  result.mRowsCount        = load_le_int64(header + PS_TABLE_LEGACY_ROWS_OFF);
+  result.mRetypedField     = load_le_int16(header + PS_TABLE_RETYPED_FIELD_OFF);
+  result.mRetypedFieldType = load_le_int16(header + PS_TABLE_RETYPED_TYPE_OFF);
+  result.mRetypedFieldOff  = load_le_int32(header + PS_TABLE_RETYPED_DATA_OFF);
+
+  return result;
+}
+
+
+static void
+store_legacy_rows_layout(const LegacyRowsLayout& layout, uint8_t* const header)
+{
+  store_le_int32(layout.mRowSize,          header + PS_TABLE_LEGACY_ROW_SIZE_OFF);
+  store_le_int64(layout.mRowsCount,        header + PS_TABLE_LEGACY_ROWS_OFF);
+  store_le_int16(layout.mRetypedField,     header + PS_TABLE_RETYPED_FIELD_OFF);
+  store_le_int16(layout.mRetypedFieldType, header + PS_TABLE_RETYPED_TYPE_OFF);
+  store_le_int32(layout.mRetypedFieldOff,  header + PS_TABLE_RETYPED_DATA_OFF);
+}
 
 
 
@@ -371,9 +418,12 @@ create_table_file(const uint64_t                    maxFileSize,
   store_le_int64(~(uint64_t)0,    header + PS_TABLE_MAINTABLE_SIZE_OFF);
   store_le_int32(0,               header + PS_TABLE_FLAGS_OFF);
 
+  store_le_int32(VariableSizeStore::FORMAT_VERSION, header + PS_TABLE_VARSTORAGE_VER_OFF);
+
   assert(sizeof(NODE_INDEX) == PS_TABLE_BT_HEAD_LEN);
   assert(sizeof(NODE_INDEX) == PS_TABLE_BT_ROOT_LEN);
 
+  store_legacy_rows_layout(LegacyRowsLayout(), header);
   memset(header + PS_RESEVED_FOR_FUTURE_OFF, 0, PS_RESEVED_FOR_FUTURE_LEN);
 
   //Write the first header part to reserve the space!
@@ -395,15 +445,87 @@ create_table_file(const uint64_t                    maxFileSize,
 }
 
 
+//The fields of an altered table are not placed like the ones of a new table.
+//There is nothing to guess from, so they are only checked for consistency.
+static uint_t
+check_altered_table_fields(const FieldDescriptor* const   fields,
+                           const uint_t                   fieldsCount,
+                           const FIX_ERROR_CALLBACK       fixCallback)
+{
+  static const uint_t NOT_FIXED = 0;
+  const auto descriptorBase = _RC(const char*, fields);
+
+  vector<pair<uint_t, uint_t>> usedBytes;
+  uint_t rowSize = 0;
+
+  for (uint_t i = 0; i < fieldsCount; ++i)
+  {
+    const uint_t dataSize = Serializer::Size(_SC(DBS_FIELD_TYPE, GET_BASE_TYPE(fields[i].Type())),
+                                             IS_ARRAY(fields[i].Type()));
+
+    usedBytes.push_back(make_pair(fields[i].RowDataOff(), fields[i].RowDataOff() + dataSize));
+    rowSize = MAX(rowSize, fields[i].RowDataOff() + dataSize);
+  }
+
+  for (uint_t i = 0; i < fieldsCount; ++i)
+  {
+    const uint_t nullByte = fields[i].NullBitIndex() / 8;
+
+    for (uint_t j = 0; j < fieldsCount; ++j)
+    {
+      if ((i != j) && (fields[i].NullBitIndex() == fields[j].NullBitIndex()))
+      {
+        fixCallback(CRITICAL,
+                    "Fields '%s' and '%s' share the same null bit.",
+                    descriptorBase + fields[i].NameOffset(),
+                    descriptorBase + fields[j].NameOffset());
+        return NOT_FIXED;
+      }
+    }
+    usedBytes.push_back(make_pair(nullByte, nullByte + 1));
+  }
+
+  sort(usedBytes.begin(), usedBytes.end());
+
+  uint_t usedEnd = 0;
+  for (uint_t i = 0; i < usedBytes.size(); ++i)
+  {
+    //The null bits of different fields may share the same byte.
+    if ((usedBytes[i].first < usedEnd) && (usedBytes[i - 1] != usedBytes[i]))
+    {
+      fixCallback(CRITICAL,
+                  "The fields data overlaps at offset %u of the table rows.",
+                  usedBytes[i].first);
+      return NOT_FIXED;
+    }
+    usedEnd = MAX(usedEnd, usedBytes[i].second);
+  }
+
+  for (uint_t i = 0; i < fieldsCount; ++i)
+  {
+    fixCallback(INFORMATION,
+                "Field '%s' data offset set at '%u'.",
+                descriptorBase + fields[i].NameOffset(),
+                fields[i].RowDataOff());
+  }
+
+  return rowSize;
+}
+
+
 static uint_t
 repair_table_fields(FieldDescriptor* const           fields,
                     uint_t                           fieldsCount,
+                    const bool                       altered,
                     const FIX_ERROR_CALLBACK         fixCallback)
 {
   static const uint_t NOT_FIXED = 0;
   const auto descriptorBase = _RC(const char*, fields);
   uint_t rowSize = (fieldsCount + 7) / 8;
 
+  if (altered)
+    return check_altered_table_fields(fields, fieldsCount, fixCallback);
+
   for (uint_t i = 0; i < fieldsCount; ++i)
   {
     const char* const fieldName = descriptorBase + fields[i].NameOffset();
@@ -556,7 +678,8 @@ repair_table_header(const string&              name,
     return false;
   }
 
-  const uint_t rowSize = repair_table_fields(fds, fieldsCount, fixCallback);
+  const bool altered = (load_le_int32(header + PS_TABLE_FLAGS_OFF) & PS_TABLE_ALTERED_MASK) != 0;
+  const uint_t rowSize = repair_table_fields(fds, fieldsCount, altered, fixCallback);
   if (rowSize == 0)
     return false;
 
@@ -585,8 +708,8 @@ repair_table_header(const string&              name,
 
   uint64_t vsSize = load_le_int64(header + PS_TABLE_VARSTORAGE_SIZE_OFF);
 
-  vsSize /= sizeof(StoreEntry);
-  vsSize *= sizeof(StoreEntry);
+  vsSize /= VariableSizeStore::UNIT_SIZE;
+  vsSize *= VariableSizeStore::UNIT_SIZE;
 
   store_le_int64(vsSize, header + PS_TABLE_VARSTORAGE_SIZE_OFF);
 
@@ -604,6 +727,423 @@ repair_table_header(const string&              name,
 }
 
 
+static void
+remove_container_files(const string& baseFile)
+{
+  for (uint_t unit = 0; ; ++unit)
+  {
+    string fileName = baseFile;
+
+    if (unit != 0)
+      append_int_to_str(unit, fileName);
+
+    if ( ! whf_file_exists(fileName.c_str()))
+      return;
+
+    if ( ! whf_remove(fileName.c_str()))
+    {
+      throw WFileContainerException(_EXTRA(WFileContainerException::FILE_OS_IO_ERROR),
+                                    "Failed to remove file '%s'.",
+                                    fileName.c_str());
+    }
+  }
+}
+
+
+static void
+replace_container_files(const string& baseFile, const string& newBaseFile)
+{
+  remove_container_files(baseFile);
+
+  for (uint_t unit = 0; ; ++unit)
+  {
+    string fileName = baseFile, newFileName = newBaseFile;
+
+    if (unit != 0)
+    {
+      append_int_to_str(unit, fileName);
+      append_int_to_str(unit, newFileName);
+    }
+
+    if ( ! whf_file_exists(newFileName.c_str()))
+      return;
+
+    whf_move_file(newFileName.c_str(), fileName.c_str());
+    if ( ! whf_file_exists(fileName.c_str()))
+    {
+      throw WFileContainerException(_EXTRA(WFileContainerException::FILE_OS_IO_ERROR),
+                                    "Failed to move file '%s' to '%s'.",
+                                    newFileName.c_str(),
+                                    fileName.c_str());
+    }
+  }
+}
+
+
+static string
+composite_container_name(const string&                     fileNamePrefix,
+                         const FieldDescriptor* const      fds,
+                         const vector<FIELD_INDEX>&        fields)
+{
+  string result = fileNamePrefix + '_';
+
+  for (size_t i = 0; i < fields.size(); ++i)
+  {
+    if (i > 0)
+      result += '+';
+
+    result += _RC(const char*, fds) + fds[fields[i]].NameOffset();
+  }
+
+  return result + "_bt";
+}
+
+
+//The composite indexes are listed aside from the table header. For each one
+//there are its fields count, its node size in KB, its containers units count
+//and its fields. The file is missing if the table has no composite indexes.
+//It is rewritten only if its content changes, in which case the journal of
+//the table (if any) is told first, as the log cannot undo it.
+static void
+store_composite_indexes(const string&                    fileName,
+                        const vector<CompositeIndex>&    indexes,
+                        const uint64_t                   maxFileSize,
+                        TableJournal* const              journal)
+{
+  if (indexes.empty())
+  {
+    if (whf_file_exists(fileName.c_str()))
+    {
+      if (journal != nullptr)
+        journal->MarkAltered();
+
+      remove_container_files(fileName);
+    }
+    return;
+  }
+
+  vector<uint8_t> content(sizeof(uint16_t));
+
+  store_le_int16(indexes.size(), content.data());
+  for (const auto& index : indexes)
+  {
+    uint8_t header[2 * sizeof(uint16_t) + sizeof(uint32_t)];
+
+    uint64_t unitsCount = maxFileSize - 1;
+
+    unitsCount += index.mNodeMgr->IndexRawSize();
+    unitsCount /= maxFileSize;
+
+    store_le_int16(index.mFields.size(), header);
+    store_le_int16(index.mNodeMgr->NodeRawSize() / 1024, header + sizeof(uint16_t));
+    store_le_int32(unitsCount, header + 2 * sizeof(uint16_t));
+    content.insert(content.end(), header, header + sizeof header);
+
+    for (auto field : index.mFields)
+    {
+      uint8_t data[sizeof(uint16_t)];
+
+      store_le_int16(field, data);
+      content.insert(content.end(), data, data + sizeof data);
+    }
+  }
+
+  if (whf_file_exists(fileName.c_str()))
+  {
+    File file(fileName.c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD);
+
+    if (file.Size() == content.size())
+    {
+      vector<uint8_t> stored(content.size());
+
+      file.Read(stored.data(), stored.size());
+      if (stored == content)
+        return;
+    }
+  }
+
+  if (journal != nullptr)
+    journal->MarkAltered();
+
+  File file(fileName.c_str(), WH_FILECREATE | WH_FILETRUNC | WH_FILERDWR);
+  file.Write(content.data(), content.size());
+}
+
+
+struct CompositeIndexEntry
+{
+  vector<FIELD_INDEX>   mFields;
+  uint_t                mNodeSizeKB;
+  uint32_t              mUnitsCount;
+};
+
+
+static bool
+load_composite_indexes(const string& fileName, vector<CompositeIndexEntry>& outEntries)
+{
+  outEntries.clear();
+
+  if ( ! whf_file_exists(fileName.c_str()))
+    return true;
+
+  File file(fileName.c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD);
+  vector<uint8_t> content(file.Size());
+
+  file.Read(content.data(), content.size());
+
+  const uint8_t* data = content.data();
+  const uint8_t* const end = data + content.size();
+
+  if (data + sizeof(uint16_t) > end)
+    return false;
+
+  uint_t indexesCount = load_le_int16(data);
+  data += sizeof(uint16_t);
+
+  while (indexesCount-- > 0)
+  {
+    if (data + 2 * sizeof(uint16_t) + sizeof(uint32_t) > end)
+      return false;
+
+    CompositeIndexEntry entry;
+
+    const uint_t fieldsCount = load_le_int16(data);
+    entry.mNodeSizeKB = load_le_int16(data + sizeof(uint16_t));
+    entry.mUnitsCount = load_le_int32(data + 2 * sizeof(uint16_t));
+    data += 2 * sizeof(uint16_t) + sizeof(uint32_t);
+
+    if ((fieldsCount < 2)
+        || (entry.mNodeSizeKB == 0)
+        || (data + fieldsCount * sizeof(uint16_t) > end))
+    {
+      return false;
+    }
+
+    for (uint_t f = 0; f < fieldsCount; ++f, data += sizeof(uint16_t))
+      entry.mFields.push_back(load_le_int16(data));
+
+    outEntries.push_back(entry);
+  }
+
+  return data == end;
+}
+
+
+//Converts the variable size store of a table to the current format. The rows
+//are rewritten to refer the new records. Both are built aside and swapped at
+//the end. Returns the size of the new store.
+static uint64_t
+migrate_variable_store(const string&                  fileNamePrefix,
+                       const uint64_t                 vsSize,
+                       const uint64_t                 maxFileSize,
+                       const FieldDescriptor* const   fields,
+                       const FIELD_INDEX              fieldsCount,
+                       const uint32_t                 rowSize,
+                       const ROW_INDEX                rowsCount,
+                       const bool                     dropInvalid)
+{
+  static const ROW_INDEX MIGRATION_CHUNK_ROWS = 1024;
+
+  const string vsFile = fileNamePrefix + PS_TABLE_VARFIELDS_EXT;
+  const string rowsFile = fileNamePrefix + PS_TABLE_FIXFIELDS_EXT;
+
+  //Some leftovers of an interrupted migration.
+  remove_container_files(vsFile + PS_TABLE_MIGRATION_EXT);
+  remove_container_files(rowsFile + PS_TABLE_MIGRATION_EXT);
+
+  uint64_t result;
+  {
+    FileContainer legacyStore(vsFile.c_str(),
+                              maxFileSize,
+                              (vsSize + maxFileSize - 1) / maxFileSize,
+                              false);
+    FileContainer rowsData(rowsFile.c_str(),
+                           maxFileSize,
+                           ((rowSize * rowsCount) + maxFileSize - 1) / maxFileSize,
+                           false);
+    FileContainer newRowsData((rowsFile + PS_TABLE_MIGRATION_EXT).c_str(), maxFileSize, 0, false);
+
+    VariableSizeStore store;
+    store.Init((vsFile + PS_TABLE_MIGRATION_EXT).c_str(), 0, maxFileSize);
+
+    //Some records could be shared by more rows.
+    map<uint64_t, uint64_t> importedRecords;
+
+    const ROW_INDEX rowsToMigrate = MIN(rowsCount, rowsData.Size() / rowSize);
+    unique_ptr<uint8_t[]> chunkData(unique_array_make(uint8_t,
+                                                      MIGRATION_CHUNK_ROWS * rowSize));
+
+    for (ROW_INDEX firstRow = 0; firstRow < rowsToMigrate; firstRow += MIGRATION_CHUNK_ROWS)
+    {
+      const ROW_INDEX chunkRows = MIN(MIGRATION_CHUNK_ROWS, rowsToMigrate - firstRow);
+
+      rowsData.Read(firstRow * rowSize, chunkRows * rowSize, chunkData.get());
+      for (ROW_INDEX i = 0; i < chunkRows; ++i)
+      {
+        uint8_t* const rowData = chunkData.get() + i * rowSize;
+
+        for (FIELD_INDEX field = 0; field < fieldsCount; ++field)
+        {
+          const FieldDescriptor& fd = fields[field];
+          const uint_t byteOff = fd.NullBitIndex() / 8;
+          const uint_t bitOff = fd.NullBitIndex() % 8;
+          uint8_t* const fieldData = rowData + fd.RowDataOff();
+
+          if (( ! IS_ARRAY(fd.Type()) && (GET_BASE_TYPE(fd.Type()) != T_TEXT))
+              || ((rowData[byteOff] & (1 << bitOff)) != 0))
+          {
+            continue;
+          }
+
+          const uint64_t entry = load_le_int64(fieldData);
+          const uint64_t size = load_le_int64(fieldData + sizeof(uint64_t));
+
+          //Small values are kept in the row itself.
+          if (size & 0x8000000000000000ull)
+            continue;
+
+          uint64_t record = 0;
+
+          auto it = importedRecords.find(entry);
+          if (it != importedRecords.end())
+          {
+            record = it->second;
+            store.IncrementRecordRef(record);
+          }
+          else
+          {
+            record = store.ImportLegacyRecord(legacyStore, entry, size);
+            if (record != 0)
+              importedRecords.insert(make_pair(entry, record));
+          }
+
+          if (record == 0)
+          {
+            if ( ! dropInvalid)
+            {
+              throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY),
+                                 "Failed to convert the value of row %u of table '%s'.",
+                                 _SC(uint_t, firstRow + i),
+                                 fileNamePrefix.c_str());
+            }
+
+            rowData[byteOff] |= (1 << bitOff);
+            continue;
+          }
+
+          store_le_int64(record, fieldData);
+        }
+      }
+
+      newRowsData.Write(firstRow * rowSize, chunkRows * rowSize, chunkData.get());
+    }
+
+    store.Flush();
+    result = store.Size();
+  }
+
+  replace_container_files(rowsFile, rowsFile + PS_TABLE_MIGRATION_EXT);
+  replace_container_files(vsFile, vsFile + PS_TABLE_MIGRATION_EXT);
+
+  return result;
+}
+
+
+static uint_t
+container_units_count(const string& baseFile)
+{
+  uint_t result = 0;
+
+  while (true)
+  {
+    string fileName = baseFile;
+
+    if (result != 0)
+      append_int_to_str(result, fileName);
+
+    if ( ! whf_file_exists(fileName.c_str()))
+      return result;
+
+    ++result;
+  }
+}
+
+
+//Finishes the conversion of the rows left with the layout the table had
+//before being altered, when the table could not be opened to do it.
+static void
+convert_legacy_rows(const string&                  rowsFile,
+                    const uint64_t                 maxFileSize,
+                    const LegacyRowsLayout&        layout,
+                    const FieldDescriptor* const   fields,
+                    const uint32_t                 rowSize)
+{
+  static const ROW_INDEX CONVERSION_CHUNK_ROWS = 1024;
+
+  const string legacyFile = rowsFile + PS_TABLE_LEGACY_EXT;
+
+  //The table was altered, but its rows were not moved aside yet.
+  if ( ! whf_file_exists(legacyFile.c_str()))
+  {
+    replace_container_files(legacyFile, rowsFile);
+    FileContainer::Fix(rowsFile.c_str(), maxFileSize, _SC(uint64_t, layout.mRowsCount) * rowSize);
+  }
+
+  {
+    FileContainer legacyData(legacyFile.c_str(),
+                             maxFileSize,
+                             container_units_count(legacyFile),
+                             false);
+    FileContainer rowsData(rowsFile.c_str(), maxFileSize, container_units_count(rowsFile), false);
+
+    const ROW_INDEX rowsToConvert = MIN(_SC(uint64_t, layout.mRowsCount),
+                                        rowsData.Size() / rowSize);
+    const ROW_INDEX legacyRows = MIN(_SC(uint64_t, layout.mRowsCount),
+                                     legacyData.Size() / layout.mRowSize);
+
+    unique_ptr<uint8_t[]> chunkData(unique_array_make(uint8_t, CONVERSION_CHUNK_ROWS * rowSize));
+    unique_ptr<uint8_t[]> legacyChunk(unique_array_make(uint8_t,
+                                                        CONVERSION_CHUNK_ROWS * layout.mRowSize));
+
+    for (ROW_INDEX firstRow = 0; firstRow < rowsToConvert; firstRow += CONVERSION_CHUNK_ROWS)
+    {
+      const ROW_INDEX chunkRows = MIN(CONVERSION_CHUNK_ROWS, rowsToConvert - firstRow);
+
+      rowsData.Read(firstRow * rowSize, chunkRows * rowSize, chunkData.get());
+
+      //The legacy rows lost with a damaged file are left with null values.
+      memset(legacyChunk.get(), 0xFF, chunkRows * layout.mRowSize);
+      if (firstRow < legacyRows)
+      {
+        legacyData.Read(firstRow * layout.mRowSize,
+                        MIN(chunkRows, legacyRows - firstRow) * layout.mRowSize,
+                        legacyChunk.get());
+      }
+
+      for (ROW_INDEX i = 0; i < chunkRows; ++i)
+      {
+        uint8_t* const rowData = chunkData.get() + i * rowSize;
+
+        if (rowData[layout.mRowSize] == 0)
+        {
+          convert_legacy_row(layout,
+                             fields,
+                             legacyChunk.get() + i * layout.mRowSize,
+                             rowSize,
+                             rowData);
+        }
+      }
+
+      rowsData.Write(firstRow * rowSize, chunkRows * rowSize, chunkData.get());
+    }
+
+    rowsData.Flush();
+  }
+
+  remove_container_files(legacyFile);
+}
+
+
 class RepairTableNodeManager : public TemporalTable
 {
   /* This class is declared to reuse as much as possible the code used to build
@@ -713,16 +1253,23 @@ private:
 
 DBSFieldDescriptor RepairTableNodeManager::field = {"dummy", T_BOOL, FALSE};
 
-PersistentTable::PersistentTable(DbsHandler& dbs, const string& name)
+PersistentTable::PersistentTable(DbsHandler& dbs, const string& name, const bool recovering)
   : PrototypeTable(dbs),
     mDbsSettings(DBSGetSeettings()),
     mMaxFileSize(0),
     mVSDataSize(0),
+    mVSDataVersion(VariableSizeStore::FORMAT_VERSION),
+    mName(name),
     mFileNamePrefix(dbs.WorkingDir() + name),
+    mJournal((dbs.GetRedoLog() != nullptr)
+               ? new TableJournal( *dbs.GetRedoLog(), name, dbs.WorkingDir(), ! recovering)
+               : nullptr),
     mVSData(nullptr),
-    mRemoved(false)
+    mRemoved(false),
+    mLayoutAltered(false),
+    mRecovering(recovering)
 {
-  InitFromFile(name);
+  InitFromFile(name, recovering);
 
   if (mMaxFileSize != dbs.MaxFileSize())
   {
@@ -759,12 +1306,19 @@ PersistentTable::PersistentTable(DbsHandler&                       dbs,
     mDbsSettings(DBSGetSeettings()),
     mMaxFileSize(0),
     mVSDataSize(0),
+    mVSDataVersion(VariableSizeStore::FORMAT_VERSION),
+    mName(name),
     mFileNamePrefix(dbs.WorkingDir() + name),
+    mJournal((dbs.GetRedoLog() != nullptr)
+               ? new TableJournal( *dbs.GetRedoLog(), name, dbs.WorkingDir(), true)
+               : nullptr),
     mVSData(nullptr),
-    mRemoved(false)
+    mRemoved(false),
+    mLayoutAltered(false),
+    mRecovering(false)
 {
   create_table_file(dbs.MaxFileSize(), mFileNamePrefix.c_str(), inoutFields, fieldsCount);
-  InitFromFile(name);
+  InitFromFile(name, false);
 
   assert(mTableData.get() != nullptr);
 
@@ -785,24 +1339,22 @@ PersistentTable::PersistentTable(DbsHandler&                       dbs,
 
 PersistentTable::~PersistentTable()
 {
+  //The flush records the indexes units counts too, nothing is written after.
   Flush();
 
+  if (mVSData != nullptr)
+    mVSData->MarkClosed();
+
   for (FIELD_INDEX fieldIndex = 0; fieldIndex < mFieldsCount; ++fieldIndex)
   {
-    if (mvIndexNodeMgrs[fieldIndex] != nullptr)
-    {
-      FieldDescriptor& field = GetFieldDescriptorInternal(fieldIndex);
-
-      uint64_t unitsCount = mMaxFileSize - 1;
-
-      unitsCount += mvIndexNodeMgrs[fieldIndex]->IndexRawSize();
-      unitsCount /= mMaxFileSize;
-
-      field.IndexUnitsCount(unitsCount);
-      delete mvIndexNodeMgrs[fieldIndex];
-    }
+    delete mvIndexNodeMgrs[fieldIndex];
+    delete mvHashIndexes[fieldIndex];
+    delete mvBitmapIndexes[fieldIndex];
   }
-  MakeHeaderPersistent();
+
+  MakeCompositeIndexesPersistent();
+  for (auto& index : mvCompositeIndexes)
+    delete index.mNodeMgr;
 }
 
 
@@ -825,7 +1377,7 @@ PersistentTable::Spawn() const
 
 
 void
-PersistentTable::InitFromFile(const string& tableName)
+PersistentTable::InitFromFile(const string& tableName, const bool recovering)
 {
   uint64_t mainTableSize = 0;
   uint8_t tableHdr[PS_HEADER_SIZE];
@@ -845,11 +1397,14 @@ PersistentTable::InitFromFile(const string& tableName)
   mDescriptorsSize = load_le_int32(tableHdr + PS_TABLE_ELEMS_SIZE_OFF);
   mRowsCount       = load_le_int64(tableHdr + PS_TABLE_ROWS_COUNT_OFF);
   mVSDataSize      = load_le_int64(tableHdr + PS_TABLE_VARSTORAGE_SIZE_OFF);
+  mVSDataVersion   = load_le_int32(tableHdr + PS_TABLE_VARSTORAGE_VER_OFF);
   mRowSize         = load_le_int32(tableHdr + PS_TABLE_ROW_SIZE_OFF);
   mRootNode        = load_le_int32(tableHdr + PS_TABLE_BT_ROOT_OFF);
   mUnallocatedHead = load_le_int32(tableHdr + PS_TABLE_BT_HEAD_OFF);
   mMaxFileSize     = load_le_int64(tableHdr + PS_TABLE_MAX_FILE_SIZE_OFF);
   mainTableSize    = load_le_int64(tableHdr + PS_TABLE_MAINTABLE_SIZE_OFF);
+  mLegacyRows      = load_legacy_rows_layout(tableHdr);
+  mLayoutAltered   = (load_le_int32(tableHdr + PS_TABLE_FLAGS_OFF) & PS_TABLE_ALTERED_MASK) != 0;
 
   if (mFieldsCount == 0
      || mDescriptorsSize < sizeof(FieldDescriptor) * mFieldsCount
@@ -859,7 +1414,8 @@ PersistentTable::InitFromFile(const string& tableName)
                          "Persistent table file '%s' has an invalid signature.",
                          mFileNamePrefix.c_str());
     }
-  else if (load_le_int32(tableHdr + PS_TABLE_FLAGS_OFF) & PS_TABLE_MODIFIED_MASK)
+  else if ( ! recovering
+           && (load_le_int32(tableHdr + PS_TABLE_FLAGS_OFF) & PS_TABLE_MODIFIED_MASK))
     {
       throw DBSException(_EXTRA(DBSException::TABLE_IN_USE),
                          "Cannot open table '%s' as is already in use or was not closed properly"
@@ -872,20 +1428,58 @@ PersistentTable::InitFromFile(const string& tableName)
   mainTableFile.Read(_CC(uint8_t*, mFieldsDescriptors.get()), mDescriptorsSize);
   mainTableFile.Close();
 
-  mTableData.reset(new FileContainer(mFileNamePrefix.c_str(),
-                                     mMaxFileSize,
-                                     (mainTableSize + mMaxFileSize - 1) / mMaxFileSize,
-                                     false));
+  mPersistedHeader.assign(tableHdr, tableHdr + PS_HEADER_SIZE);
+  mPersistedHeader.insert(mPersistedHeader.end(),
+                          mFieldsDescriptors.get(),
+                          mFieldsDescriptors.get() + mDescriptorsSize);
+
+  mTableData.reset(Journaled(new FileContainer(mFileNamePrefix.c_str(),
+                                               mMaxFileSize,
+                                               (mainTableSize + mMaxFileSize - 1) / mMaxFileSize,
+                                               false)));
+}
+
+FileContainer*
+PersistentTable::Journaled(FileContainer* const container)
+{
+  if (mJournal != nullptr)
+    mJournal->Attach( *container);
+
+  return container;
 }
 
 void
 PersistentTable::InitVariableStorages()
 {
+  const bool migrate = (mVSDataVersion < VariableSizeStore::FORMAT_VERSION);
+
+  //The table keeps its values in the format used by a previous version.
+  //Convert them up front; the table is flagged as not closed properly until
+  //it is done.
+  if (migrate && (mVSDataSize > 0))
+  {
+    uint8_t flags[PS_TABLE_FLAGS_LEN];
+
+    if (mJournal != nullptr)
+      mJournal->MarkAltered();
+
+    store_le_int32(PS_TABLE_MODIFIED_MASK, flags);
+    mTableData->Write(PS_TABLE_FLAGS_OFF, sizeof flags, flags);
+    mPersistedHeader.clear();
+
+    mVSDataSize = migrate_variable_store(mFileNamePrefix,
+                                         mVSDataSize,
+                                         mMaxFileSize,
+                                         &GetFieldDescriptorInternal(0),
+                                         mFieldsCount,
+                                         mRowSize,
+                                         mRowsCount,
+                                         false);
+  }
+  mVSDataVersion = VariableSizeStore::FORMAT_VERSION;
+
   // Loading the rows regular should be done up front.
-  mRowsData.reset (new FileContainer((mFileNamePrefix + PS_TABLE_FIXFIELDS_EXT).c_str(),
-                                     mMaxFileSize,
-                                     ((mRowSize * mRowsCount) + mMaxFileSize - 1) / mMaxFileSize,
-                                     false));
+  InitRowsContainers();
 
   //Check if are fields demanding variable size store.
   for (FIELD_INDEX i = 0; i < mFieldsCount; ++i)
@@ -899,13 +1493,45 @@ PersistentTable::InitVariableStorages()
       mVSData = shared_make(VariableSizeStore);
       mVSData->Init((mFileNamePrefix + PS_TABLE_VARFIELDS_EXT).c_str(),
                     mVSDataSize,
-                    mMaxFileSize);
+                    mMaxFileSize,
+                    false,
+                    mJournal.get());
 
       //We only need one field to require variable storage initialisation
       //and it would be enough for the(if they are present).
       break;
     }
   }
+
+  if (migrate)
+    MakeHeaderPersistent();
+}
+
+void
+PersistentTable::InitRowsContainers()
+{
+  const string rowsFile = mFileNamePrefix + PS_TABLE_FIXFIELDS_EXT;
+  const string legacyFile = rowsFile + PS_TABLE_LEGACY_EXT;
+
+  mRowsData.reset (Journaled(new FileContainer(rowsFile.c_str(),
+                                               mMaxFileSize,
+                                               ((_SC(uint64_t, mRowSize) * mRowsCount)
+                                                  + mMaxFileSize - 1) / mMaxFileSize,
+                                               false)));
+
+  if (mLegacyRows.mRowSize == 0)
+  {
+    //Some leftovers of a conversion ended right before the table was closed.
+    remove_container_files(legacyFile);
+    return;
+  }
+
+  const uint64_t legacySize = _SC(uint64_t, mLegacyRows.mRowSize) * mLegacyRows.mRowsCount;
+
+  mLegacyRowsData.reset(Journaled(new FileContainer(legacyFile.c_str(),
+                                                    mMaxFileSize,
+                                                    (legacySize + mMaxFileSize - 1) / mMaxFileSize,
+                                                    false)));
 }
 
 void
@@ -920,6 +1546,8 @@ PersistentTable::InitIndexedFields()
       assert(field.IndexUnitsCount() == 0);
 
       mvIndexNodeMgrs.push_back(nullptr);
+      mvHashIndexes.push_back(nullptr);
+      mvBitmapIndexes.push_back(nullptr);
       continue;
     }
 
@@ -928,17 +1556,75 @@ PersistentTable::InitIndexedFields()
                                  + _RC(const char*, mFieldsDescriptors.get() + field.NameOffset())
                                  + "_bt";
 
-    unique_ptr<IDataContainer> indexContainer(unique_make(FileContainer,
-                                                          containerName.c_str(),
-                                                          mMaxFileSize,
-                                                          field.IndexUnitsCount(),
-                                                          false));
+    unique_ptr<IDataContainer> indexContainer(Journaled(new FileContainer(containerName.c_str(),
+                                                                          mMaxFileSize,
+                                                                          field.IndexUnitsCount(),
+                                                                          false)));
+    if (field.IndexKind() == INDEX_HASH)
+    {
+      mvIndexNodeMgrs.push_back(nullptr);
+      mvHashIndexes.push_back(new FieldHashIndex(indexContainer,
+                                                 field.IndexNodeSizeKB() * 1024,
+                                                 false));
+      mvBitmapIndexes.push_back(nullptr);
+      continue;
+    }
+    else if ((field.IndexKind() == INDEX_BITMAP)
+             || (field.IndexKind() == INDEX_TRIGRAM)
+             || (field.IndexKind() == INDEX_ELEMENTS))
+    {
+      mvIndexNodeMgrs.push_back(nullptr);
+      mvHashIndexes.push_back(nullptr);
+      mvBitmapIndexes.push_back(new FieldBitmapIndex(indexContainer, false));
+      continue;
+    }
+
+    mvHashIndexes.push_back(nullptr);
+    mvBitmapIndexes.push_back(nullptr);
     mvIndexNodeMgrs.push_back(new FieldIndexNodeManager(indexContainer,
                                                         field.IndexNodeSizeKB() * 1024,
                                                         0x400000, //4MB
                                                         _SC(DBS_FIELD_TYPE, field.Type()),
                                                         false));
   }
+
+  vector<CompositeIndexEntry> entries;
+  if ( ! load_composite_indexes(mFileNamePrefix + PS_TABLE_COMPOSITE_EXT, entries))
+  {
+    throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY),
+                       "The composite indexes of table '%s' are not recorded properly.",
+                       mName.c_str());
+  }
+
+  for (const auto& entry : entries)
+  {
+    for (auto field : entry.mFields)
+    {
+      if (field >= mFieldsCount)
+      {
+        throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY),
+                           "A composite index of table '%s' refers an invalid field.",
+                           mName.c_str());
+      }
+    }
+
+    const string containerName = composite_container_name(mFileNamePrefix,
+                                                          &GetFieldDescriptorInternal(0),
+                                                          entry.mFields);
+    unique_ptr<IDataContainer> indexContainer(Journaled(new FileContainer(containerName.c_str(),
+                                                                          mMaxFileSize,
+                                                                          entry.mUnitsCount,
+                                                                          false)));
+    CompositeIndex index;
+
+    index.mFields = entry.mFields;
+    index.mNodeMgr = new FieldIndexNodeManager(indexContainer,
+                                               entry.mNodeSizeKB * 1024,
+                                               0x400000, //4MB
+                                               PS_COMPOSITE_KEY_TYPE,
+                                               false);
+    mvCompositeIndexes.push_back(index);
+  }
 }
 
 void
@@ -952,6 +1638,9 @@ PersistentTable::MakeHeaderPersistent()
   if (mRowModified)
     flags |= PS_TABLE_MODIFIED_MASK;
 
+  if (mLayoutAltered)
+    flags |= PS_TABLE_ALTERED_MASK;
+
   uint8_t tableHdr[PS_HEADER_SIZE];
 
   memcpy(tableHdr, PS_TABLE_SIGNATURE, sizeof PS_TABLE_SIGNATURE);
@@ -965,23 +1654,47 @@ PersistentTable::MakeHeaderPersistent()
   store_le_int64(mMaxFileSize,        tableHdr + PS_TABLE_MAX_FILE_SIZE_OFF);
   store_le_int64(mTableData->Size(),  tableHdr + PS_TABLE_MAINTABLE_SIZE_OFF);
   store_le_int32(flags,               tableHdr + PS_TABLE_FLAGS_OFF);
+  store_le_int32(mVSDataVersion,      tableHdr + PS_TABLE_VARSTORAGE_VER_OFF);
 
   store_le_int64((mVSData != nullptr) ? mVSData->Size() : 0,
                  tableHdr + PS_TABLE_VARSTORAGE_SIZE_OFF);
 
+  store_legacy_rows_layout(mLegacyRows, tableHdr);
   memset(tableHdr + PS_RESEVED_FOR_FUTURE_OFF, 0, PS_RESEVED_FOR_FUTURE_LEN);
 
+  //Do not bother to write it again if it was not changed.
+  if ((mPersistedHeader.size() == sizeof tableHdr + mDescriptorsSize)
+      && (memcmp(mPersistedHeader.data(), tableHdr, sizeof tableHdr) == 0)
+      && (memcmp(mPersistedHeader.data() + sizeof tableHdr,
+                 mFieldsDescriptors.get(),
+                 mDescriptorsSize) == 0))
+  {
+    return;
+  }
+
+  mPersistedHeader.clear();
   mTableData->Write(0, sizeof tableHdr, tableHdr);
   mTableData->Write(sizeof tableHdr, mDescriptorsSize, mFieldsDescriptors.get());
+
+  mPersistedHeader.assign(tableHdr, tableHdr + sizeof tableHdr);
+  mPersistedHeader.insert(mPersistedHeader.end(),
+                          mFieldsDescriptors.get(),
+                          mFieldsDescriptors.get() + mDescriptorsSize);
 }
 
 
 void
 PersistentTable::RemoveFromDatabase()
 {
+  //The table's files are gone, nothing is left to be restored.
+  mJournal.reset();
+
   if (mRowsData.get() != nullptr)
     mRowsData->MarkForRemoval();
 
+  if (mLegacyRowsData.get() != nullptr)
+    mLegacyRowsData->MarkForRemoval();
+
   if (mVSData != nullptr)
     mVSData->MarkForRemoval();
 
@@ -989,8 +1702,19 @@ PersistentTable::RemoveFromDatabase()
   {
     if (mvIndexNodeMgrs[i] != nullptr)
       mvIndexNodeMgrs[i]->MarkForRemoval();
+
+    else if (mvHashIndexes[i] != nullptr)
+      mvHashIndexes[i]->MarkForRemoval();
+
+    else if (mvBitmapIndexes[i] != nullptr)
+      mvBitmapIndexes[i]->MarkForRemoval();
   }
 
+  for (auto& index : mvCompositeIndexes)
+    index.mNodeMgr->MarkForRemoval();
+
+  remove_container_files(mFileNamePrefix + PS_TABLE_COMPOSITE_EXT);
+
   mTableData->MarkForRemoval();
   mRemoved = true;
 }
@@ -1004,13 +1728,61 @@ PersistentTable::CreateIndexContainer(const FIELD_INDEX field)
   const DBSFieldDescriptor desc = DescribeField(field);
   const string containerNameBase = mFileNamePrefix + '_' + desc.name + "_bt";
 
-  return new FileContainer(containerNameBase.c_str(), mDbsSettings.mMaxFileSize, 0, false);
+  return Journaled(new FileContainer(containerNameBase.c_str(), mDbsSettings.mMaxFileSize, 0, false));
+}
+
+
+IDataContainer*
+PersistentTable::CreateCompositeIndexContainer(const vector<FIELD_INDEX>& fields)
+{
+  assert(!mFileNamePrefix.empty());
+
+  const string containerNameBase = composite_container_name(mFileNamePrefix,
+                                                            &GetFieldDescriptorInternal(0),
+                                                            fields);
+
+  return Journaled(new FileContainer(containerNameBase.c_str(), mDbsSettings.mMaxFileSize, 0, false));
+}
+
+
+void
+PersistentTable::MakeCompositeIndexesPersistent()
+{
+  if (mRemoved)
+    return;
+
+  store_composite_indexes(mFileNamePrefix + PS_TABLE_COMPOSITE_EXT,
+                          mvCompositeIndexes,
+                          mMaxFileSize,
+                          mJournal.get());
 }
 
 
 void
 PersistentTable::FlushEpilog()
 {
+  //The indexes are written by now, so their sizes are known. Record them
+  //with the header that follows.
+  for (FIELD_INDEX field = 0; field < mFieldsCount; ++field)
+  {
+    uint64_t indexSize;
+
+    if (mvIndexNodeMgrs[field] != nullptr)
+      indexSize = mvIndexNodeMgrs[field]->IndexRawSize();
+
+    else if (mvHashIndexes[field] != nullptr)
+      indexSize = mvHashIndexes[field]->IndexRawSize();
+
+    else if (mvBitmapIndexes[field] != nullptr)
+      indexSize = mvBitmapIndexes[field]->IndexRawSize();
+
+    else
+      continue;
+
+    GetFieldDescriptorInternal(field).IndexUnitsCount((indexSize + mMaxFileSize - 1)
+                                                        / mMaxFileSize);
+  }
+
   if (mVSData != nullptr)
     mVSData->Flush();
 
@@ -1022,6 +1794,63 @@ PersistentTable::FlushEpilog()
 }
 
 
+uint64_t
+PersistentTable::BeginContentSync()
+{
+  return (mJournal != nullptr) ? mJournal->LastLsn() : 0;
+}
+
+
+void
+PersistentTable::EndContentSync(const uint64_t lsn)
+{
+  if (mJournal != nullptr)
+    mJournal->EndEpoch(lsn);
+}
+
+
+void
+PersistentTable::FlushDeferred()
+{
+  //Without a journal the staged content could not be told apart from what is
+  //written after the table is unlocked.
+  if (mJournal == nullptr)
+  {
+    Flush();
+    return;
+  }
+
+  {
+    DoubleLockGuard<Lock> _l(mRowsSync, mIndexesSync);
+
+    mJournal->BeginStaging();
+    try
+    {
+      FlushInternal();
+    }
+    catch (...)
+    {
+      mJournal->CancelStaging();
+      throw;
+    }
+  }
+
+  mJournal->WriteStaged();
+}
+
+
+bool
+PersistentTable::FlushSome(const uint_t maxBlocks)
+{
+  bool result = PrototypeTable::FlushSome(maxBlocks);
+
+  if (mVSData != nullptr)
+    result = mVSData->FlushSome(maxBlocks) || result;
+
+  return result;
+}
+
+
 IDataContainer&
 PersistentTable::RowsContainer()
 {
@@ -1049,6 +1878,247 @@ PersistentTable::VSStore()
 }
 
 
+RedoLog*
+PersistentTable::TableRedoLog()
+{
+  //The updates replayed while recovering are already in the log.
+  return (mRemoved || mRecovering) ? nullptr : mDbs.GetRedoLog();
+}
+
+
+const std::string&
+PersistentTable::TableName() const
+{
+  return mName;
+}
+
+
+IDataContainer&
+PersistentTable::LegacyRowsContainer()
+{
+  assert(mLegacyRowsData.get() != nullptr);
+
+  return *mLegacyRowsData.get();
+}
+
+
+void
+PersistentTable::EndRowsConversion()
+{
+  assert(mLegacyRows.mRowSize == 0);
+
+  //The legacy rows are not needed once the header does not point to them.
+  mRowsData->Flush();
+
+  MakeHeaderPersistent();
+  mTableData->Flush();
+
+  mLegacyRowsData->MarkForRemoval();
+  mLegacyRowsData.reset();
+}
+
+
+void
+PersistentTable::AddField(const DBSFieldDescriptor& field)
+{
+  validate_field_descriptors(&field, 1);
+
+  DoubleLockGuard<Lock> _l(mRowsSync, mIndexesSync);
+
+  for (FIELD_INDEX i = 0; i < mFieldsCount; ++i)
+  {
+    if (strcmp(DescribeField(i).name, field.name) == 0)
+    {
+      throw DBSException(_EXTRA(DBSException::FIELD_NAME_INVALID),
+                         "Table '%s' already has a field named '%s'.",
+                         mName.c_str(),
+                         field.name);
+    }
+  }
+
+  //The new field null bit is placed after the current row content.
+  if ((mFieldsCount >= 0xFFFFu) || (mRowSize * 8 + 7 > 0xFFFFu))
+  {
+    throw DBSException(_EXTRA(DBSException::OPER_NOT_SUPPORTED),
+                       "Cannot add more fields to table '%s'.",
+                       mName.c_str());
+  }
+
+  const uint_t nameLen = strlen(field.name) + 1;
+  const uint_t namesOffset = mFieldsCount * sizeof(FieldDescriptor);
+  const uint32_t descriptorsSize = mDescriptorsSize + sizeof(FieldDescriptor) + nameLen;
+
+  unique_ptr<uint8_t> descriptors(new uint8_t[descriptorsSize]);
+  FieldDescriptor* const fds = _RC(FieldDescriptor*, descriptors.get());
+
+  memcpy(fds, mFieldsDescriptors.get(), namesOffset);
+  memcpy(descriptors.get() + namesOffset + sizeof(FieldDescriptor),
+         mFieldsDescriptors.get() + namesOffset,
+         mDescriptorsSize - namesOffset);
+  memcpy(descriptors.get() + descriptorsSize - nameLen, field.name, nameLen);
+
+  for (FIELD_INDEX i = 0; i < mFieldsCount; ++i)
+    fds[i].NameOffset(fds[i].NameOffset() + sizeof(FieldDescriptor));
+
+  FieldDescriptor& newField = fds[mFieldsCount];
+
+  newField = FieldDescriptor();
+  newField.NullBitIndex(mRowSize * 8);
+  newField.RowDataOff(mRowSize + 1);
+  newField.NameOffset(descriptorsSize - nameLen);
+  newField.Type(field.type | (field.isArray ? PS_TABLE_ARRAY_MASK : 0));
+
+  if ((field.isArray || (field.type == T_TEXT)) && (mVSData == nullptr))
+  {
+    mVSData = shared_make(VariableSizeStore);
+    mVSData->Init((mFileNamePrefix + PS_TABLE_VARFIELDS_EXT).c_str(),
+                  0,
+                  mMaxFileSize,
+                  false,
+                  mJournal.get());
+  }
+
+  ChangeRowsLayout(descriptors.release(),
+                   descriptorsSize,
+                   mFieldsCount + 1,
+                   mRowSize + 1 + Serializer::Size(field.type, field.isArray),
+                   LegacyRowsLayout());
+}
+
+
+void
+PersistentTable::RetypeField(const FIELD_INDEX field, const DBS_FIELD_TYPE type)
+{
+  DoubleLockGuard<Lock> _l(mRowsSync, mIndexesSync);
+
+  if (field >= mFieldsCount)
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_NOT_FOUND),
+                       "Table field index is invalid %u(count %u).",
+                       field,
+                       mFieldsCount);
+  }
+
+  const FieldDescriptor& fd = GetFieldDescriptorInternal(field);
+  const DBSFieldDescriptor desc = DescribeField(field);
+
+  if (desc.isArray || ! Serializer::IsWidening(desc.type, type))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID),
+                       "Cannot change the type of field '%s' from %s to %s and keep its values.",
+                       desc.name,
+                       field_type_to_text(desc.type),
+                       field_type_to_text(type));
+  }
+  else if (HasIndex(field))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_INDEXED),
+                       "Field '%s' has to be not indexed to change its type.",
+                       desc.name);
+  }
+
+  for (const auto& index : mvCompositeIndexes)
+  {
+    if (find(index.mFields.begin(), index.mFields.end(), field) != index.mFields.end())
+    {
+      throw DBSException(_EXTRA(DBSException::FIELD_INDEXED),
+                         "Field '%s' has to be not part of a composite index to change its type.",
+                         desc.name);
+    }
+  }
+
+  unique_ptr<uint8_t> descriptors(new uint8_t[mDescriptorsSize]);
+  FieldDescriptor* const fds = _RC(FieldDescriptor*, descriptors.get());
+
+  memcpy(descriptors.get(), mFieldsDescriptors.get(), mDescriptorsSize);
+
+  //The field keeps its null bit, its values are moved after the row content.
+  fds[field].Type(type);
+  fds[field].RowDataOff(mRowSize + 1);
+
+  LegacyRowsLayout legacyRows;
+
+  legacyRows.mRetypedField     = field;
+  legacyRows.mRetypedFieldType = fd.Type();
+  legacyRows.mRetypedFieldOff  = fd.RowDataOff();
+
+  ChangeRowsLayout(descriptors.release(),
+                   mDescriptorsSize,
+                   mFieldsCount,
+                   mRowSize + 1 + Serializer::Size(type, false),
+                   legacyRows);
+}
+
+
+void
+PersistentTable::ChangeRowsLayout(uint8_t* const            descriptors,
+                                  const uint32_t            descriptorsSize,
+                                  const FIELD_INDEX         fieldsCount,
+                                  const uint32_t            rowSize,
+                                  const LegacyRowsLayout&   legacyRows)
+{
+  unique_ptr<uint8_t> newDescriptors(descriptors);
+
+  //The removed rows index follows the descriptors.
+  uint64_t headerSpace = PS_HEADER_SIZE + mDescriptorsSize + TableRmNode::RAW_NODE_SIZE - 1;
+
+  headerSpace /= TableRmNode::RAW_NODE_SIZE;
+  headerSpace *= TableRmNode::RAW_NODE_SIZE;
+
+  if (PS_HEADER_SIZE + descriptorsSize > headerSpace)
+  {
+    throw DBSException(_EXTRA(DBSException::OPER_NOT_SUPPORTED),
+                       "No room left for the fields descriptors of table '%s'.",
+                       mName.c_str());
+  }
+
+  MarkRowModification(nullptr);
+
+  //Only one set of rows is kept aside.
+  while (ConvertRows(mDbsSettings.mCheckpointBatch))
+    ;
+
+  FlushInternal();
+
+  //The rows files are replaced from here on.
+  if (mJournal != nullptr)
+    mJournal->MarkAltered();
+
+  MarkRowModification(nullptr);
+
+  const ROW_INDEX rowsCount = mRowsCount;
+  const uint32_t legacyRowSize = mRowSize;
+
+  ReplaceRowsLayout(newDescriptors.release(), descriptorsSize, fieldsCount, rowSize);
+
+  mLayoutAltered = true;
+  if (rowsCount > 0)
+  {
+    mLegacyRows = legacyRows;
+    mLegacyRows.mRowSize = legacyRowSize;
+    mLegacyRows.mRowsCount = rowsCount;
+    mConvertedRows = 0;
+  }
+
+  //The header goes first, the table repair knows to resume from there.
+  MakeHeaderPersistent();
+  mTableData->Flush();
+
+  if (rowsCount == 0)
+    return;
+
+  const string rowsFile = mFileNamePrefix + PS_TABLE_FIXFIELDS_EXT;
+
+  mRowsData.reset();
+  replace_container_files(rowsFile + PS_TABLE_LEGACY_EXT, rowsFile);
+
+  //No row is written yet, this reads back as zeros.
+  FileContainer::Fix(rowsFile.c_str(), mMaxFileSize, _SC(uint64_t, rowsCount) * rowSize);
+
+  InitRowsContainers();
+}
+
+
 bool
 PersistentTable::ValidateTable(const std::string& path, const std::string& name)
 {
@@ -1141,54 +2211,577 @@ check_text_buffer(const uint8_t* const utf8buffer, const uint_t bufferSize)
     {
       const uint_t unitsCount = wh_utf8_cu_count(utf8buffer[verified]);
 
-      if (unitsCount == 0)
-        return false;
+      if (unitsCount == 0)
+        return false;
+
+      uint32_t cp;
+      wh_load_utf8_cp(utf8buffer + verified, &cp);
+      DChar chk_cp_valid(cp);
+
+      verified += unitsCount;
+    }
+    catch (...)
+    {
+      return false;
+    }
+  }
+
+  return verified == bufferSize;
+}
+
+
+static void
+remove_extra_container_files(FIX_ERROR_CALLBACK   fixCallback,
+                             const string         baseFile,
+                             const uint64_t       containerSize,
+                             const uint64_t       maxFileSize)
+{
+  uint_t seriesStart = containerSize / maxFileSize + 1;
+
+  if ((containerSize == 0) || (containerSize % maxFileSize == 0))
+    --seriesStart;
+
+  while (true)
+  {
+    string fileName = baseFile;
+
+    if (seriesStart != 0)
+      append_int_to_str(seriesStart, fileName);
+
+    if ( ! whf_file_exists(fileName.c_str()))
+      return;
+
+    fixCallback(INFORMATION, "Removing extra file '%s.", fileName.c_str());
+    if ( ! whf_remove(fileName.c_str()))
+    {
+      throw WFileContainerException(_EXTRA(WFileContainerException::FILE_OS_IO_ERROR),
+                                    "Failed to remove file '%s'.",
+                                    fileName.c_str());
+    }
+    ++seriesStart;
+  }
+}
+
+
+static const ROW_INDEX CHECK_CHUNK_ROWS = 1024;
+
+
+struct RowsCheckJob
+{
+  RowsCheckJob(const string&             tableName,
+               const string&             rowsFile,
+               const DBSSettings&        settings,
+               const FieldDescriptor*    fields,
+               const FIELD_INDEX         fieldsCount,
+               const uint32_t            rowSize,
+               const ROW_INDEX           rowsCount,
+               VariableSizeStore* const  vsData,
+               FIX_ERROR_CALLBACK        fixCallback)
+    : mTableName(tableName),
+      mRowsFile(rowsFile),
+      mSettings(settings),
+      mFields(fields),
+      mFieldsCount(fieldsCount),
+      mRowSize(rowSize),
+      mRowsCount(rowsCount),
+      mVSData(vsData),
+      mFixCallback(fixCallback),
+      mChunksCount((rowsCount + CHECK_CHUNK_ROWS - 1) / CHECK_CHUNK_ROWS),
+      mNextChunk(0),
+      mCheckedChunks(0),
+      mFailed(false)
+  {
+  }
+
+  const string&             mTableName;
+  const string              mRowsFile;
+  const DBSSettings&        mSettings;
+  const FieldDescriptor*    mFields;
+  const FIELD_INDEX         mFieldsCount;
+  const uint32_t            mRowSize;
+  const ROW_INDEX           mRowsCount;
+  VariableSizeStore* const  mVSData;
+  FIX_ERROR_CALLBACK        mFixCallback;
+  const int64_t             mChunksCount;
+  volatile int64_t          mNextChunk;
+  volatile int64_t          mCheckedChunks;
+  volatile bool             mFailed;
+  vector<ROW_INDEX>         mNullRows;
+  Lock                      mSync;
+};
+
+
+//Validates the values of a row and sets to null the ones found invalid.
+//Returns true if all row's values end up being null.
+static bool
+check_row_values(RowsCheckJob&           job,
+                 IDataContainer* const   vsEntries,
+                 const ROW_INDEX         row,
+                 uint8_t* const          rowData,
+                 bool* const             outModified)
+{
+  const char* const fieldsNames = _RC(const char*, job.mFields);
+
+  bool allFieldsAreNull = true;
+  for (FIELD_INDEX field = 0; field < job.mFieldsCount; ++field)
+  {
+    const FieldDescriptor& fd = job.mFields[field];
+    const uint_t byteOff = fd.NullBitIndex() / 8;
+    const uint_t bitOff = fd.NullBitIndex() % 8;
+    const uint8_t* const fieldData = rowData + fd.RowDataOff();
+    const DBS_FIELD_TYPE baseType = _SC(DBS_FIELD_TYPE, GET_BASE_TYPE(fd.Type()));
+
+    bool isNullValue = ((rowData[byteOff] & (1 << bitOff)) != 0);
+    bool isValid = true;
+
+    if (isNullValue)
+      ;
+
+    else if (IS_ARRAY(fd.Type()) || (baseType == T_TEXT))
+    {
+      const uint64_t fieldEntry = load_le_int64(fieldData);
+      const uint64_t fieldSize = load_le_int64(fieldData + sizeof(uint64_t));
+
+      if (fieldSize & 0x8000000000000000ull)
+      {
+        isValid = IS_ARRAY(fd.Type())
+                  ? check_array_buffer(fieldData, (fieldSize >> 56) & 0x7F, baseType)
+                  : check_text_buffer(fieldData, (fieldSize >> 56) & 0x7F);
+      }
+      else if (vsEntries == nullptr)
+        isValid = false;
+
+      else
+      {
+        isValid = IS_ARRAY(fd.Type())
+                  ? job.mVSData->CheckArrayEntry( *vsEntries, fieldEntry, fieldSize, baseType)
+                  : job.mVSData->CheckTextEntry( *vsEntries, fieldEntry, fieldSize);
+      }
+    }
+    else if (fd.IndexNodeSizeKB() > 0)
+      isValid = Serializer::SelectValidator(baseType)(fieldData);
+
+    if ( ! isValid)
+    {
+      job.mFixCallback(FIX_INFO,
+                       "Detected invalid value of field '%s' of table '%s' at row %u."
+                         " Set to null.",
+                       fieldsNames + fd.NameOffset(),
+                       job.mTableName.c_str(),
+                       row);
+
+      rowData[byteOff] |= (1 << bitOff);
+      *outModified = isNullValue = true;
+    }
+
+    allFieldsAreNull &= isNullValue;
+  }
+
+  return allFieldsAreNull;
+}
+
+
+static void
+check_rows_routine(void* args)
+{
+  RowsCheckJob& job = *_RC(RowsCheckJob*, args);
+
+  try
+  {
+    //Every thread does its IO through its own files handles.
+    FileContainer rowsData(job.mRowsFile.c_str(),
+                           job.mSettings.mMaxFileSize,
+                           ((job.mRowSize * job.mRowsCount) + job.mSettings.mMaxFileSize - 1)
+                             / job.mSettings.mMaxFileSize,
+                           false);
+
+    unique_ptr<IDataContainer> vsEntries;
+    if (job.mVSData != nullptr)
+      vsEntries = job.mVSData->OpenEntriesReader();
+
+    unique_ptr<uint8_t[]> chunkData(unique_array_make(uint8_t, CHECK_CHUNK_ROWS * job.mRowSize));
+    vector<ROW_INDEX> nullRows;
+
+    while ( ! job.mFailed)
+    {
+      const int64_t chunk = wh_atomic_fetch_inc64(&job.mNextChunk);
+      if (chunk >= job.mChunksCount)
+        break;
+
+      const ROW_INDEX firstRow = chunk * CHECK_CHUNK_ROWS;
+      const ROW_INDEX rowsCount = MIN(CHECK_CHUNK_ROWS, job.mRowsCount - firstRow);
+
+      rowsData.Read(firstRow * job.mRowSize, rowsCount * job.mRowSize, chunkData.get());
+
+      bool modified = false;
+      for (ROW_INDEX i = 0; i < rowsCount; ++i)
+      {
+        if (check_row_values(job,
+                             vsEntries.get(),
+                             firstRow + i,
+                             chunkData.get() + i * job.mRowSize,
+                             &modified))
+        {
+          nullRows.push_back(firstRow + i);
+        }
+      }
+
+      if (modified)
+        rowsData.Write(firstRow * job.mRowSize, rowsCount * job.mRowSize, chunkData.get());
+
+      const int64_t checked = wh_atomic_fetch_inc64(&job.mCheckedChunks) + 1;
+      const uint_t percent = (checked * 100) / job.mChunksCount;
+
+      if ((job.mChunksCount > 1) && (percent / 10 != ((checked - 1) * 100 / job.mChunksCount) / 10))
+      {
+        job.mFixCallback(PROGRESS_INFO,
+                         "Checked %u%% of the rows of table '%s'.",
+                         percent,
+                         job.mTableName.c_str());
+      }
+    }
+
+    LockGuard<Lock> _l(job.mSync);
+
+    job.mNullRows.insert(job.mNullRows.end(), nullRows.begin(), nullRows.end());
+  }
+  catch (...)
+  {
+    job.mFailed = true;
+  }
+}
+
+
+template<typename T> static void
+index_field_value(FieldIndexNodeManager&   indexNodeMgr,
+                  const uint8_t* const     fieldData,
+                  const bool               isNullValue,
+                  const ROW_INDEX          row,
+                  const bool               removeValue)
+{
+  NODE_INDEX dummyNode;
+  KEY_INDEX dummyKey;
+
+  T value;
+
+  if ( ! isNullValue)
+    Serializer::Load(fieldData, &value);
+
+  if (removeValue)
+    BTree(indexNodeMgr).RemoveKey(T_BTreeKey<T>(value, row));
+
+  else
+    BTree(indexNodeMgr).InsertKey(T_BTreeKey<T>(value, row), &dummyNode, &dummyKey);
+}
+
+
+void
+index_row_values(vector<FieldIndexNodeManager*>&   indexNodeMgrs,
+                 const FieldDescriptor* const      fds,
+                 const FIELD_INDEX                 fieldsCount,
+                 const ROW_INDEX                   row,
+                 const uint8_t* const              rowData,
+                 VariableSizeStore* const          store,
+                 const bool                        removeValues)
+{
+  for (FIELD_INDEX field = 0; field < fieldsCount; ++field)
+  {
+    if (indexNodeMgrs[field] == nullptr)
+      continue;
+
+    FieldIndexNodeManager& nodeMgr = *indexNodeMgrs[field];
+
+    const uint8_t* const fieldData = rowData + fds[field].RowDataOff();
+    const bool isNullValue = (rowData[fds[field].NullBitIndex() / 8]
+                              & (1 << (fds[field].NullBitIndex() % 8))) != 0;
+
+    switch (GET_BASE_TYPE(fds[field].Type()))
+    {
+    case T_BOOL:
+      index_field_value<DBool>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_CHAR:
+      index_field_value<DChar>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_DATE:
+      index_field_value<DDate>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_DATETIME:
+      index_field_value<DDateTime>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_HIRESTIME:
+      index_field_value<DHiresTime>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_INT8:
+      index_field_value<DInt8>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_INT16:
+      index_field_value<DInt16>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_INT32:
+      index_field_value<DInt32>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_INT64:
+      index_field_value<DInt64>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_REAL:
+      index_field_value<DReal>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_RICHREAL:
+      index_field_value<DRichReal>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_UINT8:
+      index_field_value<DUInt8>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_UINT16:
+      index_field_value<DUInt16>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_UINT32:
+      index_field_value<DUInt32>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_UINT64:
+      index_field_value<DUInt64>(nodeMgr, fieldData, isNullValue, row, removeValues);
+      break;
+
+    case T_TEXT:
+    {
+      NODE_INDEX dummyNode;
+      KEY_INDEX dummyKey;
+
+      const TextIndexPrefix value = PrototypeTable::StoredTextPrefix(store, fds[field], rowData);
+
+      if (removeValues)
+        BTree(nodeMgr).RemoveKey(TextBTreeKey(value, row));
+
+      else
+        BTree(nodeMgr).InsertKey(TextBTreeKey(value, row), &dummyNode, &dummyKey);
+    }
+      break;
+
+    default:
+      throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
+    }
+  }
+}
+
+
+void
+hash_row_values(vector<FieldHashIndex*>&        hashIndexes,
+                const FieldDescriptor* const    fds,
+                const FIELD_INDEX               fieldsCount,
+                const ROW_INDEX                 row,
+                const uint8_t* const            rowData,
+                VariableSizeStore* const        store,
+                const bool                      removeValues)
+{
+  for (FIELD_INDEX field = 0; field < fieldsCount; ++field)
+  {
+    if (hashIndexes[field] == nullptr)
+      continue;
+
+    const bool isNullValue = (rowData[fds[field].NullBitIndex() / 8]
+                              & (1 << (fds[field].NullBitIndex() % 8))) != 0;
+
+    if (isNullValue)
+      continue;
+
+    const uint64_t hash = PrototypeTable::StoredValueHash(store, fds[field], rowData);
+    if (removeValues)
+      hashIndexes[field]->Remove(hash, row);
+
+    else
+      hashIndexes[field]->Insert(hash, row);
+  }
+}
+
+
+void
+bitmap_row_values(vector<FieldBitmapIndex*>&      bitmapIndexes,
+                  const FieldDescriptor* const    fds,
+                  const FIELD_INDEX               fieldsCount,
+                  const ROW_INDEX                 row,
+                  const uint8_t* const            rowData,
+                  VariableSizeStore* const        store,
+                  const bool                      removeValues)
+{
+  for (FIELD_INDEX field = 0; field < fieldsCount; ++field)
+  {
+    if (bitmapIndexes[field] == nullptr)
+      continue;
+
+    FieldBitmapIndex& index = *bitmapIndexes[field];
+
+    if (fds[field].IndexKind() == INDEX_TRIGRAM)
+    {
+      vector<uint64_t> trigrams;
+
+      PrototypeTable::StoredTextTrigrams(store, fds[field], rowData, trigrams);
+      if (removeValues)
+        index.RemoveTrigrams(trigrams, row);
+
+      else
+        index.AddTrigrams(trigrams, row);
+
+      continue;
+    }
+    else if (fds[field].IndexKind() == INDEX_ELEMENTS)
+    {
+      const uint_t elementSize = Serializer::Size(_SC(DBS_FIELD_TYPE,
+                                                      GET_BASE_TYPE(fds[field].Type())),
+                                                  false);
+      vector<uint8_t> elements;
+
+      PrototypeTable::StoredArrayElements(store, fds[field], rowData, elements);
+      if (removeValues)
+        index.RemoveElements(elements, elementSize, row);
+
+      else
+        index.AddElements(elements, elementSize, row);
+
+      continue;
+    }
+
+    const bool isNullValue = (rowData[fds[field].NullBitIndex() / 8]
+                              & (1 << (fds[field].NullBitIndex() % 8))) != 0;
+    const uint_t valueSize = isNullValue
+                               ? 0
+                               : Serializer::Size(_SC(DBS_FIELD_TYPE, fds[field].Type()), false);
+
+    if (removeValues)
+      index.Remove(rowData + fds[field].RowDataOff(), valueSize, row);
+
+    else
+      index.Add(rowData + fds[field].RowDataOff(), valueSize, row);
+  }
+}
+
+
+template<typename T> static void
+add_composite_value(CompositeKey&             key,
+                    const FieldDescriptor&    fd,
+                    const uint8_t* const      rowData)
+{
+  T value;
+
+  if ((rowData[fd.NullBitIndex() / 8] & (1 << (fd.NullBitIndex() % 8))) == 0)
+    Serializer::Load(rowData + fd.RowDataOff(), &value);
+
+  key.Add(value);
+}
+
+
+CompositeKey
+composite_row_key(const FieldDescriptor* const   fds,
+                  const vector<FIELD_INDEX>&     fields,
+                  const uint8_t* const           rowData)
+{
+  CompositeKey result;
+
+  for (auto field : fields)
+  {
+    switch (fds[field].Type())
+    {
+    case T_BOOL:
+      add_composite_value<DBool>(result, fds[field], rowData);
+      break;
+
+    case T_CHAR:
+      add_composite_value<DChar>(result, fds[field], rowData);
+      break;
+
+    case T_DATE:
+      add_composite_value<DDate>(result, fds[field], rowData);
+      break;
+
+    case T_DATETIME:
+      add_composite_value<DDateTime>(result, fds[field], rowData);
+      break;
+
+    case T_HIRESTIME:
+      add_composite_value<DHiresTime>(result, fds[field], rowData);
+      break;
+
+    case T_INT8:
+      add_composite_value<DInt8>(result, fds[field], rowData);
+      break;
+
+    case T_INT16:
+      add_composite_value<DInt16>(result, fds[field], rowData);
+      break;
+
+    case T_INT32:
+      add_composite_value<DInt32>(result, fds[field], rowData);
+      break;
+
+    case T_INT64:
+      add_composite_value<DInt64>(result, fds[field], rowData);
+      break;
+
+    case T_REAL:
+      add_composite_value<DReal>(result, fds[field], rowData);
+      break;
+
+    case T_RICHREAL:
+      add_composite_value<DRichReal>(result, fds[field], rowData);
+      break;
+
+    case T_UINT8:
+      add_composite_value<DUInt8>(result, fds[field], rowData);
+      break;
+
+    case T_UINT16:
+      add_composite_value<DUInt16>(result, fds[field], rowData);
+      break;
+
+    case T_UINT32:
+      add_composite_value<DUInt32>(result, fds[field], rowData);
+      break;
 
-      uint32_t cp;
-      wh_load_utf8_cp(utf8buffer + verified, &cp);
-      DChar chk_cp_valid(cp);
+    case T_UINT64:
+      add_composite_value<DUInt64>(result, fds[field], rowData);
+      break;
 
-      verified += unitsCount;
-    }
-    catch (...)
-    {
-      return false;
+    default:
+      throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
     }
   }
 
-  return verified == bufferSize;
+  return result;
 }
 
 
-static void
-remove_extra_container_files(FIX_ERROR_CALLBACK   fixCallback,
-                             const string         baseFile,
-                             const uint64_t       containerSize,
-                             const uint64_t       maxFileSize)
+void
+composite_row_values(vector<CompositeIndex>&        compositeIndexes,
+                     const FieldDescriptor* const   fds,
+                     const ROW_INDEX                row,
+                     const uint8_t* const           rowData,
+                     const bool                     removeValues)
 {
-  uint_t seriesStart = containerSize / maxFileSize + 1;
-
-  if ((containerSize == 0) || (containerSize % maxFileSize == 0))
-    --seriesStart;
-
-  while (true)
+  for (auto& index : compositeIndexes)
   {
-    string fileName = baseFile;
-
-    if (seriesStart != 0)
-      append_int_to_str(seriesStart, fileName);
+    NODE_INDEX dummyNode;
+    KEY_INDEX dummyKey;
 
-    if ( ! whf_file_exists(fileName.c_str()))
-      return;
+    const CompositeBTreeKey key(composite_row_key(fds, index.mFields, rowData), row);
+    if (removeValues)
+      BTree(*index.mNodeMgr).RemoveKey(key);
 
-    fixCallback(INFORMATION, "Removing extra file '%s.", fileName.c_str());
-    if ( ! whf_remove(fileName.c_str()))
-    {
-      throw WFileContainerException(_EXTRA(WFileContainerException::FILE_OS_IO_ERROR),
-                                    "Failed to remove file '%s'.",
-                                    fileName.c_str());
-    }
-    ++seriesStart;
+    else
+      BTree(*index.mNodeMgr).InsertKey(key, &dummyNode, &dummyKey);
   }
 }
 
@@ -1197,7 +2790,8 @@ bool
 PersistentTable::RepairTable(DbsHandler&           dbs,
                              const std::string&    name,
                              const std::string&    path,
-                              FIX_ERROR_CALLBACK   fixCallback)
+                             FIX_ERROR_CALLBACK    fixCallback,
+                             const uint_t          threadsCount)
 {
   const DBSSettings& settings = dbs.Settings();
 
@@ -1224,6 +2818,7 @@ PersistentTable::RepairTable(DbsHandler&           dbs,
 
   uint32_t rowsCount = load_le_int32(tableHeader.get() + PS_TABLE_ROWS_COUNT_OFF);
   uint64_t vsDataSize = load_le_int64(tableHeader.get() + PS_TABLE_VARSTORAGE_SIZE_OFF);
+  const uint32_t vsVersion = load_le_int32(tableHeader.get() + PS_TABLE_VARSTORAGE_VER_OFF);
 
   unique_ptr<uint8_t[]> fieldsDescs(unique_array_make(uint8_t, descSize));
 
@@ -1235,6 +2830,8 @@ PersistentTable::RepairTable(DbsHandler&           dbs,
   const auto fds = _RC(FieldDescriptor*, fieldsDescs.get());
 
   std::vector<FieldIndexNodeManager*> indexNodeMgrs;
+  std::vector<FieldHashIndex*> hashIndexes;
+  std::vector<FieldBitmapIndex*> bitmapIndexes;
   for (FIELD_INDEX i = 0; i < fieldsCount; ++i)
   {
     if ((fds[i].IndexNodeSizeKB() == 0)
@@ -1242,8 +2839,11 @@ PersistentTable::RepairTable(DbsHandler&           dbs,
       {
         fds[i].IndexNodeSizeKB(0);
         fds[i].IndexUnitsCount(0);
+        fds[i].IndexKind(INDEX_BTREE);
 
         indexNodeMgrs.push_back(nullptr);
+        hashIndexes.push_back(nullptr);
+        bitmapIndexes.push_back(nullptr);
         continue;
       }
 
@@ -1260,6 +2860,27 @@ PersistentTable::RepairTable(DbsHandler&           dbs,
                                                           settings.mMaxFileSize,
                                                           0,
                                                           false));
+    if (fds[i].IndexKind() == INDEX_HASH)
+    {
+      indexNodeMgrs.push_back(nullptr);
+      hashIndexes.push_back(new FieldHashIndex(indexContainer,
+                                               fds[i].IndexNodeSizeKB() * 1024,
+                                               true));
+      bitmapIndexes.push_back(nullptr);
+      continue;
+    }
+    else if ((fds[i].IndexKind() == INDEX_BITMAP)
+             || (fds[i].IndexKind() == INDEX_TRIGRAM)
+             || (fds[i].IndexKind() == INDEX_ELEMENTS))
+    {
+      indexNodeMgrs.push_back(nullptr);
+      hashIndexes.push_back(nullptr);
+      bitmapIndexes.push_back(new FieldBitmapIndex(indexContainer, true));
+      continue;
+    }
+
+    hashIndexes.push_back(nullptr);
+    bitmapIndexes.push_back(nullptr);
     indexNodeMgrs.push_back(new FieldIndexNodeManager(indexContainer,
                                                       fds[i].IndexNodeSizeKB() * 1024,
                                                       0x400000, //4MB
@@ -1267,6 +2888,90 @@ PersistentTable::RepairTable(DbsHandler&           dbs,
                                                       true));
   }
 
+  //The composite indexes are rebuilt too, the ones whose fields still suit them.
+  vector<CompositeIndexEntry> compositeEntries;
+  vector<CompositeIndex> compositeIndexes;
+  if ( ! load_composite_indexes(fileNamePrefix + PS_TABLE_COMPOSITE_EXT, compositeEntries))
+  {
+    fixCallback(INFORMATION,
+                "Dropping the composite indexes of table '%s', as their list is damaged.",
+                name.c_str());
+    compositeEntries.clear();
+  }
+
+  for (const auto& entry : compositeEntries)
+  {
+    bool valid = true;
+    for (auto field : entry.mFields)
+    {
+      valid = valid
+              && (field < fieldsCount)
+              && (sort_key_size(_SC(DBS_FIELD_TYPE, fds[field].Type())) > 0);
+    }
+
+    if ( ! valid)
+    {
+      fixCallback(INFORMATION,
+                  "Dropping a composite index of table '%s' not matching its fields.",
+                  name.c_str());
+      continue;
+    }
+
+    const string containerName = composite_container_name(fileNamePrefix, fds, entry.mFields);
+
+    FileContainer::Fix(containerName.c_str(), settings.mMaxFileSize, 0);
+    unique_ptr<IDataContainer> indexContainer(unique_make(FileContainer,
+                                                          containerName.c_str(),
+                                                          settings.mMaxFileSize,
+                                                          0,
+                                                          false));
+    CompositeIndex index;
+
+    index.mFields = entry.mFields;
+    index.mNodeMgr = new FieldIndexNodeManager(indexContainer,
+                                               entry.mNodeSizeKB * 1024,
+                                               0x400000, //4MB
+                                               PS_COMPOSITE_KEY_TYPE,
+                                               true);
+    compositeIndexes.push_back(index);
+  }
+
+  const LegacyRowsLayout legacyRows = load_legacy_rows_layout(tableHeader.get());
+  if (legacyRows.mRowSize > 0)
+  {
+    fixCallback(INFORMATION,
+                "Converting the rows of table '%s' to its current layout.",
+                name.c_str());
+
+    convert_legacy_rows(fileNamePrefix + PS_TABLE_FIXFIELDS_EXT,
+                        settings.mMaxFileSize,
+                        legacyRows,
+                        fds,
+                        rowSize);
+
+    store_legacy_rows_layout(LegacyRowsLayout(), tableHeader.get());
+  }
+  else
+    remove_container_files(fileNamePrefix + PS_TABLE_FIXFIELDS_EXT + PS_TABLE_LEGACY_EXT);
+
+  //The values kept in the format of a previous version are converted first,
+  //the ones that could not be followed are set to null.
+  if ((vsVersion < VariableSizeStore::FORMAT_VERSION) && (vsDataSize > 0))
+  {
+    fixCallback(INFORMATION,
+                "Converting the variable size values of table '%s' to the current format.",
+                name.c_str());
+
+    vsDataSize = migrate_variable_store(fileNamePrefix,
+                                        vsDataSize,
+                                        settings.mMaxFileSize,
+                                        fds,
+                                        fieldsCount,
+                                        rowSize,
+                                        rowsCount,
+                                        true);
+  }
+
   FileContainer tableData(fileNamePrefix.c_str(), settings.mMaxFileSize, 1, false);
   FileContainer rowsData((fileNamePrefix + PS_TABLE_FIXFIELDS_EXT).c_str(),
                          settings.mMaxFileSize,
@@ -1296,347 +3001,94 @@ PersistentTable::RepairTable(DbsHandler&           dbs,
   {
     vsData->Init((fileNamePrefix + PS_TABLE_VARFIELDS_EXT).c_str(),
                  vsDataSize,
-                 settings.mMaxFileSize);
+                 settings.mMaxFileSize,
+                 true);
     vsData->PrepareToCheckStorage();
   }
 
-  unique_ptr<uint8_t[]> _d(unique_array_make(uint8_t, rowSize));
-  uint8_t* const rowData = _d.get();
-  for (ROW_INDEX row = 0; row < rowsCount; ++row)
   {
-    NODE_INDEX dummyNode;
-    KEY_INDEX dummyKey;
-
-    bool allFieldsAreNull = true;
-
-    rowsData.Read(row * rowSize, rowSize, rowData);
-
-    for (FIELD_INDEX field = 0; field < fieldsCount; ++field)
-    {
-      const uint_t byteOff = fds[field].NullBitIndex() / 8;
-      const uint_t bitOff = fds[field].NullBitIndex() % 8;
-      const uint8_t* const fieldData = rowData + fds[field].RowDataOff();
-
-      bool isNullValue = ((rowData[byteOff] & (1 << bitOff)) != 0);
-
-      if (IS_ARRAY(fds[field].Type()) && !isNullValue)
-      {
-        const uint64_t fieldEntry = load_le_int64(fieldData);
-        const uint64_t fieldSize = load_le_int64(fieldData + sizeof(uint64_t));
-        if (fieldSize & 0x8000000000000000ull)
-        {
-          if ( ! check_array_buffer(fieldData,
-                                    (fieldSize >> 56) & 0x7F,
-                                    _SC(DBS_FIELD_TYPE, GET_BASE_TYPE(fds[field].Type()))))
-
-          {
-            fixCallback(FIX_INFO,
-                        "Detected invalid value of field '%s' at row %u. Set to nullptr.",
-                        fieldsDescs.get() + fds[field].NameOffset(), row);
-            isNullValue = true;
-          }
-        }
-        else if ( ! vsData->CheckArrayEntry(fieldEntry,
-                                            fieldSize,
-                                            _SC(DBS_FIELD_TYPE, GET_BASE_TYPE(fds[field].Type()))))
-        {
-          fixCallback(FIX_INFO, "Detected invalid value of field '%s' at row"
-              " %u. Set to nullptr.", fieldsDescs.get() + fds[field].NameOffset(), row);
-          isNullValue = true;
-        }
-      }
-      else if (GET_BASE_TYPE(fds[field].Type()) == T_TEXT && ! isNullValue)
-      {
-        const uint64_t fieldEntry = load_le_int64(fieldData);
-        const uint64_t fieldSize = load_le_int64(fieldData + sizeof(uint64_t));
-        if ((fieldSize & 0x8000000000000000ull) != 0)
-        {
-          if ( ! check_text_buffer(fieldData, (fieldSize >> 56) & 0x7F))
-          {
-            fixCallback(FIX_INFO,
-                        "Detected invalid value of field '%s' at row %u. Set to nullptr.",
-                        fieldsDescs.get() + fds[field].NameOffset(), row);
-            isNullValue = true;
-          }
-        }
-        else if (!vsData->CheckTextEntry(fieldEntry, fieldSize))
-        {
-          fixCallback(FIX_INFO,
-                      "Detected invalid value of field '%s' at row %u. Set to nullptr.",
-                      fieldsDescs.get() + fds[field].NameOffset(), row);
-          isNullValue = true;
-        }
-      }
-      else if ((indexNodeMgrs[field] != nullptr))
-      {
-        switch (GET_BASE_TYPE(fds[field].Type()))
-        {
-        case T_BOOL:
-        {
-          DBool value;
-
-          if (!isNullValue && !Serializer::ValidateDBoolBuffer(fieldData))
-          {
-            fixCallback(FIX_INFO,
-                        "Detected invalid value of field '%s' at row %u. Set to nullptr.",
-                        fieldsDescs.get() + fds[field].NameOffset(), row);
-            isNullValue = true;
-          }
-
-          if ( ! isNullValue)
-            Serializer::Load(fieldData, &value);
-
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DBool>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        case T_CHAR:
-        {
-          DChar value;
-
-          if ( ! isNullValue && ! Serializer::ValidateDCharBuffer(fieldData))
-          {
-            fixCallback(FIX_INFO,
-                        "Detected invalid value of field '%s' at row %u. Set to nullptr.",
-                        fieldsDescs.get() + fds[field].NameOffset(), row);
-            isNullValue = true;
-          }
+    RowsCheckJob job(name,
+                     fileNamePrefix + PS_TABLE_FIXFIELDS_EXT,
+                     settings,
+                     fds,
+                     fieldsCount,
+                     rowSize,
+                     rowsCount,
+                     (vsDataSize > 0) ? vsData.get() : nullptr,
+                     fixCallback);
 
-          if (!isNullValue)
-            Serializer::Load(fieldData, &value);
+    //The calling thread does its share of the work too.
+    const uint_t workersCount = min<int64_t>(MAX(threadsCount, 1u), job.mChunksCount);
+    unique_ptr<Thread[]> workers(unique_array_make(Thread, workersCount));
 
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DChar>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        case T_DATE:
-        {
-          DDate value;
-
-          if ( ! isNullValue && ! Serializer::ValidateDDateBuffer(fieldData))
-          {
-            fixCallback(FIX_INFO,
-                        "Detected invalid value of field '%s' at row %u. Set to nullptr.",
-                        fieldsDescs.get() + fds[field].NameOffset(), row);
-            isNullValue = true;
-          }
-
-          if (!isNullValue)
-            Serializer::Load(fieldData, &value);
-
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DDate>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        case T_DATETIME:
-        {
-          DDateTime value;
-
-          if ( ! isNullValue && ! Serializer::ValidateDDateTimeBuffer(fieldData))
-          {
-            fixCallback(FIX_INFO,
-                        "Detected invalid value of field '%s' at row %u. Set to nullptr.",
-                        fieldsDescs.get() + fds[field].NameOffset(), row);
-            isNullValue = true;
-          }
-
-          if ( ! isNullValue)
-            Serializer::Load(fieldData, &value);
-
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DDateTime>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        case T_HIRESTIME:
-        {
-          DHiresTime value;
-
-          if ( ! isNullValue && ! Serializer::ValidateDHiresTimeBuffer(fieldData))
-          {
-            fixCallback(FIX_INFO,
-                        "Detected invalid value of field '%s' at row %u. Set to nullptr.",
-                        fieldsDescs.get() + fds[field].NameOffset(), row);
-            isNullValue = true;
-          }
-
-          if ( ! isNullValue)
-            Serializer::Load(fieldData, &value);
-
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DHiresTime>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        case T_INT8:
-        {
-          DInt8 value;
-
-          if ( ! isNullValue)
-            Serializer::Load(fieldData, &value);
-
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DInt8>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        case T_INT16:
-        {
-          DInt16 value;
+    for (uint_t i = 1; i < workersCount; ++i)
+      workers[i].Run(check_rows_routine, &job);
 
-          if ( ! isNullValue)
-            Serializer::Load(fieldData, &value);
+    check_rows_routine(&job);
 
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DInt16>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        case T_INT32:
-        {
-          DInt32 value;
-
-          if ( ! isNullValue)
-            Serializer::Load(fieldData, &value);
-
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DInt32>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        case T_INT64:
-        {
-          DInt64 value;
-
-          if ( ! isNullValue)
-            Serializer::Load(fieldData, &value);
-
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DInt64>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        case T_REAL:
-        {
-          DReal value;
-
-          if ( ! isNullValue && ! Serializer::ValidateDRealBuffer(fieldData))
-          {
-            fixCallback(FIX_INFO,
-                        "Detected invalid value of field '%s' at row %u. Set to nullptr.",
-                        fieldsDescs.get() + fds[field].NameOffset(),
-                        row);
-            isNullValue = true;
-          }
+    for (uint_t i = 1; i < workersCount; ++i)
+      workers[i].WaitToEnd(false);
 
-          if (!isNullValue)
-            Serializer::Load(fieldData, &value);
+    if (job.mFailed)
+      throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR),
+                         "Failed to check the rows of table '%s'.",
+                         name.c_str());
 
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DReal>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        case T_RICHREAL:
-        {
-          DRichReal value;
-
-          if ( ! isNullValue && ! Serializer::ValidateDRichRealBuffer(fieldData))
-          {
-            fixCallback(FIX_INFO,
-                        "Detected invalid value of field '%s' at row %u. Set to nullptr.",
-                        fieldsDescs.get() + fds[field].NameOffset(),
-                        row);
-            isNullValue = true;
-          }
-
-          if (!isNullValue)
-            Serializer::Load(fieldData, &value);
-
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DRichReal>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        case T_UINT8:
-        {
-          DUInt8 value;
-
-          if ( ! isNullValue)
-            Serializer::Load(fieldData, &value);
-
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DUInt8>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
+    NODE_INDEX dummyNode;
+    KEY_INDEX dummyKey;
 
-        case T_UINT16:
-        {
-          DUInt16 value;
+    bool hasIndexes = false;
+    for (auto mgr : indexNodeMgrs)
+      hasIndexes |= (mgr != nullptr);
 
-          if ( ! isNullValue)
-            Serializer::Load(fieldData, &value);
+    for (auto hashIndex : hashIndexes)
+      hasIndexes |= (hashIndex != nullptr);
 
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DUInt16>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
+    for (auto bitmapIndex : bitmapIndexes)
+      hasIndexes |= (bitmapIndex != nullptr);
 
-        case T_UINT32:
-        {
-          DUInt32 value;
+    hasIndexes |= ! compositeIndexes.empty();
 
-          if ( ! isNullValue)
-            Serializer::Load(fieldData, &value);
+    //The indexes are built with the values left after the rows check.
+    if (hasIndexes)
+    {
+      unique_ptr<uint8_t[]> chunkData(unique_array_make(uint8_t, CHECK_CHUNK_ROWS * rowSize));
 
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DUInt32>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
+      for (ROW_INDEX firstRow = 0; firstRow < rowsCount; firstRow += CHECK_CHUNK_ROWS)
+      {
+        const ROW_INDEX chunkRows = MIN(CHECK_CHUNK_ROWS, rowsCount - firstRow);
 
-        case T_UINT64:
+        rowsData.Read(firstRow * rowSize, chunkRows * rowSize, chunkData.get());
+        for (ROW_INDEX i = 0; i < chunkRows; ++i)
         {
-          DUInt64 value;
-
-          if ( ! isNullValue)
-            Serializer::Load(fieldData, &value);
-
-          BTree(*indexNodeMgrs[field]).InsertKey(T_BTreeKey<DUInt64>(value, row),
-                                                 &dummyNode,
-                                                 &dummyKey);
-        }
-          break;
-
-        default:
-          throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
+          index_row_values(indexNodeMgrs,
+                           fds,
+                           fieldsCount,
+                           firstRow + i,
+                           chunkData.get() + i * rowSize,
+                           (vsDataSize > 0) ? vsData.get() : nullptr);
+          hash_row_values(hashIndexes,
+                          fds,
+                          fieldsCount,
+                          firstRow + i,
+                          chunkData.get() + i * rowSize,
+                          (vsDataSize > 0) ? vsData.get() : nullptr);
+          bitmap_row_values(bitmapIndexes,
+                            fds,
+                            fieldsCount,
+                            firstRow + i,
+                            chunkData.get() + i * rowSize,
+                            (vsDataSize > 0) ? vsData.get() : nullptr);
+          composite_row_values(compositeIndexes,
+                               fds,
+                               firstRow + i,
+                               chunkData.get() + i * rowSize);
         }
       }
-
-      if (isNullValue)
-        rowData[byteOff] |= (1 << bitOff);
-
-      allFieldsAreNull &= isNullValue;
     }
-    rowsData.Write(row * rowSize, rowSize, rowData);
 
-    if (allFieldsAreNull)
+    sort(job.mNullRows.begin(), job.mNullRows.end());
+    for (auto row : job.mNullRows)
     {
       BTree removedNodes(tableNodeMgr);
       TableRmKey key(row);
@@ -1665,11 +3117,38 @@ PersistentTable::RepairTable(DbsHandler&           dbs,
   store_le_int32(tableNodeMgr.RootNodeId(), tableHeader.get() + PS_TABLE_BT_ROOT_OFF);
   store_le_int64(tableData.Size(), tableHeader.get() + PS_TABLE_MAINTABLE_SIZE_OFF);
 
-  store_le_int32(0, tableHeader.get() + PS_TABLE_FLAGS_OFF);
+  store_le_int32(load_le_int32(tableHeader.get() + PS_TABLE_FLAGS_OFF) & PS_TABLE_ALTERED_MASK,
+                 tableHeader.get() + PS_TABLE_FLAGS_OFF);
+  store_le_int32(VariableSizeStore::FORMAT_VERSION,
+                 tableHeader.get() + PS_TABLE_VARSTORAGE_VER_OFF);
 
   for (FIELD_INDEX field = 0; field < fieldsCount; ++field)
   {
-    if (indexNodeMgrs[field] == nullptr)
+    if (hashIndexes[field] != nullptr)
+    {
+      hashIndexes[field]->Flush();
+
+      uint64_t unitsCount = hashIndexes[field]->IndexRawSize();
+      unitsCount += settings.mMaxFileSize - 1;
+      unitsCount /= settings.mMaxFileSize;
+
+      fds[field].IndexUnitsCount(unitsCount);
+      delete hashIndexes[field];
+      continue;
+    }
+    else if (bitmapIndexes[field] != nullptr)
+    {
+      bitmapIndexes[field]->Flush();
+
+      uint64_t unitsCount = bitmapIndexes[field]->IndexRawSize();
+      unitsCount += settings.mMaxFileSize - 1;
+      unitsCount /= settings.mMaxFileSize;
+
+      fds[field].IndexUnitsCount(unitsCount);
+      delete bitmapIndexes[field];
+      continue;
+    }
+    else if (indexNodeMgrs[field] == nullptr)
     {
       assert(fds[field].IndexNodeSizeKB() == 0);
       assert(fds[field].IndexUnitsCount() == 0);
@@ -1689,6 +3168,16 @@ PersistentTable::RepairTable(DbsHandler&           dbs,
     delete indexNodeMgrs[field];
   }
 
+  for (auto& index : compositeIndexes)
+    index.mNodeMgr->FlushNodes();
+
+  store_composite_indexes(fileNamePrefix + PS_TABLE_COMPOSITE_EXT,
+                          compositeIndexes,
+                          settings.mMaxFileSize,
+                          nullptr);
+  for (auto& index : compositeIndexes)
+    delete index.mNodeMgr;
+
   tableData.Write(0, PS_HEADER_SIZE, tableHeader.get());
   tableData.Write(PS_HEADER_SIZE, descSize, fieldsDescs.get());
 
@@ -1734,6 +3223,8 @@ TemporalTable::TemporalTable(DbsHandler&                       dbs,
   mFieldsDescriptors.reset(fieldDescs.release());
 
   mvIndexNodeMgrs.insert(mvIndexNodeMgrs.begin(), mFieldsCount, nullptr);
+  mvHashIndexes.insert(mvHashIndexes.begin(), mFieldsCount, nullptr);
+  mvBitmapIndexes.insert(mvBitmapIndexes.begin(), mFieldsCount, nullptr);
 
   uint_t blkSize = DBSSettings().mTableCacheBlkSize;
   const uint_t blkCount = DBSSettings().mTableCacheBlkCount;
@@ -1753,6 +3244,8 @@ TemporalTable::TemporalTable(const PrototypeTable& prototype)
 {
 
   mvIndexNodeMgrs.insert(mvIndexNodeMgrs.begin(), mFieldsCount, nullptr);
+  mvHashIndexes.insert(mvHashIndexes.begin(), mFieldsCount, nullptr);
+  mvBitmapIndexes.insert(mvBitmapIndexes.begin(), mFieldsCount, nullptr);
 
   uint_t       blkSize  = DBSSettings().mTableCacheBlkSize;
   const uint_t blkCount = DBSSettings().mTableCacheBlkCount;
@@ -1768,7 +3261,14 @@ TemporalTable::TemporalTable(const PrototypeTable& prototype)
 TemporalTable::~TemporalTable()
 {
   for (FIELD_INDEX fieldIndex = 0; fieldIndex < mFieldsCount; ++fieldIndex)
+  {
     delete mvIndexNodeMgrs[fieldIndex];
+    delete mvHashIndexes[fieldIndex];
+    delete mvBitmapIndexes[fieldIndex];
+  }
+
+  for (auto& index : mvCompositeIndexes)
+    delete index.mNodeMgr;
 }
 
 bool
@@ -1794,6 +3294,18 @@ TemporalTable::FlushEpilog()
     mVSData->Flush();
 }
 
+uint64_t
+TemporalTable::BeginContentSync()
+{
+  return 0;
+}
+
+void
+TemporalTable::EndContentSync(const uint64_t)
+{
+  //Do nothing!
+}
+
 void
 TemporalTable::MakeHeaderPersistent()
 {
@@ -1806,6 +3318,18 @@ TemporalTable::CreateIndexContainer(const FIELD_INDEX)
   return new TemporalContainer();
 }
 
+IDataContainer*
+TemporalTable::CreateCompositeIndexContainer(const vector<FIELD_INDEX>&)
+{
+  return new TemporalContainer();
+}
+
+void
+TemporalTable::MakeCompositeIndexesPersistent()
+{
+  //Do nothing!
+}
+
 IDataContainer&
 TemporalTable::TableContainer()
 {
@@ -1836,6 +3360,37 @@ TemporalTable::VSStore()
   return mVSData;
 }
 
+RedoLog*
+TemporalTable::TableRedoLog()
+{
+  return nullptr; //The temporal tables updates are not logged.
+}
+
+const std::string&
+TemporalTable::TableName() const
+{
+  static const std::string noName;
+
+  return noName;
+}
+
+
+IDataContainer&
+TemporalTable::LegacyRowsContainer()
+{
+  //The temporal tables are never altered.
+  assert(false);
+
+  return RowsContainer();
+}
+
+
+void
+TemporalTable::EndRowsConversion()
+{
+  assert(false);
+}
+
 
 } //namespace pastra
 } //namespace whais
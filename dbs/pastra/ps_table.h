@@ -41,7 +41,7 @@ prototype_fix_table(DbsHandler&          dbs,
 class PersistentTable : public PrototypeTable
 {
 public:
-  PersistentTable(DbsHandler& dbs, const std::string& name);
+  PersistentTable(DbsHandler& dbs, const std::string& name, const bool recovering = false);
   PersistentTable(DbsHandler&                       dbs,
                   const std::string&                name,
                   const DBSFieldDescriptor* const   inoutFields,
@@ -51,37 +51,70 @@ public:
 
   void RemoveFromDatabase();
 
+  //Like Flush(), but the table is locked only while its content is taken in
+  //memory. It reaches the files afterwards.
+  void FlushDeferred();
+
+  //Change the table layout while keeping its rows, so only what the stored
+  //values allow: a new field or a wider type for a field.
+  void AddField(const DBSFieldDescriptor& field);
+  void RetypeField(const FIELD_INDEX field, const DBS_FIELD_TYPE type);
+
   virtual bool IsTemporal() const override;
   virtual ITable& Spawn() const override;
   virtual void FlushEpilog() override;
+  virtual uint64_t BeginContentSync() override;
+  virtual void EndContentSync(const uint64_t lsn) override;
+  virtual bool FlushSome(const uint_t maxBlocks) override;
 
 public:
   static bool ValidateTable(const std::string& path, const std::string& name);
   static bool RepairTable(DbsHandler&          dbs,
                           const std::string&   name,
                           const std::string&   path,
-                          FIX_ERROR_CALLBACK   fixCallback);
+                          FIX_ERROR_CALLBACK   fixCallback,
+                          const uint_t         threadsCount = 1);
 
 protected:
   virtual void MakeHeaderPersistent() override;
   virtual IDataContainer* CreateIndexContainer(const FIELD_INDEX field) override;
+  virtual IDataContainer* CreateCompositeIndexContainer(const std::vector<FIELD_INDEX>& fields) override;
+  virtual void MakeCompositeIndexesPersistent() override;
   virtual IDataContainer& RowsContainer() override;
   virtual IDataContainer& TableContainer() override;
   virtual VariableSizeStoreSPtr VSStore() override;
+  virtual RedoLog* TableRedoLog() override;
+  virtual const std::string& TableName() const override;
+  virtual IDataContainer& LegacyRowsContainer() override;
+  virtual void EndRowsConversion() override;
 
   const DBSSettings&               mDbsSettings;
   uint64_t                         mMaxFileSize;
   uint64_t                         mVSDataSize;
+  uint32_t                         mVSDataVersion;
+  const std::string                mName;
   std::string                      mFileNamePrefix;
+  std::unique_ptr<TableJournal>    mJournal;
+  std::vector<uint8_t>             mPersistedHeader;
   std::unique_ptr<FileContainer>   mTableData;
   std::unique_ptr<FileContainer>   mRowsData;
+  std::unique_ptr<FileContainer>   mLegacyRowsData;
   VariableSizeStoreSPtr            mVSData;
   bool                             mRemoved;
+  bool                             mLayoutAltered;
+  const bool                       mRecovering;
 
 private:
-  void InitFromFile(const std::string& tableName);
+  FileContainer* Journaled(FileContainer* const container);
+  void InitFromFile(const std::string& tableName, const bool recovering);
   void InitIndexedFields();
   void InitVariableStorages();
+  void InitRowsContainers();
+  void ChangeRowsLayout(uint8_t* const             descriptors,
+                        const uint32_t             descriptorsSize,
+                        const FIELD_INDEX          fieldsCount,
+                        const uint32_t             rowSize,
+                        const LegacyRowsLayout&    legacyRows);
   void CheckTableValues(FIX_ERROR_CALLBACK fixCallback);
 };
 
@@ -99,13 +132,21 @@ public:
   virtual bool IsTemporal() const override;
   virtual ITable& Spawn() const override;
   virtual void FlushEpilog() override;
+  virtual uint64_t BeginContentSync() override;
+  virtual void EndContentSync(const uint64_t lsn) override;
 
 protected:
   virtual void MakeHeaderPersistent() override;
   virtual IDataContainer* CreateIndexContainer(const FIELD_INDEX field) override;
+  virtual IDataContainer* CreateCompositeIndexContainer(const std::vector<FIELD_INDEX>& fields) override;
+  virtual void MakeCompositeIndexesPersistent() override;
   virtual IDataContainer& RowsContainer() override;
   virtual IDataContainer& TableContainer() override;
   virtual VariableSizeStoreSPtr VSStore() override;
+  virtual RedoLog* TableRedoLog() override;
+  virtual const std::string& TableName() const override;
+  virtual IDataContainer& LegacyRowsContainer() override;
+  virtual void EndRowsConversion() override;
 
   std::unique_ptr<TemporalContainer>   mTableData;
   std::unique_ptr<TemporalContainer>   mRowsData;
@@ -22,14 +22,22 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
+
 #include "utils/endianness.h"
 #include "utils/wutf.h"
 #include "utils/wunicode.h"
-#include "utils/wsort.h"
 #include "ps_templatetable.h"
 #include "ps_serializer.h"
 #include "ps_textstrategy.h"
 #include "ps_arraystrategy.h"
+#include "ps_sortkeys.h"
+#include "ps_loader.h"
+#include "ps_exporter.h"
+#include "ps_fieldstats.h"
+#include "utils/whash.h"
 
 
 using namespace std;
@@ -38,6 +46,158 @@ namespace whais {
 namespace pastra {
 
 
+//How much of the loaded rows are read back at once, to index or discard them.
+static const uint_t LOAD_CHUNK_SIZE = 256 * 1024;
+
+//Beyond this many distinct values a field is better served by a B-tree.
+static const uint_t BITMAP_INDEX_MAX_VALUES = 1024;
+
+//How many rows changes of a field are kept aside, while its index updates are
+//deferred, before they are applied.
+static const size_t MAX_PENDING_INDEX_KEYS = 64 * 1024;
+
+
+class TextRedoContent : public IRedoContent
+{
+public:
+  TextRedoContent(ITextStrategy& text)
+    : mText(text)
+  {
+  }
+
+  virtual uint64_t Size() override
+  {
+    return mText.Utf8CountU();
+  }
+
+  virtual void Read(const uint64_t offset, const uint_t size, uint8_t* const buffer) override
+  {
+    mText.ReadUtf8U(offset, size, buffer);
+  }
+
+private:
+  ITextStrategy& mText;
+};
+
+
+class ArrayRedoContent : public IRedoContent
+{
+public:
+  ArrayRedoContent(IArrayStrategy& array)
+    : mArray(array)
+  {
+  }
+
+  virtual uint64_t Size() override
+  {
+    return mArray.RawSize();
+  }
+
+  virtual void Read(const uint64_t offset, const uint_t size, uint8_t* const buffer) override
+  {
+    mArray.RawRead(offset, size, buffer);
+  }
+
+private:
+  IArrayStrategy& mArray;
+};
+
+
+template<class T> static uint64_t
+log_field_value(RedoLog&            log,
+                const string&       table,
+                const ROW_INDEX     row,
+                const FIELD_INDEX   field,
+                const uint_t        type,
+                const T&            value)
+{
+  if (value.IsNull())
+    return log.LogFieldValue(table, row, field, type, nullptr, 0);
+
+  uint8_t rawValue[Serializer::MAX_VALUE_RAW_SIZE];
+  const uint_t rawSize = Serializer::Size(_SC(DBS_FIELD_TYPE, type), false);
+
+  assert(rawSize <= sizeof rawValue);
+
+  Serializer::Store(rawValue, value);
+
+  return log.LogFieldValue(table, row, field, type, rawValue, rawSize);
+}
+
+
+template<class T> static void
+redo_field_value(ITable& table, const RedoRecord& record)
+{
+  T value;
+
+  if ( ! record.mIsNull)
+  {
+    if (record.mValueSize != Serializer::Size(value.DBSType(), false))
+    {
+      throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY),
+                         "Redo record %lu holds a value of an unexpected size.",
+                         _SC(long, record.mLsn));
+    }
+    Serializer::Load(record.mValue, &value);
+  }
+
+  table.Set(record.mRow, record.mField, value);
+}
+
+
+template<class T> static void
+redo_array_value(ITable& table, const RedoRecord& record)
+{
+  DArray array;
+  T element;
+
+  const uint_t elementSize = Serializer::Size(element.DBSType(), false);
+  if (record.mValueSize % elementSize != 0)
+  {
+    throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY),
+                       "Redo record %lu holds an array of an unexpected size.",
+                       _SC(long, record.mLsn));
+  }
+
+  for (uint64_t offset = 0; offset < record.mValueSize; offset += elementSize)
+  {
+    Serializer::Load(record.mValue + offset, &element);
+    array.Add(element);
+  }
+
+  table.Set(record.mRow, record.mField, array);
+}
+
+
+void
+convert_legacy_row(const LegacyRowsLayout&        layout,
+                   const FieldDescriptor* const   fields,
+                   const uint8_t* const           legacyRow,
+                   const uint_t                   rowSize,
+                   uint8_t* const                 outRow)
+{
+  assert(layout.mRowSize < rowSize);
+
+  //The fields added later are null, the same as the bits left unused.
+  memcpy(outRow, legacyRow, layout.mRowSize);
+  memset(outRow + layout.mRowSize, 0xFF, rowSize - layout.mRowSize);
+
+  if (layout.mRetypedField == LegacyRowsLayout::NO_RETYPED_FIELD)
+    return;
+
+  const FieldDescriptor& field = fields[layout.mRetypedField];
+  const uint_t nullBit = field.NullBitIndex();
+
+  if (outRow[nullBit / 8] & (1 << (nullBit % 8)))
+    return;
+
+  Serializer::Widen(_SC(DBS_FIELD_TYPE, layout.mRetypedFieldType),
+                    legacyRow + layout.mRetypedFieldOff,
+                    _SC(DBS_FIELD_TYPE, field.Type()),
+                    outRow + field.RowDataOff());
+}
+
+
 PrototypeTable::PrototypeTable(DbsHandler& dbs)
   : mDbs(dbs),
     mRowsCount(0),
@@ -47,7 +207,10 @@ PrototypeTable::PrototypeTable(DbsHandler& dbs)
     mDescriptorsSize(0),
     mFieldsCount(0),
     mRowModified(false),
-    mLockInProgress(false)
+    mLockInProgress(false),
+    mConvertedRows(0),
+    mUpdatesCount(0),
+    mDeferIndexesUpdates(false)
 {
 }
 
@@ -62,10 +225,15 @@ PrototypeTable::PrototypeTable(const PrototypeTable& prototype)
     mFieldsCount(prototype.mFieldsCount),
     mFieldsDescriptors(),
     mvIndexNodeMgrs(),
+    mvHashIndexes(),
+    mvBitmapIndexes(),
     mRowsSync(),
     mIndexesSync(),
     mRowModified(false),
-    mLockInProgress(false)
+    mLockInProgress(false),
+    mConvertedRows(0),
+    mUpdatesCount(0),
+    mDeferIndexesUpdates(false)
 {
   //TODO: Should be possible for the two prototypes to share the same memory
   //      for fields descriptors.
@@ -84,6 +252,15 @@ PrototypeTable::Flush()
 }
 
 
+bool
+PrototypeTable::FlushSome(const uint_t maxBlocks)
+{
+  LockGuard<Lock> _l(mRowsSync);
+
+  return mRowCache.FlushSome(maxBlocks);
+}
+
+
 void
 PrototypeTable::LockTable()
 {
@@ -299,6 +476,11 @@ PrototypeTable::AddRow(const bool skipThreadSafety)
           insert_null_field_value<DRichReal>(fieldIndexTree, mRowsCount);
           break;
         }
+        case T_TEXT:
+        {
+          insert_null_field_value<TextIndexPrefix>(fieldIndexTree, mRowsCount);
+          break;
+        }
         default:
           assert(false);
         }
@@ -309,10 +491,48 @@ PrototypeTable::AddRow(const bool skipThreadSafety)
     }
   }
 
+  //A new row holds nulls, so it belongs to the null values rows sets. A
+  //null text has no trigrams and a null array no elements.
+  for (uint_t f = 0; f < mvBitmapIndexes.size(); f++)
+  {
+    if (mvBitmapIndexes[f] == nullptr)
+      continue;
+
+    const FieldDescriptor& fd = GetFieldDescriptorInternal(f);
+    if (fd.IndexKind() != INDEX_BITMAP)
+      continue;
+
+    while (fd.IsAcquired())
+      wh_yield();
+
+    mvBitmapIndexes[f]->Add(nullptr, 0, mRowsCount);
+  }
+
+  for (const auto& index : mvCompositeIndexes)
+  {
+    BTree indexTree( *index.mNodeMgr);
+    insert_null_field_value<CompositeKey>(indexTree, mRowsCount);
+  }
+
   // The rows count has to be update before the procedure code is executed.
   // Other way the new content will not be refreshed.
-  mRowCache.RefreshItem(mRowsCount++);
-  return mRowsCount - 1;
+  const ROW_INDEX result = mRowsCount++;
+  mRowCache.RefreshItem(result);
+
+  RedoLog* const log = TableRedoLog();
+  if (log != nullptr)
+  {
+    const uint64_t lsn = log->LogRowAdd(TableName(), result);
+    if ( ! skipThreadSafety)
+    {
+      syncHolder2.unlock();
+      syncGuard.unlock();
+
+      log->CommitWrite(lsn);
+    }
+  }
+
+  return result;
 }
 
 
@@ -466,9 +686,49 @@ PrototypeTable::MarkRowForReuse(const ROW_INDEX row)
 }
 
 
+template<class T> static uint64_t
+value_hash(const T& value)
+{
+  uint8_t data[Serializer::MAX_VALUE_RAW_SIZE];
+
+  assert( ! value.IsNull());
+
+  Serializer::Store(data, value);
+
+  return wh_hash(data, Serializer::Size(value.DBSType(), false));
+}
+
+
+static uint64_t
+value_hash(const DText& value)
+{
+  assert( ! value.IsNull());
+
+  vector<uint8_t> utf8(value.RawSize());
+  value.RawRead(0, utf8.size(), utf8.data());
+
+  return wh_hash(utf8.data(), utf8.size());
+}
+
+
+//The key of a value in a bitmap index is its raw content (none for null).
+template<class T> static uint_t
+value_raw(const T& value, uint8_t* const outData)
+{
+  if (value.IsNull())
+    return 0;
+
+  Serializer::Store(outData, value);
+
+  return Serializer::Size(value.DBSType(), false);
+}
+
+
 template<class T> static void
 insert_row_field(PrototypeTable& table,
-                 BTree& tree,
+                 BTree* const tree,
+                 FieldHashIndex* const hashIndex,
+                 FieldBitmapIndex* const bitmapIndex,
                  const ROW_INDEX row,
                  const FIELD_INDEX field)
 {
@@ -478,19 +738,108 @@ insert_row_field(PrototypeTable& table,
   T rowValue;
   table.Get(row, field, rowValue, true);
 
+  if (bitmapIndex != nullptr)
+  {
+    uint8_t data[Serializer::MAX_VALUE_RAW_SIZE];
+
+    bitmapIndex->Add(data, value_raw(rowValue, data), row);
+    return;
+  }
+  else if (hashIndex != nullptr)
+  {
+    if ( ! rowValue.IsNull())
+      hashIndex->Insert(value_hash(rowValue), row);
+
+    return;
+  }
+
   T_BTreeKey<T> keyValue(rowValue, row);
 
-  tree.InsertKey(keyValue, &dummyNode, &dummyKey);
+  tree->InsertKey(keyValue, &dummyNode, &dummyKey);
+}
+
+
+static void
+insert_row_text_field(PrototypeTable& table,
+                      BTree* const tree,
+                      FieldHashIndex* const hashIndex,
+                      FieldBitmapIndex* const trigramIndex,
+                      const ROW_INDEX row,
+                      const FIELD_INDEX field)
+{
+  NODE_INDEX dummyNode;
+  KEY_INDEX dummyKey;
+
+  DText rowValue;
+  table.Get(row, field, rowValue, true);
+
+  if (trigramIndex != nullptr)
+  {
+    vector<uint8_t> utf8(rowValue.RawSize());
+    vector<uint64_t> trigrams;
+
+    rowValue.RawRead(0, utf8.size(), utf8.data());
+    text_trigrams(utf8.data(), utf8.size(), trigrams);
+
+    trigramIndex->AddTrigrams(trigrams, row);
+    return;
+  }
+  else if (hashIndex != nullptr)
+  {
+    if ( ! rowValue.IsNull())
+      hashIndex->Insert(value_hash(rowValue), row);
+
+    return;
+  }
+
+  tree->InsertKey(TextBTreeKey(TextIndexPrefix(rowValue), row), &dummyNode, &dummyKey);
+}
+
+
+static void
+array_elements(const DArray& array, const uint_t elementSize, vector<uint8_t>& outElements)
+{
+  outElements.resize(array.Count() * elementSize);
+
+  if (array.Count() > 0)
+    array.GetStrategy()->Get(0, array.Count(), outElements.data());
+}
+
+
+static void
+insert_row_array_field(PrototypeTable& table,
+                       FieldBitmapIndex& elementsIndex,
+                       const ROW_INDEX row,
+                       const FIELD_INDEX field)
+{
+  const DBSFieldDescriptor fd = table.DescribeField(field);
+  const uint_t elementSize = Serializer::Size(fd.type, false);
+
+  DArray rowValue;
+  table.Get(row, field, rowValue, true);
+
+  vector<uint8_t> elements;
+  array_elements(rowValue, elementSize, elements);
+
+  elementsIndex.AddElements(elements, elementSize, row);
 }
 
 
 void
 PrototypeTable::CreateIndex(const FIELD_INDEX field,
                             CREATE_INDEX_CALLBACK_FUNC* const cbFunc,
-                            CreateIndexCallbackContext* const cbContext)
+                            CreateIndexCallbackContext* const cbContext,
+                            const DBS_INDEX_KIND kind)
 {
-  if ((cbFunc == nullptr) && (cbContext != nullptr))
+  if (((cbFunc == nullptr) && (cbContext != nullptr))
+      || ((kind != INDEX_BTREE)
+          && (kind != INDEX_HASH)
+          && (kind != INDEX_BITMAP)
+          && (kind != INDEX_TRIGRAM)
+          && (kind != INDEX_ELEMENTS)))
+  {
     throw DBSException(_EXTRA(DBSException::INVALID_PARAMETERS));
+  }
 
   if (field >= mFieldsCount)
   {
@@ -504,91 +853,128 @@ PrototypeTable::CreateIndex(const FIELD_INDEX field,
 
   assert(mvIndexNodeMgrs.size() == mFieldsCount);
 
-  if (mvIndexNodeMgrs[field] != nullptr)
+  if (HasIndex(field))
     throw DBSException(_EXTRA(DBSException::FIELD_INDEXED));
 
   FieldDescriptor& desc = GetFieldDescriptorInternal(field);
 
-  if ((desc.Type() == T_TEXT) || (desc.Type() & PS_TABLE_ARRAY_MASK) != 0)
+  if (((desc.Type() & PS_TABLE_ARRAY_MASK) != 0) != (kind == INDEX_ELEMENTS))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID),
+                       "The array fields support only the elements indexes.");
+  }
+  else if ((kind == INDEX_BITMAP) && (desc.Type() == T_TEXT))
   {
     throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID),
-                       "This implementation does not support indexing text "
-                       "or array fields.");
+                       "This implementation does not support bitmap indexes of text fields.");
+  }
+  else if ((kind == INDEX_TRIGRAM) && (desc.Type() != T_TEXT))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID),
+                       "Only the text fields can have trigram indexes.");
   }
 
-  const uint_t nodeSizeKB  = 16; //16KB
+  //A hash index page holds fewer keys than a node, so it's kept smaller. The
+  //bitmap and trigram indexes have no nodes; their size only marks the field
+  //as indexed.
+  const bool rowsSets = (kind == INDEX_BITMAP)
+                        || (kind == INDEX_TRIGRAM)
+                        || (kind == INDEX_ELEMENTS);
+  const uint_t nodeSizeKB  = (kind == INDEX_HASH) ? 4 : (rowsSets ? 1 : 16);
 
   unique_ptr<IDataContainer> indexContainer(CreateIndexContainer(field));
-  unique_ptr<FieldIndexNodeManager> nodeMgr(new FieldIndexNodeManager(indexContainer,
-                                                                      nodeSizeKB * 1024,
-                                                                      0x400000, //4MB
-                                                                      _SC(DBS_FIELD_TYPE,
-                                                                          desc.Type()),
-                                                                      true));
+  unique_ptr<FieldIndexNodeManager> nodeMgr;
+  unique_ptr<FieldHashIndex> hashIndex;
+  unique_ptr<FieldBitmapIndex> bitmapIndex;
+  unique_ptr<BTree> fieldTree;
+
+  if (kind == INDEX_HASH)
+    hashIndex.reset(new FieldHashIndex(indexContainer, nodeSizeKB * 1024, true));
+
+  else if (rowsSets)
+    bitmapIndex.reset(new FieldBitmapIndex(indexContainer, true));
+
+  else
+  {
+    nodeMgr.reset(new FieldIndexNodeManager(indexContainer,
+                                            nodeSizeKB * 1024,
+                                            0x400000, //4MB
+                                            _SC(DBS_FIELD_TYPE, desc.Type()),
+                                            true));
+    fieldTree.reset(new BTree( *nodeMgr.get()));
+  }
 
-  BTree fieldTree( *nodeMgr.get());
   for (ROW_INDEX row = 0; row < mRowsCount; ++row)
   {
-    switch (desc.Type())
+    //All the array types are indexed the same way.
+    switch ((kind == INDEX_ELEMENTS) ? PS_TABLE_ARRAY_MASK : desc.Type())
     {
+    case PS_TABLE_ARRAY_MASK:
+      insert_row_array_field( *this, *bitmapIndex, row, field);
+      break;
+
     case T_BOOL:
-      insert_row_field<DBool>( *this, fieldTree, row, field);
+      insert_row_field<DBool>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_CHAR:
-      insert_row_field<DChar>( *this, fieldTree, row, field);
+      insert_row_field<DChar>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_DATE:
-      insert_row_field<DDate>( *this, fieldTree, row, field);
+      insert_row_field<DDate>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_DATETIME:
-      insert_row_field<DDateTime>( *this, fieldTree, row, field);
+      insert_row_field<DDateTime>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_HIRESTIME:
-      insert_row_field<DHiresTime>( *this, fieldTree, row, field);
+      insert_row_field<DHiresTime>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_UINT8:
-      insert_row_field<DUInt8>( *this, fieldTree, row, field);
+      insert_row_field<DUInt8>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_UINT16:
-      insert_row_field<DUInt16>( *this, fieldTree, row, field);
+      insert_row_field<DUInt16>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_UINT32:
-      insert_row_field<DUInt32>( *this, fieldTree, row, field);
+      insert_row_field<DUInt32>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_UINT64:
-      insert_row_field<DUInt64>( *this, fieldTree, row, field);
+      insert_row_field<DUInt64>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_INT8:
-      insert_row_field<DInt8>( *this, fieldTree, row, field);
+      insert_row_field<DInt8>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_INT16:
-      insert_row_field<DInt16>( *this, fieldTree, row, field);
+      insert_row_field<DInt16>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_INT32:
-      insert_row_field<DInt32>( *this, fieldTree, row, field);
+      insert_row_field<DInt32>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_INT64:
-      insert_row_field<DInt64>( *this, fieldTree, row, field);
+      insert_row_field<DInt64>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_REAL:
-      insert_row_field<DReal>( *this, fieldTree, row, field);
+      insert_row_field<DReal>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     case T_RICHREAL:
-      insert_row_field<DRichReal>( *this, fieldTree, row, field);
+      insert_row_field<DRichReal>( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
+      break;
+
+    case T_TEXT:
+      insert_row_text_field( *this, fieldTree.get(), hashIndex.get(), bitmapIndex.get(), row, field);
       break;
 
     default:
@@ -604,16 +990,35 @@ PrototypeTable::CreateIndex(const FIELD_INDEX field,
       }
       cbFunc(cbContext);
     }
+
+    if ((kind == INDEX_BITMAP) && (bitmapIndex->Values().size() > BITMAP_INDEX_MAX_VALUES))
+    {
+      bitmapIndex->MarkForRemoval();
+
+      throw DBSException(_EXTRA(DBSException::OPER_NOT_SUPPORTED),
+                         "Field '%s' has too many distinct values for a bitmap index.",
+                         DescribeField(field).name);
+    }
   }
 
   desc.IndexNodeSizeKB(nodeSizeKB);
   desc.IndexUnitsCount(1);
+  desc.IndexKind(kind);
+
+  if (hashIndex)
+    hashIndex->Flush();
+
+  if (bitmapIndex)
+    bitmapIndex->Flush();
 
   MakeHeaderPersistent();
 
-  assert(mvIndexNodeMgrs[field] == nullptr);
+  assert( ! HasIndex(field));
 
+  fieldTree.reset();
   mvIndexNodeMgrs[field] = nodeMgr.release();
+  mvHashIndexes[field] = hashIndex.release();
+  mvBitmapIndexes[field] = bitmapIndex.release();
 }
 
 
@@ -634,7 +1039,7 @@ PrototypeTable::RemoveIndex(const FIELD_INDEX field)
 
   FieldDescriptor& desc = GetFieldDescriptorInternal(field);
 
-  if (mvIndexNodeMgrs[field] == nullptr)
+  if ( ! HasIndex(field))
     throw DBSException(_EXTRA(DBSException::FIELD_NOT_INDEXED));
 
   AcquireFieldIndex( &desc);
@@ -643,11 +1048,32 @@ PrototypeTable::RemoveIndex(const FIELD_INDEX field)
 
   desc.IndexNodeSizeKB(0);
   desc.IndexUnitsCount(0);
+  desc.IndexKind(INDEX_BTREE);
+
+  if (mvHashIndexes[field] != nullptr)
+  {
+    unique_ptr<FieldHashIndex> hashIndex(mvHashIndexes[field]);
+    hashIndex->MarkForRemoval();
+
+    mvHashIndexes[field] = nullptr;
+  }
+  else if (mvBitmapIndexes[field] != nullptr)
+  {
+    unique_ptr<FieldBitmapIndex> bitmapIndex(mvBitmapIndexes[field]);
+    bitmapIndex->MarkForRemoval();
 
-  unique_ptr<FieldIndexNodeManager> fieldMgr(mvIndexNodeMgrs[field]);
-  fieldMgr->MarkForRemoval();
+    mvBitmapIndexes[field] = nullptr;
+  }
+  else
+  {
+    unique_ptr<FieldIndexNodeManager> fieldMgr(mvIndexNodeMgrs[field]);
+    fieldMgr->MarkForRemoval();
+
+    mvIndexNodeMgrs[field] = nullptr;
 
-  mvIndexNodeMgrs[field] = nullptr;
+    if (field < mvPendingIndexKeys.size())
+      mvPendingIndexKeys[field].reset();
+  }
   ReleaseIndexField( &desc);
 
   MakeHeaderPersistent();
@@ -669,1734 +1095,4288 @@ PrototypeTable::IsIndexed(const FIELD_INDEX field) const
 
   assert(mvIndexNodeMgrs.size() == mFieldsCount);
 
-  return mvIndexNodeMgrs[field] != nullptr;
+  return HasIndex(field);
 }
 
 
-uint_t
-PrototypeTable::RowSize() const
+bool
+PrototypeTable::HasIndex(const FIELD_INDEX field) const
 {
-  return mRowSize;
+  return (mvIndexNodeMgrs[field] != nullptr)
+         || (mvHashIndexes[field] != nullptr)
+         || (mvBitmapIndexes[field] != nullptr);
 }
 
 
-FieldDescriptor&
-PrototypeTable::GetFieldDescriptorInternal(const FIELD_INDEX field) const
+//Collect the rows of an index's keys in range, in their keys order.
+template<class T, class R> static void
+index_range_rows(FieldIndexNodeManager&   nodeMgr,
+                 const T&                 min,
+                 const T&                 max,
+                 const ROW_INDEX          fromRow,
+                 const ROW_INDEX          toRow,
+                 R&                       output)
 {
-  const auto desc = _RC(FieldDescriptor*, mFieldsDescriptors.get());
+  NODE_INDEX nodeId;
+  KEY_INDEX fromKey;
+  const T_BTreeKey<T> firstKey(min, fromRow);
+  const T_BTreeKey<T> lastKey(max, toRow);
 
-  if (field >= mFieldsCount)
+  BTree indexTree(nodeMgr);
+
+  if ( ! indexTree.FindBiggerOrEqual(firstKey, &nodeId, &fromKey))
+    return;
+
+  auto currentNode = nodeMgr.RetrieveNode(nodeId);
+
+  assert(fromKey < currentNode->KeysCount());
+  while (true)
   {
-    throw DBSException(_EXTRA(DBSException::FIELD_NOT_FOUND),
-                       "Cannot get table field %u(of %u) description.",
-                       field,
-                       mFieldsCount);
-  }
+    IBTreeFieldIndexNode* node = _SC(IBTreeFieldIndexNode*, &*currentNode);
+    KEY_INDEX toKey = ~0;
 
-  return desc[field];
-}
+    bool lastNode = false;
 
+    if (node->FindBiggerOrEqual(lastKey, &toKey))
+    {
+      lastNode = true;
 
-uint64_t
-PrototypeTable::NodeRawSize() const
-{
-  return TableRmNode::RAW_NODE_SIZE;
-}
+      if (node->CompareKey(lastKey, toKey) < 0)
+        toKey++;
+    }
+    else
+      toKey = 0;
 
+    if (fromKey >= toKey)
+      node->GetRows(fromKey, toKey, fromRow, toRow, output);
 
-NODE_INDEX PrototypeTable::AllocateNode(const NODE_INDEX parent, const KEY_INDEX parentKey)
-{
-  NODE_INDEX nodeIndex = mUnallocatedHead;
+    if (lastNode || (node->Next() == NIL_NODE))
+      break;
 
-  assert((parent == NIL_NODE) || mRowModified);
+    currentNode = nodeMgr.RetrieveNode(node->Next());
 
-  if (nodeIndex != NIL_NODE)
-  {
-    auto freeNode = RetrieveNode(nodeIndex);
+    assert(currentNode->KeysCount() > 0);
 
-    mUnallocatedHead = freeNode->Next();
-    MakeHeaderPersistent();
+    fromKey = currentNode->KeysCount() - 1;
   }
-  else
-  {
-    assert(TableContainer().Size() % NodeRawSize() == 0);
-
-    nodeIndex = TableContainer().Size() / NodeRawSize();
-  }
-
-  if (parent != NIL_NODE)
-  {
-    auto parentNode = RetrieveNode(parent);
-    parentNode->SetNodeOfKey(parentKey, nodeIndex);
-
-    assert(parentNode->IsLeaf() == false);
-  }
-
-  return nodeIndex;
 }
 
 
-void
-PrototypeTable::FreeNode(const NODE_INDEX nodeId)
+//Walk an index's entries in their keys order (or the reverse one), starting
+//with the entry of the specified key or the one following it.
+template<class N> static uint_t
+index_walk_entries(FieldIndexNodeManager&                        nodeMgr,
+                   const T_BTreeKey<typename N::VALUE_TYPE>&     startKey,
+                   const bool                                    skipStart,
+                   const bool                                    reverse,
+                   const uint_t                                  count,
+                   DArray&                                       outValues,
+                   DArray&                                       outRows)
 {
-  assert(mRowModified);
-
-  auto node = RetrieveNode(nodeId);
+  NODE_INDEX nodeId;
+  KEY_INDEX keyIndex;
 
-  node->MarkAsRemoved();
-  node->Next(mUnallocatedHead);
+  BTree indexTree(nodeMgr);
 
-  mUnallocatedHead = node->NodeId();
+  //A search past the biggest key stops on the sentinel key, the reversed
+  //walk starting from there.
+  if ( ! indexTree.FindBiggerOrEqual(startKey, &nodeId, &keyIndex) && ! reverse)
+    return 0;
 
-  MakeHeaderPersistent();
-}
+  auto currentNode = nodeMgr.RetrieveNode(nodeId);
 
+  //The keys of a node are kept from the biggest down, and the next node
+  //holds bigger keys.
+  bool stepBack = reverse
+                  && (_SC(const N*, &*currentNode)->CompareKey(startKey, keyIndex) < 0);
+  bool stepOver = skipStart;
 
-NODE_INDEX
-PrototypeTable::RootNodeId()
-{
-  if (mRootNode == NIL_NODE)
+  uint_t result = 0;
+  while (result < count)
   {
-    auto rootNode = RetrieveNode(AllocateNode(NIL_NODE, 0));
+    const N* const node = _SC(const N*, &*currentNode);
+    const auto key = node->GetKey(keyIndex);
 
-    rootNode->Next(NIL_NODE);
-    rootNode->Prev(NIL_NODE);
-    rootNode->KeysCount(0);
-    rootNode->Leaf(true);
-    rootNode->InsertKey(rootNode->SentinelKey());
+    if (stepBack || (stepOver && (startKey.CompareWith(key) == 0)))
+      stepBack = false;
 
-    RootNodeId(rootNode->NodeId());
-  }
+    else if (key.mValuePart.IsNull())
+    {
+      //The null values come first, so the reversed walk is over.
+      if (reverse)
+        break;
+    }
+    else if (node->CompareKey(node->SentinelKey(), keyIndex) != 0)
+    {
+      outValues.Add(key.mValuePart);
+      outRows.Add(DROW_INDEX(key.mRowPart));
+      ++result;
+    }
+    stepOver = false;
 
-  return mRootNode;
-}
+    if (reverse)
+    {
+      if (keyIndex + 1 < node->KeysCount())
+        ++keyIndex;
 
+      else if (node->Prev() == NIL_NODE)
+        break;
 
-void
-PrototypeTable::RootNodeId(const NODE_INDEX node)
-{
-  mRootNode = node;
+      else
+      {
+        currentNode = nodeMgr.RetrieveNode(node->Prev());
+        keyIndex = 0;
+      }
+    }
+    else
+    {
+      if (keyIndex > 0)
+        --keyIndex;
 
-  MakeHeaderPersistent();
-}
+      else if (node->Next() == NIL_NODE)
+        break;
 
+      else
+      {
+        currentNode = nodeMgr.RetrieveNode(node->Next());
+        keyIndex = currentNode->KeysCount() - 1;
+      }
+    }
+  }
 
-uint_t
-PrototypeTable::MaxCachedNodes()
-{
-  return 128;
+  return result;
 }
 
 
-shared_ptr<IBTreeNode>
-PrototypeTable::LoadNode(const NODE_INDEX nodeId)
+template<class N> static uint_t
+index_fetch_entries(FieldIndexNodeManager&  nodeMgr,
+                    const DArray&           fromValue,
+                    const ROW_INDEX         afterRow,
+                    const bool              reverse,
+                    const uint_t            count,
+                    DArray&                 outValues,
+                    DArray&                 outRows)
 {
-  shared_ptr<IBTreeNode> node(shared_make(TableRmNode, *this, nodeId));
-
-  assert(TableContainer().Size() % NodeRawSize() == 0);
+  typedef typename N::VALUE_TYPE T;
 
-  if (TableContainer().Size() > nodeId * NodeRawSize())
-    TableContainer().Read(node->NodeId() * NodeRawSize(), NodeRawSize(), node->RawData());
+  T value = reverse ? T::Max() : T::Min();
+  ROW_INDEX row = reverse ? INVALID_ROW_INDEX : 0;
 
-  else
+  if ( ! fromValue.IsNull())
   {
-    MarkRowModification(nullptr);
-
-    //Reserve space for this node
-    assert(TableContainer().Size() == (nodeId * NodeRawSize()));
-
-    TableContainer().Write(TableContainer().Size(), NodeRawSize(), node->RawData());
+    fromValue.Get(fromValue.Count() - 1, value);
+    if (afterRow != INVALID_ROW_INDEX)
+      row = afterRow;
   }
 
-  node->MarkClean();
-  assert(node->NodeId() == nodeId);
-
-  return node;
+  return index_walk_entries<N>(nodeMgr,
+                               T_BTreeKey<T>(value, row),
+                               afterRow != INVALID_ROW_INDEX,
+                               reverse,
+                               count,
+                               outValues,
+                               outRows);
 }
 
 
-void
-PrototypeTable::SaveNode(IBTreeNode* const node)
+static void
+update_composite_key(FieldIndexNodeManager&   nodeMgr,
+                     const ROW_INDEX          row,
+                     const CompositeKey&      oldKey,
+                     const CompositeKey&      newKey)
 {
-  if (node->IsDirty() == false)
+  if (oldKey == newKey)
     return;
 
-  assert(mRowModified);
-
-  TableContainer().Write(node->NodeId() * NodeRawSize(), NodeRawSize(), node->RawData());
-  node->MarkClean();
-}
-
-
-void
-PrototypeTable::StoreItems(uint64_t firstItem, uint_t itemsCount, const uint8_t* const from)
-{
-  assert(mRowModified);
+  NODE_INDEX dummyNode;
+  KEY_INDEX dummyKey;
 
-  if (itemsCount + firstItem > mRowsCount)
-    itemsCount = mRowsCount - firstItem;
+  BTree indexTree(nodeMgr);
 
-  RowsContainer().Write(firstItem * mRowSize, itemsCount * mRowSize, from);
+  indexTree.RemoveKey(CompositeBTreeKey(oldKey, row));
+  indexTree.InsertKey(CompositeBTreeKey(newKey, row), &dummyNode, &dummyKey);
 }
 
 
-void
-PrototypeTable::RetrieveItems(uint64_t firstItem, uint_t itemsCount, uint8_t* const to)
+size_t
+PrototypeTable::FindCompositeIndex(const FIELD_INDEX* const   fields,
+                                   const FIELD_INDEX          fieldsCount) const
 {
-  if (itemsCount + firstItem > mRowsCount)
-    itemsCount = mRowsCount - firstItem;
+  for (size_t i = 0; i < mvCompositeIndexes.size(); ++i)
+  {
+    const vector<FIELD_INDEX>& indexFields = mvCompositeIndexes[i].mFields;
 
-  RowsContainer().Read(firstItem * mRowSize, itemsCount * mRowSize, to);
+    if ((indexFields.size() == fieldsCount)
+        && equal(indexFields.begin(), indexFields.end(), fields))
+    {
+      return i;
+    }
+  }
+
+  return mvCompositeIndexes.size();
 }
 
 
 void
-PrototypeTable::CheckRowToDelete(const ROW_INDEX row)
+PrototypeTable::CreateCompositeIndex(const FIELD_INDEX* const            fields,
+                                     const FIELD_INDEX                   fieldsCount,
+                                     CREATE_INDEX_CALLBACK_FUNC* const   cbFunc,
+                                     CreateIndexCallbackContext* const   cbContext)
 {
-  assert(mRowModified);
-
-  bool allFieldsNull = true;
+  if ((fields == nullptr)
+      || (fieldsCount < 2)
+      || ((cbFunc == nullptr) && (cbContext != nullptr)))
+  {
+    throw DBSException(_EXTRA(DBSException::INVALID_PARAMETERS));
+  }
 
-  StoredItem cachedItem = mRowCache.RetriveItem(row);
-  uint8_t* const rowData = cachedItem.GetDataForUpdate();
+  LockGuard<Lock> syncHolder(mRowsSync);
 
-  for (FIELD_INDEX index = 0; index < mFieldsCount; index += 8)
+  uint_t keySize = 0;
+  for (FIELD_INDEX f = 0; f < fieldsCount; ++f)
   {
-    const FieldDescriptor& fieldDesc = GetFieldDescriptorInternal(index);
-    const uint8_t bitsSet = ~0;
+    const DBSFieldDescriptor fd = DescribeField(fields[f]);
 
-    if (rowData[fieldDesc.NullBitIndex() / 8] != bitsSet)
+    if (find(fields, fields + f, fields[f]) != fields + f)
     {
-      allFieldsNull = false;
-      break;
+      throw DBSException(_EXTRA(DBSException::INVALID_PARAMETERS),
+                         "Field '%s' is listed more than once.",
+                         fd.name);
     }
+    else if (fd.isArray || (fd.type == T_TEXT))
+    {
+      throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID),
+                         "The text and array fields cannot be part of composite indexes.");
+    }
+
+    keySize += sort_key_size(fd.type);
   }
 
-  if (allFieldsNull)
+  if (keySize > CompositeKey::SIZE)
   {
-    NODE_INDEX dummyNode;
-    KEY_INDEX dummyKey;
-    BTree removedNodes( *this);
-    TableRmKey key(row);
-
-    removedNodes.InsertKey(key, &dummyNode, &dummyKey);
+    throw DBSException(_EXTRA(DBSException::OPER_NOT_SUPPORTED),
+                       "The values of these fields do not fit in a composite index key.");
   }
-}
+  else if (FindCompositeIndex(fields, fieldsCount) < mvCompositeIndexes.size())
+    throw DBSException(_EXTRA(DBSException::FIELD_INDEXED));
 
+  CompositeIndex index;
+  index.mFields.assign(fields, fields + fieldsCount);
 
-void
-PrototypeTable::CheckRowToReuse(const ROW_INDEX row)
-{
-  assert(mRowModified);
+  unique_ptr<IDataContainer> indexContainer(CreateCompositeIndexContainer(index.mFields));
+  unique_ptr<FieldIndexNodeManager> nodeMgr(new FieldIndexNodeManager(indexContainer,
+                                                                      16 * 1024,
+                                                                      0x400000, //4MB
+                                                                      PS_COMPOSITE_KEY_TYPE,
+                                                                      true));
+  try
+  {
+    BTree indexTree( *nodeMgr);
 
-  bool allFieldsNull = true;
+    for (ROW_INDEX row = 0; row < mRowsCount; ++row)
+    {
+      NODE_INDEX dummyNode;
+      KEY_INDEX dummyKey;
 
-  StoredItem cachedItem = mRowCache.RetriveItem(row);
-  uint8_t* const rowData = cachedItem.GetDataForUpdate();
+      StoredItem cachedItem = mRowCache.RetriveItem(row);
+      const CompositeKey key = composite_row_key(&GetFieldDescriptorInternal(0),
+                                                 index.mFields,
+                                                 cachedItem.GetDataForRead());
 
-  for (FIELD_INDEX index = 0; index < mFieldsCount; index += 8)
-  {
-    const FieldDescriptor& fieldDesc = GetFieldDescriptorInternal(index);
-    const uint8_t bitsSet = ~0;
+      indexTree.InsertKey(CompositeBTreeKey(key, row), &dummyNode, &dummyKey);
 
-    if (rowData[fieldDesc.NullBitIndex() / 8] != bitsSet)
-    {
-      allFieldsNull = false;
-      break;
+      if (cbFunc != nullptr)
+      {
+        if (cbContext != nullptr)
+        {
+          cbContext->mRowsCount = mRowsCount;
+          cbContext->mRowIndex = row;
+        }
+        cbFunc(cbContext);
+      }
     }
   }
-
-  if (allFieldsNull)
+  catch (...)
   {
-    BTree removedNodes( *this);
-    TableRmKey key(row);
-
-    removedNodes.RemoveKey(key);
+    nodeMgr->MarkForRemoval();
+    throw;
   }
+
+  index.mNodeMgr = nodeMgr.release();
+  mvCompositeIndexes.push_back(index);
+
+  MakeCompositeIndexesPersistent();
 }
 
 
 void
-PrototypeTable::AcquireFieldIndex(FieldDescriptor* const field)
+PrototypeTable::RemoveCompositeIndex(const FIELD_INDEX* const   fields,
+                                     const FIELD_INDEX          fieldsCount)
 {
-  while (true)
-  {
-    LockGuard<Lock> syncHolder(mIndexesSync);
+  LockGuard<Lock> syncHolder(mRowsSync);
 
-    if ( !field->IsAcquired())
-    {
-      field->Acquire();
-      break;
-    }
+  const size_t i = FindCompositeIndex(fields, fieldsCount);
+  if (i == mvCompositeIndexes.size())
+    throw DBSException(_EXTRA(DBSException::FIELD_NOT_INDEXED));
 
-    syncHolder.unlock();
-    wh_yield();
-  }
+  unique_ptr<FieldIndexNodeManager> nodeMgr(mvCompositeIndexes[i].mNodeMgr);
+  nodeMgr->MarkForRemoval();
+
+  mvCompositeIndexes.erase(mvCompositeIndexes.begin() + i);
+
+  MakeCompositeIndexesPersistent();
 }
 
 
-void
-PrototypeTable::ReleaseIndexField(FieldDescriptor* const field)
+vector<vector<FIELD_INDEX>>
+PrototypeTable::CompositeIndexes()
 {
-  //Do not try to grab the lock when you release the field.
-  assert(field->IsAcquired());
+  LockGuard<Lock> syncHolder(mRowsSync);
 
-  field->Release();
+  vector<vector<FIELD_INDEX>> result;
+  for (const auto& index : mvCompositeIndexes)
+    result.push_back(index.mFields);
+
+  return result;
 }
 
 
-template <class T> void
-PrototypeTable::StoreEntry(const ROW_INDEX row,
-                           const FIELD_INDEX field,
-                           const bool threadSafe,
-                           const T& value)
+RowsSet
+PrototypeTable::MatchCompositeRows(const FIELD_INDEX* const   fields,
+                                   const FIELD_INDEX          fieldsCount,
+                                   const CompositeKey&        min,
+                                   const CompositeKey&        max,
+                                   const ROW_INDEX            fromRow,
+                                   const ROW_INDEX            toRow)
 {
-  T currentValue;
-  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
-  if (row == mRowsCount)
-    AddRow(true);
+  LockGuard<Lock> syncHolder(mRowsSync);
 
-  else
-    RetrieveEntry(row, field, false, currentValue);
+  const size_t i = FindCompositeIndex(fields, fieldsCount);
+  if (i == mvCompositeIndexes.size())
+    throw DBSException(_EXTRA(DBSException::FIELD_NOT_INDEXED));
 
-  if (currentValue == value)
-    return; //Nothing to change
+  RowsSet result;
+  if (mRowsCount == 0)
+    return result;
 
-  MarkRowModification(threadSafe ? &syncHolder : nullptr);
+  index_range_rows( *mvCompositeIndexes[i].mNodeMgr,
+                   min,
+                   max,
+                   fromRow,
+                   MIN(toRow, mRowsCount - 1),
+                   result);
+  return result;
+}
 
-  const uint8_t bitsSet = ~0;
-  FieldDescriptor& desc = GetFieldDescriptorInternal(field);
-  const uint_t byteOff = desc.NullBitIndex() / 8;
-  const uint8_t bitOff = desc.NullBitIndex() % 8;
 
-  StoredItem cachedItem = mRowCache.RetriveItem(row);
-  uint8_t * const rowData = cachedItem.GetDataForUpdate();
+uint_t
+PrototypeTable::FetchIndexEntries(const FIELD_INDEX   field,
+                                  const DArray&       fromValue,
+                                  const ROW_INDEX     afterRow,
+                                  const bool          reverse,
+                                  const uint_t        count,
+                                  DArray&             outValues,
+                                  DArray&             outRows)
+{
+  outValues = DArray();
+  outRows = DArray();
 
-  if (value.IsNull())
+  FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+  const uint_t fieldType = desc.Type() & PS_TABLE_FIELD_TYPE_MASK;
+
+  if ((desc.Type() & PS_TABLE_ARRAY_MASK)
+      || (fieldType == T_TEXT)
+      || ( ! fromValue.IsNull() && (fromValue.Type() != fieldType)))
   {
-    assert((rowData[byteOff] & (1 << bitOff)) == 0);
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+  }
 
-    rowData[byteOff] |= (1 << bitOff);
+  FieldIndexNodeManager* const nodeMgr = mvIndexNodeMgrs[field];
+  if (nodeMgr == nullptr)
+    throw DBSException(_EXTRA(DBSException::FIELD_NOT_INDEXED));
 
-    if (rowData[byteOff] == bitsSet)
-      CheckRowToDelete(row);
-  }
-  else
-  {
-    if (rowData[byteOff] == bitsSet)
-      CheckRowToReuse(row);
+  if ((mRowsCount == 0) || (count == 0))
+    return 0;
 
-    rowData[byteOff] &= ~(1 << bitOff);
+  uint_t result = 0;
 
-    Serializer::Store(rowData + desc.RowDataOff(), value);
-  }
+  AcquireUpdatedFieldIndex(field);
 
-  //Update the field index if it exists
-  if (mvIndexNodeMgrs[field] != nullptr)
+  try
   {
-    NODE_INDEX dummyNode;
-    KEY_INDEX dummyKey;
-
-    if (threadSafe)
+    switch (fieldType)
     {
-      AcquireFieldIndex( &desc);
-      syncHolder.unlock();
-    }
+    case T_BOOL:
+      result = index_fetch_entries<BoolBTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                  count, outValues, outRows);
+      break;
 
-    try
+    case T_CHAR:
+      result = index_fetch_entries<CharBTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                  count, outValues, outRows);
+      break;
+
+    case T_DATE:
+      result = index_fetch_entries<DateBTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                  count, outValues, outRows);
+      break;
+
+    case T_DATETIME:
+      result = index_fetch_entries<DateTimeBTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                      count, outValues, outRows);
+      break;
+
+    case T_HIRESTIME:
+      result = index_fetch_entries<HiresTimeBTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                       count, outValues, outRows);
+      break;
+
+    case T_UINT8:
+      result = index_fetch_entries<UInt8BTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                   count, outValues, outRows);
+      break;
+
+    case T_UINT16:
+      result = index_fetch_entries<UInt16BTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                    count, outValues, outRows);
+      break;
+
+    case T_UINT32:
+      result = index_fetch_entries<UInt32BTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                    count, outValues, outRows);
+      break;
+
+    case T_UINT64:
+      result = index_fetch_entries<UInt64BTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                    count, outValues, outRows);
+      break;
+
+    case T_INT8:
+      result = index_fetch_entries<Int8BTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                  count, outValues, outRows);
+      break;
+
+    case T_INT16:
+      result = index_fetch_entries<Int16BTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                   count, outValues, outRows);
+      break;
+
+    case T_INT32:
+      result = index_fetch_entries<Int32BTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                   count, outValues, outRows);
+      break;
+
+    case T_INT64:
+      result = index_fetch_entries<Int64BTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                   count, outValues, outRows);
+      break;
+
+    case T_REAL:
+      result = index_fetch_entries<RealBTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                  count, outValues, outRows);
+      break;
+
+    case T_RICHREAL:
+      result = index_fetch_entries<RichRealBTreeNode>( *nodeMgr, fromValue, afterRow, reverse,
+                                                      count, outValues, outRows);
+      break;
+
+    default:
+      throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+    }
+  }
+  catch (...)
+  {
+    ReleaseIndexField( &desc);
+
+    throw;
+  }
+
+  ReleaseIndexField( &desc);
+
+  return result;
+}
+
+
+void
+PrototypeTable::CompositeRowKeys(const FIELD_INDEX        field,
+                                 const uint8_t* const     rowData,
+                                 vector<CompositeKey>&    outKeys) const
+{
+  const FieldDescriptor* const fds = _RC(const FieldDescriptor*, mFieldsDescriptors.get());
+
+  for (const auto& index : mvCompositeIndexes)
+  {
+    if (find(index.mFields.begin(), index.mFields.end(), field) != index.mFields.end())
+      outKeys.push_back(composite_row_key(fds, index.mFields, rowData));
+  }
+}
+
+
+void
+PrototypeTable::UpdateCompositeIndexes(const FIELD_INDEX             field,
+                                       const ROW_INDEX               row,
+                                       const vector<CompositeKey>&   oldKeys,
+                                       const uint8_t* const          newRowData)
+{
+  const FieldDescriptor* const fds = _RC(const FieldDescriptor*, mFieldsDescriptors.get());
+
+  //The old keys are in the same order, as got by CompositeRowKeys().
+  size_t k = 0;
+  for (const auto& index : mvCompositeIndexes)
+  {
+    if (find(index.mFields.begin(), index.mFields.end(), field) == index.mFields.end())
+      continue;
+
+    update_composite_key( *index.mNodeMgr,
+                         row,
+                         oldKeys[k++],
+                         composite_row_key(fds, index.mFields, newRowData));
+  }
+}
+
+
+uint_t
+PrototypeTable::RowSize() const
+{
+  return mRowSize;
+}
+
+
+FieldDescriptor&
+PrototypeTable::GetFieldDescriptorInternal(const FIELD_INDEX field) const
+{
+  const auto desc = _RC(FieldDescriptor*, mFieldsDescriptors.get());
+
+  if (field >= mFieldsCount)
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_NOT_FOUND),
+                       "Cannot get table field %u(of %u) description.",
+                       field,
+                       mFieldsCount);
+  }
+
+  return desc[field];
+}
+
+
+uint64_t
+PrototypeTable::NodeRawSize() const
+{
+  return TableRmNode::RAW_NODE_SIZE;
+}
+
+
+NODE_INDEX PrototypeTable::AllocateNode(const NODE_INDEX parent, const KEY_INDEX parentKey)
+{
+  NODE_INDEX nodeIndex = mUnallocatedHead;
+
+  assert((parent == NIL_NODE) || mRowModified);
+
+  if (nodeIndex != NIL_NODE)
+  {
+    auto freeNode = RetrieveNode(nodeIndex);
+
+    mUnallocatedHead = freeNode->Next();
+    MakeHeaderPersistent();
+  }
+  else
+  {
+    assert(TableContainer().Size() % NodeRawSize() == 0);
+
+    nodeIndex = TableContainer().Size() / NodeRawSize();
+  }
+
+  if (parent != NIL_NODE)
+  {
+    auto parentNode = RetrieveNode(parent);
+    parentNode->SetNodeOfKey(parentKey, nodeIndex);
+
+    assert(parentNode->IsLeaf() == false);
+  }
+
+  return nodeIndex;
+}
+
+
+void
+PrototypeTable::FreeNode(const NODE_INDEX nodeId)
+{
+  assert(mRowModified);
+
+  auto node = RetrieveNode(nodeId);
+
+  node->MarkAsRemoved();
+  node->Next(mUnallocatedHead);
+
+  mUnallocatedHead = node->NodeId();
+
+  MakeHeaderPersistent();
+}
+
+
+NODE_INDEX
+PrototypeTable::RootNodeId()
+{
+  if (mRootNode == NIL_NODE)
+  {
+    auto rootNode = RetrieveNode(AllocateNode(NIL_NODE, 0));
+
+    rootNode->Next(NIL_NODE);
+    rootNode->Prev(NIL_NODE);
+    rootNode->KeysCount(0);
+    rootNode->Leaf(true);
+    rootNode->InsertKey(rootNode->SentinelKey());
+
+    RootNodeId(rootNode->NodeId());
+  }
+
+  return mRootNode;
+}
+
+
+void
+PrototypeTable::RootNodeId(const NODE_INDEX node)
+{
+  mRootNode = node;
+
+  MakeHeaderPersistent();
+}
+
+
+uint_t
+PrototypeTable::MaxCachedNodes()
+{
+  return 128;
+}
+
+
+shared_ptr<IBTreeNode>
+PrototypeTable::LoadNode(const NODE_INDEX nodeId)
+{
+  shared_ptr<IBTreeNode> node(shared_make(TableRmNode, *this, nodeId));
+
+  assert(TableContainer().Size() % NodeRawSize() == 0);
+
+  if (TableContainer().Size() > nodeId * NodeRawSize())
+    TableContainer().Read(node->NodeId() * NodeRawSize(), NodeRawSize(), node->RawData());
+
+  else
+  {
+    MarkRowModification(nullptr);
+
+    //Reserve space for this node
+    assert(TableContainer().Size() == (nodeId * NodeRawSize()));
+
+    TableContainer().Write(TableContainer().Size(), NodeRawSize(), node->RawData());
+  }
+
+  node->MarkClean();
+  assert(node->NodeId() == nodeId);
+
+  return node;
+}
+
+
+void
+PrototypeTable::SaveNode(IBTreeNode* const node)
+{
+  if (node->IsDirty() == false)
+    return;
+
+  assert(mRowModified);
+
+  TableContainer().Write(node->NodeId() * NodeRawSize(), NodeRawSize(), node->RawData());
+  node->MarkClean();
+}
+
+
+void
+PrototypeTable::StoreItems(uint64_t firstItem, uint_t itemsCount, const uint8_t* const from)
+{
+  assert(mRowModified);
+
+  if (itemsCount + firstItem > mRowsCount)
+    itemsCount = mRowsCount - firstItem;
+
+  RowsContainer().Write(firstItem * mRowSize, itemsCount * mRowSize, from);
+}
+
+
+void
+PrototypeTable::RetrieveItems(uint64_t firstItem, uint_t itemsCount, uint8_t* const to)
+{
+  if (itemsCount + firstItem > mRowsCount)
+    itemsCount = mRowsCount - firstItem;
+
+  RowsContainer().Read(firstItem * mRowSize, itemsCount * mRowSize, to);
+
+  if ((mLegacyRows.mRowSize > 0)
+      && (firstItem < mLegacyRows.mRowsCount)
+      && (mConvertedRows < firstItem + itemsCount))
+  {
+    ConvertLegacyRows(firstItem, itemsCount, to);
+  }
+}
+
+
+bool
+PrototypeTable::ConvertLegacyRows(const ROW_INDEX   firstRow,
+                                  const uint_t      rowsCount,
+                                  uint8_t* const    to)
+{
+  const ROW_INDEX lastRow = MIN(firstRow + rowsCount, mLegacyRows.mRowsCount);
+
+  ROW_INDEX from = MAX(firstRow, mConvertedRows);
+  ROW_INDEX end = lastRow;
+
+  //Only the rows not written since the table was altered need the legacy ones.
+  while ((from < lastRow) && (to[(from - firstRow) * mRowSize + mLegacyRows.mRowSize] != 0))
+    ++from;
+
+  while ((from < end) && (to[(end - 1 - firstRow) * mRowSize + mLegacyRows.mRowSize] != 0))
+    --end;
+
+  if (from >= end)
+    return false;
+
+  const uint_t legacyRowSize = mLegacyRows.mRowSize;
+  unique_ptr<uint8_t[]> legacyRows(unique_array_make(uint8_t, (end - from) * legacyRowSize));
+
+  LegacyRowsContainer().Read(from * legacyRowSize, (end - from) * legacyRowSize, legacyRows.get());
+
+  for (ROW_INDEX row = from; row < end; ++row)
+  {
+    uint8_t* const rowData = to + (row - firstRow) * mRowSize;
+
+    if (rowData[legacyRowSize] != 0)
+      continue;
+
+    convert_legacy_row(mLegacyRows,
+                       &GetFieldDescriptorInternal(0),
+                       legacyRows.get() + (row - from) * legacyRowSize,
+                       mRowSize,
+                       rowData);
+  }
+
+  return true;
+}
+
+
+void
+PrototypeTable::CheckRowToDelete(const ROW_INDEX row)
+{
+  assert(mRowModified);
+
+  StoredItem cachedItem = mRowCache.RetriveItem(row);
+
+  if (IsRowNull(cachedItem.GetDataForRead()))
+  {
+    NODE_INDEX dummyNode;
+    KEY_INDEX dummyKey;
+    BTree removedNodes( *this);
+    TableRmKey key(row);
+
+    removedNodes.InsertKey(key, &dummyNode, &dummyKey);
+  }
+}
+
+
+void
+PrototypeTable::CheckRowToReuse(const ROW_INDEX row)
+{
+  assert(mRowModified);
+
+  StoredItem cachedItem = mRowCache.RetriveItem(row);
+
+  if (IsRowNull(cachedItem.GetDataForRead()))
+  {
+    BTree removedNodes( *this);
+    TableRmKey key(row);
+
+    removedNodes.RemoveKey(key);
+  }
+}
+
+
+void
+PrototypeTable::AcquireFieldIndex(FieldDescriptor* const field)
+{
+  while ( ! TryAcquireFieldIndex(field))
+    wh_yield();
+}
+
+
+bool
+PrototypeTable::TryAcquireFieldIndex(FieldDescriptor* const field)
+{
+  LockGuard<Lock> syncHolder(mIndexesSync);
+
+  if (field->IsAcquired())
+    return false;
+
+  field->Acquire();
+  return true;
+}
+
+
+void
+PrototypeTable::ReleaseIndexField(FieldDescriptor* const field)
+{
+  //Do not try to grab the lock when you release the field.
+  assert(field->IsAcquired());
+
+  field->Release();
+}
+
+
+template<class T>
+class FieldPendingKeys : public PendingIndexKeys
+{
+public:
+  //Only the value a row has in the index, before its first change, is kept.
+  void Add(const ROW_INDEX row, const T& indexedValue)
+  {
+    mIndexedValues.insert(make_pair(row, indexedValue));
+  }
+
+  virtual size_t Count() const override
+  {
+    return mIndexedValues.size();
+  }
+
+  virtual void Collect(PrototypeTable& table, const FIELD_INDEX field) override
+  {
+    mOldKeys.clear();
+    mNewKeys.clear();
+
+    for (const auto& entry : mIndexedValues)
+    {
+      T value;
+      table.RetrieveEntry(entry.first, field, false, value);
+
+      //The row got back its indexed value.
+      if (value == entry.second)
+        continue;
+
+      mOldKeys.push_back(make_tuple(entry.second, entry.first));
+      mNewKeys.push_back(make_tuple(value, entry.first));
+    }
+
+    //In order, the keys are updated leaf after leaf.
+    sort(mOldKeys.begin(), mOldKeys.end());
+    sort(mNewKeys.begin(), mNewKeys.end());
+  }
+
+  virtual void Apply(FieldIndexNodeManager& nodeMgr) override
+  {
+    NODE_INDEX dummyNode;
+    KEY_INDEX dummyKey;
+    BTree indexTree(nodeMgr);
+
+    size_t removedKeys = 0, insertedKeys = 0;
+    try
+    {
+      for (; removedKeys < mOldKeys.size(); ++removedKeys)
+      {
+        indexTree.RemoveKey(T_BTreeKey<T>(get<0>(mOldKeys[removedKeys]),
+                                          get<1>(mOldKeys[removedKeys])));
+      }
+
+      for (; insertedKeys < mNewKeys.size(); ++insertedKeys)
+      {
+        indexTree.InsertKey(T_BTreeKey<T>(get<0>(mNewKeys[insertedKeys]),
+                                          get<1>(mNewKeys[insertedKeys])),
+                            &dummyNode,
+                            &dummyKey);
+      }
+    }
+    catch (...)
+    {
+      //The index has to agree with the changes still kept.
+      while (insertedKeys > 0)
+      {
+        --insertedKeys;
+        indexTree.RemoveKey(T_BTreeKey<T>(get<0>(mNewKeys[insertedKeys]),
+                                          get<1>(mNewKeys[insertedKeys])));
+      }
+
+      while (removedKeys > 0)
+      {
+        --removedKeys;
+        indexTree.InsertKey(T_BTreeKey<T>(get<0>(mOldKeys[removedKeys]),
+                                          get<1>(mOldKeys[removedKeys])),
+                            &dummyNode,
+                            &dummyKey);
+      }
+
+      throw;
+    }
+
+    mIndexedValues.clear();
+    mOldKeys.clear();
+    mNewKeys.clear();
+  }
+
+  virtual void Merge(PendingIndexKeys& later) override
+  {
+    //Ours are the values still in the index, so they are not replaced.
+    for (const auto& entry : _SC(FieldPendingKeys<T>&, later).mIndexedValues)
+      mIndexedValues.insert(entry);
+  }
+
+private:
+  unordered_map<ROW_INDEX, T>    mIndexedValues;
+  vector<tuple<T, ROW_INDEX>>    mOldKeys;
+  vector<tuple<T, ROW_INDEX>>    mNewKeys;
+};
+
+
+void
+PrototypeTable::ApplyPendingIndexKeys(const FIELD_INDEX field, const bool acquireField)
+{
+  if ((field >= mvPendingIndexKeys.size()) || (mvPendingIndexKeys[field] == nullptr))
+    return;
+
+  if (mvIndexNodeMgrs[field] == nullptr)
+  {
+    mvPendingIndexKeys[field].reset();
+    return;
+  }
+
+  FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+
+  if (acquireField)
+    AcquireFieldIndex( &desc);
+
+  try
+  {
+    mvPendingIndexKeys[field]->Collect( *this, field);
+    mvPendingIndexKeys[field]->Apply( *mvIndexNodeMgrs[field]);
+  }
+  catch (...)
+  {
+    if (acquireField)
+      ReleaseIndexField( &desc);
+
+    throw;
+  }
+
+  if (acquireField)
+    ReleaseIndexField( &desc);
+
+  mvPendingIndexKeys[field].reset();
+}
+
+
+void
+PrototypeTable::AcquireUpdatedFieldIndex(const FIELD_INDEX field)
+{
+  FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+  unique_ptr<PendingIndexKeys> pendingKeys;
+
+  //Do not wait for the field while holding the rows, as it might be in use for
+  //a long index walk. The rows are needed only to get the changes to apply.
+  while (true)
+  {
+    LockGuard<Lock> syncHolder(mRowsSync);
+
+    if (TryAcquireFieldIndex( &desc))
+    {
+      if ((field < mvPendingIndexKeys.size()) && (mvPendingIndexKeys[field] != nullptr))
+      {
+        try
+        {
+          mvPendingIndexKeys[field]->Collect( *this, field);
+        }
+        catch (...)
+        {
+          ReleaseIndexField( &desc);
+          throw;
+        }
+
+        pendingKeys = move(mvPendingIndexKeys[field]);
+      }
+      break;
+    }
+
+    syncHolder.unlock();
+    wh_yield();
+  }
+
+  if (pendingKeys == nullptr)
+    return;
+
+  try
+  {
+    pendingKeys->Apply( *mvIndexNodeMgrs[field]);
+  }
+  catch (...)
+  {
+    LockGuard<Lock> syncHolder(mRowsSync);
+
+    if (mvPendingIndexKeys[field] != nullptr)
+      pendingKeys->Merge( *mvPendingIndexKeys[field]);
+
+    mvPendingIndexKeys[field] = move(pendingKeys);
+    ReleaseIndexField( &desc);
+
+    throw;
+  }
+}
+
+
+void
+PrototypeTable::DeferIndexesUpdates(const bool defer)
+{
+  LockGuard<Lock> syncHolder(mRowsSync);
+
+  mDeferIndexesUpdates = defer;
+  if (defer)
+    return;
+
+  for (FIELD_INDEX field = 0; field < mvPendingIndexKeys.size(); ++field)
+    ApplyPendingIndexKeys(field, true);
+}
+
+
+template <class T> uint64_t
+PrototypeTable::StoreEntry(const ROW_INDEX row,
+                           const FIELD_INDEX field,
+                           const bool threadSafe,
+                           const T& value)
+{
+  T currentValue;
+  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
+  if (row == mRowsCount)
+    AddRow(true);
+
+  else
+    RetrieveEntry(row, field, false, currentValue);
+
+  if (currentValue == value)
+    return 0; //Nothing to change
+
+  MarkRowModification(threadSafe ? &syncHolder : nullptr);
+
+  const uint8_t bitsSet = ~0;
+  FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+  const uint_t byteOff = desc.NullBitIndex() / 8;
+  const uint8_t bitOff = desc.NullBitIndex() % 8;
+
+  StoredItem cachedItem = mRowCache.RetriveItem(row);
+  uint8_t * const rowData = cachedItem.GetDataForUpdate();
+
+  //The composite indexes keys hold other fields values too, so they are got
+  //from the whole row.
+  vector<CompositeKey> compositeKeys;
+  CompositeRowKeys(field, rowData, compositeKeys);
+
+  if (value.IsNull())
+  {
+    assert((rowData[byteOff] & (1 << bitOff)) == 0);
+
+    rowData[byteOff] |= (1 << bitOff);
+
+    if (rowData[byteOff] == bitsSet)
+      CheckRowToDelete(row);
+  }
+  else
+  {
+    if (rowData[byteOff] == bitsSet)
+      CheckRowToReuse(row);
+
+    rowData[byteOff] &= ~(1 << bitOff);
+
+    Serializer::Store(rowData + desc.RowDataOff(), value);
+  }
+
+  UpdateCompositeIndexes(field, row, compositeKeys, rowData);
+
+  uint64_t lsn = 0;
+  RedoLog* const log = TableRedoLog();
+  if (log != nullptr)
+    lsn = log_field_value( *log, TableName(), row, field, desc.Type(), value);
+
+  //Update the field index if it exists
+  if ((mvIndexNodeMgrs[field] != nullptr) && mDeferIndexesUpdates)
+  {
+    if (mvPendingIndexKeys.size() < mFieldsCount)
+      mvPendingIndexKeys.resize(mFieldsCount);
+
+    if (mvPendingIndexKeys[field] == nullptr)
+      mvPendingIndexKeys[field].reset(new FieldPendingKeys<T>());
+
+    FieldPendingKeys<T>& pendingKeys = *_SC(FieldPendingKeys<T>*, mvPendingIndexKeys[field].get());
+
+    pendingKeys.Add(row, currentValue);
+    if (pendingKeys.Count() >= MAX_PENDING_INDEX_KEYS)
+      ApplyPendingIndexKeys(field, threadSafe);
+  }
+  else if (mvIndexNodeMgrs[field] != nullptr)
+  {
+    NODE_INDEX dummyNode;
+    KEY_INDEX dummyKey;
+
+    if (threadSafe)
+    {
+      AcquireFieldIndex( &desc);
+      syncHolder.unlock();
+    }
+
+    try
+    {
+      BTree fieldIndexTree( *mvIndexNodeMgrs[field]);
+
+      fieldIndexTree.RemoveKey(T_BTreeKey<T>(currentValue, row));
+      fieldIndexTree.InsertKey(T_BTreeKey<T>(value, row), &dummyNode, &dummyKey);
+    }
+    catch (...)
+    {
+      ReleaseIndexField( &desc);
+      throw;
+    }
+
+    if (threadSafe)
+    {
+      ReleaseIndexField( &desc);
+      syncHolder.lock();
+    }
+  }
+  else if (mvBitmapIndexes[field] != nullptr)
+  {
+    //The rows sets are in memory, so the rows lock is kept.
+    if (threadSafe)
+      AcquireFieldIndex( &desc);
+
+    try
+    {
+      uint8_t data[Serializer::MAX_VALUE_RAW_SIZE];
+
+      mvBitmapIndexes[field]->Remove(data, value_raw(currentValue, data), row);
+      mvBitmapIndexes[field]->Add(data, value_raw(value, data), row);
+    }
+    catch (...)
+    {
+      if (threadSafe)
+        ReleaseIndexField( &desc);
+
+      throw;
+    }
+
+    if (threadSafe)
+      ReleaseIndexField( &desc);
+  }
+  else if (mvHashIndexes[field] != nullptr)
+  {
+    FieldHashIndex& hashIndex = *mvHashIndexes[field];
+
+    if (threadSafe)
+    {
+      AcquireFieldIndex( &desc);
+      syncHolder.unlock();
+    }
+
+    try
+    {
+      //The null values are not kept by a hash index.
+      if ( ! currentValue.IsNull())
+        hashIndex.Remove(value_hash(currentValue), row);
+
+      if ( ! value.IsNull())
+        hashIndex.Insert(value_hash(value), row);
+    }
+    catch (...)
+    {
+      if (threadSafe)
+        ReleaseIndexField( &desc);
+
+      throw;
+    }
+
+    if (threadSafe)
+    {
+      ReleaseIndexField( &desc);
+      syncHolder.lock();
+    }
+  }
+
+  return lsn;
+}
+
+
+template<> uint64_t
+PrototypeTable::StoreEntry(const ROW_INDEX        row,
+                           const FIELD_INDEX      field,
+                           const bool             threadSafe,
+                           const DText&           value)
+{
+  FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+
+  if (IS_ARRAY(desc.Type()) || (GET_BASE_TYPE(desc.Type()) != T_TEXT))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+  }
+  else if (row > mRowsCount)
+    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
+
+  assert(Serializer::Size(T_TEXT, false) == 2 * sizeof(uint64_t));
+
+  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
+  MarkRowModification(threadSafe ? &syncHolder : nullptr);
+
+  shared_ptr<ITextStrategy> s = value.GetStrategy();
+  LockGuard<Lock> _l(s->mLock);
+
+  uint64_t newFirstEntry = ~0ull;
+  uint64_t newFieldValueSize = 0;
+  const bool skipVariableStore = s->Utf8CountU() < (2 * sizeof(uint64_t));
+  VariableSizeStore* const store = VSStore().get();
+
+  if ( !skipVariableStore)
+  {
+    if (s->ShareStoredCopy( *store, &newFirstEntry))
+    {
+      //The value was already copied here, so just share it.
+      newFieldValueSize = s->Utf8CountU() + RowFieldText::CACHE_META_DATA_SIZE;
+    }
+    else if (s->GetTemporalContainer().Size() == 0)
+    {
+      RowFieldText& r = _SC(RowFieldText&, *s);
+      newFieldValueSize = r.Utf8CountU() + RowFieldText::CACHE_META_DATA_SIZE;
+
+      if ( &r.GetRowStorage() != store)
+      {
+        newFirstEntry = store->AddRecord(r.GetRowStorage(),
+                                         r.mFirstEntry,
+                                         0,
+                                         newFieldValueSize);
+        r.BindStoredCopy(VSStore(), newFirstEntry);
+      }
+      else
+      {
+        r.GetRowStorage().IncrementRecordRef(r.mFirstEntry);
+        newFirstEntry = r.mFirstEntry;
+      }
+    }
+    else
+    {
+      if (s->Utf8CountU() >= RowFieldText::MAX_BYTES_COUNT)
+      {
+        throw DBSException(_EXTRA(DBSException::OPER_NOT_SUPPORTED),
+                           "This implementation does not support text"
+                           " fields with more than %lu characters.",
+                           _SC(long, RowFieldText::MAX_BYTES_COUNT));
+      }
+
+      newFieldValueSize = s->Utf8CountU() + RowFieldText::CACHE_META_DATA_SIZE;
+
+      assert(s->mCachedCharsCount <= RowFieldText::MAX_CHARS_COUNT);
+
+      uint8_t headerData[RowFieldText::CACHE_META_DATA_SIZE];
+
+      store_le_int32(s->mCachedCharsCount, headerData);
+      store_le_int32(s->mCachedCharIndex, headerData + sizeof(uint32_t));
+      store_le_int32(s->mCachedCharIndexOffset, headerData + 2 * sizeof(uint32_t));
+
+      newFirstEntry = store->AddRecord(headerData, sizeof headerData);
+      store->UpdateRecord(newFirstEntry,
+                          sizeof headerData,
+                          s->GetTemporalContainer(),
+                          0,
+                          s->Utf8CountU());
+      s->BindStoredCopy(VSStore(), newFirstEntry);
+    }
+  }
+
+  if (row == mRowsCount)
+    AddRow(true);
+
+  StoredItem cachedItem = mRowCache.RetriveItem(row);
+  uint8_t* const rowData = cachedItem.GetDataForUpdate();
+  const uint8_t bitsSet = ~0;
+  bool fieldValueWasNull = false;
+
+  uint8_t* const fieldFirstEntry = rowData + desc.RowDataOff();
+  uint8_t* const fieldValueSize = rowData + desc.RowDataOff() + sizeof(uint64_t);
+
+  const uint_t byteOff = desc.NullBitIndex() / 8;
+  const uint8_t bitOff = desc.NullBitIndex() % 8;
+
+  //Get the old index key while the old value is still stored.
+  const bool indexed = (mvIndexNodeMgrs[field] != nullptr);
+  const TextIndexPrefix oldKey = indexed
+                                   ? StoredTextPrefix(store, desc, rowData)
+                                   : TextIndexPrefix();
+
+  if ((rowData[byteOff] & (1 << bitOff)) != 0)
+    fieldValueWasNull = true;
+
+  const bool hashed = (mvHashIndexes[field] != nullptr);
+  const uint64_t oldHash = (hashed && ! fieldValueWasNull)
+                             ? StoredValueHash(store, desc, rowData)
+                             : 0;
+
+  const bool trigramIndexed = (mvBitmapIndexes[field] != nullptr);
+  vector<uint64_t> oldTrigrams;
+  if (trigramIndexed)
+    StoredTextTrigrams(store, desc, rowData, oldTrigrams);
+
+  if (fieldValueWasNull && (s->mCachedCharsCount == 0))
+    return 0;
+
+  else if ((fieldValueWasNull == false) && (s->mCachedCharsCount == 0))
+  {
+    rowData[byteOff] |= (1 << bitOff);
+
+    if (rowData[byteOff] == bitsSet)
+      CheckRowToDelete(row);
+  }
+  else if (s->mCachedCharsCount != 0)
+  {
+    if (rowData[byteOff] == bitsSet)
+    {
+      assert(fieldValueWasNull == true);
+
+      CheckRowToReuse(row);
+    }
+    rowData[byteOff] &= ~(1 << bitOff);
+  }
+
+  if ((fieldValueWasNull == false)
+      && ((load_le_int64(fieldValueSize) & 0x8000000000000000ull) == 0))
+  {
+    store->DecrementRecordRef(load_le_int64(fieldFirstEntry));
+  }
+
+  if (skipVariableStore)
+  {
+    assert(s->Utf8CountU() < _SC(uint_t, Serializer::Size(T_TEXT, false)));
+
+    store_le_int64((s->Utf8CountU() | 0x80) << 56, fieldValueSize);
+    s->ReadUtf8U(0, s->Utf8CountU(), rowData + desc.RowDataOff());
+  }
+  else
+  {
+    store_le_int64(newFieldValueSize, fieldValueSize);
+    store_le_int64(newFirstEntry, fieldFirstEntry);
+  }
+
+  if (indexed)
+  {
+    const TextIndexPrefix newKey = StoredTextPrefix(store, desc, rowData);
+
+    //The rows lock is kept, as the value's lock is held too.
+    if (threadSafe)
+      AcquireFieldIndex( &desc);
+
+    try
+    {
+      if ( ! (oldKey == newKey))
+      {
+        NODE_INDEX dummyNode;
+        KEY_INDEX dummyKey;
+
+        BTree fieldIndexTree( *mvIndexNodeMgrs[field]);
+
+        fieldIndexTree.RemoveKey(TextBTreeKey(oldKey, row));
+        fieldIndexTree.InsertKey(TextBTreeKey(newKey, row), &dummyNode, &dummyKey);
+      }
+    }
+    catch (...)
+    {
+      if (threadSafe)
+        ReleaseIndexField( &desc);
+
+      throw;
+    }
+
+    if (threadSafe)
+      ReleaseIndexField( &desc);
+  }
+  else if (hashed)
+  {
+    const bool newNull = (rowData[byteOff] & (1 << bitOff)) != 0;
+    const uint64_t newHash = newNull ? 0 : StoredValueHash(store, desc, rowData);
+
+    if (threadSafe)
+      AcquireFieldIndex( &desc);
+
+    try
+    {
+      if ((fieldValueWasNull != newNull) || (oldHash != newHash))
+      {
+        if ( ! fieldValueWasNull)
+          mvHashIndexes[field]->Remove(oldHash, row);
+
+        if ( ! newNull)
+          mvHashIndexes[field]->Insert(newHash, row);
+      }
+    }
+    catch (...)
+    {
+      if (threadSafe)
+        ReleaseIndexField( &desc);
+
+      throw;
+    }
+
+    if (threadSafe)
+      ReleaseIndexField( &desc);
+  }
+  else if (trigramIndexed)
+  {
+    vector<uint64_t> newTrigrams;
+    StoredTextTrigrams(store, desc, rowData, newTrigrams);
+
+    if (threadSafe)
+      AcquireFieldIndex( &desc);
+
+    try
+    {
+      if (oldTrigrams != newTrigrams)
+      {
+        mvBitmapIndexes[field]->RemoveTrigrams(oldTrigrams, row);
+        mvBitmapIndexes[field]->AddTrigrams(newTrigrams, row);
+      }
+    }
+    catch (...)
+    {
+      if (threadSafe)
+        ReleaseIndexField( &desc);
+
+      throw;
+    }
+
+    if (threadSafe)
+      ReleaseIndexField( &desc);
+  }
+
+  RedoLog* const log = TableRedoLog();
+  if (log == nullptr)
+    return 0;
+
+  TextRedoContent content( *s);
+  return log->LogFieldValue(TableName(), row, field, desc.Type(), content);
+}
+
+
+template<> uint64_t
+PrototypeTable::StoreEntry(const ROW_INDEX        row,
+                           const FIELD_INDEX      field,
+                           const bool             threadSafe,
+                           const DArray&          value)
+{
+  FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+
+  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
+  MarkRowModification(threadSafe ? &syncHolder : nullptr);
+
+  auto s = value.GetStrategy();
+  LockGuard<Lock> _l(s->mLock);
+
+  if ( ! IS_ARRAY(desc.Type())
+      || (GET_BASE_TYPE(desc.Type()) != s->Type() && s->Count() != 0))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+  }
+  else if (row > mRowsCount)
+    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
+
+  uint64_t newFirstEntry = ~0;
+  uint64_t newFieldValueSize = 0;
+  const uint8_t bitsSet = ~0;
+  bool fieldValueWasNull = false;
+  const bool skipVariableStore = s->RawSize() < (2 * sizeof(uint64_t));
+  VariableSizeStore* const store = VSStore().get();
+
+  if ( !skipVariableStore)
+  {
+    if (s->ShareStoredCopy( *store, &newFirstEntry))
+    {
+      //The array was already copied here, so just share it.
+      newFieldValueSize = s->RawSize() + RowFieldArray::METADATA_SIZE;
+    }
+    else if (s->GetTemporalContainer().Size() == 0)
+    {
+      VariableSizeStore& arrayStore = s->GetRowStorage();
+      const uint64_t arrayFirstEntry = _SC(RowFieldArray&, *s).mFirstRecordEntry;
+      if ( &arrayStore == store)
+      {
+        arrayStore.IncrementRecordRef(arrayFirstEntry);
+
+        newFieldValueSize = s->RawSize() + RowFieldArray::METADATA_SIZE;
+        newFirstEntry = arrayFirstEntry;
+      }
+      else
+      {
+        newFieldValueSize = s->RawSize() + RowFieldArray::METADATA_SIZE;
+        newFirstEntry = store->AddRecord(arrayStore,
+                                         arrayFirstEntry,
+                                         0,
+                                         newFieldValueSize);
+        s->BindStoredCopy(VSStore(), newFirstEntry);
+      }
+    }
+    else
+    {
+      newFieldValueSize = s->RawSize();
+
+      uint8_t elemsCount[RowFieldArray::METADATA_SIZE];
+      store_le_int64(s->Count(), elemsCount);
+
+      newFirstEntry = store->AddRecord(elemsCount, sizeof elemsCount);
+      store->UpdateRecord(newFirstEntry,
+                          sizeof elemsCount,
+                          s->GetTemporalContainer(),
+                          0,
+                          newFieldValueSize);
+      newFieldValueSize += sizeof elemsCount;
+      s->BindStoredCopy(VSStore(), newFirstEntry);
+    }
+  }
+
+  if (row == mRowsCount)
+    AddRow(true);
+
+  StoredItem cachedItem = mRowCache.RetriveItem(row);
+  uint8_t * const rowData = cachedItem.GetDataForUpdate();
+
+  uint8_t * const fieldFirstEntry = rowData + desc.RowDataOff();
+  uint8_t * const fieldValueSize = rowData + desc.RowDataOff() + sizeof(uint64_t);
+
+  const uint_t byteOff = desc.NullBitIndex() / 8;
+  const uint8_t bitOff = desc.NullBitIndex() % 8;
+
+  if ((rowData[byteOff] & (1 << bitOff)) != 0)
+    fieldValueWasNull = true;
+
+  //Read before the row's value is changed, to know what to remove from the index.
+  const bool elementsIndexed = (mvBitmapIndexes[field] != nullptr);
+  vector<uint8_t> oldElements;
+  if (elementsIndexed && ! fieldValueWasNull)
+    StoredArrayElements(store, desc, rowData, oldElements);
+
+  if (fieldValueWasNull && (s->Count() == 0))
+    return 0;
+
+  else if ((fieldValueWasNull == false) && (s->Count() == 0))
+  {
+    rowData[byteOff] |= (1 << bitOff);
+
+    if (rowData[byteOff] == bitsSet)
+      CheckRowToDelete(row);
+  }
+  else if (s->Count() != 0)
+  {
+    if (rowData[byteOff] == bitsSet)
+    {
+      assert(fieldValueWasNull == true);
+
+      CheckRowToReuse(row);
+    }
+    rowData[byteOff] &= ~(1 << bitOff);
+  }
+
+  if ((fieldValueWasNull == false)
+      && ((load_le_int64(fieldValueSize) & 0x8000000000000000ull) == 0))
+  {
+    store->DecrementRecordRef(load_le_int64(fieldFirstEntry));
+  }
+
+  if (skipVariableStore)
+  {
+    assert(s->RawSize() < _SC(uint_t, Serializer::Size(T_HIRESTIME, true)));
+
+    store_le_int64((s->RawSize() | 0x80) << 56, fieldValueSize);
+    s->RawRead(0, s->RawSize(), rowData + desc.RowDataOff());
+  }
+  else
+  {
+    store_le_int64(newFieldValueSize, fieldValueSize);
+    store_le_int64(newFirstEntry, fieldFirstEntry);
+  }
+
+  if (elementsIndexed)
+  {
+    const uint_t elementSize = Serializer::Size(_SC(DBS_FIELD_TYPE, GET_BASE_TYPE(desc.Type())),
+                                                false);
+    vector<uint8_t> newElements;
+    StoredArrayElements(store, desc, rowData, newElements);
+
+    //The rows lock is kept, as the value's lock is held too.
+    if (threadSafe)
+      AcquireFieldIndex( &desc);
+
+    try
+    {
+      mvBitmapIndexes[field]->RemoveElements(oldElements, elementSize, row);
+      mvBitmapIndexes[field]->AddElements(newElements, elementSize, row);
+    }
+    catch (...)
+    {
+      if (threadSafe)
+        ReleaseIndexField( &desc);
+
+      throw;
+    }
+
+    if (threadSafe)
+      ReleaseIndexField( &desc);
+  }
+
+  RedoLog* const log = TableRedoLog();
+  if (log == nullptr)
+    return 0;
+
+  ArrayRedoContent content( *s);
+  return log->LogFieldValue(TableName(), row, field, desc.Type(), content);
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX       row,
+                    const FIELD_INDEX     field,
+                    const DBool&          value,
+                    const bool            skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX      row,
+                    const FIELD_INDEX    field,
+                    const DChar&         value,
+                    const bool           skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX       row,
+                    const FIELD_INDEX     field,
+                    const DDate&          value,
+                    const bool            skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX       row,
+                    const FIELD_INDEX     field,
+                    const DDateTime&      value,
+                    const bool            skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    const DHiresTime&      value,
+                    const bool             skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    const DInt8&           value,
+                    const bool             skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    const DInt16&          value,
+                    const bool             skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    const DInt32&          value,
+                    const bool             skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    const DInt64&          value,
+                    const bool             skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    const DReal&           value,
+                    const bool             skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    const DRichReal&       value,
+                    const bool             skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX       row,
+                    const FIELD_INDEX     field,
+                    const DUInt8&         value,
+                    const bool            skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX      row,
+                    const FIELD_INDEX    field,
+                    const DUInt16&       value,
+                    const bool           skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX      row,
+                    const FIELD_INDEX    field,
+                    const DUInt32&       value,
+                    const bool           skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX      row,
+                    const FIELD_INDEX    field,
+                    const DUInt64&       value,
+                    const bool           skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+void
+PrototypeTable::Set(const ROW_INDEX      row,
+                    const FIELD_INDEX    field,
+                    const DText&         value,
+                    const bool           skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+void
+PrototypeTable::Set(const ROW_INDEX      row,
+                    const FIELD_INDEX    field,
+                    const DArray&        value,
+                    const bool           skipThreadSafety)
+{
+  CommitUpdate(StoreEntry(row, field, ! skipThreadSafety, value));
+}
+
+
+shared_ptr<ITextStrategy>
+allocate_row_field_text(VariableSizeStoreSPtr store,
+                        const uint64_t        firstRecordEntry,
+                        const uint64_t        valueSize)
+{
+  shared_ptr<ITextStrategy> result = shared_make(RowFieldText,
+                                                 store,
+                                                 firstRecordEntry,
+                                                 valueSize);
+  result->SetSelfReference(result);
+  return result;
+}
+
+
+static shared_ptr<IArrayStrategy>
+allocate_row_field_array(VariableSizeStoreSPtr store,
+                         const uint64_t        firstRecordEntry,
+                         const DBS_FIELD_TYPE  type)
+{
+  shared_ptr<IArrayStrategy> r = shared_make(RowFieldArray,
+                                             store,
+                                             firstRecordEntry,
+                                             type);
+  r->SetSelfReference(r);
+  return r;
+}
+
+
+template <class T> void
+PrototypeTable::RetrieveEntry(const ROW_INDEX   row,
+                              const FIELD_INDEX field,
+                              const bool        threadSafe,
+                              T&                outValue)
+{
+  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
+
+  const FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+
+  if ((desc.Type() & PS_TABLE_ARRAY_MASK)
+      || ((desc.Type() & PS_TABLE_FIELD_TYPE_MASK) != _SC(uint_t, outValue.DBSType())))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+  }
+
+  const uint_t byteOff = desc.NullBitIndex() / 8;
+  const uint8_t bitOff = desc.NullBitIndex() % 8;
+
+  if (row >= mRowsCount)
+    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
+
+  StoredItem cachedItem = mRowCache.RetriveItem(row);
+  const uint8_t* const rowData = cachedItem.GetDataForRead();
+
+  if (rowData[byteOff] & (1 << bitOff))
+    outValue = T();
+
+  else
+  {
+    outValue.~T();
+    Serializer::Load(rowData + desc.RowDataOff(), &outValue);
+  }
+}
+
+
+template <> void
+PrototypeTable::RetrieveEntry(const ROW_INDEX   row,
+                              const FIELD_INDEX field,
+                              const bool        threadSafe,
+                              DText&            outValue)
+{
+  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
+
+  const FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+
+  if (row >= mRowsCount)
+    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
+
+  if (IS_ARRAY(desc.Type()) || (GET_BASE_TYPE(desc.Type()) != T_TEXT))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+  }
+
+  StoredItem cachedItem = mRowCache.RetriveItem(row);
+  const uint8_t* const rowData = cachedItem.GetDataForRead();
+
+  const uint64_t fieldValueSize = load_le_int64(rowData + desc.RowDataOff() + sizeof(uint64_t));
+  const uint_t byteOff = desc.NullBitIndex() / 8;
+  const uint8_t bitOff = desc.NullBitIndex() % 8;
+
+  if (rowData[byteOff] & (1 << bitOff))
+    outValue = DText();
+
+  else if ((fieldValueSize & 0x8000000000000000ull) != 0)
+  {
+    assert(((fieldValueSize >> 56) & 0x7F) > 0);
+    assert(((fieldValueSize >> 56) & 0x7F) < Serializer::Size(T_TEXT, false));
+
+    outValue = DText(rowData + desc.RowDataOff(), (fieldValueSize >> 56) & 0x7F);
+  }
+  else
+  {
+    const uint64_t fieldFirstEntry = load_le_int64(rowData + desc.RowDataOff());
+    outValue = DText(allocate_row_field_text(VSStore(), fieldFirstEntry, fieldValueSize));
+  }
+}
+
+
+template <> void
+PrototypeTable::RetrieveEntry(const ROW_INDEX   row,
+                              const FIELD_INDEX field,
+                              const bool        threadSafe,
+                              DArray&           outValue)
+{
+  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
+
+  const FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+
+  if (row >= mRowsCount)
+    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
+
+  if ( !IS_ARRAY(desc.Type())
+      || ((GET_BASE_TYPE(desc.Type()) != outValue.Type()) && !outValue.IsNull()))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+  }
+
+  StoredItem cachedItem = mRowCache.RetriveItem(row);
+  const uint8_t * const rowData = cachedItem.GetDataForRead();
+
+  const uint64_t fieldValueSize = load_le_int64(rowData + desc.RowDataOff() + sizeof(uint64_t));
+
+  const uint_t byteOff = desc.NullBitIndex() / 8;
+  const uint8_t bitOff = desc.NullBitIndex() % 8;
+
+  if (rowData[byteOff] & (1 << bitOff))
+  {
+    switch (GET_BASE_TYPE(desc.Type()))
+    {
+    case T_BOOL:
+      outValue = DArray(_SC(DBool *, nullptr));
+      break;
+
+    case T_CHAR:
+      outValue = DArray(_SC(DChar *, nullptr));
+      break;
+
+    case T_DATE:
+      outValue = DArray(_SC(DDate *, nullptr));
+      break;
+
+    case T_DATETIME:
+      outValue = DArray(_SC(DDateTime *, nullptr));
+      break;
+
+    case T_HIRESTIME:
+      outValue = DArray(_SC(DHiresTime *, nullptr));
+      break;
+
+    case T_UINT8:
+      outValue = DArray(_SC(DUInt8 *, nullptr));
+      break;
+
+    case T_UINT16:
+      outValue = DArray(_SC(DUInt16 *, nullptr));
+      break;
+
+    case T_UINT32:
+      outValue = DArray(_SC(DUInt32 *, nullptr));
+      break;
+
+    case T_UINT64:
+      outValue = DArray(_SC(DUInt64 *, nullptr));
+      break;
+
+    case T_REAL:
+      outValue = DArray(_SC(DReal *, nullptr));
+      break;
+
+    case T_RICHREAL:
+      outValue = DArray(_SC(DRichReal *, nullptr));
+      break;
+
+    case T_INT8:
+      outValue = DArray(_SC(DInt8 *, nullptr));
+      break;
+
+    case T_INT16:
+      outValue = DArray(_SC(DInt16 *, nullptr));
+      break;
+
+    case T_INT32:
+      outValue = DArray(_SC(DInt32 *, nullptr));
+      break;
+
+    case T_INT64:
+      outValue = DArray(_SC(DInt64 *, nullptr));
+      break;
+
+    default:
+      assert(false);
+    }
+  }
+  else if ((fieldValueSize & 0x8000000000000000ull) != 0)
+  {
+    shared_ptr<IArrayStrategy> strategy = shared_make(TemporalArray, GET_BASE_TYPE(desc.Type()));
+    strategy->SetSelfReference(strategy);
+
+    assert(((fieldValueSize >> 56) & 0x7F) > 0);
+    assert(((fieldValueSize >> 56) & 0x7F) < Serializer::Size(T_BOOL, true));
+
+    const uint64_t size = (fieldValueSize >> 56) & 0x7F;
+    strategy->RawWrite(0, size, rowData + desc.RowDataOff());
+    strategy->mElementsCount = size / strategy->mElementRawSize;
+    outValue = DArray(strategy);
+  }
+  else
+  {
+    const uint64_t fieldFirstEntry = load_le_int64(rowData + desc.RowDataOff());
+    outValue = DArray(allocate_row_field_array(VSStore(),
+                                               fieldFirstEntry,
+                                               _SC(DBS_FIELD_TYPE,
+                                                   desc.Type() & PS_TABLE_FIELD_TYPE_MASK)));
+  }
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DBool&                 outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX      row,
+                    const FIELD_INDEX    field,
+                    DChar&               outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DDate&                 outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DDateTime&             outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DHiresTime&            outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DInt8&                 outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DInt16&                outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DInt32&                outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DInt64&                outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DReal&                 outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DRichReal&             outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DUInt8&                outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DUInt16&               outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DUInt32&               outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DUInt64&               outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DText&                 outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+void
+PrototypeTable::Get(const ROW_INDEX        row,
+                    const FIELD_INDEX      field,
+                    DArray&                outValue,
+                    const bool             skipThreadSafety)
+{
+  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+}
+
+
+template<typename T> void
+PrototypeTable::table_exchange_rows(const FIELD_INDEX field,
+                                    const ROW_INDEX row1,
+                                    const ROW_INDEX row2)
+{
+  T row1Value, row2Value;
+
+  assert(row1 < AllocatedRows());
+  assert(row2 < AllocatedRows());
+
+  Get(row1, field, row1Value, true);
+  Get(row2, field, row2Value, true);
+
+  Set(row1, field, row2Value, true);
+  Set(row2, field, row1Value, true);
+}
+
+
+void
+PrototypeTable::ExchangeRows(const ROW_INDEX    row1,
+                             const ROW_INDEX    row2,
+                             const bool         skipTthreadSafety)
+{
+  LockGuard<Lock> _l(mRowsSync, skipTthreadSafety);
+
+  const ROW_INDEX allocatedRows = AllocatedRows();
+  const FIELD_INDEX fieldsCount = FieldsCount();
+
+  if ((allocatedRows <= row1) || (allocatedRows <= row2))
+    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
+
+  if (row1 == row2)
+    return ;
+
+  for (FIELD_INDEX field = 0; field < fieldsCount; ++field)
+  {
+    const DBSFieldDescriptor fieldDesc = DescribeField(field);
+
+    if (fieldDesc.isArray)
+      table_exchange_rows<DArray>(field, row1, row2);
+
+    else
     {
-      BTree fieldIndexTree( *mvIndexNodeMgrs[field]);
+      switch (fieldDesc.type)
+      {
+      case T_BOOL:
+        table_exchange_rows<DBool>(field, row1, row2);
+        break;
+
+      case T_CHAR:
+        table_exchange_rows<DChar>(field, row1, row2);
+        break;
+
+      case T_DATE:
+        table_exchange_rows<DDate>(field, row1, row2);
+        break;
+
+      case T_DATETIME:
+        table_exchange_rows<DDateTime>(field, row1, row2);
+        break;
+
+      case T_HIRESTIME:
+        table_exchange_rows<DHiresTime>(field, row1, row2);
+        break;
+
+      case T_INT8:
+        table_exchange_rows<DInt8>(field, row1, row2);
+        break;
+
+      case T_INT16:
+        table_exchange_rows<DInt16>(field, row1, row2);
+        break;
+
+      case T_INT32:
+        table_exchange_rows<DInt32>(field, row1, row2);
+        break;
+
+      case T_INT64:
+        table_exchange_rows<DInt64>(field, row1, row2);
+        break;
+
+      case T_UINT8:
+        table_exchange_rows<DUInt8>(field, row1, row2);
+        break;
+
+      case T_UINT16:
+        table_exchange_rows<DUInt16>(field, row1, row2);
+        break;
+
+      case T_UINT32:
+        table_exchange_rows<DUInt32>(field, row1, row2);
+        break;
+
+      case T_UINT64:
+        table_exchange_rows<DUInt64>(field, row1, row2);
+        break;
+
+      case T_REAL:
+        table_exchange_rows<DReal>(field, row1, row2);
+        break;
+
+      case T_RICHREAL:
+        table_exchange_rows<DRichReal>(field, row1, row2);
+        break;
+
+      case T_TEXT:
+        table_exchange_rows<DText>(field, row1, row2);
+        break;
+
+      default:
+        throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
+      }
+    }
+  }
+}
 
-      fieldIndexTree.RemoveKey(T_BTreeKey<T>(currentValue, row));
-      fieldIndexTree.InsertKey(T_BTreeKey<T>(value, row), &dummyNode, &dummyKey);
+class StoredFieldRedoContent : public IRedoContent
+{
+public:
+  StoredFieldRedoContent(VariableSizeStore&     store,
+                         const uint8_t* const   fieldData,
+                         const bool             isNull,
+                         const uint_t           metaDataSize)
+    : mStore(store),
+      mFieldData(fieldData),
+      mIsNull(isNull),
+      mMetaDataSize(metaDataSize)
+  {
+  }
+
+  virtual uint64_t Size() override
+  {
+    if (mIsNull)
+      return 0;
+
+    const uint64_t valueSize = load_le_int64(mFieldData + sizeof(uint64_t));
+    if (valueSize & 0x8000000000000000ull)
+      return (valueSize >> 56) & 0x7F;
+
+    return valueSize - mMetaDataSize;
+  }
+
+  virtual void Read(const uint64_t offset, const uint_t size, uint8_t* const buffer) override
+  {
+    const uint64_t valueSize = load_le_int64(mFieldData + sizeof(uint64_t));
+    if (valueSize & 0x8000000000000000ull)
+      memcpy(buffer, mFieldData + offset, size);
+
+    else
+    {
+      mStore.GetRecord(load_le_int64(mFieldData),
+                       mMetaDataSize + offset,
+                       size,
+                       buffer);
     }
-    catch (...)
+  }
+
+private:
+  VariableSizeStore&      mStore;
+  const uint8_t* const    mFieldData;
+  const bool              mIsNull;
+  const uint_t            mMetaDataSize;
+};
+
+
+static bool
+is_field_null(const FieldDescriptor& desc, const uint8_t* const rowData)
+{
+  return (rowData[desc.NullBitIndex() / 8] & (1 << (desc.NullBitIndex() % 8))) != 0;
+}
+
+
+TextIndexPrefix
+PrototypeTable::StoredTextPrefix(VariableSizeStore* const   store,
+                                 const FieldDescriptor&     desc,
+                                 const uint8_t* const       rowData)
+{
+  if (is_field_null(desc, rowData))
+    return TextIndexPrefix();
+
+  const uint8_t* const fieldData = rowData + desc.RowDataOff();
+  const uint64_t valueSize = load_le_int64(fieldData + sizeof(uint64_t));
+
+  if (valueSize & 0x8000000000000000ull)
+    return TextIndexPrefix(fieldData, (valueSize >> 56) & 0x7F);
+
+  //Just the prefix's code units are read, but all of them are counted.
+  const uint64_t utf8Count = valueSize - RowFieldText::CACHE_META_DATA_SIZE;
+  uint8_t prefix[TextIndexPrefix::MAX_UNITS];
+
+  assert(store != nullptr);
+
+  store->GetRecord(load_le_int64(fieldData),
+                   RowFieldText::CACHE_META_DATA_SIZE,
+                   MIN(utf8Count, _SC(uint64_t, sizeof prefix)),
+                   prefix);
+
+  return TextIndexPrefix(prefix, utf8Count);
+}
+
+
+uint64_t
+PrototypeTable::StoredValueHash(VariableSizeStore* const   store,
+                                const FieldDescriptor&     desc,
+                                const uint8_t* const       rowData)
+{
+  assert( ! is_field_null(desc, rowData));
+
+  const uint8_t* const fieldData = rowData + desc.RowDataOff();
+
+  if (GET_BASE_TYPE(desc.Type()) != T_TEXT)
+    return wh_hash(fieldData, Serializer::Size(_SC(DBS_FIELD_TYPE, desc.Type()), false));
+
+  const uint64_t valueSize = load_le_int64(fieldData + sizeof(uint64_t));
+
+  if (valueSize & 0x8000000000000000ull)
+    return wh_hash(fieldData, (valueSize >> 56) & 0x7F);
+
+  vector<uint8_t> utf8(valueSize - RowFieldText::CACHE_META_DATA_SIZE);
+
+  assert(store != nullptr);
+
+  store->GetRecord(load_le_int64(fieldData),
+                   RowFieldText::CACHE_META_DATA_SIZE,
+                   utf8.size(),
+                   utf8.data());
+
+  return wh_hash(utf8.data(), utf8.size());
+}
+
+
+void
+PrototypeTable::StoredTextTrigrams(VariableSizeStore* const   store,
+                                   const FieldDescriptor&     desc,
+                                   const uint8_t* const       rowData,
+                                   vector<uint64_t>&          outTrigrams)
+{
+  assert(GET_BASE_TYPE(desc.Type()) == T_TEXT);
+
+  if (is_field_null(desc, rowData))
+  {
+    outTrigrams.clear();
+    return;
+  }
+
+  const uint8_t* const fieldData = rowData + desc.RowDataOff();
+  const uint64_t valueSize = load_le_int64(fieldData + sizeof(uint64_t));
+
+  if (valueSize & 0x8000000000000000ull)
+  {
+    text_trigrams(fieldData, (valueSize >> 56) & 0x7F, outTrigrams);
+    return;
+  }
+
+  vector<uint8_t> utf8(valueSize - RowFieldText::CACHE_META_DATA_SIZE);
+
+  assert(store != nullptr);
+
+  store->GetRecord(load_le_int64(fieldData),
+                   RowFieldText::CACHE_META_DATA_SIZE,
+                   utf8.size(),
+                   utf8.data());
+
+  text_trigrams(utf8.data(), utf8.size(), outTrigrams);
+}
+
+
+void
+PrototypeTable::StoredArrayElements(VariableSizeStore* const   store,
+                                    const FieldDescriptor&     desc,
+                                    const uint8_t* const       rowData,
+                                    vector<uint8_t>&           outElements)
+{
+  assert(IS_ARRAY(desc.Type()));
+
+  if (is_field_null(desc, rowData))
+  {
+    outElements.clear();
+    return;
+  }
+
+  const uint8_t* const fieldData = rowData + desc.RowDataOff();
+  const uint64_t valueSize = load_le_int64(fieldData + sizeof(uint64_t));
+
+  if (valueSize & 0x8000000000000000ull)
+  {
+    outElements.assign(fieldData, fieldData + ((valueSize >> 56) & 0x7F));
+    return;
+  }
+
+  outElements.resize(valueSize - RowFieldArray::METADATA_SIZE);
+
+  assert(store != nullptr);
+
+  store->GetRecord(load_le_int64(fieldData),
+                   RowFieldArray::METADATA_SIZE,
+                   outElements.size(),
+                   outElements.data());
+}
+
+
+template<class T> static T
+row_field_value(const FieldDescriptor& desc, const uint8_t* const rowData)
+{
+  T value;
+
+  if ( ! is_field_null(desc, rowData))
+  {
+    value.~T();
+    Serializer::Load(rowData + desc.RowDataOff(), &value);
+  }
+
+  return value;
+}
+
+
+template<class T> static void
+add_sort_key(RowsSortKeys&            keys,
+             const FieldDescriptor&   desc,
+             const uint8_t* const     rowData,
+             const bool               reverse)
+{
+  keys.Add(row_field_value<T>(desc, rowData), reverse);
+}
+
+
+template<class T> static void
+update_sorted_row_index(BTree&                   indexTree,
+                        const FieldDescriptor&   desc,
+                        const ROW_INDEX          row,
+                        const uint8_t* const     oldRowData,
+                        const uint8_t* const     newRowData)
+{
+  const T oldValue = row_field_value<T>(desc, oldRowData);
+  const T newValue = row_field_value<T>(desc, newRowData);
+
+  if (oldValue == newValue)
+    return;
+
+  NODE_INDEX dummyNode;
+  KEY_INDEX dummyKey;
+
+  indexTree.RemoveKey(T_BTreeKey<T>(oldValue, row));
+  indexTree.InsertKey(T_BTreeKey<T>(newValue, row), &dummyNode, &dummyKey);
+}
+
+
+void
+PrototypeTable::Sort(const FIELD_INDEX field,
+                     const ROW_INDEX fromRow,
+                     const ROW_INDEX toRow,
+                     const bool reverse)
+{
+  Sort( &field, &reverse, 1, fromRow, toRow);
+}
+
+
+void
+PrototypeTable::Sort(const FIELD_INDEX* const   fields,
+                     const bool* const          reverse,
+                     const FIELD_INDEX          fieldsCount,
+                     const ROW_INDEX            fromRow,
+                     const ROW_INDEX            toRow)
+{
+  for (FIELD_INDEX f = 0; f < fieldsCount; ++f)
+  {
+    const DBSFieldDescriptor fd = DescribeField(fields[f]);
+
+    if (fd.isArray)
     {
-      ReleaseIndexField( &desc);
-      throw;
+      throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID),
+                         "This implementation does not sort array fields.");
     }
+  }
 
-    if (threadSafe)
+  LockGuard<Lock> syncHolder(mRowsSync);
+
+  if ((fieldsCount == 0) || (mRowsCount == 0))
+    return;
+
+  const ROW_INDEX from = MIN(fromRow, toRow);
+  const ROW_INDEX to = MIN(MAX(fromRow, toRow), mRowsCount - 1);
+
+  if (from > to)
+    throw DBSException(_EXTRA(DBSException::INVALID_PARAMETERS));
+
+  else if (from == to)
+    return;
+
+  vector<ROW_INDEX> sortedRows;
+  if ( ! SortWithCompositeIndex(fields, reverse, fieldsCount, from, to, sortedRows))
+  {
+    //Build the rows' keys in a single pass, so the values are not loaded again
+    //every time two rows are compared.
+    RowsSortKeys keys(DBSGetSeettings().mSortThreads);
+    vector<uint8_t> textBuffer;
+
+    for (ROW_INDEX row = from; row <= to; ++row)
     {
-      ReleaseIndexField( &desc);
-      syncHolder.lock();
+      StoredItem cachedItem = mRowCache.RetriveItem(row);
+      const uint8_t* const rowData = cachedItem.GetDataForRead();
+
+      for (FIELD_INDEX f = 0; f < fieldsCount; ++f)
+        AddSortKey(keys, fields[f], rowData, reverse[f], textBuffer);
+
+      keys.CommitKey(row);
     }
+
+    keys.Sort(sortedRows);
   }
+
+  assert(sortedRows.size() == (to - from + 1));
+
+  RewriteSortedRows(from, sortedRows, syncHolder);
 }
 
 
-template<> void
-PrototypeTable::StoreEntry(const ROW_INDEX        row,
+bool
+PrototypeTable::SortWithCompositeIndex(const FIELD_INDEX* const   fields,
+                                       const bool* const          reverse,
+                                       const FIELD_INDEX          fieldsCount,
+                                       const ROW_INDEX            from,
+                                       const ROW_INDEX            to,
+                                       vector<ROW_INDEX>&         outRows)
+{
+  //An index keeps its keys like the sort does, the equal ones ordered by
+  //their rows, so its order is the sorted one when nothing is reversed.
+  if (find(reverse, reverse + fieldsCount, true) != reverse + fieldsCount)
+    return false;
+
+  const size_t i = FindCompositeIndex(fields, fieldsCount);
+  if (i == mvCompositeIndexes.size())
+    return false;
+
+  index_range_rows( *mvCompositeIndexes[i].mNodeMgr,
+                   CompositeKey(),
+                   CompositeKey::Max(),
+                   from,
+                   to,
+                   outRows);
+  return true;
+}
+
+
+void
+PrototypeTable::AddSortKey(RowsSortKeys&          keys,
                            const FIELD_INDEX      field,
-                           const bool             threadSafe,
-                           const DText&           value)
+                           const uint8_t* const   rowData,
+                           const bool             reverse,
+                           vector<uint8_t>&       textBuffer)
 {
   const FieldDescriptor& desc = GetFieldDescriptorInternal(field);
 
-  if (IS_ARRAY(desc.Type()) || (GET_BASE_TYPE(desc.Type()) != T_TEXT))
+  switch (desc.Type())
   {
-    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
-  }
-  else if (row > mRowsCount)
-    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
+  case T_BOOL:
+    add_sort_key<DBool>(keys, desc, rowData, reverse);
+    break;
 
-  assert(Serializer::Size(T_TEXT, false) == 2 * sizeof(uint64_t));
+  case T_CHAR:
+    add_sort_key<DChar>(keys, desc, rowData, reverse);
+    break;
 
-  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
-  MarkRowModification(threadSafe ? &syncHolder : nullptr);
+  case T_DATE:
+    add_sort_key<DDate>(keys, desc, rowData, reverse);
+    break;
 
-  shared_ptr<ITextStrategy> s = value.GetStrategy();
-  LockGuard<Lock> _l(s->mLock);
+  case T_DATETIME:
+    add_sort_key<DDateTime>(keys, desc, rowData, reverse);
+    break;
 
-  uint64_t newFirstEntry = ~0ull;
-  uint64_t newFieldValueSize = 0;
-  const bool skipVariableStore = s->Utf8CountU() < (2 * sizeof(uint64_t));
-  VariableSizeStore* const store = VSStore().get();
+  case T_HIRESTIME:
+    add_sort_key<DHiresTime>(keys, desc, rowData, reverse);
+    break;
 
-  if ( !skipVariableStore)
-  {
-    if (s->GetTemporalContainer().Size() == 0)
-    {
-      RowFieldText& r = _SC(RowFieldText&, *s);
-      newFieldValueSize = r.Utf8CountU() + RowFieldText::CACHE_META_DATA_SIZE;
+  case T_INT8:
+    add_sort_key<DInt8>(keys, desc, rowData, reverse);
+    break;
 
-      if ( &r.GetRowStorage() != store)
-      {
-        newFirstEntry = store->AddRecord(r.GetRowStorage(),
-                                         r.mFirstEntry,
-                                         0,
-                                         newFieldValueSize);
-      }
-      else
-      {
-        r.GetRowStorage().IncrementRecordRef(r.mFirstEntry);
-        newFirstEntry = r.mFirstEntry;
-      }
-    }
-    else
-    {
-      if (s->Utf8CountU() >= RowFieldText::MAX_BYTES_COUNT)
-      {
-        throw DBSException(_EXTRA(DBSException::OPER_NOT_SUPPORTED),
-                           "This implementation does not support text"
-                           " fields with more than %lu characters.",
-                           _SC(long, RowFieldText::MAX_BYTES_COUNT));
-      }
+  case T_INT16:
+    add_sort_key<DInt16>(keys, desc, rowData, reverse);
+    break;
 
-      newFieldValueSize = s->Utf8CountU() + RowFieldText::CACHE_META_DATA_SIZE;
+  case T_INT32:
+    add_sort_key<DInt32>(keys, desc, rowData, reverse);
+    break;
 
-      assert(s->mCachedCharsCount <= RowFieldText::MAX_CHARS_COUNT);
+  case T_INT64:
+    add_sort_key<DInt64>(keys, desc, rowData, reverse);
+    break;
 
-      uint8_t headerData[RowFieldText::CACHE_META_DATA_SIZE];
+  case T_UINT8:
+    add_sort_key<DUInt8>(keys, desc, rowData, reverse);
+    break;
 
-      store_le_int32(s->mCachedCharsCount, headerData);
-      store_le_int32(s->mCachedCharIndex, headerData + sizeof(uint32_t));
-      store_le_int32(s->mCachedCharIndexOffset, headerData + 2 * sizeof(uint32_t));
+  case T_UINT16:
+    add_sort_key<DUInt16>(keys, desc, rowData, reverse);
+    break;
 
-      newFirstEntry = store->AddRecord(headerData, sizeof headerData);
-      store->UpdateRecord(newFirstEntry,
-                          sizeof headerData,
-                          s->GetTemporalContainer(),
-                          0,
-                          s->Utf8CountU());
+  case T_UINT32:
+    add_sort_key<DUInt32>(keys, desc, rowData, reverse);
+    break;
+
+  case T_UINT64:
+    add_sort_key<DUInt64>(keys, desc, rowData, reverse);
+    break;
+
+  case T_REAL:
+    add_sort_key<DReal>(keys, desc, rowData, reverse);
+    break;
+
+  case T_RICHREAL:
+    add_sort_key<DRichReal>(keys, desc, rowData, reverse);
+    break;
+
+  case T_TEXT:
+  {
+    if (is_field_null(desc, rowData))
+    {
+      keys.AddNull(reverse);
+      break;
+    }
+
+    const uint8_t* const fieldData = rowData + desc.RowDataOff();
+    const uint64_t valueSize = load_le_int64(fieldData + sizeof(uint64_t));
+
+    if (valueSize & 0x8000000000000000ull)
+      keys.AddText(fieldData, (valueSize >> 56) & 0x7F, reverse);
+
+    else
+    {
+      const uint64_t utf8Count = valueSize - RowFieldText::CACHE_META_DATA_SIZE;
+
+      textBuffer.resize(utf8Count);
+      VSStore()->GetRecord(load_le_int64(fieldData),
+                           RowFieldText::CACHE_META_DATA_SIZE,
+                           utf8Count,
+                           textBuffer.data());
+      keys.AddText(textBuffer.data(), utf8Count, reverse);
     }
   }
+    break;
+
+  default:
+    throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
+  }
+}
 
-  if (row == mRowsCount)
-    AddRow(true);
 
-  StoredItem cachedItem = mRowCache.RetriveItem(row);
-  uint8_t* const rowData = cachedItem.GetDataForUpdate();
-  const uint8_t bitsSet = ~0;
-  bool fieldValueWasNull = false;
+void
+PrototypeTable::UpdateSortedRowIndex(const FIELD_INDEX      field,
+                                     const ROW_INDEX        row,
+                                     const uint8_t* const   oldRowData,
+                                     const uint8_t* const   newRowData)
+{
+  const FieldDescriptor& desc = GetFieldDescriptorInternal(field);
 
-  uint8_t* const fieldFirstEntry = rowData + desc.RowDataOff();
-  uint8_t* const fieldValueSize = rowData + desc.RowDataOff() + sizeof(uint64_t);
+  if (mvHashIndexes[field] != nullptr)
+  {
+    FieldHashIndex& hashIndex = *mvHashIndexes[field];
 
-  const uint_t byteOff = desc.NullBitIndex() / 8;
-  const uint8_t bitOff = desc.NullBitIndex() % 8;
+    if ( ! is_field_null(desc, oldRowData))
+      hashIndex.Remove(StoredValueHash(VSStore().get(), desc, oldRowData), row);
 
-  if ((rowData[byteOff] & (1 << bitOff)) != 0)
-    fieldValueWasNull = true;
+    if ( ! is_field_null(desc, newRowData))
+      hashIndex.Insert(StoredValueHash(VSStore().get(), desc, newRowData), row);
 
-  if (fieldValueWasNull && (s->mCachedCharsCount == 0))
     return;
-
-  else if ((fieldValueWasNull == false) && (s->mCachedCharsCount == 0))
-  {
-    rowData[byteOff] |= (1 << bitOff);
-
-    if (rowData[byteOff] == bitsSet)
-      CheckRowToDelete(row);
   }
-  else if (s->mCachedCharsCount != 0)
+  else if ((mvBitmapIndexes[field] != nullptr) && (desc.IndexKind() == INDEX_ELEMENTS))
   {
-    if (rowData[byteOff] == bitsSet)
-    {
-      assert(fieldValueWasNull == true);
+    const uint_t elementSize = Serializer::Size(_SC(DBS_FIELD_TYPE, GET_BASE_TYPE(desc.Type())),
+                                                false);
+    vector<uint8_t> elements;
 
-      CheckRowToReuse(row);
-    }
-    rowData[byteOff] &= ~(1 << bitOff);
-  }
+    StoredArrayElements(VSStore().get(), desc, oldRowData, elements);
+    mvBitmapIndexes[field]->RemoveElements(elements, elementSize, row);
 
-  if ((fieldValueWasNull == false)
-      && ((load_le_int64(fieldValueSize) & 0x8000000000000000ull) == 0))
-  {
-    store->DecrementRecordRef(load_le_int64(fieldFirstEntry));
+    StoredArrayElements(VSStore().get(), desc, newRowData, elements);
+    mvBitmapIndexes[field]->AddElements(elements, elementSize, row);
+    return;
   }
-
-  if (skipVariableStore)
+  else if ((mvBitmapIndexes[field] != nullptr) && (desc.IndexKind() == INDEX_TRIGRAM))
   {
-    assert(s->Utf8CountU() < _SC(uint_t, Serializer::Size(T_TEXT, false)));
+    vector<uint64_t> trigrams;
 
-    store_le_int64((s->Utf8CountU() | 0x80) << 56, fieldValueSize);
-    s->ReadUtf8U(0, s->Utf8CountU(), rowData + desc.RowDataOff());
+    StoredTextTrigrams(VSStore().get(), desc, oldRowData, trigrams);
+    mvBitmapIndexes[field]->RemoveTrigrams(trigrams, row);
+
+    StoredTextTrigrams(VSStore().get(), desc, newRowData, trigrams);
+    mvBitmapIndexes[field]->AddTrigrams(trigrams, row);
+    return;
   }
-  else
+  else if (mvBitmapIndexes[field] != nullptr)
   {
-    store_le_int64(newFieldValueSize, fieldValueSize);
-    store_le_int64(newFirstEntry, fieldFirstEntry);
+    FieldBitmapIndex& bitmapIndex = *mvBitmapIndexes[field];
+    const uint_t valueSize = Serializer::Size(_SC(DBS_FIELD_TYPE, desc.Type()), false);
+
+    bitmapIndex.Remove(oldRowData + desc.RowDataOff(),
+                       is_field_null(desc, oldRowData) ? 0 : valueSize,
+                       row);
+    bitmapIndex.Add(newRowData + desc.RowDataOff(),
+                    is_field_null(desc, newRowData) ? 0 : valueSize,
+                    row);
+    return;
   }
-}
 
+  BTree indexTree( *mvIndexNodeMgrs[field]);
 
-template<> void
-PrototypeTable::StoreEntry(const ROW_INDEX        row,
-                           const FIELD_INDEX      field,
-                           const bool             threadSafe,
-                           const DArray&          value)
-{
-  const FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+  switch (desc.Type())
+  {
+  case T_BOOL:
+    update_sorted_row_index<DBool>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
-  MarkRowModification(threadSafe ? &syncHolder : nullptr);
+  case T_CHAR:
+    update_sorted_row_index<DChar>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  auto s = value.GetStrategy();
-  LockGuard<Lock> _l(s->mLock);
+  case T_DATE:
+    update_sorted_row_index<DDate>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  if ( ! IS_ARRAY(desc.Type())
-      || (GET_BASE_TYPE(desc.Type()) != s->Type() && s->Count() != 0))
-  {
-    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
-  }
-  else if (row > mRowsCount)
-    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
+  case T_DATETIME:
+    update_sorted_row_index<DDateTime>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  uint64_t newFirstEntry = ~0;
-  uint64_t newFieldValueSize = 0;
-  const uint8_t bitsSet = ~0;
-  bool fieldValueWasNull = false;
-  const bool skipVariableStore = s->RawSize() < (2 * sizeof(uint64_t));
-  VariableSizeStore* const store = VSStore().get();
+  case T_HIRESTIME:
+    update_sorted_row_index<DHiresTime>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  if ( !skipVariableStore)
-  {
-    if (s->GetTemporalContainer().Size() == 0)
-    {
-      VariableSizeStore& arrayStore = s->GetRowStorage();
-      const uint64_t arrayFirstEntry = _SC(RowFieldArray&, *s).mFirstRecordEntry;
-      if ( &arrayStore == store)
-      {
-        arrayStore.IncrementRecordRef(arrayFirstEntry);
+  case T_INT8:
+    update_sorted_row_index<DInt8>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-        newFieldValueSize = s->RawSize() + RowFieldArray::METADATA_SIZE;
-        newFirstEntry = arrayFirstEntry;
-      }
-      else
-      {
-        newFieldValueSize = s->RawSize() + RowFieldArray::METADATA_SIZE;
-        newFirstEntry = store->AddRecord(arrayStore,
-                                         arrayFirstEntry,
-                                         0,
-                                         newFieldValueSize);
-      }
-    }
-    else
-    {
-      newFieldValueSize = s->RawSize();
+  case T_INT16:
+    update_sorted_row_index<DInt16>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-      uint8_t elemsCount[RowFieldArray::METADATA_SIZE];
-      store_le_int64(s->Count(), elemsCount);
+  case T_INT32:
+    update_sorted_row_index<DInt32>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-      newFirstEntry = store->AddRecord(elemsCount, sizeof elemsCount);
-      store->UpdateRecord(newFirstEntry,
-                          sizeof elemsCount,
-                          s->GetTemporalContainer(),
-                          0,
-                          newFieldValueSize);
-      newFieldValueSize += sizeof elemsCount;
-    }
-  }
+  case T_INT64:
+    update_sorted_row_index<DInt64>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  if (row == mRowsCount)
-    AddRow(true);
+  case T_UINT8:
+    update_sorted_row_index<DUInt8>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  StoredItem cachedItem = mRowCache.RetriveItem(row);
-  uint8_t * const rowData = cachedItem.GetDataForUpdate();
+  case T_UINT16:
+    update_sorted_row_index<DUInt16>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  uint8_t * const fieldFirstEntry = rowData + desc.RowDataOff();
-  uint8_t * const fieldValueSize = rowData + desc.RowDataOff() + sizeof(uint64_t);
+  case T_UINT32:
+    update_sorted_row_index<DUInt32>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  const uint_t byteOff = desc.NullBitIndex() / 8;
-  const uint8_t bitOff = desc.NullBitIndex() % 8;
+  case T_UINT64:
+    update_sorted_row_index<DUInt64>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  if ((rowData[byteOff] & (1 << bitOff)) != 0)
-    fieldValueWasNull = true;
+  case T_REAL:
+    update_sorted_row_index<DReal>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  if (fieldValueWasNull && (s->Count() == 0))
-    return;
+  case T_RICHREAL:
+    update_sorted_row_index<DRichReal>(indexTree, desc, row, oldRowData, newRowData);
+    break;
 
-  else if ((fieldValueWasNull == false) && (s->Count() == 0))
+  case T_TEXT:
   {
-    rowData[byteOff] |= (1 << bitOff);
+    const TextIndexPrefix oldValue = StoredTextPrefix(VSStore().get(), desc, oldRowData);
+    const TextIndexPrefix newValue = StoredTextPrefix(VSStore().get(), desc, newRowData);
 
-    if (rowData[byteOff] == bitsSet)
-      CheckRowToDelete(row);
-  }
-  else if (s->Count() != 0)
-  {
-    if (rowData[byteOff] == bitsSet)
-    {
-      assert(fieldValueWasNull == true);
+    if (oldValue == newValue)
+      break;
 
-      CheckRowToReuse(row);
-    }
-    rowData[byteOff] &= ~(1 << bitOff);
-  }
+    NODE_INDEX dummyNode;
+    KEY_INDEX dummyKey;
 
-  if ((fieldValueWasNull == false)
-      && ((load_le_int64(fieldValueSize) & 0x8000000000000000ull) == 0))
-  {
-    store->DecrementRecordRef(load_le_int64(fieldFirstEntry));
+    indexTree.RemoveKey(TextBTreeKey(oldValue, row));
+    indexTree.InsertKey(TextBTreeKey(newValue, row), &dummyNode, &dummyKey);
   }
+    break;
 
-  if (skipVariableStore)
-  {
-    assert(s->RawSize() < _SC(uint_t, Serializer::Size(T_HIRESTIME, true)));
-
-    store_le_int64((s->RawSize() | 0x80) << 56, fieldValueSize);
-    s->RawRead(0, s->RawSize(), rowData + desc.RowDataOff());
-  }
-  else
-  {
-    store_le_int64(newFieldValueSize, fieldValueSize);
-    store_le_int64(newFirstEntry, fieldFirstEntry);
+  default:
+    throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
   }
 }
 
 
-void
-PrototypeTable::Set(const ROW_INDEX       row,
-                    const FIELD_INDEX     field,
-                    const DBool&          value,
-                    const bool            skipThreadSafety)
+uint64_t
+PrototypeTable::LogSortedRow(const ROW_INDEX row, const uint8_t* const rowData)
 {
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
-
+  RedoLog* const log = TableRedoLog();
+  if (log == nullptr)
+    return 0;
 
-void
-PrototypeTable::Set(const ROW_INDEX      row,
-                    const FIELD_INDEX    field,
-                    const DChar&         value,
-                    const bool           skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
+  uint64_t lsn = 0;
+  for (FIELD_INDEX field = 0; field < mFieldsCount; ++field)
+  {
+    const FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+    const bool isNull = is_field_null(desc, rowData);
+    const uint8_t* const fieldData = rowData + desc.RowDataOff();
 
+    if (IS_ARRAY(desc.Type()) || (desc.Type() == T_TEXT))
+    {
+      StoredFieldRedoContent content( *VSStore(),
+                                     fieldData,
+                                     isNull,
+                                     IS_ARRAY(desc.Type())
+                                       ? RowFieldArray::METADATA_SIZE
+                                       : RowFieldText::CACHE_META_DATA_SIZE);
+
+      lsn = log->LogFieldValue(TableName(), row, field, desc.Type(), content);
+    }
+    else
+    {
+      const uint_t valueSize = Serializer::Size(_SC(DBS_FIELD_TYPE, desc.Type()), false);
+
+      lsn = log->LogFieldValue(TableName(),
+                               row,
+                               field,
+                               desc.Type(),
+                               isNull ? nullptr : fieldData,
+                               isNull ? 0 : valueSize);
+    }
+  }
 
-void
-PrototypeTable::Set(const ROW_INDEX       row,
-                    const FIELD_INDEX     field,
-                    const DDate&          value,
-                    const bool            skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
+  return lsn;
 }
 
 
-void
-PrototypeTable::Set(const ROW_INDEX       row,
-                    const FIELD_INDEX     field,
-                    const DDateTime&      value,
-                    const bool            skipThreadSafety)
+bool
+PrototypeTable::SelectFields(const FIELD_INDEX* const   fields,
+                             const FIELD_INDEX          fieldsCount,
+                             vector<FIELD_INDEX>&       outFields)
 {
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
+  bool variableFields = false;
 
+  if (fieldsCount == 0)
+  {
+    for (FIELD_INDEX field = 0; field < mFieldsCount; ++field)
+      outFields.push_back(field);
+  }
+  else
+    outFields.assign(fields, fields + fieldsCount);
 
-void
-PrototypeTable::Set(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    const DHiresTime&      value,
-                    const bool             skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
-
+  vector<bool> seenFields(mFieldsCount, false);
+  for (auto field : outFields)
+  {
+    if (field >= mFieldsCount)
+    {
+      throw DBSException(_EXTRA(DBSException::FIELD_NOT_FOUND),
+                         "Table field index is invalid %u(count %u).",
+                         field,
+                         mFieldsCount);
+    }
+    else if (seenFields[field])
+    {
+      throw DBSException(_EXTRA(DBSException::INVALID_PARAMETERS),
+                         "Field '%s' is specified twice.",
+                         DescribeField(field).name);
+    }
 
-void
-PrototypeTable::Set(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    const DInt8&           value,
-                    const bool             skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
+    const DBSFieldDescriptor fd = DescribeField(field);
 
+    seenFields[field] = true;
+    variableFields |= fd.isArray || (fd.type == T_TEXT);
+  }
 
-void
-PrototypeTable::Set(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    const DInt16&          value,
-                    const bool             skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
+  return variableFields;
 }
 
 
-void
-PrototypeTable::Set(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    const DInt32&          value,
-                    const bool             skipThreadSafety)
+ROW_INDEX
+PrototypeTable::ExportRows(const char* const          file,
+                           const FIELD_INDEX* const   fields,
+                           const FIELD_INDEX          fieldsCount)
 {
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
+  vector<FIELD_INDEX> exportedFields;
+  const bool variableFields = SelectFields(fields, fieldsCount, exportedFields);
 
+  vector<const char*> names;
+  for (auto field : exportedFields)
+    names.push_back(DescribeField(field).name);
 
-void
-PrototypeTable::Set(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    const DInt64&          value,
-                    const bool             skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
+  //The rows are not changed while they are exported, so the file holds a
+  //consistent snapshot of the table.
+  LockGuard<Lock> syncHolder(mRowsSync);
 
+  VariableSizeStoreSPtr vsStore = variableFields ? VSStore() : VariableSizeStoreSPtr();
+  ColumnsExporter exporter(file,
+                           &GetFieldDescriptorInternal(0),
+                           exportedFields.data(),
+                           names.data(),
+                           exportedFields.size(),
+                           mRowSize,
+                           vsStore.get(),
+                           DBSGetSeettings().mExportThreads);
 
-void
-PrototypeTable::Set(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    const DReal&           value,
-                    const bool             skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
+  for (ROW_INDEX row = 0; row < mRowsCount; ++row)
+  {
+    StoredItem cachedItem = mRowCache.RetriveItem(row);
+    const uint8_t* const rowData = cachedItem.GetDataForRead();
 
+    if ( ! IsRowNull(rowData))
+      exporter.AddRow(row, rowData);
+  }
 
-void
-PrototypeTable::Set(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    const DRichReal&       value,
-                    const bool             skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
+  return exporter.Finish();
 }
 
 
-void
-PrototypeTable::Set(const ROW_INDEX       row,
-                    const FIELD_INDEX     field,
-                    const DUInt8&         value,
-                    const bool            skipThreadSafety)
+DBSFieldStats
+PrototypeTable::GetFieldStats(const FIELD_INDEX field)
 {
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
+  LockGuard<Lock> syncHolder(mRowsSync);
 
+  const FieldDescriptor& fd = GetFieldDescriptorInternal(field);
 
-void
-PrototypeTable::Set(const ROW_INDEX      row,
-                    const FIELD_INDEX    field,
-                    const DUInt16&       value,
-                    const bool           skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
+  auto cached = mFieldsStats.find(field);
+  if ((cached != mFieldsStats.end())
+      && (mUpdatesCount - cached->second.mUpdatesCount <= mRowsCount / 10))
+  {
+    return cached->second.mStats;
+  }
+
+  FieldStatsCollector collector(fd, mRowsCount);
+  for (ROW_INDEX row = 0; row < mRowsCount; ++row)
+  {
+    StoredItem cachedItem = mRowCache.RetriveItem(row);
+    const uint8_t* const rowData = cachedItem.GetDataForRead();
 
+    if ( ! IsRowNull(rowData))
+      collector.AddRow(rowData);
+  }
 
-void
-PrototypeTable::Set(const ROW_INDEX      row,
-                    const FIELD_INDEX    field,
-                    const DUInt32&       value,
-                    const bool           skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
+  CachedFieldStats& entry = mFieldsStats[field];
 
+  entry.mUpdatesCount = mUpdatesCount;
+  entry.mStats = collector.Result();
 
-void
-PrototypeTable::Set(const ROW_INDEX      row,
-                    const FIELD_INDEX    field,
-                    const DUInt64&       value,
-                    const bool           skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
+  return entry.mStats;
 }
 
 
-void
-PrototypeTable::Set(const ROW_INDEX      row,
-                    const FIELD_INDEX    field,
-                    const DText&         value,
-                    const bool           skipThreadSafety)
+ROW_INDEX
+PrototypeTable::LoadRows(const char* const          file,
+                         const DBS_LOAD_FORMAT      format,
+                         const FIELD_INDEX* const   fields,
+                         const FIELD_INDEX          fieldsCount)
 {
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
+  vector<FIELD_INDEX> loadedFields;
+  const bool variableFields = SelectFields(fields, fieldsCount, loadedFields);
 
-void
-PrototypeTable::Set(const ROW_INDEX      row,
-                    const FIELD_INDEX    field,
-                    const DArray&        value,
-                    const bool           skipThreadSafety)
-{
-  StoreEntry(row, field, ! skipThreadSafety, value);
-}
+  LockGuard<Lock> syncHolder(mRowsSync);
 
+  //The database is marked as updated once for all the loaded rows.
+  MarkRowModification(&syncHolder);
 
-shared_ptr<ITextStrategy>
-allocate_row_field_text(VariableSizeStoreSPtr store,
-                        const uint64_t        firstRecordEntry,
-                        const uint64_t        valueSize)
-{
-  shared_ptr<ITextStrategy> result = shared_make(RowFieldText,
-                                                 store,
-                                                 firstRecordEntry,
-                                                 valueSize);
-  result->SetSelfReference(result);
-  return result;
-}
+  VariableSizeStoreSPtr vsStore = variableFields ? VSStore() : VariableSizeStoreSPtr();
+  RowsLoader loader(file,
+                    format,
+                    &GetFieldDescriptorInternal(0),
+                    mFieldsCount,
+                    loadedFields.data(),
+                    loadedFields.size(),
+                    mRowSize,
+                    vsStore.get(),
+                    DBSGetSeettings().mLoadThreads);
 
+  const ROW_INDEX firstRow = mRowsCount;
+  ROW_INDEX loadedRows = 0;
+  vector<ROW_INDEX> nullRows;
 
-static shared_ptr<IArrayStrategy>
-allocate_row_field_array(VariableSizeStoreSPtr store,
-                         const uint64_t        firstRecordEntry,
-                         const DBS_FIELD_TYPE  type)
-{
-  shared_ptr<IArrayStrategy> r = shared_make(RowFieldArray,
-                                             store,
-                                             firstRecordEntry,
-                                             type);
-  r->SetSelfReference(r);
-  return r;
-}
+  mRowCache.FlushItem(mRowsCount - 1);
 
+  try
+  {
+    while (loader.NextBatch())
+    {
+      const ROW_INDEX batchRows = loader.BatchRowsCount();
+      const uint8_t* const rows = loader.BatchRows();
 
-template <class T> void
-PrototypeTable::RetrieveEntry(const ROW_INDEX   row,
-                              const FIELD_INDEX field,
-                              const bool        threadSafe,
-                              T&                outValue)
-{
-  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
+      try
+      {
+        RowsContainer().Write((firstRow + loadedRows) * mRowSize,
+                              batchRows * mRowSize,
+                              rows);
+      }
+      catch (...)
+      {
+        loader.ReleaseBatch();
+        throw;
+      }
 
-  const FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+      for (ROW_INDEX row = 0; row < batchRows; ++row)
+      {
+        if (IsRowNull(rows + row * mRowSize))
+          nullRows.push_back(firstRow + loadedRows + row);
+      }
 
-  if ((desc.Type() & PS_TABLE_ARRAY_MASK)
-      || ((desc.Type() & PS_TABLE_FIELD_TYPE_MASK) != _SC(uint_t, outValue.DBSType())))
+      loadedRows += batchRows;
+    }
+  }
+  catch (...)
   {
-    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+    DiscardLoadedRows(firstRow, loadedRows);
+    throw;
   }
 
-  const uint_t byteOff = desc.NullBitIndex() / 8;
-  const uint8_t bitOff = desc.NullBitIndex() % 8;
-
-  if (row >= mRowsCount)
-    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
+  NODE_INDEX dummyNode;
+  KEY_INDEX dummyKey;
+  BTree removedRows(*this);
+  size_t removedKeys = 0;
 
-  StoredItem cachedItem = mRowCache.RetriveItem(row);
-  const uint8_t* const rowData = cachedItem.GetDataForRead();
+  LockGuard<Lock> syncHolder2(mIndexesSync);
 
-  if (rowData[byteOff] & (1 << bitOff))
-    outValue = T();
+  try
+  {
+    for (; removedKeys < nullRows.size(); ++removedKeys)
+      removedRows.InsertKey(TableRmKey(nullRows[removedKeys]), &dummyNode, &dummyKey);
 
-  else
+    //The indexes are updated once all the rows are in, not for every value.
+    try
+    {
+      IndexLoadedRows(firstRow, loadedRows);
+    }
+    catch (...)
+    {
+      //The rows not indexed yet have no keys to remove, which is fine.
+      IndexLoadedRows(firstRow, loadedRows, true);
+      throw;
+    }
+  }
+  catch (...)
   {
-    outValue.~T();
-    Serializer::Load(rowData + desc.RowDataOff(), &outValue);
+    for (size_t i = 0; i < removedKeys; ++i)
+      removedRows.RemoveKey(TableRmKey(nullRows[i]));
+
+    DiscardLoadedRows(firstRow, loadedRows);
+    throw;
   }
-}
 
+  mRowsCount += loadedRows;
+  mRowCache.RefreshItem(firstRow);
 
-template <> void
-PrototypeTable::RetrieveEntry(const ROW_INDEX   row,
-                              const FIELD_INDEX field,
-                              const bool        threadSafe,
-                              DText&            outValue)
-{
-  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
+  //The loaded rows are not recorded by the redo log, so make them durable now.
+  FlushInternal();
 
-  const FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+  return loadedRows;
+}
 
-  if (row >= mRowsCount)
-    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
 
-  if (IS_ARRAY(desc.Type()) || (GET_BASE_TYPE(desc.Type()) != T_TEXT))
+void
+PrototypeTable::IndexLoadedRows(const ROW_INDEX   firstRow,
+                                const ROW_INDEX   rowsCount,
+                                const bool        removeValues)
+{
+  bool indexed = false;
+  for (FIELD_INDEX field = 0; field < mFieldsCount; ++field)
   {
-    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
-  }
+    if ( ! HasIndex(field))
+      continue;
 
-  StoredItem cachedItem = mRowCache.RetriveItem(row);
-  const uint8_t* const rowData = cachedItem.GetDataForRead();
+    const FieldDescriptor& fd = GetFieldDescriptorInternal(field);
+    while (fd.IsAcquired())
+      wh_yield();
 
-  const uint64_t fieldValueSize = load_le_int64(rowData + desc.RowDataOff() + sizeof(uint64_t));
-  const uint_t byteOff = desc.NullBitIndex() / 8;
-  const uint8_t bitOff = desc.NullBitIndex() % 8;
+    indexed = true;
+  }
 
-  if (rowData[byteOff] & (1 << bitOff))
-    outValue = DText();
+  if ( ! indexed && mvCompositeIndexes.empty())
+    return;
 
-  else if ((fieldValueSize & 0x8000000000000000ull) != 0)
-  {
-    assert(((fieldValueSize >> 56) & 0x7F) > 0);
-    assert(((fieldValueSize >> 56) & 0x7F) < Serializer::Size(T_TEXT, false));
+  const ROW_INDEX chunkRows = MAX(LOAD_CHUNK_SIZE / mRowSize, 1u);
+  unique_ptr<uint8_t[]> chunk(unique_array_make(uint8_t, chunkRows * mRowSize));
 
-    outValue = DText(rowData + desc.RowDataOff(), (fieldValueSize >> 56) & 0x7F);
-  }
-  else
+  for (ROW_INDEX row = 0; row < rowsCount; row += chunkRows)
   {
-    const uint64_t fieldFirstEntry = load_le_int64(rowData + desc.RowDataOff());
-    outValue = DText(allocate_row_field_text(VSStore(), fieldFirstEntry, fieldValueSize));
+    const ROW_INDEX count = MIN(chunkRows, rowsCount - row);
+
+    RowsContainer().Read((firstRow + row) * mRowSize, count * mRowSize, chunk.get());
+    for (ROW_INDEX i = 0; i < count; ++i)
+    {
+      index_row_values(mvIndexNodeMgrs,
+                       &GetFieldDescriptorInternal(0),
+                       mFieldsCount,
+                       firstRow + row + i,
+                       chunk.get() + i * mRowSize,
+                       VSStore().get(),
+                       removeValues);
+      hash_row_values(mvHashIndexes,
+                      &GetFieldDescriptorInternal(0),
+                      mFieldsCount,
+                      firstRow + row + i,
+                      chunk.get() + i * mRowSize,
+                      VSStore().get(),
+                      removeValues);
+      bitmap_row_values(mvBitmapIndexes,
+                        &GetFieldDescriptorInternal(0),
+                        mFieldsCount,
+                        firstRow + row + i,
+                        chunk.get() + i * mRowSize,
+                        VSStore().get(),
+                        removeValues);
+      composite_row_values(mvCompositeIndexes,
+                           &GetFieldDescriptorInternal(0),
+                           firstRow + row + i,
+                           chunk.get() + i * mRowSize,
+                           removeValues);
+    }
   }
 }
 
 
-template <> void
-PrototypeTable::RetrieveEntry(const ROW_INDEX   row,
-                              const FIELD_INDEX field,
-                              const bool        threadSafe,
-                              DArray&           outValue)
+void
+PrototypeTable::DiscardLoadedRows(const ROW_INDEX firstRow, const ROW_INDEX rowsCount)
 {
-  LockGuard<Lock> syncHolder(mRowsSync, !threadSafe);
+  IDataContainer& rowsData = RowsContainer();
 
-  const FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+  bool variableFields = false;
+  for (FIELD_INDEX field = 0; field < mFieldsCount; ++field)
+  {
+    const DBSFieldDescriptor fd = DescribeField(field);
+    variableFields |= fd.isArray || (fd.type == T_TEXT);
+  }
 
-  if (row >= mRowsCount)
-    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
+  if (variableFields && (rowsCount > 0))
+  {
+    VariableSizeStoreSPtr vsStore = VSStore();
 
-  if ( !IS_ARRAY(desc.Type())
-      || ((GET_BASE_TYPE(desc.Type()) != outValue.Type()) && !outValue.IsNull()))
+    const ROW_INDEX chunkRows = MAX(LOAD_CHUNK_SIZE / mRowSize, 1u);
+    unique_ptr<uint8_t[]> chunk(unique_array_make(uint8_t, chunkRows * mRowSize));
+
+    for (ROW_INDEX row = 0; row < rowsCount; row += chunkRows)
+    {
+      const ROW_INDEX count = MIN(chunkRows, rowsCount - row);
+
+      rowsData.Read((firstRow + row) * mRowSize, count * mRowSize, chunk.get());
+      RowsLoader::ReleaseRowsValues(&GetFieldDescriptorInternal(0),
+                                    mFieldsCount,
+                                    chunk.get(),
+                                    count,
+                                    mRowSize,
+                                    *vsStore);
+    }
+  }
+
+  if (rowsData.Size() > firstRow * mRowSize)
+    rowsData.Colapse(firstRow * mRowSize, rowsData.Size());
+}
+
+
+bool
+PrototypeTable::IsRowNull(const uint8_t* const rowData) const
+{
+  //The null bits are not all packed at the row start if the table was altered,
+  //but the unused bits of their bytes are always set.
+  for (FIELD_INDEX index = 0; index < mFieldsCount; ++index)
   {
-    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+    const FieldDescriptor& fieldDesc = GetFieldDescriptorInternal(index);
+    const uint8_t bitsSet = ~0;
+
+    if (rowData[fieldDesc.NullBitIndex() / 8] != bitsSet)
+      return false;
   }
 
-  StoredItem cachedItem = mRowCache.RetriveItem(row);
-  const uint8_t * const rowData = cachedItem.GetDataForRead();
+  return true;
+}
 
-  const uint64_t fieldValueSize = load_le_int64(rowData + desc.RowDataOff() + sizeof(uint64_t));
 
-  const uint_t byteOff = desc.NullBitIndex() / 8;
-  const uint8_t bitOff = desc.NullBitIndex() % 8;
+void
+PrototypeTable::RewriteSortedRows(const ROW_INDEX                 from,
+                                  const vector<ROW_INDEX>&        sortedRows,
+                                  LockGuard<Lock>&                syncHolder)
+{
+  MarkRowModification( &syncHolder);
 
-  if (rowData[byteOff] & (1 << bitOff))
+  //Get the new content of the rows first, as the rows are moved around.
+  TemporalContainer newRows;
+  for (ROW_INDEX r = 0; r < sortedRows.size(); ++r)
   {
-    switch (GET_BASE_TYPE(desc.Type()))
-    {
-    case T_BOOL:
-      outValue = DArray(_SC(DBool *, nullptr));
-      break;
+    StoredItem cachedItem = mRowCache.RetriveItem(sortedRows[r]);
+    newRows.Write(r * mRowSize, mRowSize, cachedItem.GetDataForRead());
+  }
 
-    case T_CHAR:
-      outValue = DArray(_SC(DChar *, nullptr));
-      break;
+  vector<FIELD_INDEX> indexedFields;
+  for (FIELD_INDEX field = 0; field < mFieldsCount; ++field)
+  {
+    if ( ! HasIndex(field))
+      continue;
 
-    case T_DATE:
-      outValue = DArray(_SC(DDate *, nullptr));
-      break;
+    ApplyPendingIndexKeys(field, true);
+    AcquireFieldIndex( &GetFieldDescriptorInternal(field));
+    indexedFields.push_back(field);
+  }
 
-    case T_DATETIME:
-      outValue = DArray(_SC(DDateTime *, nullptr));
-      break;
+  unique_ptr<uint8_t[]> newRowData(new uint8_t[mRowSize]);
+  uint64_t lsn = 0;
 
-    case T_HIRESTIME:
-      outValue = DArray(_SC(DHiresTime *, nullptr));
-      break;
+  try
+  {
+    for (ROW_INDEX r = 0; r < sortedRows.size(); ++r)
+    {
+      const ROW_INDEX row = from + r;
 
-    case T_UINT8:
-      outValue = DArray(_SC(DUInt8 *, nullptr));
-      break;
+      if (sortedRows[r] == row)
+        continue;
 
-    case T_UINT16:
-      outValue = DArray(_SC(DUInt16 *, nullptr));
-      break;
+      newRows.Read(r * mRowSize, mRowSize, newRowData.get());
 
-    case T_UINT32:
-      outValue = DArray(_SC(DUInt32 *, nullptr));
-      break;
+      StoredItem cachedItem = mRowCache.RetriveItem(row);
+      uint8_t* const rowData = cachedItem.GetDataForUpdate();
 
-    case T_UINT64:
-      outValue = DArray(_SC(DUInt64 *, nullptr));
-      break;
+      for (auto field : indexedFields)
+        UpdateSortedRowIndex(field, row, rowData, newRowData.get());
 
-    case T_REAL:
-      outValue = DArray(_SC(DReal *, nullptr));
-      break;
+      for (const auto& index : mvCompositeIndexes)
+      {
+        const FieldDescriptor* const fds = &GetFieldDescriptorInternal(0);
 
-    case T_RICHREAL:
-      outValue = DArray(_SC(DRichReal *, nullptr));
-      break;
+        update_composite_key( *index.mNodeMgr,
+                             row,
+                             composite_row_key(fds, index.mFields, rowData),
+                             composite_row_key(fds, index.mFields, newRowData.get()));
+      }
 
-    case T_INT8:
-      outValue = DArray(_SC(DInt8 *, nullptr));
-      break;
+      //The values are moved between rows, so their references stay the same.
+      const bool wasNull = IsRowNull(rowData);
+      const bool isNull = IsRowNull(newRowData.get());
 
-    case T_INT16:
-      outValue = DArray(_SC(DInt16 *, nullptr));
-      break;
+      if (wasNull && ! isNull)
+        CheckRowToReuse(row);
 
-    case T_INT32:
-      outValue = DArray(_SC(DInt32 *, nullptr));
-      break;
+      memcpy(rowData, newRowData.get(), mRowSize);
 
-    case T_INT64:
-      outValue = DArray(_SC(DInt64 *, nullptr));
-      break;
+      if (isNull && ! wasNull)
+        CheckRowToDelete(row);
 
-    default:
-      assert(false);
+      lsn = LogSortedRow(row, rowData);
     }
   }
-  else if ((fieldValueSize & 0x8000000000000000ull) != 0)
+  catch (...)
   {
-    shared_ptr<IArrayStrategy> strategy = shared_make(TemporalArray, GET_BASE_TYPE(desc.Type()));
-    strategy->SetSelfReference(strategy);
-
-    assert(((fieldValueSize >> 56) & 0x7F) > 0);
-    assert(((fieldValueSize >> 56) & 0x7F) < Serializer::Size(T_BOOL, true));
+    for (auto field : indexedFields)
+      ReleaseIndexField( &GetFieldDescriptorInternal(field));
 
-    const uint64_t size = (fieldValueSize >> 56) & 0x7F;
-    strategy->RawWrite(0, size, rowData + desc.RowDataOff());
-    strategy->mElementsCount = size / strategy->mElementRawSize;
-    outValue = DArray(strategy);
-  }
-  else
-  {
-    const uint64_t fieldFirstEntry = load_le_int64(rowData + desc.RowDataOff());
-    outValue = DArray(allocate_row_field_array(VSStore(),
-                                               fieldFirstEntry,
-                                               _SC(DBS_FIELD_TYPE,
-                                                   desc.Type() & PS_TABLE_FIELD_TYPE_MASK)));
+    throw;
   }
-}
 
+  for (auto field : indexedFields)
+    ReleaseIndexField( &GetFieldDescriptorInternal(field));
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DBool&                 outValue,
-                    const bool             skipThreadSafety)
-{
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+  CommitUpdate(lsn);
 }
 
 
-void
-PrototypeTable::Get(const ROW_INDEX      row,
-                    const FIELD_INDEX    field,
-                    DChar&               outValue,
-                    const bool             skipThreadSafety)
+DArray
+PrototypeTable::MatchRows(const DBool&       min,
+                          const DBool&       max,
+                          const ROW_INDEX    fromRow,
+                          const ROW_INDEX    toRow,
+                          const FIELD_INDEX  field)
 {
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
-}
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
 
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DDate&                 outValue,
-                    const bool             skipThreadSafety)
-{
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DDateTime&             outValue,
-                    const bool             skipThreadSafety)
+DArray
+PrototypeTable::MatchRows(const DChar&         min,
+                           const DChar&         max,
+                           const ROW_INDEX      fromRow,
+                           const ROW_INDEX      toRow,
+                           const FIELD_INDEX    field)
 {
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
-}
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
 
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DHiresTime&            outValue,
-                    const bool             skipThreadSafety)
-{
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DInt8&                 outValue,
-                    const bool             skipThreadSafety)
+DArray
+PrototypeTable::MatchRows(const DDate&         min,
+                          const DDate&         max,
+                          const ROW_INDEX      fromRow,
+                          const ROW_INDEX      toRow,
+                          const FIELD_INDEX    field)
 {
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
-}
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
 
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DInt16&                outValue,
-                    const bool             skipThreadSafety)
-{
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DInt32&                outValue,
-                    const bool             skipThreadSafety)
+DArray
+PrototypeTable::MatchRows(const DDateTime&     min,
+                          const DDateTime&     max,
+                          const ROW_INDEX      fromRow,
+                          const ROW_INDEX      toRow,
+                          const FIELD_INDEX    field)
 {
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
-}
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
 
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DInt64&                outValue,
-                    const bool             skipThreadSafety)
-{
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DReal&                 outValue,
-                    const bool             skipThreadSafety)
+DArray
+PrototypeTable::MatchRows(const DHiresTime&     min,
+                          const DHiresTime&     max,
+                          const ROW_INDEX       fromRow,
+                          const ROW_INDEX       toRow,
+                          const FIELD_INDEX     field)
 {
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
-}
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
 
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DRichReal&             outValue,
-                    const bool             skipThreadSafety)
-{
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DUInt8&                outValue,
-                    const bool             skipThreadSafety)
+DArray
+PrototypeTable::MatchRows(const DUInt8&        min,
+                          const DUInt8&        max,
+                          const ROW_INDEX      fromRow,
+                          const ROW_INDEX      toRow,
+                          const FIELD_INDEX    field)
 {
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
+
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DUInt16&               outValue,
-                    const bool             skipThreadSafety)
+DArray
+PrototypeTable::MatchRows(const DUInt16&       min,
+                          const DUInt16&       max,
+                          const ROW_INDEX      fromRow,
+                          const ROW_INDEX      toRow,
+                          const FIELD_INDEX    field)
 {
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
+
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DUInt32&               outValue,
-                    const bool             skipThreadSafety)
+DArray
+PrototypeTable::MatchRows(const DUInt32&       min,
+                          const DUInt32&       max,
+                          const ROW_INDEX      fromRow,
+                          const ROW_INDEX      toRow,
+                          const FIELD_INDEX    field)
 {
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
+
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DUInt64&               outValue,
-                    const bool             skipThreadSafety)
+DArray
+PrototypeTable::MatchRows(const DUInt64&       min,
+                          const DUInt64&       max,
+                          const ROW_INDEX      fromRow,
+                          const ROW_INDEX      toRow,
+                          const FIELD_INDEX    field)
 {
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
+
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DText&                 outValue,
-                    const bool             skipThreadSafety)
+DArray
+PrototypeTable::MatchRows(const DInt8&         min,
+                          const DInt8&         max,
+                          const ROW_INDEX      fromRow,
+                          const ROW_INDEX      toRow,
+                          const FIELD_INDEX    field)
 {
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
-}
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
 
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
 
-void
-PrototypeTable::Get(const ROW_INDEX        row,
-                    const FIELD_INDEX      field,
-                    DArray&                outValue,
-                    const bool             skipThreadSafety)
-{
-  RetrieveEntry(row, field, ! skipThreadSafety, outValue);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
 
-template<typename T> void
-PrototypeTable::table_exchange_rows(const FIELD_INDEX field,
-                                    const ROW_INDEX row1,
-                                    const ROW_INDEX row2)
+DArray
+PrototypeTable::MatchRows(const DInt16&        min,
+                          const DInt16&        max,
+                          const ROW_INDEX      fromRow,
+                          const ROW_INDEX      toRow,
+                          const FIELD_INDEX    field)
 {
-  T row1Value, row2Value;
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
 
-  assert(row1 < AllocatedRows());
-  assert(row2 < AllocatedRows());
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
 
-  Get(row1, field, row1Value, true);
-  Get(row2, field, row2Value, true);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
 
-  Set(row1, field, row2Value, true);
-  Set(row2, field, row1Value, true);
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
 
-void
-PrototypeTable::ExchangeRows(const ROW_INDEX    row1,
-                             const ROW_INDEX    row2,
-                             const bool         skipTthreadSafety)
+DArray
+PrototypeTable::MatchRows(const DInt32&       min,
+                          const DInt32&       max,
+                          const ROW_INDEX     fromRow,
+                          const ROW_INDEX     toRow,
+                          const FIELD_INDEX   field)
 {
-  LockGuard<Lock> _l(mRowsSync, skipTthreadSafety);
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
 
-  const ROW_INDEX allocatedRows = AllocatedRows();
-  const FIELD_INDEX fieldsCount = FieldsCount();
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
 
-  if ((allocatedRows <= row1) || (allocatedRows <= row2))
-    throw DBSException(_EXTRA(DBSException::ROW_NOT_ALLOCATED));
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
 
-  if (row1 == row2)
-    return ;
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
+}
 
-  for (FIELD_INDEX field = 0; field < fieldsCount; ++field)
-  {
-    const DBSFieldDescriptor fieldDesc = DescribeField(field);
 
-    if (fieldDesc.isArray)
-      table_exchange_rows<DArray>(field, row1, row2);
+DArray
+PrototypeTable::MatchRows(const DInt64&       min,
+                          const DInt64&       max,
+                          const ROW_INDEX     fromRow,
+                          const ROW_INDEX     toRow,
+                          const FIELD_INDEX   field)
+{
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
 
-    else
-    {
-      switch (fieldDesc.type)
-      {
-      case T_BOOL:
-        table_exchange_rows<DBool>(field, row1, row2);
-        break;
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
 
-      case T_CHAR:
-        table_exchange_rows<DChar>(field, row1, row2);
-        break;
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
 
-      case T_DATE:
-        table_exchange_rows<DDate>(field, row1, row2);
-        break;
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
+}
 
-      case T_DATETIME:
-        table_exchange_rows<DDateTime>(field, row1, row2);
-        break;
 
-      case T_HIRESTIME:
-        table_exchange_rows<DHiresTime>(field, row1, row2);
-        break;
+DArray
+PrototypeTable::MatchRows(const DReal&        min,
+                          const DReal&        max,
+                          const ROW_INDEX     fromRow,
+                          const ROW_INDEX     toRow,
+                          const FIELD_INDEX   field)
+{
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
 
-      case T_INT8:
-        table_exchange_rows<DInt8>(field, row1, row2);
-        break;
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
 
-      case T_INT16:
-        table_exchange_rows<DInt16>(field, row1, row2);
-        break;
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
 
-      case T_INT32:
-        table_exchange_rows<DInt32>(field, row1, row2);
-        break;
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
+}
 
-      case T_INT64:
-        table_exchange_rows<DInt64>(field, row1, row2);
-        break;
 
-      case T_UINT8:
-        table_exchange_rows<DUInt8>(field, row1, row2);
-        break;
+DArray
+PrototypeTable::MatchRows(const DRichReal&    min,
+                          const DRichReal&    max,
+                          const ROW_INDEX     fromRow,
+                          const ROW_INDEX     toRow,
+                          const FIELD_INDEX   field)
+{
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<DArray>(min, max, fromRow, toRow, field);
 
-      case T_UINT16:
-        table_exchange_rows<DUInt16>(field, row1, row2);
-        break;
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field).ToArray();
 
-      case T_UINT32:
-        table_exchange_rows<DUInt32>(field, row1, row2);
-        break;
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
 
-      case T_UINT64:
-        table_exchange_rows<DUInt64>(field, row1, row2);
-        break;
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
+}
 
-      case T_REAL:
-        table_exchange_rows<DReal>(field, row1, row2);
-        break;
 
-      case T_RICHREAL:
-        table_exchange_rows<DRichReal>(field, row1, row2);
-        break;
+DArray
+PrototypeTable::MatchRows(const DText&        min,
+                          const DText&        max,
+                          const ROW_INDEX     fromRow,
+                          const ROW_INDEX     toRow,
+                          const FIELD_INDEX   field)
+{
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchTextRowsWithIndex(min, max, fromRow, toRow, field).ToArray();
 
-      case T_TEXT:
-        table_exchange_rows<DText>(field, row1, row2);
-        break;
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<DArray>(min, max, fromRow, toRow, field);
 
-      default:
-        throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
-      }
-    }
-  }
+  return MatchRowsNoIndex<DArray>(min, max, fromRow, toRow, field);
 }
 
-template<typename TF> class
-SortTableContainer
+
+static void
+add_matched_row(DArray& rows, const ROW_INDEX row)
 {
-public:
-  SortTableContainer(PrototypeTable& table, const FIELD_INDEX field)
-    : mTable(table),
-      mField(field)
-  {
-    mRowsPermutation.resize(table.AllocatedRows());
-    for (ROW_INDEX i = 0; i < mRowsPermutation.size(); ++i)
-      mRowsPermutation[i] = i;
-  }
+  rows.Add(DROW_INDEX(row));
+}
 
-  ~SortTableContainer()
-  {
-    ROW_INDEX row = 0;
-    while (row < mRowsPermutation.size())
-    {
-      if (mRowsPermutation[row] == row)
-      {
-        ++row;
-        continue;
-      }
 
-      ROW_INDEX currentRow = row;
-      do
-      {
-        const ROW_INDEX correctRow = mRowsPermutation[currentRow];
-        if (correctRow == row)
-        {
-          mRowsPermutation[currentRow] = currentRow;
-          break;
-        }
+static void
+add_matched_row(RowsSet& rows, const ROW_INDEX row)
+{
+  rows.Add(row);
+}
 
-        mTable.ExchangeRows(currentRow, correctRow, true);
-        mRowsPermutation[currentRow] = currentRow;
 
-        currentRow = correctRow;
-      } while (true);
-    }
-  }
-  const TF operator[] (const int64_t index) const
-  {
-    TF value;
-    mTable.Get(mRowsPermutation[index], mField, value, true);
+RowsSet
+PrototypeTable::MatchRowsSet(const DBool&        min,
+                             const DBool&        max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
+{
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
 
-    return value;
-  }
-  void Exchange(const int64_t pos1, const int64_t pos2)
-  {
-    const ROW_INDEX t      = mRowsPermutation[pos1];
-    mRowsPermutation[pos1] = mRowsPermutation[pos2];
-    mRowsPermutation[pos2] = t;
-  }
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  uint64_t Count() const { return mRowsPermutation.size(); }
-  void Pivot(const uint64_t index) { mTable.Get(mRowsPermutation[index], mField, mPivot, true); }
-  const TF& Pivot() const { return mPivot; }
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
 
-private:
-  PrototypeTable&           mTable;
-  std::vector<ROW_INDEX>    mRowsPermutation;
-  const FIELD_INDEX         mField;
-  TF                        mPivot;
-};
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
+}
 
 
-void
-PrototypeTable::Sort(const FIELD_INDEX field,
-                        const ROW_INDEX fromRow,
-                        const ROW_INDEX toRow,
-                        const bool reverse)
+RowsSet
+PrototypeTable::MatchRowsSet(const DChar&        min,
+                             const DChar&        max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
-  const DBSFieldDescriptor fd = DescribeField(field);
-
-  if (fd.isArray)
-  {
-    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID),
-                       "This implementation does not sort array fields.");
-  }
-
-  LockGuard<Lock> _l(mRowsSync);
-
-  const ROW_INDEX from = MIN(fromRow, toRow);
-  const ROW_INDEX to = MIN(MAX(fromRow, toRow), AllocatedRows() - 1);
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
 
-  if (from > to)
-    throw DBSException(_EXTRA(DBSException::INVALID_PARAMETERS));
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  else
-    if (from == to)
-      return;
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
 
-  switch (fd.type)
-  {
-  case T_BOOL:
-  {
-    SortTableContainer<DBool> temp( *this, field);
-    quick_sort<DBool, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
+}
 
-  case T_CHAR:
-  {
-    SortTableContainer<DChar> temp( *this, field);
-    quick_sort<DChar, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
 
-  case T_DATE:
-  {
-    SortTableContainer<DDate> temp( *this, field);
-    quick_sort<DDate, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+RowsSet
+PrototypeTable::MatchRowsSet(const DDate&        min,
+                             const DDate&        max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
+{
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
 
-  case T_DATETIME:
-  {
-    SortTableContainer<DDateTime> temp( *this, field);
-    quick_sort<DDateTime, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  case T_HIRESTIME:
-  {
-    SortTableContainer<DHiresTime> temp( *this, field);
-    quick_sort<DHiresTime, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
 
-  case T_UINT8:
-  {
-    SortTableContainer<DUInt8> temp( *this, field);
-    quick_sort<DUInt8, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
+}
 
-  case T_UINT16:
-  {
-    SortTableContainer<DUInt16> temp( *this, field);
-    quick_sort<DUInt16, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
 
-  case T_UINT32:
-  {
-    SortTableContainer<DUInt32> temp( *this, field);
-    quick_sort<DUInt32, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+RowsSet
+PrototypeTable::MatchRowsSet(const DDateTime&    min,
+                             const DDateTime&    max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
+{
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
 
-  case T_UINT64:
-  {
-    SortTableContainer<DUInt64> temp( *this, field);
-    quick_sort<DUInt64, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  case T_REAL:
-  {
-    SortTableContainer<DReal> temp( *this, field);
-    quick_sort<DReal, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
 
-  case T_RICHREAL:
-  {
-    SortTableContainer<DRichReal> temp( *this, field);
-    quick_sort<DRichReal, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
+}
 
-  case T_INT8:
-  {
-    SortTableContainer<DInt8> temp( *this, field);
-    quick_sort<DInt8, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
 
-  case T_INT16:
-  {
-    SortTableContainer<DInt16> temp( *this, field);
-    quick_sort<DInt16, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+RowsSet
+PrototypeTable::MatchRowsSet(const DHiresTime&   min,
+                             const DHiresTime&   max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
+{
+  if (mvIndexNodeMgrs[field] != nullptr)
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
 
-  case T_INT32:
-  {
-    SortTableContainer<DInt32> temp( *this, field);
-    quick_sort<DInt32, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  case T_INT64:
-  {
-    SortTableContainer<DInt64> temp( *this, field);
-    quick_sort<DInt64, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
-  case T_TEXT:
-  {
-    SortTableContainer<DText> temp( *this, field);
-    quick_sort<DText, decltype(temp)>(from, to, reverse, temp);
-  }
-    break;
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
 
-  default:
-    throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
-  }
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DBool&       min,
-                          const DBool&       max,
-                          const ROW_INDEX    fromRow,
-                          const ROW_INDEX    toRow,
-                          const FIELD_INDEX  field)
+RowsSet
+PrototypeTable::MatchRowsSet(const DUInt8&       min,
+                             const DUInt8&       max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
   if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DChar&         min,
-                           const DChar&         max,
-                           const ROW_INDEX      fromRow,
-                           const ROW_INDEX      toRow,
-                           const FIELD_INDEX    field)
+RowsSet
+PrototypeTable::MatchRowsSet(const DUInt16&      min,
+                             const DUInt16&      max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
   if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DDate&         min,
-                          const DDate&         max,
-                          const ROW_INDEX      fromRow,
-                          const ROW_INDEX      toRow,
-                          const FIELD_INDEX    field)
+RowsSet
+PrototypeTable::MatchRowsSet(const DUInt32&      min,
+                             const DUInt32&      max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
   if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DDateTime&     min,
-                          const DDateTime&     max,
-                          const ROW_INDEX      fromRow,
-                          const ROW_INDEX      toRow,
-                          const FIELD_INDEX    field)
+RowsSet
+PrototypeTable::MatchRowsSet(const DUInt64&      min,
+                             const DUInt64&      max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
   if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DHiresTime&     min,
-                          const DHiresTime&     max,
-                          const ROW_INDEX       fromRow,
-                          const ROW_INDEX       toRow,
-                          const FIELD_INDEX     field)
+RowsSet
+PrototypeTable::MatchRowsSet(const DInt8&        min,
+                             const DInt8&        max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
   if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DUInt8&        min,
-                          const DUInt8&        max,
-                          const ROW_INDEX      fromRow,
-                          const ROW_INDEX      toRow,
-                          const FIELD_INDEX    field)
+RowsSet
+PrototypeTable::MatchRowsSet(const DInt16&       min,
+                             const DInt16&       max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
   if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DUInt16&       min,
-                          const DUInt16&       max,
-                          const ROW_INDEX      fromRow,
-                          const ROW_INDEX      toRow,
-                          const FIELD_INDEX    field)
+RowsSet
+PrototypeTable::MatchRowsSet(const DInt32&       min,
+                             const DInt32&       max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
   if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DUInt32&       min,
-                          const DUInt32&       max,
-                          const ROW_INDEX      fromRow,
-                          const ROW_INDEX      toRow,
-                          const FIELD_INDEX    field)
+RowsSet
+PrototypeTable::MatchRowsSet(const DInt64&       min,
+                             const DInt64&       max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
   if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DUInt64&       min,
-                          const DUInt64&       max,
-                          const ROW_INDEX      fromRow,
-                          const ROW_INDEX      toRow,
-                          const FIELD_INDEX    field)
+RowsSet
+PrototypeTable::MatchRowsSet(const DReal&        min,
+                             const DReal&        max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
   if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DInt8&         min,
-                          const DInt8&         max,
-                          const ROW_INDEX      fromRow,
-                          const ROW_INDEX      toRow,
-                          const FIELD_INDEX    field)
+RowsSet
+PrototypeTable::MatchRowsSet(const DRichReal&    min,
+                             const DRichReal&    max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
   if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+    return MatchRowsWithIndex<RowsSet>(min, max, fromRow, toRow, field);
+
+  if (mvBitmapIndexes[field] != nullptr)
+    return MatchRowsWithBitmap(min, max, fromRow, toRow, field);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
+
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DInt16&        min,
-                          const DInt16&        max,
-                          const ROW_INDEX      fromRow,
-                          const ROW_INDEX      toRow,
-                          const FIELD_INDEX    field)
+RowsSet
+PrototypeTable::MatchRowsSet(const DText&        min,
+                             const DText&        max,
+                             const ROW_INDEX     fromRow,
+                             const ROW_INDEX     toRow,
+                             const FIELD_INDEX   field)
 {
   if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+    return MatchTextRowsWithIndex(min, max, fromRow, toRow, field);
+
+  if (mvHashIndexes[field] != nullptr)
+    return MatchRowsWithHash<RowsSet>(min, max, fromRow, toRow, field);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  return MatchRowsNoIndex<RowsSet>(min, max, fromRow, toRow, field);
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DInt32&       min,
-                          const DInt32&       max,
-                          const ROW_INDEX     fromRow,
-                          const ROW_INDEX     toRow,
-                          const FIELD_INDEX   field)
+RowsSet
+PrototypeTable::MatchTextRowsWithIndex(const DText&        min,
+                                       const DText&        max,
+                                       const ROW_INDEX     fromRow,
+                                       const ROW_INDEX     toRow,
+                                       const FIELD_INDEX   field)
 {
-  if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+  const TextIndexPrefix minKey(min);
+  const TextIndexPrefix maxKey(max);
+
+  RowsSet result = MatchRowsWithIndex<RowsSet>(minKey, maxKey, fromRow, toRow, field);
+
+  //Only the rows sharing a truncated prefix with one of the range ends might
+  //be out of it, so only their values are loaded to be checked.
+  RowsSet ties;
+  if (minKey.IsTruncated())
+    ties.Unite(MatchRowsWithIndex<RowsSet>(minKey, minKey, fromRow, toRow, field));
+
+  if (maxKey.IsTruncated() && ! (maxKey == minKey))
+    ties.Unite(MatchRowsWithIndex<RowsSet>(maxKey, maxKey, fromRow, toRow, field));
+
+  for (ROW_INDEX row = ties.Next(0); row != INVALID_ROW_INDEX; row = ties.Next(row + 1))
+  {
+    DText rowValue;
+    Get(row, field, rowValue);
+
+    if ((rowValue < min) || (max < rowValue))
+      result.Remove(row);
+  }
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  return result;
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DInt64&       min,
-                          const DInt64&       max,
-                          const ROW_INDEX     fromRow,
-                          const ROW_INDEX     toRow,
-                          const FIELD_INDEX   field)
+RowsSet
+PrototypeTable::MatchTextRows(const DText&        substring,
+                              const bool          ignoreCase,
+                              const ROW_INDEX     fromRow,
+                              ROW_INDEX           toRow,
+                              const FIELD_INDEX   field)
 {
-  if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+  FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+
+  if (desc.Type() != T_TEXT)
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+
+  RowsSet result;
+  if ((mRowsCount == 0) || substring.IsNull())
+    return result;
+
+  toRow = MIN(toRow, mRowsCount - 1);
+  if (fromRow > toRow)
+    return result;
+
+  RowsSet candidates;
+  candidates.Add(fromRow, toRow);
+
+  vector<uint64_t> trigrams;
+  if (mvBitmapIndexes[field] != nullptr)
+  {
+    vector<uint8_t> utf8(substring.RawSize());
+
+    substring.RawRead(0, utf8.size(), utf8.data());
+    text_trigrams(utf8.data(), utf8.size(), trigrams);
+  }
+
+  //A substring shorter than a trigram has its rows checked one by one.
+  if ( ! trigrams.empty())
+  {
+    AcquireFieldIndex( &desc);
+
+    try
+    {
+      for (auto trigram : trigrams)
+      {
+        const RowsSet* const rows = mvBitmapIndexes[field]->TrigramRows(trigram);
+
+        if (rows == nullptr)
+        {
+          candidates.Clear();
+          break;
+        }
+
+        candidates.Intersect( *rows);
+      }
+    }
+    catch (...)
+    {
+      ReleaseIndexField( &desc);
+
+      throw;
+    }
+
+    ReleaseIndexField( &desc);
+  }
+
+  for (ROW_INDEX row = candidates.Next(0);
+       row != INVALID_ROW_INDEX;
+       row = candidates.Next(row + 1))
+  {
+    DText rowValue;
+    Get(row, field, rowValue);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+    if ( ! rowValue.IsNull()
+        && ! _CC(DText&, substring).FindInText(rowValue, ignoreCase, 0, rowValue.Count()).IsNull())
+    {
+      result.Add(row);
+    }
+  }
+
+  return result;
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DReal&        min,
-                          const DReal&        max,
-                          const ROW_INDEX     fromRow,
-                          const ROW_INDEX     toRow,
-                          const FIELD_INDEX   field)
+RowsSet
+PrototypeTable::MatchArrayRows(const DArray&       values,
+                               const bool          matchAll,
+                               const ROW_INDEX     fromRow,
+                               ROW_INDEX           toRow,
+                               const FIELD_INDEX   field)
 {
-  if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+  FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+
+  if ( ! IS_ARRAY(desc.Type())
+      || ( ! values.IsNull() && (GET_BASE_TYPE(desc.Type()) != _SC(uint_t, values.Type()))))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+  }
+
+  RowsSet result;
+  if ((mRowsCount == 0) || values.IsNull())
+    return result;
+
+  toRow = MIN(toRow, mRowsCount - 1);
+  if (fromRow > toRow)
+    return result;
+
+  const uint_t elementSize = Serializer::Size(_SC(DBS_FIELD_TYPE, GET_BASE_TYPE(desc.Type())),
+                                              false);
+  vector<uint8_t> wanted;
+  array_elements(values, elementSize, wanted);
+
+  if (mvBitmapIndexes[field] != nullptr)
+  {
+    AcquireFieldIndex( &desc);
+
+    try
+    {
+      for (size_t offset = 0; offset < wanted.size(); offset += elementSize)
+      {
+        const RowsSet* const rows = mvBitmapIndexes[field]->Rows(wanted.data() + offset,
+                                                                 elementSize);
+        if (matchAll && (rows == nullptr))
+        {
+          result.Clear();
+          break;
+        }
+        else if (rows == nullptr)
+          continue;
+
+        if (matchAll && (offset > 0))
+          result.Intersect( *rows);
+
+        else
+          result.Unite( *rows);
+      }
+    }
+    catch (...)
+    {
+      ReleaseIndexField( &desc);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+      throw;
+    }
+
+    ReleaseIndexField( &desc);
+
+    if ((fromRow > 0) || (toRow < mRowsCount - 1))
+    {
+      RowsSet range;
+      range.Add(fromRow, toRow);
+
+      result.Intersect(range);
+    }
+
+    return result;
+  }
+
+  vector<uint8_t> elements;
+  for (ROW_INDEX row = fromRow; row <= toRow; ++row)
+  {
+    DArray rowValue;
+    Get(row, field, rowValue);
+
+    array_elements(rowValue, elementSize, elements);
+
+    bool matched = matchAll;
+    for (size_t w = 0; (w < wanted.size()) && (matched == matchAll); w += elementSize)
+    {
+      bool found = false;
+      for (size_t e = 0; ! found && (e < elements.size()); e += elementSize)
+        found = (memcmp(wanted.data() + w, elements.data() + e, elementSize) == 0);
+
+      matched = found;
+    }
+
+    if (matched)
+      result.Add(row);
+  }
+
+  return result;
 }
 
 
-DArray
-PrototypeTable::MatchRows(const DRichReal&    min,
-                          const DRichReal&    max,
-                          const ROW_INDEX     fromRow,
-                          const ROW_INDEX     toRow,
-                          const FIELD_INDEX   field)
+template <class R, class T> R
+PrototypeTable::MatchRowsWithIndex(const T&          min,
+                                   const T&          max,
+                                   const ROW_INDEX   fromRow,
+                                   ROW_INDEX         toRow,
+                                   const FIELD_INDEX field)
 {
-  if (mvIndexNodeMgrs[field] != nullptr)
-    return MatchRowsWithIndex(min, max, fromRow, toRow, field);
+  R result;
+  if (mRowsCount == 0)
+    return result;
+
+  FieldDescriptor& desc = GetFieldDescriptorInternal(field);
+
+  if ((desc.Type() & PS_TABLE_ARRAY_MASK)
+      || ((desc.Type() & PS_TABLE_FIELD_TYPE_MASK) != _SC(uint_t, min.DBSType())))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+  }
+
+  toRow = MIN(toRow, mRowsCount - 1);
+
+  FieldIndexNodeManager* const nodeMgr = mvIndexNodeMgrs[field];
+
+  assert(nodeMgr != nullptr);
+
+  AcquireUpdatedFieldIndex(field);
+
+  try
+  {
+    index_range_rows( *nodeMgr, min, max, fromRow, toRow, result);
+  }
+  catch (...)
+  {
+    ReleaseIndexField( &desc);
+
+    throw;
+  }
+
+  ReleaseIndexField( &desc);
 
-  return MatchRowsNoIndex(min, max, fromRow, toRow, field);
+  return result;
 }
 
 
-template <class T> DArray
-PrototypeTable::MatchRowsWithIndex(const T&          min,
-                                   const T&          max,
-                                   const ROW_INDEX   fromRow,
-                                   ROW_INDEX         toRow,
-                                   const FIELD_INDEX field)
+template <class R, class T> R
+PrototypeTable::MatchRowsWithHash(const T&          min,
+                                  const T&          max,
+                                  const ROW_INDEX   fromRow,
+                                  ROW_INDEX         toRow,
+                                  const FIELD_INDEX field)
 {
-  DArray result;
+  //Only the matches of a single value are served by a hash index.
+  if (min.IsNull() || ! (min == max))
+    return MatchRowsNoIndex<R>(min, max, fromRow, toRow, field);
+
+  R result;
   if (mRowsCount == 0)
     return result;
 
@@ -2410,58 +5390,76 @@ PrototypeTable::MatchRowsWithIndex(const T&          min,
 
   toRow = MIN(toRow, mRowsCount - 1);
 
-  FieldIndexNodeManager* const nodeMgr = mvIndexNodeMgrs[field];
-
-  NODE_INDEX nodeId;
-  KEY_INDEX fromKey;
-  const T_BTreeKey<T> firstKey(min, fromRow);
-  const T_BTreeKey<T> lastKey(max, toRow);
-
-  assert(nodeMgr != nullptr);
+  RowsSet candidates;
+  const uint64_t hash = value_hash(min);
 
   AcquireFieldIndex( &desc);
 
   try
   {
-    BTree fieldIndexTree( *nodeMgr);
+    mvHashIndexes[field]->Find(hash, fromRow, toRow, candidates);
+  }
+  catch (...)
+  {
+    ReleaseIndexField( &desc);
 
-    if ( !fieldIndexTree.FindBiggerOrEqual(firstKey, &nodeId, &fromKey))
-      goto force_return;
+    throw;
+  }
 
-    auto currentNode = nodeMgr->RetrieveNode(nodeId);
+  ReleaseIndexField( &desc);
 
-    assert(fromKey < currentNode->KeysCount());
-    while (true)
-    {
-      IBTreeFieldIndexNode* node = _SC(IBTreeFieldIndexNode*, &*currentNode);
-      KEY_INDEX toKey = ~0;
+  //Different values may share a hash, so the values of the found rows are checked.
+  for (ROW_INDEX row = candidates.Next(0); row != INVALID_ROW_INDEX; row = candidates.Next(row + 1))
+  {
+    T rowValue;
+    Get(row, field, rowValue);
 
-      bool lastNode = false;
+    if (rowValue == min)
+      add_matched_row(result, row);
+  }
 
-      if (node->FindBiggerOrEqual(lastKey, &toKey))
-      {
-        lastNode = true;
+  return result;
+}
 
-        if (node->CompareKey(lastKey, toKey) < 0)
-          toKey++;
-      }
-      else
-        toKey = 0;
 
-      if (fromKey >= toKey)
-        node->GetRows(fromKey, toKey, fromRow, toRow, result);
+template <class T> RowsSet
+PrototypeTable::MatchRowsWithBitmap(const T&          min,
+                                    const T&          max,
+                                    const ROW_INDEX   fromRow,
+                                    ROW_INDEX         toRow,
+                                    const FIELD_INDEX field)
+{
+  RowsSet result;
+  if (mRowsCount == 0)
+    return result;
 
-      if (lastNode || (node->Next() == NIL_NODE))
-        break;
+  FieldDescriptor& desc = GetFieldDescriptorInternal(field);
 
-      else
-      {
-        currentNode = nodeMgr->RetrieveNode(node->Next());
+  if ((desc.Type() & PS_TABLE_ARRAY_MASK)
+      || ((desc.Type() & PS_TABLE_FIELD_TYPE_MASK) != _SC(uint_t, min.DBSType())))
+  {
+    throw DBSException(_EXTRA(DBSException::FIELD_TYPE_INVALID));
+  }
+
+  toRow = MIN(toRow, mRowsCount - 1);
+  if (fromRow > toRow)
+    return result;
 
-        assert(currentNode->KeysCount() > 0);
+  AcquireFieldIndex( &desc);
 
-        fromKey = currentNode->KeysCount() - 1;
+  try
+  {
+    for (const auto& entry : mvBitmapIndexes[field]->Values())
+    {
+      T value;
+      if ( ! entry.mValue.empty())
+      {
+        value.~T();
+        Serializer::Load(entry.mValue.data(), &value);
       }
+
+      if ((min <= value) && (value <= max))
+        result.Unite(entry.mRows);
     }
   }
   catch (...)
@@ -2471,22 +5469,28 @@ PrototypeTable::MatchRowsWithIndex(const T&          min,
     throw;
   }
 
-  force_return:
-
   ReleaseIndexField( &desc);
 
+  if ((fromRow > 0) || (toRow < mRowsCount - 1))
+  {
+    RowsSet range;
+    range.Add(fromRow, toRow);
+
+    result.Intersect(range);
+  }
+
   return result;
 }
 
 
-template <class T> DArray
+template <class R, class T> R
 PrototypeTable::MatchRowsNoIndex(const T&          min,
                                  const T&          max,
                                  const ROW_INDEX   fromRow,
                                  ROW_INDEX         toRow,
                                  const FIELD_INDEX field)
 {
-  DArray result;
+  R result;
 
   if (mRowsCount == 0)
     return result;
@@ -2500,7 +5504,7 @@ PrototypeTable::MatchRowsNoIndex(const T&          min,
     if ((rowValue < min) || (max < rowValue))
       continue;
 
-    result.Add(DROW_INDEX(row));
+    add_matched_row(result, row);
   }
 
   return result;
@@ -2510,15 +5514,18 @@ PrototypeTable::MatchRowsNoIndex(const T&          min,
 void
 PrototypeTable::MarkRowModification(LockGuard<Lock>* const guard)
 {
+  ++mUpdatesCount;
+
   if (mRowModified)
     return ;
 
-  while (! mDbs.NotifyDatabaseUpdate(true))
+  //Do not wait for the database lock while holding the rows one.
+  if (! mDbs.NotifyDatabaseUpdate(true))
   {
     if (guard != nullptr)
       guard->unlock();
 
-    wh_yield();
+    mDbs.NotifyDatabaseUpdate(false);
 
     if (guard != nullptr)
       guard->lock();
@@ -2528,9 +5535,224 @@ PrototypeTable::MarkRowModification(LockGuard<Lock>* const guard)
 }
 
 
+void
+PrototypeTable::ApplyRedoRecord(const RedoRecord& record)
+{
+  if (record.mType == REDO_ROW_ADD)
+  {
+    while (mRowsCount <= record.mRow)
+      AddRow();
+
+    return;
+  }
+
+  assert(record.mType == REDO_FIELD_VALUE);
+
+  const uint_t fieldType = (record.mField < mFieldsCount)
+                             ? GetFieldDescriptorInternal(record.mField).Type()
+                             : 0;
+  const bool retyped = (fieldType != record.mFieldType)
+                       && ! IS_ARRAY(fieldType)
+                       && ! IS_ARRAY(record.mFieldType)
+                       && Serializer::IsWidening(GET_BASE_TYPE(record.mFieldType),
+                                                 GET_BASE_TYPE(fieldType));
+
+  if ((record.mField >= mFieldsCount)
+      || (record.mRow >= mRowsCount)
+      || ((fieldType != record.mFieldType) && ! retyped))
+  {
+    throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY),
+                       "Redo record %lu does not match the layout of table '%s'.",
+                       _SC(long, record.mLsn),
+                       TableName().c_str());
+  }
+  else if (retyped)
+  {
+    //The value was logged before the field was set to a wider type.
+    uint8_t rawValue[Serializer::MAX_VALUE_RAW_SIZE];
+    RedoRecord widened = record;
+
+    widened.mFieldType = fieldType;
+    if ( ! record.mIsNull)
+    {
+      const auto oldType = GET_BASE_TYPE(record.mFieldType);
+      const auto newType = GET_BASE_TYPE(fieldType);
+
+      if (record.mValueSize != Serializer::Size(oldType, false))
+      {
+        throw DBSException(_EXTRA(DBSException::TABLE_INCONSITENCY),
+                           "Redo record %lu holds a value of an unexpected size.",
+                           _SC(long, record.mLsn));
+      }
+
+      Serializer::Widen(oldType, record.mValue, newType, rawValue);
+
+      widened.mValue = rawValue;
+      widened.mValueSize = Serializer::Size(newType, false);
+    }
+
+    ApplyRedoRecord(widened);
+    return;
+  }
+
+  if (IS_ARRAY(record.mFieldType))
+  {
+    switch (GET_BASE_TYPE(record.mFieldType))
+    {
+    case T_BOOL:
+      redo_array_value<DBool>( *this, record);
+      break;
+
+    case T_CHAR:
+      redo_array_value<DChar>( *this, record);
+      break;
+
+    case T_DATE:
+      redo_array_value<DDate>( *this, record);
+      break;
+
+    case T_DATETIME:
+      redo_array_value<DDateTime>( *this, record);
+      break;
+
+    case T_HIRESTIME:
+      redo_array_value<DHiresTime>( *this, record);
+      break;
+
+    case T_INT8:
+      redo_array_value<DInt8>( *this, record);
+      break;
+
+    case T_INT16:
+      redo_array_value<DInt16>( *this, record);
+      break;
+
+    case T_INT32:
+      redo_array_value<DInt32>( *this, record);
+      break;
+
+    case T_INT64:
+      redo_array_value<DInt64>( *this, record);
+      break;
+
+    case T_UINT8:
+      redo_array_value<DUInt8>( *this, record);
+      break;
+
+    case T_UINT16:
+      redo_array_value<DUInt16>( *this, record);
+      break;
+
+    case T_UINT32:
+      redo_array_value<DUInt32>( *this, record);
+      break;
+
+    case T_UINT64:
+      redo_array_value<DUInt64>( *this, record);
+      break;
+
+    case T_REAL:
+      redo_array_value<DReal>( *this, record);
+      break;
+
+    case T_RICHREAL:
+      redo_array_value<DRichReal>( *this, record);
+      break;
+
+    default:
+      assert(false);
+    }
+    return;
+  }
+
+  switch (GET_BASE_TYPE(record.mFieldType))
+  {
+  case T_BOOL:
+    redo_field_value<DBool>( *this, record);
+    break;
+
+  case T_CHAR:
+    redo_field_value<DChar>( *this, record);
+    break;
+
+  case T_DATE:
+    redo_field_value<DDate>( *this, record);
+    break;
+
+  case T_DATETIME:
+    redo_field_value<DDateTime>( *this, record);
+    break;
+
+  case T_HIRESTIME:
+    redo_field_value<DHiresTime>( *this, record);
+    break;
+
+  case T_INT8:
+    redo_field_value<DInt8>( *this, record);
+    break;
+
+  case T_INT16:
+    redo_field_value<DInt16>( *this, record);
+    break;
+
+  case T_INT32:
+    redo_field_value<DInt32>( *this, record);
+    break;
+
+  case T_INT64:
+    redo_field_value<DInt64>( *this, record);
+    break;
+
+  case T_UINT8:
+    redo_field_value<DUInt8>( *this, record);
+    break;
+
+  case T_UINT16:
+    redo_field_value<DUInt16>( *this, record);
+    break;
+
+  case T_UINT32:
+    redo_field_value<DUInt32>( *this, record);
+    break;
+
+  case T_UINT64:
+    redo_field_value<DUInt64>( *this, record);
+    break;
+
+  case T_REAL:
+    redo_field_value<DReal>( *this, record);
+    break;
+
+  case T_RICHREAL:
+    redo_field_value<DRichReal>( *this, record);
+    break;
+
+  case T_TEXT:
+    Set(record.mRow,
+        record.mField,
+        DText(record.mValue, record.mIsNull ? 0 : record.mValueSize));
+    break;
+
+  default:
+    assert(false);
+  }
+}
+
+
+void
+PrototypeTable::CommitUpdate(const uint64_t lsn)
+{
+  RedoLog* const log = TableRedoLog();
+  if (log != nullptr)
+    log->CommitWrite(lsn);
+}
+
+
 void
 PrototypeTable::FlushInternal()
 {
+  const uint64_t lsn = BeginContentSync();
+
   mRowCache.Flush();
   FlushNodes();
 
@@ -2544,17 +5766,127 @@ PrototypeTable::FlushInternal()
     while (fd.IsAcquired())
       wh_yield();
 
+    ApplyPendingIndexKeys(field, false);
     mvIndexNodeMgrs[field]->FlushNodes();
   }
 
+  for (FIELD_INDEX field = 0; field < mFieldsCount; ++field)
+  {
+    if (mvHashIndexes[field] == nullptr)
+      continue;
+
+    FieldDescriptor& fd = GetFieldDescriptorInternal(field);
+
+    while (fd.IsAcquired())
+      wh_yield();
+
+    mvHashIndexes[field]->Flush();
+  }
+
+  for (FIELD_INDEX field = 0; field < mFieldsCount; ++field)
+  {
+    if (mvBitmapIndexes[field] == nullptr)
+      continue;
+
+    FieldDescriptor& fd = GetFieldDescriptorInternal(field);
+
+    while (fd.IsAcquired())
+      wh_yield();
+
+    mvBitmapIndexes[field]->Flush();
+  }
+
+  for (auto& index : mvCompositeIndexes)
+    index.mNodeMgr->FlushNodes();
+
   FlushEpilog();
 
   mRowModified = false;
 
   MakeHeaderPersistent();
+  EndContentSync(lsn);
+}
+
+
+
+
+bool
+PrototypeTable::ConvertSomeRows(const uint_t maxBlocks)
+{
+  LockGuard<Lock> syncHolder(mRowsSync);
+
+  if (mLegacyRows.mRowSize == 0)
+    return false;
+
+  MarkRowModification( &syncHolder);
+
+  return ConvertRows(maxBlocks);
+}
+
+
+bool
+PrototypeTable::ConvertRows(const uint_t maxBlocks)
+{
+  assert(mRowModified);
+
+  if (mLegacyRows.mRowSize == 0)
+    return false;
+
+  const uint64_t batchRows = _SC(uint64_t, maxBlocks) * mRowCache.BlockItemsCount();
+  const ROW_INDEX from = mConvertedRows;
+  const ROW_INDEX to = MIN(_SC(uint64_t, mLegacyRows.mRowsCount), from + batchRows);
+  if (from < to)
+  {
+    unique_ptr<uint8_t[]> rowsData(unique_array_make(uint8_t, (to - from) * mRowSize));
+
+    //The rows held by the cache are written over these when they are flushed.
+    RowsContainer().Read(from * mRowSize, (to - from) * mRowSize, rowsData.get());
+    if (ConvertLegacyRows(from, to - from, rowsData.get()))
+      RowsContainer().Write(from * mRowSize, (to - from) * mRowSize, rowsData.get());
+  }
+
+  mConvertedRows = to;
+  if (mConvertedRows < mLegacyRows.mRowsCount)
+    return true;
+
+  mLegacyRows = LegacyRowsLayout();
+  mConvertedRows = 0;
+
+  EndRowsConversion();
+
+  return false;
 }
 
 
+void
+PrototypeTable::ReplaceRowsLayout(uint8_t* const      descriptors,
+                                  const uint32_t      descriptorsSize,
+                                  const FIELD_INDEX   fieldsCount,
+                                  const uint32_t      rowSize)
+{
+  assert(fieldsCount >= mFieldsCount);
+  assert(rowSize > mRowSize);
+
+  uint_t blkSize = DBSSettings().mTableCacheBlkSize;
+
+  while (blkSize < rowSize)
+    blkSize *= 2;
+
+  mRowCache.Reset(rowSize, blkSize);
+
+  mRetiredDescriptors.push_back(move(mFieldsDescriptors));
+  mFieldsDescriptors.reset(descriptors);
+
+  mvIndexNodeMgrs.resize(fieldsCount, nullptr);
+  mvHashIndexes.resize(fieldsCount, nullptr);
+  mvBitmapIndexes.resize(fieldsCount, nullptr);
+
+  mDescriptorsSize = descriptorsSize;
+  mRowSize         = rowSize;
+  mFieldsCount     = fieldsCount;
+
+  mFieldsStats.clear();
+}
 
 
 TableRmNode::TableRmNode(PrototypeTable& table, const NODE_INDEX nodeId)
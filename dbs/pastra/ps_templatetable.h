@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define PS_TEMPLATETABLE_H_
 
 #include <assert.h>
+#include <map>
 
 #include "utils/wfile.h"
 #include "utils/endianness.h"
@@ -37,6 +38,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ps_blockcache.h"
 #include "ps_varstorage.h"
 #include "ps_btree_fields.h"
+#include "ps_hashindex.h"
+#include "ps_bitmapindex.h"
+#include "ps_redolog.h"
 
 
 namespace whais {
@@ -47,6 +51,9 @@ static const uint_t PS_TABLE_FIELD_TYPE_MASK = 0x00FF;
 static const uint_t PS_TABLE_ARRAY_MASK      = 0x0100;
 
 
+class RowsSortKeys;
+
+
 class FieldDescriptor
 {
 public:
@@ -59,7 +66,7 @@ public:
     IndexNodeSizeKB(0);
     IndexUnitsCount(0);
     Type(0);
-    mAcquired = 0;
+    mFlags = 0;
   }
 
   uint_t NullBitIndex() const { return load_le_int16(mNullBitIndex); }
@@ -70,25 +77,142 @@ public:
   void NameOffset(const uint_t off) { store_le_int32(off, mNameOffset); }
   uint_t Type() const { return load_le_int16(mType); }
   void Type(const uint_t type) { store_le_int16(type, mType); }
-  bool IsAcquired() const { return mAcquired != 0; }
-  void Acquire() { assert(mAcquired == 0); mAcquired = 1; }
-  void Release() { assert(mAcquired > 0); mAcquired = 0; }
+  bool IsAcquired() const { return (mFlags & ACQUIRED_FLAG) != 0; }
+  void Acquire() { assert( ! IsAcquired()); mFlags |= ACQUIRED_FLAG; }
+  void Release() { assert(IsAcquired()); mFlags &= ~ACQUIRED_FLAG; }
+  uint_t IndexKind() const { return mFlags >> INDEX_KIND_SHIFT; }
+  void IndexKind(const uint_t kind) { assert(kind <= 0x0F); mFlags = (mFlags & ACQUIRED_FLAG) | (kind << INDEX_KIND_SHIFT); }
   uint_t IndexNodeSizeKB() const { return mIndexNodeSizeKB; }
   void IndexNodeSizeKB(const uint_t kb) { assert(kb <= 255); mIndexNodeSizeKB = kb; }
   uint_t IndexUnitsCount() const { return load_le_int16(mIndexUnitsCount); }
   void IndexUnitsCount(const uint_t count) { store_le_int16(count, mIndexUnitsCount); }
 
 private:
+  //The index kind shares its byte with the runtime flag of an acquired index.
+  static const uint8_t ACQUIRED_FLAG    = 0x01;
+  static const uint_t  INDEX_KIND_SHIFT = 4;
+
   //TODO: Make sure you check no fields count bigger than 65535
   uint8_t  mNullBitIndex[2];
   uint8_t  mRowDataOff[4];
   uint8_t  mNameOffset[4];
   uint8_t  mType[2];
   uint8_t  mIndexUnitsCount[2];
-  uint8_t  mAcquired;
+  uint8_t  mFlags;
   uint8_t  mIndexNodeSizeKB;
 };
 
+/* The layout the rows of a table had before it was altered. The rows stored
+ * by then are kept aside with this layout and are converted to the current one
+ * when first read or in the background. A converted row is recognized by the
+ * byte following its legacy part, which is never zero. */
+struct LegacyRowsLayout
+{
+  LegacyRowsLayout()
+    : mRowSize(0),
+      mRowsCount(0),
+      mRetypedField(NO_RETYPED_FIELD),
+      mRetypedFieldType(0),
+      mRetypedFieldOff(0)
+  {
+  }
+
+  static const FIELD_INDEX NO_RETYPED_FIELD = 0xFFFF;
+
+  uint32_t      mRowSize;   //Zero if there are no rows left to convert.
+  ROW_INDEX     mRowsCount;
+  FIELD_INDEX   mRetypedField;
+  uint16_t      mRetypedFieldType;
+  uint32_t      mRetypedFieldOff;
+};
+
+
+void
+convert_legacy_row(const LegacyRowsLayout&        layout,
+                   const FieldDescriptor* const   fields,
+                   const uint8_t* const           legacyRow,
+                   const uint_t                   rowSize,
+                   uint8_t* const                 outRow);
+
+
+//Add the row's values to the indexes of its fields (the ones with a node manager),
+//or remove them if asked.
+void
+index_row_values(std::vector<FieldIndexNodeManager*>&   indexNodeMgrs,
+                 const FieldDescriptor* const           fds,
+                 const FIELD_INDEX                      fieldsCount,
+                 const ROW_INDEX                        row,
+                 const uint8_t* const                   rowData,
+                 VariableSizeStore* const               store,
+                 const bool                             removeValues = false);
+
+//Add the row's values to the hash indexes of its fields, or remove them.
+void
+hash_row_values(std::vector<FieldHashIndex*>&   hashIndexes,
+                const FieldDescriptor* const    fds,
+                const FIELD_INDEX               fieldsCount,
+                const ROW_INDEX                 row,
+                const uint8_t* const            rowData,
+                VariableSizeStore* const        store,
+                const bool                      removeValues = false);
+
+//Add the row's values to the bitmap indexes of its fields, or remove them.
+void
+bitmap_row_values(std::vector<FieldBitmapIndex*>&   bitmapIndexes,
+                  const FieldDescriptor* const      fds,
+                  const FIELD_INDEX                 fieldsCount,
+                  const ROW_INDEX                   row,
+                  const uint8_t* const              rowData,
+                  VariableSizeStore* const          store,
+                  const bool                        removeValues = false);
+
+
+//A B-tree index whose keys hold the values of several fields, in order.
+struct CompositeIndex
+{
+  std::vector<FIELD_INDEX>   mFields;
+  FieldIndexNodeManager*     mNodeMgr;
+};
+
+//The key of a row in a composite index over the specified fields.
+CompositeKey
+composite_row_key(const FieldDescriptor* const      fds,
+                  const std::vector<FIELD_INDEX>&   fields,
+                  const uint8_t* const              rowData);
+
+//Add the row's values to the composite indexes, or remove them.
+void
+composite_row_values(std::vector<CompositeIndex>&   compositeIndexes,
+                     const FieldDescriptor* const   fds,
+                     const ROW_INDEX                row,
+                     const uint8_t* const           rowData,
+                     const bool                     removeValues = false);
+
+
+class PrototypeTable;
+
+//The changes of a B-tree indexed field, kept aside while the table defers its
+//indexes updates.
+class PendingIndexKeys
+{
+public:
+  virtual ~PendingIndexKeys() = default;
+
+  virtual size_t Count() const = 0;
+
+  //Get the keys to update from the rows current values. The rows lock is held.
+  virtual void Collect(PrototypeTable& table, const FIELD_INDEX field) = 0;
+
+  //Update the index with the collected keys. The changes are kept and the
+  //index is left as it was if this fails.
+  virtual void Apply(FieldIndexNodeManager& nodeMgr) = 0;
+
+  //Take in the changes done since these were collected, as they have to be
+  //applied again.
+  virtual void Merge(PendingIndexKeys& later) = 0;
+};
+
+
 class PrototypeTable : public ITable,
                        public IBlocksManager,
                        public IBTreeNodeManager
@@ -114,9 +238,18 @@ public:
   virtual void MarkRowForReuse(const ROW_INDEX row) override;
   virtual void CreateIndex(const FIELD_INDEX                   field,
                            CREATE_INDEX_CALLBACK_FUNC* const   cbFunc,
-                           CreateIndexCallbackContext* const   cbContext);
+                           CreateIndexCallbackContext* const   cbContext,
+                           const DBS_INDEX_KIND                kind = INDEX_BTREE) override;
   virtual void RemoveIndex(const FIELD_INDEX field) override;
   virtual bool IsIndexed(const FIELD_INDEX field) const override;
+  virtual void CreateCompositeIndex(const FIELD_INDEX* const            fields,
+                                    const FIELD_INDEX                   fieldsCount,
+                                    CREATE_INDEX_CALLBACK_FUNC* const   cbFunc,
+                                    CreateIndexCallbackContext* const   cbContext) override;
+  virtual void RemoveCompositeIndex(const FIELD_INDEX* const   fields,
+                                    const FIELD_INDEX          fieldsCount) override;
+  virtual std::vector<std::vector<FIELD_INDEX>> CompositeIndexes() override;
+  virtual void DeferIndexesUpdates(const bool defer) override;
 
   virtual void Set(const ROW_INDEX row,
                    const FIELD_INDEX field,
@@ -293,9 +426,26 @@ public:
                             const bool skipThreadSafety = false);
 
   virtual void Sort(const FIELD_INDEX   field,
-                      const ROW_INDEX     from,
-                      const ROW_INDEX     to,
-                      const bool          reverse);
+                    const ROW_INDEX     from,
+                    const ROW_INDEX     to,
+                    const bool          reverse);
+
+  virtual void Sort(const FIELD_INDEX* const   fields,
+                    const bool* const          reverse,
+                    const FIELD_INDEX          fieldsCount,
+                    const ROW_INDEX            from,
+                    const ROW_INDEX            to);
+
+  virtual ROW_INDEX LoadRows(const char* const          file,
+                             const DBS_LOAD_FORMAT      format,
+                             const FIELD_INDEX* const   fields,
+                             const FIELD_INDEX          fieldsCount);
+
+  virtual ROW_INDEX ExportRows(const char* const          file,
+                               const FIELD_INDEX* const   fields,
+                               const FIELD_INDEX          fieldsCount);
+
+  virtual DBSFieldStats GetFieldStats(const FIELD_INDEX field);
 
   virtual DArray MatchRows(const DBool&        min,
                            const DBool&        max,
@@ -386,27 +536,204 @@ public:
                            const ROW_INDEX fromRow,
                            const ROW_INDEX toRow,
                            const FIELD_INDEX field);
+
+  virtual DArray MatchRows(const DText& min,
+                           const DText& max,
+                           const ROW_INDEX fromRow,
+                           const ROW_INDEX toRow,
+                           const FIELD_INDEX field);
+
+  virtual RowsSet MatchRowsSet(const DBool&        min,
+                               const DBool&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DChar&        min,
+                               const DChar&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DDate&        min,
+                               const DDate&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DDateTime&    min,
+                               const DDateTime&    max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DHiresTime&   min,
+                               const DHiresTime&   max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DUInt8&       min,
+                               const DUInt8&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DUInt16&      min,
+                               const DUInt16&      max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DUInt32&      min,
+                               const DUInt32&      max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DUInt64&      min,
+                               const DUInt64&      max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DInt8&        min,
+                               const DInt8&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DInt16&       min,
+                               const DInt16&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DInt32&       min,
+                               const DInt32&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DInt64&       min,
+                               const DInt64&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DReal&        min,
+                               const DReal&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DRichReal&    min,
+                               const DRichReal&    max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DText&        min,
+                               const DText&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchTextRows(const DText&        substring,
+                                const bool          ignoreCase,
+                                const ROW_INDEX     fromRow,
+                                const ROW_INDEX     toRow,
+                                const FIELD_INDEX   field) override;
+
+  virtual RowsSet MatchArrayRows(const DArray&       values,
+                                 const bool          matchAll,
+                                 const ROW_INDEX     fromRow,
+                                 const ROW_INDEX     toRow,
+                                 const FIELD_INDEX   field) override;
+  virtual RowsSet MatchCompositeRows(const FIELD_INDEX* const   fields,
+                                     const FIELD_INDEX          fieldsCount,
+                                     const CompositeKey&        min,
+                                     const CompositeKey&        max,
+                                     const ROW_INDEX            fromRow,
+                                     const ROW_INDEX            toRow) override;
+  virtual uint_t FetchIndexEntries(const FIELD_INDEX   field,
+                                   const DArray&       fromValue,
+                                   const ROW_INDEX     afterRow,
+                                   const bool          reverse,
+                                   const uint_t        count,
+                                   DArray&             outValues,
+                                   DArray&             outRows) override;
   virtual void LockTable() override;
   virtual void UnlockTable() override;
   virtual void Flush() override;
+  //Write at most 'maxBlocks' of the modified rows blocks, holding the table
+  //lock only while doing so. Returns true if there are modified blocks left.
+  virtual bool FlushSome(const uint_t maxBlocks);
   virtual void ReleaseFromDbs() final override { mDbs.ReleaseTable(*this); }
 
   DbsHandler& GetDbsHandler() { return mDbs; };
 
+  //Redo a logged update while the database is recovered.
+  void ApplyRedoRecord(const RedoRecord& record);
+
+  //Convert at most 'maxBlocks' of the rows still kept with the layout the table
+  //had before being altered. Returns true if there are rows left to convert.
+  bool ConvertSomeRows(const uint_t maxBlocks);
+
   //Followings declarations shouldn't be public,
   //but kept here to ease the testing procedures.
   uint_t RowSize() const;
   FieldDescriptor& GetFieldDescriptorInternal(const FIELD_INDEX fieldIndex) const;
 
+  //The index key of a text field's value, as it's kept in a row's data.
+  static TextIndexPrefix StoredTextPrefix(VariableSizeStore* const   store,
+                                          const FieldDescriptor&     desc,
+                                          const uint8_t* const       rowData);
+
+  //The hash index key of a field's value (not null), as it's kept in a row's data.
+  static uint64_t StoredValueHash(VariableSizeStore* const   store,
+                                  const FieldDescriptor&     desc,
+                                  const uint8_t* const       rowData);
+  static void StoredTextTrigrams(VariableSizeStore* const   store,
+                                 const FieldDescriptor&     desc,
+                                 const uint8_t* const       rowData,
+                                 std::vector<uint64_t>&     outTrigrams);
+  static void StoredArrayElements(VariableSizeStore* const   store,
+                                  const FieldDescriptor&     desc,
+                                  const uint8_t* const       rowData,
+                                  std::vector<uint8_t>&      outElements);
+
 protected:
   virtual void MakeHeaderPersistent() = 0;
   virtual IDataContainer* CreateIndexContainer(const FIELD_INDEX field) = 0;
+  virtual IDataContainer* CreateCompositeIndexContainer(const std::vector<FIELD_INDEX>& fields) = 0;
+  //Record which composite indexes the table has, once they are changed.
+  virtual void MakeCompositeIndexesPersistent() = 0;
   virtual IDataContainer& RowsContainer() = 0;
   virtual IDataContainer& TableContainer() = 0;
   virtual VariableSizeStoreSPtr VSStore() = 0;
   virtual void FlushEpilog() = 0;
+  //The table's content is about to be written, covering the updates logged
+  //up to the returned LSN. Once it was written, make it durable.
+  virtual uint64_t BeginContentSync() = 0;
+  virtual void EndContentSync(const uint64_t lsn) = 0;
+  //The log where this table's updates are recorded (if any) and the table
+  //name used by its records.
+  virtual RedoLog* TableRedoLog() = 0;
+  virtual const std::string& TableName() const = 0;
+  //Where the rows kept with the legacy layout are and what to do once they
+  //are all converted.
+  virtual IDataContainer& LegacyRowsContainer() = 0;
+  virtual void EndRowsConversion() = 0;
   void MarkRowModification(LockGuard<Lock>* const guard);
+  void CommitUpdate(const uint64_t lsn);
   void FlushInternal();
+  bool HasIndex(const FIELD_INDEX field) const;
+  bool ConvertRows(const uint_t maxBlocks);
+  void ReplaceRowsLayout(uint8_t* const      descriptors,
+                         const uint32_t      descriptorsSize,
+                         const FIELD_INDEX   fieldsCount,
+                         const uint32_t      rowSize);
 
   //Data members
   DbsHandler&                           mDbs;
@@ -418,37 +745,114 @@ protected:
   FIELD_INDEX                           mFieldsCount;
   std::unique_ptr<uint8_t>              mFieldsDescriptors;
   std::vector<FieldIndexNodeManager*>   mvIndexNodeMgrs;
+  std::vector<FieldHashIndex*>          mvHashIndexes;
+  std::vector<FieldBitmapIndex*>        mvBitmapIndexes;
+  //Maintained and searched while holding the rows lock.
+  std::vector<CompositeIndex>           mvCompositeIndexes;
   BlockCache                            mRowCache;
   Lock                                  mRowsSync;
   Lock                                  mIndexesSync;
   bool                                  mRowModified;
   bool                                  mLockInProgress;
+  LegacyRowsLayout                      mLegacyRows;
+  ROW_INDEX                             mConvertedRows;
+  //The descriptors replaced when the table was altered. Kept around as they
+  //are read without holding the table locks.
+  std::vector<std::unique_ptr<uint8_t>> mRetiredDescriptors;
+  //Counts the rows changes, to know when the fields statistics are stale.
+  uint64_t                              mUpdatesCount;
+  //The B-tree indexes changes not applied yet. Kept under the rows lock.
+  std::vector<std::unique_ptr<PendingIndexKeys>> mvPendingIndexKeys;
+  bool                                  mDeferIndexesUpdates;
 
 private:
-  template<class T> void StoreEntry(const ROW_INDEX, const FIELD_INDEX, const bool, const T&);
+  template<class T> friend class FieldPendingKeys;
+
+  template<class T> uint64_t StoreEntry(const ROW_INDEX, const FIELD_INDEX, const bool, const T&);
   template<class T> void RetrieveEntry(const ROW_INDEX, const FIELD_INDEX, const bool, T&);
   template<typename T> void table_exchange_rows(const FIELD_INDEX field,
                                                 const ROW_INDEX row1,
                                                 const ROW_INDEX row2);
-  template<class T> DArray MatchRowsWithIndex(const T& min,
-                                              const T& max,
-                                              const ROW_INDEX fromRow,
-                                              ROW_INDEX toRow,
-                                              const FIELD_INDEX fieldIndex);
-  template<class T> DArray MatchRowsNoIndex(const T& min,
-                                            const T& max,
-                                            const ROW_INDEX fromRow,
-                                            ROW_INDEX toRow,
-                                            const FIELD_INDEX filedIndex);
+  template<class R, class T> R MatchRowsWithIndex(const T& min,
+                                                  const T& max,
+                                                  const ROW_INDEX fromRow,
+                                                  ROW_INDEX toRow,
+                                                  const FIELD_INDEX fieldIndex);
+  template<class R, class T> R MatchRowsNoIndex(const T& min,
+                                                const T& max,
+                                                const ROW_INDEX fromRow,
+                                                ROW_INDEX toRow,
+                                                const FIELD_INDEX filedIndex);
+  template<class R, class T> R MatchRowsWithHash(const T& min,
+                                                 const T& max,
+                                                 const ROW_INDEX fromRow,
+                                                 ROW_INDEX toRow,
+                                                 const FIELD_INDEX field);
+  template<class T> RowsSet MatchRowsWithBitmap(const T& min,
+                                                const T& max,
+                                                const ROW_INDEX fromRow,
+                                                ROW_INDEX toRow,
+                                                const FIELD_INDEX field);
+  RowsSet MatchTextRowsWithIndex(const DText& min,
+                                 const DText& max,
+                                 const ROW_INDEX fromRow,
+                                 const ROW_INDEX toRow,
+                                 const FIELD_INDEX field);
   void CheckRowToReuse(const ROW_INDEX row);
   void CheckRowToDelete(const ROW_INDEX row);
+  bool IsRowNull(const uint8_t* const rowData) const;
+  bool SelectFields(const FIELD_INDEX* const   fields,
+                    const FIELD_INDEX          fieldsCount,
+                    std::vector<FIELD_INDEX>&  outFields);
+  void IndexLoadedRows(const ROW_INDEX   firstRow,
+                       const ROW_INDEX   rowsCount,
+                       const bool        removeValues = false);
+  void DiscardLoadedRows(const ROW_INDEX firstRow, const ROW_INDEX rowsCount);
+  bool ConvertLegacyRows(const ROW_INDEX firstRow, const uint_t rowsCount, uint8_t* const to);
+  void AddSortKey(RowsSortKeys&               keys,
+                  const FIELD_INDEX           field,
+                  const uint8_t* const        rowData,
+                  const bool                  reverse,
+                  std::vector<uint8_t>&       textBuffer);
+  void UpdateSortedRowIndex(const FIELD_INDEX      field,
+                            const ROW_INDEX        row,
+                            const uint8_t* const   oldRowData,
+                            const uint8_t* const   newRowData);
+  uint64_t LogSortedRow(const ROW_INDEX row, const uint8_t* const rowData);
+  void RewriteSortedRows(const ROW_INDEX                   from,
+                         const std::vector<ROW_INDEX>&     sortedRows,
+                         LockGuard<Lock>&                  syncHolder);
+  size_t FindCompositeIndex(const FIELD_INDEX* const fields, const FIELD_INDEX fieldsCount) const;
+  void CompositeRowKeys(const FIELD_INDEX              field,
+                        const uint8_t* const           rowData,
+                        std::vector<CompositeKey>&     outKeys) const;
+  void UpdateCompositeIndexes(const FIELD_INDEX                  field,
+                              const ROW_INDEX                    row,
+                              const std::vector<CompositeKey>&   oldKeys,
+                              const uint8_t* const               newRowData);
+  bool SortWithCompositeIndex(const FIELD_INDEX* const   fields,
+                              const bool* const          reverse,
+                              const FIELD_INDEX          fieldsCount,
+                              const ROW_INDEX            from,
+                              const ROW_INDEX            to,
+                              std::vector<ROW_INDEX>&    outRows);
   void AcquireFieldIndex(FieldDescriptor* const field);
+  bool TryAcquireFieldIndex(FieldDescriptor* const field);
   void ReleaseIndexField(FieldDescriptor* const field);
+  void ApplyPendingIndexKeys(const FIELD_INDEX field, const bool acquireField);
+  void AcquireUpdatedFieldIndex(const FIELD_INDEX field);
 
   virtual uint_t MaxCachedNodes() override;
   virtual std::shared_ptr<IBTreeNode> LoadNode(const NODE_INDEX nodeId) override;
   virtual void SaveNode(IBTreeNode* const node) override;
 
+  struct CachedFieldStats
+  {
+    uint64_t        mUpdatesCount;
+    DBSFieldStats   mStats;
+  };
+
+  std::map<FIELD_INDEX, CachedFieldStats>   mFieldsStats;
 };
 
 class TableRmKey : public IBTreeKey
@@ -42,7 +42,9 @@ ITextStrategy::ITextStrategy()
   : mMatcher(nullptr),
     mCachedCharsCount(0),
     mCachedCharIndex(0),
-    mCachedCharIndexOffset(0)
+    mCachedCharIndexOffset(0),
+    mStoredCopyEntry(0),
+    mStoredCopyGeneration(0)
 {
 }
 
@@ -860,6 +862,38 @@ ITextStrategy::GetRowStorage()
   throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
 }
 
+bool
+ITextStrategy::ShareStoredCopy(pastra::VariableSizeStore& store, uint64_t* const outEntry)
+{
+  if (mStoredCopy.lock().get() != &store)
+    return false;
+
+  if ( ! store.ShareRecord(mStoredCopyEntry, mStoredCopyGeneration))
+  {
+    ReleaseStoredCopy();
+    return false;
+  }
+
+  *outEntry = mStoredCopyEntry;
+  return true;
+}
+
+void
+ITextStrategy::BindStoredCopy(pastra::VariableSizeStoreSPtr store, const uint64_t entry)
+{
+  assert(store);
+
+  mStoredCopy = store;
+  mStoredCopyEntry = entry;
+  mStoredCopyGeneration = store->RecordGeneration(entry);
+}
+
+void
+ITextStrategy::ReleaseStoredCopy()
+{
+  mStoredCopy.reset();
+}
+
 
 namespace pastra {
 
@@ -990,12 +1024,14 @@ TemporalText::WriteUtf8U(const uint64_t offset,
                          const uint64_t count,
                          const uint8_t* const buffer)
 {
+  ReleaseStoredCopy();
   mStorage.Write(offset, count, buffer);
 }
 
 void
 TemporalText::TruncateUtf8U(const uint64_t offset)
 {
+  ReleaseStoredCopy();
   mStorage.Colapse(0, offset);
 }
 
@@ -1102,6 +1138,8 @@ RowFieldText::WriteUtf8U(const uint64_t offset,
                        _SC(long, MAX_BYTES_COUNT));
   }
 
+  ReleaseStoredCopy();
+
   const uint64_t containerSize = mTempContainer.Size();
   if ((containerSize == 0) && (mUtf8Count > 0))
   {
@@ -1131,6 +1169,8 @@ RowFieldText::WriteUtf8U(const uint64_t offset,
 void
 RowFieldText::TruncateUtf8U(const uint64_t atOffset)
 {
+  ReleaseStoredCopy();
+
   const uint64_t containerSize = mTempContainer.Size();
 
   if ((containerSize == 0) && (mUtf8Count > 0))
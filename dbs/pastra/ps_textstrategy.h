@@ -40,6 +40,7 @@ namespace pastra {
 //Just forward declarations for now!
 class PrototypeTable;
 class StringMatcher;
+class TextRedoContent;
 
 
 }
@@ -50,6 +51,7 @@ class ITextStrategy
   friend class std::unique_ptr<ITextStrategy>;
   friend class pastra::PrototypeTable;
   friend class pastra::StringMatcher;
+  friend class pastra::TextRedoContent;
 
 public:
   virtual ~ITextStrategy();
@@ -112,11 +114,21 @@ protected:
                           const uint8_t* const buffer) = 0;
   virtual void TruncateUtf8U(const uint64_t offset) = 0;
 
+  //A copy of this value already kept by a variable size store. Storing the
+  //value again in the same store will just share that record, if it's still
+  //there. The binding is kept in memory only, no reference is held.
+  bool ShareStoredCopy(pastra::VariableSizeStore& store, uint64_t* const outEntry);
+  void BindStoredCopy(pastra::VariableSizeStoreSPtr store, const uint64_t entry);
+  void ReleaseStoredCopy();
+
   pastra::StringMatcher* mMatcher;
   uint64_t mCachedCharsCount;
   uint64_t mCachedCharIndex;
   uint64_t mCachedCharIndexOffset;
   std::weak_ptr<ITextStrategy> mSelfShare;
+  std::weak_ptr<pastra::VariableSizeStore> mStoredCopy;
+  uint64_t mStoredCopyEntry;
+  uint32_t mStoredCopyGeneration;
   Lock mLock;
 };
 
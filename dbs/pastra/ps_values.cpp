@@ -46,6 +46,7 @@ using namespace pastra;
 
 
 static const uint_t  MAX_VALUE_RAW_STORAGE = Serializer::MAX_VALUE_RAW_SIZE;
+static const uint_t  MAX_VALUES_BATCH_STORAGE = 4096;
 static const uint_t  MNTH_DAYS[]           = MNTH_DAYS_A;
 
 extern const UTF8_CU_COUNTER _cuCache;
@@ -800,20 +801,26 @@ wh_array_init(const T* const array,
     throw DBSException(_EXTRA(DBSException::BAD_PARAMETERS));
 
   shared_ptr<IArrayStrategy> s = shared_make(TemporalArray, (array[0].DBSType()));
+  s->SetSelfReference(s);
 
+  uint8_t rawValues[MAX_VALUES_BATCH_STORAGE];
+
+  const uint_t elSize = Serializer::Size(array[0].DBSType(), false);
+  const uint_t batchCount = sizeof rawValues / elSize;
+
+  uint_t batchSize = 0;
   for (uint64_t index = 0; index < count; ++index)
   {
     uint64_t dummy;
 
-    if (array[index].IsNull())
-      continue;
-
-    uint8_t rawValue[MAX_VALUE_RAW_STORAGE];
+    if ( ! array[index].IsNull())
+      Serializer::Store(rawValues + batchSize++ * elSize, array[index]);
 
-    assert(sizeof rawValue <= Serializer::Size(array[0].DBSType(), false));
-
-    Serializer::Store(rawValue, array[index]);
-    s->Add(array[index].DBSType(), rawValue, &dummy);
+    if ((batchSize == batchCount) || ((batchSize > 0) && (index == count - 1)))
+    {
+      s->Add(array[0].DBSType(), rawValues, batchSize, &dummy);
+      batchSize = 0;
+    }
   }
   *outStrategy = s;
 }
@@ -1077,6 +1084,129 @@ DArray::Add(const DInt64& value)
   return add_array_element(value);
 }
 
+
+template <class T> inline uint64_t
+DArray::add_array_elements(const T* const values, const uint64_t count)
+{
+  uint8_t rawValues[MAX_VALUES_BATCH_STORAGE];
+
+  const uint_t elSize = Serializer::Size(values[0].DBSType(), false);
+  const uint_t batchCount = sizeof rawValues / elSize;
+
+  uint64_t result = Count();
+  for (uint64_t offset = 0; offset < count; offset += batchCount)
+  {
+    const uint_t toAdd = MIN(batchCount, count - offset);
+
+    for (uint_t i = 0; i < toAdd; ++i)
+    {
+      if (values[offset + i].IsNull())
+        throw DBSException(_EXTRA(DBSException::NULL_ARRAY_ELEMENT));
+
+      Serializer::Store(rawValues + i * elSize, values[offset + i]);
+    }
+
+    uint64_t index;
+    auto s = GetStrategy();
+    ReplaceStrategy(s->Add(values[0].DBSType(), rawValues, toAdd, &index));
+
+    if (offset == 0)
+      result = index;
+  }
+
+  return result;
+}
+
+uint64_t
+DArray::Add(const DBool* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DChar* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DDate* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DDateTime* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DHiresTime* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DUInt8* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DUInt16* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DUInt32* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DUInt64* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DReal* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DRichReal* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DInt8* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DInt16* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DInt32* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
+uint64_t
+DArray::Add(const DInt64* const values, const uint64_t count)
+{
+  return add_array_elements(values, count);
+}
+
 template <class T> void
 DArray::get_array_element(const uint64_t index, T& outElement) const
 {
@@ -1188,6 +1318,128 @@ DArray::Get(const uint64_t index, DInt64& outValue) const
 }
 
 
+template <class T> uint64_t
+DArray::get_array_elements(const uint64_t from,
+                           const uint64_t count,
+                           T* const outElements) const
+{
+  uint8_t rawValues[MAX_VALUES_BATCH_STORAGE];
+
+  auto s = GetStrategy();
+  if ((s->Count() > from) && (outElements[0].DBSType() != s->Type()))
+    throw DBSException(_EXTRA(DBSException::INVALID_ARRAY_TYPE));
+
+  const uint_t elSize = Serializer::Size(outElements[0].DBSType(), false);
+  const uint_t batchCount = sizeof rawValues / elSize;
+
+  uint64_t result = 0;
+  while (result < count)
+  {
+    const uint64_t batchResult = s->Get(from + result,
+                                        MIN(batchCount, count - result),
+                                        rawValues);
+    for (uint_t i = 0; i < batchResult; ++i)
+      Serializer::Load(rawValues + i * elSize, outElements + result + i);
+
+    result += batchResult;
+    if (batchResult < batchCount)
+      break;
+  }
+
+  return result;
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DBool* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DChar* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DDate* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DDateTime* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DHiresTime* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DUInt8* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DUInt16* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DUInt32* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DUInt64* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DReal* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DRichReal* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DInt8* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DInt16* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DInt32* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+uint64_t
+DArray::Get(const uint64_t from, const uint64_t count, DInt64* const outValues) const
+{
+  return get_array_elements(from, count, outValues);
+}
+
+
 template<class T> inline void
 DArray::set_array_element(const T& value, const uint64_t index)
 {
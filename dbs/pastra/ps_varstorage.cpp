@@ -42,99 +42,441 @@ namespace pastra {
 typedef bool(*VALUE_VALIDATOR) (const uint8_t* const);
 
 
-uint_t
-StoreEntry::Read(uint_t offset, uint_t count, uint8_t* buffer) const
+
+static const uint8_t STORE_SIGNATURE[] = { 0x50, 0x53, 0x56, 0x53, 0x54, 0x4F, 0x52, 0x45 };
+
+static const uint_t STORE_SIG_OFF         = 0;
+static const uint_t STORE_VERSION_OFF     = 8;
+static const uint_t STORE_TAIL_RUN_OFF    = 16;
+static const uint_t STORE_FREE_HEADS_UNIT = 1;
+
+//A free run keeps the previous run of its list right after its header, and
+//its units count in the last bytes of its last unit.
+static const uint_t FREE_RUN_PREV_OFF     = StoreExtent::HEADER_SIZE;
+static const uint_t FREE_RUN_FOOTER_OFF   = VariableSizeStore::UNIT_SIZE - sizeof(uint64_t);
+
+//Do not let a record's extent to grow too big, no matter how large the record is.
+static const uint64_t MAX_EXTENT_UNITS    = 0x100000;
+
+//How many runs of the requested size class to look at before trying the
+//bigger ones.
+static const uint_t MAX_SCANNED_RUNS      = 16;
+
+//The layout of the entries used by the previous format of the store.
+static const uint_t   LEGACY_ENTRY_SIZE        = 64;
+static const uint_t   LEGACY_ENTRY_NEXT_OFF    = 8;
+static const uint_t   LEGACY_ENTRY_DATA_OFF    = 16;
+static const uint_t   LEGACY_ENTRY_DATA_SIZE   = 48;
+static const uint64_t LEGACY_LAST_ENTRY        = 0x0FFFFFFFFFFFFFFFull;
+static const uint64_t LEGACY_DELETED_MASK      = 0x8000000000000000ull;
+static const uint64_t LEGACY_FIRST_MASK        = 0x4000000000000000ull;
+
+
+
+static uint_t
+size_class(uint64_t unitsCount)
 {
-  assert(IsDeleted() == false);
+  assert(unitsCount > 0);
 
-  if (count + offset > Size() )
-    count = Size() - offset;
+  uint_t result = 0;
+  while ((unitsCount > 1) && (result < VariableSizeStore::FREE_CLASSES - 1))
+    unitsCount >>= 1, ++result;
+
+  return result;
+}
 
-  memcpy(buffer, mRawData + offset, count);
 
-  return count;
+static uint64_t
+units_for(const uint64_t size)
+{
+  const uint64_t units = (size + StoreExtent::HEADER_SIZE + VariableSizeStore::UNIT_SIZE - 1)
+                         / VariableSizeStore::UNIT_SIZE;
+
+  return MIN(units, MAX_EXTENT_UNITS);
 }
 
 
-uint_t
-StoreEntry::Write(uint_t offset, uint_t count, const uint8_t* buffer)
+static uint64_t
+extent_capacity(const StoreExtent& extent)
+{
+  return _SC(uint64_t, extent.UnitsCount()) * VariableSizeStore::UNIT_SIZE
+         - StoreExtent::HEADER_SIZE;
+}
+
+
+class RecordSource
+{
+public:
+  virtual ~RecordSource() = default;
+
+  virtual void Read(const uint64_t offset, const uint64_t count, uint8_t* const to) = 0;
+};
+
+
+class BufferSource : public RecordSource
+{
+public:
+  BufferSource(const uint8_t* const buffer)
+    : mBuffer(buffer)
+  {
+  }
+
+  virtual void Read(const uint64_t offset, const uint64_t count, uint8_t* const to) override
+  {
+    memcpy(to, mBuffer + offset, count);
+  }
+
+private:
+  const uint8_t* const mBuffer;
+};
+
+
+class ContainerSource : public RecordSource
 {
-  assert(IsDeleted() == false);
+public:
+  ContainerSource(IDataContainer& container, const uint64_t from)
+    : mContainer(container),
+      mFrom(from)
+  {
+  }
+
+  virtual void Read(const uint64_t offset, const uint64_t count, uint8_t* const to) override
+  {
+    mContainer.Read(mFrom + offset, count, to);
+  }
+
+private:
+  IDataContainer&   mContainer;
+  const uint64_t    mFrom;
+};
+
+
+class StoreSource : public RecordSource
+{
+public:
+  StoreSource(VariableSizeStore& store, const uint64_t record, const uint64_t from)
+    : mStore(store),
+      mRecord(record),
+      mFrom(from)
+  {
+  }
+
+  virtual void Read(const uint64_t offset, const uint64_t count, uint8_t* const to) override
+  {
+    mStore.ReadRecord(mRecord, mFrom + offset, count, to);
+  }
+
+private:
+  VariableSizeStore&   mStore;
+  const uint64_t       mRecord;
+  const uint64_t       mFrom;
+};
+
+
+//Reads sequentially the content of a record while the storage is checked,
+//validating the extents it goes through.
+class RecordChecker
+{
+public:
+  RecordChecker(IDataContainer&   units,
+                EntriesBitmap&    usedUnits,
+                const uint64_t    unitsCount,
+                const uint64_t    firstExtent,
+                const uint64_t    recordSize)
+    : mUnits(units),
+      mUsedUnits(usedUnits),
+      mUnitsCount(unitsCount),
+      mNextExtent(firstExtent),
+      mRecordLeft(recordSize),
+      mExtentPosition(0),
+      mExtentLeft(0),
+      mBufferPosition(0),
+      mBufferSize(0)
+  {
+  }
+
+  bool Read(uint8_t* to, uint64_t count)
+  {
+    while (count > 0)
+    {
+      if ((mBufferPosition == mBufferSize) && ! FillBuffer())
+        return false;
+
+      const uint_t chunk = MIN(count, mBufferSize - mBufferPosition);
+
+      memcpy(to, mBuffer + mBufferPosition, chunk);
 
-  if (count + offset > Size() )
-    count = Size() - offset;
+      to += chunk, count -= chunk, mBufferPosition += chunk;
+    }
+
+    return true;
+  }
+
+  //Mark the record's units as used, if no other record has claimed them.
+  bool Claim()
+  {
+    if ((mRecordLeft != 0) || (mExtentLeft != 0) || (mBufferPosition != mBufferSize))
+      return false;
+
+    else if (mNextExtent != StoreExtent::LAST_EXTENT)
+      return false;
+
+    for (size_t e = 0; e < mExtents.size(); ++e)
+    {
+      for (uint64_t u = 0; u < mExtents[e].second; ++u)
+      {
+        if ( ! mUsedUnits.TestAndSet(mExtents[e].first + u))
+          continue;
+
+        //Some other record (or this one) uses it already.
+        while (u-- > 0)
+          mUsedUnits.Reset(mExtents[e].first + u);
+
+        while (e-- > 0)
+        {
+          for (u = 0; u < mExtents[e].second; ++u)
+            mUsedUnits.Reset(mExtents[e].first + u);
+        }
+
+        return false;
+      }
+    }
+
+    return true;
+  }
+
+private:
+  bool FillBuffer()
+  {
+    if ((mExtentLeft == 0) && ! NextExtent())
+      return false;
+
+    mBufferSize = MIN(sizeof mBuffer, mExtentLeft);
+    mBufferPosition = 0;
+
+    mUnits.Read(mExtentPosition, mBufferSize, mBuffer);
+
+    mExtentPosition += mBufferSize, mExtentLeft -= mBufferSize;
+
+    return true;
+  }
+
+  bool NextExtent()
+  {
+    const uint64_t extent = mNextExtent;
 
-  memcpy(mRawData + offset, buffer, count);
+    if ((mRecordLeft == 0)
+        || (extent < VariableSizeStore::HEADER_UNITS)
+        || (extent >= mUnitsCount)
+        || mUsedUnits.Test(extent))
+    {
+      return false;
+    }
+
+    StoreExtent header;
+    mUnits.Read(extent * VariableSizeStore::UNIT_SIZE, sizeof header, _RC(uint8_t*, &header));
+
+    const uint64_t count = header.UnitsCount();
+    if (header.IsFree()
+        || (header.IsFirst() != mExtents.empty())
+        || (header.IsFirst() && (header.RefCount() == 0))
+        || (count == 0)
+        || (count > mUnitsCount - extent))
+    {
+      return false;
+    }
 
-  return count;
+    mExtents.push_back(make_pair(extent, count));
+
+    mNextExtent = header.NextExtent();
+    mExtentPosition = extent * VariableSizeStore::UNIT_SIZE + StoreExtent::HEADER_SIZE;
+    mExtentLeft = MIN(extent_capacity(header), mRecordLeft);
+    mRecordLeft -= mExtentLeft;
+
+    return true;
+  }
+
+  IDataContainer&                         mUnits;
+  EntriesBitmap&                          mUsedUnits;
+  const uint64_t                          mUnitsCount;
+  uint64_t                                mNextExtent;
+  uint64_t                                mRecordLeft;
+  uint64_t                                mExtentPosition;
+  uint64_t                                mExtentLeft;
+  uint_t                                  mBufferPosition;
+  uint_t                                  mBufferSize;
+  vector<pair<uint64_t, uint64_t>>        mExtents;
+  uint8_t                                 mBuffer[4096];
+};
+
+
+void
+EntriesBitmap::Resize(const uint64_t count)
+{
+  mWords.resize((count + WORD_BITS - 1) / WORD_BITS, 0);
+
+  //Do not keep the state of the entries left out.
+  if ((count % WORD_BITS) != 0)
+    mWords.back() &= _SC(int32_t, (1u << (count % WORD_BITS)) - 1);
+
+  mSize = count;
 }
 
 
 void VariableSizeStore::Init(const char* tempDir, const uint32_t reservedMem)
 {
   mEntriesContainer.reset(new TemporalContainer());
-  mEntriesCount = 0;
+  mUnitsCount = 0;
 
-  FinishInit(true);
+  FinishInit(true, false);
 }
 
 
 void
 VariableSizeStore::Init(const char* baseName,
                         const uint64_t containerSize,
-                        const uint64_t maxFileSize)
+                        const uint64_t maxFileSize,
+                        const bool toCheck,
+                        IContainerJournal* const journal)
 {
   assert(maxFileSize != 0);
 
   const uint64_t unitsCount = (containerSize + maxFileSize - 1) / maxFileSize;
 
-  mEntriesContainer.reset(new FileContainer(baseName, maxFileSize, unitsCount, false));
-  mEntriesCount = mEntriesContainer->Size() / sizeof(StoreEntry);
+  mBaseName = baseName;
+  mMaxFileSize = maxFileSize;
+
+  FileContainer* const container = new FileContainer(baseName, maxFileSize, unitsCount, false);
+
+  mEntriesContainer.reset(container);
+  if (journal != nullptr)
+    journal->Attach( *container);
+
+  mUnitsCount = mEntriesContainer->Size() / UNIT_SIZE;
+
+  FinishInit(false, toCheck);
+}
+
+
+void
+VariableSizeStore::FinishInit(const bool nonPersitentData, const bool toCheck)
+{
+  assert(sizeof(StoreExtent) == StoreExtent::HEADER_SIZE);
+  assert(FREE_CLASSES * sizeof(uint64_t) <= (HEADER_UNITS - STORE_FREE_HEADS_UNIT) * UNIT_SIZE);
+
+  memset(mFreeHeads, 0, sizeof mFreeHeads);
+  mTailFreeRun = 0;
+
+  if (mUnitsCount == 0)
+    WriteStoreHeader();
 
-  FinishInit(false);
+  else if ( ! toCheck)
+  {
+    uint8_t header[HEADER_UNITS * UNIT_SIZE];
+
+    if (mUnitsCount >= HEADER_UNITS)
+      mEntriesContainer->Read(0, sizeof header, header);
+
+    if ((mUnitsCount < HEADER_UNITS)
+        || (memcmp(header + STORE_SIG_OFF, STORE_SIGNATURE, sizeof STORE_SIGNATURE) != 0)
+        || (load_le_int32(header + STORE_VERSION_OFF) != FORMAT_VERSION))
+    {
+      throw DBSException(_EXTRA(DBSException::TABLE_INVALID),
+                         "The variable size store '%s' has an invalid header.",
+                         mBaseName.c_str());
+    }
+
+    mTailFreeRun = load_le_int64(header + STORE_TAIL_RUN_OFF);
+    for (uint_t c = 0; c < FREE_CLASSES; ++c)
+    {
+      mFreeHeads[c] = load_le_int64(header
+                                    + STORE_FREE_HEADS_UNIT * UNIT_SIZE
+                                    + c * sizeof(uint64_t));
+    }
+  }
+
+  InitCache(nonPersitentData);
+}
+
+
+void
+VariableSizeStore::InitCache(const bool nonPersitentData)
+{
+  uint_t blkSize = DBSSettings().mVLStoreCacheBlkSize;
+  const uint_t blkCount = DBSSettings().mVLStoreCacheBlkCount;
+
+  assert((blkSize != 0) && (blkCount != 0));
+
+  while (blkSize < UNIT_SIZE)
+    blkSize *= 2;
+
+  mBlockUnits = blkSize / UNIT_SIZE;
+  mEntriesCache.Init( *this, UNIT_SIZE, blkSize, blkCount, nonPersitentData);
+}
+
+
+void
+VariableSizeStore::WriteStoreHeader()
+{
+  uint8_t header[HEADER_UNITS * UNIT_SIZE];
+
+  memset(header, 0, sizeof header);
+  memcpy(header + STORE_SIG_OFF, STORE_SIGNATURE, sizeof STORE_SIGNATURE);
+  store_le_int32(FORMAT_VERSION, header + STORE_VERSION_OFF);
+  store_le_int64(mTailFreeRun, header + STORE_TAIL_RUN_OFF);
+
+  for (uint_t c = 0; c < FREE_CLASSES; ++c)
+  {
+    store_le_int64(mFreeHeads[c],
+                   header + STORE_FREE_HEADS_UNIT * UNIT_SIZE + c * sizeof(uint64_t));
+  }
+
+  mEntriesContainer->Write(0, sizeof header, header);
+
+  mUnitsCount = MAX(mUnitsCount, HEADER_UNITS);
 }
 
 
 void
 VariableSizeStore::PrepareToCheckStorage()
 {
-  assert(mUsedEntries.size() == 0);
+  assert(mUsedEntries.Size() == 0);
 
   //Disable the cache block.
   mEntriesCache.~BlockCache();
   memset(_RC(void*, &mEntriesCache), 0, sizeof(mEntriesCache));
 
-  assert(mEntriesCount > 0);
-
-  mUsedEntries.resize(mEntriesCount, false);
-  mUsedEntries[0] = true; //The first entry is always in use. It holds the
-                          //chain head of the removed ones.
-
-  const uint64_t containerSize = mEntriesCount * sizeof(StoreEntry);
+  const uint64_t containerSize = mUnitsCount * UNIT_SIZE;
 
   if (containerSize < mEntriesContainer->Size())
     mEntriesContainer->Colapse(containerSize, mEntriesContainer->Size());
+
+  //Too small to hold anything, start over.
+  if (mUnitsCount < HEADER_UNITS)
+  {
+    mEntriesContainer->Colapse(0, mEntriesContainer->Size());
+    mUnitsCount = 0;
+
+    WriteStoreHeader();
+  }
+
+  mUsedEntries.Resize(mUnitsCount);
+  mCheckedRecords.clear();
+
+  //The units holding the store's header are always in use.
+  for (uint64_t unit = 0; unit < HEADER_UNITS; ++unit)
+    mUsedEntries.TestAndSet(unit);
 }
 
 
-static bool
-is_entry_valid(const StoreEntry&    entry,
-               const uint64_t       prevEntry,
-               const bool           firstEntry,
-               const bool           lastEntry)
+unique_ptr<IDataContainer>
+VariableSizeStore::OpenEntriesReader() const
 {
-  if (firstEntry && ! entry.IsFirstEntry())
-    return false;
+  assert(mMaxFileSize > 0);
 
-  else if ( ! firstEntry && entry.IsFirstEntry())
-    return false;
+  const uint64_t unitsCount = (mEntriesContainer->Size() + mMaxFileSize - 1) / mMaxFileSize;
 
-  else if (lastEntry && (entry.NextEntry() != StoreEntry::LAST_CHAINED_ENTRY))
-    return false;
-
-  return firstEntry
-         ? entry.PrevEntry() >= StoreEntry::FIRST_PREV_ENTRY
-         : entry.PrevEntry() == prevEntry;
+  return unique_make(FileContainer, mBaseName.c_str(), mMaxFileSize, unitsCount, false);
 }
 
 
@@ -142,33 +484,35 @@ bool
 VariableSizeStore::CheckArrayEntry(const uint64_t         recordFirstEntry,
                                    const uint64_t         recordSize,
                                    const DBS_FIELD_TYPE   itemType)
+{
+  return CheckArrayEntry( *mEntriesContainer, recordFirstEntry, recordSize, itemType);
+}
+
+
+bool
+VariableSizeStore::CheckArrayEntry(IDataContainer&        entries,
+                                   const uint64_t         recordFirstEntry,
+                                   const uint64_t         recordSize,
+                                   const DBS_FIELD_TYPE   itemType)
 {
   if (_SC(int64_t, recordSize) <= Serializer::Size(itemType, true) - 1)
     return false;
 
+  bool valid;
+  if (ReferCheckedRecord(recordFirstEntry, recordSize, itemType, &valid))
+    return valid;
+
   const uint_t itemSize = Serializer::Size(itemType, false);
 
   const Serializer::VALUE_VALIDATOR validator = Serializer::SelectValidator(itemType);
 
-  uint64_t currentEntry = recordFirstEntry;
-  uint64_t prevEntry = 0;
-  StoreEntry vsEntry;
-  vector<uint64_t> entriesUsed;
-
-  if ((recordFirstEntry >= mUsedEntries.size()) || mUsedEntries[currentEntry])
-    return false;
+  RecordChecker record(entries, mUsedEntries, mUnitsCount, recordFirstEntry, recordSize);
 
-  entriesUsed.push_back(currentEntry);
-  mEntriesContainer.get()->Read(currentEntry * sizeof vsEntry,
-                                sizeof vsEntry,
-                                _RC(uint8_t*, &vsEntry));
-  if (vsEntry.IsDeleted())
+  uint8_t buffer[sizeof(uint64_t)];
+  if ( ! record.Read(buffer, sizeof buffer))
     return false;
 
-  uint8_t temp[sizeof(uint64_t)];
-  vsEntry.Read(0, sizeof temp, temp);
-
-  const uint64_t itemsCount = load_le_int64(temp);
+  const uint64_t itemsCount = load_le_int64(buffer);
   if ((itemsCount == 0)
       || ((recordSize - sizeof(uint64_t)) % itemSize != 0)
       || ((recordSize - sizeof(uint64_t)) / itemSize != itemsCount))
@@ -176,112 +520,46 @@ VariableSizeStore::CheckArrayEntry(const uint64_t         recordFirstEntry,
     return false;
   }
 
-  uint64_t actualSize = sizeof(uint64_t);
-  uint64_t itemsChecked = 0;
-  uint_t itemBytesRead = 0;
-  uint8_t itemBuffer[StoreEntry::ENTRY_SIZE];
-  bool entryValidated = false;
-  while (itemsChecked < itemsCount)
-  {
-    const bool lastEntry = (recordSize - actualSize)
-        <= (StoreEntry::ENTRY_SIZE - actualSize % StoreEntry::ENTRY_SIZE);
-    if ( ! entryValidated
-        && ! is_entry_valid(vsEntry, prevEntry, currentEntry == recordFirstEntry, lastEntry))
-    {
-      return false;
-    }
-    else
-      entryValidated = true;
-
-    if (itemBytesRead == 0)
-    {
-      if (itemSize > StoreEntry::ENTRY_SIZE - actualSize % StoreEntry::ENTRY_SIZE)
-        itemBytesRead = StoreEntry::ENTRY_SIZE - actualSize % StoreEntry::ENTRY_SIZE;
-
-      else
-        itemBytesRead = itemSize;
+  uint8_t itemBuffer[64];
 
-      vsEntry.Read(actualSize % StoreEntry::ENTRY_SIZE, itemBytesRead, itemBuffer);
+  assert(itemSize <= sizeof itemBuffer);
 
-      actualSize += itemBytesRead;
-    }
-    else
-    {
-      assert(itemBytesRead < itemSize);
-      assert(actualSize % StoreEntry::ENTRY_SIZE == 0);
-
-      vsEntry.Read(actualSize % StoreEntry::ENTRY_SIZE,
-                   itemSize - itemBytesRead,
-                   itemBuffer + itemBytesRead);
-
-      actualSize += itemSize - itemBytesRead;
-      itemBytesRead = itemSize;
-    }
-
-    if (itemBytesRead == itemSize)
-    {
-      ++itemsChecked;
-      itemBytesRead = 0;
-
-      if ( !validator(itemBuffer))
-        return false;
-    }
-
-    if ((itemsChecked < itemsCount) && (actualSize % StoreEntry::ENTRY_SIZE == 0))
-    {
-      prevEntry = currentEntry;
-      currentEntry = vsEntry.NextEntry();
-
-      if (currentEntry >= mEntriesCount
-          || mUsedEntries[currentEntry])
-      {
-        return false;
-      }
-      else
-        entriesUsed.push_back(currentEntry);
-
-      mEntriesContainer.get()->Read(currentEntry * sizeof vsEntry,
-                                    sizeof vsEntry,
-                                    _RC(uint8_t*, &vsEntry));
-      entryValidated = false;
-    }
+  for (uint64_t item = 0; item < itemsCount; ++item)
+  {
+    if ( ! record.Read(itemBuffer, itemSize) || ! validator(itemBuffer))
+      return false;
   }
 
-  if (actualSize != recordSize)
-    return false;
+  return ClaimCheckedRecord(record, recordFirstEntry, recordSize, itemType);
+}
 
-  for (size_t i = 0; i < entriesUsed.size(); ++i)
-    mUsedEntries[entriesUsed[i]] = true;
 
-  return true;
+bool
+VariableSizeStore::CheckTextEntry(const uint64_t   recordFirstEntry,
+                                  const uint64_t   recordSize)
+{
+  return CheckTextEntry( *mEntriesContainer, recordFirstEntry, recordSize);
 }
 
 
 bool
-VariableSizeStore::CheckTextEntry(const uint64_t   recordFirstEntry,
+VariableSizeStore::CheckTextEntry(IDataContainer&  entries,
+                                  const uint64_t   recordFirstEntry,
                                   const uint64_t   recordSize)
 {
   if (_SC(int64_t, recordSize) <= Serializer::Size(T_TEXT, false) - 1)
     return false;
 
-  uint64_t currentEntry = recordFirstEntry;
-  uint64_t prevEntry = 0;
-  StoreEntry vsEntry;
-  vector<uint64_t> entriesUsed;
+  bool valid;
+  if (ReferCheckedRecord(recordFirstEntry, recordSize, T_TEXT, &valid))
+    return valid;
 
-  if ((recordFirstEntry >= mUsedEntries.size()) || mUsedEntries[currentEntry])
-    return false;
+  RecordChecker record(entries, mUsedEntries, mUnitsCount, recordFirstEntry, recordSize);
 
-  entriesUsed.push_back(currentEntry);
-  mEntriesContainer.get()->Read(currentEntry * sizeof vsEntry,
-                                sizeof vsEntry,
-                                _RC(uint8_t*, &vsEntry));
-  if (vsEntry.IsDeleted())
+  uint8_t temp[RowFieldText::CACHE_META_DATA_SIZE];
+  if ( ! record.Read(temp, sizeof temp))
     return false;
 
-  uint8_t temp[StoreEntry::ENTRY_SIZE];
-  vsEntry.Read(0, sizeof temp, temp);
-
   const uint32_t charsCount = load_le_int32(temp);
   const uint32_t charIndex = load_le_int32(temp + sizeof(uint32_t));
   const uint32_t charOffset = load_le_int32(temp + 2 * sizeof(uint32_t));
@@ -290,231 +568,204 @@ VariableSizeStore::CheckTextEntry(const uint64_t   recordFirstEntry,
     return false;
 
   uint32_t checkedChars = 0;
-  uint32_t actualSize = RowFieldText::CACHE_META_DATA_SIZE;
+  uint64_t actualSize = RowFieldText::CACHE_META_DATA_SIZE;
 
-  uint8_t readCodeUnits = 0;
-  uint8_t codeUnitsCount = 0;
   uint8_t codeUnits[7]; //UTF-8 has a maximum of 6 code units per
-  bool entryValidated = false;
   while (checkedChars < charsCount)
   {
-    const bool lastEntry = (recordSize - actualSize)
-        <= (StoreEntry::ENTRY_SIZE - actualSize % StoreEntry::ENTRY_SIZE);
+    if ((actualSize >= recordSize) || ! record.Read(codeUnits, 1))
+      return false;
 
-    if ( !entryValidated
-        && !is_entry_valid(vsEntry, prevEntry, currentEntry == recordFirstEntry, lastEntry))
-    {
+    const uint_t codeUnitsCount = wh_utf8_cu_count(codeUnits[0]);
+    if ((codeUnitsCount == 0) || (actualSize + codeUnitsCount > recordSize))
       return false;
-    }
-    else
-      entryValidated = true;
 
-    if (readCodeUnits == 0)
+    else if (checkedChars == charIndex
+             && charOffset != (actualSize - RowFieldText::CACHE_META_DATA_SIZE))
     {
-      codeUnitsCount = wh_utf8_cu_count(temp[actualSize % StoreEntry::ENTRY_SIZE]);
-      if ((codeUnitsCount == 0) || (actualSize + codeUnitsCount > recordSize))
-      {
-        return false;
-      }
-
-      else if (checkedChars == charIndex
-               && charOffset != (actualSize - RowFieldText::CACHE_META_DATA_SIZE))
-      {
-        return false;
-      }
-
-      if (codeUnitsCount > StoreEntry::ENTRY_SIZE - actualSize % StoreEntry::ENTRY_SIZE)
-      {
-        readCodeUnits = StoreEntry::ENTRY_SIZE - actualSize % StoreEntry::ENTRY_SIZE;
-      }
-      else
-        readCodeUnits = codeUnitsCount;
-
-      memcpy(codeUnits, temp + actualSize % StoreEntry::ENTRY_SIZE, readCodeUnits);
-
-      actualSize += readCodeUnits;
+      return false;
     }
-    else
-    {
-      assert(readCodeUnits < codeUnitsCount);
-      assert(actualSize % StoreEntry::ENTRY_SIZE == 0);
 
-      memcpy(codeUnits + readCodeUnits,
-             temp + actualSize % StoreEntry::ENTRY_SIZE,
-             codeUnitsCount - readCodeUnits);
-
-      actualSize += codeUnitsCount - readCodeUnits;
-      readCodeUnits = codeUnitsCount;
-    }
+    if ( ! record.Read(codeUnits + 1, codeUnitsCount - 1))
+      return false;
 
     try
     {
-      if (readCodeUnits == codeUnitsCount)
-      {
-        uint32_t codePoint;
-        wh_load_utf8_cp(codeUnits, &codePoint);
+      uint32_t codePoint;
+      wh_load_utf8_cp(codeUnits, &codePoint);
 
-        //Throw an exception if the code point is not Unicode valid.
-        DChar validateCodePoint(codePoint);
-
-        ++checkedChars;
-        readCodeUnits = codeUnitsCount = 0;
-      }
+      //Throw an exception if the code point is not Unicode valid.
+      DChar validateCodePoint(codePoint);
     }
     catch (...)
     {
       return false;
     }
 
-    if ((checkedChars < charsCount) && (actualSize % StoreEntry::ENTRY_SIZE == 0))
-    {
-      prevEntry = currentEntry;
-      currentEntry = vsEntry.NextEntry();
-
-      if ((currentEntry >= mEntriesCount) || mUsedEntries[currentEntry])
-      {
-        return false;
-      }
-      else
-        entriesUsed.push_back(currentEntry);
-
-      mEntriesContainer.get()->Read(currentEntry * sizeof vsEntry,
-                                    sizeof vsEntry,
-                                    _RC(uint8_t*, &vsEntry));
-      vsEntry.Read(0, sizeof temp, temp);
-    }
+    actualSize += codeUnitsCount;
+    ++checkedChars;
   }
 
   if (actualSize != recordSize)
     return false;
 
-  for (size_t i = 0; i < entriesUsed.size(); ++i)
-    mUsedEntries[entriesUsed[i]] = true;
-
-  return true;
+  return ClaimCheckedRecord(record, recordFirstEntry, recordSize, T_TEXT);
 }
 
 
-void
-VariableSizeStore::ConcludeStorageCheck()
+//Counts one more row referring an already checked record. Returns false if the
+//record was not checked yet.
+bool
+VariableSizeStore::ReferCheckedRecord(const uint64_t   recordFirstEntry,
+                                      const uint64_t   recordSize,
+                                      const uint_t     kind,
+                                      bool* const      outValid)
 {
-  assert(mUsedEntries[0]);
-  assert(mUsedEntries.size() == mEntriesCount);
+  LockGuard<Lock> sync(mSync);
 
-  while (mEntriesCount > 0)
-  {
-    if (mUsedEntries[mEntriesCount - 1])
-      break;
+  auto it = mCheckedRecords.find(recordFirstEntry);
+  if (it == mCheckedRecords.end())
+    return false;
 
-    --mEntriesCount;
-  }
+  //A row may refer a shared record only as the same kind of value.
+  *outValid = (it->second.mSize == recordSize) && (it->second.mKind == kind);
+  if (*outValid)
+    ++it->second.mRefsCount;
 
-  const uint64_t containerSize = mEntriesCount * sizeof(StoreEntry);
+  return true;
+}
 
-  if (containerSize <= mEntriesContainer->Size())
-    mEntriesContainer->Colapse(containerSize, mEntriesContainer->Size());
 
-  else
+bool
+VariableSizeStore::ClaimCheckedRecord(RecordChecker&   record,
+                                      const uint64_t   recordFirstEntry,
+                                      const uint64_t   recordSize,
+                                      const uint_t     kind)
+{
+  LockGuard<Lock> sync(mSync);
+
+  //Another row could have checked the same record meanwhile.
+  auto it = mCheckedRecords.find(recordFirstEntry);
+  if (it != mCheckedRecords.end())
   {
-    assert(false);
+    const bool valid = (it->second.mSize == recordSize) && (it->second.mKind == kind);
+    if (valid)
+      ++it->second.mRefsCount;
+
+    return valid;
   }
 
-  assert(mEntriesCount >= 1);
+  if ( ! record.Claim())
+    return false;
 
-  mUsedEntries.resize(mEntriesCount);
+  mCheckedRecords[recordFirstEntry] = {recordSize, kind, 1};
 
-  StoreEntry templateEntry;
+  return true;
+}
 
-  mEntriesContainer.get()->Read(0, sizeof templateEntry, _RC(uint8_t*, &templateEntry));
 
-  templateEntry.MarkAsDeleted(true);
-  templateEntry.MarkAsFirstEntry(false);
-  templateEntry.PrevEntry(0);
+void
+VariableSizeStore::ConcludeStorageCheck()
+{
+  assert(mUsedEntries.Test(0));
+  assert(mUsedEntries.Size() == mUnitsCount);
 
-  templateEntry.NextEntry(StoreEntry::LAST_DELETED_ENTRY);
-  mFirstFreeEntry = StoreEntry::LAST_DELETED_ENTRY;
+  uint64_t lastInClass[FREE_CLASSES];
 
-  uint64_t lastFreeEntry = 0, currentEntry = 1;
-  while (currentEntry < mUsedEntries.size())
+  memset(mFreeHeads, 0, sizeof mFreeHeads);
+  memset(lastInClass, 0, sizeof lastInClass);
+  mTailFreeRun = 0;
+
+  //Rebuild the free runs lists from the units left unclaimed, and let go the
+  //ones found at the end.
+  bool prevFree = false;
+  uint64_t unit = HEADER_UNITS;
+  while (unit < mUnitsCount)
   {
-    if (mUsedEntries[currentEntry])
+    if (mUsedEntries.Test(unit))
     {
-      currentEntry++;
-      continue;
-    }
+      StoreExtent header;
 
-    templateEntry.NextEntry(currentEntry);
+      mEntriesContainer->Read(unit * UNIT_SIZE, sizeof header, _RC(uint8_t*, &header));
 
-    if (mFirstFreeEntry == StoreEntry::LAST_DELETED_ENTRY)
-      mFirstFreeEntry = currentEntry;
+      //A record is left referred by the rows found to use it.
+      header.MarkPrevFree(prevFree);
+      if (header.IsFirst())
+      {
+        assert(mCheckedRecords.count(unit) == 1);
 
-    mEntriesContainer.get()->Write(lastFreeEntry * sizeof templateEntry,
-                                   sizeof templateEntry,
-                                   _RC(uint8_t*, &templateEntry));
+        header.RefCount(mCheckedRecords[unit].mRefsCount);
+      }
 
-    templateEntry.PrevEntry(lastFreeEntry);
-    templateEntry.NextEntry(StoreEntry::LAST_DELETED_ENTRY);
+      mEntriesContainer->Write(unit * UNIT_SIZE, sizeof header, _RC(uint8_t*, &header));
 
-    lastFreeEntry = currentEntry++;
-  }
+      assert(header.UnitsCount() > 0);
 
-  mEntriesContainer.get()->Write(lastFreeEntry * sizeof templateEntry,
-                                 sizeof templateEntry,
-                                 _RC(uint8_t*, &templateEntry));
+      unit += header.UnitsCount();
+      prevFree = false;
+      continue;
+    }
 
-  _placement_new(_RC(void*, &mEntriesCache), BlockCache());
+    uint64_t runEnd = unit + 1;
+    while ((runEnd < mUnitsCount) && ! mUsedEntries.Test(runEnd))
+      ++runEnd;
 
-  uint_t blkSize = DBSSettings().mVLStoreCacheBlkSize;
-  const uint_t blkCount = DBSSettings().mVLStoreCacheBlkCount;
+    if (runEnd == mUnitsCount)
+    {
+      mUnitsCount = unit;
+      break;
+    }
 
-  assert((blkSize != 0) && (blkCount != 0));
+    const uint64_t count = runEnd - unit;
+    const uint_t sizeClass = size_class(count);
 
-  while (blkSize < sizeof(StoreEntry))
-    blkSize *= 2;
+    uint8_t run[FREE_RUN_PREV_OFF + sizeof(uint64_t)];
+    StoreExtent& header = *_RC(StoreExtent*, run);
 
-  mEntriesCache.Init( *this, sizeof(StoreEntry), blkSize, blkCount, false);
-}
+    memset(run, 0, sizeof run);
+    header.MarkAsFree(true);
+    header.UnitsCount(count);
+    store_le_int64(lastInClass[sizeClass], run + FREE_RUN_PREV_OFF);
 
-void
-VariableSizeStore::FinishInit(const bool nonPersitentData)
-{
-  if (mEntriesCount == 0)
-  {
-    StoreEntry entry;
+    mEntriesContainer->Write(unit * UNIT_SIZE, sizeof run, run);
 
-    entry.MarkAsDeleted(true);
-    entry.MarkAsFirstEntry(false);
+    store_le_int64(count, run);
+    mEntriesContainer->Write(runEnd * UNIT_SIZE - sizeof(uint64_t), sizeof(uint64_t), run);
 
-    entry.PrevEntry(0);
-    entry.NextEntry(StoreEntry::LAST_DELETED_ENTRY);
+    if (lastInClass[sizeClass] == 0)
+      mFreeHeads[sizeClass] = unit;
 
-    mEntriesContainer.get()->Write(0, sizeof entry, _RC(uint8_t*, &entry));
+    else
+    {
+      StoreExtent prevHeader;
+
+      mEntriesContainer->Read(lastInClass[sizeClass] * UNIT_SIZE,
+                              sizeof prevHeader,
+                              _RC(uint8_t*, &prevHeader));
+      prevHeader.NextExtent(unit);
+      mEntriesContainer->Write(lastInClass[sizeClass] * UNIT_SIZE,
+                               sizeof prevHeader,
+                               _RC(uint8_t*, &prevHeader));
+    }
 
-    mEntriesCount++;
+    lastInClass[sizeClass] = unit;
+    prevFree = true;
+    unit = runEnd;
   }
 
-  uint_t blkSize = DBSSettings().mVLStoreCacheBlkSize;
-  const uint_t blkCount = DBSSettings().mVLStoreCacheBlkCount;
+  const uint64_t containerSize = mUnitsCount * UNIT_SIZE;
 
-  assert((blkSize != 0) && (blkCount != 0));
-
-  while (blkSize < sizeof(StoreEntry))
-    blkSize *= 2;
+  assert(containerSize <= mEntriesContainer->Size());
 
-  mEntriesCache.Init( *this, sizeof(StoreEntry), blkSize, blkCount, nonPersitentData);
+  mEntriesContainer->Colapse(containerSize, mEntriesContainer->Size());
+  mUsedEntries.Resize(0);
+  mCheckedRecords.clear();
 
-  StoredItem cachedItem = mEntriesCache.RetriveItem(0);
-  const StoreEntry* const entry = _RC(const StoreEntry*, cachedItem.GetDataForRead());
+  WriteStoreHeader();
 
-  //TBD: What we should with these? Leave them like this for now, maybe we are
-  //     in the middle of a repair.
-  //assert(entry->IsDeleted());
-  //assert(entry->IsFirstEntry() == false);
-
-  mFirstFreeEntry = entry->NextEntry();
+  _placement_new(_RC(void*, &mEntriesCache), BlockCache());
 
-  assert((mEntriesContainer->Size() % sizeof(StoreEntry)) == 0);
-  assert(mEntriesCount > 0);
+  InitCache(false);
 }
 
 
@@ -527,6 +778,15 @@ VariableSizeStore::Flush()
 }
 
 
+bool
+VariableSizeStore::FlushSome(const uint_t maxBlocks)
+{
+  LockGuard<Lock> sync(mSync);
+
+  return mEntriesCache.FlushSome(maxBlocks);
+}
+
+
 void
 VariableSizeStore::MarkForRemoval()
 {
@@ -534,33 +794,33 @@ VariableSizeStore::MarkForRemoval()
 }
 
 
-uint64_t
-VariableSizeStore::AddRecord(const uint8_t* buffer, const uint64_t size)
+void
+VariableSizeStore::MarkClosed()
 {
-  assert(mUsedEntries.size() == 0);
-
   LockGuard<Lock> sync(mSync);
 
-  uint64_t resultEntry = AllocateEntry(0);
-  StoredItem cachedItem = mEntriesCache.RetriveItem(resultEntry);
-  StoreEntry* entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
+  mClosed = true;
+}
 
-  entry->MarkAsDeleted(false);
-  entry->MarkAsFirstEntry(true);
 
-  entry->NextEntry(StoreEntry::LAST_CHAINED_ENTRY);
-  entry->PrevEntry(StoreEntry::FIRST_PREV_ENTRY);
+uint64_t
+VariableSizeStore::AddRecord(const uint8_t* buffer, const uint64_t size)
+{
+  assert(mUsedEntries.Size() == 0);
+
+  LockGuard<Lock> sync(mSync);
 
-  sync.unlock();
+  const uint64_t result = NewRecord(size);
 
-  if ((resultEntry != 0) && (size > 0))
+  if (size > 0)
   {
     assert(buffer != nullptr);
 
-    UpdateRecord(resultEntry, 0, size, buffer);
+    BufferSource source(buffer);
+    WriteRecord(result, 0, size, source);
   }
 
-  return resultEntry;
+  return result;
 }
 
 
@@ -570,28 +830,19 @@ VariableSizeStore::AddRecord(VariableSizeStore& sourceStore,
                              uint64_t           sourceOffset,
                              uint64_t           sourceSize)
 {
-  assert(mUsedEntries.size() == 0);
-
-  LockGuard<Lock> sync(mSync);
+  assert(mUsedEntries.Size() == 0);
 
-  uint64_t resultEntry = AllocateEntry(0);
-  StoredItem cachedItem = mEntriesCache.RetriveItem(resultEntry);
-  StoreEntry* entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
-
-  entry->MarkAsDeleted(false);
-  entry->MarkAsFirstEntry(true);
-
-  entry->NextEntry(StoreEntry::LAST_CHAINED_ENTRY);
-  entry->PrevEntry(StoreEntry::FIRST_PREV_ENTRY);
+  DoubleLockGuard<Lock> sync(mSync, sourceStore.mSync);
 
-  sync.unlock();
+  const uint64_t result = NewRecord(sourceSize);
 
-  if ((resultEntry != 0) && (sourceSize > 0))
+  if (sourceSize > 0)
   {
-    UpdateRecord(resultEntry, 0, sourceStore, sourceFirstEntry, sourceOffset, sourceSize);
+    StoreSource source(sourceStore, sourceFirstEntry, sourceOffset);
+    WriteRecord(result, 0, sourceSize, source);
   }
 
-  return resultEntry;
+  return result;
 }
 
 
@@ -600,26 +851,80 @@ VariableSizeStore::AddRecord(IDataContainer& sourceContainer,
                              uint64_t        sourceOffset,
                              uint64_t        sourceSize)
 {
-  assert(mUsedEntries.size() == 0);
+  assert(mUsedEntries.Size() == 0);
 
   LockGuard<Lock> sync(mSync);
 
-  uint64_t resultEntry = AllocateEntry(0);
-  StoredItem cachedItem = mEntriesCache.RetriveItem(resultEntry);
-  StoreEntry* entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
+  const uint64_t result = NewRecord(sourceSize);
 
-  entry->MarkAsDeleted(false);
-  entry->MarkAsFirstEntry(true);
+  if (sourceSize > 0)
+  {
+    ContainerSource source(sourceContainer, sourceOffset);
+    WriteRecord(result, 0, sourceSize, source);
+  }
+
+  return result;
+}
 
-  entry->NextEntry(StoreEntry::LAST_CHAINED_ENTRY);
-  entry->PrevEntry(StoreEntry::FIRST_PREV_ENTRY);
 
-  sync.unlock();
+uint64_t
+VariableSizeStore::ImportLegacyRecord(IDataContainer&  legacyEntries,
+                                      const uint64_t   legacyFirstEntry,
+                                      const uint64_t   recordSize)
+{
+  assert(mUsedEntries.Size() == 0);
+
+  LockGuard<Lock> sync(mSync);
 
-  if ((resultEntry != 0) && (sourceSize > 0))
-    UpdateRecord(resultEntry, 0, sourceContainer, sourceOffset, sourceSize);
+  const uint64_t entriesCount = legacyEntries.Size() / LEGACY_ENTRY_SIZE;
+  const uint64_t result = NewRecord(recordSize);
+
+  uint8_t buffer[LEGACY_ENTRY_DATA_SIZE * 64];
+  uint_t bufferSize = 0;
+  uint64_t written = 0, entry = legacyFirstEntry;
+
+  while (written + bufferSize < recordSize)
+  {
+    uint8_t legacyEntry[LEGACY_ENTRY_SIZE];
+
+    if ((entry == 0) || (entry >= entriesCount))
+    {
+      RemoveRecord(result);
+      return 0;
+    }
+
+    legacyEntries.Read(entry * LEGACY_ENTRY_SIZE, sizeof legacyEntry, legacyEntry);
+
+    const uint64_t link = load_le_int64(legacyEntry + LEGACY_ENTRY_NEXT_OFF);
+    if (((link & LEGACY_DELETED_MASK) != 0)
+        || (((link & LEGACY_FIRST_MASK) != 0) != (entry == legacyFirstEntry)))
+    {
+      RemoveRecord(result);
+      return 0;
+    }
+
+    const uint_t chunk = MIN(LEGACY_ENTRY_DATA_SIZE, recordSize - written - bufferSize);
+
+    memcpy(buffer + bufferSize, legacyEntry + LEGACY_ENTRY_DATA_OFF, chunk);
+    bufferSize += chunk;
+
+    if ((bufferSize == sizeof buffer) || (written + bufferSize == recordSize))
+    {
+      BufferSource source(buffer);
+      WriteRecord(result, written, bufferSize, source);
 
-  return resultEntry;
+      written += bufferSize, bufferSize = 0;
+    }
+
+    entry = link & ~(LEGACY_DELETED_MASK | LEGACY_FIRST_MASK);
+    if ((entry == LEGACY_LAST_ENTRY) && (written + bufferSize < recordSize))
+    {
+      RemoveRecord(result);
+      return 0;
+    }
+  }
+
+  return result;
 }
 
 
@@ -629,649 +934,717 @@ VariableSizeStore::GetRecord(uint64_t  recordFirstEntry,
                              uint64_t  size,
                              uint8_t*  buffer)
 {
-  assert(mUsedEntries.size() == 0);
+  assert(mUsedEntries.Size() == 0);
+
+  LockGuard<Lock> sync(mSync);
+
+  ReadRecord(recordFirstEntry, offset, size, buffer);
+}
+
+
+void
+VariableSizeStore::UpdateRecord(uint64_t       recordFirstEntry,
+                                uint64_t       offset,
+                                uint64_t       size,
+                                const uint8_t* buffer)
+{
+  assert(mUsedEntries.Size() == 0);
+
+  LockGuard<Lock> sync(mSync);
+
+  if (mClosed)
+    return;
+
+  BufferSource source(buffer);
+  WriteRecord(recordFirstEntry, offset, size, source);
+}
+
+
+void
+VariableSizeStore::UpdateRecord(uint64_t           recordFirstEntry,
+                                uint64_t           offset,
+                                VariableSizeStore& sourceStore,
+                                uint64_t           sourceFirstEntry,
+                                uint64_t           sourceOffset,
+                                uint64_t           sourceSize)
+{
+  assert(mUsedEntries.Size() == 0);
+
+  DoubleLockGuard<Lock> sync(mSync, sourceStore.mSync);
+
+  StoreSource source(sourceStore, sourceFirstEntry, sourceOffset);
+  WriteRecord(recordFirstEntry, offset, sourceSize, source);
+}
 
+
+void
+VariableSizeStore::UpdateRecord(uint64_t         recordFirstEntry,
+                                uint64_t         offset,
+                                IDataContainer&  sourceContainer,
+                                uint64_t         sourceOffset,
+                                uint64_t         sourceSize)
+{
+  assert(mUsedEntries.Size() == 0);
+
+  LockGuard<Lock> sync(mSync);
+
+  ContainerSource source(sourceContainer, sourceOffset);
+  WriteRecord(recordFirstEntry, offset, sourceSize, source);
+}
+
+
+void
+VariableSizeStore::IncrementRecordRef(const uint64_t recordFirstEntry)
+{
   LockGuard<Lock> sync(mSync);
-  do
+
+  if (mClosed)
+    return;
+
+  StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
+  const auto extent = _RC(StoreExtent*, cachedItem.GetDataForUpdate());
+
+  assert(extent->IsFirst());
+  assert(extent->IsFree() == false);
+  assert(extent->RefCount() > 0);
+
+  extent->RefCount(extent->RefCount() + 1);
+}
+
+
+void
+VariableSizeStore::DecrementRecordRef(const uint64_t recordFirstEntry)
+{
+  LockGuard<Lock> sync(mSync);
+
+  if (mClosed)
+    return;
+
+  uint32_t refCount;
   {
+    StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
+    const auto extent = _RC(StoreExtent*, cachedItem.GetDataForUpdate());
+
+    assert(extent->IsFirst());
+    assert(extent->IsFree() == false);
+
+    refCount = extent->RefCount();
+
+    assert(refCount > 0);
+
+    extent->RefCount(--refCount);
+  }
+
+  if (refCount == 0)
+    RemoveRecord(recordFirstEntry);
+}
+
+
+uint32_t
+VariableSizeStore::RecordGeneration(const uint64_t recordFirstEntry)
+{
+  LockGuard<Lock> sync(mSync);
+
+  return mGenerations[recordFirstEntry % GENERATIONS];
+}
+
+
+bool
+VariableSizeStore::ShareRecord(const uint64_t recordFirstEntry, const uint32_t generation)
+{
+  LockGuard<Lock> sync(mSync);
+
+  if (mGenerations[recordFirstEntry % GENERATIONS] != generation)
+    return false;
+
+  StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
+  const auto extent = _RC(StoreExtent*, cachedItem.GetDataForUpdate());
+
+  assert(extent->IsFirst());
+  assert(extent->IsFree() == false);
+  assert(extent->RefCount() > 0);
+
+  extent->RefCount(extent->RefCount() + 1);
+
+  return true;
+}
+
+
+uint64_t
+VariableSizeStore::Size() const
+{
+  LockGuard<Lock> sync(_CC(Lock&, mSync));
+
+  if (mEntriesContainer.get() == nullptr)
+    return 0;
+
+  return mEntriesContainer->Size();
+}
+
+
+void
+VariableSizeStore::StoreItems(uint64_t firstItem, uint_t itemsCount, const uint8_t* from)
+{
+  if (firstItem + itemsCount > mUnitsCount)
+    itemsCount = mUnitsCount - firstItem;
 
-    if (recordFirstEntry == StoreEntry::LAST_CHAINED_ENTRY)
-      throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
+  const uint64_t start = firstItem * UNIT_SIZE;
+  const uint64_t count = itemsCount * UNIT_SIZE;
 
-    StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
+  mEntriesContainer->Write(start, count, from);
+}
 
-    const StoreEntry* entry = _RC(const StoreEntry*, cachedItem.GetDataForRead());
 
-    assert(entry->IsDeleted() == false);
+void
+VariableSizeStore::RetrieveItems(uint64_t    firstItem,
+                                 uint_t      itemsCount,
+                                 uint8_t*    to)
+{
+  if (firstItem + itemsCount > mUnitsCount)
+    itemsCount = mUnitsCount - firstItem;
 
-    if (offset < entry->Size())
-      break;
+  const uint64_t start = firstItem * UNIT_SIZE;
+  const uint64_t count = itemsCount * UNIT_SIZE;
 
-    offset -= entry->Size();
-    recordFirstEntry = entry->NextEntry();
-  } while (true);
+  mEntriesContainer->Read(start, count, to);
+}
 
-  while (size > 0)
-  {
-    if (recordFirstEntry == StoreEntry::LAST_CHAINED_ENTRY)
-      throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
 
-    StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
+uint_t
+VariableSizeStore::UnitBytesToBlockEnd(const uint64_t unit) const
+{
+  return (mBlockUnits - unit % mBlockUnits) * UNIT_SIZE;
+}
+
 
-    const StoreEntry* entry = _RC(const StoreEntry*, cachedItem.GetDataForRead());
+uint64_t
+VariableSizeStore::NewRecord(const uint64_t size)
+{
+  const uint64_t result = AllocateExtent(units_for(size));
 
-    assert(entry->IsDeleted() == false);
+  StoredItem cachedItem = mEntriesCache.RetriveItem(result);
+  const auto extent = _RC(StoreExtent*, cachedItem.GetDataForUpdate());
 
-    const uint64_t chunkSize = min(size, entry->Size() - offset);
-    entry->Read(offset, chunkSize, buffer);
+  extent->MarkAsFirst(true);
+  extent->NextExtent(StoreExtent::LAST_EXTENT);
+  extent->RefCount(1);
 
-    size -= chunkSize, buffer += chunkSize;
-    offset = (offset + chunkSize) % entry->Size();
-    recordFirstEntry = entry->NextEntry();
-  }
+  return result;
 }
 
+
 void
-VariableSizeStore::UpdateRecord(uint64_t       recordFirstEntry,
-                                uint64_t       offset,
-                                uint64_t       size,
-                                const uint8_t* buffer)
+VariableSizeStore::ReadRecord(uint64_t  record,
+                              uint64_t  offset,
+                              uint64_t  size,
+                              uint8_t*  buffer)
 {
-  assert(mUsedEntries.size() == 0);
+  uint64_t capacity, next;
 
-  uint64_t prevEntry = recordFirstEntry;
-
-  LockGuard<Lock> sync(mSync);
-  do
+  //Skip the extents ahead of the requested offset.
+  while (true)
   {
+    if (record == StoreExtent::LAST_EXTENT)
+      throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
 
-    if (recordFirstEntry == StoreEntry::LAST_CHAINED_ENTRY)
-    {
-      if (offset != 0)
-        throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
-
-      else
-        break;
-    }
-
-    StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
+    StoredItem cachedItem = mEntriesCache.RetriveItem(record);
+    const auto extent = _RC(const StoreExtent*, cachedItem.GetDataForRead());
 
-    const StoreEntry* entry = _RC(const StoreEntry*, cachedItem.GetDataForRead());
+    assert(extent->IsFree() == false);
 
-    assert(entry->IsDeleted() == false);
+    capacity = extent_capacity( *extent);
+    next = extent->NextExtent();
 
-    if (offset < entry->Size())
+    if (offset < capacity)
       break;
 
-    offset -= entry->Size();
-    prevEntry = recordFirstEntry;
-    recordFirstEntry = entry->NextEntry();
-  } while (true);
+    offset -= capacity;
+    record = next;
+  }
 
   while (size > 0)
   {
-    if (recordFirstEntry == StoreEntry::LAST_CHAINED_ENTRY)
-      recordFirstEntry = AllocateEntry(prevEntry);
-
-    StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
+    if (offset == capacity)
+    {
+      if (next == StoreExtent::LAST_EXTENT)
+        throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
 
-    StoreEntry* const entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
+      StoredItem cachedItem = mEntriesCache.RetriveItem(next);
+      const auto extent = _RC(const StoreExtent*, cachedItem.GetDataForRead());
 
-    assert(entry->IsDeleted() == false);
+      assert(extent->IsFree() == false);
+      assert(extent->IsFirst() == false);
 
-    const uint64_t chunkSize = entry->Write(offset, size, buffer);
-    assert(chunkSize > 0);
+      record = next, offset = 0;
+      capacity = extent_capacity( *extent);
+      next = extent->NextExtent();
+    }
 
-    size -= chunkSize, buffer += chunkSize;
+    //Copy as much as possible from the cached block holding this unit.
+    const uint64_t position = offset + StoreExtent::HEADER_SIZE;
+    const uint64_t unit = record + position / UNIT_SIZE;
+    const uint_t unitOffset = position % UNIT_SIZE;
+    const uint64_t chunk = MIN(MIN(size, capacity - offset),
+                               UnitBytesToBlockEnd(unit) - unitOffset);
 
-    offset = (offset + chunkSize) % entry->Size();
+    StoredItem cachedItem = mEntriesCache.RetriveItem(unit);
+    memcpy(buffer, cachedItem.GetDataForRead() + unitOffset, chunk);
 
-    prevEntry = recordFirstEntry;
-    recordFirstEntry = entry->NextEntry();
+    size -= chunk, buffer += chunk, offset += chunk;
   }
 }
 
 
 void
-VariableSizeStore::UpdateRecord(uint64_t           recordFirstEntry,
-                                uint64_t           offset,
-                                VariableSizeStore& sourceStore,
-                                uint64_t           sourceFirstEntry,
-                                uint64_t           sourceOffset,
-                                uint64_t           sourceSize)
+VariableSizeStore::WriteRecord(uint64_t       record,
+                               uint64_t       offset,
+                               uint64_t       size,
+                               RecordSource&  source)
 {
-  assert(mUsedEntries.size() == 0);
+  uint64_t capacity, next;
 
-  uint64_t prevEntry = recordFirstEntry;
-  uint64_t sourcePrevEntry = sourceFirstEntry;
-
-  DoubleLockGuard<Lock> sync(mSync, sourceStore.mSync);
-  do
+  while (true)
   {
-    if (recordFirstEntry == StoreEntry::LAST_CHAINED_ENTRY)
-    {
-      if (offset != 0)
-        throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
-
-      else
-        break;
-    }
+    StoredItem cachedItem = mEntriesCache.RetriveItem(record);
+    const auto extent = _RC(const StoreExtent*, cachedItem.GetDataForRead());
 
-    StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
-    auto entry = _RC(const StoreEntry*, cachedItem.GetDataForRead());
+    assert(extent->IsFree() == false);
 
-    assert(entry->IsDeleted() == false);
+    capacity = extent_capacity( *extent);
+    next = extent->NextExtent();
 
-    if (offset < entry->Size())
+    if (offset < capacity)
       break;
 
-    offset -= entry->Size();
-    prevEntry = recordFirstEntry;
-    recordFirstEntry = entry->NextEntry();
-
-  } while (true);
-
-  do
-  {
-    if (sourceFirstEntry == StoreEntry::LAST_CHAINED_ENTRY)
+    else if (next == StoreExtent::LAST_EXTENT)
     {
-      if (sourceOffset != 0)
+      //Only appending right at the end of the record is allowed.
+      if (offset > capacity)
         throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
 
-      else
-        break;
-    }
-
-    StoredItem cachedItem = sourceStore.mEntriesCache.RetriveItem(sourceFirstEntry);
-    auto entry = _RC(const StoreEntry*, cachedItem.GetDataForRead());
-
-    assert(entry->IsDeleted() == false);
-
-    if (sourceOffset < entry->Size())
       break;
+    }
 
-    sourceOffset -= entry->Size();
-    sourceFirstEntry = entry->NextEntry();
-  } while (true);
+    offset -= capacity;
+    record = next;
+  }
 
-  while (sourceSize > 0)
+  uint64_t sourceOffset = 0;
+  while (size > 0)
   {
-    if (sourceFirstEntry == StoreEntry::LAST_CHAINED_ENTRY)
-      throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
-
-    if (recordFirstEntry == StoreEntry::LAST_CHAINED_ENTRY)
-      recordFirstEntry = AllocateEntry(prevEntry);
-
-    uint8_t tembuffer[64];
-    uint_t tempValid = 0;
-
+    if (offset == capacity)
     {
-      StoredItem cachedItem = sourceStore.mEntriesCache.RetriveItem(sourceFirstEntry);
-      const auto entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
-
-
-      assert(entry->Size() <= sizeof tembuffer);
-
-      tempValid = entry->Read(sourceOffset, sourceSize, tembuffer);
-      sourcePrevEntry = sourceFirstEntry;
-      sourceFirstEntry = entry->NextEntry();
-    }
+      if (next != StoreExtent::LAST_EXTENT)
+      {
+        StoredItem cachedItem = mEntriesCache.RetriveItem(next);
+        const auto extent = _RC(const StoreExtent*, cachedItem.GetDataForRead());
 
-    StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
-    const auto entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
+        assert(extent->IsFree() == false);
+        assert(extent->IsFirst() == false);
 
-    assert(entry->IsDeleted() == false);
+        record = next, offset = 0;
+        capacity = extent_capacity( *extent);
+        next = extent->NextExtent();
+      }
+      else
+      {
+        //Try first to keep the record's data contiguous.
+        const uint64_t units = MIN((size + UNIT_SIZE - 1) / UNIT_SIZE, MAX_EXTENT_UNITS);
 
-    const uint64_t chunkSize = entry->Write(offset, tempValid, tembuffer);
+        if (GrowExtent(record, units))
+          capacity += units * UNIT_SIZE;
 
-    assert(chunkSize > 0);
+        else
+        {
+          const uint64_t newExtent = AllocateExtent(units_for(size));
+          {
+            StoredItem cachedItem = mEntriesCache.RetriveItem(newExtent);
+            const auto extent = _RC(StoreExtent*, cachedItem.GetDataForUpdate());
 
-    sourceSize -= chunkSize, offset += chunkSize;
+            extent->NextExtent(StoreExtent::LAST_EXTENT);
+            capacity = extent_capacity( *extent);
+          }
 
-    if (offset >= entry->Size())
-    {
-      prevEntry = recordFirstEntry;
-      recordFirstEntry = entry->NextEntry();
+          StoredItem cachedItem = mEntriesCache.RetriveItem(record);
+          _RC(StoreExtent*, cachedItem.GetDataForUpdate())->NextExtent(newExtent);
 
-      offset -= entry->Size();
+          record = newExtent, offset = 0;
+        }
+      }
+      continue;
     }
 
-    sourceOffset += chunkSize;
-    if (sourceOffset < entry->Size())
-      sourceFirstEntry = sourcePrevEntry;
+    const uint64_t position = offset + StoreExtent::HEADER_SIZE;
+    const uint64_t unit = record + position / UNIT_SIZE;
+    const uint_t unitOffset = position % UNIT_SIZE;
+    const uint64_t chunk = MIN(MIN(size, capacity - offset),
+                               UnitBytesToBlockEnd(unit) - unitOffset);
 
-    else
-      sourceOffset -= entry->Size();
+    StoredItem cachedItem = mEntriesCache.RetriveItem(unit);
+    source.Read(sourceOffset, chunk, cachedItem.GetDataForUpdate() + unitOffset);
+
+    size -= chunk, sourceOffset += chunk, offset += chunk;
   }
 }
 
+
 void
-VariableSizeStore::UpdateRecord(uint64_t         recordFirstEntry,
-                                uint64_t         offset,
-                                IDataContainer&  sourceContainer,
-                                uint64_t         sourceOffset,
-                                uint64_t         sourceSize)
+VariableSizeStore::RemoveRecord(uint64_t recordFirstEntry)
 {
-  assert(mUsedEntries.size() == 0);
+  assert(mUsedEntries.Size() == 0);
 
-  uint64_t prevEntry = recordFirstEntry;
-
-  LockGuard<Lock> sync(mSync);
+  ++mGenerations[recordFirstEntry % GENERATIONS];
 
-  do
+  while (recordFirstEntry != StoreExtent::LAST_EXTENT)
   {
-    if (recordFirstEntry == StoreEntry::LAST_CHAINED_ENTRY)
+    uint64_t unitsCount;
+    const uint64_t extent = recordFirstEntry;
     {
-      if (offset != 0)
-        throw DBSException(_EXTRA(DBSException::GENERAL_CONTROL_ERROR));
-
-      else
-        break;
-    }
+      StoredItem cachedItem = mEntriesCache.RetriveItem(extent);
+      const auto header = _RC(const StoreExtent*, cachedItem.GetDataForRead());
 
-    StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
+      assert(header->IsFree() == false);
 
-    const auto entry = _RC(const StoreEntry*, cachedItem.GetDataForRead());
+      unitsCount = header->UnitsCount();
+      recordFirstEntry = header->NextExtent();
+    }
 
-    assert(entry->IsDeleted() == false);
+    FreeExtent(extent, unitsCount);
+  }
+}
 
-    if (offset < entry->Size())
-      break;
 
-    offset -= entry->Size();
-    prevEntry = recordFirstEntry;
-    recordFirstEntry = entry->NextEntry();
+uint64_t
+VariableSizeStore::AllocateExtent(const uint64_t unitsCount)
+{
+  assert((unitsCount > 0) && (unitsCount <= MAX_EXTENT_UNITS));
 
-  } while (true);
+  uint_t sizeClass = size_class(unitsCount);
+  uint64_t run = mFreeHeads[sizeClass], runUnits = 0;
 
-  while (sourceSize > 0)
+  //The runs of a class are not equally sized, check a few of them first.
+  for (uint_t scanned = 0; (run != 0) && (scanned < MAX_SCANNED_RUNS); ++scanned)
   {
-    if (recordFirstEntry == StoreEntry::LAST_CHAINED_ENTRY)
-      recordFirstEntry = AllocateEntry(prevEntry);
+    StoredItem cachedItem = mEntriesCache.RetriveItem(run);
+    const auto header = _RC(const StoreExtent*, cachedItem.GetDataForRead());
 
-    StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
+    assert(header->IsFree());
 
-    const auto entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
+    runUnits = header->UnitsCount();
+    if (runUnits >= unitsCount)
+      break;
 
-    assert(entry->IsDeleted() == false);
+    run = header->NextExtent();
+  }
 
-    uint8_t tembuffer[64];
-    uint_t tempValid = MIN(entry->Size() - offset, sourceSize);
+  if ((run == 0) || (runUnits < unitsCount))
+  {
+    for (run = 0, ++sizeClass; (run == 0) && (sizeClass < FREE_CLASSES); ++sizeClass)
+      run = mFreeHeads[sizeClass];
 
-    assert(entry->Size() < sizeof tembuffer);
+    //Nothing big enough, but the free space at the end could be extended.
+    if (run == 0)
+      run = mTailFreeRun;
 
-    sourceContainer.Read(sourceOffset, tempValid, tembuffer);
+    if (run != 0)
+    {
+      StoredItem cachedItem = mEntriesCache.RetriveItem(run);
+      runUnits = _RC(const StoreExtent*, cachedItem.GetDataForRead())->UnitsCount();
+    }
+  }
 
-    const uint64_t chunkSize = entry->Write(offset, tempValid, tembuffer);
+  if (run == 0)
+    run = AppendUnits(unitsCount);
 
-    (void)chunkSize;
-    assert(chunkSize == tempValid);
+  else
+    TakeFreeRun(run, runUnits, unitsCount);
 
-    sourceSize -= tempValid, sourceOffset += tempValid;
+  StoredItem cachedItem = mEntriesCache.RetriveItem(run);
+  const auto header = _RC(StoreExtent*, cachedItem.GetDataForUpdate());
 
-    offset = (offset + tempValid) % entry->Size();
+  memset(header, 0, sizeof *header);
+  header->UnitsCount(unitsCount);
+  header->NextExtent(StoreExtent::LAST_EXTENT);
 
-    prevEntry = recordFirstEntry;
-    recordFirstEntry = entry->NextEntry();
-  }
+  return run;
 }
 
 
-void
-VariableSizeStore::IncrementRecordRef(const uint64_t recordFirstEntry)
+bool
+VariableSizeStore::GrowExtent(const uint64_t extent, const uint64_t unitsCount)
 {
-  LockGuard<Lock> sync(mSync);
-
-  StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
-  const auto entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
-
-  assert(entry->IsFirstEntry());
-  assert(entry->IsDeleted() == false);
-  assert(entry->PrevEntry() > 0);
+  uint64_t extentUnits;
+  {
+    StoredItem cachedItem = mEntriesCache.RetriveItem(extent);
+    extentUnits = _RC(const StoreExtent*, cachedItem.GetDataForRead())->UnitsCount();
+  }
 
-  entry->PrevEntry(entry->PrevEntry() + 1);
-}
+  if (extentUnits + unitsCount > MAX_EXTENT_UNITS)
+    return false;
 
+  const uint64_t following = extent + extentUnits;
+  if (following == mUnitsCount)
+    AppendUnits(unitsCount);
 
-void
-VariableSizeStore::DecrementRecordRef(const uint64_t recordFirstEntry)
-{
-  LockGuard<Lock> sync(mSync);
+  else
+  {
+    uint64_t runUnits;
+    {
+      StoredItem cachedItem = mEntriesCache.RetriveItem(following);
+      const auto header = _RC(const StoreExtent*, cachedItem.GetDataForRead());
 
-  StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
-  const auto entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
+      if ( ! header->IsFree())
+        return false;
 
-  assert(entry->IsFirstEntry());
-  assert(entry->IsDeleted() == false);
+      runUnits = header->UnitsCount();
+    }
 
-  uint64_t refCount = entry->PrevEntry();
+    if ((runUnits < unitsCount) && (following != mTailFreeRun))
+      return false;
 
-  assert(refCount > 0);
+    TakeFreeRun(following, runUnits, unitsCount);
+  }
 
-  entry->PrevEntry(--refCount);
+  StoredItem cachedItem = mEntriesCache.RetriveItem(extent);
+  _RC(StoreExtent*, cachedItem.GetDataForUpdate())->UnitsCount(extentUnits + unitsCount);
 
-  if (refCount == 0)
-    RemoveRecord(recordFirstEntry);
+  return true;
 }
 
 
-uint64_t
-VariableSizeStore::Size() const
+void
+VariableSizeStore::FreeExtent(uint64_t extent, uint64_t unitsCount)
 {
-  LockGuard<Lock> sync(_CC(Lock&, mSync));
+  assert((extent >= HEADER_UNITS) && (extent + unitsCount <= mUnitsCount));
 
-  if (mEntriesContainer.get() == nullptr)
-    return 0;
+  //Merge with the free neighbors, so the free space does not get fragmented.
+  const uint64_t following = extent + unitsCount;
+  if (following < mUnitsCount)
+  {
+    uint64_t runUnits = 0;
+    {
+      StoredItem cachedItem = mEntriesCache.RetriveItem(following);
+      const auto header = _RC(const StoreExtent*, cachedItem.GetDataForRead());
 
-  return mEntriesContainer->Size();
-}
+      if (header->IsFree())
+        runUnits = header->UnitsCount();
+    }
 
+    if (runUnits > 0)
+    {
+      UnlinkFreeRun(following, runUnits);
+      unitsCount += runUnits;
+    }
+  }
 
-void
-VariableSizeStore::StoreItems(uint64_t firstItem, uint_t itemsCount, const uint8_t* from)
-{
-  if (firstItem + itemsCount > mEntriesCount)
-    itemsCount = mEntriesCount - firstItem;
+  bool prevFree;
+  {
+    StoredItem cachedItem = mEntriesCache.RetriveItem(extent);
+    prevFree = _RC(const StoreExtent*, cachedItem.GetDataForRead())->IsPrevFree();
+  }
 
-  const uint64_t start = firstItem * sizeof(StoreEntry);
-  const uint64_t count = itemsCount * sizeof(StoreEntry);
+  if (prevFree)
+  {
+    uint64_t runUnits;
+    {
+      StoredItem cachedItem = mEntriesCache.RetriveItem(extent - 1);
+      runUnits = load_le_int64(cachedItem.GetDataForRead() + FREE_RUN_FOOTER_OFF);
+    }
 
-  mEntriesContainer->Write(start, count, from);
-}
+    assert((runUnits > 0) && (runUnits <= extent - HEADER_UNITS));
 
+    UnlinkFreeRun(extent - runUnits, runUnits);
+    extent -= runUnits, unitsCount += runUnits;
+  }
 
-void
-VariableSizeStore::RetrieveItems(uint64_t    firstItem,
-                                 uint_t      itemsCount,
-                                 uint8_t*    to)
-{
-  if (firstItem + itemsCount > mEntriesCount)
-    itemsCount = mEntriesCount - firstItem;
+  SetFreeRun(extent, unitsCount);
+  LinkFreeRun(extent, unitsCount);
 
-  const uint64_t start = firstItem * sizeof(StoreEntry);
-  const uint64_t count = itemsCount * sizeof(StoreEntry);
+  if (extent + unitsCount < mUnitsCount)
+    MarkPrevFree(extent + unitsCount, true);
 
-  mEntriesContainer->Read(start, count, to);
+  else
+    TailFreeRun(extent);
 }
 
 
-uint64_t
-VariableSizeStore::AllocateEntry(const uint64_t prevEntryId)
+void
+VariableSizeStore::TakeFreeRun(const uint64_t  run,
+                               const uint64_t  runUnits,
+                               const uint64_t  unitsCount)
 {
-  uint64_t foundFree = mFirstFreeEntry;
+  UnlinkFreeRun(run, runUnits);
 
-  //Try to find a free neighbor of the previous entry;
-  if ((prevEntryId + 1) < mEntriesCount)
+  if (runUnits > unitsCount)
   {
-    StoredItem cachedItem = mEntriesCache.RetriveItem(prevEntryId + 1);
-    const StoreEntry* entry = _RC(const StoreEntry*, cachedItem.GetDataForRead());
-    if (entry->IsDeleted())
-      foundFree = prevEntryId + 1;
-  }
-  else if (prevEntryId > 1)
-  {
-    StoredItem cachedItem = mEntriesCache.RetriveItem(prevEntryId - 1);
-    const StoreEntry* entry = _RC(const StoreEntry*, cachedItem.GetDataForRead());
-    if (entry->IsDeleted())
-      foundFree = prevEntryId - 1;
-  }
-
-  if (foundFree == StoreEntry::LAST_DELETED_ENTRY)
-    foundFree = ExtentFreeList();
+    SetFreeRun(run + unitsCount, runUnits - unitsCount);
+    LinkFreeRun(run + unitsCount, runUnits - unitsCount);
 
-  ExtractFromFreeList(foundFree);
+    if (run == mTailFreeRun)
+      TailFreeRun(run + unitsCount);
 
-  StoredItem cachedItem = mEntriesCache.RetriveItem(foundFree);
-  StoreEntry* entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
+    return;
+  }
 
-  if (prevEntryId > 0)
+  if (run == mTailFreeRun)
   {
-    StoredItem prevCachedItem = mEntriesCache.RetriveItem(prevEntryId);
-    StoreEntry* prevEntry = _RC(StoreEntry*, prevCachedItem.GetDataForUpdate());
-
-    const uint64_t prevNext = prevEntry->NextEntry();
-
-    assert(prevEntry->IsDeleted() == false);
-    assert(prevEntry->NextEntry() == StoreEntry::LAST_CHAINED_ENTRY);
-
-    prevEntry->NextEntry(foundFree);
+    TailFreeRun(0);
 
-    entry->PrevEntry(prevEntryId);
-    entry->MarkAsFirstEntry(false);
-    entry->NextEntry(prevNext);
-
-    if (entry->NextEntry() != StoreEntry::LAST_CHAINED_ENTRY)
-    {
-      StoredItem nextCachedItem = mEntriesCache.RetriveItem(entry->NextEntry());
-      entry = _RC(StoreEntry*, nextCachedItem.GetDataForUpdate());
-
-      entry->PrevEntry(foundFree);
-    }
+    //The store's last run is too small, make room for what is missing.
+    if (runUnits < unitsCount)
+      AppendUnits(unitsCount - runUnits);
   }
   else
   {
-    entry->MarkAsFirstEntry(true);
-    entry->PrevEntry(0);
-    entry->NextEntry(StoreEntry::LAST_CHAINED_ENTRY);
-  }
+    assert(runUnits == unitsCount);
 
-  return foundFree;
+    MarkPrevFree(run + runUnits, false);
+  }
 }
 
 
 uint64_t
-VariableSizeStore::ExtentFreeList()
+VariableSizeStore::AppendUnits(const uint64_t unitsCount)
 {
-  assert(mFirstFreeEntry == StoreEntry::LAST_DELETED_ENTRY);
-  StoreEntry newEntry;
-
-  newEntry.MarkAsDeleted(true);
-  newEntry.PrevEntry(0);
-  newEntry.NextEntry(StoreEntry::LAST_DELETED_ENTRY);
-
-  newEntry.MarkAsFirstEntry(false);
+  static const uint8_t zeroes[64 * UNIT_SIZE] = { 0, };
 
-  const uint64_t insertPos = mEntriesContainer.get()->Size();
+  const uint64_t result = mUnitsCount;
 
-  mFirstFreeEntry = insertPos / sizeof(newEntry);
+  //Flush the current content.
+  mEntriesCache.FlushItem(result - 1);
 
-  //Flush the current content
-  mEntriesCache.FlushItem(mFirstFreeEntry - 1);
+  for (uint64_t written = 0; written < unitsCount; )
+  {
+    const uint64_t units = MIN(unitsCount - written, sizeof zeroes / UNIT_SIZE);
 
-  assert((insertPos % sizeof(newEntry)) == 0);
-  mEntriesContainer->Write(insertPos, sizeof(newEntry), _RC(uint8_t*, &newEntry));
-  ++mEntriesCount;
+    mEntriesContainer->Write((result + written) * UNIT_SIZE, units * UNIT_SIZE, zeroes);
+    written += units;
+  }
+  mUnitsCount += unitsCount;
 
   //Reload the content of item's block.
-  mEntriesCache.RefreshItem(mFirstFreeEntry);
-
-  StoredItem cachedItem = mEntriesCache.RetriveItem(0);
-  StoreEntry* entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
+  mEntriesCache.RefreshItem(result - 1);
 
-  entry->NextEntry(mFirstFreeEntry);
-
-  return mFirstFreeEntry;
+  return result;
 }
 
 
 void
-VariableSizeStore::RemoveRecord(uint64_t recordFirstEntry)
+VariableSizeStore::SetFreeRun(const uint64_t run, const uint64_t unitsCount)
 {
-  assert(mUsedEntries.size() == 0);
-
-  StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
-  const StoreEntry* entry = _RC(const StoreEntry*, cachedItem.GetDataForRead());
-
-  (void)entry;
-  assert(entry->IsDeleted() == false);
-  assert(entry->IsFirstEntry());
-
-  while (recordFirstEntry != StoreEntry::LAST_CHAINED_ENTRY)
   {
-    StoredItem cachedItem = mEntriesCache.RetriveItem(recordFirstEntry);
-    const StoreEntry* entry = _RC(const StoreEntry*, cachedItem.GetDataForRead());
-
-    assert(entry->IsDeleted() == false);
+    StoredItem cachedItem = mEntriesCache.RetriveItem(run);
+    uint8_t* const data = cachedItem.GetDataForUpdate();
+    const auto header = _RC(StoreExtent*, data);
 
-    const uint64_t currentEntry = recordFirstEntry;
-    recordFirstEntry = entry->NextEntry();
-
-    AddToFreeList(currentEntry);
+    memset(data, 0, FREE_RUN_PREV_OFF + sizeof(uint64_t));
+    header->MarkAsFree(true);
+    header->UnitsCount(unitsCount);
   }
+
+  StoredItem cachedItem = mEntriesCache.RetriveItem(run + unitsCount - 1);
+  store_le_int64(unitsCount, cachedItem.GetDataForUpdate() + FREE_RUN_FOOTER_OFF);
 }
 
 
 void
-VariableSizeStore::ExtractFromFreeList(const uint64_t entryId)
+VariableSizeStore::LinkFreeRun(const uint64_t run, const uint64_t unitsCount)
 {
-  StoredItem cachedItem = mEntriesCache.RetriveItem(entryId);
-  StoreEntry* entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
-
-  assert(entryId != 0);
-  assert(entry->IsDeleted());
-  assert(entry->IsFirstEntry() == false);
-
-  const uint64_t prevEntry = entry->PrevEntry();
-  const uint64_t nextEntry = entry->NextEntry();
+  const uint_t sizeClass = size_class(unitsCount);
+  const uint64_t head = mFreeHeads[sizeClass];
 
-  assert(prevEntry < mEntriesCount);
-  assert((nextEntry == StoreEntry::LAST_DELETED_ENTRY) || (nextEntry < mEntriesCount));
-
-  entry->MarkAsDeleted(false);
-  entry->PrevEntry(0);
-  entry->NextEntry(0);
-
-  cachedItem = mEntriesCache.RetriveItem(prevEntry);
-  entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
-
-  assert(entry->IsDeleted());
-  assert(entry->IsFirstEntry() == false);
-
-  entry->NextEntry(nextEntry);
-
-  if (entryId == mFirstFreeEntry)
-    mFirstFreeEntry = nextEntry;
-
-  if (nextEntry != StoreEntry::LAST_DELETED_ENTRY)
   {
-    cachedItem = mEntriesCache.RetriveItem(nextEntry);
-    entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
+    StoredItem cachedItem = mEntriesCache.RetriveItem(run);
+    _RC(StoreExtent*, cachedItem.GetDataForUpdate())->NextExtent(head);
+  }
 
-    assert(entry->IsDeleted());
-    assert(entry->IsFirstEntry() == false);
+  FreeRunPrev(run, 0);
+  if (head != 0)
+    FreeRunPrev(head, run);
 
-    entry->PrevEntry(prevEntry);
-  }
+  FreeHead(sizeClass, run);
 }
 
 
 void
-VariableSizeStore::AddToFreeList(const uint64_t entryId)
+VariableSizeStore::UnlinkFreeRun(const uint64_t run, const uint64_t unitsCount)
 {
-  assert(mEntriesCount > entryId);
-
-  StoredItem cachedItem = mEntriesCache.RetriveItem(entryId);
-  StoreEntry* entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
-
-  //Just to have a valid initialization
-  StoredItem neighborCachedItem = cachedItem;
-  StoreEntry* neighborEntry = nullptr;
-
-  assert(entry > 0);
-  assert(entry->IsDeleted() == false);
-
-  entry->MarkAsDeleted(true);
-  entry->MarkAsFirstEntry(false);
-
-  //Maybe we are lucky! Check to see if we can link to one of our neighbors!
-  if ((entryId + 1) < mEntriesCount)
+  uint64_t next;
   {
-    neighborCachedItem = mEntriesCache.RetriveItem(entryId + 1);
-    neighborEntry = _RC(StoreEntry*, neighborCachedItem.GetDataForUpdate());
-
-    if (neighborEntry->IsDeleted())
-    {
-      assert(neighborEntry->IsFirstEntry() == false);
-
-      const uint64_t prevEntry = neighborEntry->PrevEntry();
+    StoredItem cachedItem = mEntriesCache.RetriveItem(run);
+    const auto header = _RC(const StoreExtent*, cachedItem.GetDataForRead());
 
-      neighborEntry->PrevEntry(entryId);
-      entry->PrevEntry(prevEntry);
-      entry->NextEntry(entryId + 1);
+    assert(header->IsFree());
+    assert(header->UnitsCount() == unitsCount);
 
-      neighborCachedItem = mEntriesCache.RetriveItem(prevEntry);
-      neighborEntry = _RC(StoreEntry*, neighborCachedItem.GetDataForUpdate());
-
-      assert(neighborEntry->IsDeleted());
-      assert(neighborEntry->IsFirstEntry() == false);
-
-      neighborEntry->NextEntry(entryId);
+    next = header->NextExtent();
+  }
 
-      if (mFirstFreeEntry == (entryId + 1))
-      {
-        assert(prevEntry == 0);
+  const uint64_t prev = FreeRunPrev(run);
 
-        mFirstFreeEntry = entryId;
-      }
+  if (prev == 0)
+  {
+    assert(mFreeHeads[size_class(unitsCount)] == run);
 
-      return;
-    }
+    FreeHead(size_class(unitsCount), next);
   }
-  else if (entryId > 1)
+  else
   {
-    neighborCachedItem = mEntriesCache.RetriveItem(entryId - 1);
-    neighborEntry = _RC(StoreEntry*, neighborCachedItem.GetDataForUpdate());
+    StoredItem cachedItem = mEntriesCache.RetriveItem(prev);
+    _RC(StoreExtent*, cachedItem.GetDataForUpdate())->NextExtent(next);
+  }
+
+  if (next != 0)
+    FreeRunPrev(next, prev);
+}
 
-    if (neighborEntry->IsDeleted())
-    {
-      assert(neighborEntry->IsFirstEntry() == false);
 
-      const uint64_t nextEntry = neighborEntry->NextEntry();
+void
+VariableSizeStore::MarkPrevFree(const uint64_t extent, const bool prevFree)
+{
+  StoredItem cachedItem = mEntriesCache.RetriveItem(extent);
+  _RC(StoreExtent*, cachedItem.GetDataForUpdate())->MarkPrevFree(prevFree);
+}
 
-      neighborEntry->NextEntry(entryId);
-      entry->NextEntry(nextEntry);
-      entry->PrevEntry(entryId - 1);
 
-      if (nextEntry == StoreEntry::LAST_CHAINED_ENTRY)
-        return;
+uint64_t
+VariableSizeStore::FreeRunPrev(const uint64_t run)
+{
+  StoredItem cachedItem = mEntriesCache.RetriveItem(run);
 
-      neighborCachedItem = mEntriesCache.RetriveItem(nextEntry);
-      neighborEntry = _RC(StoreEntry*, neighborCachedItem.GetDataForUpdate());
+  return load_le_int64(cachedItem.GetDataForRead() + FREE_RUN_PREV_OFF);
+}
 
-      assert(neighborEntry->IsDeleted());
-      assert(neighborEntry->IsFirstEntry() == false);
 
-      neighborEntry->PrevEntry(entryId);
+void
+VariableSizeStore::FreeRunPrev(const uint64_t run, const uint64_t prev)
+{
+  StoredItem cachedItem = mEntriesCache.RetriveItem(run);
 
-      return;
-    }
-  }
+  store_le_int64(prev, cachedItem.GetDataForUpdate() + FREE_RUN_PREV_OFF);
+}
 
-  //No neighbors! Let's add it at the front of the free entries chain.
-  if (mFirstFreeEntry != StoreEntry::LAST_CHAINED_ENTRY)
-  {
-    neighborCachedItem = mEntriesCache.RetriveItem(mFirstFreeEntry);
-    neighborEntry = _RC(StoreEntry*, neighborCachedItem.GetDataForUpdate());
 
-    assert(neighborEntry->IsDeleted());
-    assert(neighborEntry->IsFirstEntry() == false);
+void
+VariableSizeStore::TailFreeRun(const uint64_t run)
+{
+  mTailFreeRun = run;
 
-    neighborEntry->PrevEntry(entryId);
-  }
+  StoredItem cachedItem = mEntriesCache.RetriveItem(0);
+  store_le_int64(run, cachedItem.GetDataForUpdate() + STORE_TAIL_RUN_OFF);
+}
 
-  entry->PrevEntry(0);
-  entry->NextEntry(mFirstFreeEntry);
 
-  mFirstFreeEntry = entryId;
-  cachedItem = mEntriesCache.RetriveItem(0);
-  entry = _RC(StoreEntry*, cachedItem.GetDataForUpdate());
+void
+VariableSizeStore::FreeHead(const uint_t sizeClass, const uint64_t run)
+{
+  mFreeHeads[sizeClass] = run;
 
-  assert(entry->IsDeleted());
-  assert(entry->IsFirstEntry() == false);
+  const uint_t offset = sizeClass * sizeof(uint64_t);
 
-  entry->NextEntry(entryId);
+  StoredItem cachedItem = mEntriesCache.RetriveItem(STORE_FREE_HEADS_UNIT + offset / UNIT_SIZE);
+  store_le_int64(run, cachedItem.GetDataForUpdate() + offset % UNIT_SIZE);
 }
 
 } //namespace pastra
 } //namespace whais
-
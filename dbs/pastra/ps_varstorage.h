@@ -25,6 +25,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef PS_VARSTORAGE_H_
 #define PS_VARSTORAGE_H_
 
+#include <map>
+
 #include "whais.h"
 
 #include "utils/wthread.h"
@@ -40,83 +42,132 @@ namespace pastra
 
 
 
-class StoreEntry
+//Keeps track of the store entries found in use while the storage is checked.
+//The entries could be claimed concurrently by different threads.
+class EntriesBitmap
 {
 public:
-  static const uint64_t LAST_DELETED_ENTRY = 0x0FFFFFFFFFFFFFFFull;
-  static const uint64_t LAST_CHAINED_ENTRY = 0x0FFFFFFFFFFFFFFFull;
-  static const uint64_t ENTRY_DELETED_MASK = 0x8000000000000000ull;
-  static const uint64_t FIRST_RECORD_ENTRY = 0x4000000000000000ull;
-  static const uint64_t FIRST_PREV_ENTRY   = 0x0000000000000001ull;
-  static const uint_t  ENTRY_SIZE          = 48;
-
-  StoreEntry()
+  void Resize(const uint64_t count);
+  uint64_t Size() const { return mSize; }
+
+  bool Test(const uint64_t entry) const
   {
-    memset(mPrevEntry, 0xFF, sizeof mPrevEntry);
-    memset(mNextEntry, 0xFF, sizeof mPrevEntry);
-    memset(mRawData,   0xFF, sizeof mRawData);
+    assert(entry < mSize);
+
+    return (mWords[entry / WORD_BITS] & EntryMask(entry)) != 0;
   }
 
-  void MarkAsDeleted(const bool deleted)
+  //Returns the previous state of the entry.
+  bool TestAndSet(const uint64_t entry)
   {
-    uint64_t entry = load_le_int64(mNextEntry);
-
-    deleted ? (entry |= ENTRY_DELETED_MASK) : (entry &= ~ENTRY_DELETED_MASK);
+    assert(entry < mSize);
 
-    store_le_int64(entry, mNextEntry);
+    return (wh_atomic_fetch_or32(&mWords[entry / WORD_BITS], EntryMask(entry))
+            & EntryMask(entry)) != 0;
   }
 
-  void MarkAsFirstEntry(const bool first)
+  void Reset(const uint64_t entry)
   {
-    uint64_t entry = load_le_int64(mNextEntry);
+    assert(entry < mSize);
 
-    first ? (entry |= FIRST_RECORD_ENTRY) : (entry &= ~FIRST_RECORD_ENTRY);
-
-    store_le_int64(entry, mNextEntry);
+    wh_atomic_fetch_and32(&mWords[entry / WORD_BITS], ~EntryMask(entry));
   }
 
-  bool IsDeleted() const { return (load_le_int64(mNextEntry) & ENTRY_DELETED_MASK) != 0; }
-  bool IsFirstEntry() const { return(load_le_int64(mNextEntry) & FIRST_RECORD_ENTRY) != 0; }
-  uint64_t PrevEntry() const { return load_le_int64(mPrevEntry); }
-  void PrevEntry(const uint64_t content) { store_le_int64(content, mPrevEntry); }
-  uint64_t NextEntry() const
+private:
+  static const uint_t WORD_BITS = 32;
+
+  static int32_t EntryMask(const uint64_t entry)
   {
-    return load_le_int64(mNextEntry) & ~(ENTRY_DELETED_MASK | FIRST_RECORD_ENTRY);
+    return _SC(int32_t, 1u << (entry % WORD_BITS));
   }
 
-  void NextEntry(const uint64_t content)
-  {
-    uint64_t entry = load_le_int64(mNextEntry);
+  std::vector<int32_t> mWords;
+  uint64_t             mSize = { 0 };
+};
 
-    entry &= (ENTRY_DELETED_MASK | FIRST_RECORD_ENTRY);
-    entry |= content;
 
-    store_le_int64(entry, mNextEntry);
+//The store's space is split in units of UNIT_SIZE bytes. A record is kept in
+//one or more extents (runs of adjacent units) chained together. Every extent
+//begins with this header, the record's data follows it. The free runs use the
+//same header, they are linked in lists depending on their size.
+class StoreExtent
+{
+public:
+  static const uint64_t LAST_EXTENT      = 0x0FFFFFFFFFFFFFFFull;
+  static const uint64_t FREE_MASK        = 0x8000000000000000ull;
+  static const uint64_t FIRST_MASK       = 0x4000000000000000ull;
+  static const uint64_t PREV_FREE_MASK   = 0x2000000000000000ull;
+  static const uint64_t FLAGS_MASK       = 0xF000000000000000ull;
+  static const uint_t   HEADER_SIZE      = 16;
+
+  bool IsFree() const { return (load_le_int64(mLink) & FREE_MASK) != 0; }
+  bool IsFirst() const { return (load_le_int64(mLink) & FIRST_MASK) != 0; }
+  bool IsPrevFree() const { return (load_le_int64(mLink) & PREV_FREE_MASK) != 0; }
+
+  void MarkAsFree(const bool free) { SetFlag(FREE_MASK, free); }
+  void MarkAsFirst(const bool first) { SetFlag(FIRST_MASK, first); }
+  void MarkPrevFree(const bool prevFree) { SetFlag(PREV_FREE_MASK, prevFree); }
+
+  uint64_t NextExtent() const { return load_le_int64(mLink) & ~FLAGS_MASK; }
+  void NextExtent(const uint64_t extent)
+  {
+    store_le_int64((load_le_int64(mLink) & FLAGS_MASK) | extent, mLink);
   }
 
-  uint_t Read(uint_t offset, uint_t count, uint8_t* buffer) const;
-  uint_t Write(uint_t offset, uint_t count, const uint8_t* buffer);
+  uint32_t UnitsCount() const { return load_le_int32(mUnitsCount); }
+  void UnitsCount(const uint32_t count) { store_le_int32(count, mUnitsCount); }
 
-  static uint8_t Size() { return ENTRY_SIZE; }
+  //Only the first extent of a record keeps the references count.
+  uint32_t RefCount() const { return load_le_int32(mRefCount); }
+  void RefCount(const uint32_t count) { store_le_int32(count, mRefCount); }
 
 private:
-  uint8_t  mPrevEntry[8];
-  uint8_t  mNextEntry[8];
-  uint8_t  mRawData[ENTRY_SIZE];
+  void SetFlag(const uint64_t mask, const bool set)
+  {
+    uint64_t link = load_le_int64(mLink);
+
+    set ? (link |= mask) : (link &= ~mask);
+
+    store_le_int64(link, mLink);
+  }
+
+  uint8_t  mLink[8];
+  uint8_t  mUnitsCount[4];
+  uint8_t  mRefCount[4];
 };
 
 
+class RecordSource;
+class RecordChecker;
+
+
 class VariableSizeStore : public IBlocksManager
 {
 public:
+  static const uint_t   UNIT_SIZE       = 64;
+  static const uint_t   HEADER_UNITS    = 8;
+  static const uint_t   FREE_CLASSES    = 48;
+  static const uint32_t FORMAT_VERSION  = 1;
+  static const uint_t   GENERATIONS     = 1024;
+
   VariableSizeStore() = default;
   ~VariableSizeStore() = default;
 
   void Init(const char* tempDir, const uint32_t reservedMem);
-  void Init(const char* baseName, const uint64_t storeSize, const uint64_t maxFileSize);
+  void Init(const char* baseName,
+            const uint64_t storeSize,
+            const uint64_t maxFileSize,
+            const bool toCheck = false,
+            IContainerJournal* const journal = nullptr);
 
   void Flush();
+  bool FlushSome(const uint_t maxBlocks);
   void MarkForRemoval();
+  //The table owning this store was closed. The values read from it may still
+  //hold references to its records, but the store is not written anymore, as
+  //the table could be opened again over the same files. The references left
+  //behind are dropped by the next repair of the table.
+  void MarkClosed();
 
   uint64_t AddRecord(const uint8_t* buffer, const uint64_t size);
   uint64_t AddRecord(VariableSizeStore& sourceStore,
@@ -125,6 +176,12 @@ public:
                      uint64_t sourceSize);
   uint64_t AddRecord(IDataContainer& sourceContainer, uint64_t sourceFrom, uint64_t sourceSize);
 
+  //Copies a record kept by a store of the previous format version, a chain
+  //of fixed size entries. Returns 0 if the record's chain is not valid.
+  uint64_t ImportLegacyRecord(IDataContainer& legacyEntries,
+                              const uint64_t legacyFirstEntry,
+                              const uint64_t recordSize);
+
   void GetRecord(uint64_t recordFirstEntry, uint64_t offset, uint64_t size, uint8_t* buffer);
   void UpdateRecord(uint64_t recordFirstEntry,
                     uint64_t offset,
@@ -147,33 +204,94 @@ public:
   void IncrementRecordRef(const uint64_t recordFirstEntry);
   void DecrementRecordRef(const uint64_t recordFirstEntry);
 
+  //Values remember the records they were copied into without holding them.
+  //A record is shared again only if no record that started at the same
+  //entry was removed in the meantime (as the entry might be reused).
+  uint32_t RecordGeneration(const uint64_t recordFirstEntry);
+  bool ShareRecord(const uint64_t recordFirstEntry, const uint32_t generation);
+
   uint64_t Size() const;
 
   virtual void StoreItems(uint64_t firstItem, uint_t itemsCount, const uint8_t* const from) override;
   virtual void RetrieveItems(uint64_t firstItem, uint_t itemsCount, uint8_t* const to) override;
 
+  //The records checks could be done concurrently, as long as every thread
+  //reads the entries through its own container (see OpenEntriesReader()).
   void PrepareToCheckStorage();
   bool CheckArrayEntry(const uint64_t recordFirstEntry,
                        const uint64_t recordSize,
                        const DBS_FIELD_TYPE itemSize);
+  bool CheckArrayEntry(IDataContainer& entries,
+                       const uint64_t recordFirstEntry,
+                       const uint64_t recordSize,
+                       const DBS_FIELD_TYPE itemSize);
   bool CheckTextEntry(const uint64_t recordFirstEntry, const uint64_t recordSize);
+  bool CheckTextEntry(IDataContainer& entries,
+                      const uint64_t recordFirstEntry,
+                      const uint64_t recordSize);
   void ConcludeStorageCheck();
+  std::unique_ptr<IDataContainer> OpenEntriesReader() const;
 
 private:
-  void FinishInit(const bool nonPersitentData);
-
-  uint64_t AllocateEntry(const uint64_t prevEntryId);
-  uint64_t ExtentFreeList();
+  friend class StoreSource;
+
+  void FinishInit(const bool nonPersitentData, const bool toCheck);
+  void InitCache(const bool nonPersitentData);
+  void WriteStoreHeader();
+
+  bool ReferCheckedRecord(const uint64_t   recordFirstEntry,
+                          const uint64_t   recordSize,
+                          const uint_t     kind,
+                          bool* const      outValid);
+  bool ClaimCheckedRecord(RecordChecker&   record,
+                          const uint64_t   recordFirstEntry,
+                          const uint64_t   recordSize,
+                          const uint_t     kind);
+
+  uint64_t NewRecord(const uint64_t size);
+  void ReadRecord(uint64_t record, uint64_t offset, uint64_t size, uint8_t* buffer);
+  void WriteRecord(uint64_t record, uint64_t offset, uint64_t size, RecordSource& source);
   void RemoveRecord(uint64_t recordFirstEntry);
-  void ExtractFromFreeList(const uint64_t entryId);
-  void AddToFreeList(const uint64_t entryId);
+
+  uint64_t AllocateExtent(const uint64_t unitsCount);
+  bool GrowExtent(const uint64_t extent, const uint64_t unitsCount);
+  void FreeExtent(uint64_t extent, uint64_t unitsCount);
+  uint64_t AppendUnits(const uint64_t unitsCount);
+
+  void TakeFreeRun(const uint64_t run, const uint64_t runUnits, const uint64_t unitsCount);
+  void SetFreeRun(const uint64_t run, const uint64_t unitsCount);
+  void LinkFreeRun(const uint64_t run, const uint64_t unitsCount);
+  void UnlinkFreeRun(const uint64_t run, const uint64_t unitsCount);
+  void MarkPrevFree(const uint64_t extent, const bool prevFree);
+  uint64_t FreeRunPrev(const uint64_t run);
+  void FreeRunPrev(const uint64_t run, const uint64_t prev);
+  void FreeHead(const uint_t sizeClass, const uint64_t run);
+  void TailFreeRun(const uint64_t run);
+
+  uint_t UnitBytesToBlockEnd(const uint64_t unit) const;
+
+  //A record found valid while the storage is checked, with the count of
+  //rows referring it.
+  struct CheckedRecord
+  {
+    uint64_t   mSize;
+    uint_t     mKind;
+    uint32_t   mRefsCount;
+  };
 
   std::unique_ptr<IDataContainer> mEntriesContainer;
   BlockCache                      mEntriesCache;
-  uint64_t                        mFirstFreeEntry = { 0 };
-  uint64_t                        mEntriesCount = { 0 };
+  uint64_t                        mFreeHeads[FREE_CLASSES] = { 0, };
+  uint64_t                        mTailFreeRun = { 0 };
+  uint64_t                        mUnitsCount = { 0 };
+  uint_t                          mBlockUnits = { 0 };
   Lock                            mSync;
-  std::vector<bool>               mUsedEntries;
+  EntriesBitmap                   mUsedEntries;
+  std::map<uint64_t, CheckedRecord>  mCheckedRecords;
+  std::string                     mBaseName;
+  uint64_t                        mMaxFileSize = { 0 };
+  uint32_t                        mGenerations[GENERATIONS] = { 0, };
+  bool                            mClosed = { false };
 };
 
 using VariableSizeStoreSPtr = std::shared_ptr<VariableSizeStore>;
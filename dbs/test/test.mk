@@ -2,6 +2,10 @@ UNIT_EXES+=test_wfilecontainer
 test_wfilecontainer_SRC=test/test_wfilecontainer.cpp
 test_wfilecontainer_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc 
 
+UNIT_EXES+=test_temp_memory
+test_temp_memory_SRC=test/test_temp_memory.cpp
+test_temp_memory_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc 
+
 UNIT_EXES+=test_dbsmgr
 test_dbsmgr_SRC=test/test_dbsmgr.cpp
 test_dbsmgr_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc 
@@ -122,3 +126,75 @@ test_autofix_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmema
 UNIT_EXES+=test_field_variable_values
 test_field_variable_values_SRC=test/test_field_variable_values.cpp
 test_field_variable_values_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc 
+
+UNIT_EXES+=test_redolog
+test_redolog_SRC=test/test_redolog.cpp
+test_redolog_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc 
+
+UNIT_EXES+=test_redo_recovery
+test_redo_recovery_SRC=test/test_redo_recovery.cpp
+test_redo_recovery_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc 
+
+UNIT_EXES+=test_checkpointer
+test_checkpointer_SRC=test/test_checkpointer.cpp
+test_checkpointer_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc 
+
+UNIT_EXES+=test_parallel_repair
+test_parallel_repair_SRC=test/test_parallel_repair.cpp
+test_parallel_repair_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc 
+
+UNIT_EXES+=test_table_multisort
+test_table_multisort_SRC=test/test_table_multisort.cpp
+test_table_multisort_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc 
+
+UNIT_EXES+=test_table_alter
+test_table_alter_SRC=test/test_table_alter.cpp
+test_table_alter_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc 
+
+UNIT_EXES+=test_table_load
+test_table_load_SRC=test/test_table_load.cpp
+test_table_load_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
+
+UNIT_EXES+=test_table_export
+test_table_export_SRC=test/test_table_export.cpp
+test_table_export_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
+
+UNIT_EXES+=test_rowsset
+test_rowsset_SRC=test/test_rowsset.cpp
+test_rowsset_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
+
+UNIT_EXES+=test_field_stats
+test_field_stats_SRC=test/test_field_stats.cpp
+test_field_stats_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
+
+UNIT_EXES+=test_textbtindex
+test_textbtindex_SRC=test/test_textbtindex.cpp
+test_textbtindex_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
+
+UNIT_EXES+=test_hashindex
+test_hashindex_SRC=test/test_hashindex.cpp
+test_hashindex_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
+
+UNIT_EXES+=test_bitmapindex
+test_bitmapindex_SRC=test/test_bitmapindex.cpp
+test_bitmapindex_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
+
+UNIT_EXES+=test_trigramindex
+test_trigramindex_SRC=test/test_trigramindex.cpp
+test_trigramindex_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
+
+UNIT_EXES+=test_elementsindex
+test_elementsindex_SRC=test/test_elementsindex.cpp
+test_elementsindex_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
+
+UNIT_EXES+=test_compositeindex
+test_compositeindex_SRC=test/test_compositeindex.cpp
+test_compositeindex_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
+
+UNIT_EXES+=test_indexcursor
+test_indexcursor_SRC=test/test_indexcursor.cpp
+test_indexcursor_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
+
+UNIT_EXES+=test_deferredindex
+test_deferredindex_SRC=test/test_deferredindex.cpp
+test_deferredindex_LIB=dbs/wslpastra utils/wslutils custom/wslcustom custom/wslcppmemalloc
@@ -0,0 +1,281 @@
+#include <assert.h>
+#include <iostream>
+#include <set>
+
+#include "utils/wrandom.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_rowsset.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_bitmapindex_db";
+static const char table_name[] = "t_bitmapindex_table";
+
+static const ROW_INDEX TABLE_ROWS = 40000;
+static const uint_t STATUS_VALUES = 6;
+
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"id", T_UINT32, false},
+                                            {"status", T_UINT8, false},
+                                            {"flag", T_BOOL, false},
+                                            {"name", T_TEXT, false}
+                                          };
+
+
+static bool
+same_rows(const RowsSet& set, const std::set<ROW_INDEX>& expected)
+{
+  if (set.Count() != expected.size())
+    return false;
+
+  for (auto row : expected)
+  {
+    if ( ! set.Contains(row))
+      return false;
+  }
+
+  return true;
+}
+
+
+template<class T> static bool
+same_matches(ITable& table,
+             const FIELD_INDEX field,
+             const T& min,
+             const T& max,
+             const ROW_INDEX fromRow,
+             const ROW_INDEX toRow)
+{
+  std::set<ROW_INDEX> expected;
+
+  for (ROW_INDEX row = fromRow; (row <= toRow) && (row < table.AllocatedRows()); ++row)
+  {
+    T rowValue;
+    table.Get(row, field, rowValue);
+
+    if ((min <= rowValue) && (rowValue <= max))
+      expected.insert(row);
+  }
+
+  const RowsSet set = table.MatchRowsSet(min, max, fromRow, toRow, field);
+  const DArray array = table.MatchRows(min, max, fromRow, toRow, field);
+
+  return same_rows(set, expected) && (array.Count() == expected.size());
+}
+
+
+static bool
+check_matches(ITable& table)
+{
+  const FIELD_INDEX statusField = table.RetrieveField("status");
+  const FIELD_INDEX flagField = table.RetrieveField("flag");
+  const ROW_INDEX lastRow = table.AllocatedRows() - 1;
+
+  bool result = true;
+
+  for (uint_t s = 0; result && (s < STATUS_VALUES); ++s)
+    result = same_matches(table, statusField, DUInt8(s), DUInt8(s), 0, lastRow);
+
+  result = result && same_matches(table, statusField, DUInt8(), DUInt8(), 0, lastRow);
+  result = result && same_matches(table, statusField, DUInt8(1), DUInt8(3), 0, lastRow);
+  result = result && same_matches(table, statusField, DUInt8(2), DUInt8(4), 1000, 25000);
+  result = result && same_matches(table, flagField, DBool(true), DBool(true), 0, lastRow);
+  result = result && same_matches(table, flagField, DBool(), DBool(false), 100, lastRow);
+
+  //The rows sets of both fields are combined as a filter would.
+  RowsSet both = table.MatchRowsSet(DUInt8(2), DUInt8(2), 0, lastRow, statusField);
+  both.Intersect(table.MatchRowsSet(DBool(true), DBool(true), 0, lastRow, flagField));
+
+  RowsSet either = table.MatchRowsSet(DUInt8(5), DUInt8(5), 0, lastRow, statusField);
+  either.Unite(table.MatchRowsSet(DBool(false), DBool(false), 0, lastRow, flagField));
+
+  std::set<ROW_INDEX> expectedBoth, expectedEither;
+  for (ROW_INDEX row = 0; row <= lastRow; ++row)
+  {
+    DUInt8 status;
+    DBool flag;
+
+    table.Get(row, statusField, status);
+    table.Get(row, flagField, flag);
+
+    if ((status == DUInt8(2)) && (flag == DBool(true)))
+      expectedBoth.insert(row);
+
+    if ((status == DUInt8(5)) || (flag == DBool(false)))
+      expectedEither.insert(row);
+  }
+
+  result = result && same_rows(both, expectedBoth);
+  result = result && same_rows(either, expectedEither);
+
+  return result;
+}
+
+
+static void
+set_row(ITable& table, const ROW_INDEX row)
+{
+  const uint_t value = wh_rnd() % 100000;
+
+  table.Set(row, table.RetrieveField("id"), DUInt32(value));
+  table.Set(row,
+            table.RetrieveField("status"),
+            (value % 13 == 0) ? DUInt8() : DUInt8(value % STATUS_VALUES));
+  table.Set(row,
+            table.RetrieveField("flag"),
+            (value % 17 == 0) ? DBool() : DBool((value % 3) == 0));
+}
+
+
+static bool
+test_bitmap_index(ITable& table)
+{
+  std::cout << "Test matching the rows of bitmap indexed fields ... ";
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS / 2; ++row)
+  {
+    table.AddRow();
+    set_row(table, row);
+  }
+
+  table.CreateIndex(table.RetrieveField("status"), nullptr, nullptr, INDEX_BITMAP);
+  table.CreateIndex(table.RetrieveField("flag"), nullptr, nullptr, INDEX_BITMAP);
+
+  bool result = table.IsIndexed(table.RetrieveField("status"));
+  result = result && check_matches(table);
+
+  //The new rows start with null values, then get theirs.
+  for (ROW_INDEX row = TABLE_ROWS / 2; row < TABLE_ROWS; ++row)
+    table.AddRow();
+
+  result = result && check_matches(table);
+
+  for (ROW_INDEX row = TABLE_ROWS / 2; row < TABLE_ROWS; ++row)
+    set_row(table, row);
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; row += 7)
+    set_row(table, row);
+
+  result = result && check_matches(table);
+
+  table.Sort(table.RetrieveField("id"), 0, TABLE_ROWS - 1, false);
+  result = result && check_matches(table);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_bitmap_index_refused(ITable& table)
+{
+  std::cout << "Test refusing the bitmap indexes of unsuited fields ... ";
+
+  bool result = true;
+
+  try
+  {
+    table.CreateIndex(table.RetrieveField("id"), nullptr, nullptr, INDEX_BITMAP);
+    result = false;
+  }
+  catch (DBSException& e)
+  {
+    result = (e.Code() == DBSException::OPER_NOT_SUPPORTED);
+  }
+
+  try
+  {
+    table.CreateIndex(table.RetrieveField("name"), nullptr, nullptr, INDEX_BITMAP);
+    result = false;
+  }
+  catch (DBSException& e)
+  {
+    result = result && (e.Code() == DBSException::FIELD_TYPE_INVALID);
+  }
+
+  result = result && ! table.IsIndexed(table.RetrieveField("id"));
+  result = result && ! table.IsIndexed(table.RetrieveField("name"));
+
+  //The field can still be indexed otherwise.
+  table.CreateIndex(table.RetrieveField("id"), nullptr, nullptr);
+  result = result && table.IsIndexed(table.RetrieveField("id"));
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_bitmap_index_reload(ITable& table)
+{
+  std::cout << "Test the bitmap indexes of a reopened table ... ";
+
+  bool result = check_matches(table);
+
+  for (ROW_INDEX row = 1; row < TABLE_ROWS; row += 5)
+    set_row(table, row);
+
+  result = result && check_matches(table);
+
+  const FIELD_INDEX flagField = table.RetrieveField("flag");
+
+  table.RemoveIndex(flagField);
+  result = result && ! table.IsIndexed(flagField);
+  result = result && check_matches(table);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    success = success && test_bitmap_index(table);
+    success = success && test_bitmap_index_refused(table);
+    dbs.ReleaseTable(table);
+
+    ITable& reopened = dbs.RetrievePersistentTable(table_name);
+    success = success && test_bitmap_index_reload(reopened);
+    dbs.ReleaseTable(reopened);
+
+    dbs.DeleteTable(table_name);
+    DBSReleaseDatabase(dbs);
+  }
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
@@ -0,0 +1,273 @@
+#include <assert.h>
+#include <iostream>
+#include <string.h>
+
+#include "utils/wfile.h"
+#include "utils/wthread.h"
+#include "utils/endianness.h"
+#include "custom/include/test/test_fmw.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_values.h"
+
+#include "../pastra/ps_blockcache.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_checkpoint_db";
+static const char table_name[] = "t_checkpoint_table";
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"int_field", T_INT32, false},
+                                            {"text_field", T_TEXT, false}
+                                          };
+
+static const uint_t DB_FLAGS_OFF = 24;
+static const uint64_t DB_NOT_CLOSED_FLAG = 1;
+
+static const uint_t ITEM_SIZE = 16;
+static const uint_t ITEMS_PER_BLOCK = 4;
+static const uint_t CACHED_BLOCKS = 8;
+
+static const ROW_INDEX TABLE_ROWS = 2000;
+static const uint_t UPDATE_ROUNDS = 5;
+
+
+class CountingBlocksManager : public IBlocksManager
+{
+public:
+  CountingBlocksManager()
+    : mStoredBlocks(0)
+  {
+    memset(mItems, 0, sizeof mItems);
+  }
+
+  virtual void StoreItems(uint64_t firstItem, uint_t itemsCount, const uint8_t* const from)
+  {
+    assert(firstItem % ITEMS_PER_BLOCK == 0);
+
+    memcpy(mItems + firstItem * ITEM_SIZE, from, itemsCount * ITEM_SIZE);
+    ++mStoredBlocks;
+  }
+
+  virtual void RetrieveItems(uint64_t firstItem, uint_t itemsCount, uint8_t* const to)
+  {
+    memcpy(to, mItems + firstItem * ITEM_SIZE, itemsCount * ITEM_SIZE);
+  }
+
+  uint8_t   mItems[ITEM_SIZE * ITEMS_PER_BLOCK * CACHED_BLOCKS * 2];
+  uint_t    mStoredBlocks;
+};
+
+
+static bool
+test_dirty_blocks()
+{
+  std::cout << "Test the writing of the modified blocks ... ";
+
+  CountingBlocksManager manager;
+  BlockCache cache;
+
+  cache.Init(manager, ITEM_SIZE, ITEM_SIZE * ITEMS_PER_BLOCK, CACHED_BLOCKS, false);
+
+  //Read every cached block, but modify only three of them.
+  for (uint_t item = 0; item < ITEMS_PER_BLOCK * CACHED_BLOCKS; ++item)
+    cache.RetriveItem(item).GetDataForRead();
+
+  for (uint_t block = 1; block < CACHED_BLOCKS; block += 3)
+    cache.RetriveItem(block * ITEMS_PER_BLOCK + 1).GetDataForUpdate()[0] = block;
+
+  bool result = (cache.DirtyBlocksCount() == 3)
+                && cache.FlushSome(2)
+                && (manager.mStoredBlocks == 2)
+                && (cache.DirtyBlocksCount() == 1)
+                && ! cache.FlushSome(2)
+                && (manager.mStoredBlocks == 3);
+
+  for (uint_t block = 1; result && (block < CACHED_BLOCKS); block += 3)
+    result = (manager.mItems[(block * ITEMS_PER_BLOCK + 1) * ITEM_SIZE] == block);
+
+  //A modified block written because it's evicted should not be written again.
+  cache.RetriveItem(0).GetDataForUpdate()[0] = 0xFF;
+  cache.RetriveItem(ITEMS_PER_BLOCK * CACHED_BLOCKS).GetDataForRead();
+
+  result = result
+           && (cache.DirtyBlocksCount() == 0)
+           && (manager.mStoredBlocks == 4)
+           && (manager.mItems[0] == 0xFF);
+
+  cache.Flush();
+  result = result && (manager.mStoredBlocks == 4);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+database_not_closed()
+{
+  File dbFile((DBSGetSeettings().mWorkDir + db_name + ".db").c_str(),
+              WH_FILEOPEN_EXISTING | WH_FILEREAD);
+
+  uint8_t flags[sizeof(uint64_t)];
+
+  dbFile.Seek(DB_FLAGS_OFF, WH_SEEK_BEGIN);
+  dbFile.Read(flags, sizeof flags);
+
+  return (load_le_int64(flags) & DB_NOT_CLOSED_FLAG) != 0;
+}
+
+
+static DText
+row_text(const ROW_INDEX row, const uint_t round)
+{
+  std::string text = "Some text to keep the variable size store busy: ";
+
+  text += std::to_string(row) + "/" + std::to_string(round);
+
+  return DText(text.c_str());
+}
+
+
+static ITable* sharedTable;
+static IDBSHandler* sharedDbs;
+static volatile bool updatesDone;
+
+static void
+update_rows(void*)
+{
+  const FIELD_INDEX intField = sharedTable->RetrieveField("int_field");
+  const FIELD_INDEX textField = sharedTable->RetrieveField("text_field");
+
+  for (uint_t round = 1; round <= UPDATE_ROUNDS; ++round)
+  {
+    for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+    {
+      sharedTable->Set(row, intField, DInt32(row * 10 + round));
+      sharedTable->Set(row, textField, row_text(row, round));
+    }
+  }
+
+  updatesDone = true;
+}
+
+
+static void
+sync_tables(void*)
+{
+  while ( ! updatesDone)
+    sharedDbs->SyncAllTablesContent();
+}
+
+
+static bool
+test_concurrent_checkpoint(IDBSHandler& dbs)
+{
+  std::cout << "Test the tables updates while they are synchronized ... ";
+
+  sharedDbs = &dbs;
+  sharedTable = &dbs.RetrievePersistentTable(table_name);
+  {
+    const FIELD_INDEX intField = sharedTable->RetrieveField("int_field");
+    for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+    {
+      sharedTable->AddRow();
+      sharedTable->Set(row, intField, DInt32(row * 10));
+    }
+  }
+
+  updatesDone = false;
+
+  Thread updater, syncer;
+
+  updater.Run(update_rows, nullptr);
+  syncer.Run(sync_tables, nullptr);
+
+  updater.WaitToEnd(true);
+  syncer.WaitToEnd(true);
+
+  //Some updates might have been done after the last table flush.
+  dbs.SyncAllTablesContent();
+  bool result = ! database_not_closed();
+
+  //A table released while it's flushed should be kept until it's done.
+  sharedTable->Set(0, sharedTable->RetrieveField("int_field"), DInt32(-1));
+
+  updatesDone = false;
+  syncer.Run(sync_tables, nullptr);
+
+  dbs.ReleaseTable( *sharedTable);
+  updatesDone = true;
+
+  syncer.WaitToEnd(true);
+
+  ITable& table = dbs.RetrievePersistentTable(table_name);
+
+  const FIELD_INDEX intField = table.RetrieveField("int_field");
+  const FIELD_INDEX textField = table.RetrieveField("text_field");
+
+  for (ROW_INDEX row = 0; result && (row < TABLE_ROWS); ++row)
+  {
+    DInt32 intValue;
+    DText textValue;
+
+    table.Get(row, intField, intValue);
+    table.Get(row, textField, textValue);
+
+    result = (intValue == DInt32((row == 0) ? -1 : row * 10 + UPDATE_ROUNDS))
+             && (textValue == row_text(row, UPDATE_ROUNDS));
+  }
+
+  dbs.ReleaseTable(table);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSSettings settings;
+    settings.mTableCacheBlkSize = 1024;
+    settings.mTableCacheBlkCount = 128;
+    settings.mCheckpointBatch = 4;
+
+    DBSInit(settings);
+  }
+
+  success = success && test_dirty_blocks();
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+    success = success && test_concurrent_checkpoint(dbs);
+
+    DBSReleaseDatabase(dbs);
+  }
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
@@ -0,0 +1,360 @@
+#include <assert.h>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "utils/wrandom.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_rowsset.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_compositeindex_db";
+static const char table_name[] = "t_compositeindex_table";
+
+static const ROW_INDEX TABLE_ROWS = 20000;
+static const uint_t CUSTOMERS = 150;
+static const uint_t DAYS = 60;
+
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"customer", T_UINT32, false},
+                                            {"day", T_DATE, false},
+                                            {"amount", T_INT32, false}
+                                          };
+
+static FIELD_INDEX index_fields[2];
+
+
+static DDate
+day_value(const uint_t day)
+{
+  return DDate(2018, 1 + day / 28, 1 + day % 28);
+}
+
+
+static bool
+same_matches(ITable&              table,
+             const DUInt32&       customer,
+             const DDate&         fromDay,
+             const DDate&         toDay,
+             const bool           anyDay)
+{
+  std::set<ROW_INDEX> expected;
+
+  for (ROW_INDEX row = 0; row < table.AllocatedRows(); ++row)
+  {
+    DUInt32 rowCustomer;
+    DDate rowDay;
+
+    table.Get(row, index_fields[0], rowCustomer);
+    table.Get(row, index_fields[1], rowDay);
+
+    if ( ! (rowCustomer == customer))
+      continue;
+
+    if (anyDay || ( ! (rowDay < fromDay) && ! (toDay < rowDay)))
+      expected.insert(row);
+  }
+
+  CompositeKey min, max;
+
+  min.Add(customer);
+  max.Add(customer);
+  if ( ! anyDay)
+  {
+    min.Add(fromDay);
+    max.Add(toDay);
+  }
+  max.MarkUpperBound();
+
+  const RowsSet rows = table.MatchCompositeRows(index_fields, 2, min, max, 0, TABLE_ROWS);
+  if (rows.Count() != expected.size())
+    return false;
+
+  for (auto row : expected)
+  {
+    if ( ! rows.Contains(row))
+      return false;
+  }
+
+  return true;
+}
+
+
+static bool
+check_matches(ITable& table)
+{
+  bool result = true;
+
+  for (uint_t i = 0; result && (i < 6); ++i)
+  {
+    const uint_t customer = wh_rnd() % CUSTOMERS;
+    const uint_t day = wh_rnd() % DAYS;
+
+    result = result && same_matches(table, DUInt32(customer), DDate(), DDate(), true);
+    result = result && same_matches(table,
+                                    DUInt32(customer),
+                                    day_value(day),
+                                    day_value(MIN(day + 10, DAYS - 1)),
+                                    false);
+  }
+
+  result = result && same_matches(table, DUInt32(), DDate(), DDate(), true);
+  result = result && same_matches(table, DUInt32(), DDate(), day_value(5), false);
+
+  return result;
+}
+
+
+static bool
+check_sorted(ITable& table)
+{
+  for (ROW_INDEX row = 1; row < table.AllocatedRows(); ++row)
+  {
+    DUInt32 prevCustomer, customer;
+    DDate prevDay, day;
+
+    table.Get(row - 1, index_fields[0], prevCustomer);
+    table.Get(row - 1, index_fields[1], prevDay);
+    table.Get(row, index_fields[0], customer);
+    table.Get(row, index_fields[1], day);
+
+    if ((customer < prevCustomer) || ((customer == prevCustomer) && (day < prevDay)))
+      return false;
+  }
+
+  return true;
+}
+
+
+static int64_t
+amounts_sum(ITable& table)
+{
+  int64_t result = 0;
+
+  for (ROW_INDEX row = 0; row < table.AllocatedRows(); ++row)
+  {
+    DInt32 amount;
+    table.Get(row, table.RetrieveField("amount"), amount);
+
+    if ( ! amount.IsNull())
+      result += amount.mValue;
+  }
+
+  return result;
+}
+
+
+static void
+set_row(ITable& table, const ROW_INDEX row)
+{
+  const uint_t value = wh_rnd();
+
+  table.Set(row,
+            index_fields[0],
+            (value % 13 == 0) ? DUInt32() : DUInt32(value % CUSTOMERS));
+  table.Set(row,
+            index_fields[1],
+            (value % 17 == 0) ? DDate() : day_value((value / CUSTOMERS) % DAYS));
+  table.Set(row, table.RetrieveField("amount"), DInt32(value % 1000));
+}
+
+
+static bool
+test_composite_index(ITable& table)
+{
+  std::cout << "Test matching the rows of a composite index ... ";
+
+  index_fields[0] = table.RetrieveField("customer");
+  index_fields[1] = table.RetrieveField("day");
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS / 2; ++row)
+  {
+    table.AddRow();
+    set_row(table, row);
+  }
+
+  table.CreateCompositeIndex(index_fields, 2, nullptr, nullptr);
+
+  bool result = (table.CompositeIndexes().size() == 1);
+  result = result && ! table.IsIndexed(index_fields[0]);
+  result = result && check_matches(table);
+
+  //The index is kept up to date with the rows added or changed after it.
+  for (ROW_INDEX row = TABLE_ROWS / 2; row < TABLE_ROWS; ++row)
+    set_row(table, row);
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; row += 3)
+    set_row(table, row);
+
+  for (ROW_INDEX row = 1; row < TABLE_ROWS; row += 7)
+    table.Set(row, index_fields[1], DDate());
+
+  result = result && check_matches(table);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_composite_index_sort(ITable& table)
+{
+  std::cout << "Test sorting the rows by the fields of a composite index ... ";
+
+  const int64_t sum = amounts_sum(table);
+  const bool reverse[] = {false, false};
+
+  table.Sort(index_fields, reverse, 2, 0, TABLE_ROWS - 1);
+
+  bool result = check_sorted(table);
+  result = result && (amounts_sum(table) == sum);
+  result = result && check_matches(table);
+
+  //The sorted rows keep the index usable for the next sort.
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; row += 11)
+    set_row(table, row);
+
+  table.Sort(index_fields, reverse, 2, 0, TABLE_ROWS - 1);
+
+  result = result && check_sorted(table);
+  result = result && check_matches(table);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_composite_index_definitions(ITable& table)
+{
+  std::cout << "Test the composite indexes definitions checks ... ";
+
+  bool result = true;
+
+  const FIELD_INDEX sameFields[] = {index_fields[0], index_fields[0]};
+  const FIELD_INDEX otherFields[] = {index_fields[1], index_fields[0]};
+
+  try
+  {
+    table.CreateCompositeIndex(index_fields, 1, nullptr, nullptr);
+    result = false;
+  }
+  catch (DBSException&)
+  {
+  }
+
+  try
+  {
+    table.CreateCompositeIndex(sameFields, 2, nullptr, nullptr);
+    result = false;
+  }
+  catch (DBSException&)
+  {
+  }
+
+  try
+  {
+    table.CreateCompositeIndex(index_fields, 2, nullptr, nullptr);
+    result = false;
+  }
+  catch (DBSException& e)
+  {
+    result = result && (e.Code() == DBSException::FIELD_INDEXED);
+  }
+
+  //The same fields in another order make another index.
+  table.CreateCompositeIndex(otherFields, 2, nullptr, nullptr);
+  result = result && (table.CompositeIndexes().size() == 2);
+
+  table.RemoveCompositeIndex(otherFields, 2);
+  result = result && (table.CompositeIndexes().size() == 1);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_composite_index_reload(ITable& table)
+{
+  std::cout << "Test the composite index of a reopened table ... ";
+
+  bool result = (table.CompositeIndexes().size() == 1);
+  result = result && check_matches(table);
+
+  for (ROW_INDEX row = 1; row < TABLE_ROWS; row += 5)
+    set_row(table, row);
+
+  result = result && check_matches(table);
+
+  table.RemoveCompositeIndex(index_fields, 2);
+  result = result && table.CompositeIndexes().empty();
+
+  try
+  {
+    table.MatchCompositeRows(index_fields, 2, CompositeKey(), CompositeKey::Max(), 0, TABLE_ROWS);
+    result = false;
+  }
+  catch (DBSException& e)
+  {
+    result = result && (e.Code() == DBSException::FIELD_NOT_INDEXED);
+  }
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    success = success && test_composite_index(table);
+    success = success && test_composite_index_sort(table);
+    success = success && test_composite_index_definitions(table);
+    dbs.ReleaseTable(table);
+
+    ITable& reopened = dbs.RetrievePersistentTable(table_name);
+    success = success && test_composite_index_reload(reopened);
+    dbs.ReleaseTable(reopened);
+
+    dbs.DeleteTable(table_name);
+    DBSReleaseDatabase(dbs);
+  }
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <iostream>
 #include <string.h>
+#include <vector>
 
 #include "dbs/dbs_mgr.h"
 #include "dbs/dbs_exception.h"
@@ -573,6 +574,83 @@ test_array_copy_optimizations()
   return result;
 }
 
+bool
+test_array_ranges()
+{
+  std::cout << "Testing array elements ranges... ";
+  bool result = true;
+
+  const uint64_t elementsCount = 10000;
+
+  std::vector<DInt32> values;
+  for (uint64_t i = 0; i < elementsCount; ++i)
+    values.push_back(DInt32((i * 7919) % 10007 - 5000));
+
+  DArray array(values.data(), 3);
+  if ((array.Count() != 3) || (array.Add(values.data() + 3, elementsCount - 3) != 3))
+    result = false;
+
+  std::vector<DInt32> loaded(elementsCount + 10);
+  if (result && (array.Get(0, loaded.size(), loaded.data()) != elementsCount))
+    result = false;
+
+  for (uint64_t i = 0; result && (i < elementsCount); ++i)
+  {
+    if (loaded[i] != values[i])
+      result = false;
+  }
+
+  if (result && (array.Get(elementsCount - 5, 100, loaded.data()) != 5))
+    result = false;
+
+  if (result && (array.Get(elementsCount, 100, loaded.data()) != 0))
+    result = false;
+
+  if (result)
+  {
+    DArray copy = array;
+
+    copy.Sort(true);
+    copy.Get(0, elementsCount, loaded.data());
+    for (uint64_t i = 1; result && (i < elementsCount); ++i)
+    {
+      if (loaded[i - 1] < loaded[i])
+        result = false;
+    }
+
+    //The original is not affected by the sort of the copy.
+    array.Get(0, 1, loaded.data());
+    if (loaded[0] != values[0])
+      result = false;
+  }
+
+  if (result)
+  {
+    DInt32 nullValue;
+    try
+    {
+      array.Add(&nullValue, 1);
+      result = false;
+    }
+    catch (DBSException&)
+    {
+    }
+
+    DUInt8 wrongType;
+    try
+    {
+      array.Get(0, 1, &wrongType);
+      result = false;
+    }
+    catch (DBSException&)
+    {
+    }
+  }
+
+  std::cout << ( result ? "OK" : "FALSE") << std::endl;
+  return result;
+}
+
 int
 main()
 {
@@ -589,6 +667,7 @@ main()
   success = success && test_datetimes_array();
   success = success && test_hiresdate_array();
   success = success && test_array_copy_optimizations();
+  success = success && test_array_ranges();
 
   DBSShoutdown();
 
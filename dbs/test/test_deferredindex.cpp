@@ -0,0 +1,261 @@
+#include <assert.h>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "utils/wrandom.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_rowsset.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_deferredindex_db";
+static const char table_name[] = "t_deferredindex_table";
+
+//More rows than the changes kept aside, so some are applied on the way.
+static const ROW_INDEX TABLE_ROWS = 80000;
+static const uint_t PRICES = 700;
+
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"price", T_UINT32, false},
+                                            {"day", T_DATE, false}
+                                          };
+
+
+static void
+set_row(ITable& table, const FIELD_INDEX field, const ROW_INDEX row)
+{
+  const uint_t value = wh_rnd();
+
+  table.Set(row, field, (value % 23 == 0) ? DUInt32() : DUInt32(value % PRICES));
+}
+
+
+static bool
+same_matches(ITable& table, const FIELD_INDEX field, const uint_t min, const uint_t max)
+{
+  std::set<ROW_INDEX> expected;
+
+  for (ROW_INDEX row = 0; row < table.AllocatedRows(); ++row)
+  {
+    DUInt32 price;
+    table.Get(row, field, price);
+
+    if ( ! price.IsNull() && (min <= price.mValue) && (price.mValue <= max))
+      expected.insert(row);
+  }
+
+  const RowsSet rows = table.MatchRowsSet(DUInt32(min),
+                                          DUInt32(max),
+                                          0,
+                                          table.AllocatedRows(),
+                                          field);
+  if (rows.Count() != expected.size())
+    return false;
+
+  for (auto row : expected)
+  {
+    if ( ! rows.Contains(row))
+      return false;
+  }
+
+  return true;
+}
+
+
+static bool
+check_matches(ITable& table, const FIELD_INDEX field)
+{
+  bool result = true;
+
+  for (uint_t i = 0; result && (i < 5); ++i)
+  {
+    const uint_t price = wh_rnd() % PRICES;
+
+    result = result && same_matches(table, field, price, price);
+    result = result && same_matches(table, field, price, price + 40);
+  }
+
+  return result && same_matches(table, field, 0, PRICES);
+}
+
+
+//The index walk sees every not null value too.
+static bool
+check_entries_count(ITable& table, const FIELD_INDEX field)
+{
+  ROW_INDEX expected = 0;
+  for (ROW_INDEX row = 0; row < table.AllocatedRows(); ++row)
+  {
+    DUInt32 price;
+    table.Get(row, field, price);
+
+    if ( ! price.IsNull())
+      ++expected;
+  }
+
+  DArray values, rows;
+  const uint_t count = table.FetchIndexEntries(field,
+                                               DArray(),
+                                               INVALID_ROW_INDEX,
+                                               false,
+                                               TABLE_ROWS,
+                                               values,
+                                               rows);
+  return count == expected;
+}
+
+
+static bool
+test_deferred_updates(ITable& table)
+{
+  std::cout << "Test matching the rows of deferred index updates ... ";
+
+  const FIELD_INDEX field = table.RetrieveField("price");
+
+  table.CreateIndex(field, nullptr, nullptr);
+  table.DeferIndexesUpdates(true);
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+    set_row(table, field, row);
+
+  bool result = check_matches(table, field);
+
+  //The same rows are changed over and over, some back to their values.
+  for (uint_t i = 0; i < 4; ++i)
+  {
+    for (ROW_INDEX row = i; row < TABLE_ROWS; row += 5)
+      set_row(table, field, row);
+  }
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; row += 9)
+  {
+    DUInt32 price;
+    table.Get(row, field, price);
+
+    table.Set(row, field, DUInt32(PRICES + 1));
+    table.Set(row, field, price);
+  }
+
+  result = result && check_matches(table, field);
+  result = result && check_entries_count(table, field);
+
+  for (ROW_INDEX row = 1; row < TABLE_ROWS; row += 7)
+    set_row(table, field, row);
+
+  table.Flush();
+  result = result && check_matches(table, field);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_immediate_updates(ITable& table)
+{
+  std::cout << "Test going back to the immediate index updates ... ";
+
+  const FIELD_INDEX field = table.RetrieveField("price");
+
+  for (ROW_INDEX row = 2; row < TABLE_ROWS; row += 3)
+    set_row(table, field, row);
+
+  table.DeferIndexesUpdates(false);
+
+  bool result = check_matches(table, field);
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; row += 4)
+    set_row(table, field, row);
+
+  result = result && check_matches(table, field);
+
+  //The changes kept aside are dropped with the index.
+  table.DeferIndexesUpdates(true);
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; row += 6)
+    set_row(table, field, row);
+
+  table.RemoveIndex(field);
+  table.CreateIndex(field, nullptr, nullptr);
+
+  for (ROW_INDEX row = 3; row < TABLE_ROWS; row += 6)
+    set_row(table, field, row);
+
+  result = result && check_matches(table, field);
+  result = result && check_entries_count(table, field);
+
+  //Left deferred, to be applied when the table is released.
+  for (ROW_INDEX row = 5; row < TABLE_ROWS; row += 11)
+    set_row(table, field, row);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_reopened_index(ITable& table)
+{
+  std::cout << "Test the index of a reopened table ... ";
+
+  const FIELD_INDEX field = table.RetrieveField("price");
+
+  bool result = check_matches(table, field);
+  result = result && check_entries_count(table, field);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    success = success && test_deferred_updates(table);
+    success = success && test_immediate_updates(table);
+    dbs.ReleaseTable(table);
+
+    ITable& reopened = dbs.RetrievePersistentTable(table_name);
+    success = success && test_reopened_index(reopened);
+    dbs.ReleaseTable(reopened);
+
+    dbs.DeleteTable(table_name);
+    DBSReleaseDatabase(dbs);
+  }
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
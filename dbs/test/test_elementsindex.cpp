@@ -0,0 +1,301 @@
+#include <assert.h>
+#include <iostream>
+#include <set>
+
+#include "utils/wrandom.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_rowsset.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_elementsindex_db";
+static const char table_name[] = "t_elementsindex_table";
+
+static const ROW_INDEX TABLE_ROWS = 15000;
+static const uint_t TAGS_VALUES = 300;
+
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"id", T_UINT32, false},
+                                            {"tags", T_UINT16, true},
+                                            {"dates", T_DATE, true}
+                                          };
+
+
+static bool
+holds(const DArray& array, const DUInt16& value)
+{
+  for (uint64_t i = 0; i < array.Count(); ++i)
+  {
+    DUInt16 element;
+    array.Get(i, element);
+
+    if (element == value)
+      return true;
+  }
+
+  return false;
+}
+
+
+static bool
+same_matches(ITable& table,
+             const DArray& values,
+             const bool matchAll,
+             const ROW_INDEX fromRow,
+             const ROW_INDEX toRow)
+{
+  const FIELD_INDEX field = table.RetrieveField("tags");
+  std::set<ROW_INDEX> expected;
+
+  for (ROW_INDEX row = fromRow; (row <= toRow) && (row < table.AllocatedRows()); ++row)
+  {
+    DArray rowValue;
+    table.Get(row, field, rowValue);
+
+    bool matched = matchAll;
+    for (uint64_t i = 0; i < values.Count(); ++i)
+    {
+      DUInt16 value;
+      values.Get(i, value);
+
+      if (matchAll)
+        matched = matched && holds(rowValue, value);
+
+      else
+        matched = matched || holds(rowValue, value);
+    }
+
+    if (matched && ! values.IsNull())
+      expected.insert(row);
+  }
+
+  const RowsSet found = table.MatchArrayRows(values, matchAll, fromRow, toRow, field);
+  if (found.Count() != expected.size())
+    return false;
+
+  for (auto row : expected)
+  {
+    if ( ! found.Contains(row))
+      return false;
+  }
+
+  return true;
+}
+
+
+static bool
+check_matches(ITable& table)
+{
+  const ROW_INDEX lastRow = table.AllocatedRows() - 1;
+  bool result = true;
+
+  for (uint_t i = 0; result && (i < 10); ++i)
+  {
+    DArray values;
+
+    const uint_t count = 1 + wh_rnd() % 3;
+    for (uint_t c = 0; c < count; ++c)
+      values.Add(DUInt16(wh_rnd() % TAGS_VALUES));
+
+    result = same_matches(table, values, false, 0, lastRow)
+             && same_matches(table, values, true, 0, lastRow)
+             && same_matches(table, values, false, 500, 4000);
+  }
+
+  //A common element matches most of the rows.
+  DArray common;
+  common.Add(DUInt16(0));
+  common.Add(DUInt16(TAGS_VALUES + 1));
+
+  result = result && same_matches(table, common, false, 0, lastRow);
+  result = result && same_matches(table, common, true, 0, lastRow);
+  result = result && same_matches(table, DArray(), false, 0, lastRow);
+
+  return result;
+}
+
+
+static void
+set_row(ITable& table, const ROW_INDEX row)
+{
+  DArray tags;
+
+  const uint_t count = wh_rnd() % 8;
+  for (uint_t c = 0; c < count; ++c)
+    tags.Add(DUInt16(wh_rnd() % TAGS_VALUES));
+
+  if ((count > 0) && (wh_rnd() % 2 == 0))
+    tags.Add(DUInt16(0));
+
+  table.Set(row, table.RetrieveField("id"), DUInt32(wh_rnd() % 100000));
+  table.Set(row, table.RetrieveField("tags"), tags);
+}
+
+
+static bool
+test_elements_index(ITable& table)
+{
+  std::cout << "Test matching the rows of an elements indexed field ... ";
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS / 2; ++row)
+  {
+    table.AddRow();
+    set_row(table, row);
+  }
+
+  bool result = check_matches(table);
+
+  table.CreateIndex(table.RetrieveField("tags"), nullptr, nullptr, INDEX_ELEMENTS);
+
+  result = result && table.IsIndexed(table.RetrieveField("tags"));
+  result = result && check_matches(table);
+
+  for (ROW_INDEX row = TABLE_ROWS / 2; row < TABLE_ROWS; ++row)
+    table.AddRow();
+
+  for (ROW_INDEX row = TABLE_ROWS / 2; row < TABLE_ROWS; row += 2)
+    set_row(table, row);
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; row += 7)
+    set_row(table, row);
+
+  result = result && check_matches(table);
+
+  table.Sort(table.RetrieveField("id"), 0, TABLE_ROWS - 1, false);
+  result = result && check_matches(table);
+
+  //The other index kinds do not support the array fields.
+  try
+  {
+    table.CreateIndex(table.RetrieveField("dates"), nullptr, nullptr, INDEX_BTREE);
+    result = false;
+  }
+  catch (DBSException& e)
+  {
+    result = result && (e.Code() == DBSException::FIELD_TYPE_INVALID);
+  }
+
+  try
+  {
+    table.CreateIndex(table.RetrieveField("id"), nullptr, nullptr, INDEX_ELEMENTS);
+    result = false;
+  }
+  catch (DBSException& e)
+  {
+    result = result && (e.Code() == DBSException::FIELD_TYPE_INVALID);
+  }
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_emptied_arrays(ITable& table)
+{
+  std::cout << "Test emptying the arrays of an elements indexed field ... ";
+
+  const FIELD_INDEX tagsField = table.RetrieveField("tags");
+  const ROW_INDEX reusableRows = table.ReusableRowsCount();
+  const ROW_INDEX row = table.AddRow();
+
+  DArray tags;
+  tags.Add(DUInt16(TAGS_VALUES + 2));
+
+  table.Set(row, tagsField, tags);
+  bool result = (table.ReusableRowsCount() == reusableRows);
+  result = result && check_matches(table);
+
+  //An empty array is a null value, leaving the row with no values at all.
+  table.Set(row, tagsField, DArray());
+
+  DArray rowValue;
+  table.Get(row, tagsField, rowValue);
+
+  result = result && rowValue.IsNull();
+  result = result && (table.ReusableRowsCount() == reusableRows + 1);
+  result = result && check_matches(table);
+
+  table.Set(row, tagsField, tags);
+  result = result && (table.ReusableRowsCount() == reusableRows);
+  result = result && same_matches(table, tags, false, 0, table.AllocatedRows() - 1);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_elements_index_reload(ITable& table)
+{
+  std::cout << "Test the elements index of a reopened table ... ";
+
+  bool result = check_matches(table);
+
+  for (ROW_INDEX row = 1; row < TABLE_ROWS; row += 5)
+    set_row(table, row);
+
+  result = result && check_matches(table);
+
+  const FIELD_INDEX tagsField = table.RetrieveField("tags");
+
+  table.RemoveIndex(tagsField);
+  result = result && ! table.IsIndexed(tagsField);
+  result = result && check_matches(table);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    success = success && test_elements_index(table);
+    success = success && test_emptied_arrays(table);
+    dbs.ReleaseTable(table);
+
+    ITable& reopened = dbs.RetrievePersistentTable(table_name);
+    success = success && test_elements_index_reload(reopened);
+    dbs.ReleaseTable(reopened);
+
+    dbs.DeleteTable(table_name);
+    DBSReleaseDatabase(dbs);
+  }
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
@@ -0,0 +1,161 @@
+#include <assert.h>
+#include <iostream>
+#include <string>
+
+#include "utils/wrandom.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_stats_db";
+static const char table_name[] = "t_stats_table";
+
+static const ROW_INDEX TABLE_ROWS     = 60000;
+static const uint_t    DISTINCT_VALUES = 1000;
+
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"value", T_UINT32, false},
+                                            {"day", T_DATE, false},
+                                            {"note", T_TEXT, false}
+                                          };
+
+
+static bool
+near(const uint64_t value, const uint64_t expected, const uint64_t error)
+{
+  return (expected <= value + error) && (value <= expected + error);
+}
+
+
+static bool
+test_values_stats(ITable& table)
+{
+  std::cout << "Test the field values statistics ... ";
+
+  const FIELD_INDEX valueField = table.RetrieveField("value");
+  const FIELD_INDEX dayField = table.RetrieveField("day");
+  const FIELD_INDEX noteField = table.RetrieveField("note");
+
+  uint64_t nulls = 0;
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+  {
+    table.AddRow();
+    if (row % 10 == 0)
+    {
+      ++nulls;
+      table.Set(row, noteField, DText("some note"));
+      continue;
+    }
+
+    table.Set(row, valueField, DUInt32(wh_rnd() % DISTINCT_VALUES));
+    table.Set(row, dayField, DDate(2000, 1 + row % 12, 1 + row % 28));
+  }
+
+  bool result = true;
+
+  const DBSFieldStats values = table.GetFieldStats(valueField);
+  result = result && (values.mRowsCount == TABLE_ROWS);
+  result = result && (values.mNullsCount == nulls);
+  result = result && near(values.mDistinctCount, DISTINCT_VALUES, DISTINCT_VALUES / 20);
+  result = result && (values.mHistogram.size() == 64);
+
+  //The values are spread evenly, so should be the histogram's bounds.
+  for (size_t b = 0; result && (b < values.mHistogram.size()); ++b)
+  {
+    const uint64_t bound = std::stoul(values.mHistogram[b]);
+    result = near(bound, (b + 1) * DISTINCT_VALUES / 64, DISTINCT_VALUES / 20);
+  }
+
+  const DBSFieldStats days = table.GetFieldStats(dayField);
+  result = result && (days.mNullsCount == nulls);
+  //A month and a day are paired every 84 rows.
+  result = result && near(days.mDistinctCount, 84, 4);
+  result = result && (days.mHistogram.back() == "2000/12/28");
+
+  const DBSFieldStats notes = table.GetFieldStats(noteField);
+  result = result && (notes.mRowsCount == TABLE_ROWS);
+  result = result && (notes.mNullsCount == TABLE_ROWS - nulls);
+  result = result && notes.mHistogram.empty() && (notes.mDistinctCount == 0);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_stats_refresh(ITable& table)
+{
+  std::cout << "Test the field statistics refresh ... ";
+
+  const FIELD_INDEX valueField = table.RetrieveField("value");
+  const uint64_t nulls = table.GetFieldStats(valueField).mNullsCount;
+
+  bool result = true;
+
+  //A few changes leave the statistics as they are.
+  for (ROW_INDEX row = 1; row < 100; ++row)
+    table.Set(row, valueField, DUInt32());
+
+  result = result && (table.GetFieldStats(valueField).mNullsCount == nulls);
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+    table.Set(row, valueField, DUInt32(7));
+
+  const DBSFieldStats values = table.GetFieldStats(valueField);
+  result = result && (values.mNullsCount == 0);
+  result = result && (values.mDistinctCount == 1);
+  result = result && (values.mHistogram.front() == "7") && (values.mHistogram.back() == "7");
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+
+    success = success && test_values_stats(table);
+    success = success && test_stats_refresh(table);
+
+    dbs.ReleaseTable(table);
+    dbs.DeleteTable(table_name);
+    DBSReleaseDatabase(dbs);
+  }
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
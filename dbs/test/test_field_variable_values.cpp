@@ -8,7 +8,10 @@
 #include <assert.h>
 #include <iostream>
 #include <string.h>
+#include <memory>
+#include <vector>
 
+#include "utils/wfile.h"
 #include "dbs/dbs_mgr.h"
 #include "dbs/dbs_exception.h"
 
@@ -20,6 +23,10 @@ using namespace pastra;
 
 const char db_name[] = "t_baza_date_1";
 const char tb_name[] = "t_test_tab";
+const char shared_tb_name[] = "t_shared_tab";
+
+static const ROW_INDEX SHARED_ROWS = 200;
+static const uint_t SHARED_ELEMENTS = 256;
 
 
 static char text1[]     = "Test_1";
@@ -425,6 +432,231 @@ test_array_table(IDBSHandler& h)
   return true;
 }
 
+static bool
+test_shared_values(IDBSHandler& h)
+{
+  std::cout << "Testing values shared between rows ... ";
+
+  DBSFieldDescriptor fieldsDescs[] = {
+                                       {"test_text", T_TEXT, false},
+                                       {"test_array", T_INT64, true}
+                                     };
+  h.AddTable(shared_tb_name, sizeof fieldsDescs / sizeof fieldsDescs[0], fieldsDescs);
+
+  DText text;
+  DArray array;
+
+  for (uint_t i = 0; i < SHARED_ELEMENTS; ++i)
+  {
+    text.Append(DChar('a' + i % 26));
+    array.Add(DInt64(i));
+  }
+
+  {
+    ITable& table = h.RetrievePersistentTable(shared_tb_name);
+
+    const FIELD_INDEX textField = table.RetrieveField("test_text");
+    const FIELD_INDEX arrayField = table.RetrieveField("test_array");
+
+    for (ROW_INDEX row = 0; row < SHARED_ROWS; ++row)
+    {
+      table.Set(row, textField, text);
+      table.Set(row, arrayField, array);
+    }
+
+    //Copies of the stored values should be shared too.
+    DText rowText;
+    DArray rowArray;
+
+    table.Get(0, textField, rowText);
+    table.Get(0, arrayField, rowArray);
+    table.Set(SHARED_ROWS, textField, rowText);
+    table.Set(SHARED_ROWS, arrayField, rowArray);
+
+    h.ReleaseTable(table);
+  }
+
+  const std::string vsFile = DBSGetSeettings().mWorkDir + shared_tb_name + "_v";
+  if (File(vsFile.c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD).Size()
+      > SHARED_ELEMENTS * (1 + sizeof(uint64_t)) * SHARED_ROWS / 8)
+  {
+    return false;
+  }
+
+  ITable& table = h.RetrievePersistentTable(shared_tb_name);
+
+  const FIELD_INDEX textField = table.RetrieveField("test_text");
+  const FIELD_INDEX arrayField = table.RetrieveField("test_array");
+
+  //Changing a value should not affect the rows sharing it.
+  DText rowText, textCopy = text;
+  DArray rowArray, arrayCopy = array;
+
+  table.Get(1, textField, rowText);
+  table.Get(1, arrayField, rowArray);
+
+  rowText.Append(DChar('X'));
+  rowArray.Set(0, DInt64(-1));
+  table.Set(1, textField, rowText);
+  table.Set(1, arrayField, rowArray);
+
+  text.Append(DChar('Y'));
+  array.Add(DInt64(-2));
+  table.Set(2, textField, text);
+  table.Set(2, arrayField, array);
+
+  for (ROW_INDEX row = 0; row <= SHARED_ROWS; ++row)
+  {
+    DText fieldText;
+    DArray fieldArray;
+
+    table.Get(row, textField, fieldText);
+    table.Get(row, arrayField, fieldArray);
+
+    if (row == 1)
+    {
+      if ((fieldText != rowText) || (fieldArray != rowArray))
+        return false;
+    }
+    else if (row == 2)
+    {
+      if ((fieldText != text) || (fieldArray != array))
+        return false;
+    }
+    else if ((fieldText != textCopy) || (fieldArray != arrayCopy))
+      return false;
+  }
+
+  if ((rowText == textCopy) || (rowArray == arrayCopy))
+    return false;
+
+  h.ReleaseTable(table);
+  h.DeleteTable(shared_tb_name);
+
+  std::cout << "OK\n";
+  return true;
+}
+
+
+static DText
+filled_text(const char c)
+{
+  DText result;
+
+  for (uint_t i = 0; i < SHARED_ELEMENTS * 4; ++i)
+    result.Append(DChar(c));
+
+  return result;
+}
+
+static bool
+test_unbound_values(IDBSHandler& h)
+{
+  std::cout << "Testing values stored in rows no longer holding them ... ";
+
+  DBSFieldDescriptor fieldsDescs[] = { {"test_text", T_TEXT, false} };
+  h.AddTable(shared_tb_name, sizeof fieldsDescs / sizeof fieldsDescs[0], fieldsDescs);
+
+  const std::string vsFile = DBSGetSeettings().mWorkDir + shared_tb_name + "_v";
+  const DText text = filled_text('a');
+  const DText otherText = filled_text('b');
+
+  bool result = true;
+  uint64_t storeSize = 0;
+  {
+    ITable& table = h.RetrievePersistentTable(shared_tb_name);
+
+    table.Set(0, table.RetrieveField("test_text"), text);
+    h.ReleaseTable(table);
+
+    storeSize = File(vsFile.c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD).Size();
+  }
+
+  ITable& table = h.RetrievePersistentTable(shared_tb_name);
+  const FIELD_INDEX field = table.RetrieveField("test_text");
+
+  //The value still around should not keep its record once no row has it.
+  table.Set(0, field, DText());
+  table.Set(0, field, otherText);
+  table.Flush();
+
+  result = (File(vsFile.c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD).Size() == storeSize);
+
+  //A value whose record was removed and its place reused is copied again.
+  table.Set(1, field, text);
+  table.Set(1, field, DText());
+  table.Set(2, field, otherText);
+  table.Set(3, field, text);
+
+  DText fieldText;
+
+  table.Get(3, field, fieldText);
+  result = result && (fieldText == text);
+
+  table.Get(2, field, fieldText);
+  result = result && (fieldText == otherText);
+
+  h.ReleaseTable(table);
+  h.DeleteTable(shared_tb_name);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+static std::vector<uint8_t>
+file_content(const std::string& fileName)
+{
+  File file(fileName.c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD);
+  std::vector<uint8_t> result(file.Size());
+
+  file.Seek(0, WH_SEEK_BEGIN);
+  file.Read(result.data(), result.size());
+
+  return result;
+}
+
+static bool
+test_outliving_values(IDBSHandler& h)
+{
+  std::cout << "Testing values outliving the table they were read from ... ";
+
+  DBSFieldDescriptor fieldsDescs[] = { {"test_text", T_TEXT, false} };
+  h.AddTable(shared_tb_name, sizeof fieldsDescs / sizeof fieldsDescs[0], fieldsDescs);
+
+  const std::string vsFile = DBSGetSeettings().mWorkDir + shared_tb_name + "_v";
+  const DText text = filled_text('c');
+
+  std::unique_ptr<DText> readText(new DText());
+  {
+    ITable& table = h.RetrievePersistentTable(shared_tb_name);
+    const FIELD_INDEX field = table.RetrieveField("test_text");
+
+    table.Set(0, field, text);
+    table.Get(0, field, *readText);
+
+    h.ReleaseTable(table);
+  }
+
+  ITable& table = h.RetrievePersistentTable(shared_tb_name);
+  const std::vector<uint8_t> storeContent = file_content(vsFile);
+
+  //The value still reads its record, but once its table was released it
+  //should not write anything to the files the table was opened again over.
+  bool result = (*readText == text);
+
+  readText.reset();
+  result = result && (file_content(vsFile) == storeContent);
+
+  DText fieldText;
+  table.Get(0, table.RetrieveField("test_text"), fieldText);
+  result = result && (fieldText == text);
+
+  h.ReleaseTable(table);
+  h.DeleteTable(shared_tb_name);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
 
 int
 main()
@@ -439,6 +671,9 @@ main()
 
   success &= test_text_table(handler);
   success &= test_array_table(handler);
+  success &= test_shared_values(handler);
+  success &= test_unbound_values(handler);
+  success &= test_outliving_values(handler);
 
   DBSReleaseDatabase(handler);
   DBSRemoveDatabase(db_name);
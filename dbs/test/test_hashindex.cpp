@@ -0,0 +1,222 @@
+#include <assert.h>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "utils/wrandom.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_rowsset.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_hashindex_db";
+static const char table_name[] = "t_hashindex_table";
+
+static const ROW_INDEX TABLE_ROWS = 30000;
+
+//Few values, so every one is held by many rows (e.g. chained in overflow pages).
+static const uint_t DUPLICATED_VALUES = 7;
+
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"id", T_UINT32, false},
+                                            {"kind", T_UINT8, false},
+                                            {"name", T_TEXT, false}
+                                          };
+
+
+static std::string
+row_name(const uint_t value)
+{
+  if (value % 5 == 0)
+    return std::string();
+
+  else if (value % 5 == 1)
+    return "u" + std::to_string(value % 2000);
+
+  return "customer.with.a.long.name#" + std::to_string(value % 3000);
+}
+
+
+template<class T> static bool
+same_matches(ITable& table, const FIELD_INDEX field, const T& value)
+{
+  std::set<ROW_INDEX> expected;
+
+  for (ROW_INDEX row = 0; row < table.AllocatedRows(); ++row)
+  {
+    T rowValue;
+    table.Get(row, field, rowValue);
+
+    if (rowValue == value)
+      expected.insert(row);
+  }
+
+  const RowsSet set = table.MatchRowsSet(value, value, 0, TABLE_ROWS, field);
+  const DArray array = table.MatchRows(value, value, 0, TABLE_ROWS, field);
+
+  if ((set.Count() != expected.size()) || (array.Count() != expected.size()))
+    return false;
+
+  for (auto row : expected)
+  {
+    if ( ! set.Contains(row))
+      return false;
+  }
+
+  return true;
+}
+
+
+static bool
+check_matches(ITable& table)
+{
+  const FIELD_INDEX idField = table.RetrieveField("id");
+  const FIELD_INDEX kindField = table.RetrieveField("kind");
+  const FIELD_INDEX nameField = table.RetrieveField("name");
+
+  bool result = true;
+
+  for (uint_t i = 0; result && (i < 4); ++i)
+  {
+    const uint_t value = wh_rnd() % 100000;
+
+    result = result && same_matches(table, idField, DUInt32(value));
+    result = result && same_matches(table, nameField, DText(row_name(value).c_str()));
+  }
+
+  for (uint_t k = 0; result && (k <= DUPLICATED_VALUES); ++k)
+    result = same_matches(table, kindField, DUInt8(k));
+
+  result = result && same_matches(table, idField, DUInt32());
+  result = result && same_matches(table, nameField, DText());
+
+  //The ranges are matched without the hash index.
+  const RowsSet range = table.MatchRowsSet(DUInt8(2), DUInt8(3), 0, TABLE_ROWS, kindField);
+  const RowsSet two = table.MatchRowsSet(DUInt8(2), DUInt8(2), 0, TABLE_ROWS, kindField);
+  const RowsSet three = table.MatchRowsSet(DUInt8(3), DUInt8(3), 0, TABLE_ROWS, kindField);
+
+  result = result && (range.Count() == two.Count() + three.Count());
+
+  return result;
+}
+
+
+static void
+set_row(ITable& table, const ROW_INDEX row)
+{
+  const uint_t value = wh_rnd() % 100000;
+
+  table.Set(row, table.RetrieveField("id"), (value % 11 == 0) ? DUInt32() : DUInt32(value));
+  table.Set(row, table.RetrieveField("kind"), DUInt8(value % DUPLICATED_VALUES));
+  table.Set(row, table.RetrieveField("name"), DText(row_name(value).c_str()));
+}
+
+
+static bool
+test_hash_index(ITable& table)
+{
+  std::cout << "Test matching the rows of hash indexed fields ... ";
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS / 2; ++row)
+  {
+    table.AddRow();
+    set_row(table, row);
+  }
+
+  table.CreateIndex(table.RetrieveField("id"), nullptr, nullptr, INDEX_HASH);
+  table.CreateIndex(table.RetrieveField("kind"), nullptr, nullptr, INDEX_HASH);
+  table.CreateIndex(table.RetrieveField("name"), nullptr, nullptr, INDEX_HASH);
+
+  bool result = table.IsIndexed(table.RetrieveField("id"));
+  result = result && check_matches(table);
+
+  //The indexes are kept up to date with the rows added or changed after them.
+  for (ROW_INDEX row = TABLE_ROWS / 2; row < TABLE_ROWS; ++row)
+    set_row(table, row);
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; row += 3)
+    set_row(table, row);
+
+  result = result && check_matches(table);
+
+  table.Sort(table.RetrieveField("id"), 0, TABLE_ROWS - 1, false);
+  result = result && check_matches(table);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_hash_index_reload(ITable& table)
+{
+  std::cout << "Test the hash indexes of a reopened table ... ";
+
+  bool result = check_matches(table);
+
+  for (ROW_INDEX row = 1; row < TABLE_ROWS; row += 5)
+    set_row(table, row);
+
+  result = result && check_matches(table);
+
+  const FIELD_INDEX nameField = table.RetrieveField("name");
+
+  table.RemoveIndex(nameField);
+  result = result && ! table.IsIndexed(nameField);
+  result = result && check_matches(table);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    success = success && test_hash_index(table);
+    dbs.ReleaseTable(table);
+
+    ITable& reopened = dbs.RetrievePersistentTable(table_name);
+    success = success && test_hash_index_reload(reopened);
+    dbs.ReleaseTable(reopened);
+
+    dbs.DeleteTable(table_name);
+    DBSReleaseDatabase(dbs);
+  }
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
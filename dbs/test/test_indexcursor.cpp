@@ -0,0 +1,279 @@
+#include <assert.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "utils/wrandom.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_indexcursor_db";
+static const char table_name[] = "t_indexcursor_table";
+
+static const ROW_INDEX TABLE_ROWS = 25000;
+static const uint_t DAYS = 300;
+
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"day", T_DATE, false},
+                                            {"amount", T_INT32, false}
+                                          };
+
+typedef std::tuple<DDate, ROW_INDEX> ENTRY;
+
+
+static DDate
+day_value(const uint_t day)
+{
+  return DDate(2017 + day / 336, 1 + (day / 28) % 12, 1 + day % 28);
+}
+
+
+static void
+set_row(ITable& table, const FIELD_INDEX field, const ROW_INDEX row)
+{
+  const uint_t value = wh_rnd();
+
+  table.Set(row, field, (value % 19 == 0) ? DDate() : day_value(value % DAYS));
+}
+
+
+static std::vector<ENTRY>
+table_entries(ITable& table, const FIELD_INDEX field)
+{
+  std::vector<ENTRY> result;
+
+  for (ROW_INDEX row = 0; row < table.AllocatedRows(); ++row)
+  {
+    DDate day;
+    table.Get(row, field, day);
+
+    if ( ! day.IsNull())
+      result.push_back(std::make_tuple(day, row));
+  }
+
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+
+static bool
+same_entries(const DArray&               values,
+             const DArray&               rows,
+             const uint_t                count,
+             const std::vector<ENTRY>&   expected,
+             const size_t                from,
+             const bool                  reverse)
+{
+  if ((values.Count() != count) || (rows.Count() != count))
+    return false;
+
+  for (uint_t i = 0; i < count; ++i)
+  {
+    if (from + i >= expected.size())
+      return false;
+
+    const ENTRY& entry = reverse ? expected[expected.size() - from - i - 1] : expected[from + i];
+
+    DDate day;
+    DROW_INDEX row;
+
+    values.Get(i, day);
+    rows.Get(i, row);
+
+    if ( ! (day == std::get<0>(entry)) || (row.mValue != std::get<1>(entry)))
+      return false;
+  }
+
+  return true;
+}
+
+
+//Walk the whole index in chunks, every one resuming after the previous one.
+static bool
+walk_entries(ITable&                      table,
+             const FIELD_INDEX            field,
+             const bool                   reverse,
+             const uint_t                 chunk,
+             const std::vector<ENTRY>&    expected)
+{
+  DArray fromValue, values, rows;
+  ROW_INDEX afterRow = INVALID_ROW_INDEX;
+  size_t walked = 0;
+
+  uint_t count;
+  while ((count = table.FetchIndexEntries(field,
+                                          fromValue,
+                                          afterRow,
+                                          reverse,
+                                          chunk,
+                                          values,
+                                          rows)) > 0)
+  {
+    if ( ! same_entries(values, rows, count, expected, walked, reverse))
+      return false;
+
+    walked += count;
+
+    DROW_INDEX lastRow;
+    rows.Get(count - 1, lastRow);
+
+    fromValue = values;
+    afterRow = lastRow.mValue;
+  }
+
+  return walked == expected.size();
+}
+
+
+static bool
+test_index_walk(ITable& table)
+{
+  std::cout << "Test walking the entries of an index ... ";
+
+  const FIELD_INDEX field = table.RetrieveField("day");
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+    set_row(table, field, row);
+
+  table.CreateIndex(field, nullptr, nullptr);
+
+  std::vector<ENTRY> expected = table_entries(table, field);
+
+  bool result = walk_entries(table, field, false, 100, expected);
+  result = result && walk_entries(table, field, true, 100, expected);
+  result = result && walk_entries(table, field, false, 1, expected);
+  result = result && walk_entries(table, field, true, 7000, expected);
+
+  //The walk follows the values changes.
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; row += 3)
+    set_row(table, field, row);
+
+  expected = table_entries(table, field);
+
+  result = result && walk_entries(table, field, false, 333, expected);
+  result = result && walk_entries(table, field, true, 333, expected);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_index_seek(ITable& table)
+{
+  std::cout << "Test seeking the entries of an index ... ";
+
+  const FIELD_INDEX field = table.RetrieveField("day");
+  const std::vector<ENTRY> expected = table_entries(table, field);
+
+  bool result = true;
+  for (uint_t i = 0; result && (i < 50); ++i)
+  {
+    const DDate day = day_value(wh_rnd() % DAYS);
+
+    DArray fromValue, values, rows;
+    fromValue.Add(day);
+
+    //The first entry holding the value, or the next bigger one.
+    const size_t first = std::lower_bound(expected.begin(),
+                                          expected.end(),
+                                          std::make_tuple(day, ROW_INDEX(0))) - expected.begin();
+    uint_t count = table.FetchIndexEntries(field,
+                                           fromValue,
+                                           INVALID_ROW_INDEX,
+                                           false,
+                                           20,
+                                           values,
+                                           rows);
+
+    result = result && (count == std::min<size_t>(20, expected.size() - first));
+    result = result && same_entries(values, rows, count, expected, first, false);
+
+    //The last entry holding the value, or the previous smaller one.
+    const size_t last = std::upper_bound(expected.begin(),
+                                         expected.end(),
+                                         std::make_tuple(day, INVALID_ROW_INDEX)) - expected.begin();
+    count = table.FetchIndexEntries(field, fromValue, INVALID_ROW_INDEX, true, 20, values, rows);
+
+    result = result && (count == std::min<size_t>(20, last));
+    result = result && same_entries(values, rows, count, expected, expected.size() - last, true);
+  }
+
+  //The most recent entries, without a sort.
+  DArray values, rows;
+  const uint_t count = table.FetchIndexEntries(field, DArray(), INVALID_ROW_INDEX, true, 100, values, rows);
+
+  result = result && (count == 100);
+  result = result && same_entries(values, rows, count, expected, 0, true);
+
+  try
+  {
+    table.FetchIndexEntries(table.RetrieveField("amount"),
+                            DArray(),
+                            INVALID_ROW_INDEX,
+                            false,
+                            10,
+                            values,
+                            rows);
+    result = false;
+  }
+  catch (DBSException& e)
+  {
+    result = result && (e.Code() == DBSException::FIELD_NOT_INDEXED);
+  }
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    success = success && test_index_walk(table);
+    success = success && test_index_seek(table);
+    dbs.ReleaseTable(table);
+
+    dbs.DeleteTable(table_name);
+    DBSReleaseDatabase(dbs);
+  }
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
@@ -0,0 +1,288 @@
+#include <assert.h>
+#include <iostream>
+#include <stdarg.h>
+#include <string.h>
+
+#include "utils/wfile.h"
+#include "custom/include/test/test_fmw.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_values.h"
+
+using namespace whais;
+
+
+static const char db_name[] = "t_parallel_repair_db";
+
+static const char* tables_names[] = {
+                                      "t_repair_table_1",
+                                      "t_repair_table_2",
+                                      "t_repair_table_3"
+                                    };
+
+static const uint_t TABLES_COUNT = sizeof tables_names / sizeof tables_names[0];
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"int_field", T_INT32, false},
+                                            {"text_field", T_TEXT, false},
+                                            {"array_field", T_UINT16, true}
+                                          };
+
+static const ROW_INDEX TABLE_ROWS = 5000;
+static const ROW_INDEX NULL_ROWS_STEP = 97;
+
+static uint_t progressReports;
+static uint_t tablesReports;
+
+
+static bool
+repair_callback(const FIX_ERROR_CALLBACK_TYPE type, const char* const format, ...)
+{
+  if (type != PROGRESS_INFO)
+    return true;
+
+  va_list vl;
+
+  va_start(vl, format);
+  const char* const message = va_arg(vl, const char*);
+  va_end(vl);
+
+  ++progressReports;
+  if (strstr(message, "tables checked") != nullptr)
+    ++tablesReports;
+
+  return true;
+}
+
+
+static DText
+row_text(const ROW_INDEX row)
+{
+  std::string text = "A text long enough to be kept in the variable size store: ";
+
+  text += std::to_string(row);
+
+  return DText(text.c_str());
+}
+
+
+static bool
+is_null_row(const ROW_INDEX row)
+{
+  return (row % NULL_ROWS_STEP) == (NULL_ROWS_STEP - 1);
+}
+
+
+static void
+fill_table(ITable& table)
+{
+  const FIELD_INDEX intField = table.RetrieveField("int_field");
+  const FIELD_INDEX textField = table.RetrieveField("text_field");
+  const FIELD_INDEX arrayField = table.RetrieveField("array_field");
+
+  table.CreateIndex(intField, nullptr, nullptr);
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+  {
+    table.AddRow();
+    if (is_null_row(row))
+      continue;
+
+    DArray array;
+    array.Add(DUInt16(row % 0xFFFF));
+    array.Add(DUInt16(row % 7));
+
+    table.Set(row, intField, DInt32(row));
+    table.Set(row, textField, row_text(row));
+    table.Set(row, arrayField, array);
+  }
+}
+
+
+//Make the second row a copy of the first one, so both will refer to the same
+//variable size values.
+static void
+duplicate_first_row(const char* const tableName)
+{
+  const std::string fileName = DBSGetSeettings().mWorkDir + tableName + "_f";
+
+  File rowsFile(fileName.c_str(), WH_FILEOPEN_EXISTING | WH_FILERDWR);
+
+  const uint_t rowSize = rowsFile.Size() / TABLE_ROWS;
+  std::unique_ptr<uint8_t[]> rowData(new uint8_t[rowSize]);
+
+  rowsFile.Seek(0, WH_SEEK_BEGIN);
+  rowsFile.Read(rowData.get(), rowSize);
+  rowsFile.Write(rowData.get(), rowSize);
+}
+
+
+static bool
+check_table(ITable& table, const bool duplicatedRow)
+{
+  const FIELD_INDEX intField = table.RetrieveField("int_field");
+  const FIELD_INDEX textField = table.RetrieveField("text_field");
+  const FIELD_INDEX arrayField = table.RetrieveField("array_field");
+
+  ROW_INDEX nullRows = 0;
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+  {
+    DInt32 intValue;
+    DText textValue;
+    DArray arrayValue;
+
+    table.Get(row, intField, intValue);
+    table.Get(row, textField, textValue);
+    table.Get(row, arrayField, arrayValue);
+
+    if (is_null_row(row))
+    {
+      if ( ! (intValue.IsNull() && textValue.IsNull() && arrayValue.IsNull()))
+        return false;
+
+      ++nullRows;
+      continue;
+    }
+    const ROW_INDEX expectedRow = (duplicatedRow && (row == 1)) ? 0 : row;
+
+    if ((intValue != DInt32(expectedRow))
+        || (textValue != row_text(expectedRow))
+        || (arrayValue.Count() != 2))
+    {
+      return false;
+    }
+  }
+
+  if (table.ReusableRowsCount() != nullRows)
+    return false;
+
+  const DArray matched = table.MatchRows(DInt32(0),
+                                         DInt32(TABLE_ROWS),
+                                         0,
+                                         TABLE_ROWS - 1,
+                                         intField);
+  if (matched.Count() != TABLE_ROWS - nullRows)
+    return false;
+
+  if (duplicatedRow
+      && (table.MatchRows(DInt32(0), DInt32(0), 0, TABLE_ROWS - 1, intField).Count() != 2))
+  {
+    return false;
+  }
+
+  return true;
+}
+
+
+//Both rows keep the shared values, so letting go one of them should leave the
+//other one's intact, even after the store's space is reused.
+static bool
+check_shared_row(ITable& table)
+{
+  const FIELD_INDEX textField = table.RetrieveField("text_field");
+  const FIELD_INDEX arrayField = table.RetrieveField("array_field");
+
+  table.Set(1, textField, DText());
+  table.Set(1, arrayField, DArray());
+
+  for (ROW_INDEX row = 2; row < 20; ++row)
+  {
+    DArray array;
+    array.Add(DUInt16(row));
+    array.Add(DUInt16(row + 1));
+
+    table.Set(row, textField, row_text(row + TABLE_ROWS));
+    table.Set(row, arrayField, array);
+  }
+
+  DText text;
+  DArray array;
+  DUInt16 item;
+
+  table.Get(0, textField, text);
+  table.Get(0, arrayField, array);
+
+  if ((text != row_text(0)) || (array.Count() != 2))
+    return false;
+
+  array.Get(1, item);
+  return item == DUInt16(0);
+}
+
+
+static bool
+test_parallel_repair()
+{
+  std::cout << "Test the repair of the tables using several threads ... ";
+
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    for (uint_t t = 0; t < TABLES_COUNT; ++t)
+    {
+      dbs.AddTable(tables_names[t], sizeof field_descs / sizeof field_descs[0], field_descs);
+
+      ITable& table = dbs.RetrievePersistentTable(tables_names[t]);
+      fill_table(table);
+      dbs.ReleaseTable(table);
+    }
+    DBSReleaseDatabase(dbs);
+  }
+
+  duplicate_first_row(tables_names[0]);
+
+  progressReports = tablesReports = 0;
+
+  bool result = DBSRepairDatabase(db_name, nullptr, repair_callback)
+                && (tablesReports == TABLES_COUNT)
+                && (progressReports > TABLES_COUNT);
+
+  if (result)
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    for (uint_t t = 0; result && (t < TABLES_COUNT); ++t)
+    {
+      ITable& table = dbs.RetrievePersistentTable(tables_names[t]);
+      result = check_table(table, t == 0) && ((t != 0) || check_shared_row(table));
+      dbs.ReleaseTable(table);
+    }
+    DBSReleaseDatabase(dbs);
+  }
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSSettings settings;
+    settings.mCheckThreads = 8;
+
+    DBSInit(settings);
+  }
+
+  DBSCreateDatabase(db_name);
+
+  success = success && test_parallel_repair();
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
@@ -0,0 +1,504 @@
+#include <assert.h>
+#include <iostream>
+#include <string.h>
+
+#include "utils/wfile.h"
+#include "utils/endianness.h"
+#include "custom/include/test/test_fmw.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_values.h"
+
+#include "../pastra/ps_redolog.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_recover_db";
+static const char table_name[] = "t_recover_table";
+
+static const char* table_files[] = {
+                                     "t_recover_table",
+                                     "t_recover_table_f",
+                                     "t_recover_table_v",
+                                     "t_recover_table_int_field_bt"
+                                   };
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"int_field", T_INT32, false},
+                                            {"text_field", T_TEXT, false},
+                                            {"array_field", T_UINT16, true}
+                                          };
+
+static const uint_t DB_FLAGS_OFF = 24;
+static const uint64_t DB_NOT_CLOSED_FLAG = 1;
+
+static const ROW_INDEX CHECKPOINT_ROWS = 200;
+static const ROW_INDEX ADDED_ROWS = 50;
+
+
+static bool
+repair_callback(const FIX_ERROR_CALLBACK_TYPE, const char* const, ...)
+{
+  return true;
+}
+
+
+static std::string
+file_path(const std::string& name)
+{
+  return DBSGetSeettings().mWorkDir + name;
+}
+
+
+static void
+copy_file(const std::string& src, const std::string& dst)
+{
+  if ( ! whf_file_exists(src.c_str()))
+  {
+    whf_remove(dst.c_str());
+    return;
+  }
+
+  File from(src.c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD);
+  File to(dst.c_str(), WH_FILECREATE | WH_FILETRUNC | WH_FILEWRITE);
+
+  uint8_t buffer[4096];
+  for (uint64_t left = from.Size(); left > 0; )
+  {
+    const uint_t chunk = (left < sizeof buffer) ? left : sizeof buffer;
+
+    from.Read(buffer, chunk);
+    to.Write(buffer, chunk);
+
+    left -= chunk;
+  }
+}
+
+
+static void
+save_table_files(const char* const suffix)
+{
+  for (uint_t i = 0; i < sizeof table_files / sizeof table_files[0]; ++i)
+    copy_file(file_path(table_files[i]), file_path(table_files[i]) + suffix);
+}
+
+
+static void
+remove_table_files(const char* const suffix)
+{
+  for (uint_t i = 0; i < sizeof table_files / sizeof table_files[0]; ++i)
+    whf_remove((file_path(table_files[i]) + suffix).c_str());
+}
+
+
+//Copy the log without its last record of the table's synchronisation, as if
+//the process stopped before getting to it.
+static void
+copy_unsynced_log(const std::string& dst)
+{
+  const std::string redoFile = file_path(std::string(db_name) + ".redo");
+
+  uint64_t syncOffset = 0;
+  {
+    RedoLogReader reader(redoFile);
+    RedoRecord record;
+
+    for (uint64_t offset = reader.ValidSize(); reader.Next(record); offset = reader.ValidSize())
+    {
+      if ((record.mType == REDO_TABLE_SYNC) && (record.mTable == table_name))
+        syncOffset = offset;
+    }
+  }
+
+  assert(syncOffset > 0);
+
+  File from(redoFile.c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD);
+  File to(dst.c_str(), WH_FILECREATE | WH_FILETRUNC | WH_FILEWRITE);
+
+  uint8_t buffer[4096];
+  for (uint64_t left = syncOffset; left > 0; )
+  {
+    const uint_t chunk = (left < sizeof buffer) ? left : sizeof buffer;
+
+    from.Read(buffer, chunk);
+    to.Write(buffer, chunk);
+
+    left -= chunk;
+  }
+}
+
+
+//Put back the table files as they were after a flush, but with every block
+//the flush wrote left as garbage.
+static void
+tear_table_files()
+{
+  for (uint_t i = 0; i < sizeof table_files / sizeof table_files[0]; ++i)
+  {
+    const std::string fileName = file_path(table_files[i]);
+
+    File synced((fileName + ".bak").c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD);
+    File flushed((fileName + ".flushed").c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD);
+    File torn(fileName.c_str(), WH_FILECREATE | WH_FILETRUNC | WH_FILEWRITE);
+
+    const uint64_t syncedSize = synced.Size();
+    const uint64_t flushedSize = flushed.Size();
+
+    uint8_t block[4096], syncedBlock[4096];
+    for (uint64_t offset = 0; offset < flushedSize; offset += sizeof block)
+    {
+      const uint_t chunk = MIN(sizeof block, flushedSize - offset);
+
+      flushed.Read(block, chunk);
+
+      bool written = (offset + chunk > syncedSize);
+      if ( ! written)
+      {
+        synced.Read(syncedBlock, chunk);
+        written = (memcmp(block, syncedBlock, chunk) != 0);
+      }
+
+      if (written)
+        memset(block, 0xA5, chunk);
+
+      torn.Write(block, chunk);
+    }
+  }
+}
+
+
+//Bring the files in the state they would have been if the process stopped
+//right after the last update got durable: the table files as they were at
+//their last synchronisation followed by the logged updates.
+static void
+simulate_crash(const std::string& savedLog)
+{
+  for (uint_t i = 0; i < sizeof table_files / sizeof table_files[0]; ++i)
+    copy_file(file_path(table_files[i]) + ".bak", file_path(table_files[i]));
+
+  const std::string redoFile = file_path(std::string(db_name) + ".redo");
+  if (savedLog.empty())
+    whf_remove(redoFile.c_str());
+
+  else
+    copy_file(savedLog, redoFile);
+
+  File dbFile(file_path(std::string(db_name) + ".db").c_str(),
+              WH_FILEOPEN_EXISTING | WH_FILERDWR);
+
+  uint8_t flags[sizeof(uint64_t)];
+
+  dbFile.Seek(DB_FLAGS_OFF, WH_SEEK_BEGIN);
+  dbFile.Read(flags, sizeof flags);
+  store_le_int64(load_le_int64(flags) | DB_NOT_CLOSED_FLAG, flags);
+  dbFile.Seek(DB_FLAGS_OFF, WH_SEEK_BEGIN);
+  dbFile.Write(flags, sizeof flags);
+}
+
+
+static DText
+row_text(const ROW_INDEX row, const uint_t version)
+{
+  std::string text = "A text value that does not fit in the row itself: ";
+
+  text += std::to_string(row) + "/" + std::to_string(version);
+
+  return DText(text.c_str());
+}
+
+
+static DArray
+row_array(const ROW_INDEX row, const uint_t version)
+{
+  DArray result;
+
+  for (uint_t i = 0; i < (row % 7) + 1; ++i)
+    result.Add(DUInt16(row + version + i));
+
+  return result;
+}
+
+
+static void
+fill_rows(ITable& table, const ROW_INDEX from, const ROW_INDEX to, const uint_t version)
+{
+  const FIELD_INDEX intField = table.RetrieveField("int_field");
+  const FIELD_INDEX textField = table.RetrieveField("text_field");
+  const FIELD_INDEX arrayField = table.RetrieveField("array_field");
+
+  for (ROW_INDEX row = from; row < to; ++row)
+  {
+    if (row >= table.AllocatedRows())
+      table.AddRow();
+
+    table.Set(row, intField, DInt32(row * 10 + version));
+    table.Set(row, textField, row_text(row, version));
+    table.Set(row, arrayField, row_array(row, version));
+  }
+}
+
+
+static bool
+check_rows(ITable& table, const ROW_INDEX from, const ROW_INDEX to, const uint_t version)
+{
+  const FIELD_INDEX intField = table.RetrieveField("int_field");
+  const FIELD_INDEX textField = table.RetrieveField("text_field");
+  const FIELD_INDEX arrayField = table.RetrieveField("array_field");
+
+  for (ROW_INDEX row = from; row < to; ++row)
+  {
+    DInt32 intValue;
+    DText textValue;
+    DArray arrayValue;
+
+    table.Get(row, intField, intValue);
+    table.Get(row, textField, textValue);
+    table.Get(row, arrayField, arrayValue);
+
+    if ((intValue != DInt32(row * 10 + version))
+        || (textValue != row_text(row, version)))
+    {
+      return false;
+    }
+
+    const DArray expected = row_array(row, version);
+    if (arrayValue.Count() != expected.Count())
+      return false;
+
+    for (uint64_t i = 0; i < expected.Count(); ++i)
+    {
+      DUInt16 element, expectedElement;
+
+      arrayValue.Get(i, element);
+      expected.Get(i, expectedElement);
+
+      if (element != expectedElement)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+
+static void
+prepare_crash(const std::string& savedLog, const std::string& tornLog)
+{
+  IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+
+    table.CreateIndex(table.RetrieveField("int_field"), nullptr, nullptr);
+    fill_rows(table, 0, CHECKPOINT_ROWS, 0);
+
+    dbs.ReleaseTable(table);
+  }
+
+  dbs.SyncAllTablesContent();
+  save_table_files(".bak");
+
+  ITable& table = dbs.RetrievePersistentTable(table_name);
+
+  fill_rows(table, 0, CHECKPOINT_ROWS / 2, 1);
+  fill_rows(table, CHECKPOINT_ROWS, CHECKPOINT_ROWS + ADDED_ROWS, 1);
+  table.MarkRowForReuse(CHECKPOINT_ROWS - 1);
+
+  copy_file(file_path(std::string(db_name) + ".redo"), savedLog);
+
+  table.Flush();
+  copy_unsynced_log(tornLog);
+  save_table_files(".flushed");
+
+  dbs.ReleaseTable(table);
+  DBSReleaseDatabase(dbs);
+}
+
+
+static bool
+check_recovered()
+{
+  IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+  ITable& table = dbs.RetrievePersistentTable(table_name);
+
+  const FIELD_INDEX intField = table.RetrieveField("int_field");
+
+  bool result = (table.AllocatedRows() == CHECKPOINT_ROWS + ADDED_ROWS)
+                && check_rows(table, 0, CHECKPOINT_ROWS / 2, 1)
+                && check_rows(table, CHECKPOINT_ROWS / 2, CHECKPOINT_ROWS - 1, 0)
+                && check_rows(table, CHECKPOINT_ROWS, CHECKPOINT_ROWS + ADDED_ROWS, 1)
+                && (table.ReusableRowsCount() == 1)
+                && (table.GetReusableRow(false) == CHECKPOINT_ROWS - 1);
+
+  //The field index should reflect the replayed values.
+  const DArray matched = table.MatchRows(DInt32(1),
+                                         DInt32(CHECKPOINT_ROWS / 2 * 10 - 1),
+                                         0,
+                                         table.AllocatedRows() - 1,
+                                         intField);
+  result = result && (matched.Count() == CHECKPOINT_ROWS / 2);
+
+  dbs.ReleaseTable(table);
+  DBSReleaseDatabase(dbs);
+
+  return result;
+}
+
+
+static bool
+test_replay(const std::string& savedLog)
+{
+  std::cout << "Test the replay of the logged updates ... ";
+
+  simulate_crash(savedLog);
+
+  bool result = false;
+  try
+  {
+    DBSRetrieveDatabase(db_name);
+  }
+  catch (DBSException& e)
+  {
+    result = (e.Code() == DBSException::DATABASE_IN_USE);
+  }
+
+  result = result && DBSRecoverDatabase(db_name);
+
+  //Nothing else to do for a database properly closed.
+  result = result && DBSRecoverDatabase(db_name);
+
+  result = result && check_recovered();
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_torn_flush(const std::string& tornLog)
+{
+  std::cout << "Test the replay over a partially written flush ... ";
+
+  simulate_crash(tornLog);
+  tear_table_files();
+
+  //The journaled blocks alone should bring the table back, without a repair
+  //that would miss the values of the rows not logged since the checkpoint.
+  bool result = DBSRecoverDatabase(db_name);
+  result = result && check_recovered();
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_missing_log()
+{
+  std::cout << "Test the recovery without a log ... ";
+
+  simulate_crash("");
+
+  bool result = ! DBSRecoverDatabase(db_name);
+  try
+  {
+    DBSRetrieveDatabase(db_name);
+    result = false;
+  }
+  catch (DBSException& e)
+  {
+    result = result && (e.Code() == DBSException::DATABASE_IN_USE);
+  }
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_damaged_log(const std::string& savedLog)
+{
+  std::cout << "Test the recovery with a damaged log ... ";
+
+  simulate_crash(savedLog);
+  {
+    File redoFile(file_path(std::string(db_name) + ".redo").c_str(),
+                  WH_FILEOPEN_EXISTING | WH_FILERDWR);
+
+    const uint8_t garbage[] = {0xDE, 0xAD, 0xBE, 0xEF};
+    redoFile.Seek(0, WH_SEEK_BEGIN);
+    redoFile.Write(garbage, sizeof garbage);
+  }
+
+  bool result = ! DBSRecoverDatabase(db_name);
+
+  //A full repair is still possible and leaves no records behind.
+  result = result && DBSRepairDatabase(db_name, nullptr, repair_callback);
+  if (result)
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+
+    result = check_rows(table, 0, CHECKPOINT_ROWS, 0);
+
+    dbs.ReleaseTable(table);
+    DBSReleaseDatabase(dbs);
+  }
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSSettings settings;
+    settings.mDurability = DURABILITY_PER_WRITE;
+
+    DBSInit(settings);
+  }
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+    DBSReleaseDatabase(dbs);
+  }
+
+  const std::string savedLog = file_path(std::string(db_name) + ".redo.bak");
+  const std::string tornLog = file_path(std::string(db_name) + ".redo.torn");
+
+  prepare_crash(savedLog, tornLog);
+
+  success = success && test_replay(savedLog);
+  success = success && test_torn_flush(tornLog);
+  success = success && test_missing_log();
+  success = success && test_damaged_log(savedLog);
+
+  remove_table_files(".bak");
+  remove_table_files(".flushed");
+  whf_remove(savedLog.c_str());
+  whf_remove(tornLog.c_str());
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
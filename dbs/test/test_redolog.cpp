@@ -0,0 +1,481 @@
+#include <assert.h>
+#include <iostream>
+#include <vector>
+#include <string.h>
+
+#include "utils/wthread.h"
+#include "custom/include/test/test_fmw.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_values.h"
+
+#include "../pastra/ps_redolog.h"
+#include "../pastra/ps_dbsmgr.h"
+#include "../pastra/ps_serializer.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_redolog_db";
+static const char table_name[] = "t_redo_table";
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"int_field", T_INT32, false},
+                                            {"text_field", T_TEXT, false},
+                                            {"array_field", T_UINT16, true}
+                                          };
+
+static const uint_t THREADS_COUNT = 4;
+static const uint_t THREAD_UPDATES = 200;
+
+
+static std::string
+redo_file_name()
+{
+  return DBSGetSeettings().mWorkDir + db_name + ".redo";
+}
+
+
+//Skips the records journaling the content of the tables' files.
+static bool
+next_update(RedoLogReader& reader, RedoRecord& outRecord)
+{
+  while (reader.Next(outRecord))
+  {
+    if ((outRecord.mType == REDO_ROW_ADD) || (outRecord.mType == REDO_FIELD_VALUE))
+      return true;
+  }
+
+  return false;
+}
+
+
+static uint_t
+count_log_records()
+{
+  RedoLogReader reader(redo_file_name());
+  RedoRecord record;
+
+  uint_t result = 0;
+  while (next_update(reader, record))
+    ++result;
+
+  return result;
+}
+
+
+static bool
+test_logged_updates(IDBSHandler& dbs)
+{
+  std::cout << "Test the records of the tables updates ... ";
+
+  ITable& table = dbs.RetrievePersistentTable(table_name);
+
+  const FIELD_INDEX intField = table.RetrieveField("int_field");
+  const FIELD_INDEX textField = table.RetrieveField("text_field");
+  const FIELD_INDEX arrayField = table.RetrieveField("array_field");
+
+  DArray array;
+  array.Add(DUInt16(10));
+  array.Add(DUInt16(11));
+  array.Add(DUInt16(12));
+
+  const DText text("A text long enough to be kept in the variable size store.");
+
+  table.AddRow();
+  table.Set(0, intField, DInt32(-32));
+  table.Set(0, textField, text);
+  table.Set(0, arrayField, array);
+  table.Set(0, intField, DInt32());
+
+  //A temporal table updates should not be logged.
+  ITable& tempTable = table.Spawn();
+  tempTable.AddRow();
+  tempTable.Set(0, intField, DInt32(1));
+  dbs.ReleaseTable(tempTable);
+
+  dbs.ReleaseTable(table);
+
+  RedoLogReader reader(redo_file_name());
+  RedoRecord record;
+
+  bool result = next_update(reader, record)
+                && (record.mType == REDO_ROW_ADD)
+                && (record.mTable == table_name)
+                && (record.mRow == 0);
+
+  const uint64_t firstLsn = record.mLsn;
+
+  uint8_t rawValue[Serializer::MAX_VALUE_RAW_SIZE];
+  Serializer::Store(rawValue, DInt32(-32));
+
+  result = result
+           && next_update(reader, record)
+           && (record.mType == REDO_FIELD_VALUE)
+           && (record.mLsn > firstLsn)
+           && (record.mRow == 0)
+           && (record.mField == intField)
+           && (record.mFieldType == T_INT32)
+           && ! record.mIsNull
+           && (record.mValueSize == Serializer::Size(T_INT32, false))
+           && (memcmp(record.mValue, rawValue, record.mValueSize) == 0);
+
+  const char* const expectedText = "A text long enough to be kept in the variable size store.";
+  result = result
+           && next_update(reader, record)
+           && (record.mField == textField)
+           && (record.mFieldType == T_TEXT)
+           && (record.mValueSize == strlen(expectedText))
+           && (memcmp(record.mValue, expectedText, record.mValueSize) == 0);
+
+  result = result
+           && next_update(reader, record)
+           && (record.mField == arrayField)
+           && (record.mFieldType == (T_UINT16 | T_ARRAY_MASK))
+           && (record.mValueSize == 3 * Serializer::Size(T_UINT16, false));
+
+  for (uint_t i = 0; result && (i < 3); ++i)
+  {
+    DUInt16 element;
+    Serializer::Load(record.mValue + i * Serializer::Size(T_UINT16, false), &element);
+
+    result = (element == DUInt16(10 + i));
+  }
+
+  result = result
+           && next_update(reader, record)
+           && (record.mField == intField)
+           && record.mIsNull
+           && (record.mValueSize == 0);
+
+  result = result && ! next_update(reader, record);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_checkpoint(IDBSHandler& dbs)
+{
+  std::cout << "Test the log checkpoint ... ";
+
+  RedoLog& log = *_SC(DbsHandler&, dbs).GetRedoLog();
+  const uint64_t lastLsn = log.LastLsn();
+
+  bool result = (count_log_records() > 0);
+
+  dbs.SyncAllTablesContent();
+
+  result = result
+           && (count_log_records() == 0)
+           && (log.CheckpointLsn() == lastLsn)
+           && (log.DurableLsn() == lastLsn);
+
+  ITable& table = dbs.RetrievePersistentTable(table_name);
+  const FIELD_INDEX intField = table.RetrieveField("int_field");
+
+  table.AddRow();
+  table.Set(1, intField, DInt32(1));
+
+  //Records added while a checkpoint is in progress should be kept.
+  const uint64_t checkpointLsn = log.BeginCheckpoint();
+  table.Set(1, intField, DInt32(2));
+  table.Flush();
+  log.EndCheckpoint(checkpointLsn);
+
+  dbs.ReleaseTable(table);
+
+  RedoLogReader reader(redo_file_name());
+  RedoRecord record;
+
+  DInt32 value;
+  result = result
+           && next_update(reader, record)
+           && (record.mLsn > checkpointLsn)
+           && (record.mRow == 1)
+           && (Serializer::Load(record.mValue, &value), value == DInt32(2))
+           && ! next_update(reader, record)
+           && (reader.CheckpointLsn() == checkpointLsn);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static ITable* sharedTable;
+static FIELD_INDEX sharedField;
+
+static void
+update_rows(void* args)
+{
+  const uint_t id = *_RC(uint_t*, args);
+
+  for (uint_t i = 0; i < THREAD_UPDATES; ++i)
+    sharedTable->Set(id, sharedField, DInt32(i + 1));
+}
+
+
+static bool
+test_group_commit(IDBSHandler& dbs)
+{
+  std::cout << "Test the concurrent commits ... ";
+
+  dbs.SyncAllTablesContent();
+
+  RedoLog& log = *_SC(DbsHandler&, dbs).GetRedoLog();
+  sharedTable = &dbs.RetrievePersistentTable(table_name);
+  sharedField = sharedTable->RetrieveField("int_field");
+
+  while (sharedTable->AllocatedRows() < THREADS_COUNT)
+    sharedTable->AddRow();
+
+  const uint_t recordsBefore = count_log_records();
+
+  Thread threads[THREADS_COUNT];
+  uint_t ids[THREADS_COUNT];
+
+  for (uint_t i = 0; i < THREADS_COUNT; ++i)
+  {
+    ids[i] = i;
+    threads[i].Run(update_rows, &ids[i]);
+  }
+
+  for (uint_t i = 0; i < THREADS_COUNT; ++i)
+    threads[i].WaitToEnd(true);
+
+  dbs.ReleaseTable( *sharedTable);
+
+  const bool result = (log.DurableLsn() == log.LastLsn())
+                      && (count_log_records() == recordsBefore + THREADS_COUNT * THREAD_UPDATES);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_journaled_blocks(IDBSHandler& dbs)
+{
+  std::cout << "Test the journal of the tables files ... ";
+
+  const std::string rowsFile = DBSGetSeettings().mWorkDir + table_name + "_f";
+
+  std::vector<uint8_t> rowsContent;
+  {
+    File file(rowsFile.c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD);
+
+    rowsContent.resize(MIN(file.Size(), TableJournal::IMAGE_SIZE));
+    file.Read(rowsContent.data(), rowsContent.size());
+  }
+
+  RedoLog& log = *_SC(DbsHandler&, dbs).GetRedoLog();
+  const uint64_t lsn = log.LastLsn();
+
+  ITable& table = dbs.RetrievePersistentTable(table_name);
+  const FIELD_INDEX intField = table.RetrieveField("int_field");
+
+  table.Set(0, intField, DInt32(7));
+  table.Set(1, intField, DInt32(8));
+  table.Flush();
+  table.Set(0, intField, DInt32(9));
+
+  dbs.ReleaseTable(table);
+
+  RedoLogReader reader(redo_file_name());
+  RedoRecord record;
+
+  //Each flush should journal the rows block once, with what the file had
+  //before, then tell the table is synchronised.
+  uint_t rowsImages = 0, tableImages = 0, syncs = 0;
+  uint64_t epoch = 0;
+  bool result = true;
+
+  while (result && reader.Next(record))
+  {
+    if ((record.mLsn <= lsn) || (record.mTable != table_name))
+      continue;
+
+    if (record.mType == REDO_TABLE_SYNC)
+    {
+      result = (rowsImages == syncs + 1)
+               && (tableImages == syncs + 1)
+               && (record.mEpoch > epoch);
+
+      epoch = record.mEpoch;
+      ++syncs;
+    }
+    else if (record.mType == REDO_BLOCK_IMAGE)
+    {
+      result = (record.mOffset == 0) && (record.mEpoch == epoch || syncs == 0);
+      if (record.mContainer == std::string(table_name) + "_f")
+      {
+        result = result
+                 && ((syncs > 0)
+                     || ((record.mValueSize == rowsContent.size())
+                         && (memcmp(record.mValue, rowsContent.data(), rowsContent.size()) == 0)));
+        ++rowsImages;
+      }
+      else if (record.mContainer == table_name)
+        ++tableImages;
+    }
+  }
+
+  result = result && (syncs == 2);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_checkpoint_sync(IDBSHandler& dbs)
+{
+  std::cout << "Test the tables synchronised by a checkpoint ... ";
+
+  RedoLog& log = *_SC(DbsHandler&, dbs).GetRedoLog();
+
+  ITable& table = dbs.RetrievePersistentTable(table_name);
+  const FIELD_INDEX intField = table.RetrieveField("int_field");
+
+  table.Set(0, intField, DInt32(11));
+  const uint64_t lsn = log.LastLsn();
+
+  //The table content is written after the table is unlocked, but the table's
+  //synchronisation should still be logged once it's durable.
+  dbs.SyncAllTablesContent();
+
+  RedoLogReader reader(redo_file_name());
+  RedoRecord record;
+
+  bool result = false;
+  while (reader.Next(record))
+  {
+    if ((record.mType == REDO_TABLE_SYNC) && (record.mTable == table_name))
+      result = (record.mEpoch >= lsn);
+  }
+
+  DInt32 value;
+  table.Get(0, intField, value);
+  result = result && (value == DInt32(11));
+
+  table.Set(0, intField, DInt32(12));
+  dbs.ReleaseTable(table);
+
+  ITable& reopened = dbs.RetrievePersistentTable(table_name);
+
+  reopened.Get(0, intField, value);
+  result = result && (value == DInt32(12));
+
+  dbs.ReleaseTable(reopened);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_damaged_tail()
+{
+  std::cout << "Test a log with an incomplete record ... ";
+
+  const std::string fileName = DBSGetSeettings().mWorkDir + "t_damaged.redo";
+  uint64_t lastLsn, validSize;
+  {
+    RedoLog log(fileName, DURABILITY_PER_WRITE);
+
+    log.LogRowAdd("some_table", 1);
+    lastLsn = log.LogRowAdd("some_table", 2);
+    log.Commit(lastLsn);
+  }
+
+  {
+    File file(fileName.c_str(), WH_FILEOPEN_EXISTING | WH_FILERDWR);
+
+    validSize = file.Size();
+
+    const uint8_t garbage[] = {0x30, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00};
+    file.Seek(0, WH_SEEK_END);
+    file.Write(garbage, sizeof garbage);
+  }
+
+  bool result;
+  {
+    RedoLog log(fileName, DURABILITY_ASYNC);
+
+    result = (log.LastLsn() == lastLsn);
+    log.Commit(log.LogRowAdd("some_table", 3));
+  }
+
+  {
+    File file(fileName.c_str(), WH_FILEOPEN_EXISTING | WH_FILEREAD);
+    result = result && (file.Size() > validSize);
+  }
+
+  RedoLogReader reader(fileName);
+  RedoRecord record;
+
+  result = result
+           && reader.Next(record) && (record.mRow == 1)
+           && reader.Next(record) && (record.mRow == 2)
+           && reader.Next(record) && (record.mRow == 3) && (record.mLsn == lastLsn + 1)
+           && ! reader.Next(record);
+
+  whf_remove(fileName.c_str());
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSSettings settings;
+    settings.mDurability = DURABILITY_PER_WRITE;
+
+    DBSInit(settings);
+  }
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+    success = success && test_logged_updates(dbs);
+    success = success && test_checkpoint(dbs);
+    success = success && test_group_commit(dbs);
+    success = success && test_journaled_blocks(dbs);
+    success = success && test_checkpoint_sync(dbs);
+
+    DBSReleaseDatabase(dbs);
+  }
+
+  //A database properly closed does not need any of its records.
+  success = success && (count_log_records() == 0);
+
+  success = success && test_damaged_tail();
+
+  DBSRemoveDatabase(db_name);
+  success = success && ! whf_file_exists(redo_file_name().c_str());
+
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
@@ -0,0 +1,213 @@
+#include <assert.h>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "utils/wrandom.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_rowsset.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_rowsset_db";
+static const char table_name[] = "t_rowsset_table";
+
+static const ROW_INDEX TABLE_ROWS = 40000;
+
+
+static bool
+same_rows(const RowsSet& set, const std::set<ROW_INDEX>& expected)
+{
+  if (set.Count() != expected.size())
+    return false;
+
+  std::vector<ROW_INDEX> rows(expected.size() + 1);
+  if (set.Fetch(0, rows.size(), rows.data()) != expected.size())
+    return false;
+
+  size_t i = 0;
+  for (auto row : expected)
+  {
+    if ((rows[i++] != row) || ! set.Contains(row))
+      return false;
+  }
+
+  if (expected.empty())
+    return set.IsEmpty() && (set.Last() == INVALID_ROW_INDEX);
+
+  return (set.Next(0) == *expected.begin()) && (set.Last() == *expected.rbegin());
+}
+
+
+static void
+fill_random(RowsSet& set, std::set<ROW_INDEX>& expected, const uint_t count, const ROW_INDEX span)
+{
+  for (uint_t i = 0; i < count; ++i)
+  {
+    const ROW_INDEX row = wh_rnd() % span;
+
+    set.Add(row);
+    expected.insert(row);
+  }
+}
+
+
+static bool
+test_rows_set_operations()
+{
+  std::cout << "Test the rows set operations ... ";
+
+  bool result = true;
+
+  RowsSet sparse, dense;
+  std::set<ROW_INDEX> sparseRows, denseRows;
+
+  //Few rows spread over many blocks, and many rows packed in bitmaps.
+  fill_random(sparse, sparseRows, 3000, 0x1000000);
+  fill_random(dense, denseRows, 120000, 200000);
+
+  sparse.Add(0x7FFF0, 0x90010);
+  for (ROW_INDEX row = 0x7FFF0; row <= 0x90010; ++row)
+    sparseRows.insert(row);
+
+  result = result && same_rows(sparse, sparseRows) && same_rows(dense, denseRows);
+
+  {
+    RowsSet united = sparse;
+    std::set<ROW_INDEX> unitedRows = sparseRows;
+
+    united.Unite(dense);
+    unitedRows.insert(denseRows.begin(), denseRows.end());
+
+    result = result && same_rows(united, unitedRows);
+  }
+
+  {
+    RowsSet common = dense;
+    std::set<ROW_INDEX> commonRows;
+
+    for (auto row : denseRows)
+    {
+      if (sparseRows.count(row) > 0)
+        commonRows.insert(row);
+    }
+
+    common.Intersect(sparse);
+    result = result && same_rows(common, commonRows);
+  }
+
+  {
+    const RowsSet copy = RowsSet::FromArray(dense.ToArray());
+    result = result && same_rows(copy, denseRows);
+  }
+
+  {
+    RowsSet none;
+
+    none.Intersect(dense);
+    result = result && same_rows(none, std::set<ROW_INDEX>());
+    result = result && (none.ToArray().Count() == 0);
+  }
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+same_matches(ITable& table, const FIELD_INDEX field, const DUInt32& min, const DUInt32& max)
+{
+  const DArray matches = table.MatchRows(min, max, 0, TABLE_ROWS, field);
+  const RowsSet set = table.MatchRowsSet(min, max, 0, TABLE_ROWS, field);
+
+  std::set<ROW_INDEX> expected;
+  for (uint64_t i = 0; i < matches.Count(); ++i)
+  {
+    DROW_INDEX row;
+    matches.Get(i, row);
+    expected.insert(row.mValue);
+  }
+
+  return (expected.size() == matches.Count()) && same_rows(set, expected);
+}
+
+
+static bool
+test_table_rows_sets()
+{
+  std::cout << "Test matching the table rows into sets ... ";
+
+  DBSFieldDescriptor fields[] = { {"value", T_UINT32, false} };
+
+  IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+  dbs.AddTable(table_name, 1, fields);
+
+  bool result = true;
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    const FIELD_INDEX field = table.RetrieveField("value");
+
+    for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+    {
+      table.AddRow();
+      if (row % 17 != 0)
+        table.Set(row, field, DUInt32(wh_rnd() % 1000));
+    }
+
+    result = result && same_matches(table, field, DUInt32(100), DUInt32(600));
+    result = result && same_matches(table, field, DUInt32(0), DUInt32(10));
+
+    table.CreateIndex(field, nullptr, nullptr);
+
+    result = result && same_matches(table, field, DUInt32(100), DUInt32(600));
+    result = result && same_matches(table, field, DUInt32(0), DUInt32(10));
+    result = result && same_matches(table, field, DUInt32(2000), DUInt32(3000));
+
+    dbs.ReleaseTable(table);
+  }
+
+  dbs.DeleteTable(table_name);
+  DBSReleaseDatabase(dbs);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(db_name);
+
+  success = success && test_rows_set_operations();
+  success = success && test_table_rows_sets();
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
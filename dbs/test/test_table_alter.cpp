@@ -0,0 +1,359 @@
+#include <assert.h>
+#include <iostream>
+#include <string>
+
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_values.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_alter_db";
+static const char table_name[] = "t_alter_table";
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"id", T_UINT32, false},
+                                            {"small", T_INT16, false},
+                                            {"day", T_DATE, false},
+                                            {"arr", T_UINT8, true}
+                                          };
+
+static const ROW_INDEX TABLE_ROWS = 5000;
+
+
+static bool
+is_null_row(const uint32_t id)
+{
+  return (id % 23) == 7;
+}
+
+
+static DInt16
+row_small(const uint32_t id)
+{
+  if ((id % 7) == 0)
+    return DInt16();
+
+  return DInt16(_SC(int16_t, (id * 7919) % 30000) - 15000);
+}
+
+
+static DDate
+row_day(const uint32_t id)
+{
+  if ((id % 5) == 0)
+    return DDate();
+
+  return DDate(1990 + id % 40, 1 + id % 12, 1 + id % 28);
+}
+
+
+static DText
+row_text(const uint32_t id)
+{
+  if ((id % 3) == 0)
+    return DText();
+
+  std::string text = "Row text added after the table was altered: ";
+  text += std::to_string(id);
+
+  return DText(text.c_str());
+}
+
+
+static void
+fill_table(ITable& table)
+{
+  const FIELD_INDEX id = table.RetrieveField("id");
+  const FIELD_INDEX small = table.RetrieveField("small");
+  const FIELD_INDEX day = table.RetrieveField("day");
+  const FIELD_INDEX arr = table.RetrieveField("arr");
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+  {
+    table.AddRow();
+    if (is_null_row(row))
+      continue;
+
+    DArray array;
+    array.Add(DUInt8(row % 256));
+
+    table.Set(row, id, DUInt32(row));
+    table.Set(row, small, row_small(row));
+    table.Set(row, day, row_day(row));
+    table.Set(row, arr, array);
+  }
+}
+
+
+static bool
+check_row(ITable& table, const ROW_INDEX row, const bool retyped, const bool texted)
+{
+  DUInt32 id;
+  DArray array;
+
+  table.Get(row, table.RetrieveField("id"), id);
+  table.Get(row, table.RetrieveField("arr"), array);
+
+  if (is_null_row(row))
+  {
+    if ( ! id.IsNull() || ! array.IsNull())
+      return false;
+  }
+  else
+  {
+    DUInt8 element;
+
+    if ((id != DUInt32(row)) || (array.Count() != 1))
+      return false;
+
+    array.Get(0, element);
+    if (element != DUInt8(row % 256))
+      return false;
+  }
+
+  const bool nullValues = is_null_row(row);
+  if (retyped)
+  {
+    DInt64 small;
+    DDateTime day;
+
+    table.Get(row, table.RetrieveField("small"), small);
+    table.Get(row, table.RetrieveField("day"), day);
+
+    const DInt16 expSmall = nullValues ? DInt16() : row_small(row);
+    const DDate expDay = nullValues ? DDate() : row_day(row);
+
+    if (expSmall.IsNull() ? ! small.IsNull() : (small != DInt64(expSmall.mValue)))
+      return false;
+
+    if (expDay.IsNull())
+      return day.IsNull();
+
+    return day == DDateTime(expDay.mYear, expDay.mMonth, expDay.mDay, 0, 0, 0);
+  }
+
+  DInt16 small;
+  DDate day;
+  DText text;
+  DUInt64 counter;
+
+  table.Get(row, table.RetrieveField("small"), small);
+  table.Get(row, table.RetrieveField("day"), day);
+  table.Get(row, table.RetrieveField("note"), text);
+  table.Get(row, table.RetrieveField("counter"), counter);
+
+  if ((small != (nullValues ? DInt16() : row_small(row)))
+      || (day != (nullValues ? DDate() : row_day(row))))
+  {
+    return false;
+  }
+
+  if ( ! counter.IsNull() && (counter != DUInt64(row)))
+    return false;
+
+  return texted ? (text == row_text(row)) : text.IsNull();
+}
+
+
+static bool
+check_table(ITable& table, const bool retyped, const bool texted)
+{
+  if (table.AllocatedRows() != TABLE_ROWS)
+    return false;
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+  {
+    if ( ! check_row(table, row, retyped, texted))
+      return false;
+  }
+
+  return true;
+}
+
+
+static bool
+test_add_fields()
+{
+  std::cout << "Test adding fields to a table with rows ... ";
+
+  IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+  dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    fill_table(table);
+    dbs.ReleaseTable(table);
+  }
+
+  //The table does not use variable size values until now.
+  const DBSFieldDescriptor note = {"note", T_TEXT, false};
+  const DBSFieldDescriptor counter = {"counter", T_UINT64, false};
+
+  dbs.AddTableField(table_name, note);
+
+  bool result = true;
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+
+    //Alter it while in use, with some of its rows still to be converted.
+    dbs.AddTableField(table_name, counter);
+
+    result = (table.FieldsCount() == 6) && check_table(table, false, false);
+
+    const FIELD_INDEX noteField = table.RetrieveField("note");
+    const FIELD_INDEX counterField = table.RetrieveField("counter");
+    for (ROW_INDEX row = 0; result && (row < TABLE_ROWS); ++row)
+    {
+      table.Set(row, noteField, row_text(row));
+      if ((row % 2) == 0)
+        table.Set(row, counterField, DUInt64(row));
+    }
+
+    result = result && check_table(table, false, true);
+
+    dbs.ReleaseTable(table);
+  }
+
+  if (result)
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    result = check_table(table, false, true);
+    dbs.ReleaseTable(table);
+  }
+
+  try
+  {
+    dbs.AddTableField(table_name, note);
+    result = false;
+  }
+  catch (DBSException& e)
+  {
+    result = result && (e.Code() == DBSException::FIELD_NAME_INVALID);
+  }
+
+  dbs.DeleteTable(table_name);
+  DBSReleaseDatabase(dbs);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_retype_fields()
+{
+  std::cout << "Test widening the fields of a table with rows ... ";
+
+  IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+  dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+  bool result = true;
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    fill_table(table);
+    table.CreateIndex(table.RetrieveField("id"), nullptr, nullptr);
+
+    dbs.RetypeTableField(table_name, "small", T_INT64);
+
+    //Convert only some of the rows, the rest are left to be converted later.
+    _SC(PrototypeTable&, table).ConvertSomeRows(1);
+
+    dbs.ReleaseTable(table);
+  }
+
+  dbs.RetypeTableField(table_name, "day", T_DATETIME);
+
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+
+    result = check_table(table, true, false);
+
+    while (_SC(PrototypeTable&, table).ConvertSomeRows(1))
+      ;
+
+    result = result && check_table(table, true, false);
+
+    dbs.ReleaseTable(table);
+  }
+
+  const DBS_FIELD_TYPE invalidTypes[] = {T_INT8, T_TEXT, T_DATE};
+  const char* const invalidFields[] = {"small", "small", "id"};
+  for (uint_t i = 0; i < sizeof invalidTypes / sizeof invalidTypes[0]; ++i)
+  {
+    try
+    {
+      dbs.RetypeTableField(table_name, invalidFields[i], invalidTypes[i]);
+      result = false;
+    }
+    catch (DBSException& e)
+    {
+      result = result && (e.Code() == DBSException::FIELD_TYPE_INVALID);
+    }
+  }
+
+  try
+  {
+    dbs.RetypeTableField(table_name, "id", T_UINT64);
+    result = false;
+  }
+  catch (DBSException& e)
+  {
+    result = result && (e.Code() == DBSException::FIELD_INDEXED);
+  }
+
+  if (result)
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    result = check_table(table, true, false);
+    dbs.ReleaseTable(table);
+  }
+
+  dbs.DeleteTable(table_name);
+  DBSReleaseDatabase(dbs);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSSettings settings;
+    settings.mTableCacheBlkCount = 4;
+    settings.mCheckpointBatch = 1;
+
+    DBSInit(settings);
+  }
+
+  DBSCreateDatabase(db_name);
+
+  success = success && test_add_fields();
+  success = success && test_retype_fields();
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
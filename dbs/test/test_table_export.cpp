@@ -0,0 +1,590 @@
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_values.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+#include "../pastra/ps_serializer.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_export_db";
+static const char table_name[] = "t_export_table";
+static const char csv_file[] = "t_export_rows.csv";
+static const char cols_file[] = "t_export_rows.cols";
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"id", T_UINT32, false},
+                                            {"kind", T_UINT8, false},
+                                            {"day", T_DATE, false},
+                                            {"tag", T_TEXT, false},
+                                            {"note", T_TEXT, false},
+                                            {"vals", T_INT32, true}
+                                          };
+
+static const ROW_INDEX TABLE_ROWS = 150000;
+
+
+static bool
+is_null_row(const ROW_INDEX row)
+{
+  return (row % 29) == 13;
+}
+
+
+static DUInt32
+row_id(const ROW_INDEX row)
+{
+  return DUInt32(row);
+}
+
+
+static DUInt8
+row_kind(const ROW_INDEX row)
+{
+  if ((row % 11) == 3)
+    return DUInt8();
+
+  return DUInt8((row / 1000) % 4);
+}
+
+
+static DDate
+row_day(const ROW_INDEX row)
+{
+  if ((row % 5) == 0)
+    return DDate();
+
+  return DDate(1990 + row % 40, 1 + row % 12, 1 + row % 28);
+}
+
+
+static std::string
+row_tag(const ROW_INDEX row)
+{
+  if ((row % 7) == 0)
+    return std::string();
+
+  return "tag" + std::to_string(row % 5);
+}
+
+
+static std::string
+row_note(const ROW_INDEX row)
+{
+  if ((row % 3) == 0)
+    return std::string();
+
+  return "The note of the exported row " + std::to_string(row);
+}
+
+
+static std::vector<int32_t>
+row_vals(const ROW_INDEX row)
+{
+  std::vector<int32_t> result;
+
+  if ((row % 4) == 0)
+    return result;
+
+  result.push_back(row);
+  result.push_back(-_SC(int32_t, row));
+  result.push_back(row % 10);
+
+  return result;
+}
+
+
+static void
+fill_table(ITable& table)
+{
+  std::string content;
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+  {
+    if (is_null_row(row))
+    {
+      content += ",,,,,\n";
+      continue;
+    }
+
+    content += std::to_string(row) + ",";
+
+    const DUInt8 kind = row_kind(row);
+    if ( ! kind.IsNull())
+      content += std::to_string(kind.mValue);
+    content += ",";
+
+    const DDate day = row_day(row);
+    if ( ! day.IsNull())
+    {
+      content += std::to_string(day.mYear) + "/" + std::to_string(day.mMonth)
+                 + "/" + std::to_string(day.mDay);
+    }
+
+    content += "," + row_tag(row) + "," + row_note(row) + ",";
+
+    const std::vector<int32_t> vals = row_vals(row);
+    for (size_t i = 0; i < vals.size(); ++i)
+      content += (i > 0 ? ";" : "") + std::to_string(vals[i]);
+
+    content += "\n";
+  }
+
+  FILE* const file = fopen(csv_file, "wb");
+  fwrite(content.data(), 1, content.size(), file);
+  fclose(file);
+
+  std::vector<FIELD_INDEX> fields;
+  for (auto& fd : field_descs)
+    fields.push_back(table.RetrieveField(fd.name));
+
+  table.LoadRows(csv_file, LOAD_CSV, fields.data(), fields.size());
+  remove(csv_file);
+}
+
+
+static int64_t
+days_since_epoch(const DDate& date)
+{
+  //Count the days one year at a time, good enough for the tested dates.
+  int64_t days = 0;
+  for (int y = 1970; y < date.mYear; ++y)
+    days += ((y % 4 == 0) && ((y % 100 != 0) || (y % 400 == 0))) ? 366 : 365;
+
+  static const int monthDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  const bool leap = (date.mYear % 4 == 0)
+                    && ((date.mYear % 100 != 0) || (date.mYear % 400 == 0));
+
+  for (int m = 1; m < date.mMonth; ++m)
+    days += monthDays[m - 1] + (((m == 2) && leap) ? 1 : 0);
+
+  return days + date.mDay - 1;
+}
+
+
+class ColumnsReader
+{
+public:
+  ColumnsReader(const std::vector<uint8_t>& data)
+    : mData(data),
+      mPos(0)
+  {
+  }
+
+  bool Ended() const { return mPos >= mData.size(); }
+  size_t Position() const { return mPos; }
+
+  uint64_t Int(const uint_t size)
+  {
+    uint64_t result = 0;
+
+    for (uint_t i = 0; i < size; ++i)
+      result |= _SC(uint64_t, mData.at(mPos++)) << (8 * i);
+
+    return result;
+  }
+
+  uint64_t Leb128()
+  {
+    uint64_t result = 0;
+    uint_t shift = 0;
+
+    while (true)
+    {
+      const uint8_t byte = mData.at(mPos++);
+
+      result |= _SC(uint64_t, byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+        return result;
+
+      shift += 7;
+    }
+  }
+
+  int64_t Delta(int64_t& previous)
+  {
+    const uint64_t value = Leb128();
+
+    previous += _SC(int64_t, (value >> 1) ^ (~(value & 1) + 1));
+    return previous;
+  }
+
+  std::string Text(const uint64_t size)
+  {
+    std::string result(_RC(const char*, mData.data() + mPos), size);
+
+    mPos += size;
+    return result;
+  }
+
+private:
+  const std::vector<uint8_t>&   mData;
+  size_t                        mPos;
+};
+
+
+struct ColumnCheck
+{
+  std::string       mName;
+  uint_t            mType;
+  std::vector<bool> mEncodings;
+};
+
+
+template<typename T> static bool
+check_basic_value(const T& expected,
+                  const uint8_t encoding,
+                  const std::string& raw,
+                  const int64_t ordinal)
+{
+  if (encoding == EXPORT_DELTA)
+    return ordinal == _SC(int64_t, expected.mValue);
+
+  uint8_t buffer[16];
+  Serializer::Store(buffer, expected);
+
+  return memcmp(buffer, raw.data(), raw.size()) == 0;
+}
+
+
+static bool
+check_basic_value(const DDate& expected,
+                  const uint8_t encoding,
+                  const std::string& raw,
+                  const int64_t ordinal)
+{
+  if (encoding == EXPORT_DELTA)
+    return ordinal == days_since_epoch(expected);
+
+  uint8_t buffer[16];
+  Serializer::Store(buffer, expected);
+
+  return memcmp(buffer, raw.data(), raw.size()) == 0;
+}
+
+
+static bool
+check_value(ColumnsReader&      reader,
+            const std::string&  field,
+            const uint8_t       encoding,
+            const ROW_INDEX     row,
+            int64_t&            previous,
+            std::string&        runValue,
+            uint64_t&           runLeft,
+            const std::vector<std::string>& dictionary)
+{
+  if ((field == "id") || (field == "kind") || (field == "day"))
+  {
+    const uint_t size = (field == "id") ? 4 : ((field == "kind") ? 1 : Serializer::Size(T_DATE, false));
+    int64_t ordinal = 0;
+
+    if (encoding == EXPORT_DELTA)
+      ordinal = reader.Delta(previous);
+
+    else if (encoding == EXPORT_RLE)
+    {
+      if (runLeft == 0)
+      {
+        runLeft = reader.Int(sizeof(uint32_t));
+        runValue = reader.Text(size);
+      }
+      --runLeft;
+    }
+    else if (encoding == EXPORT_PLAIN)
+      runValue = reader.Text(size);
+
+    else
+      return false;
+
+    if (field == "id")
+      return check_basic_value(row_id(row), encoding, runValue, ordinal);
+
+    else if (field == "kind")
+      return check_basic_value(row_kind(row), encoding, runValue, ordinal);
+
+    return check_basic_value(row_day(row), encoding, runValue, ordinal);
+  }
+  else if ((field == "tag") || (field == "note"))
+  {
+    std::string value;
+
+    if (encoding == EXPORT_DICTIONARY)
+      value = dictionary.at(reader.Leb128());
+
+    else if (encoding == EXPORT_PLAIN)
+      value = reader.Text(reader.Int(sizeof(uint32_t)));
+
+    else
+      return false;
+
+    return value == ((field == "tag") ? row_tag(row) : row_note(row));
+  }
+
+  if (encoding != EXPORT_PLAIN)
+    return false;
+
+  const std::vector<int32_t> expected = row_vals(row);
+  if (reader.Int(sizeof(uint32_t)) != expected.size())
+    return false;
+
+  for (auto value : expected)
+  {
+    if (_SC(int32_t, reader.Int(sizeof(int32_t))) != value)
+      return false;
+  }
+
+  return true;
+}
+
+
+static bool
+is_null_value(const std::string& field, const ROW_INDEX row)
+{
+  if (field == "id")
+    return false;
+
+  else if (field == "kind")
+    return row_kind(row).IsNull();
+
+  else if (field == "day")
+    return row_day(row).IsNull();
+
+  else if (field == "tag")
+    return row_tag(row).empty();
+
+  else if (field == "note")
+    return row_note(row).empty();
+
+  return row_vals(row).empty();
+}
+
+
+static bool
+check_column(ColumnsReader&                  reader,
+             const std::string&              field,
+             const std::vector<ROW_INDEX>&   rows,
+             std::vector<bool>&              encodings)
+{
+  const uint8_t encoding = reader.Int(1);
+  const uint64_t size = reader.Int(sizeof(uint64_t));
+  const size_t end = reader.Position() + size;
+
+  if (encoding > EXPORT_DICTIONARY)
+    return false;
+
+  encodings[encoding] = true;
+
+  std::vector<bool> nulls;
+  for (size_t i = 0; i < (rows.size() + 7) / 8; ++i)
+  {
+    const uint8_t bits = reader.Int(1);
+    for (uint_t b = 0; b < 8; ++b)
+      nulls.push_back((bits & (1 << b)) != 0);
+  }
+
+  std::vector<std::string> dictionary;
+  if (encoding == EXPORT_DICTIONARY)
+  {
+    const uint64_t count = reader.Int(sizeof(uint32_t));
+    for (uint64_t i = 0; i < count; ++i)
+      dictionary.push_back(reader.Text(reader.Int(sizeof(uint32_t))));
+  }
+
+  int64_t previous = 0;
+  std::string runValue;
+  uint64_t runLeft = 0;
+  for (size_t i = 0; i < rows.size(); ++i)
+  {
+    if (nulls[i] != is_null_value(field, rows[i]))
+      return false;
+
+    if ( ! nulls[i]
+        && ! check_value(reader, field, encoding, rows[i], previous, runValue, runLeft, dictionary))
+    {
+      return false;
+    }
+  }
+
+  return (reader.Position() == end) && (runLeft == 0);
+}
+
+
+static bool
+check_export_file(const std::vector<std::string>& fields, std::vector<bool>& encodings)
+{
+  std::vector<uint8_t> data;
+  {
+    FILE* const file = fopen(cols_file, "rb");
+    uint8_t buffer[4096];
+    size_t count;
+
+    while ((count = fread(buffer, 1, sizeof buffer, file)) > 0)
+      data.insert(data.end(), buffer, buffer + count);
+
+    fclose(file);
+  }
+
+  ColumnsReader reader(data);
+
+  if ((reader.Int(sizeof(uint32_t)) != 0x534C4F43)
+      || (reader.Int(sizeof(uint16_t)) != 1)
+      || (reader.Int(sizeof(uint16_t)) != fields.size()))
+  {
+    return false;
+  }
+
+  for (auto& field : fields)
+  {
+    const uint_t type = reader.Int(sizeof(uint16_t));
+    const std::string name = reader.Text(reader.Int(sizeof(uint16_t)));
+
+    uint_t expectedType = 0;
+    for (auto& fd : field_descs)
+    {
+      if (field == fd.name)
+        expectedType = fd.type | (fd.isArray ? T_ARRAY_MASK : 0);
+    }
+
+    if ((name != field) || (type != expectedType))
+      return false;
+  }
+
+  std::vector<ROW_INDEX> expectedRows;
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+  {
+    if ( ! is_null_row(row))
+      expectedRows.push_back(row);
+  }
+
+  size_t exported = 0;
+  while (true)
+  {
+    const uint64_t rowsCount = reader.Int(sizeof(uint32_t));
+    if (rowsCount == 0)
+      break;
+
+    if ((reader.Int(1) != EXPORT_DELTA))
+      return false;
+
+    const size_t end = reader.Int(sizeof(uint64_t)) + reader.Position();
+    std::vector<ROW_INDEX> rows;
+    int64_t previous = 0;
+
+    for (uint64_t i = 0; i < rowsCount; ++i)
+    {
+      rows.push_back(reader.Delta(previous));
+      if (rows.back() != expectedRows.at(exported + i))
+        return false;
+    }
+
+    if (reader.Position() != end)
+      return false;
+
+    for (auto& field : fields)
+    {
+      if ( ! check_column(reader, field, rows, encodings))
+        return false;
+    }
+
+    exported += rowsCount;
+  }
+
+  return (exported == expectedRows.size())
+         && (reader.Int(sizeof(uint64_t)) == exported)
+         && reader.Ended();
+}
+
+
+static bool
+test_export_table()
+{
+  std::cout << "Test exporting a table to a columnar file ... ";
+
+  IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+  dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+  bool result = true;
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    fill_table(table);
+
+    ROW_INDEX expectedRows = 0;
+    for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+      expectedRows += is_null_row(row) ? 0 : 1;
+
+    std::vector<std::string> fields;
+    for (FIELD_INDEX f = 0; f < table.FieldsCount(); ++f)
+      fields.push_back(table.DescribeField(f).name);
+
+    std::vector<bool> encodings(_SC(size_t, EXPORT_DICTIONARY) + 1, false);
+
+    result = (table.ExportRows(cols_file, nullptr, 0) == expectedRows);
+    result = result && check_export_file(fields, encodings);
+
+    //Every encoding was picked by some of the columns.
+    for (auto used : encodings)
+      result = result && used;
+
+    const FIELD_INDEX someFields[] = {table.RetrieveField("note"),
+                                      table.RetrieveField("id"),
+                                      table.RetrieveField("day")};
+    result = result && (table.ExportRows(cols_file, someFields, 3) == expectedRows);
+    result = result && check_export_file({"note", "id", "day"}, encodings);
+
+    dbs.ReleaseTable(table);
+  }
+
+  remove(cols_file);
+
+  dbs.DeleteTable(table_name);
+  DBSReleaseDatabase(dbs);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSSettings settings;
+    settings.mTableCacheBlkCount = 16;
+    settings.mExportThreads = 3;
+
+    DBSInit(settings);
+  }
+
+  DBSCreateDatabase(db_name);
+
+  success = success && test_export_table();
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
@@ -0,0 +1,550 @@
+#include <assert.h>
+#include <stdio.h>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_values.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_load_db";
+static const char table_name[] = "t_load_table";
+static const char csv_file[] = "t_load_rows.csv";
+static const char bin_file[] = "t_load_rows.bin";
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"id", T_UINT32, false},
+                                            {"name", T_TEXT, false},
+                                            {"day", T_DATE, false},
+                                            {"vals", T_INT16, true}
+                                          };
+
+static const ROW_INDEX PRESET_ROWS = 10;
+static const ROW_INDEX LOADED_ROWS = 5000;
+
+
+static bool
+is_null_row(const uint32_t id)
+{
+  return (id % 37) == 11;
+}
+
+
+static std::string
+row_name(const uint32_t id)
+{
+  if ((id % 3) == 0)
+    return std::string();
+
+  else if ((id % 3) == 1)
+    return "Name, \"quoted\" of the loaded row " + std::to_string(id);
+
+  return "n" + std::to_string(id % 1000);
+}
+
+
+static DDate
+row_day(const uint32_t id)
+{
+  if ((id % 5) == 0)
+    return DDate();
+
+  return DDate(1990 + id % 40, 1 + id % 12, 1 + id % 28);
+}
+
+
+static std::vector<int16_t>
+row_vals(const uint32_t id)
+{
+  std::vector<int16_t> result;
+
+  if ((id % 4) == 0)
+    return result;
+
+  result.push_back(id % 100);
+  result.push_back(-_SC(int16_t, id % 50));
+  for (uint_t i = 0; i < id % 9; ++i)
+    result.push_back(i);
+
+  return result;
+}
+
+
+static void
+write_file(const char* const name, const std::string& content)
+{
+  FILE* const file = fopen(name, "wb");
+
+  fwrite(content.data(), 1, content.size(), file);
+  fclose(file);
+}
+
+
+static std::string
+csv_row(const uint32_t id)
+{
+  if (is_null_row(id))
+    return ",,,";
+
+  std::string result = std::to_string(id) + ",";
+
+  const std::string name = row_name(id);
+  if ( ! name.empty())
+  {
+    result += '"';
+    for (auto c : name)
+    {
+      if (c == '"')
+        result += '"';
+      result += c;
+    }
+    result += '"';
+  }
+  result += ",";
+
+  const DDate day = row_day(id);
+  if ( ! day.IsNull())
+  {
+    result += std::to_string(day.mYear) + "/" + std::to_string(day.mMonth)
+              + "/" + std::to_string(day.mDay);
+  }
+  result += ",";
+
+  const std::vector<int16_t> vals = row_vals(id);
+  for (size_t i = 0; i < vals.size(); ++i)
+    result += (i > 0 ? ";" : "") + std::to_string(vals[i]);
+
+  return result;
+}
+
+
+static void
+write_csv_file(const ROW_INDEX rowsCount)
+{
+  std::string content;
+
+  for (ROW_INDEX row = 0; row < rowsCount; ++row)
+    content += csv_row(row) + (((row % 2) == 0) ? "\r\n" : "\n");
+
+  //The empty lines are skipped.
+  content += "\n\n";
+
+  write_file(csv_file, content);
+}
+
+
+static void
+append_le(std::string& content, const uint64_t value, const uint_t size)
+{
+  for (uint_t i = 0; i < size; ++i)
+    content += _SC(char, (value >> (8 * i)) & 0xFF);
+}
+
+
+//The binary rows hold only the 'vals' and 'id' fields, in this order.
+static void
+write_bin_file(const ROW_INDEX rowsCount)
+{
+  std::string content;
+
+  for (ROW_INDEX row = 0; row < rowsCount; ++row)
+  {
+    const std::vector<int16_t> vals = row_vals(row);
+    const uint8_t nulls = (is_null_row(row) ? 2 : 0) | ((vals.empty() || is_null_row(row)) ? 1 : 0);
+
+    content += _SC(char, nulls);
+    if ((nulls & 1) == 0)
+    {
+      append_le(content, vals.size(), sizeof(uint32_t));
+      for (auto v : vals)
+        append_le(content, _SC(uint16_t, v), sizeof(uint16_t));
+    }
+
+    if ((nulls & 2) == 0)
+      append_le(content, row, sizeof(uint32_t));
+  }
+
+  write_file(bin_file, content);
+}
+
+
+//The values of the CSV rows are in the order the fields are declared.
+static std::vector<FIELD_INDEX>
+csv_fields(ITable& table)
+{
+  std::vector<FIELD_INDEX> result;
+
+  for (auto& fd : field_descs)
+    result.push_back(table.RetrieveField(fd.name));
+
+  return result;
+}
+
+
+static bool
+check_loaded_row(ITable& table, const ROW_INDEX row, const uint32_t id, const bool binary)
+{
+  DUInt32 idValue;
+  DText name;
+  DDate day;
+  DArray vals;
+
+  table.Get(row, table.RetrieveField("id"), idValue);
+  table.Get(row, table.RetrieveField("name"), name);
+  table.Get(row, table.RetrieveField("day"), day);
+  table.Get(row, table.RetrieveField("vals"), vals);
+
+  if (is_null_row(id))
+    return idValue.IsNull() && name.IsNull() && day.IsNull() && vals.IsNull();
+
+  if (idValue != DUInt32(id))
+    return false;
+
+  if (binary)
+  {
+    if ( ! name.IsNull() || ! day.IsNull())
+      return false;
+  }
+  else
+  {
+    const std::string expName = row_name(id);
+    if ((expName.empty() ? ! name.IsNull() : (name != DText(expName.c_str())))
+        || (day != row_day(id)))
+    {
+      return false;
+    }
+  }
+
+  const std::vector<int16_t> expVals = row_vals(id);
+  if (vals.Count() != expVals.size())
+    return false;
+
+  for (size_t i = 0; i < expVals.size(); ++i)
+  {
+    DInt16 value;
+    vals.Get(i, value);
+
+    if (value != DInt16(expVals[i]))
+      return false;
+  }
+
+  return true;
+}
+
+
+static void
+preset_rows(ITable& table)
+{
+  for (ROW_INDEX row = 0; row < PRESET_ROWS; ++row)
+  {
+    table.AddRow();
+    table.Set(row, table.RetrieveField("id"), DUInt32(1000000 + row));
+    table.Set(row, table.RetrieveField("name"), DText("A row that was added before the load."));
+  }
+}
+
+
+static bool
+check_preset_rows(ITable& table)
+{
+  for (ROW_INDEX row = 0; row < PRESET_ROWS; ++row)
+  {
+    DUInt32 id;
+    DText name;
+
+    table.Get(row, table.RetrieveField("id"), id);
+    table.Get(row, table.RetrieveField("name"), name);
+
+    if ((id != DUInt32(1000000 + row))
+        || (name != DText("A row that was added before the load.")))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+static bool
+check_csv_table(ITable& table)
+{
+  if (table.AllocatedRows() != PRESET_ROWS + LOADED_ROWS)
+    return false;
+
+  if ( ! check_preset_rows(table))
+    return false;
+
+  ROW_INDEX nullRows = 0;
+  for (ROW_INDEX row = 0; row < LOADED_ROWS; ++row)
+  {
+    if ( ! check_loaded_row(table, PRESET_ROWS + row, row, false))
+      return false;
+
+    nullRows += is_null_row(row) ? 1 : 0;
+  }
+
+  if (table.ReusableRowsCount() != nullRows)
+    return false;
+
+  //The index was updated with the loaded rows too.
+  const FIELD_INDEX id = table.RetrieveField("id");
+  for (ROW_INDEX row = 0; row < LOADED_ROWS; row += 7)
+  {
+    if (is_null_row(row))
+      continue;
+
+    DArray matched = table.MatchRows(DUInt32(row), DUInt32(row), 0, ~0, id);
+    DROW_INDEX matchedRow;
+
+    if (matched.Count() != 1)
+      return false;
+
+    matched.Get(0, matchedRow);
+    if (matchedRow != DROW_INDEX(PRESET_ROWS + row))
+      return false;
+  }
+
+  return true;
+}
+
+
+static bool
+test_load_csv()
+{
+  std::cout << "Test loading the rows of a CSV file ... ";
+
+  IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+  dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+  write_csv_file(LOADED_ROWS);
+
+  bool result = true;
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+
+    const std::vector<FIELD_INDEX> csvFields = csv_fields(table);
+
+    table.CreateIndex(table.RetrieveField("id"), nullptr, nullptr);
+    preset_rows(table);
+
+    result = (table.LoadRows(csv_file, LOAD_CSV, csvFields.data(), csvFields.size()) == LOADED_ROWS);
+    result = result && check_csv_table(table);
+
+    dbs.ReleaseTable(table);
+  }
+
+  if (result)
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    result = check_csv_table(table);
+    dbs.ReleaseTable(table);
+  }
+
+  dbs.DeleteTable(table_name);
+  DBSReleaseDatabase(dbs);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_load_binary()
+{
+  std::cout << "Test loading some fields from a binary file ... ";
+
+  IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+  dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+  write_bin_file(LOADED_ROWS);
+
+  bool result = true;
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+
+    const FIELD_INDEX fields[] = {table.RetrieveField("vals"), table.RetrieveField("id")};
+
+    result = (table.LoadRows(bin_file, LOAD_BINARY, fields, 2) == LOADED_ROWS);
+    result = result && (table.AllocatedRows() == LOADED_ROWS);
+    for (ROW_INDEX row = 0; result && (row < LOADED_ROWS); ++row)
+      result = check_loaded_row(table, row, row, true);
+
+    dbs.ReleaseTable(table);
+  }
+
+  dbs.DeleteTable(table_name);
+  DBSReleaseDatabase(dbs);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_load_errors()
+{
+  std::cout << "Test the table is left unchanged by invalid files ... ";
+
+  IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+  dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+  bool result = true;
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    const std::vector<FIELD_INDEX> csvFields = csv_fields(table);
+
+    table.CreateIndex(table.RetrieveField("id"), nullptr, nullptr);
+    preset_rows(table);
+
+    const std::string goodRows[] = {csv_row(1), csv_row(2), csv_row(4)};
+    const std::string badRows[] = {
+                                    "abc,,,",
+                                    "1,,2020/1/1",
+                                    "1,,,1;2;",
+                                    "1,\"unterminated,,",
+                                    "1,,,,",
+                                    "1,,2020/13/40,"
+                                  };
+
+    for (auto& badRow : badRows)
+    {
+      std::string content;
+      for (ROW_INDEX row = 0; row < 3000; ++row)
+        content += goodRows[row % 3] + "\n";
+
+      content += badRow + "\n";
+      for (ROW_INDEX row = 0; row < 10; ++row)
+        content += goodRows[row % 3] + "\n";
+
+      write_file(csv_file, content);
+      try
+      {
+        table.LoadRows(csv_file, LOAD_CSV, csvFields.data(), csvFields.size());
+        result = false;
+      }
+      catch (DBSException& e)
+      {
+        result = result && (e.Code() == DBSException::INVALID_PARAMETERS);
+      }
+    }
+
+    //A file bigger than the loader's input buffer, with its rows already
+    //written to the table when the invalid one is found.
+    {
+      std::string content;
+      for (ROW_INDEX row = 0; row < 100000; ++row)
+        content += csv_row(row) + "\n";
+
+      content += "1,,,1;;2\n";
+      write_file(csv_file, content);
+      try
+      {
+        table.LoadRows(csv_file, LOAD_CSV, csvFields.data(), csvFields.size());
+        result = false;
+      }
+      catch (DBSException& e)
+      {
+        result = result && (e.Code() == DBSException::INVALID_PARAMETERS);
+      }
+    }
+
+    //A binary file that ends in the middle of a row.
+    write_bin_file(100);
+    {
+      FILE* const file = fopen(bin_file, "ab");
+      fputc(0, file);
+      fclose(file);
+    }
+
+    const FIELD_INDEX fields[] = {table.RetrieveField("vals"), table.RetrieveField("id")};
+    try
+    {
+      table.LoadRows(bin_file, LOAD_BINARY, fields, 2);
+      result = false;
+    }
+    catch (DBSException& e)
+    {
+      result = result && (e.Code() == DBSException::INVALID_PARAMETERS);
+    }
+
+    try
+    {
+      const FIELD_INDEX duplicates[] = {fields[0], fields[0]};
+      table.LoadRows(bin_file, LOAD_BINARY, duplicates, 2);
+      result = false;
+    }
+    catch (DBSException& e)
+    {
+      result = result && (e.Code() == DBSException::INVALID_PARAMETERS);
+    }
+
+    result = result
+             && (table.AllocatedRows() == PRESET_ROWS)
+             && (table.ReusableRowsCount() == 0)
+             && check_preset_rows(table)
+             && (table.MatchRows(DUInt32(1), DUInt32(1), 0, ~0, fields[1]).Count() == 0);
+
+    //The table is still usable after that.
+    write_csv_file(100);
+    result = result && (table.LoadRows(csv_file, LOAD_CSV, csvFields.data(), csvFields.size()) == 100);
+    result = result && check_loaded_row(table, PRESET_ROWS + 1, 1, false);
+
+    dbs.ReleaseTable(table);
+  }
+
+  dbs.DeleteTable(table_name);
+  DBSReleaseDatabase(dbs);
+
+  remove(csv_file);
+  remove(bin_file);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSSettings settings;
+    settings.mTableCacheBlkCount = 4;
+    settings.mLoadThreads = 3;
+
+    DBSInit(settings);
+  }
+
+  DBSCreateDatabase(db_name);
+
+  success = success && test_load_csv();
+  success = success && test_load_binary();
+  success = success && test_load_errors();
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
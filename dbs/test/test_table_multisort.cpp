@@ -0,0 +1,370 @@
+#include <assert.h>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "utils/wrandom.h"
+#include "utils/wsort.h"
+#include "custom/include/test/test_fmw.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_values.h"
+
+#include "../pastra/ps_sortkeys.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_multisort_db";
+static const char table_name[] = "t_multisort_table";
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"id", T_UINT32, false},
+                                            {"k1", T_INT16, false},
+                                            {"k2", T_TEXT, false},
+                                            {"arr", T_UINT16, true}
+                                          };
+
+static const ROW_INDEX TABLE_ROWS = 3000;
+
+
+static bool
+is_null_row(const uint32_t id)
+{
+  return (id % 17) == 5;
+}
+
+
+static DInt16
+row_k1(const uint32_t id)
+{
+  if ((id % 11) == 0)
+    return DInt16();
+
+  return DInt16(_SC(int16_t, (id * 7919) % 50) - 25);
+}
+
+
+static DText
+row_k2(const uint32_t id)
+{
+  if ((id % 13) == 0)
+    return DText();
+
+  std::string text = (id % 3) ? "t " : "A text long enough to be stored apart: ";
+  text += std::to_string((id * 31) % 97);
+
+  return DText(text.c_str());
+}
+
+
+static void
+fill_table(ITable& table)
+{
+  const FIELD_INDEX id = table.RetrieveField("id");
+  const FIELD_INDEX k1 = table.RetrieveField("k1");
+  const FIELD_INDEX k2 = table.RetrieveField("k2");
+  const FIELD_INDEX arr = table.RetrieveField("arr");
+
+  table.CreateIndex(k1, nullptr, nullptr);
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+  {
+    table.AddRow();
+    if (is_null_row(row))
+      continue;
+
+    DArray array;
+    array.Add(DUInt16(row));
+    array.Add(DUInt16(row % 5));
+
+    table.Set(row, id, DUInt32(row));
+    table.Set(row, k1, row_k1(row));
+    table.Set(row, k2, row_k2(row));
+    table.Set(row, arr, array);
+  }
+}
+
+
+static bool
+check_row_values(ITable& table, const ROW_INDEX row, DUInt32& outId)
+{
+  DInt16 k1Value;
+  DText k2Value;
+  DArray arrayValue;
+
+  table.Get(row, table.RetrieveField("id"), outId);
+  table.Get(row, table.RetrieveField("k1"), k1Value);
+  table.Get(row, table.RetrieveField("k2"), k2Value);
+  table.Get(row, table.RetrieveField("arr"), arrayValue);
+
+  if (outId.IsNull())
+    return k1Value.IsNull() && k2Value.IsNull() && arrayValue.IsNull();
+
+  DUInt16 first, second;
+  if (arrayValue.Count() != 2)
+    return false;
+
+  arrayValue.Get(0, first);
+  arrayValue.Get(1, second);
+
+  return (k1Value == row_k1(outId.mValue))
+         && (k2Value == row_k2(outId.mValue))
+         && (first == DUInt16(outId.mValue))
+         && (second == DUInt16(outId.mValue % 5));
+}
+
+
+static bool
+check_sorted_table(ITable& table, const ROW_INDEX from, const ROW_INDEX to)
+{
+  const FIELD_INDEX k1 = table.RetrieveField("k1");
+  const FIELD_INDEX k2 = table.RetrieveField("k2");
+
+  ROW_INDEX nullRows = 0;
+  std::vector<bool> seenIds(TABLE_ROWS, false);
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+  {
+    DUInt32 id;
+
+    if ( ! check_row_values(table, row, id))
+      return false;
+
+    if (id.IsNull())
+    {
+      ++nullRows;
+      continue;
+    }
+    else if (seenIds[id.mValue])
+      return false;
+
+    seenIds[id.mValue] = true;
+
+    if ((row < from) || (to < row))
+    {
+      if (id.mValue != row)
+        return false;
+
+      continue;
+    }
+    else if (row == from)
+      continue;
+
+    DUInt32 prevId;
+    DInt16 prevK1, k1Value;
+    DText prevK2, k2Value;
+
+    table.Get(row - 1, table.RetrieveField("id"), prevId);
+    table.Get(row - 1, k1, prevK1);
+    table.Get(row, k1, k1Value);
+    table.Get(row - 1, k2, prevK2);
+    table.Get(row, k2, k2Value);
+
+    if (k1Value < prevK1)
+      return false;
+
+    else if (k1Value == prevK1)
+    {
+      //The second field is sorted in reverse order.
+      if (prevK2 < k2Value)
+        return false;
+
+      else if ((prevK2 == k2Value) && ! prevId.IsNull() && (id < prevId))
+        return false;
+    }
+  }
+
+  if (table.ReusableRowsCount() != nullRows)
+    return false;
+
+  const ROW_INDEX reusableRow = table.GetReusableRow(false);
+  DUInt32 reusableId;
+  if ((reusableRow >= TABLE_ROWS) || ! check_row_values(table, reusableRow, reusableId)
+      || ! reusableId.IsNull())
+  {
+    return false;
+  }
+
+  for (int16_t value = -25; value < 25; ++value)
+  {
+    const DArray matched = table.MatchRows(DInt16(value),
+                                           DInt16(value),
+                                           0,
+                                           TABLE_ROWS - 1,
+                                           k1);
+    ROW_INDEX expectedCount = 0;
+    for (ROW_INDEX row = 0; row < TABLE_ROWS; ++row)
+    {
+      DInt16 k1Value;
+      table.Get(row, k1, k1Value);
+
+      if (k1Value == DInt16(value))
+        ++expectedCount;
+    }
+
+    if (matched.Count() != expectedCount)
+      return false;
+
+    for (uint64_t i = 0; i < matched.Count(); ++i)
+    {
+      DROW_INDEX row;
+      DInt16 k1Value;
+
+      matched.Get(i, row);
+      table.Get(row.mValue, k1, k1Value);
+
+      if (k1Value != DInt16(value))
+        return false;
+    }
+  }
+
+  return true;
+}
+
+
+static bool
+test_multi_field_sort()
+{
+  std::cout << "Test sorting a table by several fields ... ";
+
+  IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+  dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+  bool result = true;
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    fill_table(table);
+
+    const FIELD_INDEX fields[] = {table.RetrieveField("k1"), table.RetrieveField("k2")};
+    const bool reverse[] = {false, true};
+
+    table.Sort(fields, reverse, 2, 100, 1999);
+    result = check_sorted_table(table, 100, 1999);
+
+    table.Sort(fields, reverse, 2, 0, TABLE_ROWS - 1);
+    result = result && check_sorted_table(table, 0, TABLE_ROWS - 1);
+
+    dbs.ReleaseTable(table);
+  }
+
+  if (result)
+  {
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    result = check_sorted_table(table, 0, TABLE_ROWS - 1);
+    dbs.ReleaseTable(table);
+  }
+
+  dbs.DeleteTable(table_name);
+  DBSReleaseDatabase(dbs);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_spilled_keys()
+{
+  std::cout << "Test sorting keys over the memory budget ... ";
+
+  static const uint_t KEYS_COUNT = 40000;
+
+  auto budget = std::make_shared<TempMemoryBudget>(64 * 1024);
+  auto prevBudget = TempMemoryBudget::Current(budget);
+
+  std::vector<std::pair<int32_t, ROW_INDEX>> expected;
+  std::vector<ROW_INDEX> sortedRows;
+  uint_t runsCount = 0;
+  {
+    RowsSortKeys keys(4);
+
+    for (ROW_INDEX row = 0; row < KEYS_COUNT; ++row)
+    {
+      const int32_t value = _SC(int32_t, wh_rnd() % 1000) - 500;
+
+      keys.Add(DInt32(value), true);
+      keys.CommitKey(row);
+
+      expected.push_back(std::make_pair(-value, row));
+    }
+
+    runsCount = keys.SpilledRunsCount();
+    keys.Sort(sortedRows);
+  }
+
+  std::sort(expected.begin(), expected.end());
+
+  bool result = (runsCount > 1)
+                && (sortedRows.size() == KEYS_COUNT)
+                && (budget->Stats().mUsed == 0)
+                && (budget->Stats().mSpillsCount > 0);
+
+  for (ROW_INDEX i = 0; result && (i < KEYS_COUNT); ++i)
+    result = (sortedRows[i] == expected[i].second);
+
+  TempMemoryBudget::Current(prevBudget);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_parallel_sort()
+{
+  std::cout << "Test sorting items using several threads ... ";
+
+  std::vector<uint64_t> items;
+  for (uint_t i = 0; i < 100003; ++i)
+    items.push_back(wh_rnd());
+
+  std::vector<uint64_t> expected = items;
+  std::sort(expected.begin(), expected.end());
+
+  parallel_sort(items.data(), items.size(), 5, std::less<uint64_t>());
+
+  const bool result = (items == expected);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSSettings settings;
+    settings.mSortThreads = 3;
+
+    DBSInit(settings);
+  }
+
+  DBSCreateDatabase(db_name);
+
+  success = success && test_parallel_sort();
+  success = success && test_spilled_keys();
+  success = success && test_multi_field_sort();
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
@@ -0,0 +1,224 @@
+#include <assert.h>
+#include <memory.h>
+#include <iostream>
+
+#include "dbs/dbs_mgr.h"
+#include "utils/wrandom.h"
+
+#include "custom/include/test/test_fmw.h"
+#include "../pastra/ps_container.h"
+
+using namespace whais;
+using namespace pastra;
+
+uint8_t buffer[1024];
+
+
+static void
+fill_container(TemporalContainer& container, const uint_t size, const uint_t step)
+{
+  uint_t written = 0;
+
+  while (written < size)
+    {
+      const uint_t writeSize = MIN(step, size - written);
+
+      for (uint_t i = 0; i < writeSize; ++i)
+        buffer[i] = (written + i) & 0xFF;
+
+      container.Write(written, writeSize, buffer);
+      written += writeSize;
+    }
+}
+
+
+static bool
+check_container(TemporalContainer& container,
+                const uint_t      size,
+                const uint_t      step,
+                const uint_t      removedFrom,
+                const uint_t      removedSize)
+{
+  uint_t checked = 0;
+
+  if (container.Size() != size)
+    return false;
+
+  while (checked < size)
+    {
+      const uint_t readSize = MIN(step, size - checked);
+
+      container.Read(checked, readSize, buffer);
+      for (uint_t i = 0; i < readSize; ++i)
+        {
+          uint_t pos = checked + i;
+          if (pos >= removedFrom)
+            pos += removedSize;
+
+          if (buffer[i] != (pos & 0xFF))
+            return false;
+        }
+
+      checked += readSize;
+    }
+
+  return true;
+}
+
+
+static bool
+test_in_memory()
+{
+  std::cout << "Testing a big temporal container kept in memory ... ";
+
+  const uint_t containerSize = 1024 * 1024 + 313;
+  const uint_t step = wh_rnd() % 600 + 1;
+
+  const DBSTempMemoryStats before = DBSGetTempMemoryStats();
+  {
+    TemporalContainer container;
+
+    fill_container(container, containerSize, step);
+    if (container.IsSpilled()
+        || ! check_container(container, containerSize, step, containerSize, 0))
+    {
+      std::cout << "FAIL\n";
+      return false;
+    }
+
+    container.Colapse(1000, 300000);
+    if (container.IsSpilled()
+        || ! check_container(container, containerSize - 299000, step, 1000, 299000))
+    {
+      std::cout << "FAIL\n";
+      return false;
+    }
+
+    if (DBSGetTempMemoryStats().mUsed <= before.mUsed)
+    {
+      std::cout << "FAIL\n";
+      return false;
+    }
+  }
+
+  const DBSTempMemoryStats after = DBSGetTempMemoryStats();
+  if ((after.mUsed != before.mUsed) || (after.mSpillsCount != before.mSpillsCount))
+  {
+    std::cout << "FAIL\n";
+    return false;
+  }
+
+  std::cout << "OK\n";
+  return true;
+}
+
+
+static bool
+test_spill()
+{
+  std::cout << "Testing a temporal container over its memory budget ... ";
+
+  const uint_t containerSize = 512 * 1024 + 77;
+  const uint_t step = wh_rnd() % 600 + 1;
+
+  auto budget = std::make_shared<TempMemoryBudget>(64 * 1024);
+  auto prevBudget = TempMemoryBudget::Current(budget);
+
+  bool result = true;
+  {
+    TemporalContainer container(1024);
+
+    fill_container(container, containerSize, step);
+
+    result = container.IsSpilled()
+             && (budget->Stats().mSpillsCount == 1)
+             && (budget->Stats().mUsed <= 64 * 1024)
+             && check_container(container, containerSize, step, containerSize, 0);
+
+    container.Colapse(5, 400000);
+    result = result && check_container(container, containerSize - 399995, step, 5, 399995);
+
+    //Small enough to be moved back in memory.
+    container.Colapse(0, containerSize - 399995 - 100);
+    result = result
+             && ! container.IsSpilled()
+             && (container.Size() == 100);
+
+    container.Read(0, 100, buffer);
+    for (uint_t i = 0; i < 100; ++i)
+      result = result && (buffer[i] == ((containerSize - 100 + i) & 0xFF));
+  }
+
+  result = result && (budget->Stats().mUsed == 0);
+
+  TempMemoryBudget::Current(prevBudget);
+
+  std::cout << (result ? "OK\n" : "FAIL\n");
+  return result;
+}
+
+
+static bool
+test_exhausted_budget()
+{
+  std::cout << "Testing a temporal container with its memory budget exhausted ... ";
+
+  const uint_t containerSize = 64 * 1024 + 19;
+  const uint_t step = wh_rnd() % 600 + 1;
+
+  //Too small even for the container's first chunk.
+  auto budget = std::make_shared<TempMemoryBudget>(512);
+  auto prevBudget = TempMemoryBudget::Current(budget);
+
+  const DBSTempMemoryStats before = DBSGetTempMemoryStats();
+
+  bool result = true;
+  {
+    TemporalContainer container(1024);
+
+    fill_container(container, containerSize, step);
+
+    result = container.IsSpilled()
+             && (budget->Stats().mUsed == 0)
+             && check_container(container, containerSize, step, containerSize, 0);
+  }
+
+  result = result && (budget->Stats().mUsed == 0);
+  result = result && (DBSGetTempMemoryStats().mUsed == before.mUsed);
+
+  TempMemoryBudget::Current(prevBudget);
+
+  std::cout << (result ? "OK\n" : "FAIL\n");
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  success = success && test_in_memory();
+  success = success && test_spill();
+  success = success && test_exhausted_budget();
+
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
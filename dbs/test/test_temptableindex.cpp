@@ -213,7 +213,11 @@ main(int argc, char **argv)
 
   bool success = true;
   {
-    DBSInit(DBSSettings());
+    //Keep the temporal values under the memory limit of the tests allocator.
+    DBSSettings settings;
+    settings.mTempMemoryLimit = 8 * 1024 * 1024;
+
+    DBSInit(settings);
     DBSCreateDatabase(db_name);
   }
 
@@ -0,0 +1,199 @@
+#include <assert.h>
+#include <iostream>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "utils/wrandom.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_rowsset.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_textbtindex_db";
+static const char table_name[] = "t_textbtindex_table";
+
+static const ROW_INDEX TABLE_ROWS = 20000;
+
+//Longer than the index prefix, so these are told apart by their rows only.
+static const char long_prefix[] = "customer.with.a.very.long.common.name#";
+
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"name", T_TEXT, false},
+                                            {"id", T_UINT32, false}
+                                          };
+
+
+static std::string
+row_name(const uint_t value)
+{
+  switch (value % 4)
+  {
+  case 0:
+    return std::string();
+
+  case 1:
+    return "sku" + std::to_string(value % 1000);
+
+  case 2:
+    return "m\xC4\x83r" + std::to_string(value % 300);
+
+  default:
+    break;
+  }
+
+  return long_prefix + std::to_string(value % 5000);
+}
+
+
+static std::set<ROW_INDEX>
+scan_rows(ITable& table, const FIELD_INDEX field, const DText& min, const DText& max)
+{
+  std::set<ROW_INDEX> result;
+
+  for (ROW_INDEX row = 0; row < table.AllocatedRows(); ++row)
+  {
+    DText value;
+    table.Get(row, field, value);
+
+    if ((min <= value) && (value <= max))
+      result.insert(row);
+  }
+
+  return result;
+}
+
+
+static bool
+same_matches(ITable& table, const FIELD_INDEX field, const std::string& min, const std::string& max)
+{
+  const DText minText(min.c_str());
+  const DText maxText(max.c_str());
+
+  const std::set<ROW_INDEX> expected = scan_rows(table, field, minText, maxText);
+  const RowsSet set = table.MatchRowsSet(minText, maxText, 0, TABLE_ROWS, field);
+  const DArray array = table.MatchRows(minText, maxText, 0, TABLE_ROWS, field);
+
+  if ((set.Count() != expected.size()) || (array.Count() != expected.size()))
+    return false;
+
+  for (auto row : expected)
+  {
+    if ( ! set.Contains(row))
+      return false;
+  }
+
+  return true;
+}
+
+
+static bool
+check_ranges(ITable& table, const FIELD_INDEX field)
+{
+  const std::string longName = long_prefix + std::to_string(1234);
+
+  bool result = true;
+
+  result = result && same_matches(table, field, "sku1", "sku5");
+  result = result && same_matches(table, field, "sku999", "sku999");
+  result = result && same_matches(table, field, "m\xC4\x83r1", "m\xC4\x83r2");
+  result = result && same_matches(table, field, longName, longName);
+  result = result && same_matches(table, field, long_prefix + std::string("2"), long_prefix + std::string("3"));
+  result = result && same_matches(table, field, "a", "z");
+  result = result && same_matches(table, field, "sku5", "sku1");
+
+  return result;
+}
+
+
+static bool
+test_text_index(ITable& table)
+{
+  std::cout << "Test matching the rows of an indexed text field ... ";
+
+  const FIELD_INDEX nameField = table.RetrieveField("name");
+  const FIELD_INDEX idField = table.RetrieveField("id");
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS / 2; ++row)
+  {
+    const uint_t value = wh_rnd() % 100000;
+
+    table.AddRow();
+    table.Set(row, nameField, DText(row_name(value).c_str()));
+    table.Set(row, idField, DUInt32(value));
+  }
+
+  bool result = check_ranges(table, nameField);
+
+  table.CreateIndex(nameField, nullptr, nullptr);
+  result = result && check_ranges(table, nameField);
+
+  //The index is kept up to date with the rows added or changed after it.
+  for (ROW_INDEX row = TABLE_ROWS / 2; row < TABLE_ROWS; ++row)
+  {
+    const uint_t value = wh_rnd() % 100000;
+
+    table.Set(row, nameField, DText(row_name(value).c_str()));
+    table.Set(row, idField, DUInt32(value));
+  }
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; row += 7)
+    table.Set(row, nameField, DText(row_name(wh_rnd() % 100000).c_str()));
+
+  result = result && check_ranges(table, nameField);
+
+  table.Sort(idField, 0, TABLE_ROWS - 1, false);
+  result = result && check_ranges(table, nameField);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+
+    success = success && test_text_index(table);
+
+    dbs.ReleaseTable(table);
+    dbs.DeleteTable(table_name);
+    DBSReleaseDatabase(dbs);
+  }
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
@@ -0,0 +1,238 @@
+#include <assert.h>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "utils/wrandom.h"
+#include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
+#include "dbs/dbs_rowsset.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "../pastra/ps_templatetable.h"
+
+using namespace whais;
+using namespace pastra;
+
+
+static const char db_name[] = "t_trigramindex_db";
+static const char table_name[] = "t_trigramindex_table";
+
+static const ROW_INDEX TABLE_ROWS = 10000;
+
+static const char* const words[] = {
+                                     "Alpha", "bravo", "CHARLIE", "delta",
+                                     "Echo", "foxtrot", "golf", "Hotel",
+                                     "india", "JULIETT", "kilo", "lima",
+                                     "\xC8\x98osea", "\xC8\x99oseaua", "a", "xy"
+                                   };
+
+static const char* const searches[] = {
+                                        "alpha", "ALPHA", "ech", "o g",
+                                        "charlie delta", "lima kilo", "a",
+                                        "xy", "x", "ot", "\xC8\x99osea",
+                                        "Hotel india", "zulu", "JULIETT "
+                                      };
+
+
+static DBSFieldDescriptor field_descs[] = {
+                                            {"id", T_UINT32, false},
+                                            {"name", T_TEXT, false}
+                                          };
+
+
+static std::string
+random_name()
+{
+  const uint_t wordsCount = wh_rnd() % 6;
+  std::string result;
+
+  for (uint_t w = 0; w < wordsCount; ++w)
+  {
+    if (w > 0)
+      result += ' ';
+
+    result += words[wh_rnd() % (sizeof words / sizeof words[0])];
+  }
+
+  return result;
+}
+
+
+static bool
+same_matches(ITable& table,
+             const DText& substring,
+             const bool ignoreCase,
+             const ROW_INDEX fromRow,
+             const ROW_INDEX toRow)
+{
+  const FIELD_INDEX field = table.RetrieveField("name");
+  std::set<ROW_INDEX> expected;
+
+  for (ROW_INDEX row = fromRow; (row <= toRow) && (row < table.AllocatedRows()); ++row)
+  {
+    DText value;
+    table.Get(row, field, value);
+
+    if ( ! value.IsNull()
+        && ! _CC(DText&, substring).FindInText(value, ignoreCase).IsNull())
+    {
+      expected.insert(row);
+    }
+  }
+
+  const RowsSet found = table.MatchTextRows(substring, ignoreCase, fromRow, toRow, field);
+  if (found.Count() != expected.size())
+    return false;
+
+  for (auto row : expected)
+  {
+    if ( ! found.Contains(row))
+      return false;
+  }
+
+  return true;
+}
+
+
+static bool
+check_matches(ITable& table)
+{
+  const ROW_INDEX lastRow = table.AllocatedRows() - 1;
+  bool result = true;
+
+  for (uint_t s = 0; result && (s < sizeof searches / sizeof searches[0]); ++s)
+  {
+    const DText substring(searches[s]);
+
+    result = same_matches(table, substring, true, 0, lastRow)
+             && same_matches(table, substring, false, 0, lastRow)
+             && same_matches(table, substring, true, 1000, 7000);
+  }
+
+  return result;
+}
+
+
+static void
+set_row(ITable& table, const ROW_INDEX row)
+{
+  table.Set(row, table.RetrieveField("id"), DUInt32(wh_rnd() % 100000));
+  table.Set(row, table.RetrieveField("name"), DText(random_name().c_str()));
+}
+
+
+static bool
+test_trigram_index(ITable& table)
+{
+  std::cout << "Test searching the substrings of a trigram indexed field ... ";
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS / 2; ++row)
+  {
+    table.AddRow();
+    set_row(table, row);
+  }
+
+  //The rows are searched without an index too.
+  bool result = check_matches(table);
+
+  table.CreateIndex(table.RetrieveField("name"), nullptr, nullptr, INDEX_TRIGRAM);
+
+  result = result && table.IsIndexed(table.RetrieveField("name"));
+  result = result && check_matches(table);
+
+  for (ROW_INDEX row = TABLE_ROWS / 2; row < TABLE_ROWS; ++row)
+    table.AddRow();
+
+  for (ROW_INDEX row = TABLE_ROWS / 2; row < TABLE_ROWS; row += 2)
+    set_row(table, row);
+
+  for (ROW_INDEX row = 0; row < TABLE_ROWS; row += 7)
+    set_row(table, row);
+
+  result = result && check_matches(table);
+
+  table.Sort(table.RetrieveField("id"), 0, TABLE_ROWS - 1, false);
+  result = result && check_matches(table);
+
+  try
+  {
+    table.CreateIndex(table.RetrieveField("id"), nullptr, nullptr, INDEX_TRIGRAM);
+    result = false;
+  }
+  catch (DBSException& e)
+  {
+    result = result && (e.Code() == DBSException::FIELD_TYPE_INVALID);
+  }
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+static bool
+test_trigram_index_reload(ITable& table)
+{
+  std::cout << "Test the trigram index of a reopened table ... ";
+
+  bool result = check_matches(table);
+
+  for (ROW_INDEX row = 1; row < TABLE_ROWS; row += 5)
+    set_row(table, row);
+
+  result = result && check_matches(table);
+
+  const FIELD_INDEX nameField = table.RetrieveField("name");
+
+  table.RemoveIndex(nameField);
+  result = result && ! table.IsIndexed(nameField);
+  result = result && check_matches(table);
+
+  std::cout << (result ? "OK" : "FAIL") << std::endl;
+  return result;
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(db_name);
+  {
+    IDBSHandler& dbs = DBSRetrieveDatabase(db_name);
+    dbs.AddTable(table_name, sizeof field_descs / sizeof field_descs[0], field_descs);
+
+    ITable& table = dbs.RetrievePersistentTable(table_name);
+    success = success && test_trigram_index(table);
+    dbs.ReleaseTable(table);
+
+    ITable& reopened = dbs.RetrievePersistentTable(table_name);
+    success = success && test_trigram_index_reload(reopened);
+    dbs.ReleaseTable(reopened);
+
+    dbs.DeleteTable(table_name);
+    DBSReleaseDatabase(dbs);
+  }
+
+  DBSRemoveDatabase(db_name);
+  DBSShoutdown();
+
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
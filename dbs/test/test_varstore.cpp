@@ -24,6 +24,7 @@ static uint8_t pattern2[503];
 static uint8_t pattern3[0x1001F7];
 
 static uint64_t firstEntries[3];
+static uint64_t storeSize;
 
 #define TEST_UNIT_MAX_SIZE              105000
 
@@ -100,6 +101,7 @@ bool test_record_create()
       }
 
     storage.Flush();
+    storeSize = storage.Size();
   }
 
   if (result)
@@ -107,12 +109,8 @@ bool test_record_create()
       std::string temp_file_base = DBSGetSeettings().mWorkDir;
       temp_file_base += "t_ps_varstore";
 
-      uint_t storageSize = sizeof pattern1 + sizeof pattern2 + sizeof pattern3;
-
-      storageSize = ((storageSize + 47 ) /48) * 64;
-
       VariableSizeStore storage;
-      storage.Init(temp_file_base.c_str(), storageSize, TEST_UNIT_MAX_SIZE);
+      storage.Init(temp_file_base.c_str(), storeSize, TEST_UNIT_MAX_SIZE);
 
       if (test_record(&storage, pattern3, 61, firstEntries[2], sizeof pattern3) == false)
         result = false;
@@ -122,6 +120,7 @@ bool test_record_create()
         result = false;
 
       storage.Flush();
+      storeSize = storage.Size();
     }
 
   std::cout << ( result ? "OK" : "FALSE") << std::endl;
@@ -140,12 +139,8 @@ test_record_removal()
     std::string temp_file_base = DBSGetSeettings().mWorkDir;
     temp_file_base += "t_ps_varstore";
 
-    uint_t storageSize = sizeof pattern1 + sizeof pattern2 + sizeof pattern3;
-
-    storageSize = ((storageSize + 47 ) /48) * 64;
-
     VariableSizeStore storage;
-    storage.Init(temp_file_base.c_str(), storageSize, TEST_UNIT_MAX_SIZE);
+    storage.Init(temp_file_base.c_str(), storeSize, TEST_UNIT_MAX_SIZE);
 
     if (result)
       {
@@ -166,6 +161,7 @@ test_record_removal()
       }
 
     storage.Flush();
+    storeSize = storage.Size();
   }
 
   if (result)
@@ -173,17 +169,14 @@ test_record_removal()
       std::string temp_file_base = DBSGetSeettings().mWorkDir;
       temp_file_base += "t_ps_varstore";
 
-      uint_t storageSize = sizeof pattern1 + sizeof pattern2 + sizeof pattern3;
-
-      storageSize = ((storageSize + 47 ) /48) * 64;
-
       VariableSizeStore storage;
-      storage.Init(temp_file_base.c_str(), storageSize, TEST_UNIT_MAX_SIZE);
+      storage.Init(temp_file_base.c_str(), storeSize, TEST_UNIT_MAX_SIZE);
 
       if (test_record(&storage, pattern3, 61, firstEntries[2], sizeof pattern3) == false)
         result = false;
 
       storage.Flush();
+      storeSize = storage.Size();
     }
 
   std::cout << ( result ? "OK" : "FALSE") << std::endl;
@@ -200,12 +193,8 @@ bool test_record_update()
     std::string temp_file_base = DBSGetSeettings().mWorkDir;
     temp_file_base += "t_ps_varstore";
 
-    uint_t storageSize = sizeof pattern1 + sizeof pattern2 + sizeof pattern3;
-
-    storageSize = ((storageSize + 47 ) /48) * 64;
-
     VariableSizeStore storage;
-    storage.Init(temp_file_base.c_str(), storageSize, TEST_UNIT_MAX_SIZE);
+    storage.Init(temp_file_base.c_str(), storeSize, TEST_UNIT_MAX_SIZE);
 
     if (result)
       {
@@ -232,6 +221,7 @@ bool test_record_update()
       }
 
     storage.Flush();
+    storeSize = storage.Size();
   }
 
   if (result)
@@ -239,12 +229,8 @@ bool test_record_update()
       std::string temp_file_base = DBSGetSeettings().mWorkDir;
       temp_file_base += "t_ps_varstore";
 
-      uint_t storageSize = sizeof pattern1 + sizeof pattern2 + sizeof pattern3;
-
-      storageSize = ((storageSize + 47 ) /48) * 64;
-
       VariableSizeStore storage;
-      storage.Init(temp_file_base.c_str(), storageSize, TEST_UNIT_MAX_SIZE);
+      storage.Init(temp_file_base.c_str(), storeSize, TEST_UNIT_MAX_SIZE);
       storage.MarkForRemoval();
 
       init_pattern(pattern3, sizeof pattern3, 21);
@@ -256,6 +242,7 @@ bool test_record_update()
         result = false;
 
       storage.Flush();
+      storeSize = storage.Size();
     }
 
   std::cout << ( result ? "OK" : "FALSE") << std::endl;
@@ -396,6 +383,143 @@ test_record_record_update()
 }
 
 
+bool
+test_free_space_reuse()
+{
+  bool result = true;
+  std::cout << "Testing the reuse of the removed records space ... ";
+
+  std::string temp_file_base = DBSGetSeettings().mWorkDir;
+  temp_file_base += "t_ps_varstore";
+
+  VariableSizeStore storage;
+  storage.Init(temp_file_base.c_str(), 0, TEST_UNIT_MAX_SIZE);
+  storage.MarkForRemoval();
+
+  uint64_t records[64];
+  const uint_t recordsCount = sizeof records / sizeof records[0];
+  const uint_t recordSize = 2 * VariableSizeStore::UNIT_SIZE - StoreExtent::HEADER_SIZE;
+
+  init_pattern(pattern3, recordSize, 7);
+  for (uint_t i = 0; i < recordsCount; ++i)
+    records[i] = storage.AddRecord(pattern3, recordSize);
+
+  const uint64_t sizeBefore = storage.Size();
+
+  //Remove them out of order, so the freed space has to be merged both ways.
+  for (uint_t i = 0; i < recordsCount; i += 2)
+    storage.DecrementRecordRef(records[i]);
+
+  for (uint_t i = 1; i < recordsCount; i += 2)
+    storage.DecrementRecordRef(records[i]);
+
+  const uint_t bigSize = recordsCount * 2 * VariableSizeStore::UNIT_SIZE
+                         - StoreExtent::HEADER_SIZE;
+
+  init_pattern(pattern3, bigSize, 17);
+  const uint64_t bigRecord = storage.AddRecord(pattern3, bigSize);
+
+  if ((storage.Size() != sizeBefore)
+      || ! test_record(&storage, pattern3, 17, bigRecord, bigSize))
+  {
+    result = false;
+  }
+
+  //A record appended to should keep its content.
+  const uint64_t first = storage.AddRecord(pattern1, sizeof pattern1);
+  const uint64_t second = storage.AddRecord(pattern1, sizeof pattern1);
+
+  init_pattern(pattern2, sizeof pattern2, 3);
+  storage.UpdateRecord(first, 0, sizeof pattern2, pattern2);
+
+  if ( ! test_record(&storage, pattern2, 3, first, sizeof pattern2)
+      || ! test_record(&storage, pattern3, 17, bigRecord, bigSize))
+  {
+    result = false;
+  }
+
+  init_pattern(pattern1, sizeof pattern1, 5);
+  storage.UpdateRecord(second, 0, sizeof pattern1, pattern1);
+  if ( ! test_record(&storage, pattern1, 5, second, sizeof pattern1))
+    result = false;
+
+  storage.Flush();
+
+  std::cout << ( result ? "OK" : "FALSE") << std::endl;
+  return result;
+}
+
+
+static void
+write_legacy_entry(TemporalContainer& container,
+                   const uint64_t entry,
+                   const uint64_t next,
+                   const bool first,
+                   const uint8_t* const data)
+{
+  uint8_t raw[64];
+
+  memset(raw, 0xFF, sizeof raw);
+  store_le_int64(next | (first ? 0x4000000000000000ull : 0), raw + 8);
+  memcpy(raw + 16, data, 48);
+
+  container.Write(entry * sizeof raw, sizeof raw, raw);
+}
+
+
+bool
+test_legacy_import()
+{
+  bool result = true;
+  std::cout << "Testing the import of the records of the previous format ... ";
+
+  const uint64_t LAST_ENTRY = 0x0FFFFFFFFFFFFFFFull;
+
+  TemporalContainer legacy(4096);
+  uint8_t data[4 * 48];
+
+  init_pattern(data, sizeof data, 23);
+
+  write_legacy_entry(legacy, 0, LAST_ENTRY, false, data);
+  write_legacy_entry(legacy, 1, 3, true, data);
+  write_legacy_entry(legacy, 2, LAST_ENTRY, false, data + 96);
+  write_legacy_entry(legacy, 3, 2, false, data + 48);
+
+  std::string temp_file_base = DBSGetSeettings().mWorkDir;
+  temp_file_base += "t_ps_varstore";
+
+  VariableSizeStore storage;
+  storage.Init(temp_file_base.c_str(), 0, TEST_UNIT_MAX_SIZE);
+  storage.MarkForRemoval();
+
+  const uint64_t recordSize = 130;
+  const uint64_t record = storage.ImportLegacyRecord(legacy, 1, recordSize);
+
+  uint8_t temp[130];
+  memset(temp, 0, sizeof temp);
+
+  if (record == 0)
+    result = false;
+
+  else
+  {
+    storage.GetRecord(record, 0, recordSize, temp);
+    result = test_pattern(temp, recordSize, 23);
+  }
+
+  //Neither a record starting in the middle of a chain, nor one bigger than
+  //its chain could be imported.
+  result = result
+           && (storage.ImportLegacyRecord(legacy, 3, 50) == 0)
+           && (storage.ImportLegacyRecord(legacy, 1, 3 * 48 + 1) == 0)
+           && (storage.ImportLegacyRecord(legacy, 7, 10) == 0);
+
+  storage.Flush();
+
+  std::cout << ( result ? "OK" : "FALSE") << std::endl;
+  return result;
+}
+
 
 int
 main()
@@ -409,6 +533,8 @@ main()
   success = success && test_record_update();
   success = success && test_record_container_update();
   success = success && test_record_record_update();
+  success = success && test_free_space_reuse();
+  success = success && test_legacy_import();
 
   DBSShoutdown();
 
@@ -8,6 +8,7 @@
 #include <assert.h>
 #include <memory.h>
 #include <iostream>
+#include <vector>
 
 #include "dbs/dbs_mgr.h"
 #include "utils/wrandom.h"
@@ -97,6 +98,86 @@ colapse_container(uint_t max_file_size, const uint_t container_size)
   return new_container_size;
 }
 
+static bool
+same_content(IDataContainer& container, const std::vector<uint8_t>& expected)
+{
+  if (container.Size() != expected.size())
+    return false;
+
+  std::vector<uint8_t> content(expected.size());
+  container.Read(0, content.size(), content.data());
+
+  return content == expected;
+}
+
+static bool
+same_files_content(const uint_t max_file_size, const std::vector<uint8_t>& expected)
+{
+  FileContainer files(fileName,
+                      max_file_size,
+                      (expected.size() + max_file_size - 1) / max_file_size,
+                      false);
+
+  return same_content(files, expected);
+}
+
+static bool
+check_staged_container(const uint_t max_file_size)
+{
+  std::vector<uint8_t> expected(max_file_size + 100, 1);
+  {
+    FileContainer container(fileName, max_file_size, 0, true);
+    container.Write(0, expected.size(), expected.data());
+  }
+
+  const std::vector<uint8_t> initial = expected;
+  FileContainer container(fileName, max_file_size, 2, false);
+
+  container.StageWrites(true);
+
+  memset(buffer, 2, sizeof buffer);
+  container.Write(max_file_size - 10, 20, buffer);
+  memset(&expected[max_file_size - 10], 2, 20);
+
+  memset(buffer, 3, sizeof buffer);
+  container.Write(container.Size(), sizeof buffer, buffer);
+  expected.insert(expected.end(), buffer, buffer + sizeof buffer);
+
+  container.Colapse(10, 30);
+  expected.erase(expected.begin() + 10, expected.begin() + 30);
+
+  container.Colapse(container.Size() - 50, container.Size());
+  expected.resize(expected.size() - 50);
+
+  container.StageWrites(false);
+
+  //What is staged is read back, but it does not reach the files yet.
+  bool result = same_content(container, expected)
+                && same_files_content(max_file_size, initial);
+
+  container.WriteStaged();
+  result = result && same_files_content(max_file_size, expected);
+
+  //A write not staged lets the staged ones go first.
+  container.StageWrites(true);
+
+  memset(buffer, 4, sizeof buffer);
+  container.Write(0, 10, buffer);
+  memset(&expected[0], 4, 10);
+
+  container.StageWrites(false);
+
+  memset(buffer, 5, sizeof buffer);
+  container.Write(5, 10, buffer);
+  memset(&expected[5], 5, 10);
+
+  result = result && same_files_content(max_file_size, expected);
+
+  container.MarkForRemoval();
+
+  return result;
+}
+
 static bool
 check_temp_container(uint_t uTestContainerSize)
 {
@@ -187,6 +268,9 @@ main()
     new_container_size = colapse_container(max_file_size,
                                             new_container_size);
 
+  if (!check_staged_container(max_file_size))
+    success = false;
+
   if (!check_temp_container(760))
     success = false;
 
@@ -10,7 +10,10 @@ wpastra_SRC:=pastra/ps_values.cpp pastra/ps_container.cpp pastra/ps_table.cpp\
 		   	pastra/ps_dbsmgr.cpp pastra/ps_serializer.cpp pastra/ps_varstorage.cpp\
 		   	pastra/ps_blockcache.cpp pastra/ps_textstrategy.cpp pastra/ps_arraystrategy.cpp\
 		   	pastra/ps_btree_index.cpp pastra/ps_btree_fields.cpp pastra/ps_templatetable.cpp\
-		   	pastra/ps_exception.cpp pastra/ps_valtranslator.cpp
+		   	pastra/ps_exception.cpp pastra/ps_valtranslator.cpp pastra/ps_redolog.cpp\
+		   	pastra/ps_sortkeys.cpp pastra/ps_loader.cpp pastra/ps_exporter.cpp\
+		   	pastra/ps_rowsset.cpp pastra/ps_fieldstats.cpp pastra/ps_hashindex.cpp \
+		   	pastra/ps_bitmapindex.cpp pastra/ps_compositekey.cpp
 
 wpastra_cmn_DEF:=WVER_MAJ=1 WVER_MIN=0
 wpastra_DEF:=USE_CUSTOM_SHL USE_DBS_SHL DBS_EXPORTING $(wpastra_cmn_DEF)
@@ -73,9 +73,25 @@ class TableFilterRunnerRule
 public:
   virtual ~TableFilterRunnerRule() = default;
 
-  virtual DArray MatchRows(const DArray& rowsSet) = 0;
-  virtual bool   RowIsMatching(const ITable& table, ROW_INDEX row) = 0;
-  virtual bool   IsSearchIndexed() const = 0;
+  virtual RowsSet  MatchRows(const RowsSet& rowsSet) = 0;
+  virtual bool     RowIsMatching(const ITable& table, ROW_INDEX row) = 0;
+  virtual bool     IsSearchIndexed() const = 0;
+
+  //The count of the table's rows expected to match, based on the statistics
+  //of the rule's field.
+  virtual uint64_t EstimateMatches() = 0;
+
+  virtual FIELD_INDEX Field() const = 0;
+
+  //The rule's values are single values and no ranges of values.
+  virtual bool     MatchesSingleValues() = 0;
+
+  //Extend the bounds of the composite keys with the rule's values, giving
+  //for each pair a pair per values interval. Returns false, leaving them
+  //unchanged, if there would be more than the maximum count of pairs.
+  virtual bool     ExtendCompositeKeys(
+                      std::vector<std::tuple<CompositeKey, CompositeKey>>& keys,
+                      const size_t                                        maxKeys) = 0;
 };
 
 class TableFilterRunner
@@ -87,6 +103,7 @@ public:
   bool AddFilterRules(TableFieldValuesFilter& filter);
 
   DArray Run();
+  RowsSet RunRowsSet();
 
   void ResetRowsFilter();
   void ResetFilterRules();
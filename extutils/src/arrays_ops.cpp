@@ -7,12 +7,19 @@
 
 #include "arrays_ops.h"
 
+#include <algorithm>
 #include <cassert>
+#include <vector>
 
 #include "ext_exception.h"
 
 using namespace whais;
 
+//The elements are moved in chunks through contiguous buffers, rather than one
+//at a time.
+static const uint_t ARRAY_CHUNK_SIZE = 256;
+
+
 template<typename T>
 DArray array_get_uniques_helper(const DArray& array)
 {
@@ -20,16 +27,25 @@ DArray array_get_uniques_helper(const DArray& array)
 
   temp.Sort();
   const auto count = temp.Count();
+
+  T values[ARRAY_CHUNK_SIZE];
   T lastValue;
-  for (uint64_t i = 0; i < count; ++i)
+  for (uint64_t i = 0; i < count; i += ARRAY_CHUNK_SIZE)
   {
-    T value;
-    temp.Get(i, value);
-    if (value == lastValue)
-      continue;
+    const auto chunkCount = temp.Get(i, ARRAY_CHUNK_SIZE, values);
+
+    uint_t uniques = 0;
+    for (uint_t j = 0; j < chunkCount; ++j)
+    {
+      if (values[j] == lastValue)
+        continue;
+
+      lastValue = values[j];
+      values[uniques++] = lastValue;
+    }
 
-    lastValue = value;
-    result.Add(lastValue);
+    if (uniques > 0)
+      result.Add(values, uniques);
   }
 
   return result;
@@ -40,12 +56,13 @@ DArray array_unite_helper(const DArray& ar1, const DArray& ar2)
 {
   DArray result = ar1;
 
+  T values[ARRAY_CHUNK_SIZE];
+
   const auto count = ar2.Count();
-  for (uint64_t i = 0; i < count; ++i)
+  for (uint64_t i = 0; i < count; i += ARRAY_CHUNK_SIZE)
   {
-    T value;
-    ar2.Get(i, value);
-    result.Add(value);
+    const auto chunkCount = ar2.Get(i, ARRAY_CHUNK_SIZE, values);
+    result.Add(values, chunkCount);
   }
 
   return result;
@@ -69,14 +86,28 @@ DArray array_intersect_helper(const DArray& ar1, const DArray& ar2)
   }
 
   lessCount.Sort();
+
+  //Keep the sorted elements in memory, so the binary searches do not have to
+  //go through the array for every probe.
+  std::vector<T> sorted(lessCount.Count());
+  lessCount.Get(0, sorted.size(), sorted.data());
+
+  T values[ARRAY_CHUNK_SIZE];
+
   const auto count = second.Count();
-  for (uint64_t i = 0; i < count; ++i)
+  for (uint64_t i = 0; i < count; i += ARRAY_CHUNK_SIZE)
   {
-    T value;
-    second.Get(i, value);
+    const auto chunkCount = second.Get(i, ARRAY_CHUNK_SIZE, values);
+
+    uint_t matches = 0;
+    for (uint_t j = 0; j < chunkCount; ++j)
+    {
+      if (std::binary_search(sorted.begin(), sorted.end(), values[j]))
+        values[matches++] = values[j];
+    }
 
-    if (find_in_sorted_array(lessCount, value) >= 0)
-      result.Add(value);
+    if (matches > 0)
+      result.Add(values, matches);
   }
 
   return result;
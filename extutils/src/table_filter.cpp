@@ -24,15 +24,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "../include/table_filter.h"
 
+#include <algorithm>
 #include <memory>
 
 #include "dbs/dbs_valtranslator.h"
 #include "ext_exception.h"
-#include "arrays_ops.h"
 
 using namespace whais;
 using namespace std;
 
+
+//The rows of a set are visited in chunks of this size.
+static const uint_t ROWS_CHUNK_SIZE = 256;
+
+
 template<typename T>
 T operator+ (const T& op, int i)
 {
@@ -465,35 +470,45 @@ public:
 
   ~TableFilterRunnerFieldRule() = default;
 
-  DArray MatchRows(const DArray& rowsSet) override
+  RowsSet MatchRows(const RowsSet& rowsSet) override
   {
-    DArray result;
+    RowsSet result;
 
     BuildValuesIntervals();
     if ( ! IsSearchIndexed())
     {
-      ROW_INDEX rowsCount = rowsSet.Count();
-      for (ROW_INDEX i = 0; i < rowsCount; ++i)
+      ROW_INDEX rows[ROWS_CHUNK_SIZE];
+
+      uint_t count;
+      ROW_INDEX from = 0;
+      while ((count = rowsSet.Fetch(from, ROWS_CHUNK_SIZE, rows)) > 0)
       {
-        DUInt32 row;
-        if (RowIsMatching(mTable, row.mValue))
-          result.Add(row);
+        for (uint_t i = 0; i < count; ++i)
+        {
+          if (RowIsMatching(mTable, rows[i]))
+            result.Add(rows[i]);
+        }
+        from = rows[count - 1] + 1;
       }
-      result.Sort();
       return result;
     }
 
+    if (rowsSet.IsEmpty())
+      return result;
+
+    const ROW_INDEX fromRow = rowsSet.Next(0);
+    const ROW_INDEX toRow = rowsSet.Last();
     for (auto entry = mValues.begin(); entry != mValues.end(); ++entry)
     {
-      DArray entryMatches = mTable.MatchRows(get<0>(*entry),
-                                             get<1>(*entry),
-                                             0,
-                                             mTable.AllocatedRows(),
-                                             mField);
-      result = array_unite(result, entryMatches);
+      result.Unite(mTable.MatchRowsSet(get<0>(*entry),
+                                       get<1>(*entry),
+                                       fromRow,
+                                       toRow,
+                                       mField));
     }
 
-    return array_intersect(rowsSet, result);
+    result.Intersect(rowsSet);
+    return result;
   }
 
   bool RowIsMatching(const ITable& table, ROW_INDEX row) override
@@ -515,6 +530,97 @@ public:
     return mTable.IsIndexed(mField);
   }
 
+  FIELD_INDEX Field() const override
+  {
+    return mField;
+  }
+
+  bool MatchesSingleValues() override
+  {
+    BuildValuesIntervals();
+    for (auto entry = mValues.cbegin(); entry != mValues.cend(); ++entry)
+    {
+      if ( ! (get<0>(*entry) == get<1>(*entry)))
+        return false;
+    }
+    return true;
+  }
+
+  bool ExtendCompositeKeys(vector<tuple<CompositeKey, CompositeKey>>& keys,
+                           const size_t                               maxKeys) override
+  {
+    BuildValuesIntervals();
+    if (keys.size() * mValues.size() > maxKeys)
+      return false;
+
+    vector<tuple<CompositeKey, CompositeKey>> result;
+    for (const auto& key : keys)
+    {
+      for (auto entry = mValues.cbegin(); entry != mValues.cend(); ++entry)
+      {
+        CompositeKey from = get<0>(key), to = get<1>(key);
+
+        from.Add(get<0>(*entry));
+        to.Add(get<1>(*entry));
+        result.push_back(make_tuple(from, to));
+      }
+    }
+
+    keys.swap(result);
+    return true;
+  }
+
+  uint64_t EstimateMatches() override
+  {
+    const DBSFieldStats stats = mTable.GetFieldStats(mField);
+
+    BuildValuesIntervals();
+    if (stats.mHistogram.empty())
+      return stats.mRowsCount;
+
+    vector<T> bounds;
+    for (const auto& text : stats.mHistogram)
+    {
+      T bound;
+      Utf8Translator::Read(_RC(const uint8_t*, text.c_str()), text.length(), &bound);
+      bounds.push_back(bound);
+    }
+
+    const uint64_t valuesCount = stats.mRowsCount - stats.mNullsCount;
+    const double bucketRows = _SC(double, valuesCount) / bounds.size();
+
+    double result = 0;
+    for (auto entry = mValues.cbegin(); entry != mValues.cend(); ++entry)
+    {
+      const T& from = get<0>(*entry);
+      const T& to = get<1>(*entry);
+
+      if (from.IsNull())
+        result += stats.mNullsCount;
+
+      //A bucket holds the values bigger than its predecessor's bound.
+      uint_t buckets = 0;
+      for (size_t b = 0; b < bounds.size(); ++b)
+      {
+        if ((from <= bounds[b]) && ((b == 0) || (bounds[b - 1] < to)))
+          ++buckets;
+      }
+
+      if (buckets == 0)
+        continue;
+
+      else if (from == to)
+      {
+        result += MIN(buckets * bucketRows,
+                      _SC(double, valuesCount) / MAX(stats.mDistinctCount, 1));
+      }
+      else
+        result += (buckets - 0.5) * bucketRows;
+    }
+
+    return MIN(_SC(uint64_t, result + 0.5), stats.mRowsCount);
+  }
+
   void AddValues (const string& from, const string& to)
   {
     T first, last;
@@ -911,9 +1017,106 @@ TableFilterRunner::ResetFilterRules()
 
 DArray
 TableFilterRunner::Run()
+{
+  return RunRowsSet().ToArray();
+}
+
+
+/* Look for the composite index which serves at once the most rules, those of
+ * its leading fields. The rules before the last one covered must match single
+ * values, as a range of values of a field leaves the next fields unordered.
+ * Returns the covered rules, and no rules if no index is worth probing. */
+static vector<TableFilterRunnerRule*>
+match_composite_index(ITable&                                                 table,
+                      const vector<tuple<uint64_t, TableFilterRunnerRule*>>&  rules,
+                      RowsSet&                                                rows)
+{
+  //Every values interval of the covered rules multiplies the probed ranges.
+  static const size_t MAX_COMPOSITE_KEYS = 64;
+
+  vector<TableFilterRunnerRule*> bestRules;
+  vector<FIELD_INDEX> bestFields;
+  vector<tuple<CompositeKey, CompositeKey>> bestKeys;
+
+  for (const auto& fields : table.CompositeIndexes())
+  {
+    vector<TableFilterRunnerRule*> covered;
+    vector<tuple<CompositeKey, CompositeKey>> keys(1);
+    uint64_t estimate = rows.Count();
+
+    for (auto field : fields)
+    {
+      TableFilterRunnerRule* fieldRule = nullptr;
+      for (const auto& rule : rules)
+      {
+        if (get<1>(rule)->Field() == field)
+        {
+          fieldRule = get<1>(rule);
+          estimate = MIN(estimate, get<0>(rule));
+          break;
+        }
+      }
+
+      if ((fieldRule == nullptr) || ! fieldRule->ExtendCompositeKeys(keys, MAX_COMPOSITE_KEYS))
+        break;
+
+      covered.push_back(fieldRule);
+      if ( ! fieldRule->MatchesSingleValues())
+        break;
+    }
+
+    //A single rule is better served by its field's own index, if any.
+    if (covered.empty()
+        || (estimate >= rows.Count())
+        || ((covered.size() == 1) && covered[0]->IsSearchIndexed())
+        || (covered.size() <= bestRules.size()))
+    {
+      continue;
+    }
+
+    bestRules = covered;
+    bestFields = fields;
+    bestKeys.swap(keys);
+  }
+
+  if (bestRules.empty() || rows.IsEmpty())
+    return vector<TableFilterRunnerRule*>();
+
+  const ROW_INDEX fromRow = rows.Next(0);
+  const ROW_INDEX toRow = rows.Last();
+
+  RowsSet result;
+  for (auto& key : bestKeys)
+  {
+    get<1>(key).MarkUpperBound();
+    result.Unite(table.MatchCompositeRows(bestFields.data(),
+                                          bestFields.size(),
+                                          get<0>(key),
+                                          get<1>(key),
+                                          fromRow,
+                                          toRow));
+  }
+
+  result.Intersect(rows);
+  rows = result;
+
+  return bestRules;
+}
+
+
+static bool
+less_estimated_matches(const tuple<uint64_t, TableFilterRunnerRule*>& rule1,
+                       const tuple<uint64_t, TableFilterRunnerRule*>& rule2)
+{
+  return get<0>(rule1) < get<0>(rule2);
+}
+
+
+RowsSet
+TableFilterRunner::RunRowsSet()
 {
   if (mTable.AllocatedRows() == 0)
-    return DArray();
+    return RowsSet();
 
   vector<tuple<ROW_INDEX, ROW_INDEX>> rowsIntervals;
   for (const auto& interval : mRowsIntervals)
@@ -925,45 +1128,55 @@ TableFilterRunner::Run()
   for (const auto& interval : mExcludedRowsIntervals)
     exclude_interval(rowsIntervals, get<0>(interval), get<1>(interval));
 
-  DArray result;
+  RowsSet result;
   for (const auto& interval : rowsIntervals)
-  {
-    for (ROW_INDEX row = get<0>(interval); row <= get<1>(interval); ++row)
-      result.Add(DUInt32(row));
-  }
+    result.Add(get<0>(interval), get<1>(interval));
+
+  vector<tuple<uint64_t, TableFilterRunnerRule*>> rules;
+  for (auto rule : mFilterRules)
+    rules.push_back(make_tuple(rule->EstimateMatches(), rule));
 
-  bool allIndexed = true;
-  for (size_t rulesUsed = 0; rulesUsed < mFilterRules.size(); ++rulesUsed)
+  //The most selective rules go first, so the next ones have less to check.
+  stable_sort(rules.begin(), rules.end(), less_estimated_matches);
+
+  const vector<TableFilterRunnerRule*> coveredRules = match_composite_index(mTable, rules, result);
+
+  vector<TableFilterRunnerRule*> checkedRules;
+  for (const auto& rule : rules)
   {
-    if (! mFilterRules[rulesUsed]->IsSearchIndexed())
-    {
-      allIndexed = false;
-      continue ;
-    }
-    result = mFilterRules[rulesUsed]->MatchRows(result);
+    if (find(coveredRules.begin(), coveredRules.end(), get<1>(rule)) != coveredRules.end())
+      continue;
+
+    //Probing an index costs about as much as the rows it finds, while
+    //checking a rule costs as much as the rows left to check.
+    if (get<1>(rule)->IsSearchIndexed() && (get<0>(rule) < result.Count()))
+      result = get<1>(rule)->MatchRows(result);
+
+    else
+      checkedRules.push_back(get<1>(rule));
   }
 
-  if (allIndexed)
+  if (checkedRules.empty())
     return result;
 
-  DArray temp = result;
-  result = DArray();
-  for (uint64_t rowIdx = 0; rowIdx < temp.Count(); ++rowIdx)
+  RowsSet matched;
+  ROW_INDEX rows[ROWS_CHUNK_SIZE];
+
+  uint_t count;
+  ROW_INDEX from = 0;
+  while ((count = result.Fetch(from, ROWS_CHUNK_SIZE, rows)) > 0)
   {
-    bool matches = true;
-    DUInt32 row;
-    temp.Get(rowIdx, row);
-    for (size_t rulesUsed = 0; (rulesUsed < mFilterRules.size()) && matches; ++rulesUsed)
+    for (uint_t i = 0; i < count; ++i)
     {
-      if (mFilterRules[rulesUsed]->IsSearchIndexed())
-        continue ;
-      matches &= mFilterRules[rulesUsed]->RowIsMatching(mTable, row.mValue);
-    }
+      bool matches = true;
+      for (size_t r = 0; (r < checkedRules.size()) && matches; ++r)
+        matches = checkedRules[r]->RowIsMatching(mTable, rows[i]);
 
-    if (matches)
-      result.Add(row);
+      if (matches)
+        matched.Add(rows[i]);
+    }
+    from = rows[count - 1] + 1;
   }
 
-  return result;
+  return matched;
 }
-
@@ -542,6 +542,57 @@ test_rows_filtering_indexes(ITable& table)
 }
 
 
+bool
+test_rows_filtering_composite(ITable& table)
+{
+  cout << "Testing rows selection (with a composite index) ..." ;
+
+  TableFieldValuesFilter filterInUse = filter;
+
+  filterInUse.AddValue("fuint32", T_UINT32, "8", "8", false);
+  filterInUse.AddValue("fuint32", T_UINT32, "10", "10", false);
+  filterInUse.AddValue("fuint32", T_UINT32, "", "", false);
+  filterInUse.AddValue("fint64", T_INT64, "2", "4", false);
+
+  TableFilterRunner filterRunner(table);
+  filterRunner.AddFilterRules(filterInUse);
+  filterRunner.ResetRowsFilter();
+
+  DArray reference = array_unite(uint64_2s, array_unite(uint64_3s, uint64_4s));
+  reference = array_intersect(array_unite(uint32_null, array_unite(uint32_8s, uint32_10s)),
+                              reference);
+
+  const FIELD_INDEX fields[] = {table.RetrieveField("fuint32"), table.RetrieveField("fint64")};
+  table.CreateCompositeIndex(fields, 2, nullptr, nullptr);
+
+  if (filterRunner.Run() != reference)
+  {
+    cout << "FAIL\n";
+    return false;
+  }
+
+  filterRunner.ResetFilterRules();
+  filterRunner.ResetRowsFilter();
+  filterRunner.AddFilterRules(filter);
+
+  const DArray filterRows = filterRunner.Run();
+
+  filterRunner.ResetFilterRules();
+  filterRunner.ResetRowsFilter();
+  filterRunner.AddFilterRules(filterInUse);
+  if (filterRunner.Run() != array_intersect(filterRows, reference))
+  {
+    cout << "FAIL\n";
+    return false;
+  }
+
+  table.RemoveCompositeIndex(fields, 2);
+
+  cout << "OK\n";
+  return true;
+}
+
+
 int
 main(int argc, char** argv)
 {
@@ -554,6 +605,7 @@ main(int argc, char** argv)
   success = success && test_prepare_filter_row();
   success = success && test_rows_selection(testTable);
   success = success && test_rows_filtering_no(testTable);
+  success = success && test_rows_filtering_composite(testTable);
   success = success && test_rows_filtering_indexes(testTable);
 
 
@@ -48,6 +48,27 @@ wh_lock_try_acquire(WH_LOCK* const lock,
 CUSTOM_SHL uint_t 
 wh_lock_release(WH_LOCK* const lock);
 
+CUSTOM_SHL uint_t 
+wh_cond_init(WH_COND* const cond);
+
+CUSTOM_SHL uint_t 
+wh_cond_destroy(WH_COND* const cond);
+
+CUSTOM_SHL uint_t 
+wh_cond_wait(WH_COND* const cond, WH_LOCK* const lock);
+
+CUSTOM_SHL uint_t 
+wh_cond_timed_wait(WH_COND* const  cond,
+                    WH_LOCK* const  lock,
+                    const uint_t    millisecs,
+                    bool_t* const   outTimeout);
+
+CUSTOM_SHL uint_t 
+wh_cond_signal(WH_COND* const cond);
+
+CUSTOM_SHL uint_t 
+wh_cond_broadcast(WH_COND* const cond);
+
 CUSTOM_SHL uint_t 
 wh_thread_create(WH_THREAD*                    outThread,
                   const WH_THREAD_ROUTINE       routine,
@@ -80,6 +101,12 @@ wh_atomic_fetch_inc64(volatile int64_t* const value);
 CUSTOM_SHL int64_t 
 wh_atomic_fetch_dec64(volatile int64_t* const value);
 
+CUSTOM_SHL int32_t 
+wh_atomic_fetch_or32(volatile int32_t* const value, const int32_t mask);
+
+CUSTOM_SHL int32_t 
+wh_atomic_fetch_and32(volatile int32_t* const value, const int32_t mask);
+
 
 #ifdef __cplusplus
 }
@@ -91,6 +91,7 @@ public:
 
     STACK_TOO_BIG,
     SERVER_STOPPED,
+    SYNC_WAIT_TIMEOUT,
 
     //The exception codes below this line cause an application stop.
     __CRITICAL_EXCEPTIONS,
@@ -162,6 +163,8 @@ public:
   static const uint_t MAX_PROCS_TMO           = 2;
   static const uint_t MAX_STACK_COUNT         = 3;
   static const uint_t MAX_PROCS_CALL_DEPTH    = 4;
+  static const uint_t JIT_CALLS_THRESHOLD     = 5;
+  static const uint_t SYNC_WAIT_TMO           = 6;
 
 protected:
 
@@ -148,6 +148,9 @@ InterException::Description() const
   case SERVER_STOPPED:
     return "Server was asked to stop.";
 
+  case SYNC_WAIT_TIMEOUT:
+    return "Timed out while waiting to acquire a procedure synchronized statement.";
+
   case ALREADY_INITED:
     return "Cannot initialize the interpreter as it was already initialized.";
 
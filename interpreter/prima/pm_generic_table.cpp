@@ -100,7 +100,8 @@ GenericTable::MarkRowForReuse(const ROW_INDEX)
 void
 GenericTable::CreateIndex(const FIELD_INDEX,
                            CREATE_INDEX_CALLBACK_FUNC* const,
-                           CreateIndexCallbackContext* const)
+                           CreateIndexCallbackContext* const,
+                           const DBS_INDEX_KIND)
 {
   throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
 }
@@ -120,6 +121,37 @@ GenericTable::IsIndexed(const FIELD_INDEX) const
 }
 
 
+void
+GenericTable::CreateCompositeIndex(const FIELD_INDEX* const,
+                                   const FIELD_INDEX,
+                                   CREATE_INDEX_CALLBACK_FUNC* const,
+                                   CreateIndexCallbackContext* const)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+void
+GenericTable::RemoveCompositeIndex(const FIELD_INDEX* const, const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+std::vector<std::vector<FIELD_INDEX>>
+GenericTable::CompositeIndexes()
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+void
+GenericTable::DeferIndexesUpdates(const bool)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
 void
 GenericTable::Set(const ROW_INDEX, const FIELD_INDEX, const DChar&, const bool)
 {
@@ -372,6 +404,43 @@ GenericTable::Sort(const FIELD_INDEX, const ROW_INDEX, const ROW_INDEX, const bo
 }
 
 
+void
+GenericTable::Sort(const FIELD_INDEX* const,
+                   const bool* const,
+                   const FIELD_INDEX,
+                   const ROW_INDEX,
+                   const ROW_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+ROW_INDEX
+GenericTable::LoadRows(const char* const,
+                       const DBS_LOAD_FORMAT,
+                       const FIELD_INDEX* const,
+                       const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+ROW_INDEX
+GenericTable::ExportRows(const char* const,
+                         const FIELD_INDEX* const,
+                         const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+DBSFieldStats
+GenericTable::GetFieldStats(const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
 DArray
 GenericTable::MatchRows(const DBool&,
                         const DBool&,
@@ -536,6 +605,238 @@ GenericTable::MatchRows(const DRichReal&,
   throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
 }
 
+
+DArray
+GenericTable::MatchRows(const DText&,
+                        const DText&,
+                        const ROW_INDEX,
+                        const ROW_INDEX,
+                        const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DBool&,
+                           const DBool&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DChar&,
+                           const DChar&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DDate&,
+                           const DDate&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DDateTime&,
+                           const DDateTime&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DHiresTime&,
+                           const DHiresTime&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DUInt8&,
+                           const DUInt8&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DUInt16&,
+                           const DUInt16&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DUInt32&,
+                           const DUInt32&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DUInt64&,
+                           const DUInt64&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DInt8&,
+                           const DInt8&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DInt16&,
+                           const DInt16&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DInt32&,
+                           const DInt32&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DInt64&,
+                           const DInt64&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DReal&,
+                           const DReal&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DRichReal&,
+                           const DRichReal&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchRowsSet(const DText&,
+                           const DText&,
+                           const ROW_INDEX,
+                           const ROW_INDEX,
+                           const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchTextRows(const DText&,
+                            const bool,
+                            const ROW_INDEX,
+                            const ROW_INDEX,
+                            const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+
+RowsSet
+GenericTable::MatchArrayRows(const DArray&,
+                             const bool,
+                             const ROW_INDEX,
+                             const ROW_INDEX,
+                             const FIELD_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+RowsSet
+GenericTable::MatchCompositeRows(const FIELD_INDEX* const,
+                                 const FIELD_INDEX,
+                                 const CompositeKey&,
+                                 const CompositeKey&,
+                                 const ROW_INDEX,
+                                 const ROW_INDEX)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
+uint_t
+GenericTable::FetchIndexEntries(const FIELD_INDEX,
+                                const DArray&,
+                                const ROW_INDEX,
+                                const bool,
+                                const uint_t,
+                                DArray&,
+                                DArray&)
+{
+  throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+}
+
 void
 GenericTable::Flush()
 {
@@ -51,9 +51,18 @@ public:
 
   virtual void CreateIndex(const FIELD_INDEX field,
                            CREATE_INDEX_CALLBACK_FUNC* const cbFunc,
-                           CreateIndexCallbackContext* const cbCotext);
+                           CreateIndexCallbackContext* const cbCotext,
+                           const DBS_INDEX_KIND kind) override;
   virtual void RemoveIndex(const FIELD_INDEX field) override;
   virtual bool IsIndexed(const FIELD_INDEX field) const override;
+  virtual void CreateCompositeIndex(const FIELD_INDEX* const fields,
+                                    const FIELD_INDEX fieldsCount,
+                                    CREATE_INDEX_CALLBACK_FUNC* const cbFunc,
+                                    CreateIndexCallbackContext* const cbCotext) override;
+  virtual void RemoveCompositeIndex(const FIELD_INDEX* const fields,
+                                    const FIELD_INDEX fieldsCount) override;
+  virtual std::vector<std::vector<FIELD_INDEX>> CompositeIndexes() override;
+  virtual void DeferIndexesUpdates(const bool defer) override;
 
   virtual void Set(const ROW_INDEX   row,
                    const FIELD_INDEX field,
@@ -233,6 +242,20 @@ public:
                     const ROW_INDEX from,
                     const ROW_INDEX to,
                     const bool reverse);
+  virtual void Sort(const FIELD_INDEX* const fields,
+                    const bool* const reverse,
+                    const FIELD_INDEX fieldsCount,
+                    const ROW_INDEX from,
+                    const ROW_INDEX to);
+  virtual ROW_INDEX LoadRows(const char* const file,
+                             const DBS_LOAD_FORMAT format,
+                             const FIELD_INDEX* const fields,
+                             const FIELD_INDEX fieldsCount);
+  virtual ROW_INDEX ExportRows(const char* const file,
+                               const FIELD_INDEX* const fields,
+                               const FIELD_INDEX fieldsCount);
+
+  virtual DBSFieldStats GetFieldStats(const FIELD_INDEX field);
 
   virtual DArray MatchRows(const DBool&        min,
                            const DBool&        max,
@@ -323,6 +346,131 @@ public:
                            const ROW_INDEX       fromRow,
                            const ROW_INDEX       toRow,
                            const FIELD_INDEX     field);
+
+  virtual DArray MatchRows(const DText&          min,
+                           const DText&          max,
+                           const ROW_INDEX       fromRow,
+                           const ROW_INDEX       toRow,
+                           const FIELD_INDEX     field);
+
+  virtual RowsSet MatchRowsSet(const DBool&        min,
+                               const DBool&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DChar&        min,
+                               const DChar&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DDate&        min,
+                               const DDate&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DDateTime&    min,
+                               const DDateTime&    max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DHiresTime&   min,
+                               const DHiresTime&   max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DUInt8&       min,
+                               const DUInt8&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DUInt16&      min,
+                               const DUInt16&      max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DUInt32&      min,
+                               const DUInt32&      max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DUInt64&      min,
+                               const DUInt64&      max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DInt8&        min,
+                               const DInt8&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DInt16&       min,
+                               const DInt16&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DInt32&       min,
+                               const DInt32&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DInt64&       min,
+                               const DInt64&       max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DReal&        min,
+                               const DReal&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DRichReal&    min,
+                               const DRichReal&    max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+
+  virtual RowsSet MatchRowsSet(const DText&        min,
+                               const DText&        max,
+                               const ROW_INDEX     fromRow,
+                               const ROW_INDEX     toRow,
+                               const FIELD_INDEX   field);
+  virtual RowsSet MatchTextRows(const DText&        substring,
+                                const bool          ignoreCase,
+                                const ROW_INDEX     fromRow,
+                                const ROW_INDEX     toRow,
+                                const FIELD_INDEX   field) override;
+  virtual RowsSet MatchArrayRows(const DArray&       values,
+                                 const bool          matchAll,
+                                 const ROW_INDEX     fromRow,
+                                 const ROW_INDEX     toRow,
+                                 const FIELD_INDEX   field) override;
+  virtual RowsSet MatchCompositeRows(const FIELD_INDEX* const   fields,
+                                     const FIELD_INDEX          fieldsCount,
+                                     const CompositeKey&        min,
+                                     const CompositeKey&        max,
+                                     const ROW_INDEX            fromRow,
+                                     const ROW_INDEX            toRow) override;
+  virtual uint_t FetchIndexEntries(const FIELD_INDEX   field,
+                                   const DArray&       fromValue,
+                                   const ROW_INDEX     afterRow,
+                                   const bool          reverse,
+                                   const uint_t        count,
+                                   DArray&             outValues,
+                                   DArray&             outRows) override;
   virtual void Flush() override;
   virtual void LockTable() override;
   virtual void UnlockTable() override;
@@ -190,7 +190,10 @@ Session::Session(Logger&           log,
   : ISession(log),
     mGlobalNames(globalNames),
     mPrivateNames(privateNames),
+    mTempBudget(std::make_shared<TempMemoryBudget>(DBSGetSeettings().mSessionTempMemoryLimit)),
     mMaxStackCount(~0),
+    mJitCallsThreshold(0),
+    mSyncWaitTimeout(0),
     mServerStopped(false)
 {
   DefineTablesGlobalValues();
@@ -407,7 +410,22 @@ Session::ExecuteProcedure(const char* const procedure, SessionStack& stack)
 
   const Procedure& proc = GetProcedure(procId);
 
-  ProcedureCall( *this, stack, proc);
+  //Charge the temporal values created by this procedure to this session.
+  auto prevBudget = TempMemoryBudget::Current(mTempBudget);
+  try
+  {
+    ProcedureCall( *this, stack, proc);
+  }
+  catch (...)
+  {
+    TempMemoryBudget::Current(prevBudget);
+    throw;
+  }
+  TempMemoryBudget::Current(prevBudget);
+
+  //Depending on the durability settings, wait for the tables updates to
+  //reach the database's redo log.
+  DBSHandler().CommitUpdates();
 }
 
 
@@ -681,6 +699,46 @@ Session::NotifyEvent(const uint_t event, uint64_t* const extra)
     log.Log(LT_INFO, s.str());
     mMaxStackCount = *extra;
   }
+  else if (event == ISession::JIT_CALLS_THRESHOLD)
+  {
+    if (extra == nullptr)
+    {
+      log.Log(LT_ERROR, "Could not set the JIT compile threshold because the value is missing.");
+      return false;
+    }
+
+    std::stringstream s;
+    if (*extra == 0)
+      s << "The JIT compilation of procedures is disabled.";
+
+    else if ( !JitProcedure::IsSupported())
+    {
+      log.Log(LT_INFO, "The JIT compilation of procedures is not supported on this platform.");
+      return false;
+    }
+    else
+      s << "Procedures will be JIT compiled after " << *extra << " calls.";
+
+    log.Log(LT_INFO, s.str());
+    mJitCallsThreshold = *extra;
+  }
+  else if (event == ISession::SYNC_WAIT_TMO)
+  {
+    if (extra == nullptr)
+    {
+      log.Log(LT_ERROR, "Could not set the sync statements wait timeout because the value is missing.");
+      return false;
+    }
+
+    std::stringstream s;
+    if (*extra == 0)
+      s << "Sync statements will be waited without a timeout.";
+    else
+      s << "Setting the sync statements wait timeout at " << *extra << "ms.";
+
+    log.Log(LT_INFO, s.str());
+    mSyncWaitTimeout = *extra;
+  }
   else
     return false;
 
@@ -132,6 +132,9 @@ public:
 
   bool IsServerShoutdowing() const { return mServerStopped; }
   uint_t MaxStackCount() const { return mMaxStackCount; }
+  uint_t JitCallsThreshold() const { return mJitCallsThreshold; }
+  uint_t SyncWaitTimeout() const { return mSyncWaitTimeout; }
+  DBSTempMemoryStats TempMemoryStats() { return mTempBudget->Stats(); }
 
   void LogMessage(const std::string& msg) {/* TODO: It needs to be implemented */ }
 
@@ -159,7 +162,10 @@ private:
   NameSpaceHolder            mGlobalNames;
   NameSpaceHolder            mPrivateNames;
   std::vector<WH_SHLIB>      mNativeLibs;
+  std::shared_ptr<TempMemoryBudget> mTempBudget;
   volatile uint_t            mMaxStackCount;
+  volatile uint_t            mJitCallsThreshold;
+  volatile uint_t            mSyncWaitTimeout;
   volatile bool              mServerStopped;
 };
 
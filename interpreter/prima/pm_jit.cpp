@@ -0,0 +1,428 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#include <assert.h>
+#include <string.h>
+#include <exception>
+#include <vector>
+
+#if defined(ARCH_LINUX_GCC) && defined(__x86_64__)
+#include <sys/mman.h>
+#define JIT_X86_64_SUPPORT 1
+#endif
+
+#include "compiler/wopcodes.h"
+#include "utils/endianness.h"
+#include "pm_jit.h"
+#include "pm_processor.h"
+
+
+using namespace std;
+
+namespace whais {
+namespace prima {
+
+
+typedef int (*JIT_ENTRY) (ProcedureCall* call, exception_ptr* pendingException);
+
+static const uint_t INVALID_ARGS_SIZE = 0xFFFFFFFF;
+
+//Returned by the dispatcher when the handler threw. A taken branch returns a
+//negative offset as well, so this has to be told apart from any valid one.
+static const int64_t DISPATCH_FAILED = INT64_MIN;
+
+//Returns the size of the arguments that follow an opcode in the procedure's code.
+static uint_t
+op_args_size(const W_OPCODE opcode)
+{
+  switch (opcode)
+  {
+  case W_LDNULL:
+  case W_LDI8:
+  case W_LDLO8:
+  case W_LDGB8:
+  case W_CTS:
+  case W_BSYNC:
+  case W_ESYNC:
+  case W_AJOIN:
+  case W_AFOUT:
+  case W_AFIN:
+    return sizeof(uint8_t);
+
+  case W_LDI16:
+  case W_LDLO16:
+  case W_LDGB16:
+    return sizeof(uint16_t);
+
+  case W_LDC:
+  case W_LDI32:
+  case W_LDD:
+  case W_LDT:
+  case W_LDLO32:
+  case W_LDGB32:
+  case W_CALL:
+  case W_JF:
+  case W_JFC:
+  case W_JT:
+  case W_JTC:
+  case W_JMP:
+  case W_INDTA:
+  case W_SELF:
+    return sizeof(uint32_t);
+
+  case W_LDI64:
+    return sizeof(uint64_t);
+
+  case W_LDDT:
+    return 5 + sizeof(uint16_t);
+
+  case W_LDHT:
+    return sizeof(uint32_t) + 5 + sizeof(uint16_t);
+
+  case W_LDRR:
+    return sizeof(uint64_t) + sizeof(uint64_t);
+
+  case W_CARR:
+    return sizeof(uint8_t) + sizeof(uint16_t);
+
+  case W_NA:
+  case W_OP_END_MARK:
+    return INVALID_ARGS_SIZE;
+
+  default:
+    return 0;
+  }
+}
+
+
+#ifdef JIT_X86_64_SUPPORT
+
+class CodeEmitter
+{
+public:
+  void Emit(const uint8_t b) { mCode.push_back(b); }
+
+  void Emit(const uint8_t* const bytes, const size_t count)
+  {
+    mCode.insert(mCode.end(), bytes, bytes + count);
+  }
+
+  void Emit32(const uint32_t value)
+  {
+    uint8_t bytes[sizeof value];
+    store_le_int32(value, bytes);
+    Emit(bytes, sizeof bytes);
+  }
+
+  void Emit64(const uint64_t value)
+  {
+    uint8_t bytes[sizeof value];
+    store_le_int64(value, bytes);
+    Emit(bytes, sizeof bytes);
+  }
+
+  //Emits a 32 bits relative displacement to be resolved later.
+  void EmitLabelRef(const uint32_t label)
+  {
+    mFixups.push_back(Fixup{mCode.size(), label});
+    Emit32(0);
+  }
+
+  size_t Position() const { return mCode.size(); }
+
+  bool Resolve(const vector<int64_t>& labels)
+  {
+    for (const auto& fix : mFixups)
+    {
+      if (fix.mLabel >= labels.size() || labels[fix.mLabel] < 0)
+        return false;
+
+      const int64_t disp = labels[fix.mLabel] - _SC(int64_t, fix.mPosition + sizeof(uint32_t));
+      store_le_int32(_SC(uint32_t, _SC(int32_t, disp)), &mCode[fix.mPosition]);
+    }
+    return true;
+  }
+
+  const vector<uint8_t>& Code() const { return mCode; }
+
+private:
+  struct Fixup
+  {
+    size_t   mPosition;
+    uint32_t mLabel;
+  };
+
+  vector<uint8_t> mCode;
+  vector<Fixup>   mFixups;
+};
+
+
+static void
+emit_prologue(CodeEmitter& e, const uint64_t dispatcher)
+{
+  static const uint8_t prologue[] = {
+      0x55,                         //push rbp
+      0x48, 0x89, 0xE5,             //mov rbp, rsp
+      0x53,                         //push rbx
+      0x41, 0x54,                   //push r12
+      0x41, 0x55,                   //push r13
+      0x48, 0x83, 0xEC, 0x08,       //sub rsp, 8 (keep the stack 16 bytes aligned)
+      0x48, 0x89, 0xFB,             //mov rbx, rdi (the procedure call)
+      0x49, 0x89, 0xF4,             //mov r12, rsi (the pending exception holder)
+      0x49, 0xBD                    //mov r13, imm64 (the opcode dispatcher)
+  };
+
+  e.Emit(prologue, sizeof prologue);
+  e.Emit64(dispatcher);
+}
+
+
+static void
+emit_epilogue(CodeEmitter& e, vector<int64_t>& labels, const uint32_t okLabel, const uint32_t failLabel)
+{
+  static const uint8_t epilogue[] = {
+      0x48, 0x83, 0xC4, 0x08,       //add rsp, 8
+      0x41, 0x5D,                   //pop r13
+      0x41, 0x5C,                   //pop r12
+      0x5B,                         //pop rbx
+      0x5D,                         //pop rbp
+      0xC3                          //ret
+  };
+
+  labels[okLabel] = e.Position();
+  e.Emit(0x31), e.Emit(0xC0);       //xor eax, eax
+  e.Emit(epilogue, sizeof epilogue);
+
+  labels[failLabel] = e.Position();
+  e.Emit(0xB8), e.Emit32(1);        //mov eax, 1
+  e.Emit(epilogue, sizeof epilogue);
+}
+
+
+//Calls the opcode handler through the dispatcher; on exception leaves the native code.
+static void
+emit_dispatch(CodeEmitter& e, const OP_FUNC handler, const uint32_t pc, const uint32_t failLabel)
+{
+  static const uint8_t args[] = {
+      0x48, 0x89, 0xDF,             //mov rdi, rbx
+      0x4C, 0x89, 0xE6,             //mov rsi, r12
+      0x48, 0xBA                    //mov rdx, imm64
+  };
+
+  e.Emit(args, sizeof args);
+  e.Emit64(_RC(uint64_t, handler));
+  e.Emit(0xB9), e.Emit32(pc);       //mov ecx, imm32
+
+  e.Emit(0x41), e.Emit(0xFF), e.Emit(0xD5);  //call r13
+
+  e.Emit(0x48), e.Emit(0xBA);                //mov rdx, imm64
+  e.Emit64(_SC(uint64_t, DISPATCH_FAILED));
+  e.Emit(0x48), e.Emit(0x39), e.Emit(0xD0);  //cmp rax, rdx
+  e.Emit(0x0F), e.Emit(0x84);                //je rel32
+  e.EmitLabelRef(failLabel);
+}
+
+#endif //JIT_X86_64_SUPPORT
+
+
+JitProcedure::JitProcedure(uint8_t* const code, const size_t codeSize)
+  : mCode(code),
+    mCodeSize(codeSize)
+{
+}
+
+
+JitProcedure::~JitProcedure()
+{
+#ifdef JIT_X86_64_SUPPORT
+  munmap(mCode, mCodeSize);
+#endif
+}
+
+
+bool
+JitProcedure::IsSupported()
+{
+#ifdef JIT_X86_64_SUPPORT
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+int64_t
+JitProcedure::Dispatch(ProcedureCall* const call,
+                       exception_ptr* const pendingException,
+                       const OP_FUNC handler,
+                       const uint64_t pc)
+{
+  try
+  {
+    if (call->mSession.IsServerShoutdowing())
+      throw InterException(_EXTRA(InterException::SERVER_STOPPED));
+
+    call->mCodePos = pc;
+
+    W_OPCODE opcode;
+    int64_t offset = wh_compiler_decode_op(call->mCode + pc, &opcode);
+
+    handler(*call, offset);
+
+    return offset;
+  }
+  catch (...)
+  {
+    *pendingException = current_exception();
+  }
+
+  return DISPATCH_FAILED;
+}
+
+
+JitProcedure*
+JitProcedure::Compile(const uint8_t* const code,
+                      const uint32_t codeSize,
+                      const OP_FUNC* const operations,
+                      const uint_t operationsCount)
+{
+#ifdef JIT_X86_64_SUPPORT
+  //Every code position may be a jump target. Jumping at the end of the code
+  //leaves the procedure, hence that position is also the exit label.
+  const uint32_t okLabel = codeSize;
+  const uint32_t failLabel = codeSize + 1;
+
+  vector<int64_t> labels(codeSize + 2, -1);
+  CodeEmitter e;
+
+  emit_prologue(e, _RC(uint64_t, &JitProcedure::Dispatch));
+
+  uint32_t pc = 0;
+  while (pc < codeSize)
+  {
+    W_OPCODE opcode;
+    const uint_t opSize = wh_compiler_decode_op(code + pc, &opcode);
+    const uint_t argsSize = op_args_size(opcode);
+
+    if ((argsSize == INVALID_ARGS_SIZE)
+        || (_SC(uint_t, opcode) >= operationsCount)
+        || (pc + opSize + argsSize > codeSize))
+    {
+      return nullptr;
+    }
+
+    labels[pc] = e.Position();
+
+    const uint32_t next = pc + opSize + argsSize;
+    if (opcode == W_JMP || opcode == W_JF || opcode == W_JFC || opcode == W_JT || opcode == W_JTC)
+    {
+      const int64_t target = _SC(int64_t, pc)
+                             + _SC(int32_t, load_le_int32(code + pc + opSize));
+      if (target < 0 || target > codeSize)
+        return nullptr;
+
+      if (opcode == W_JMP)
+      {
+        e.Emit(0xE9);               //jmp rel32
+        e.EmitLabelRef(target);
+      }
+      else
+      {
+        emit_dispatch(e, operations[opcode], pc, failLabel);
+
+        //The handler returns the jump's offset when the branch is taken.
+        e.Emit(0x48), e.Emit(0x83), e.Emit(0xF8), e.Emit(_SC(uint8_t, next - pc)); //cmp rax, imm8
+        e.Emit(0x0F), e.Emit(0x85); //jne rel32
+        e.EmitLabelRef(target);
+      }
+    }
+    else
+    {
+      emit_dispatch(e, operations[opcode], pc, failLabel);
+      if (opcode == W_RET)
+      {
+        e.Emit(0xE9);               //jmp rel32
+        e.EmitLabelRef(okLabel);
+      }
+    }
+
+    pc = next;
+  }
+
+  e.Emit(0xE9);                     //jmp rel32
+  e.EmitLabelRef(okLabel);
+
+  emit_epilogue(e, labels, okLabel, failLabel);
+
+  //Labels are set only for instructions' starts; jumping in the middle of
+  //an instruction means the code is corrupted, so let the interpreter handle it.
+  if ( !e.Resolve(labels))
+    return nullptr;
+
+  const vector<uint8_t>& native = e.Code();
+  void* const mem = mmap(nullptr,
+                         native.size(),
+                         PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS,
+                         -1,
+                         0);
+  if (mem == MAP_FAILED)
+    return nullptr;
+
+  memcpy(mem, native.data(), native.size());
+  if (mprotect(mem, native.size(), PROT_READ | PROT_EXEC) != 0)
+  {
+    munmap(mem, native.size());
+    return nullptr;
+  }
+
+  return new JitProcedure(_RC(uint8_t*, mem), native.size());
+
+#else
+  (void)code;
+  (void)codeSize;
+  (void)operations;
+  (void)operationsCount;
+
+  return nullptr;
+#endif
+}
+
+
+void
+JitProcedure::Execute(ProcedureCall& call) const
+{
+  exception_ptr pendingException;
+
+  const JIT_ENTRY entry = _RC(JIT_ENTRY, mCode);
+  if (entry(&call, &pendingException) != 0)
+  {
+    assert(pendingException);
+    rethrow_exception(pendingException);
+  }
+}
+
+
+} //namespace prima
+} //namespace whais
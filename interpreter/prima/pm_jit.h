@@ -0,0 +1,84 @@
+/******************************************************************************
+WHAIS - An advanced database system
+Copyright(C) 2014-2018  Iulian Popa
+
+Address: Str Olimp nr. 6
+         Pantelimon Ilfov,
+         Romania
+Phone:   +40721939650
+e-mail:  popaiulian@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+******************************************************************************/
+
+#ifndef PM_JIT_H_
+#define PM_JIT_H_
+
+#include <exception>
+
+#include "whais.h"
+
+
+namespace whais {
+namespace prima {
+
+
+class ProcedureCall;
+
+typedef void(*OP_FUNC) (ProcedureCall& call, int64_t& ioOffset);
+
+
+/* Native translation of a procedure's code. The generated code keeps the
+ * procedure's control flow in machine code and calls the same opcode handlers
+ * used by the interpreter for the rest of the work. This is a partial JIT:
+ * the arithmetic and the compares are not inlined, only the dispatch loop is
+ * removed. */
+class JitProcedure
+{
+public:
+  ~JitProcedure();
+
+  JitProcedure(const JitProcedure&) = delete;
+  JitProcedure& operator= (const JitProcedure&) = delete;
+
+  //Returns nullptr if the code could not be translated on this platform.
+  static JitProcedure* Compile(const uint8_t* const code,
+                               const uint32_t codeSize,
+                               const OP_FUNC* const operations,
+                               const uint_t operationsCount);
+
+  void Execute(ProcedureCall& call) const;
+
+  static bool IsSupported();
+
+private:
+  JitProcedure(uint8_t* const code, const size_t codeSize);
+
+  //Called from the native code to execute an opcode handler. Returns the
+  //offset to the next instruction (negative for the backward jumps taken) or
+  //INT64_MIN on exception.
+  static int64_t Dispatch(ProcedureCall* const call,
+                          std::exception_ptr* const pendingException,
+                          const OP_FUNC handler,
+                          const uint64_t pc);
+
+  uint8_t*      mCode;
+  size_t        mCodeSize;
+};
+
+
+} //namespace prima
+} //namespace whais
+
+#endif //PM_JIT_H_
@@ -24,6 +24,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <assert.h>
 #include <string.h>
+#include <algorithm>
 
 #include "pm_procedures.h"
 #include "pm_interpreter.h"
@@ -36,6 +37,12 @@ namespace whais {
 namespace prima {
 
 
+ProcedureManager::~ProcedureManager()
+{
+  for (auto& entry : mProcsEntrys)
+    delete entry.mJitCode;
+}
+
 uint32_t
 ProcedureManager::AddProcedure(const uint8_t* const name,
                                const uint_t nameLength,
@@ -59,7 +66,6 @@ ProcedureManager::AddProcedure(const uint8_t* const name,
   entry.mLocalsCount = localsCount;
   entry.mArgsCount   = argsCount;
   entry.mSyncCount   = syncCount;
-  entry.mSyncIndex   = mSyncStmts.size();
   entry.mLocalsIndex = mLocalsValues.size();
   entry.mIdIndex     = mIdentifiers.size();
   entry.mTypeOff     = mLocalsTypes.size();
@@ -68,10 +74,17 @@ ProcedureManager::AddProcedure(const uint8_t* const name,
   entry.mUnit        = unit;
   entry.mProcMgr     = this;
   entry.mNativeCode  = (unit == nullptr) ? _RC(WLIB_PROCEDURE, code) : nullptr;
+  entry.mJitCode     = nullptr;
+  entry.mCallsCount  = 0;
 
   const uint32_t result = mProcsEntrys.size();
 
-  mSyncStmts.insert(mSyncStmts.end(), syncCount, false);
+  {
+    LockGuard<Lock> holder(mSync);
+
+    entry.mSyncIndex = mSyncStmts.size();
+    mSyncStmts.insert(mSyncStmts.end(), syncCount, SyncStmt{false, {}});
+  }
 
   for (uint_t i = 0; i < localsCount; ++i)
     mLocalsValues.push_back(StackValue(localValues[i]));
@@ -185,8 +198,8 @@ ProcedureManager::Code(const Procedure& proc, uint_t* const outCodeSize) const
   return &mDefinitions[proc.mCodeIndex];
 }
 
-void
-ProcedureManager::AquireSync(const Procedure& proc, const uint32_t sync)
+bool
+ProcedureManager::AquireSync(const Procedure& proc, const uint32_t sync, const uint_t waitTimeout)
 {
   assert(proc.mProcMgr == this);
   assert(sync < proc.mSyncCount);
@@ -194,22 +207,73 @@ ProcedureManager::AquireSync(const Procedure& proc, const uint32_t sync)
   if (sync >= proc.mSyncCount)
     throw InterException(_EXTRA(InterException::INVALID_SYNC_REQ));
 
-  do
+  const uint32_t stmtIndex = proc.mSyncIndex + sync;
+
+  LockGuard<Lock> holder(mSync);
+
+  ++mSyncStats.mAquiresCount;
+  if ( !mSyncStmts[stmtIndex].mAquired)
   {
-    LockGuard<Lock> holder(mSync);
-    const bool aquired = mSyncStmts[proc.mSyncIndex + sync];
-    if (aquired)
+    assert(mSyncStmts[stmtIndex].mWaiters.empty());
+
+    mSyncStmts[stmtIndex].mAquired = true;
+    return true;
+  }
+
+  SyncWaiter waiter;
+  waiter.mGranted = false;
+
+  mSyncStmts[stmtIndex].mWaiters.push_back(&waiter);
+
+  const WTICKS waitStart = wh_msec_ticks();
+  try
+  {
+    while ( !waiter.mGranted)
     {
-      //Some one has taken this before us! Prepare to try again!
-      holder.unlock();
-      wh_yield();
+      if (waitTimeout == 0)
+      {
+        waiter.mCondition.Wait(mSync);
+        continue;
+      }
+
+      const WTICKS elapsed = wh_msec_ticks() - waitStart;
+      if ((elapsed >= waitTimeout)
+          || ! waiter.mCondition.Wait(mSync, waitTimeout - elapsed))
+      {
+        if ( !waiter.mGranted)
+          break;
+      }
     }
-    else
+  }
+  catch (...)
+  {
+    if ( !waiter.mGranted)
     {
-      mSyncStmts[proc.mSyncIndex + sync] = true;
-      break;
+      auto& waiters = mSyncStmts[stmtIndex].mWaiters;
+      waiters.erase(find(waiters.begin(), waiters.end(), &waiter));
     }
-  } while (true);
+    else
+      HandOverSync(stmtIndex);
+
+    throw;
+  }
+
+  const uint64_t waitTime = wh_msec_ticks() - waitStart;
+
+  ++mSyncStats.mWaitsCount;
+  mSyncStats.mTotalWaitTime += waitTime;
+  mSyncStats.mMaxWaitTime = max(mSyncStats.mMaxWaitTime, waitTime);
+
+  if ( !waiter.mGranted)
+  {
+    auto& waiters = mSyncStmts[stmtIndex].mWaiters;
+    waiters.erase(find(waiters.begin(), waiters.end(), &waiter));
+
+    ++mSyncStats.mTimeoutsCount;
+    return false;
+  }
+
+  return true;
 }
 
 void
@@ -221,9 +285,81 @@ ProcedureManager::ReleaseSync(const Procedure& proc, const uint32_t sync)
   if (sync >= proc.mSyncCount)
     throw InterException( _EXTRA(InterException::INVALID_SYNC_REQ));
 
-  assert(mSyncStmts[proc.mSyncIndex + sync] == true);
+  LockGuard<Lock> holder(mSync);
+
+  HandOverSync(proc.mSyncIndex + sync);
+}
+
+void
+ProcedureManager::HandOverSync(const uint32_t stmtIndex)
+{
+  SyncStmt& stmt = mSyncStmts[stmtIndex];
+
+  assert(stmt.mAquired);
+
+  if (stmt.mWaiters.empty())
+  {
+    stmt.mAquired = false;
+    return;
+  }
+
+  SyncWaiter* const next = stmt.mWaiters.front();
+  stmt.mWaiters.pop_front();
+
+  next->mGranted = true;
+  next->mCondition.Signal();
+}
+
+SyncStatistics
+ProcedureManager::SyncStats()
+{
+  LockGuard<Lock> holder(mSync);
+
+  return mSyncStats;
+}
+
+const JitProcedure*
+ProcedureManager::GetJitProcedure(const Procedure& proc,
+                                  const uint_t callsThreshold,
+                                  const OP_FUNC* const operations,
+                                  const uint_t operationsCount)
+{
+  assert(proc.mProcMgr == this);
+
+  if ((callsThreshold == 0) || (proc.mNativeCode != nullptr))
+    return nullptr;
+
+  Procedure& entry = mProcsEntrys[proc.mId];
+  if (entry.mJitCode != nullptr)
+    return entry.mJitCode;
+
+  //Do not bother to count the calls of procedures that failed to compile.
+  if ((entry.mCallsCount < 0)
+      || (wh_atomic_fetch_inc32(&entry.mCallsCount) + 1 < _SC(int32_t, callsThreshold)))
+  {
+    return nullptr;
+  }
+
+  LockGuard<Lock> holder(mSync);
+  if ((entry.mJitCode == nullptr) && (entry.mCallsCount >= 0))
+  {
+    try
+    {
+      entry.mJitCode = JitProcedure::Compile(Code(entry, nullptr),
+                                             entry.mCodeSize,
+                                             operations,
+                                             operationsCount);
+    }
+    catch (std::bad_alloc&)
+    {
+      entry.mJitCode = nullptr;
+    }
+
+    if (entry.mJitCode == nullptr)
+      entry.mCallsCount = JIT_FAILED;
+  }
 
-  mSyncStmts[proc.mSyncIndex + sync] = false;
+  return entry.mJitCode;
 }
 
 
@@ -25,11 +25,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef PM_PROCEDURES_H_
 #define PM_PROCEDURES_H_
 
+#include <deque>
 #include <vector>
 
 #include "whais.h"
+#include "utils/wthread.h"
 #include "stdlib/interface.h"
 #include "pm_operand.h"
+#include "pm_jit.h"
 
 
 namespace whais {
@@ -55,17 +58,30 @@ struct Procedure
   WLIB_PROCEDURE    mNativeCode;
   Unit*             mUnit;
   ProcedureManager* mProcMgr;
+  JitProcedure*     volatile mJitCode;
+  volatile int32_t  mCallsCount;
+};
+
+struct SyncStatistics
+{
+  uint64_t          mAquiresCount;
+  uint64_t          mWaitsCount;
+  uint64_t          mTimeoutsCount;
+  uint64_t          mTotalWaitTime;  //milliseconds
+  uint64_t          mMaxWaitTime;    //milliseconds
 };
 
 class ProcedureManager
 {
 public:
   ProcedureManager(NameSpace& space)
-    : mNameSpace(space)
+    : mNameSpace(space),
+      mSyncStats()
   {
   }
   ProcedureManager(const ProcedureManager&) = delete;
   ProcedureManager& operator= (const ProcedureManager&) = delete;
+  ~ProcedureManager();
 
   uint_t Count() const { return mProcsEntrys.size(); }
 
@@ -89,8 +105,16 @@ public:
   const uint8_t* LocalTypeDescription(const uint_t procId, const uint32_t local) const;
   const uint8_t* Code(const Procedure& proc, uint_t* const outCodeSize) const;
 
-  void AquireSync(const Procedure& proc, const uint32_t sync);
+  //Returns false if the sync statement was not acquired in the specified
+  //time (milliseconds). A zero timeout means waiting as long as is needed.
+  bool AquireSync(const Procedure& proc, const uint32_t sync, const uint_t waitTimeout = 0);
   void ReleaseSync(const Procedure& proc, const uint32_t sync);
+  SyncStatistics SyncStats();
+
+  const JitProcedure* GetJitProcedure(const Procedure& proc,
+                                      const uint_t callsThreshold,
+                                      const OP_FUNC* const operations,
+                                      const uint_t operationsCount);
 
   static bool IsValid(const uint32_t entry) { return entry != INVALID_ENTRY; }
   static bool IsGlobalEntry(const uint32_t entry)
@@ -101,8 +125,26 @@ public:
 
 
 private:
+  struct SyncWaiter
+  {
+    Condition               mCondition;
+    bool                    mGranted;
+  };
+
+  //The waiting threads are kept in arrival order, and the statement is handed
+  //directly to the first one when released.
+  struct SyncStmt
+  {
+    bool                    mAquired;
+    std::deque<SyncWaiter*> mWaiters;
+  };
+
+  //Expects mSync to be held by the caller.
+  void HandOverSync(const uint32_t stmtIndex);
+
   static const uint32_t GLOBAL_ID     = 0x80000000;
   static const uint32_t INVALID_ENTRY = 0xFFFFFFFF;
+  static const int32_t  JIT_FAILED    = -0x40000000;
 
   NameSpace&                  mNameSpace;
   std::vector<Procedure>      mProcsEntrys;
@@ -110,7 +152,8 @@ private:
   std::vector<StackValue>     mLocalsValues;
   std::vector<uint32_t>       mLocalsTypes;
   std::vector<uint8_t>        mDefinitions;
-  std::vector<bool>           mSyncStmts;
+  std::vector<SyncStmt>       mSyncStmts;
+  SyncStatistics              mSyncStats;
   Lock                        mSync;
 };
 
@@ -1861,9 +1861,6 @@ op_do_array_op(ProcedureCall& call, int64_t& offset)
 }
 
 
-typedef void(*OP_FUNC) (ProcedureCall& call, int64_t& ioOffset);
-
-
 static OP_FUNC operations[] = {
                                 nullptr,
                                 op_func_ldnull,
@@ -2059,6 +2056,7 @@ ProcedureCall::ProcedureCall(Session& session, SessionStack& stack, const Proced
     mCode(mProcedure.mNativeCode
            ? nullptr
            : procedure.mProcMgr->Code(procedure, nullptr)),
+    mJitCode(nullptr),
     mStackBegin(stack.Size() - procedure.mArgsCount),
     mCodePos(0),
     mAquiredSync(NO_INDEX)
@@ -2122,6 +2120,10 @@ ProcedureCall::ProcedureCall(Session& session, SessionStack& stack, const Proced
                            mProcedure.mProcMgr->Name(mProcedure.mId));
     }
 
+    mJitCode = mProcedure.mProcMgr->GetJitProcedure(mProcedure,
+                                                    session.JitCallsThreshold(),
+                                                    operations,
+                                                    sizeof operations / sizeof operations[0]);
     try
     {
       Run();
@@ -2157,22 +2159,28 @@ ProcedureCall::Run()
 
   try
   {
-    while (mCodePos < CodeSize())
+    if (mJitCode != nullptr)
+      mJitCode->Execute(*this);
+
+    else
     {
-      if (mSession.IsServerShoutdowing())
-        throw InterException(_EXTRA(InterException::SERVER_STOPPED));
+      while (mCodePos < CodeSize())
+      {
+        if (mSession.IsServerShoutdowing())
+          throw InterException(_EXTRA(InterException::SERVER_STOPPED));
 
-      int64_t offset = wh_compiler_decode_op(mCode + mCodePos, &opcode);
+        int64_t offset = wh_compiler_decode_op(mCode + mCodePos, &opcode);
 
-      assert(opcode < _SC(int, (sizeof operations / sizeof operations[0])));
-      assert(opcode != 0);
-      assert((offset > 0) && (offset < 3));
+        assert(opcode < _SC(int, (sizeof operations / sizeof operations[0])));
+        assert(opcode != 0);
+        assert((offset > 0) && (offset < 3));
 
-      operations[opcode]( *this, offset);
+        operations[opcode]( *this, offset);
 
-      mCodePos += offset;
+        mCodePos += offset;
 
-      assert((mCodePos <= CodeSize()) || (_SC(uint64_t, offset) == CodeSize()));
+        assert((mCodePos <= CodeSize()) || (_SC(uint64_t, offset) == CodeSize()));
+      }
     }
 
     if (mAquiredSync != NO_INDEX)
@@ -2197,7 +2205,26 @@ ProcedureCall::AquireSync(const uint8_t sync)
   if (mAquiredSync != NO_INDEX)
     throw InterException(_EXTRA(InterException::NEESTED_SYNC_REQ));
 
-  mProcedure.mProcMgr->AquireSync(mProcedure, sync);
+  ProcedureManager& procMgr = *mProcedure.mProcMgr;
+  const uint_t waitTimeout = mSession.SyncWaitTimeout();
+
+  if ( !procMgr.AquireSync(mProcedure, sync, waitTimeout))
+  {
+    const SyncStatistics stats = procMgr.SyncStats();
+
+    std::ostringstream log;
+    log << "Timed out after " << waitTimeout << "ms waiting for sync statement "
+        << _SC(uint_t, sync) << " of procedure '" << _RC(const char*, procMgr.Name(mProcedure.mId))
+        << "' (waits: " << stats.mWaitsCount << ", timeouts: " << stats.mTimeoutsCount
+        << ", total wait: " << stats.mTotalWaitTime << "ms, longest wait: "
+        << stats.mMaxWaitTime << "ms).";
+    mSession.GetLogger().Log(LT_WARNING, log.str());
+
+    throw InterException(_EXTRA(InterException::SYNC_WAIT_TIMEOUT),
+                         "Timed out waiting for sync statement %u of procedure '%s'.",
+                         _SC(uint_t, sync),
+                         _RC(const char*, procMgr.Name(mProcedure.mId)));
+  }
   mAquiredSync = sync;
 }
 
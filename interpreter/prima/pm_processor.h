@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "pm_interpreter.h"
 #include "pm_procedures.h"
+#include "pm_jit.h"
 
 
 namespace whais {
@@ -63,6 +64,8 @@ public:
   uint32_t StackBegin() const { return mStackBegin; }
 
 private:
+  friend class JitProcedure;
+
   void Run();
 
   static const uint16_t NO_INDEX = 0xFFFF;
@@ -71,6 +74,7 @@ private:
   Session&                mSession;
   SessionStack&           mStack;
   const uint8_t*          mCode;
+  const JitProcedure*     mJitCode;
   uint32_t                mStackBegin;
   uint32_t                mCodePos;
   uint16_t                mAquiredSync;
@@ -22,8 +22,10 @@ You should have received a copy of the GNU General Public License
 along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
+#include <algorithm>
 #include <assert.h>
 #include <memory.h>
+#include <string.h>
 #include <vector>
 
 #include "dbs/dbs_types.h"
@@ -525,15 +527,29 @@ TypeManager::GetTypeLength(const uint8_t* const typeDesc)
 }
 
 
+static bool
+field_name_less(const DBSFieldDescriptor& first, const DBSFieldDescriptor& second)
+{
+  return strcmp(first.name, second.name) < 0;
+}
+
+
 vector<uint8_t>
 compute_table_typeinfo(ITable& table)
 {
   vector<uint8_t> data;
+  vector<DBSFieldDescriptor> fields;
 
   const FIELD_INDEX fieldsCount = table.FieldsCount();
   for (FIELD_INDEX fieldId = 0; fieldId < fieldsCount; ++fieldId)
+    fields.push_back(table.DescribeField(fieldId));
+
+  //The fields added to an existing table follow the ones it was created with,
+  //but the type descriptions list them by name, as the compiler does.
+  std::sort(fields.begin(), fields.end(), field_name_less);
+
+  for (const auto& field : fields)
   {
-    DBSFieldDescriptor field = table.DescribeField(fieldId);
 
     const uint_t nameLen = strlen(field.name) + 1;
 
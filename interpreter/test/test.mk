@@ -119,3 +119,12 @@ UNIT_EXES+=test_stackvalue_size
 test_stackvalue_size_SRC=test/test_stackvalue_size.cpp
 test_stackvalue_size_LIB=dbs/wslpastra   interpreter/wslprima compiler/wslcompiler utils/wslutils custom/wslcustom custom/wslcppmemalloc 
 
+
+UNIT_EXES+=test_jit
+test_jit_SRC=test/test_jit.cpp
+test_jit_LIB=dbs/wslpastra   interpreter/wslprima compiler/wslcompiler utils/wslutils custom/wslcustom custom/wslcppmemalloc 
+
+
+UNIT_EXES+=test_sync_wait
+test_sync_wait_SRC=test/test_sync_wait.cpp
+test_sync_wait_LIB=dbs/wslpastra   interpreter/wslprima compiler/wslcompiler utils/wslutils custom/wslcustom custom/wslcppmemalloc 
@@ -0,0 +1,372 @@
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <iostream>
+
+#include "dbs/dbs_mgr.h"
+#include "interpreter.h"
+#include "custom/include/test/test_fmw.h"
+
+#include "interpreter/prima/pm_interpreter.h"
+#include "interpreter/prima/pm_processor.h"
+
+using namespace whais;
+using namespace prima;
+
+static const char admin[] = "administrator";
+
+const uint8_t jitTestProgram[] = ""
+    "PROCEDURE sum_to(n INT64) RETURN INT64\n"
+    "DO\n"
+    "  VAR i, result INT64;\n"
+    "\n"
+    "  i = 0;\n"
+    "  result = 0;\n"
+    "  WHILE (i <= n) DO\n"
+    "    IF ((i % 2) == 0)\n"
+    "      result += i;\n"
+    "    ELSE\n"
+    "      result -= 1;\n"
+    "    i += 1;\n"
+    "  END\n"
+    "\n"
+    "  RETURN result;\n"
+    "ENDPROC\n"
+    "\n"
+    "PROCEDURE fibonacci(n UINT32) RETURN UINT64\n"
+    "DO\n"
+    "  IF (n < 2)\n"
+    "    RETURN n;\n"
+    "\n"
+    "  RETURN fibonacci(n - 1) + fibonacci(n - 2);\n"
+    "ENDPROC\n"
+    "\n"
+    "PROCEDURE sync_count(n UINT32) RETURN UINT32\n"
+    "DO\n"
+    "  VAR result UINT32;\n"
+    "\n"
+    "  result = 0;\n"
+    "  FOR (result = 0; result < n; result += 1)\n"
+    "  DO\n"
+    "    SYNC\n"
+    "      IF (result == 100)\n"
+    "        RETURN result;\n"
+    "    ENDSYNC\n"
+    "  END\n"
+    "\n"
+    "  RETURN result;\n"
+    "ENDPROC\n"
+    "\n"
+    "PROCEDURE until_sum(n INT64) RETURN INT64\n"
+    "DO\n"
+    "  VAR i, result INT64;\n"
+    "\n"
+    "  i = 0;\n"
+    "  result = 0;\n"
+    "  DO\n"
+    "    i += 1;\n"
+    "    result += i;\n"
+    "  UNTIL (i < n);\n"
+    "\n"
+    "  RETURN result;\n"
+    "ENDPROC\n"
+    "\n"
+    "PROCEDURE nested_until(n INT64) RETURN INT64\n"
+    "DO\n"
+    "  VAR i, j, limit, result INT64;\n"
+    "\n"
+    "  i = 0;\n"
+    "  limit = 10;\n"
+    "  result = 0;\n"
+    "  WHILE (i < n) DO\n"
+    "    j = 0;\n"
+    "    DO\n"
+    "      j += 1;\n"
+    "      IF ((j % 3) == 0)\n"
+    "        CONTINUE;\n"
+    "\n"
+    "      result += i * j;\n"
+    "      result += (i + j) * 2;\n"
+    "      result -= (i + j) * 2;\n"
+    "      result += (i - j) * 3;\n"
+    "      result -= (i - j) * 3;\n"
+    "      IF (j > n)\n"
+    "        BREAK;\n"
+    "    UNTIL (j < limit);\n"
+    "    i += 1;\n"
+    "  END\n"
+    "\n"
+    "  RETURN result;\n"
+    "ENDPROC\n"
+    "\n"
+    "PROCEDURE div_fail(n INT32) RETURN INT32\n"
+    "DO\n"
+    "  VAR d INT32;\n"
+    "\n"
+    "  d = n - n;\n"
+    "  RETURN n / d;\n"
+    "ENDPROC\n";
+
+
+static const char *MSG_PREFIX[] = {
+                                      "", "error ", "warning ", "error "
+                                    };
+
+static uint_t
+get_line_from_buffer(const char * buffer, uint_t buff_pos)
+{
+  uint_t count = 0;
+  int result = 1;
+
+  if (buff_pos == WHC_IGNORE_BUFFER_POS)
+    return -1;
+
+  while (count < buff_pos)
+    {
+      if (buffer[count] == '\n')
+        ++result;
+      else if (buffer[count] == 0)
+        {
+          assert(0);
+        }
+      ++count;
+    }
+  return result;
+}
+
+void
+my_postman(WH_MESSENGER_CTXT data,
+            uint_t            buff_pos,
+            uint_t            msg_id,
+            uint_t            msgType,
+            const char*     pMsgFormat,
+            va_list           args)
+{
+  const char *buffer = (const char *) data;
+  int buff_line = get_line_from_buffer(buffer, buff_pos);
+
+  fprintf(stderr, MSG_PREFIX[msgType]);
+  fprintf(stderr, "%d : line %d: ", msg_id, buff_line);
+  vfprintf(stderr, pMsgFormat, args);
+  fprintf(stderr, "\n");
+}
+
+
+static bool
+is_jit_compiled(Session& session, const char* const name)
+{
+  const uint32_t procId = session.FindProcedure(_RC(const uint8_t*, name), strlen(name));
+  const Procedure& proc = session.GetProcedure(procId);
+
+  return proc.mJitCode != nullptr;
+}
+
+
+static bool
+test_sum_to(Session& session)
+{
+  std::cout << "Testing a loop procedure ...\n";
+
+  for (int i = 0; i < 3; ++i)
+  {
+    SessionStack stack;
+    stack.Push(DInt64(1000));
+
+    session.ExecuteProcedure("sum_to", stack);
+    if (stack.Size() != 1)
+      return false;
+
+    DInt64 result;
+    stack[0].Operand().GetValue(result);
+
+    if (result != DInt64(250000))
+      return false;
+  }
+
+  return is_jit_compiled(session, "sum_to");
+}
+
+
+static bool
+test_fibonacci(Session& session)
+{
+  std::cout << "Testing a recursive procedure ...\n";
+
+  SessionStack stack;
+  stack.Push(DUInt32(20));
+
+  session.ExecuteProcedure("fibonacci", stack);
+  if (stack.Size() != 1)
+    return false;
+
+  DUInt64 result;
+  stack[0].Operand().GetValue(result);
+
+  if (result != DUInt64(6765))
+    return false;
+
+  return is_jit_compiled(session, "fibonacci");
+}
+
+
+static bool
+test_sync_count(Session& session)
+{
+  std::cout << "Testing sync statements ...\n";
+
+  for (int i = 0; i < 3; ++i)
+  {
+    SessionStack stack;
+    stack.Push(DUInt32(i == 1 ? 200 : 50));
+
+    session.ExecuteProcedure("sync_count", stack);
+    if (stack.Size() != 1)
+      return false;
+
+    DUInt32 result;
+    stack[0].Operand().GetValue(result);
+
+    if (result != DUInt32(i == 1 ? 100 : 50))
+      return false;
+  }
+
+  return is_jit_compiled(session, "sync_count");
+}
+
+
+static bool
+test_until_loop(Session& session)
+{
+  std::cout << "Testing an UNTIL loop ...\n";
+
+  for (int i = 0; i < 3; ++i)
+  {
+    SessionStack stack;
+    stack.Push(DInt64(1000));
+
+    session.ExecuteProcedure("until_sum", stack);
+    if (stack.Size() != 1)
+      return false;
+
+    DInt64 result;
+    stack[0].Operand().GetValue(result);
+
+    if (result != DInt64(500500))
+      return false;
+  }
+
+  return is_jit_compiled(session, "until_sum");
+}
+
+
+//The inner loop jumps back over its whole body, further than a short jump.
+static bool
+test_backward_branch(Session& session)
+{
+  std::cout << "Testing backward branches of nested loops ...\n";
+
+  for (int i = 0; i < 3; ++i)
+  {
+    SessionStack stack;
+    stack.Push(DInt64(100));
+
+    session.ExecuteProcedure("nested_until", stack);
+    if (stack.Size() != 1)
+      return false;
+
+    DInt64 result;
+    stack[0].Operand().GetValue(result);
+
+    if (result != DInt64(37 * 4950))
+      return false;
+  }
+
+  return is_jit_compiled(session, "nested_until");
+}
+
+
+static bool
+test_exception(Session& session)
+{
+  std::cout << "Testing exceptions ...\n";
+
+  for (int i = 0; i < 3; ++i)
+  {
+    SessionStack stack;
+    stack.Push(DInt32(10));
+
+    try
+    {
+      session.ExecuteProcedure("div_fail", stack);
+      return false;
+    }
+    catch (InterException& e)
+    {
+      if (e.Code() != InterException::DIVIDE_BY_ZERO)
+        return false;
+
+      if (e.Message().find("PC: ") == std::string::npos)
+        return false;
+    }
+  }
+
+  return is_jit_compiled(session, "div_fail");
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(admin);
+  InitInterpreter();
+
+  {
+    ISession& commonSession = GetInstance(nullptr);
+
+    CompiledBufferUnit jitBuf(jitTestProgram,
+                              sizeof jitTestProgram,
+                              my_postman,
+                              jitTestProgram);
+
+    commonSession.LoadCompiledUnit(jitBuf);
+
+    uint64_t threshold = 2;
+    if (commonSession.NotifyEvent(ISession::JIT_CALLS_THRESHOLD, &threshold))
+    {
+      success = success && test_sum_to(_SC(Session&, commonSession));
+      success = success && test_fibonacci(_SC(Session&, commonSession));
+      success = success && test_sync_count(_SC(Session&, commonSession));
+      success = success && test_until_loop(_SC(Session&, commonSession));
+      success = success && test_backward_branch(_SC(Session&, commonSession));
+      success = success && test_exception(_SC(Session&, commonSession));
+    }
+    else
+      std::cout << "JIT compilation is not supported on this platform.\n";
+
+    ReleaseInstance(commonSession);
+  }
+
+  CleanInterpreter();
+  DBSRemoveDatabase(admin);
+  DBSShoutdown();
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
@@ -0,0 +1,301 @@
+#include <assert.h>
+#include <string.h>
+#include <stdio.h>
+#include <iostream>
+
+#include "dbs/dbs_mgr.h"
+#include "interpreter.h"
+#include "custom/include/test/test_fmw.h"
+#include "utils/wthread.h"
+
+#include "interpreter/prima/pm_interpreter.h"
+#include "interpreter/prima/pm_processor.h"
+
+using namespace whais;
+using namespace prima;
+
+static const char admin[] = "administrator";
+
+const uint8_t syncTestProgram[] = ""
+    "PROCEDURE sync_count(n UINT32) RETURN UINT32\n"
+    "DO\n"
+    "  VAR i, result UINT32;\n"
+    "\n"
+    "  result = 0;\n"
+    "  FOR (i = 0; i < n; i += 1)\n"
+    "  DO\n"
+    "    SYNC\n"
+    "      result += 1;\n"
+    "    ENDSYNC\n"
+    "  END\n"
+    "\n"
+    "  RETURN result;\n"
+    "ENDPROC\n";
+
+
+static const char *MSG_PREFIX[] = {
+                                      "", "error ", "warning ", "error "
+                                    };
+
+static uint_t
+get_line_from_buffer(const char * buffer, uint_t buff_pos)
+{
+  uint_t count = 0;
+  int result = 1;
+
+  if (buff_pos == WHC_IGNORE_BUFFER_POS)
+    return -1;
+
+  while (count < buff_pos)
+    {
+      if (buffer[count] == '\n')
+        ++result;
+      else if (buffer[count] == 0)
+        {
+          assert(0);
+        }
+      ++count;
+    }
+  return result;
+}
+
+void
+my_postman(WH_MESSENGER_CTXT data,
+            uint_t            buff_pos,
+            uint_t            msg_id,
+            uint_t            msgType,
+            const char*     pMsgFormat,
+            va_list           args)
+{
+  const char *buffer = (const char *) data;
+  int buff_line = get_line_from_buffer(buffer, buff_pos);
+
+  fprintf(stderr, MSG_PREFIX[msgType]);
+  fprintf(stderr, "%d : line %d: ", msg_id, buff_line);
+  vfprintf(stderr, pMsgFormat, args);
+  fprintf(stderr, "\n");
+}
+
+
+struct WaiterArgs
+{
+  const Procedure*  mProc;
+  uint_t            mId;
+  uint_t            mTimeout;
+  bool              mAquired;
+};
+
+static Lock     orderLock;
+static uint_t   aquireOrder[4];
+static uint_t   aquiredCount;
+
+
+static void
+sync_waiter(void* args)
+{
+  WaiterArgs& waiter = *_RC(WaiterArgs*, args);
+  const Procedure& proc = *waiter.mProc;
+
+  waiter.mAquired = proc.mProcMgr->AquireSync(proc, 0, waiter.mTimeout);
+  if ( !waiter.mAquired)
+    return;
+
+  {
+    LockGuard<Lock> _l(orderLock);
+    aquireOrder[aquiredCount++] = waiter.mId;
+  }
+
+  proc.mProcMgr->ReleaseSync(proc, 0);
+}
+
+
+static const Procedure&
+get_procedure(Session& session, const char* const name)
+{
+  const uint32_t procId = session.FindProcedure(_RC(const uint8_t*, name), strlen(name));
+
+  return session.GetProcedure(procId);
+}
+
+
+static bool
+test_wait_timeout(Session& session)
+{
+  std::cout << "Testing sync statement wait timeout ...\n";
+
+  const Procedure& proc = get_procedure(session, "sync_count");
+  const SyncStatistics before = proc.mProcMgr->SyncStats();
+
+  if ( !proc.mProcMgr->AquireSync(proc, 0, 10))
+    return false;
+
+  WaiterArgs waiter = {&proc, 1, 50, true};
+  Thread th;
+
+  th.Run(sync_waiter, &waiter);
+  th.WaitToEnd(true);
+
+  proc.mProcMgr->ReleaseSync(proc, 0);
+
+  const SyncStatistics after = proc.mProcMgr->SyncStats();
+  if (waiter.mAquired
+      || (after.mTimeoutsCount != before.mTimeoutsCount + 1)
+      || (after.mWaitsCount != before.mWaitsCount + 1)
+      || (after.mMaxWaitTime < 50))
+  {
+    return false;
+  }
+
+  //Once released, it should be acquired without waiting.
+  if ( !proc.mProcMgr->AquireSync(proc, 0, 10))
+    return false;
+
+  proc.mProcMgr->ReleaseSync(proc, 0);
+
+  return proc.mProcMgr->SyncStats().mWaitsCount == after.mWaitsCount;
+}
+
+
+static bool
+test_wait_order(Session& session)
+{
+  std::cout << "Testing sync statement wait order ...\n";
+
+  const Procedure& proc = get_procedure(session, "sync_count");
+
+  if ( !proc.mProcMgr->AquireSync(proc, 0))
+    return false;
+
+  aquiredCount = 0;
+
+  WaiterArgs waiters[4];
+  Thread th[4];
+
+  for (uint_t i = 0; i < 4; ++i)
+  {
+    waiters[i].mProc    = &proc;
+    waiters[i].mId      = i;
+    waiters[i].mTimeout = 0;
+    waiters[i].mAquired = false;
+
+    th[i].Run(sync_waiter, &waiters[i]);
+
+    //Give the thread the time to get in line.
+    wh_sleep(50);
+  }
+
+  proc.mProcMgr->ReleaseSync(proc, 0);
+
+  for (uint_t i = 0; i < 4; ++i)
+    th[i].WaitToEnd(true);
+
+  if (aquiredCount != 4)
+    return false;
+
+  for (uint_t i = 0; i < 4; ++i)
+  {
+    if ( !waiters[i].mAquired || aquireOrder[i] != i)
+      return false;
+  }
+
+  return true;
+}
+
+
+static bool  executeResult;
+
+static void
+sync_executor(void*)
+{
+  ISession& session = GetInstance(nullptr);
+
+  for (uint_t i = 0; i < 5; ++i)
+  {
+    SessionStack stack;
+    stack.Push(DUInt32(200));
+
+    session.ExecuteProcedure("sync_count", stack);
+
+    DUInt32 result;
+    stack[0].Operand().GetValue(result);
+
+    if (result != DUInt32(200))
+      executeResult = false;
+  }
+
+  ReleaseInstance(session);
+}
+
+
+static bool
+test_contention(Session& session)
+{
+  std::cout << "Testing sync statements contention ...\n";
+
+  const Procedure& proc = get_procedure(session, "sync_count");
+  const SyncStatistics before = proc.mProcMgr->SyncStats();
+
+  executeResult = true;
+
+  Thread th[8];
+  for (auto& t : th)
+    t.Run(sync_executor, nullptr);
+
+  for (auto& t : th)
+    t.WaitToEnd(true);
+
+  const SyncStatistics after = proc.mProcMgr->SyncStats();
+
+  return executeResult
+         && (after.mAquiresCount == before.mAquiresCount + 8 * 5 * 200)
+         && (after.mTimeoutsCount == before.mTimeoutsCount);
+}
+
+
+int
+main()
+{
+  bool success = true;
+
+  {
+    DBSInit(DBSSettings());
+  }
+
+  DBSCreateDatabase(admin);
+  InitInterpreter();
+
+  {
+    ISession& commonSession = GetInstance(nullptr);
+
+    CompiledBufferUnit syncBuf(syncTestProgram,
+                               sizeof syncTestProgram,
+                               my_postman,
+                               syncTestProgram);
+
+    commonSession.LoadCompiledUnit(syncBuf);
+
+    success = success && test_wait_timeout(_SC(Session&, commonSession));
+    success = success && test_wait_order(_SC(Session&, commonSession));
+    success = success && test_contention(_SC(Session&, commonSession));
+
+    ReleaseInstance(commonSession);
+  }
+
+  CleanInterpreter();
+  DBSRemoveDatabase(admin);
+  DBSShoutdown();
+  if (!success)
+    {
+      std::cout << "TEST RESULT: FAIL" << std::endl;
+      return 1;
+    }
+
+  std::cout << "TEST RESULT: PASS" << std::endl;
+
+  return 0;
+}
+
+#ifdef ENABLE_MEMORY_TRACE
+uint32_t WMemoryTracker::smInitCount = 0;
+const char* WMemoryTracker::smModule = "T";
+#endif
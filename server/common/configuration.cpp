@@ -46,6 +46,10 @@ static const char CIPHER_3K[] = "3k";
 static const char CIPHER_DES[] = "des";
 static const char CIPHER_3DES[] = "3des";
 
+static const char DURABILITY_ASYNC_NAME[] = "async";
+static const char DURABILITY_PROCEDURE_NAME[] = "procedure";
+static const char DURABILITY_WRITE_NAME[] = "write";
+
 static const uint_t MIN_TABLE_CACHE_BLOCK_SIZE = 1024;
 static const uint_t MIN_TABLE_CACHE_BLOCK_COUNT = 128;
 static const uint_t MIN_VL_BLOCK_SIZE = 1024;
@@ -62,6 +66,8 @@ static const uint_t DEFAULT_WAIT_TMO_MS = 60 * 1000;
 static const uint_t DEFAULT_SYNC_INTERVAL_MS = 0;
 static const uint_t DEFAULT_SYNC_WAKEUP_MS = 1000;
 static const uint_t DEFAULT_AUTH_TMO_MS = 1000;
+static const uint_t DEFAULT_JIT_CALLS_THRESHOLD = 64;
+static const uint_t DEFAULT_SYNC_WAIT_TMO_MS = 0;
 
 static const string gEntPort("listen");
 static const string gEntMaxConnections("max_connections");
@@ -72,6 +78,8 @@ static const string gEntTableBlkCount("table_block_cache_count");
 static const string gEntVlBlkSize("vl_values_block_size");
 static const string gEntVlBlkCount("vl_values_block_count");
 static const string gEntTempCache("temporals_cache");
+static const string gEntTempMemory("temporals_memory_limit");
+static const string gEntSessionTempMemory("session_temporals_memory_limit");
 static const string gEntAuthTMO("auth_tmo_ms");
 static const string gEntRequestTMO("request_tmo_ms");
 static const string gEntSyncInterval("sync_interval_ms");
@@ -86,6 +94,12 @@ static const string gEntNativeLib("load_native");
 static const string gEntRootPasswrd("admin_password");
 static const string gEntUserPasswrd("user_password");
 static const string gEntStackCount("max_stack_count");
+static const string gEntJitCompile("jit_compile");
+static const string gEntJitThreshold("jit_calls_threshold");
+static const string gEntSyncWaitTMO("sync_wait_tmo_ms");
+static const string gEntDurability("durability");
+static const string gEntCheckpointBatch("checkpoint_batch");
+static const string gEntCheckpointPause("checkpoint_pause_ms");
 
 static ServerSettings gMainSettings;
 
@@ -305,6 +319,21 @@ bool ParseConfigurationSection(ifstream& config, uint_t& inoutConfigLine, ostrea
         return false;
       }
     }
+    else if ((token == gEntTempMemory) || (token == gEntSessionTempMemory))
+    {
+      uint64_t& limit = (token == gEntTempMemory)
+                          ? gMainSettings.mTempMemoryLimit
+                          : gMainSettings.mSessionTempMemoryLimit;
+
+      token = NextToken(line, pos, delimiters);
+      limit = strtoull(token.c_str(), nullptr, 10);
+
+      if (limit == 0)
+      {
+        errOut << "Configuration error at line " << inoutConfigLine << ".\n";
+        return false;
+      }
+    }
     else if (token == gEntAuthTMO)
     {
       token = NextToken(line, pos, delimiters);
@@ -480,6 +509,93 @@ bool ParseConfigurationSection(ifstream& config, uint_t& inoutConfigLine, ostrea
         return false;
       }
     }
+    else if (token == gEntJitCompile)
+    {
+      token = NextToken(line, pos, delimiters);
+
+      if (token == "false")
+        gMainSettings.mJitCompile = false;
+
+      else if (token == "true")
+        gMainSettings.mJitCompile = true;
+
+      else
+      {
+        errOut << "Cannot assign '" << token << "\' to '" << gEntJitCompile << "' at line "
+            << inoutConfigLine << ". Valid value are only 'true' or 'false'.\n";
+        return false;
+      }
+    }
+    else if (token == gEntJitThreshold)
+    {
+      token = NextToken(line, pos, delimiters);
+      gMainSettings.mJitCallsThreshold = atoi(token.c_str());
+
+      if (gMainSettings.mJitCallsThreshold == 0)
+      {
+        errOut << "At line " << inoutConfigLine << " the JIT calls threshold parameter should"
+            " be an integer value bigger than 0.\n";
+        return false;
+      }
+    }
+    else if (token == gEntSyncWaitTMO)
+    {
+      token = NextToken(line, pos, delimiters);
+      gMainSettings.mSyncWaitTmo = atoi(token.c_str());
+
+      if (gMainSettings.mSyncWaitTmo < 0)
+      {
+        errOut << "At line " << inoutConfigLine << " the sync statements wait timeout parameter"
+            " should be a positive integer value (or 0 to wait without a timeout).\n";
+        return false;
+      }
+    }
+    else if (token == gEntDurability)
+    {
+      token = NextToken(line, pos, delimiters);
+      std::transform(token.begin(), token.end(), token.begin(), wh_to_lowercase);
+
+      if (token == DURABILITY_ASYNC_NAME)
+        gMainSettings.mDurability = DURABILITY_ASYNC;
+
+      else if (token == DURABILITY_PROCEDURE_NAME)
+        gMainSettings.mDurability = DURABILITY_PER_PROCEDURE;
+
+      else if (token == DURABILITY_WRITE_NAME)
+        gMainSettings.mDurability = DURABILITY_PER_WRITE;
+
+      else
+      {
+        errOut << "Cannot assign '" << token << "\' to '" << gEntDurability << "' at line "
+            << inoutConfigLine << ". Valid values are only '" << DURABILITY_ASYNC_NAME << "', '"
+            << DURABILITY_PROCEDURE_NAME << "' or '" << DURABILITY_WRITE_NAME << "'.\n";
+        return false;
+      }
+    }
+    else if (token == gEntCheckpointBatch)
+    {
+      token = NextToken(line, pos, delimiters);
+      gMainSettings.mCheckpointBatch = atoi(token.c_str());
+
+      if (gMainSettings.mCheckpointBatch == 0)
+      {
+        errOut << "At line " << inoutConfigLine << " the checkpoint batch parameter should"
+            " be an integer value bigger than 0.\n";
+        return false;
+      }
+    }
+    else if (token == gEntCheckpointPause)
+    {
+      token = NextToken(line, pos, delimiters);
+      gMainSettings.mCheckpointPause = atoi(token.c_str());
+
+      if (gMainSettings.mCheckpointPause < 0)
+      {
+        errOut << "At line " << inoutConfigLine << " the checkpoint pause parameter should"
+            " be a positive integer value (or 0 to not pause at all).\n";
+        return false;
+      }
+    }
     else
     {
       errOut << "At line " << inoutConfigLine << ": Don't know what to do with '" << token
@@ -1018,6 +1134,28 @@ bool PrepareConfigurationSection(Logger& log)
   log.Log(LT_INFO, logStream.str());
   logStream.str(CLEAR_LOG_STREAM);
 
+  if (gMainSettings.mTempMemoryLimit == UNSET_VALUE)
+  {
+    gMainSettings.mTempMemoryLimit = DEFAULT_TEMP_MEMORY_LIMIT;
+    if (gMainSettings.mShowDebugLog)
+      log.Log(LT_DEBUG, "The temporal values memory limit is set by default");
+  }
+  logStream << "The temporal values memory limit set at " << gMainSettings.mTempMemoryLimit
+      << " bytes.";
+  log.Log(LT_INFO, logStream.str());
+  logStream.str(CLEAR_LOG_STREAM);
+
+  if (gMainSettings.mSessionTempMemoryLimit == UNSET_VALUE)
+  {
+    gMainSettings.mSessionTempMemoryLimit = DEFAULT_SESSION_TEMP_MEMORY_LIMIT;
+    if (gMainSettings.mShowDebugLog)
+      log.Log(LT_DEBUG, "The session's temporal values memory limit is set by default");
+  }
+  logStream << "The session's temporal values memory limit set at "
+      << gMainSettings.mSessionTempMemoryLimit << " bytes.";
+  log.Log(LT_INFO, logStream.str());
+  logStream.str(CLEAR_LOG_STREAM);
+
   //Authentication timeout
   if (gMainSettings.mAuthTMO == UNSET_VALUE)
   {
@@ -1063,6 +1201,74 @@ bool PrepareConfigurationSection(Logger& log)
   log.Log(LT_INFO, logStream.str());
   logStream.str(CLEAR_LOG_STREAM);
 
+  //Procedures JIT compilation
+  if (gMainSettings.mJitCallsThreshold == UNSET_VALUE)
+  {
+    gMainSettings.mJitCallsThreshold = DEFAULT_JIT_CALLS_THRESHOLD;
+    if (gMainSettings.mShowDebugLog)
+      log.Log(LT_DEBUG, "The JIT calls threshold is set by default.");
+  }
+
+  if ( !gMainSettings.mJitCompile)
+  {
+    gMainSettings.mJitCallsThreshold = 0;
+    log.Log(LT_INFO, "The JIT compilation of procedures is disabled.");
+  }
+  else
+  {
+    logStream << "Procedures are JIT compiled after " << gMainSettings.mJitCallsThreshold
+        << " calls.";
+    log.Log(LT_INFO, logStream.str());
+    logStream.str(CLEAR_LOG_STREAM);
+  }
+
+  //Procedures' sync statements wait timeout
+  if (gMainSettings.mSyncWaitTmo == UNSET_VALUE)
+  {
+    gMainSettings.mSyncWaitTmo = DEFAULT_SYNC_WAIT_TMO_MS;
+    if (gMainSettings.mShowDebugLog)
+      log.Log(LT_DEBUG, "The sync statements wait timeout is set by default.");
+  }
+
+  if (gMainSettings.mSyncWaitTmo == 0)
+    log.Log(LT_INFO, "The sync statements are waited without a timeout.");
+  else
+  {
+    logStream << "The sync statements wait timeout is set at " << gMainSettings.mSyncWaitTmo
+        << " milliseconds.";
+    log.Log(LT_INFO, logStream.str());
+    logStream.str(CLEAR_LOG_STREAM);
+  }
+
+  //Tables updates durability
+  switch (gMainSettings.mDurability)
+  {
+  case DURABILITY_PER_PROCEDURE:
+    log.Log(LT_INFO, "The tables updates are made durable at the end of each procedure call.");
+    break;
+
+  case DURABILITY_PER_WRITE:
+    log.Log(LT_INFO, "The tables updates are made durable one by one.");
+    break;
+
+  default:
+    log.Log(LT_INFO, "The tables updates are made durable when the tables are synchronized.");
+  }
+
+  //Tables synchronization pace
+  if (gMainSettings.mCheckpointBatch == UNSET_VALUE)
+  {
+    gMainSettings.mCheckpointBatch = DEFAULT_CHECKPOINT_BATCH;
+    if (gMainSettings.mShowDebugLog)
+      log.Log(LT_DEBUG, "The checkpoint batch is set by default.");
+  }
+
+  logStream << "The tables are synchronized " << gMainSettings.mCheckpointBatch
+      << " blocks at a time, with a pause of " << gMainSettings.mCheckpointPause
+      << " milliseconds between them.";
+  log.Log(LT_INFO, logStream.str());
+  logStream.str(CLEAR_LOG_STREAM);
+
   return true;
 }
 
@@ -55,12 +55,20 @@ struct ServerSettings
       mVLBlockSize(UNSET_VALUE),
       mVLBlockCount(UNSET_VALUE),
       mTempValuesCache(UNSET_VALUE),
+      mTempMemoryLimit(UNSET_VALUE),
+      mSessionTempMemoryLimit(UNSET_VALUE),
       mAuthTMO(UNSET_VALUE),
       mSyncWakeup(UNSET_VALUE),
       mSyncInterval(UNSET_VALUE),
       mWaitReqTmo(UNSET_VALUE),
       mCipher(UNSET_VALUE),
-      mShowDebugLog(false)
+      mJitCallsThreshold(UNSET_VALUE),
+      mSyncWaitTmo(UNSET_VALUE),
+      mDurability(whais::DURABILITY_ASYNC),
+      mCheckpointBatch(UNSET_VALUE),
+      mCheckpointPause(UNSET_VALUE),
+      mShowDebugLog(false),
+      mJitCompile(false)
   {}
 
   uint_t                   mMaxConnections;
@@ -70,6 +78,8 @@ struct ServerSettings
   uint_t                   mVLBlockSize;
   uint_t                   mVLBlockCount;
   uint_t                   mTempValuesCache;
+  uint64_t                 mTempMemoryLimit;
+  uint64_t                 mSessionTempMemoryLimit;
   int                      mAuthTMO;
   int                      mSyncWakeup;
   int                      mSyncInterval;
@@ -79,7 +89,15 @@ struct ServerSettings
   std::string              mLogFile;
   std::vector<ListenEntry> mListens;
   uint8_t                  mCipher;
+  uint_t                   mJitCallsThreshold;
+  int                      mSyncWaitTmo;
+  whais::DBS_DURABILITY    mDurability;
+  uint_t                   mCheckpointBatch;
+  int                      mCheckpointPause;
   bool                     mShowDebugLog;
+  //Off unless asked for, as the JIT translates only the procedures' control
+  //flow for now.
+  bool                     mJitCompile;
 
 };
 
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <vector>
 
 #include "dbs/dbs_mgr.h"
+#include "dbs/dbs_exception.h"
 #include "interpreter/interpreter.h"
 #include "compiler//compiledunit.h"
 #include "utils/logger.h"
@@ -49,8 +50,34 @@ LoadDatabase(FileLogger& log, DBSDescriptors& inoutDesc)
   log.Log(LT_INFO, logEntry.str());
   logEntry.str(CLEAR_LOG_STREAM);
 
-  inoutDesc.mDbs = &DBSRetrieveDatabase(inoutDesc.mDbsName.c_str(),
-                                        inoutDesc.mDbsDirectory.c_str());
+  try
+  {
+    inoutDesc.mDbs = &DBSRetrieveDatabase(inoutDesc.mDbsName.c_str(),
+                                          inoutDesc.mDbsDirectory.c_str());
+  }
+  catch (const DBSException& e)
+  {
+    if (e.Code() != DBSException::DATABASE_IN_USE)
+      throw;
+
+    logEntry << "Database '" << inoutDesc.mDbsName << "' was not closed properly. "
+                "Replaying the updates logged since its last checkpoint.";
+    log.Log(LT_INFO, logEntry.str());
+    logEntry.str(CLEAR_LOG_STREAM);
+
+    if ( ! DBSRecoverDatabase(inoutDesc.mDbsName.c_str(), inoutDesc.mDbsDirectory.c_str()))
+    {
+      logEntry << "Database '" << inoutDesc.mDbsName << "' could not be recovered from its "
+                  "redo log. It needs to be checked for errors.";
+      log.Log(LT_ERROR, logEntry.str());
+      logEntry.str(CLEAR_LOG_STREAM);
+
+      throw;
+    }
+
+    inoutDesc.mDbs = &DBSRetrieveDatabase(inoutDesc.mDbsName.c_str(),
+                                          inoutDesc.mDbsDirectory.c_str());
+  }
   std::unique_ptr<Logger> dbsLogger = unique_make(FileLogger, inoutDesc.mDbsLogFile.c_str(), true);
 
   logEntry << "Sync interval is set at " << inoutDesc.mSyncInterval << " milliseconds";
@@ -80,6 +107,26 @@ LoadDatabase(FileLogger& log, DBSDescriptors& inoutDesc)
     logEntry.str(CLEAR_LOG_STREAM);
   }
 
+  temp = GetAdminSettings().mJitCallsThreshold;
+  if ((temp != 0) && ! inoutDesc.mSession->NotifyEvent(ISession::JIT_CALLS_THRESHOLD, &temp))
+  {
+    logEntry << "The procedures of session '" << inoutDesc.mDbsName
+             << "' will not be JIT compiled.";
+
+    log.Log(LT_INFO, logEntry.str());
+    logEntry.str(CLEAR_LOG_STREAM);
+  }
+
+  temp = GetAdminSettings().mSyncWaitTmo;
+  if ((temp != 0) && ! inoutDesc.mSession->NotifyEvent(ISession::SYNC_WAIT_TMO, &temp))
+  {
+    logEntry << "Failed to set the sync statements wait timeout for session '"
+             << inoutDesc.mDbsName << "'.";
+
+    log.Log(LT_ERROR, logEntry.str());
+    logEntry.str(CLEAR_LOG_STREAM);
+  }
+
   for (const auto& lib : inoutDesc.mNativeLibs)
   {
     logEntry << "... Loading dynamic native library '" << lib << "'.";
@@ -107,3 +154,16 @@ LoadDatabase(FileLogger& log, DBSDescriptors& inoutDesc)
 
   return true;
 }
+
+void
+LogTempMemoryStats(Logger& log)
+{
+  const DBSTempMemoryStats stats = DBSGetTempMemoryStats();
+
+  ostringstream logEntry;
+  logEntry << "Temporal values memory peak usage was " << stats.mPeak << " bytes. "
+           << stats.mSpillsCount << " temporal values (" << stats.mSpilledBytes
+           << " bytes) had to be moved to files.";
+
+  log.Log(LT_INFO, logEntry.str());
+}
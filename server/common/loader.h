@@ -33,5 +33,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 bool
 LoadDatabase(whais::FileLogger& log, DBSDescriptors& inoutDesc);
 
+void
+LogTempMemoryStats(whais::Logger& log);
+
 #endif /* LOADER_H_ */
 
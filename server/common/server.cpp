@@ -44,6 +44,7 @@ static vector<DBSDescriptors>*     sDbsDescriptors;
 static FileLogger*                 sMainLog;
 static bool                        sAcceptUsersConnections;
 static bool                        sServerStopped;
+static bool                        sCheckpointerStopped;
 static Lock                        sClosingLock;
 static int32_t                     sListenersMaxFails;
 
@@ -279,70 +280,68 @@ client_handler_routine(void* args)
 
 
 static void
-ticks_routine()
+checkpointer_routine(void*)
 {
   const uint_t syncWakeup = GetAdminSettings().mSyncWakeup;
 
-  uint_t syncElapsedTicks = 0, reqCheckElapsedTics = 0;
-  do
+  uint_t syncElapsedTicks = 0;
+  while ( ! (sServerStopped || sCheckpointerStopped))
   {
-    if (sServerStopped || sListenersMaxFails <= 0)
-      break;
-
     wh_sleep(SLEEP_TICK_RESOLUTION);
     syncElapsedTicks += SLEEP_TICK_RESOLUTION;
-    reqCheckElapsedTics += SLEEP_TICK_RESOLUTION;
 
-    if (syncElapsedTicks < syncWakeup
-        && reqCheckElapsedTics < REQ_TICK_RESOLUTION)
-    {
+    if (syncElapsedTicks < syncWakeup)
       continue;
-    }
 
-    for (size_t i = 0;
-        (syncElapsedTicks >= syncWakeup) && (i < sDbsDescriptors->size());
-        ++i)
+    syncElapsedTicks = 0;
+    for (size_t i = 0; i < sDbsDescriptors->size(); ++i)
     {
-      if (sServerStopped)
+      if (sServerStopped || sCheckpointerStopped)
         break;
 
-      const uint64_t dbsLstFlush = ( *sDbsDescriptors)[i].mLastFlushTick;
-      const int dbsSyncTmo = ( *sDbsDescriptors)[i].mSyncInterval;
+      DBSDescriptors& desc = ( *sDbsDescriptors)[i];
 
-      if (_SC(int64_t, wh_msec_ticks() - dbsLstFlush) < dbsSyncTmo)
+      if (_SC(int64_t, wh_msec_ticks() - desc.mLastFlushTick) < desc.mSyncInterval)
         continue;
 
-      IDBSHandler& hnd = *(( *sDbsDescriptors)[i].mDbs);
-      const TABLE_INDEX tablesCount = hnd.PersistentTablesCount();
-      for (TABLE_INDEX t = 0; t < tablesCount; ++t)
+      //The tables are written a few blocks at a time, so the requests served
+      //meanwhile do not have to wait for the whole database to be flushed.
+      try
       {
-        if (sServerStopped)
-          break;
-
-        hnd.SyncTableContent(t);
+        desc.mDbs->SyncAllTablesContent();
       }
+      catch (Exception& e)
+      {
+        ostringstream logEntry;
+
+        logEntry << "Failed to synchronize the database '" << desc.mDbsName << "'.\n"
+                 << "Description:\n" << e.Description() << endl;
 
-      if ( !sServerStopped)
-        (*sDbsDescriptors)[i].mDbs->SyncAllTablesContent();
+        if ( ! e.Message().empty())
+          logEntry << "Message:\n" << e.Message() << endl;
 
-      (*sDbsDescriptors)[i].mLastFlushTick = wh_msec_ticks();
+        logEntry << "Extra: " << e.Code() << " (" << e.File() << ':' << e.Line() << ").";
+        sMainLog->Log(LT_ERROR, logEntry.str());
+      }
+
+      desc.mLastFlushTick = wh_msec_ticks();
     }
+  }
+}
+
 
+static void
+ticks_routine()
+{
+  do
+  {
     if (sServerStopped || sListenersMaxFails <= 0)
       break;
 
-    if (syncElapsedTicks >= syncWakeup)
-      syncElapsedTicks = 0;
+    wh_sleep(REQ_TICK_RESOLUTION);
 
-    for (uint_t i = 0;
-        (reqCheckElapsedTics >= REQ_TICK_RESOLUTION) && (i < sListeners->size());
-        ++i)
-    {
+    for (uint_t i = 0; i < sListeners->size(); ++i)
       (*sListeners)[i].ReqTmoCloseTick();
-    }
-
-    if (reqCheckElapsedTics >= REQ_TICK_RESOLUTION)
-      reqCheckElapsedTics = 0;
 
   } while (true);
 
@@ -487,10 +486,20 @@ StartServer(FileLogger& log, vector<DBSDescriptors>& databases)
     }
   }
 
+  Thread checkpointer;
+
+  sCheckpointerStopped = false;
+  checkpointer.IgnoreExceptions(true);
+  if ( ! checkpointer.Run(checkpointer_routine, nullptr))
+    log.Log(LT_ERROR, "Failed to start the databases checkpointer.");
+
   log.Log(LT_INFO, "Server has started!");
   ticks_routine();
   log.Log(LT_DEBUG, "Ticks routine has stopped.");
 
+  sCheckpointerStopped = true;
+  checkpointer.WaitToEnd(false);
+
   LockGuard<Lock> holder(sClosingLock);
   sListeners = nullptr;
   holder.unlock();
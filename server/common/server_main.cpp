@@ -101,7 +101,10 @@ clean_frameworks(FileLogger& log)
     }
   }
   if (sDbsInited)
+  {
+    LogTempMemoryStats(log);
     DBSShoutdown();
+  }
 }
 
 
@@ -281,6 +284,11 @@ main(int argc, char** argv)
     dbsSettings.mVLStoreCacheBlkCount = confSettings.mVLBlockCount;
     dbsSettings.mVLStoreCacheBlkSize  = confSettings.mVLBlockSize;
     dbsSettings.mVLValueCacheSize     = confSettings.mTempValuesCache;
+    dbsSettings.mTempMemoryLimit      = confSettings.mTempMemoryLimit;
+    dbsSettings.mSessionTempMemoryLimit = confSettings.mSessionTempMemoryLimit;
+    dbsSettings.mDurability           = confSettings.mDurability;
+    dbsSettings.mCheckpointBatch      = confSettings.mCheckpointBatch;
+    dbsSettings.mCheckpointPause      = confSettings.mCheckpointPause;
 
     DBSInit(dbsSettings);
     sDbsInited = true;
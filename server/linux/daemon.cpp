@@ -110,7 +110,10 @@ clean_frameworks(FileLogger& log)
   }
 
   if (sDbsInited)
+  {
+    LogTempMemoryStats(log);
     DBSShoutdown();
+  }
 }
 
 static void
@@ -271,6 +274,11 @@ boot_server()
     dbsSettings.mVLStoreCacheBlkCount = confSettings.mVLBlockCount;
     dbsSettings.mVLStoreCacheBlkSize  = confSettings.mVLBlockSize;
     dbsSettings.mVLValueCacheSize     = confSettings.mTempValuesCache;
+    dbsSettings.mTempMemoryLimit      = confSettings.mTempMemoryLimit;
+    dbsSettings.mSessionTempMemoryLimit = confSettings.mSessionTempMemoryLimit;
+    dbsSettings.mDurability           = confSettings.mDurability;
+    dbsSettings.mCheckpointBatch      = confSettings.mCheckpointBatch;
+    dbsSettings.mCheckpointPause      = confSettings.mCheckpointPause;
 
     DBSInit(dbsSettings);
     sDbsInited = true;
@@ -211,7 +211,10 @@ clean_frameworks(FileLogger& log)
     }
 
   if (sDbsInited)
-    DBSShoutdown();
+    {
+      LogTempMemoryStats(log);
+      DBSShoutdown();
+    }
 }
 
 
@@ -347,6 +350,11 @@ boot_server(const char* configFile, ostream& errOut)
     dbsSettings.mVLStoreCacheBlkCount = confSettings.mVLBlockCount;
     dbsSettings.mVLStoreCacheBlkSize  = confSettings.mVLBlockSize;
     dbsSettings.mVLValueCacheSize     = confSettings.mTempValuesCache;
+    dbsSettings.mTempMemoryLimit      = confSettings.mTempMemoryLimit;
+    dbsSettings.mSessionTempMemoryLimit = confSettings.mSessionTempMemoryLimit;
+    dbsSettings.mDurability           = confSettings.mDurability;
+    dbsSettings.mCheckpointBatch      = confSettings.mCheckpointBatch;
+    dbsSettings.mCheckpointPause      = confSettings.mCheckpointPause;
 
     DBSInit(dbsSettings);
     sDbsInited = true;
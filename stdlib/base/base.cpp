@@ -191,6 +191,7 @@ static const WLIB_PROC_DESCRIPTION* sgRegisteredProcs[] = {
                                                     &gTextHash,
                                                     &gCharFind,
                                                     &gTextFind,
+                                                    &gTextFindRows,
                                                     &gTextReplace,
                                                     &gTextCompare,
                           /* Array procedures */
@@ -200,14 +201,29 @@ static const WLIB_PROC_DESCRIPTION* sgRegisteredProcs[] = {
                                                     &gProcArrayMax,
                                                     &gProcArrayTruncate,
                                                     &gProcArrayHash,
+                                                    &gProcArraySum,
+                                                    &gProcArrayAverage,
+                                                    &gProcArrayDot,
+                                                    &gProcArrayHistogram,
                           /* Field procedures */
                                                     &gProcFieldTable,
                                                     &gProcIsFielsIndexed,
                                                     &gProcFieldName,
                                                     &gProcFindValueRange,
                                                     &gProcFilterRows,
+                                                    &gProcMatchArrayRows,
+                                                    &gProcFetchIndexEntries,
                                                     &gProcFieldMinimum,
                                                     &gProcFieldMaximum,
+                                                    &gProcFieldSum,
+                                                    &gProcFieldAverage,
+                                                    &gProcFieldMinValue,
+                                                    &gProcFieldMaxValue,
+                                                    &gProcFieldCount,
+                                                    &gProcGroupRows,
+                                                    &gProcGroupCount,
+                                                    &gProcGroupSum,
+                                                    &gProcGroupAverage,
                           /* Table procedures */
                                                     &gProcTableIsPersistent,
                                                     &gProcTableFieldsCount,
@@ -218,7 +234,8 @@ static const WLIB_PROC_DESCRIPTION* sgRegisteredProcs[] = {
                                                     &gProcTableFindRemovedRow,
                                                     &gProcTableRemoveRow,
                                                     &gProcTableExchangeRows,
-                                                    &gProcTableSort
+                                                    &gProcTableSort,
+                                                    &gProcTableDeferIndexUpdates
                                                           };
 
 static const WLIB_DESCRIPTION sgLibraryDescription =
@@ -24,6 +24,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <cassert>
 #include <algorithm>
+#include <limits>
+#include <vector>
 
 #include "utils/we_int128.h"
 #include "utils/whash.h"
@@ -45,6 +47,136 @@ WLIB_PROC_DESCRIPTION         gProcArrayMax;
 WLIB_PROC_DESCRIPTION         gProcArrayTruncate;
 WLIB_PROC_DESCRIPTION         gProcArrayHash;
 
+WLIB_PROC_DESCRIPTION         gProcArraySum;
+WLIB_PROC_DESCRIPTION         gProcArrayAverage;
+WLIB_PROC_DESCRIPTION         gProcArrayDot;
+WLIB_PROC_DESCRIPTION         gProcArrayHistogram;
+
+
+//The array elements are processed in chunks copied in contiguous buffers,
+//rather than being retrieved one at a time.
+static const uint_t ARRAY_CHUNK_SIZE = 256;
+
+static const uint_t DEFAULT_HISTOGRAM_BUCKETS = 10;
+
+
+//The values the kernels below work with. For the integer types these are
+//the plain native values, so the compiler may vectorize the loops.
+template<typename T> struct KernelValue
+{
+  typedef T VALUE;
+
+  static const T& Get(const T& value) { return value; }
+};
+
+#define NATIVE_KERNEL_VALUE(DT, NT)                           \
+  template<> struct KernelValue<DT>                           \
+  {                                                           \
+    typedef NT VALUE;                                         \
+                                                              \
+    static NT Get(const DT& value) { return value.mValue; }   \
+  };
+
+NATIVE_KERNEL_VALUE(DInt8, int8_t)
+NATIVE_KERNEL_VALUE(DInt16, int16_t)
+NATIVE_KERNEL_VALUE(DInt32, int32_t)
+NATIVE_KERNEL_VALUE(DInt64, int64_t)
+NATIVE_KERNEL_VALUE(DUInt8, uint8_t)
+NATIVE_KERNEL_VALUE(DUInt16, uint16_t)
+NATIVE_KERNEL_VALUE(DUInt32, uint32_t)
+NATIVE_KERNEL_VALUE(DUInt64, uint64_t)
+
+#undef NATIVE_KERNEL_VALUE
+
+
+template<typename V> bool
+kernel_minim(const V* const values, const uint_t count, const V& margin, V& inoutMinim)
+{
+  bool found = false;
+
+  for (uint_t i = 0; i < count; ++i)
+  {
+    const bool inRange = ! (values[i] < margin);
+
+    found |= inRange;
+    inoutMinim = (inRange && (values[i] < inoutMinim)) ? values[i] : inoutMinim;
+  }
+
+  return found;
+}
+
+
+template<typename V> bool
+kernel_maxim(const V* const values, const uint_t count, const V& margin, V& inoutMaxim)
+{
+  bool found = false;
+
+  for (uint_t i = 0; i < count; ++i)
+  {
+    const bool inRange = ! (margin < values[i]);
+
+    found |= inRange;
+    inoutMaxim = (inRange && (inoutMaxim < values[i])) ? values[i] : inoutMaxim;
+  }
+
+  return found;
+}
+
+
+template<typename V> uint_t
+kernel_find(const V* const values, const uint_t count, const V& value)
+{
+  uint_t i = 0;
+  while ((i < count) && ! (values[i] == value))
+    ++i;
+
+  return i;
+}
+
+
+template<typename V> V
+kernel_sum(const V* const values, const uint_t count)
+{
+  V result(0);
+
+  for (uint_t i = 0; i < count; ++i)
+    result += values[i];
+
+  return result;
+}
+
+
+template<typename V> V
+kernel_dot(const V* const values1, const V* const values2, const uint_t count)
+{
+  V result(0);
+
+  for (uint_t i = 0; i < count; ++i)
+    result += values1[i] * values2[i];
+
+  return result;
+}
+
+
+static void
+kernel_histogram(const double* const values,
+                 const uint_t        count,
+                 const double        lower,
+                 const double        upper,
+                 const double        scale,
+                 const uint_t        bucketsCount,
+                 uint64_t* const     buckets)
+{
+  for (uint_t i = 0; i < count; ++i)
+  {
+    if ((values[i] < lower) || (upper < values[i]))
+      continue;
+
+    const uint_t bucket = (values[i] - lower) * scale;
+    ++buckets[MIN(bucket, bucketsCount - 1)];
+  }
+}
+
 
 
 static WLIB_STATUS
@@ -204,26 +336,40 @@ array_sort( SessionStack& stack, ISession&)
 template<typename T> DUInt64
 retrieve_minim_value( const DArray& array, T margin, const uint64_t from)
 {
+  typedef typename KernelValue<T>::VALUE V;
+
   const uint64_t count = array.Count();
 
   DUInt64 result;
-  T minim = T::Max();
+  if (from >= count)
+    return result;
 
   if (margin.IsNull())
     margin = T::Min();
 
-  for (uint64_t pos = from; pos < count; ++pos)
+  T elems[ARRAY_CHUNK_SIZE];
+  V values[ARRAY_CHUNK_SIZE];
+
+  const V lower = KernelValue<T>::Get(margin);
+  V minim = KernelValue<T>::Get(T::Max());
+
+  for (uint64_t pos = from; pos < count; pos += ARRAY_CHUNK_SIZE)
   {
-    T elem;
-    array.Get(pos, elem);
+    const uint_t chunkCount = array.Get(pos, ARRAY_CHUNK_SIZE, elems);
+    for (uint_t i = 0; i < chunkCount; ++i)
+      values[i] = KernelValue<T>::Get(elems[i]);
 
-    if (elem < minim && elem >= margin)
+    V chunkMinim = KernelValue<T>::Get(T::Max());
+    if ( ! kernel_minim(values, chunkCount, lower, chunkMinim))
+      continue;
+
+    if (result.IsNull() || (chunkMinim < minim))
     {
-      result = DUInt64(pos);
-      if (elem == margin)
-        break;
+      minim = chunkMinim;
+      result = DUInt64(pos + kernel_find(values, chunkCount, minim));
 
-      minim = elem;
+      if (minim == lower)
+        break;
     }
   }
 
@@ -234,26 +380,40 @@ retrieve_minim_value( const DArray& array, T margin, const uint64_t from)
 template<typename T> DUInt64
 retrieve_maxim_value( const DArray& array, T margin, const uint64_t from)
 {
+  typedef typename KernelValue<T>::VALUE V;
+
   const uint64_t count = array.Count();
 
   DUInt64 result;
+  if (from >= count)
+    return result;
 
-  T maxim = T::Min();
   if (margin.IsNull())
     margin = T::Max();
 
-  for (uint64_t pos = from; pos < count; ++pos)
+  T elems[ARRAY_CHUNK_SIZE];
+  V values[ARRAY_CHUNK_SIZE];
+
+  const V upper = KernelValue<T>::Get(margin);
+  V maxim = KernelValue<T>::Get(T::Min());
+
+  for (uint64_t pos = from; pos < count; pos += ARRAY_CHUNK_SIZE)
   {
-    T elem;
-    array.Get(pos, elem);
+    const uint_t chunkCount = array.Get(pos, ARRAY_CHUNK_SIZE, elems);
+    for (uint_t i = 0; i < chunkCount; ++i)
+      values[i] = KernelValue<T>::Get(elems[i]);
+
+    V chunkMaxim = KernelValue<T>::Get(T::Min());
+    if ( ! kernel_maxim(values, chunkCount, upper, chunkMaxim))
+      continue;
 
-    if (elem > maxim && elem <= margin)
+    if (result.IsNull() || (maxim < chunkMaxim))
     {
-      result = DUInt64(pos);
-      if (elem == margin)
-        break;
+      maxim = chunkMaxim;
+      result = DUInt64(pos + kernel_find(values, chunkCount, maxim));
 
-      maxim = elem;
+      if (maxim == upper)
+        break;
     }
   }
 
@@ -484,24 +644,15 @@ template<typename T> uint64_t
 compute_array_hash( const DArray& array)
 {
   uint8_t key[512];
+  T elems[(sizeof(key) - 1) / sizeof(T)];
 
-  const uint64_t arrayCount = array.Count();
+  assert(array.Count() > 0);
 
-  assert(arrayCount > 0);
+  const uint_t elemsCount = array.Get(0, sizeof(elems) / sizeof(elems[0]), elems);
+  for (uint_t i = 0; i < elemsCount; ++i)
+    memcpy(key + i * sizeof(T), elems + i, sizeof(T));
 
-  uint_t keyOff = 0;
-  uint_t arrayOff = 0;
-
-  T temp;
-  for (keyOff = 0, arrayOff = 0;
-       (keyOff < sizeof(key) - sizeof(temp)) && (arrayOff < arrayCount);
-       keyOff += sizeof(temp), ++arrayOff)
-  {
-    array.Get(arrayOff, temp);
-    memcpy(key + keyOff, &temp, sizeof(temp));
-  }
-
-  return wh_hash(key, keyOff);
+  return wh_hash(key, elemsCount * sizeof(T));
 }
 
 static WLIB_STATUS
@@ -593,6 +744,374 @@ proc_hash_array( SessionStack& stack, ISession&)
 }
 
 
+static bool
+is_integer_array(const DArray& array)
+{
+  switch (array.Type())
+  {
+  case T_INT8:
+  case T_INT16:
+  case T_INT32:
+  case T_INT64:
+  case T_UINT8:
+  case T_UINT16:
+  case T_UINT32:
+  case T_UINT64:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+
+static void
+check_numeric_array(const DArray& array)
+{
+  if (is_integer_array(array) || (array.Type() == T_REAL) || (array.Type() == T_RICHREAL))
+    return;
+
+  throw InterException(_EXTRA(InterException::INVALID_PARAMETER_TYPE),
+                       "Expected an array of numeric values.");
+}
+
+
+template<typename T, typename V> uint_t
+load_numeric_chunk(const DArray& array, const uint64_t from, V* const outValues)
+{
+  T elems[ARRAY_CHUNK_SIZE];
+
+  const uint_t count = array.Get(from, ARRAY_CHUNK_SIZE, elems);
+  for (uint_t i = 0; i < count; ++i)
+    outValues[i] = V(elems[i].mValue);
+
+  return count;
+}
+
+
+template<typename V> uint_t
+load_integers_chunk(const DArray& array, const uint64_t from, V* const outValues)
+{
+  switch (array.Type())
+  {
+  case T_INT8:
+    return load_numeric_chunk<DInt8>(array, from, outValues);
+
+  case T_INT16:
+    return load_numeric_chunk<DInt16>(array, from, outValues);
+
+  case T_INT32:
+    return load_numeric_chunk<DInt32>(array, from, outValues);
+
+  case T_INT64:
+    return load_numeric_chunk<DInt64>(array, from, outValues);
+
+  case T_UINT8:
+    return load_numeric_chunk<DUInt8>(array, from, outValues);
+
+  case T_UINT16:
+    return load_numeric_chunk<DUInt16>(array, from, outValues);
+
+  case T_UINT32:
+    return load_numeric_chunk<DUInt32>(array, from, outValues);
+
+  case T_UINT64:
+    return load_numeric_chunk<DUInt64>(array, from, outValues);
+
+  default:
+    throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+  }
+}
+
+
+static uint_t
+load_reals_chunk(const DArray& array, const uint64_t from, RICHREAL_T* const outValues)
+{
+  switch (array.Type())
+  {
+  case T_REAL:
+    return load_numeric_chunk<DReal>(array, from, outValues);
+
+  case T_RICHREAL:
+    return load_numeric_chunk<DRichReal>(array, from, outValues);
+
+  default:
+    break;
+  }
+
+  return load_integers_chunk(array, from, outValues);
+}
+
+
+static uint_t
+load_doubles_chunk(const DArray& array, const uint64_t from, double* const outValues)
+{
+  if (is_integer_array(array))
+    return load_integers_chunk(array, from, outValues);
+
+  RICHREAL_T values[ARRAY_CHUNK_SIZE];
+
+  const uint_t count = load_reals_chunk(array, from, values);
+  for (uint_t i = 0; i < count; ++i)
+  {
+    outValues[i] = _SC(double, values[i].Integer())
+                   + _SC(double, values[i].Fractional()) / values[i].Precision();
+  }
+
+  return count;
+}
+
+
+//The integers are summed up exactly and are converted only at the end.
+static WE_I128
+integers_sum(const DArray& array)
+{
+  const uint64_t count = array.Count();
+
+  WE_I128 values[ARRAY_CHUNK_SIZE];
+  WE_I128 result(0);
+
+  for (uint64_t from = 0; from < count; from += ARRAY_CHUNK_SIZE)
+    result += kernel_sum(values, load_integers_chunk(array, from, values));
+
+  return result;
+}
+
+
+static RICHREAL_T
+reals_sum(const DArray& array)
+{
+  const uint64_t count = array.Count();
+
+  RICHREAL_T values[ARRAY_CHUNK_SIZE];
+  RICHREAL_T result;
+
+  for (uint64_t from = 0; from < count; from += ARRAY_CHUNK_SIZE)
+    result += kernel_sum(values, load_reals_chunk(array, from, values));
+
+  return result;
+}
+
+
+template<bool average> WLIB_STATUS
+proc_array_sum( SessionStack& stack, ISession&)
+{
+  DArray array;
+
+  const auto firstParam = stack.Size() - 1;
+
+  IOperand& op = stack[firstParam].Operand();
+  if ( ! op.IsNull())
+    op.GetValue(array);
+
+  if (array.IsNull())
+  {
+    stack[firstParam] = StackValue();
+    return WOP_OK;
+  }
+
+  check_numeric_array(array);
+
+  const uint64_t count = array.Count();
+
+  RICHREAL_T result;
+  if (is_integer_array(array))
+  {
+    const WE_I128 sum = integers_sum(array);
+
+    if (average)
+    {
+      //Divide first, to keep the big sums in the range of a rich real value.
+      const RICHREAL_T quotient = sum / count;
+      const RICHREAL_T reminder = sum % count;
+
+      result = quotient + reminder / RICHREAL_T(count);
+    }
+    else
+      result = RICHREAL_T(sum);
+  }
+  else
+  {
+    result = reals_sum(array);
+    if (average)
+      result = result / RICHREAL_T(count);
+  }
+
+  stack[firstParam] = StackValue::Create(DRichReal(result));
+
+  return WOP_OK;
+}
+
+
+static WLIB_STATUS
+proc_array_dot( SessionStack& stack, ISession&)
+{
+  DArray array1, array2;
+
+  const auto paramsCount = 2;
+  const auto firstParam = stack.Size() - paramsCount;
+
+  if ( ! stack[firstParam].Operand().IsNull())
+    stack[firstParam].Operand().GetValue(array1);
+
+  if ( ! stack[firstParam + 1].Operand().IsNull())
+    stack[firstParam + 1].Operand().GetValue(array2);
+
+  const uint64_t count = array1.Count();
+  if (count != array2.Count())
+  {
+    throw InterException(_EXTRA(InterException::INVALID_PARAMETER_VALUE),
+                         "Cannot compute the dot product of arrays with different "
+                         "elements count (%lu vs. %lu).",
+                         _SC(unsigned long, count),
+                         _SC(unsigned long, array2.Count()));
+  }
+
+  stack.Pop(paramsCount - 1);
+  if (count == 0)
+  {
+    stack[firstParam] = StackValue();
+    return WOP_OK;
+  }
+
+  check_numeric_array(array1);
+  check_numeric_array(array2);
+
+  RICHREAL_T result;
+  if (is_integer_array(array1) && is_integer_array(array2))
+  {
+    WE_I128 values1[ARRAY_CHUNK_SIZE], values2[ARRAY_CHUNK_SIZE];
+    WE_I128 intResult(0);
+
+    for (uint64_t from = 0; from < count; from += ARRAY_CHUNK_SIZE)
+    {
+      const uint_t chunkCount = load_integers_chunk(array1, from, values1);
+      load_integers_chunk(array2, from, values2);
+
+      intResult += kernel_dot(values1, values2, chunkCount);
+    }
+    result = RICHREAL_T(intResult);
+  }
+  else
+  {
+    RICHREAL_T values1[ARRAY_CHUNK_SIZE], values2[ARRAY_CHUNK_SIZE];
+
+    for (uint64_t from = 0; from < count; from += ARRAY_CHUNK_SIZE)
+    {
+      const uint_t chunkCount = load_reals_chunk(array1, from, values1);
+      load_reals_chunk(array2, from, values2);
+
+      result += kernel_dot(values1, values2, chunkCount);
+    }
+  }
+
+  stack[firstParam] = StackValue::Create(DRichReal(result));
+
+  return WOP_OK;
+}
+
+
+static double
+real_to_double(const DRichReal& value)
+{
+  return _SC(double, value.mValue.Integer())
+         + _SC(double, value.mValue.Fractional()) / value.mValue.Precision();
+}
+
+
+static WLIB_STATUS
+proc_array_histogram( SessionStack& stack, ISession&)
+{
+  DArray array;
+  DRichReal lower, upper;
+  DUInt32 bucketsCount;
+
+  const auto paramsCount = 4;
+  const auto firstParam = stack.Size() - paramsCount;
+
+  if ( ! stack[firstParam].Operand().IsNull())
+    stack[firstParam].Operand().GetValue(array);
+
+  stack[firstParam + 1].Operand().GetValue(lower);
+  stack[firstParam + 2].Operand().GetValue(upper);
+  stack[firstParam + 3].Operand().GetValue(bucketsCount);
+
+  if (bucketsCount.IsNull())
+    bucketsCount = DUInt32(DEFAULT_HISTOGRAM_BUCKETS);
+
+  else if (bucketsCount.mValue == 0)
+  {
+    throw InterException(_EXTRA(InterException::INVALID_PARAMETER_VALUE),
+                         "A histogram needs at least one bucket.");
+  }
+
+  stack.Pop(paramsCount - 1);
+  if (array.IsNull())
+  {
+    stack[firstParam] = StackValue();
+    return WOP_OK;
+  }
+
+  check_numeric_array(array);
+
+  const uint64_t count = array.Count();
+  double values[ARRAY_CHUNK_SIZE];
+
+  //Without explicit limits the histogram covers all the array's values.
+  double lowerLimit = lower.IsNull() ? 0 : real_to_double(lower);
+  double upperLimit = upper.IsNull() ? 0 : real_to_double(upper);
+  if (lower.IsNull() || upper.IsNull())
+  {
+    for (uint64_t from = 0; from < count; from += ARRAY_CHUNK_SIZE)
+    {
+      const uint_t chunkCount = load_doubles_chunk(array, from, values);
+
+      double chunkMinim = values[0], chunkMaxim = values[0];
+      kernel_minim(values, chunkCount, numeric_limits<double>::lowest(), chunkMinim);
+      kernel_maxim(values, chunkCount, numeric_limits<double>::max(), chunkMaxim);
+
+      if (lower.IsNull() && ((from == 0) || (chunkMinim < lowerLimit)))
+        lowerLimit = chunkMinim;
+
+      if (upper.IsNull() && ((from == 0) || (upperLimit < chunkMaxim)))
+        upperLimit = chunkMaxim;
+    }
+  }
+
+  if (upperLimit < lowerLimit)
+  {
+    throw InterException(_EXTRA(InterException::INVALID_PARAMETER_VALUE),
+                         "The histogram's lower limit is bigger than its upper limit.");
+  }
+
+  const double scale = (lowerLimit < upperLimit)
+                       ? bucketsCount.mValue / (upperLimit - lowerLimit)
+                       : 0;
+
+  vector<uint64_t> buckets(bucketsCount.mValue, 0);
+  for (uint64_t from = 0; from < count; from += ARRAY_CHUNK_SIZE)
+  {
+    const uint_t chunkCount = load_doubles_chunk(array, from, values);
+    kernel_histogram(values,
+                     chunkCount,
+                     lowerLimit,
+                     upperLimit,
+                     scale,
+                     bucketsCount.mValue,
+                     buckets.data());
+  }
+
+  vector<DUInt64> result;
+  result.reserve(buckets.size());
+  for (const auto bucket : buckets)
+    result.push_back(DUInt64(bucket));
+
+  stack[firstParam] = StackValue::Create(DArray(result.data(), result.size()));
+
+  return WOP_OK;
+}
+
+
 WLIB_STATUS
 base_arrays_init()
 {
@@ -656,6 +1175,48 @@ base_arrays_init()
   gProcArrayHash.localsTypes  = arrayCountLocals; //Reusing!
   gProcArrayHash.code         = proc_hash_array;
 
+
+  static const uint8_t* arraySumLocals[] = {
+                                              gRichRealType,
+                                              gGenericArrayType
+                                           };
+
+  gProcArraySum.name          = "sum";
+  gProcArraySum.localsCount   = 2;
+  gProcArraySum.localsTypes   = arraySumLocals;
+  gProcArraySum.code          = proc_array_sum<false>;
+
+  gProcArrayAverage.name      = "avg";
+  gProcArrayAverage.localsCount = 2;
+  gProcArrayAverage.localsTypes = arraySumLocals; //Reusing!
+  gProcArrayAverage.code      = proc_array_sum<true>;
+
+
+  static const uint8_t* arrayDotLocals[] = {
+                                              gRichRealType,
+                                              gGenericArrayType,
+                                              gGenericArrayType
+                                           };
+
+  gProcArrayDot.name          = "dot";
+  gProcArrayDot.localsCount   = 3;
+  gProcArrayDot.localsTypes   = arrayDotLocals;
+  gProcArrayDot.code          = proc_array_dot;
+
+
+  static const uint8_t* arrayHistogramLocals[] = {
+                                                    gAUInt64Type,
+                                                    gGenericArrayType,
+                                                    gRichRealType,
+                                                    gRichRealType,
+                                                    gUInt32Type
+                                                 };
+
+  gProcArrayHistogram.name        = "histogram";
+  gProcArrayHistogram.localsCount = 5;
+  gProcArrayHistogram.localsTypes = arrayHistogramLocals;
+  gProcArrayHistogram.code        = proc_array_histogram;
+
   return WOP_OK;
 }
 
@@ -34,6 +34,10 @@ extern whais::WLIB_PROC_DESCRIPTION         gProcArrayMin;
 extern whais::WLIB_PROC_DESCRIPTION         gProcArrayMax;
 extern whais::WLIB_PROC_DESCRIPTION         gProcArrayTruncate;
 extern whais::WLIB_PROC_DESCRIPTION         gProcArrayHash;
+extern whais::WLIB_PROC_DESCRIPTION         gProcArraySum;
+extern whais::WLIB_PROC_DESCRIPTION         gProcArrayAverage;
+extern whais::WLIB_PROC_DESCRIPTION         gProcArrayDot;
+extern whais::WLIB_PROC_DESCRIPTION         gProcArrayHistogram;
 
 whais::WLIB_STATUS
 base_arrays_init();
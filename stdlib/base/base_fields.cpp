@@ -23,7 +23,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
 #include <cassert>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "base_fields.h"
 #include "base_types.h"
@@ -38,10 +42,22 @@ WLIB_PROC_DESCRIPTION         gProcFieldName;
 
 WLIB_PROC_DESCRIPTION         gProcFindValueRange;
 WLIB_PROC_DESCRIPTION         gProcFilterRows;
+WLIB_PROC_DESCRIPTION         gProcMatchArrayRows;
+WLIB_PROC_DESCRIPTION         gProcFetchIndexEntries;
 
 WLIB_PROC_DESCRIPTION         gProcFieldMinimum;
 WLIB_PROC_DESCRIPTION         gProcFieldMaximum;
+
+WLIB_PROC_DESCRIPTION         gProcFieldSum;
 WLIB_PROC_DESCRIPTION         gProcFieldAverage;
+WLIB_PROC_DESCRIPTION         gProcFieldMinValue;
+WLIB_PROC_DESCRIPTION         gProcFieldMaxValue;
+WLIB_PROC_DESCRIPTION         gProcFieldCount;
+
+WLIB_PROC_DESCRIPTION         gProcGroupRows;
+WLIB_PROC_DESCRIPTION         gProcGroupCount;
+WLIB_PROC_DESCRIPTION         gProcGroupSum;
+WLIB_PROC_DESCRIPTION         gProcGroupAverage;
 
 
 
@@ -325,6 +341,125 @@ proc_field_find_range( SessionStack& stack, ISession&)
   return WOP_OK;
 }
 
+static WLIB_STATUS
+proc_field_match_array_rows(SessionStack& stack, ISession&)
+{
+  const auto stackTop = stack.Size() - 1;
+  IOperand& field = stack[stackTop - 4].Operand();
+
+  if (field.IsNullExpression() || field.IsNull())
+  {
+    stack.Pop(5);
+    stack.Push(DArray());
+
+    return WOP_OK;
+  }
+
+  const uint_t fieldType = field.GetType();
+  if ( ! IS_ARRAY(fieldType))
+  {
+    throw InterException(_EXTRA(InterException::INVALID_PARAMETER_TYPE),
+                         "Matching the elements of the rows values is available"
+                         " only for array fields.");
+  }
+
+  DArray values;
+  DBool matchAll;
+  DUInt32 from, to;
+
+  stack[stackTop - 3].Operand().GetValue(values);
+  stack[stackTop - 2].Operand().GetValue(matchAll);
+  stack[stackTop - 1].Operand().GetValue(from);
+  stack[stackTop - 0].Operand().GetValue(to);
+
+  if ( ! values.IsNull() && (GET_BASE_TYPE(values.Type()) != GET_BASE_TYPE(fieldType)))
+    throw InterException(_EXTRA(InterException::FIELD_TYPE_MISMATCH));
+
+  ITable& table = field.GetTable();
+
+  const ROW_INDEX fromRow = from.IsNull() ? 0 : from.mValue;
+  const ROW_INDEX toRow = to.IsNull() ? table.AllocatedRows() - 1 : to.mValue;
+
+  const DArray result = table.MatchArrayRows(values,
+                                             matchAll == DBool(true),
+                                             MIN(fromRow, toRow),
+                                             MAX(fromRow, toRow),
+                                             field.GetField()).ToArray();
+  stack.Pop(5);
+  stack.Push(result);
+
+  return WOP_OK;
+}
+
+
+static WLIB_STATUS
+proc_field_fetch_index_entries(SessionStack& stack, ISession&)
+{
+  const auto stackTop = stack.Size() - 1;
+  IOperand& field = stack[stackTop - 4].Operand();
+
+  if (field.IsNullExpression() || field.IsNull())
+  {
+    stack.Pop(4);
+    stack[stackTop - 4] = StackValue::Create(DUInt32(0));
+
+    return WOP_OK;
+  }
+
+  const uint_t fieldType = field.GetType();
+  if (IS_ARRAY(fieldType)
+      || (GET_BASE_TYPE(fieldType) <= T_UNKNOWN)
+      || (GET_BASE_TYPE(fieldType) >= T_TEXT))
+  {
+    throw InterException(_EXTRA(InterException::INVALID_PARAMETER_TYPE),
+                         "Walking the entries of an index is available only"
+                         " for fields of basic types.");
+  }
+
+  IOperand& valuesOp = stack[stackTop - 3].Operand();
+  IOperand& rowsOp = stack[stackTop - 2].Operand();
+
+  DArray values, rows;
+  DBool reverse;
+  DUInt32 count;
+
+  valuesOp.GetValue(values);
+  rowsOp.GetValue(rows);
+  stack[stackTop - 1].Operand().GetValue(reverse);
+  stack[stackTop - 0].Operand().GetValue(count);
+
+  if ( ! values.IsNull() && (GET_BASE_TYPE(values.Type()) != GET_BASE_TYPE(fieldType)))
+    throw InterException(_EXTRA(InterException::FIELD_TYPE_MISMATCH));
+
+  //The walk resumes after the last entry returned by the previous one.
+  ROW_INDEX afterRow = INVALID_ROW_INDEX;
+  if ( ! rows.IsNull())
+  {
+    DROW_INDEX lastRow;
+    rows.Get(rows.Count() - 1, lastRow);
+    afterRow = lastRow.mValue;
+  }
+
+  ITable& table = field.GetTable();
+
+  DArray outValues, outRows;
+  const uint_t fetched = table.FetchIndexEntries(field.GetField(),
+                                                 values,
+                                                 afterRow,
+                                                 reverse == DBool(true),
+                                                 count.IsNull() ? 0 : count.mValue,
+                                                 outValues,
+                                                 outRows);
+  valuesOp.SetValue(outValues);
+  rowsOp.SetValue(outRows);
+
+  stack.Pop(4);
+  stack[stackTop - 4] = StackValue::Create(DUInt32(fetched));
+
+  return WOP_OK;
+}
+
+
 template<typename T> bool
 is_in_set(const DArray& set, const T e, const bool addNull)
 {
@@ -752,33 +887,845 @@ field_search_minmax( SessionStack& stack, ISession&)
 }
 
 
+//The rows an aggregate works on: the ones in a range of rows, restricted
+//to the ones listed by an array when this one is provided.
+class RowsSelection
+{
+public:
+  RowsSelection(ITable& table, IOperand& opRows, IOperand& opFrom, IOperand& opTo)
+    : mRows(),
+      mFromRow(0),
+      mEndRow(0),
+      mCurrent(0)
+  {
+    const ROW_INDEX rowsCount = table.AllocatedRows();
+
+    if ( ! opRows.IsNull())
+      opRows.GetValue(mRows);
+
+    DROW_INDEX row;
+
+    opFrom.GetValue(row);
+    ROW_INDEX fromRow = row.IsNull() ? 0 : row.mValue;
+
+    opTo.GetValue(row);
+    ROW_INDEX toRow = row.IsNull() ? rowsCount : row.mValue;
+
+    if (toRow < fromRow)
+      swap(fromRow, toRow);
+
+    mEndRow  = (toRow < rowsCount) ? toRow + 1 : rowsCount;
+    mFromRow = MIN(fromRow, mEndRow);
+
+    Reset();
+  }
+
+  bool IsRange() const { return mRows.IsNull(); }
+  bool IsEmpty() const { return mFromRow == mEndRow; }
+  ROW_INDEX FromRow() const { return mFromRow; }
+  ROW_INDEX ToRow() const { return mEndRow - 1; }
+
+  void Reset() { mCurrent = IsRange() ? mFromRow : 0; }
+
+  //Retrieves the next chunk of selected rows. Returns 0 if there are
+  //no more rows left.
+  uint_t Fetch(ROW_INDEX* const outRows)
+  {
+    uint_t count = 0;
+
+    if (IsRange())
+    {
+      while ((count < ROWS_CHUNK_SIZE) && (mCurrent < mEndRow))
+        outRows[count++] = mCurrent++;
+
+      return count;
+    }
+
+    DROW_INDEX rows[ROWS_CHUNK_SIZE];
+    while ((count == 0) && (mCurrent < mRows.Count()))
+    {
+      const uint_t fetched = mRows.Get(mCurrent, ROWS_CHUNK_SIZE, rows);
+      for (uint_t i = 0; i < fetched; ++i)
+      {
+        if ((mFromRow <= rows[i].mValue) && (rows[i].mValue < mEndRow))
+          outRows[count++] = rows[i].mValue;
+      }
+      mCurrent += fetched;
+    }
+
+    return count;
+  }
+
+  static const uint_t ROWS_CHUNK_SIZE = 256;
+
+private:
+  DArray      mRows;
+  ROW_INDEX   mFromRow;
+  ROW_INDEX   mEndRow;
+  uint64_t    mCurrent;
+};
+
+
+enum FIELD_AGGREGATE
+{
+  AGGREGATE_SUM,
+  AGGREGATE_AVERAGE,
+  AGGREGATE_MINIMUM,
+  AGGREGATE_MAXIMUM,
+  AGGREGATE_COUNT,
+};
+
+
+static DRichReal
+to_rich_real(const WE_I128& value)
+{
+  return DRichReal(RICHREAL_T(value));
+}
+
+static DRichReal
+to_rich_real(const RICHREAL_T& value)
+{
+  return DRichReal(value);
+}
+
 template<typename T> DRichReal
-compute_integer_field_average_value(ITable& table, const FIELD_INDEX field)
+to_rich_real(const T& value)
 {
-  const uint64_t rowsCount = table.AllocatedRows();
-  uint64_t rowsAdded = 0;
-  WE_I128 sum = 0;
+  return DRichReal(RICHREAL_T(value.mValue));
+}
+
+
+static DRichReal
+average_value(const WE_I128& sum, const uint64_t count)
+{
+  //Divide first, to keep the big sums in the range of a rich real value.
+  const RICHREAL_T quotient = sum / count;
+  const RICHREAL_T reminder = sum % count;
+
+  return DRichReal(quotient + reminder / RICHREAL_T(count));
+}
+
+static DRichReal
+average_value(const RICHREAL_T& sum, const uint64_t count)
+{
+  return DRichReal(sum / RICHREAL_T(count));
+}
+
 
-  T currentValue;
-  for (uint64_t row = 0; row < rowsCount; ++row)
+//Accumulates the values of a numeric field. The integers values are summed
+//up exactly and are converted only when the result is retrieved.
+template<typename T, typename S> class FieldAggregator
+{
+public:
+  FieldAggregator()
+    : mSum(0),
+      mCount(0),
+      mMinim(),
+      mMaxim()
+  {
+  }
+
+  void Add(const T& value)
   {
-    table.Get(row, field, currentValue);
-    if ( !currentValue.IsNull())
+    if (mCount == 0)
+      mMinim = mMaxim = value;
+
+    else if (value < mMinim)
+      mMinim = value;
+
+    else if (mMaxim < value)
+      mMaxim = value;
+
+    mSum += value.mValue;
+    ++mCount;
+  }
+
+  DRichReal Result(const FIELD_AGGREGATE op) const
+  {
+    if (mCount == 0)
+      return DRichReal();
+
+    switch (op)
     {
-      sum += currentValue.mValue;
-      ++rowsAdded;
+    case AGGREGATE_SUM:
+      return to_rich_real(mSum);
+
+    case AGGREGATE_AVERAGE:
+      return average_value(mSum, mCount);
+
+    case AGGREGATE_MINIMUM:
+      return to_rich_real(mMinim);
+
+    case AGGREGATE_MAXIMUM:
+      return to_rich_real(mMaxim);
+
+    default:
+      throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
     }
   }
 
-  if (rowsAdded == 0)
+private:
+  S           mSum;
+  uint64_t    mCount;
+  T           mMinim;
+  T           mMaxim;
+};
+
+
+//When the field is indexed, the index already holds the matching rows sorted
+//by their values, so the limits are found without visiting every row.
+template<typename T> DRichReal
+indexed_field_limit(ITable&               table,
+                    const FIELD_INDEX     field,
+                    const RowsSelection&  rows,
+                    const bool            minim)
+{
+  const DArray found = table.MatchRows(T::Min(),
+                                       T::Max(),
+                                       rows.FromRow(),
+                                       rows.ToRow(),
+                                       field);
+  if (found.Count() == 0)
+    return DRichReal();
+
+  DROW_INDEX first, last;
+  found.Get(0, first);
+  found.Get(found.Count() - 1, last);
+
+  T firstValue, lastValue;
+  table.Get(first.mValue, field, firstValue);
+  table.Get(last.mValue, field, lastValue);
+
+  if (lastValue < firstValue)
+    swap(firstValue, lastValue);
+
+  return to_rich_real(minim ? firstValue : lastValue);
+}
+
+
+template<typename T, typename S> DRichReal
+aggregate_field_values(ITable&                 table,
+                       const FIELD_INDEX       field,
+                       RowsSelection&          rows,
+                       const FIELD_AGGREGATE   op)
+{
+  if (rows.IsEmpty())
     return DRichReal();
 
-  const RICHREAL_T quotient = sum / rowsAdded;
-  const RICHREAL_T reminder = sum % rowsAdded;
+  if (((op == AGGREGATE_MINIMUM) || (op == AGGREGATE_MAXIMUM))
+      && rows.IsRange()
+      && table.IsIndexed(field))
+  {
+    return indexed_field_limit<T>(table, field, rows, op == AGGREGATE_MINIMUM);
+  }
+
+  FieldAggregator<T, S> aggregator;
+  ROW_INDEX chunk[RowsSelection::ROWS_CHUNK_SIZE];
+
+  uint_t count;
+  while ((count = rows.Fetch(chunk)) > 0)
+  {
+    for (uint_t i = 0; i < count; ++i)
+    {
+      T value;
+      table.Get(chunk[i], field, value);
+
+      if ( ! value.IsNull())
+        aggregator.Add(value);
+    }
+  }
 
-  return DRichReal(quotient + reminder / rowsAdded);
+  return aggregator.Result(op);
 }
 
+
+template<typename T> uint64_t
+count_field_values(ITable& table, const FIELD_INDEX field, RowsSelection& rows)
+{
+  if (rows.IsEmpty())
+    return 0;
+
+  if (rows.IsRange() && table.IsIndexed(field))
+    return table.MatchRowsSet(T::Min(), T::Max(), rows.FromRow(), rows.ToRow(), field).Count();
+
+  uint64_t result = 0;
+  ROW_INDEX chunk[RowsSelection::ROWS_CHUNK_SIZE];
+
+  uint_t count;
+  while ((count = rows.Fetch(chunk)) > 0)
+  {
+    for (uint_t i = 0; i < count; ++i)
+    {
+      T value;
+      table.Get(chunk[i], field, value);
+
+      if ( ! value.IsNull())
+        ++result;
+    }
+  }
+
+  return result;
+}
+
+
+static bool
+is_numeric_field(const uint_t fieldType)
+{
+  if (IS_ARRAY(fieldType))
+    return false;
+
+  return ((T_INT8 <= GET_BASE_TYPE(fieldType)) && (GET_BASE_TYPE(fieldType) <= T_UINT64))
+         || (GET_BASE_TYPE(fieldType) == T_REAL)
+         || (GET_BASE_TYPE(fieldType) == T_RICHREAL);
+}
+
+
+static bool
+is_basic_field(const uint_t fieldType)
+{
+  return ! IS_ARRAY(fieldType)
+         && (GET_BASE_TYPE(fieldType) > T_UNKNOWN)
+         && (GET_BASE_TYPE(fieldType) < T_TEXT);
+}
+
+
+static uint64_t
+count_field(ITable&             table,
+            const FIELD_INDEX   field,
+            const uint_t        fieldType,
+            RowsSelection&      rows)
+{
+  switch (GET_BASE_TYPE(fieldType))
+  {
+  case T_BOOL:
+    return count_field_values<DBool>(table, field, rows);
+
+  case T_CHAR:
+    return count_field_values<DChar>(table, field, rows);
+
+  case T_DATE:
+    return count_field_values<DDate>(table, field, rows);
+
+  case T_DATETIME:
+    return count_field_values<DDateTime>(table, field, rows);
+
+  case T_HIRESTIME:
+    return count_field_values<DHiresTime>(table, field, rows);
+
+  case T_INT8:
+    return count_field_values<DInt8>(table, field, rows);
+
+  case T_INT16:
+    return count_field_values<DInt16>(table, field, rows);
+
+  case T_INT32:
+    return count_field_values<DInt32>(table, field, rows);
+
+  case T_INT64:
+    return count_field_values<DInt64>(table, field, rows);
+
+  case T_UINT8:
+    return count_field_values<DUInt8>(table, field, rows);
+
+  case T_UINT16:
+    return count_field_values<DUInt16>(table, field, rows);
+
+  case T_UINT32:
+    return count_field_values<DUInt32>(table, field, rows);
+
+  case T_UINT64:
+    return count_field_values<DUInt64>(table, field, rows);
+
+  case T_REAL:
+    return count_field_values<DReal>(table, field, rows);
+
+  case T_RICHREAL:
+    return count_field_values<DRichReal>(table, field, rows);
+
+  default:
+    throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+  }
+}
+
+
+static DRichReal
+aggregate_field(ITable&                 table,
+                const FIELD_INDEX       field,
+                const uint_t            fieldType,
+                RowsSelection&          rows,
+                const FIELD_AGGREGATE   op)
+{
+  switch (GET_BASE_TYPE(fieldType))
+  {
+  case T_INT8:
+    return aggregate_field_values<DInt8, WE_I128>(table, field, rows, op);
+
+  case T_INT16:
+    return aggregate_field_values<DInt16, WE_I128>(table, field, rows, op);
+
+  case T_INT32:
+    return aggregate_field_values<DInt32, WE_I128>(table, field, rows, op);
+
+  case T_INT64:
+    return aggregate_field_values<DInt64, WE_I128>(table, field, rows, op);
+
+  case T_UINT8:
+    return aggregate_field_values<DUInt8, WE_I128>(table, field, rows, op);
+
+  case T_UINT16:
+    return aggregate_field_values<DUInt16, WE_I128>(table, field, rows, op);
+
+  case T_UINT32:
+    return aggregate_field_values<DUInt32, WE_I128>(table, field, rows, op);
+
+  case T_UINT64:
+    return aggregate_field_values<DUInt64, WE_I128>(table, field, rows, op);
+
+  case T_REAL:
+    return aggregate_field_values<DReal, RICHREAL_T>(table, field, rows, op);
+
+  case T_RICHREAL:
+    return aggregate_field_values<DRichReal, RICHREAL_T>(table, field, rows, op);
+
+  default:
+    throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+  }
+}
+
+
+template<FIELD_AGGREGATE op> WLIB_STATUS
+proc_field_aggregate(SessionStack& stack, ISession&)
+{
+  const auto paramsCount = 4;
+  const auto firstParam = stack.Size() - paramsCount;
+
+  IOperand& opField = stack[firstParam].Operand();
+  if (opField.IsNull())
+  {
+    stack.Pop(paramsCount - 1);
+    stack[firstParam] = (op == AGGREGATE_COUNT)
+                        ? StackValue::Create(DUInt64(0))
+                        : StackValue::Create(DRichReal());
+    return WOP_OK;
+  }
+
+  const uint_t fieldType = opField.GetType();
+  if ((op == AGGREGATE_COUNT) ? ! is_basic_field(fieldType) : ! is_numeric_field(fieldType))
+  {
+    throw InterException(_EXTRA(InterException::INVALID_PARAMETER_TYPE),
+                         (op == AGGREGATE_COUNT)
+                          ? "Counting field values is available only for basic "
+                            "types( e.g. reals, integers, dates, etc. and not "
+                            "for arrays or text."
+                          : "Aggregating field values is available only for "
+                            "integers and reals fields.");
+  }
+
+  ITable& table = opField.GetTable();
+  const FIELD_INDEX field = opField.GetField();
+
+  RowsSelection rows(table,
+                     stack[firstParam + 1].Operand(),
+                     stack[firstParam + 2].Operand(),
+                     stack[firstParam + 3].Operand());
+
+  StackValue result = (op == AGGREGATE_COUNT)
+                      ? StackValue::Create(DUInt64(count_field(table, field, fieldType, rows)))
+                      : StackValue::Create(aggregate_field(table, field, fieldType, rows, op));
+
+  stack.Pop(paramsCount - 1);
+  stack[firstParam] = result;
+
+  return WOP_OK;
+}
+
+
+enum FIELD_GROUP_OP
+{
+  GROUP_ROWS,
+  GROUP_COUNT,
+  GROUP_SUM,
+  GROUP_AVERAGE
+};
+
+
+template<typename T> struct GroupKeyHash
+{
+  size_t operator() (const T& key) const
+  {
+    return hash<uint64_t>()(key.mValue);
+  }
+};
+
+template<> struct GroupKeyHash<DDate>
+{
+  size_t operator() (const DDate& key) const
+  {
+    return hash<uint64_t>()((_SC(uint64_t, _SC(uint16_t, key.mYear)) << 16)
+                            | (key.mMonth << 8)
+                            | key.mDay);
+  }
+};
+
+template<> struct GroupKeyHash<DDateTime>
+{
+  size_t operator() (const DDateTime& key) const
+  {
+    return hash<uint64_t>()((_SC(uint64_t, _SC(uint16_t, key.mYear)) << 40)
+                            | (_SC(uint64_t, key.mMonth) << 32)
+                            | (key.mDay << 24)
+                            | (key.mHour << 16)
+                            | (key.mMinutes << 8)
+                            | key.mSeconds);
+  }
+};
+
+template<> struct GroupKeyHash<DHiresTime>
+{
+  size_t operator() (const DHiresTime& key) const
+  {
+    return hash<uint64_t>()((_SC(uint64_t, _SC(uint16_t, key.mYear)) << 40)
+                            | (_SC(uint64_t, key.mMonth) << 32)
+                            | (key.mDay << 24)
+                            | (key.mHour << 16)
+                            | (key.mMinutes << 8)
+                            | key.mSeconds)
+           ^ hash<uint64_t>()(key.mMicrosec);
+  }
+};
+
+template<> struct GroupKeyHash<DReal>
+{
+  size_t operator() (const DReal& key) const
+  {
+    return hash<int64_t>()(key.mValue.Integer()) ^ hash<int64_t>()(key.mValue.Fractional());
+  }
+};
+
+template<> struct GroupKeyHash<DRichReal>
+{
+  size_t operator() (const DRichReal& key) const
+  {
+    return hash<int64_t>()(key.mValue.Integer()) ^ hash<int64_t>()(key.mValue.Fractional());
+  }
+};
+
+
+template<typename T> struct GroupKeysOrder
+{
+  GroupKeysOrder(const vector<T>& keys)
+    : mKeys(keys)
+  {
+  }
+
+  bool operator() (const uint64_t first, const uint64_t second) const
+  {
+    return mKeys[first] < mKeys[second];
+  }
+
+  const vector<T>& mKeys;
+};
+
+
+template<typename T> uint_t
+load_reals_values(ITable&                 table,
+                  const FIELD_INDEX       field,
+                  const ROW_INDEX* const  rows,
+                  const uint_t            count,
+                  RICHREAL_T* const       outValues,
+                  bool* const             outNulls)
+{
+  for (uint_t i = 0; i < count; ++i)
+  {
+    T value;
+    table.Get(rows[i], field, value);
+
+    outNulls[i] = value.IsNull();
+    if ( ! outNulls[i])
+      outValues[i] = RICHREAL_T(value.mValue);
+  }
+
+  return count;
+}
+
+
+static void
+load_field_reals(ITable&                 table,
+                 const FIELD_INDEX       field,
+                 const uint_t            fieldType,
+                 const ROW_INDEX* const  rows,
+                 const uint_t            count,
+                 RICHREAL_T* const       outValues,
+                 bool* const             outNulls)
+{
+  switch (GET_BASE_TYPE(fieldType))
+  {
+  case T_INT8:
+    load_reals_values<DInt8>(table, field, rows, count, outValues, outNulls);
+    break;
+
+  case T_INT16:
+    load_reals_values<DInt16>(table, field, rows, count, outValues, outNulls);
+    break;
+
+  case T_INT32:
+    load_reals_values<DInt32>(table, field, rows, count, outValues, outNulls);
+    break;
+
+  case T_INT64:
+    load_reals_values<DInt64>(table, field, rows, count, outValues, outNulls);
+    break;
+
+  case T_UINT8:
+    load_reals_values<DUInt8>(table, field, rows, count, outValues, outNulls);
+    break;
+
+  case T_UINT16:
+    load_reals_values<DUInt16>(table, field, rows, count, outValues, outNulls);
+    break;
+
+  case T_UINT32:
+    load_reals_values<DUInt32>(table, field, rows, count, outValues, outNulls);
+    break;
+
+  case T_UINT64:
+    load_reals_values<DUInt64>(table, field, rows, count, outValues, outNulls);
+    break;
+
+  case T_REAL:
+    load_reals_values<DReal>(table, field, rows, count, outValues, outNulls);
+    break;
+
+  case T_RICHREAL:
+    load_reals_values<DRichReal>(table, field, rows, count, outValues, outNulls);
+    break;
+
+  default:
+    throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+  }
+}
+
+
+//Groups the selected rows by the values of the key field using a hash
+//table. The groups are reported in the ascending order of their keys, so
+//the arrays returned for the same selection are parallel. A group is
+//identified by the first row holding its key.
+template<typename T> DArray
+group_field_values(ITable&                 table,
+                   const FIELD_INDEX       keyField,
+                   const FIELD_INDEX       valueField,
+                   const uint_t            valueType,
+                   RowsSelection&          rows,
+                   const FIELD_GROUP_OP    op)
+{
+  unordered_map<T, uint64_t, GroupKeyHash<T>> groups;
+  vector<T>           keys;
+  vector<ROW_INDEX>   firstRows;
+  vector<uint64_t>    counts;
+  vector<RICHREAL_T>  sums;
+
+  ROW_INDEX   chunk[RowsSelection::ROWS_CHUNK_SIZE];
+  uint64_t    chunkGroups[RowsSelection::ROWS_CHUNK_SIZE];
+  RICHREAL_T  values[RowsSelection::ROWS_CHUNK_SIZE];
+  bool        nulls[RowsSelection::ROWS_CHUNK_SIZE];
+
+  uint_t count;
+  while ((count = rows.Fetch(chunk)) > 0)
+  {
+    uint_t grouped = 0;
+    for (uint_t i = 0; i < count; ++i)
+    {
+      T key;
+      table.Get(chunk[i], keyField, key);
+
+      if (key.IsNull())
+        continue;
+
+      auto group = groups.find(key);
+      if (group == groups.end())
+      {
+        group = groups.insert(make_pair(key, keys.size())).first;
+        keys.push_back(key);
+        firstRows.push_back(chunk[i]);
+        counts.push_back(0);
+        sums.push_back(RICHREAL_T(0));
+      }
+
+      chunk[grouped]         = chunk[i];
+      chunkGroups[grouped++] = group->second;
+    }
+
+    if ((op == GROUP_ROWS) || (op == GROUP_COUNT))
+    {
+      for (uint_t i = 0; i < grouped; ++i)
+        ++counts[chunkGroups[i]];
+
+      continue;
+    }
+
+    load_field_reals(table, valueField, valueType, chunk, grouped, values, nulls);
+    for (uint_t i = 0; i < grouped; ++i)
+    {
+      if (nulls[i])
+        continue;
+
+      ++counts[chunkGroups[i]];
+      sums[chunkGroups[i]] += values[i];
+    }
+  }
+
+  vector<uint64_t> order(keys.size());
+  for (uint64_t i = 0; i < order.size(); ++i)
+    order[i] = i;
+
+  sort(order.begin(), order.end(), GroupKeysOrder<T>(keys));
+
+  DArray result;
+  for (const auto group : order)
+  {
+    switch (op)
+    {
+    case GROUP_ROWS:
+      result.Add(DROW_INDEX(firstRows[group]));
+      break;
+
+    case GROUP_COUNT:
+      result.Add(DUInt64(counts[group]));
+      break;
+
+    case GROUP_SUM:
+      result.Add(DRichReal(sums[group]));
+      break;
+
+    case GROUP_AVERAGE:
+      result.Add(counts[group] == 0
+                 ? DRichReal(RICHREAL_T(0))
+                 : DRichReal(sums[group] / RICHREAL_T(counts[group])));
+      break;
+    }
+  }
+
+  return result;
+}
+
+
+static DArray
+group_field(ITable&                 table,
+            const FIELD_INDEX       keyField,
+            const uint_t            keyType,
+            const FIELD_INDEX       valueField,
+            const uint_t            valueType,
+            RowsSelection&          rows,
+            const FIELD_GROUP_OP    op)
+{
+  switch (GET_BASE_TYPE(keyType))
+  {
+  case T_BOOL:
+    return group_field_values<DBool>(table, keyField, valueField, valueType, rows, op);
+
+  case T_CHAR:
+    return group_field_values<DChar>(table, keyField, valueField, valueType, rows, op);
+
+  case T_DATE:
+    return group_field_values<DDate>(table, keyField, valueField, valueType, rows, op);
+
+  case T_DATETIME:
+    return group_field_values<DDateTime>(table, keyField, valueField, valueType, rows, op);
+
+  case T_HIRESTIME:
+    return group_field_values<DHiresTime>(table, keyField, valueField, valueType, rows, op);
+
+  case T_INT8:
+    return group_field_values<DInt8>(table, keyField, valueField, valueType, rows, op);
+
+  case T_INT16:
+    return group_field_values<DInt16>(table, keyField, valueField, valueType, rows, op);
+
+  case T_INT32:
+    return group_field_values<DInt32>(table, keyField, valueField, valueType, rows, op);
+
+  case T_INT64:
+    return group_field_values<DInt64>(table, keyField, valueField, valueType, rows, op);
+
+  case T_UINT8:
+    return group_field_values<DUInt8>(table, keyField, valueField, valueType, rows, op);
+
+  case T_UINT16:
+    return group_field_values<DUInt16>(table, keyField, valueField, valueType, rows, op);
+
+  case T_UINT32:
+    return group_field_values<DUInt32>(table, keyField, valueField, valueType, rows, op);
+
+  case T_UINT64:
+    return group_field_values<DUInt64>(table, keyField, valueField, valueType, rows, op);
+
+  case T_REAL:
+    return group_field_values<DReal>(table, keyField, valueField, valueType, rows, op);
+
+  case T_RICHREAL:
+    return group_field_values<DRichReal>(table, keyField, valueField, valueType, rows, op);
+
+  default:
+    throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
+  }
+}
+
+
+template<FIELD_GROUP_OP op> WLIB_STATUS
+proc_field_group(SessionStack& stack, ISession&)
+{
+  const bool withValues = (op == GROUP_SUM) || (op == GROUP_AVERAGE);
+  const auto paramsCount = withValues ? 5 : 4;
+  const auto firstParam = stack.Size() - paramsCount;
+
+  IOperand& opKey = stack[firstParam].Operand();
+  IOperand& opValue = stack[firstParam + (withValues ? 1 : 0)].Operand();
+
+  if (opKey.IsNull() || opValue.IsNull())
+  {
+    stack.Pop(paramsCount - 1);
+    stack[firstParam] = StackValue::Create(DArray());
+    return WOP_OK;
+  }
+
+  const uint_t keyType = opKey.GetType();
+  const uint_t valueType = opValue.GetType();
+  if ( ! is_basic_field(keyType) || (withValues && ! is_numeric_field(valueType)))
+  {
+    throw InterException(_EXTRA(InterException::INVALID_PARAMETER_TYPE),
+                         "Grouping is available only by fields of basic types "
+                         "( e.g. reals, integers, dates, etc.) and only for "
+                         "integers and reals values.");
+  }
+
+  ITable& table = opKey.GetTable();
+  if (&opValue.GetTable() != &table)
+  {
+    throw InterException(_EXTRA(InterException::INVALID_PARAMETER_VALUE),
+                         "The grouped fields need to belong to the same table.");
+  }
+
+  const auto rowsParam = firstParam + paramsCount - 3;
+  RowsSelection rows(table,
+                     stack[rowsParam].Operand(),
+                     stack[rowsParam + 1].Operand(),
+                     stack[rowsParam + 2].Operand());
+
+  DArray result = group_field(table,
+                              opKey.GetField(),
+                              keyType,
+                              opValue.GetField(),
+                              valueType,
+                              rows,
+                              op);
+
+  stack.Pop(paramsCount - 1);
+  stack[firstParam] = StackValue::Create(result);
+
+  return WOP_OK;
+}
+
+
 WLIB_STATUS
 base_fields_init()
 {
@@ -842,6 +1789,36 @@ base_fields_init()
   gProcFilterRows.localsTypes = fieldFilterRowsLocals;
 
 
+  static const uint8_t* fieldMatchArrayRowsLocals[] = {
+                                                        gAUInt32Type,
+                                                        gGenericFieldType,
+                                                        gGenericArrayType,
+                                                        gBoolType,
+                                                        gUInt32Type,
+                                                        gUInt32Type
+                                                      };
+
+  gProcMatchArrayRows.name        = "match_array_rows";
+  gProcMatchArrayRows.localsCount = 6;
+  gProcMatchArrayRows.localsTypes = fieldMatchArrayRowsLocals;
+  gProcMatchArrayRows.code        = proc_field_match_array_rows;
+
+
+  static const uint8_t* fieldFetchIndexEntriesLocals[] = {
+                                                           gUInt32Type,
+                                                           gGenericFieldType,
+                                                           gGenericArrayType,
+                                                           gAUInt32Type,
+                                                           gBoolType,
+                                                           gUInt32Type
+                                                         };
+
+  gProcFetchIndexEntries.name        = "fetch_index_entries";
+  gProcFetchIndexEntries.localsCount = 6;
+  gProcFetchIndexEntries.localsTypes = fieldFetchIndexEntriesLocals;
+  gProcFetchIndexEntries.code        = proc_field_fetch_index_entries;
+
+
 
   static const uint8_t* fieldMinimumLocals[] = {
                                                  gAUInt32Type,
@@ -859,6 +1836,96 @@ base_fields_init()
   gProcFieldMaximum.localsTypes = fieldMinimumLocals; //reusing
   gProcFieldMaximum.code        = field_search_minmax<true>;
 
+  static const uint8_t* fieldAggregateLocals[] = {
+                                                   gRichRealType,
+                                                   gGenericFieldType,
+                                                   gAUInt32Type,
+                                                   gUInt32Type,
+                                                   gUInt32Type
+                                                 };
+
+  gProcFieldSum.name        = "field_sum";
+  gProcFieldSum.localsCount = 5;
+  gProcFieldSum.localsTypes = fieldAggregateLocals;
+  gProcFieldSum.code        = proc_field_aggregate<AGGREGATE_SUM>;
+
+  gProcFieldAverage.name        = "field_avg";
+  gProcFieldAverage.localsCount = 5;
+  gProcFieldAverage.localsTypes = fieldAggregateLocals; //reusing
+  gProcFieldAverage.code        = proc_field_aggregate<AGGREGATE_AVERAGE>;
+
+  gProcFieldMinValue.name        = "field_min";
+  gProcFieldMinValue.localsCount = 5;
+  gProcFieldMinValue.localsTypes = fieldAggregateLocals; //reusing
+  gProcFieldMinValue.code        = proc_field_aggregate<AGGREGATE_MINIMUM>;
+
+  gProcFieldMaxValue.name        = "field_max";
+  gProcFieldMaxValue.localsCount = 5;
+  gProcFieldMaxValue.localsTypes = fieldAggregateLocals; //reusing
+  gProcFieldMaxValue.code        = proc_field_aggregate<AGGREGATE_MAXIMUM>;
+
+
+  static const uint8_t* fieldCountLocals[] = {
+                                               gUInt64Type,
+                                               gGenericFieldType,
+                                               gAUInt32Type,
+                                               gUInt32Type,
+                                               gUInt32Type
+                                             };
+
+  gProcFieldCount.name        = "field_count";
+  gProcFieldCount.localsCount = 5;
+  gProcFieldCount.localsTypes = fieldCountLocals;
+  gProcFieldCount.code        = proc_field_aggregate<AGGREGATE_COUNT>;
+
+
+  static const uint8_t* groupRowsLocals[] = {
+                                              gAUInt32Type,
+                                              gGenericFieldType,
+                                              gAUInt32Type,
+                                              gUInt32Type,
+                                              gUInt32Type
+                                            };
+
+  gProcGroupRows.name        = "group_rows";
+  gProcGroupRows.localsCount = 5;
+  gProcGroupRows.localsTypes = groupRowsLocals;
+  gProcGroupRows.code        = proc_field_group<GROUP_ROWS>;
+
+
+  static const uint8_t* groupCountLocals[] = {
+                                               gAUInt64Type,
+                                               gGenericFieldType,
+                                               gAUInt32Type,
+                                               gUInt32Type,
+                                               gUInt32Type
+                                             };
+
+  gProcGroupCount.name        = "group_count";
+  gProcGroupCount.localsCount = 5;
+  gProcGroupCount.localsTypes = groupCountLocals;
+  gProcGroupCount.code        = proc_field_group<GROUP_COUNT>;
+
+
+  static const uint8_t* groupSumLocals[] = {
+                                             gARichRealType,
+                                             gGenericFieldType,
+                                             gGenericFieldType,
+                                             gAUInt32Type,
+                                             gUInt32Type,
+                                             gUInt32Type
+                                           };
+
+  gProcGroupSum.name        = "group_sum";
+  gProcGroupSum.localsCount = 6;
+  gProcGroupSum.localsTypes = groupSumLocals;
+  gProcGroupSum.code        = proc_field_group<GROUP_SUM>;
+
+  gProcGroupAverage.name        = "group_avg";
+  gProcGroupAverage.localsCount = 6;
+  gProcGroupAverage.localsTypes = groupSumLocals; //reusing
+  gProcGroupAverage.code        = proc_field_group<GROUP_AVERAGE>;
+
   return WOP_OK;
 }
 
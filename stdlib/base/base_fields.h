@@ -34,8 +34,19 @@ extern whais::WLIB_PROC_DESCRIPTION         gProcIsFielsIndexed;
 extern whais::WLIB_PROC_DESCRIPTION         gProcFieldName;
 extern whais::WLIB_PROC_DESCRIPTION         gProcFindValueRange;
 extern whais::WLIB_PROC_DESCRIPTION         gProcFilterRows;
+extern whais::WLIB_PROC_DESCRIPTION         gProcMatchArrayRows;
+extern whais::WLIB_PROC_DESCRIPTION         gProcFetchIndexEntries;
 extern whais::WLIB_PROC_DESCRIPTION         gProcFieldMinimum;
 extern whais::WLIB_PROC_DESCRIPTION         gProcFieldMaximum;
+extern whais::WLIB_PROC_DESCRIPTION         gProcFieldSum;
+extern whais::WLIB_PROC_DESCRIPTION         gProcFieldAverage;
+extern whais::WLIB_PROC_DESCRIPTION         gProcFieldMinValue;
+extern whais::WLIB_PROC_DESCRIPTION         gProcFieldMaxValue;
+extern whais::WLIB_PROC_DESCRIPTION         gProcFieldCount;
+extern whais::WLIB_PROC_DESCRIPTION         gProcGroupRows;
+extern whais::WLIB_PROC_DESCRIPTION         gProcGroupCount;
+extern whais::WLIB_PROC_DESCRIPTION         gProcGroupSum;
+extern whais::WLIB_PROC_DESCRIPTION         gProcGroupAverage;
 
 
 whais::WLIB_STATUS
@@ -23,10 +23,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 ******************************************************************************/
 
 #include <cassert>
+#include <memory>
 #include <vector>
 
 #include "whais.h"
-#include "utils/wsort.h"
 #include "utils/wunicode.h"
 #include "utils/wutf.h"
 #include "base_tables.h"
@@ -49,422 +49,7 @@ WLIB_PROC_DESCRIPTION       gProcTableFindRemovedRow;
 WLIB_PROC_DESCRIPTION       gProcTableRemoveRow;
 WLIB_PROC_DESCRIPTION       gProcTableExchangeRows;
 WLIB_PROC_DESCRIPTION       gProcTableSort;
-
-
-class TableSortContainer
-{
-public:
-
-  typedef int
-  (TableSortContainer::*field_comparator)(const ROW_INDEX row1,
-                                          const ROW_INDEX row2,
-                                          const FIELD_INDEX row3) const;
-  class Value
-  {
-    friend class TableSortContainer;
-
-  public:
-    Value()
-        : mContainer(nullptr),
-          mRow(0)
-    {}
-
-    Value(const TableSortContainer& container, const ROW_INDEX row)
-        : mContainer( &container),
-          mRow(container.mRowsPermutation[row])
-    {}
-
-    Value& operator=(const Value& src)
-    {
-      _CC(const TableSortContainer*&, mContainer) = src.mContainer;
-      _CC(ROW_INDEX&, mRow) = src.mRow;
-
-      return *this;
-    }
-
-    bool operator<(const Value& val) const
-    {
-      if ((mContainer == nullptr) && (val.mContainer != nullptr))
-        return true;
-
-      else if (val.mContainer == nullptr)
-        return false;
-
-      assert(val.mContainer == mContainer);
-
-      for (FIELD_INDEX i = 0; i < mContainer->mFields.size(); ++i)
-      {
-        const field_comparator compare = mContainer->mComparators[i];
-
-        const int r = (mContainer->*compare)(mRow, val.mRow, mContainer->mFields[i]);
-        if (r < 0)
-          return true;
-
-        else if (r > 0)
-          return false;
-      }
-
-      return false;
-    }
-
-    bool operator==(const Value& val) const
-    {
-      if ((mContainer == nullptr) && (val.mContainer == nullptr))
-        return true;
-
-      else if (mContainer != val.mContainer)
-        return false;
-
-      for (FIELD_INDEX i = 0; i < mContainer->mFields.size(); ++i)
-      {
-        const field_comparator compare = mContainer->mComparators[i];
-
-        if ((mContainer->*compare)(mRow, val.mRow, mContainer->mFields[i]) != 0)
-          return false;
-      }
-
-      return true;
-    }
-
-  private:
-    const TableSortContainer* const mContainer;
-    const ROW_INDEX mRow;
-  };
-
-
-  TableSortContainer(ITable& table, const DArray& fields, const DArray& fieldsSortOrder)
-      : mTable(table)
-  {
-    assert(fields.Count() > 0);
-    assert(fields.Count() == fieldsSortOrder.Count());
-
-    extract_fields_ids(fields);
-
-    mTable.LockTable();
-    mRowsPermutation.resize(mTable.AllocatedRows());
-    for (ROW_INDEX i = 0; i < mRowsPermutation.size(); ++i)
-      mRowsPermutation[i] = i;
-
-    for (FIELD_INDEX field = 0; field < mFields.size(); ++field)
-    {
-      const DBSFieldDescriptor fd = mTable.DescribeField(mFields[field]);
-
-      if (fd.isArray)
-      {
-        throw InterException(_EXTRA(InterException::INVALID_PARAMETER_TYPE),
-                             "Cannot sort a table using an array field.");
-      }
-
-      DBool sortOrder;
-      fieldsSortOrder.Get(field, sortOrder);
-
-      switch (fd.type)
-      {
-      case T_BOOL:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DBool>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DBool>));
-        break;
-
-      case T_CHAR:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DChar>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DChar>));
-        break;
-
-      case T_DATE:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DDate>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DDate>));
-        break;
-
-      case T_DATETIME:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator,
-                    &TableSortContainer::compare_field_values_reverse<DDateTime>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DDateTime>));
-        break;
-
-      case T_HIRESTIME:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator,
-                    &TableSortContainer::compare_field_values_reverse<DHiresTime>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DHiresTime>));
-        break;
-
-      case T_INT8:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DInt8>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DInt8>));
-        break;
-
-      case T_INT16:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DInt16>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DInt16>));
-        break;
-
-      case T_INT32:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DInt32>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DInt32>));
-        break;
-
-      case T_INT64:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DInt64>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DInt64>));
-        break;
-
-      case T_REAL:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DReal>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DReal>));
-        break;
-
-      case T_RICHREAL:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator,
-                    &TableSortContainer::compare_field_values_reverse<DRichReal>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DRichReal>));
-        break;
-
-      case T_UINT8:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DUInt8>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DUInt8>));
-        break;
-
-      case T_UINT16:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DUInt16>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DUInt16>));
-        break;
-
-      case T_UINT32:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DUInt32>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DUInt32>));
-        break;
-
-      case T_UINT64:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DUInt64>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DUInt64>));
-        break;
-
-      case T_TEXT:
-        mComparators.push_back(
-            sortOrder.mValue ?
-                _SC(field_comparator, &TableSortContainer::compare_field_values_reverse<DText>) :
-                _SC(field_comparator, &TableSortContainer::compare_field_values<DText>));
-        break;
-
-      default:
-        throw InterException(_EXTRA(InterException::INTERNAL_ERROR));
-      }
-    }
-  }
-
-  TableSortContainer(const TableSortContainer&) = delete;
-  TableSortContainer& operator=(const TableSortContainer&) = delete;
-
-  const Value operator[] (const int64_t position) const { return Value(*this, position); }
-  void Exchange( const int64_t pos1, const int64_t pos2)
-  {
-    const ROW_INDEX t = mRowsPermutation[pos2];
-
-    mRowsPermutation[pos2] = mRowsPermutation[pos1];
-    mRowsPermutation[pos1] = t;
-  }
-  uint64_t Count() const { return mRowsPermutation.size(); }
-  void Pivot( const uint64_t index) { mPivot = Value( *this, index); }
-  const Value& Pivot() const { return mPivot; }
-
-  void Commit()
-  {
-    ROW_INDEX row = 0;
-    while (row < mRowsPermutation.size())
-    {
-      if (mRowsPermutation[row] == row)
-      {
-        ++row;
-        continue;
-      }
-
-      ROW_INDEX currentRow = row;
-      do
-      {
-        const ROW_INDEX correctRow = mRowsPermutation[currentRow];
-        if (correctRow == row)
-        {
-          mRowsPermutation[currentRow] = currentRow;
-          break;
-        }
-
-        mTable.ExchangeRows(currentRow, correctRow, true);
-        mRowsPermutation[currentRow] = currentRow;
-
-        currentRow = correctRow;
-      } while (true);
-    }
-
-    mTable.UnlockTable();
-  }
-
-private:
-  friend class TableSortContainer::Value;
-
-  template<typename T> int
-  compare_field_values(const ROW_INDEX row1, const ROW_INDEX row2, const FIELD_INDEX field) const
-  {
-    T v1, v2;
-
-    mTable.Get(row1, field, v1, true);
-    mTable.Get(row2, field, v2, true);
-
-    if (v1 == v2)
-      return 0;
-
-    else if (v1 < v2)
-      return -1;
-
-    return 1;
-  }
-
-  template<typename T> int
-  compare_field_values_reverse(const ROW_INDEX row1,
-                               const ROW_INDEX row2,
-                               const FIELD_INDEX field) const
-  {
-    T v1, v2;
-
-    mTable.Get(row1, field, v1, true);
-    mTable.Get(row2, field, v2, true);
-
-    if (v1 == v2)
-      return 0;
-
-    else if  (v2 < v1)
-      return -1;
-
-    return 1;
-  }
-
-
-  void extract_fields_ids(const DArray& fields)
-  {
-    const DBS_FIELD_TYPE arrayType = fields.Type();
-    const uint64_t fieldsCount = fields.Count();
-
-    assert(fieldsCount != 0);
-
-    for (uint64_t field = 0; field < fieldsCount; ++field)
-    {
-      switch (arrayType)
-      {
-      case T_INT8:
-      {
-        DInt8 temp;
-        fields.Get(field, temp);
-
-        mFields.push_back(temp.mValue);
-      }
-        break;
-
-      case T_INT16:
-      {
-        DInt16 temp;
-        fields.Get(field, temp);
-
-        mFields.push_back(temp.mValue);
-      }
-        break;
-
-      case T_INT32:
-      {
-        DInt32 temp;
-        fields.Get(field, temp);
-
-        mFields.push_back(temp.mValue);
-      }
-        break;
-
-      case T_INT64:
-      {
-        DInt64 temp;
-        fields.Get(field, temp);
-
-        mFields.push_back(temp.mValue);
-      }
-        break;
-
-      case T_UINT8:
-      {
-        DUInt8 temp;
-        fields.Get(field, temp);
-
-        mFields.push_back(temp.mValue);
-      }
-        break;
-
-      case T_UINT16:
-      {
-        DUInt16 temp;
-        fields.Get(field, temp);
-
-        mFields.push_back(temp.mValue);
-      }
-        break;
-
-      case T_UINT32:
-      {
-        DUInt32 temp;
-        fields.Get(field, temp);
-
-        mFields.push_back(temp.mValue);
-      }
-        break;
-
-      case T_UINT64:
-      {
-        DUInt64 temp;
-        fields.Get(field, temp);
-
-        mFields.push_back(temp.mValue);
-      }
-        break;
-
-      default:
-        throw InterException(_EXTRA(InterException::INVALID_PARAMETER_TYPE),
-                             "The fields list should be an array of integers.");
-      }
-    }
-  }
-
-  ITable&                       mTable;
-  vector<ROW_INDEX>             mRowsPermutation;
-  vector<uint16_t>              mFields;
-  vector<field_comparator>      mComparators;
-  uint16_t                      mFieldsCount;
-  ROW_INDEX                     mRowsCount;
-  Value                         mPivot;
-};
+WLIB_PROC_DESCRIPTION       gProcTableDeferIndexUpdates;
 
 
 static WLIB_STATUS
@@ -775,9 +360,28 @@ proc_table_sort( SessionStack& stack, ISession&)
     return WOP_OK;
   }
 
-  TableSortContainer container(table, fields, sortOrder);
-  quick_sort<TableSortContainer::Value>(from.mValue, to.mValue, false, container);
-  container.Commit();
+  vector<FIELD_INDEX> sortFields;
+  unique_ptr<bool[]> reverse(new bool[fieldsCount]);
+  for (auto f = 0u; f < fieldsCount; ++f)
+  {
+    DUInt16 fieldId;
+    DBool fieldOrder;
+
+    fields.Get(f, fieldId);
+    sortOrder.Get(f, fieldOrder);
+
+    if (table.DescribeField(fieldId.mValue).isArray)
+    {
+      throw InterException(_EXTRA(InterException::INVALID_PARAMETER_TYPE),
+                           "Cannot sort a table using an array field.");
+    }
+
+    sortFields.push_back(fieldId.mValue);
+    reverse[f] = fieldOrder.mValue;
+  }
+
+  if (fieldsCount > 0)
+    table.Sort(sortFields.data(), reverse.get(), fieldsCount, from.mValue, to.mValue);
 
   stack.Pop(5);
   stack.Push(DBool(true));
@@ -785,6 +389,30 @@ proc_table_sort( SessionStack& stack, ISession&)
 }
 
 
+static WLIB_STATUS
+proc_table_defer_index_updates( SessionStack& stack, ISession&)
+{
+  DBool defer;
+
+  IOperand& op = stack[stack.Size() - 2].Operand();
+  if (op.IsNullExpression())
+  {
+    stack.Pop(2);
+    stack.Push(DBool());
+
+    return WOP_OK;
+  }
+  stack[stack.Size() - 1].Operand().GetValue(defer);
+
+  op.GetTable().DeferIndexesUpdates( ! defer.IsNull() && defer.mValue);
+
+  stack.Pop(2);
+  stack.Push(DBool(true));
+
+  return WOP_OK;
+}
+
+
 WLIB_STATUS
 base_tables_init()
 {
@@ -892,6 +520,16 @@ base_tables_init()
   gProcTableSort.localsTypes = tableSortLocals;
   gProcTableSort.code        = proc_table_sort;
 
+  static const uint8_t* tableDeferIndexUpdatesLocals[] = {
+                                                           gBoolType,
+                                                           gGenericTableType,
+                                                           gBoolType
+                                                         };
+
+  gProcTableDeferIndexUpdates.name        = "defer_index_updates";
+  gProcTableDeferIndexUpdates.localsCount = 3;
+  gProcTableDeferIndexUpdates.localsTypes = tableDeferIndexUpdatesLocals;
+  gProcTableDeferIndexUpdates.code        = proc_table_defer_index_updates;
 
   return WOP_OK;
 }
@@ -39,6 +39,7 @@ extern whais::WLIB_PROC_DESCRIPTION       gProcTableFindRemovedRow;
 extern whais::WLIB_PROC_DESCRIPTION       gProcTableRemoveRow;
 extern whais::WLIB_PROC_DESCRIPTION       gProcTableExchangeRows;
 extern whais::WLIB_PROC_DESCRIPTION       gProcTableSort;
+extern whais::WLIB_PROC_DESCRIPTION       gProcTableDeferIndexUpdates;
 
 
 whais::WLIB_STATUS
@@ -71,6 +71,7 @@ WLIB_PROC_DESCRIPTION       gTextHash;
 
 WLIB_PROC_DESCRIPTION       gCharFind;
 WLIB_PROC_DESCRIPTION       gTextFind;
+WLIB_PROC_DESCRIPTION       gTextFindRows;
 WLIB_PROC_DESCRIPTION       gTextReplace;
 
 WLIB_PROC_DESCRIPTION       gTextCompare;
@@ -720,6 +721,52 @@ find_substring_offset( SessionStack& stack, ISession&)
 }
 
 
+static WLIB_STATUS
+find_substring_rows( SessionStack& stack, ISession&)
+{
+  IOperand& opField = stack[stack.Size() - 5].Operand();
+
+  if (opField.IsNull())
+  {
+    stack.Pop(5);
+    stack.Push(DArray());
+
+    return WOP_OK;
+  }
+
+  const uint_t fieldType = opField.GetType();
+  if (IS_ARRAY(fieldType) || (GET_BASE_TYPE(fieldType) != T_TEXT))
+  {
+    throw InterException(_EXTRA(InterException::INVALID_PARAMETER_TYPE),
+                         "Searching substrings is available only for text fields.");
+  }
+
+  DText substring;
+  DBool ignoreCase;
+  DUInt32 from, to;
+
+  stack[stack.Size() - 4].Operand().GetValue(substring);
+  stack[stack.Size() - 3].Operand().GetValue(ignoreCase);
+  stack[stack.Size() - 2].Operand().GetValue(from);
+  stack[stack.Size() - 1].Operand().GetValue(to);
+
+  ITable& table = opField.GetTable();
+
+  const ROW_INDEX fromRow = from.IsNull() ? 0 : from.mValue;
+  const ROW_INDEX toRow = to.IsNull() ? table.AllocatedRows() - 1 : to.mValue;
+
+  const DArray result = table.MatchTextRows(substring,
+                                            ignoreCase == DBool(true),
+                                            MIN(fromRow, toRow),
+                                            MAX(fromRow, toRow),
+                                            opField.GetField()).ToArray();
+  stack.Pop(5);
+  stack.Push(result);
+
+  return WOP_OK;
+}
+
+
 static WLIB_STATUS
 replace_substring_offset( SessionStack& stack, ISession&)
 {
@@ -974,6 +1021,21 @@ base_text_init()
   gTextFind.code              = find_substring_offset;
 
 
+  static const uint8_t* findTextRowsLocals[] = {
+                                                 gAUInt32Type,
+                                                 gGenericFieldType,
+                                                 gTextType,
+                                                 gBoolType,
+                                                 gUInt32Type,
+                                                 gUInt32Type
+                                               };
+
+  gTextFindRows.name          = "find_str_rows";
+  gTextFindRows.localsCount   = 6;
+  gTextFindRows.localsTypes   = findTextRowsLocals;
+  gTextFindRows.code          = find_substring_rows;
+
+
   static const uint8_t* replaceTextLocals[] = {
                                                 gTextType,
                                                 gTextType,
@@ -717,3 +717,170 @@ DO
 
 	RETURN NULL;
 ENDPROC
+
+
+PROCEDURE test_whais_api_sum(tc UINT8) RETURN BOOL
+DO
+	VAR l_a_int ARRAY INT32;
+	VAR l_a_real ARRAY REAL;
+	VAR l_a_date ARRAY DATE;
+	VAR l_a_uint ARRAY UINT64;
+	VAR i UINT32;
+
+	IF (tc == 0) DO
+		IF (sum(NULL) != NULL) DO
+			write_log(_FUNCL_ + ": result should be NULL.");
+			RETURN FALSE;
+		ELSE IF (sum(l_a_int) != NULL) DO
+			write_log(_FUNCL_ + ": result should be NULL.");
+			RETURN FALSE;
+		ELSE IF (avg(l_a_real) != NULL) DO
+			write_log(_FUNCL_ + ": result should be NULL.");
+			RETURN FALSE;
+		ELSE IF (avg(g_table_array_n.u16[0]) != NULL) DO
+			write_log(_FUNCL_ + ": result should be NULL.");
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	FOR (i = 1; i <= 1000; i += 1)
+	DO
+		IF (i % 2 == 0)
+			l_a_int += i;
+		ELSE
+			l_a_int += -i;
+	END
+
+	l_a_real = {1.5, -2.25, 10.125} REAL;
+
+	IF (tc == 1) DO
+		IF (sum(l_a_int) != 500.0) DO
+			write_log(_FUNCL_ + ": result should be 500 but I got: " + sum(l_a_int));
+			RETURN FALSE;
+		ELSE IF (avg(l_a_int) != 0.5) DO
+			write_log(_FUNCL_ + ": result should be 0.5 but I got: " + avg(l_a_int));
+			RETURN FALSE;
+		ELSE IF (sum(l_a_real) != 9.375) DO
+			write_log(_FUNCL_ + ": result should be 9.375 but I got: " + sum(l_a_real));
+			RETURN FALSE;
+		ELSE IF (avg(l_a_real) != 3.125) DO
+			write_log(_FUNCL_ + ": result should be 3.125 but I got: " + avg(l_a_real));
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	IF (tc == 2) DO
+		l_a_date = {'2016-1-21', '2017-04-03'};
+		sum(l_a_date);
+
+		RETURN FALSE;
+	END
+
+	IF (tc == 3) DO
+		l_a_uint = {18446744073709551614, 1, 0} UINT64;
+
+		IF (avg(l_a_uint) != 6148914691236517205.0) DO
+			write_log(_FUNCL_ + ": result should be 6148914691236517205 but I got: " + avg(l_a_uint));
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	RETURN NULL;
+ENDPROC
+
+
+PROCEDURE test_whais_api_dot(tc UINT8) RETURN BOOL
+DO
+	VAR l_a_int ARRAY INT64;
+	VAR l_a_uint ARRAY UINT8;
+	VAR l_a_real ARRAY RICHREAL;
+
+	IF (tc == 0) DO
+		IF (dot(NULL, NULL) != NULL) DO
+			write_log(_FUNCL_ + ": result should be NULL.");
+			RETURN FALSE;
+		ELSE IF (dot(l_a_int, l_a_real) != NULL) DO
+			write_log(_FUNCL_ + ": result should be NULL.");
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	l_a_int = {1, -2, 3, 4} INT64;
+	l_a_uint = {5, 6, 7, 8} UINT8;
+	l_a_real = {0.5, 0.25, 1.5, -2} RICHREAL;
+
+	IF (tc == 1) DO
+		IF (dot(l_a_int, l_a_uint) != 46.0) DO
+			write_log(_FUNCL_ + ": result should be 46 but I got: " + dot(l_a_int, l_a_uint));
+			RETURN FALSE;
+		ELSE IF (dot(l_a_real, l_a_int) != -3.5) DO
+			write_log(_FUNCL_ + ": result should be -3.5 but I got: " + dot(l_a_real, l_a_int));
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	IF (tc == 2) DO
+		l_a_uint += 9;
+		dot(l_a_int, l_a_uint);
+
+		RETURN FALSE;
+	END
+
+	RETURN NULL;
+ENDPROC
+
+
+PROCEDURE test_whais_api_histogram(tc UINT8) RETURN BOOL
+DO
+	VAR l_a_int ARRAY UINT16;
+	VAR l_a_real ARRAY REAL;
+	VAR buckets ARRAY UINT64;
+
+	IF (tc == 0) DO
+		IF (count(histogram(NULL, NULL, NULL, NULL)) != 0) DO
+			write_log(_FUNCL_ + ": result should be an empty array.");
+			RETURN FALSE;
+		ELSE IF (count(histogram(l_a_real, 0, 1, 2)) != 0) DO
+			write_log(_FUNCL_ + ": result should be an empty array.");
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	l_a_int = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11} UINT16;
+	l_a_real = {-1.5, 0.5, 0.25, 2.5, 3} REAL;
+
+	IF (tc == 1) DO
+		buckets = histogram(l_a_int, 0, 12, 3);
+		IF ((count(buckets) != 3) OR (buckets[0] != 4) OR (buckets[1] != 4) OR (buckets[2] != 4)) DO
+			write_log(_FUNCL_ + ": unexpected histogram of the integers array.");
+			RETURN FALSE;
+		END
+
+		buckets = histogram(l_a_int, 2, 5, NULL);
+		IF ((count(buckets) != 10) OR (buckets[0] != 1) OR (buckets[9] != 1) OR (buckets[5] != 0)) DO
+			write_log(_FUNCL_ + ": unexpected histogram of the integers array.");
+			RETURN FALSE;
+		END
+
+		buckets = histogram(l_a_real, NULL, NULL, 2);
+		IF ((count(buckets) != 2) OR (buckets[0] != 3) OR (buckets[1] != 2)) DO
+			write_log(_FUNCL_ + ": unexpected histogram of the reals array.");
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	IF (tc == 2) DO
+		histogram(l_a_int, 0, 12, 0);
+
+		RETURN FALSE;
+	END
+
+	RETURN NULL;
+ENDPROC
@@ -972,3 +972,227 @@ DO
 
 	RETURN NULL;
 ENDPROC
+
+PROCEDURE test_whais_api_field_aggregates(tc UINT8) RETURN BOOL
+DO
+	VAR tab TABLE (f1 INT8, f2 REAL, f3 DATE);
+	VAR rows ARRAY UINT32;
+	VAR f FIELD INT8;
+
+	IF (tc == 0) DO
+		IF (field_sum(NULL) != NULL) DO
+			write_log(_FUNCL_ + ": expected null result");
+			RETURN FALSE;
+		ELSE IF (field_avg(f) != NULL) DO
+			write_log(_FUNCL_ + ": expected null result");
+			RETURN FALSE;
+		ELSE IF (field_min(tab.f1) != NULL) DO
+			write_log(_FUNCL_ + ": expected null result");
+			RETURN FALSE;
+		ELSE IF (field_count(tab.f3) != 0) DO
+			write_log(_FUNCL_ + ": expected no values");
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	tab.f1[0] = 1;
+	tab.f1[1] = NULL;
+	tab.f1[2] = -9;
+	tab.f1[3] = 4;
+	tab.f1[4] = 2;
+	tab.f1[5] = NULL;
+	tab.f1[6] = 3;
+	tab.f1[7] = -9;
+	tab.f1[8] = -3;
+	tab.f1[9] = 4;
+
+	tab.f2[0] = 0.5;
+	tab.f2[3] = -1.25;
+	tab.f2[7] = 2;
+
+	IF (tc == 1) DO
+		IF (field_sum(tab.f1) != -7.0) DO
+			write_log(_FUNCL_ + ": unexpected sum " + field_sum(tab.f1));
+			RETURN FALSE;
+		ELSE IF (field_avg(tab.f1) != -0.875) DO
+			write_log(_FUNCL_ + ": unexpected average " + field_avg(tab.f1));
+			RETURN FALSE;
+		ELSE IF ((field_min(tab.f1) != -9.0) OR (field_max(tab.f1) != 4.0)) DO
+			write_log(_FUNCL_ + ": unexpected limits");
+			RETURN FALSE;
+		ELSE IF ((field_count(tab.f1) != 8) OR (field_count(tab.f2) != 3)) DO
+			write_log(_FUNCL_ + ": unexpected values count");
+			RETURN FALSE;
+		ELSE IF (field_sum(tab.f2) != 1.25) DO
+			write_log(_FUNCL_ + ": unexpected sum " + field_sum(tab.f2));
+			RETURN FALSE;
+		END
+
+		IF ((field_sum(tab.f1, NULL, 2, 4) != -3.0) OR (field_sum(tab.f1, NULL, 4, 2) != -3.0)) DO
+			write_log(_FUNCL_ + ": unexpected range sum");
+			RETURN FALSE;
+		ELSE IF (field_max(tab.f1, NULL, 5) != 4.0) DO
+			write_log(_FUNCL_ + ": unexpected range maximum");
+			RETURN FALSE;
+		ELSE IF (field_sum(tab.f1, NULL, 100) != NULL) DO
+			write_log(_FUNCL_ + ": expected null result");
+			RETURN FALSE;
+		END
+
+		rows = {9, 1, 8, 6, 300} UINT32;
+		IF (field_sum(tab.f1, rows) != 4.0) DO
+			write_log(_FUNCL_ + ": unexpected rows sum " + field_sum(tab.f1, rows));
+			RETURN FALSE;
+		ELSE IF (field_min(tab.f1, rows, 7) != -3.0) DO
+			write_log(_FUNCL_ + ": unexpected rows minimum");
+			RETURN FALSE;
+		ELSE IF (field_count(tab.f1, rows) != 3) DO
+			write_log(_FUNCL_ + ": unexpected rows count");
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	IF (tc == 2) DO
+		f = table_glb_index_fields.f2;
+		f[0] = -1;
+		f[1] = NULL;
+		f[2] = 9;
+		f[3] = -4;
+		f[4] = -5;
+		f[5] = NULL;
+		f[6] = NULL;
+		f[7] = 9;
+		f[8] = 3;
+		f[9] = -4;
+		f[10] = 0;
+		f[11] = 2;
+		f[12] = -1;
+
+		IF ((field_min(f, NULL, 0, 12) != -5.0) OR (field_max(f, NULL, 0, 12) != 9.0)) DO
+			write_log(_FUNCL_ + ": unexpected limits of the indexed field");
+			RETURN FALSE;
+		ELSE IF (field_count(f, NULL, 0, 12) != 10) DO
+			write_log(_FUNCL_ + ": unexpected count of the indexed field");
+			RETURN FALSE;
+		ELSE IF ((field_min(f, NULL, 5, 9) != -4.0) OR (field_max(f, NULL, 5, 9) != 9.0)) DO
+			write_log(_FUNCL_ + ": unexpected range limits of the indexed field");
+			RETURN FALSE;
+		ELSE IF (field_count(f, NULL, 5, 9) != 3) DO
+			write_log(_FUNCL_ + ": unexpected range count of the indexed field");
+			RETURN FALSE;
+		ELSE IF (field_sum(f, NULL, 0, 12) != 8.0) DO
+			write_log(_FUNCL_ + ": unexpected sum of the indexed field");
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	IF (tc == 3) DO
+		field_sum(tab.f3);
+
+		RETURN FALSE;
+	END
+
+	RETURN NULL;
+ENDPROC
+
+PROCEDURE test_whais_api_field_groups(tc UINT8) RETURN BOOL
+DO
+	VAR tab TABLE (k INT8, v UINT16, d DATE);
+	VAR other TABLE (v UINT16);
+	VAR groups ARRAY UINT32;
+	VAR counts ARRAY UINT64;
+	VAR sums ARRAY RICHREAL;
+
+	IF (tc == 0) DO
+		IF (group_rows(NULL) != NULL) DO
+			write_log(_FUNCL_ + ": expected null result");
+			RETURN FALSE;
+		ELSE IF (group_count(tab.k) != NULL) DO
+			write_log(_FUNCL_ + ": expected null result");
+			RETURN FALSE;
+		ELSE IF (group_sum(tab.k, NULL) != NULL) DO
+			write_log(_FUNCL_ + ": expected null result");
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	tab.k[0] = 3;
+	tab.k[1] = 1;
+	tab.k[2] = 3;
+	tab.k[3] = NULL;
+	tab.k[4] = 2;
+	tab.k[5] = 1;
+	tab.k[6] = 3;
+
+	tab.v[0] = 10;
+	tab.v[1] = 20;
+	tab.v[2] = 30;
+	tab.v[3] = 40;
+	tab.v[5] = 60;
+	tab.v[6] = 80;
+
+	tab.d[0] = '2018-03-01';
+	tab.d[2] = '2017-12-31';
+	tab.d[5] = '2018-03-01';
+
+	IF (tc == 1) DO
+		groups = group_rows(tab.k);
+		counts = group_count(tab.k);
+		IF ((count(groups) != 3) OR (groups[0] != 1) OR (groups[1] != 4) OR (groups[2] != 0)) DO
+			write_log(_FUNCL_ + ": unexpected group keys");
+			RETURN FALSE;
+		ELSE IF ((count(counts) != 3) OR (counts[0] != 2) OR (counts[1] != 1) OR (counts[2] != 3)) DO
+			write_log(_FUNCL_ + ": unexpected groups count");
+			RETURN FALSE;
+		END
+
+		sums = group_sum(tab.k, tab.v);
+		IF ((count(sums) != 3) OR (sums[0] != 80.0) OR (sums[1] != 0.0) OR (sums[2] != 120.0)) DO
+			write_log(_FUNCL_ + ": unexpected groups sums");
+			RETURN FALSE;
+		END
+
+		sums = group_avg(tab.k, tab.v);
+		IF ((count(sums) != 3) OR (sums[0] != 40.0) OR (sums[1] != 0.0) OR (sums[2] != 40.0)) DO
+			write_log(_FUNCL_ + ": unexpected groups averages");
+			RETURN FALSE;
+		END
+
+		groups = group_rows(tab.d);
+		counts = group_count(tab.d);
+		IF ((count(groups) != 2) OR (tab.d[groups[0]] != '2017-12-31') OR (tab.d[groups[1]] != '2018-03-01')) DO
+			write_log(_FUNCL_ + ": unexpected group dates");
+			RETURN FALSE;
+		ELSE IF ((counts[0] != 1) OR (counts[1] != 2)) DO
+			write_log(_FUNCL_ + ": unexpected group dates count");
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	IF (tc == 2) DO
+		groups = group_rows(tab.k, {6, 2, 1} UINT32);
+		sums = group_sum(tab.k, tab.v, NULL, 1, 2);
+		IF ((count(groups) != 2) OR (groups[0] != 1) OR (groups[1] != 6)) DO
+			write_log(_FUNCL_ + ": unexpected group keys of the selected rows");
+			RETURN FALSE;
+		ELSE IF ((count(sums) != 2) OR (sums[0] != 20.0) OR (sums[1] != 30.0)) DO
+			write_log(_FUNCL_ + ": unexpected groups sums of the rows range");
+			RETURN FALSE;
+		END
+		RETURN TRUE;
+	END
+
+	IF (tc == 3) DO
+		other.v[0] = 1;
+		group_sum(tab.k, other.v);
+
+		RETURN FALSE;
+	END
+
+	RETURN NULL;
+ENDPROC
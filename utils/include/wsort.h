@@ -27,9 +27,13 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "whais.h"
 
+#include <algorithm>
 #include <cassert>
+#include <memory>
 #include <vector>
 
+#include "wthread.h"
+
 
 template<typename TE, typename TC> int64_t
 partition(int64_t from, int64_t to, TC& inoutContainer, bool* const outAlreadySorted)
@@ -201,4 +205,89 @@ quick_sort(int64_t from, int64_t to, const bool reverse, TC& inoutContainer)
 }
 
 
+template<typename TE, typename TLess>
+struct _sort_slice_t
+{
+  TE*             mItems;
+  uint64_t        mFrom;
+  uint64_t        mMiddle;
+  uint64_t        mTo;
+  const TLess*    mLess;
+  bool            mMerge;
+};
+
+
+template<typename TE, typename TLess> void
+_sort_slice(void* args)
+{
+  typedef _sort_slice_t<TE, TLess> slice_t;
+
+  const slice_t& slice = *_RC(slice_t*, args);
+
+  if (slice.mMerge)
+  {
+    std::inplace_merge(slice.mItems + slice.mFrom,
+                       slice.mItems + slice.mMiddle,
+                       slice.mItems + slice.mTo,
+                       *slice.mLess);
+  }
+  else
+    std::sort(slice.mItems + slice.mFrom, slice.mItems + slice.mTo, *slice.mLess);
+}
+
+
+/* Sorts the items using several threads. Every thread sorts a slice of the
+ * items, then the sorted slices are merged two by two, also in parallel. */
+template<typename TE, typename TLess> void
+parallel_sort(TE* const items, const uint64_t count, uint_t threadsCount, const TLess& less)
+{
+  static const uint64_t MIN_SLICE_ITEMS = 4096;
+
+  threadsCount = std::min<uint64_t>(threadsCount, count / MIN_SLICE_ITEMS);
+  if (threadsCount <= 1)
+  {
+    std::sort(items, items + count, less);
+    return;
+  }
+
+  std::vector<uint64_t> bounds;
+  for (uint_t t = 0; t <= threadsCount; ++t)
+    bounds.push_back(count * t / threadsCount);
+
+  std::vector<_sort_slice_t<TE, TLess>> slices(threadsCount);
+  std::unique_ptr<whais::Thread[]> threads(new whais::Thread[threadsCount]);
+
+  for (uint_t t = 0; t < threadsCount; ++t)
+  {
+    slices[t] = {items, bounds[t], bounds[t], bounds[t + 1], &less, false};
+    threads[t].Run(_sort_slice<TE, TLess>, &slices[t]);
+  }
+
+  for (uint_t t = 0; t < threadsCount; ++t)
+    threads[t].WaitToEnd(true);
+
+  while (bounds.size() > 2)
+  {
+    std::vector<uint64_t> merged(1, 0);
+    uint_t jobs = 0;
+
+    for (uint_t b = 0; b + 2 < bounds.size(); b += 2, ++jobs)
+    {
+      slices[jobs] = {items, bounds[b], bounds[b + 1], bounds[b + 2], &less, true};
+      threads[jobs].Run(_sort_slice<TE, TLess>, &slices[jobs]);
+
+      merged.push_back(bounds[b + 2]);
+    }
+
+    for (uint_t t = 0; t < jobs; ++t)
+      threads[t].WaitToEnd(true);
+
+    if (merged.back() != bounds.back())
+      merged.push_back(bounds.back());
+
+    bounds.swap(merged);
+  }
+}
+
+
 #endif /* WSORT_H_ */
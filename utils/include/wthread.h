@@ -45,12 +45,37 @@ public:
   void unlock();
 
 private:
+  friend class Condition;
+
   Lock(const Lock&);
   Lock& operator= (const Lock&);
 
   WH_LOCK mLock;
 };
 
+
+class CUSTOM_SHL Condition
+{
+public:
+  Condition();
+  ~Condition();
+
+  //The lock must be held by the caller.
+  void Wait(Lock& lock);
+
+  //Returns false if the time has elapsed without the condition being signaled.
+  bool Wait(Lock& lock, const uint_t millisecs);
+
+  void Signal();
+  void Broadcast();
+
+private:
+  Condition(const Condition&);
+  Condition& operator= (const Condition&);
+
+  WH_COND mCond;
+};
+
 class CUSTOM_SHL SpinLock
 {
 public:
@@ -143,21 +168,23 @@ public:
         return ;
       }
 
+    //Block on the lock that was found busy the last time, then only try the
+    //other one. This avoids both dead locks and busy waiting.
+    bool blockOnFirst = true;
     while (true)
       {
-        mLock1.lock();
-        mIsAcquireed1 = true;
+        T& blockLock = blockOnFirst ? mLock1 : mLock2;
+        T& tryLock   = blockOnFirst ? mLock2 : mLock1;
 
-        if (mLock2.try_lock())
+        blockLock.lock();
+        if (tryLock.try_lock())
           {
-            mIsAcquireed2 = true;
+            mIsAcquireed1 = mIsAcquireed2 = true;
             return ;
           }
 
-        mLock1.unlock();
-        mIsAcquireed1 = false;
-
-        wh_yield();
+        blockLock.unlock();
+        blockOnFirst = ! blockOnFirst;
       }
   }
 